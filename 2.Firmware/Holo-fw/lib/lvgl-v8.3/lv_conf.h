@@ -45,11 +45,25 @@
    MEMORY SETTINGS
  *=========================*/
 
+/*Holo: 1: give LVGL its own TLSF pool in internal RAM so its objects don't share (and fragment)
+ *the heap used by String, the MJPEG buffers and the web server; 0: use the system malloc.
+ *Override with e.g. -DHOLO_LV_MEM_POOL=0 or -DHOLO_LV_MEM_SIZE=... in platformio.ini build_flags*/
+#ifndef HOLO_LV_MEM_POOL
+    #define HOLO_LV_MEM_POOL 1
+#endif
+#ifndef HOLO_LV_MEM_SIZE
+    #define HOLO_LV_MEM_SIZE (32U * 1024U)
+#endif
+
 /*1: use custom malloc/free, 0: use the built-in `lv_mem_alloc()` and `lv_mem_free()`*/
-#define LV_MEM_CUSTOM 1
+#if HOLO_LV_MEM_POOL
+    #define LV_MEM_CUSTOM 0
+#else
+    #define LV_MEM_CUSTOM 1
+#endif
 #if LV_MEM_CUSTOM == 0
     /*Size of the memory available for `lv_mem_alloc()` in bytes (>= 2kB)*/
-    #define LV_MEM_SIZE (48U * 1024U)          /*[bytes]*/
+    #define LV_MEM_SIZE HOLO_LV_MEM_SIZE          /*[bytes]*/
 
     /*Set an address for the memory pool instead of allocating it as a normal array. Can be in external SRAM too.*/
     #define LV_MEM_ADR 0     /*0: unused*/
@@ -169,6 +183,13 @@
  *Only used if software rotation is enabled in the display driver.*/
 #define LV_DISP_ROT_MAX_BUF (10*1024)
 
+/*1: fill, copy and blend RGB565 areas in the software renderer a word (2 or 4 pixels) at a time.
+ *The result is the same as with the pixel by pixel loops. Only used with LV_COLOR_DEPTH 16.
+ *Holo: on by default, override with -DLV_DRAW_SW_RGB565_WIDE=0 in platformio.ini build_flags*/
+#ifndef LV_DRAW_SW_RGB565_WIDE
+    #define LV_DRAW_SW_RGB565_WIDE 1
+#endif
+
 /*-------------
  * GPU
  *-----------*/
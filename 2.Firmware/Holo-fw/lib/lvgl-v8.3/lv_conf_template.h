@@ -169,6 +169,10 @@
  *Only used if software rotation is enabled in the display driver.*/
 #define LV_DISP_ROT_MAX_BUF (10*1024)
 
+/*1: fill, copy and blend RGB565 areas in the software renderer a word (2 or 4 pixels) at a time.
+ *The result is the same as with the pixel by pixel loops. Only used with LV_COLOR_DEPTH 16.*/
+#define LV_DRAW_SW_RGB565_WIDE 0
+
 /*-------------
  * GPU
  *-----------*/
@@ -14,10 +14,25 @@
 /*********************
  *      DEFINES
  *********************/
+#if LV_DRAW_SW_RGB565_WIDE && LV_COLOR_DEPTH == 16
+    #define BLEND_RGB565_WIDE 1
+    /*The word-wide mix reproduces the optimized 16 bit path of `lv_color_mix`*/
+    #define BLEND_RGB565_WIDE_MIX (LV_COLOR_16_SWAP == 0 && LV_COLOR_MIX_ROUND_OFS == 0)
+#else
+    #define BLEND_RGB565_WIDE 0
+    #define BLEND_RGB565_WIDE_MIX 0
+#endif
 
 /**********************
  *      TYPEDEFS
  **********************/
+#if BLEND_RGB565_WIDE
+/*Two neighboring pixels loaded or stored with one 32 bit access*/
+typedef union {
+    uint32_t full;
+    lv_color_t px[2];
+} px_pair_t;
+#endif
 
 /**********************
  *  STATIC PROTOTYPES
@@ -53,6 +68,15 @@ LV_ATTRIBUTE_FAST_MEM static void map_argb(lv_color_t * dest_buf, const lv_area_
 
 #endif /*LV_COLOR_SCREEN_TRANSP*/
 
+#if BLEND_RGB565_WIDE
+LV_ATTRIBUTE_FAST_MEM static void fill_row_rgb565_wide(lv_color_t * dest_buf, lv_color_t color, int32_t w);
+LV_ATTRIBUTE_FAST_MEM static void copy_row_rgb565_wide(lv_color_t * dest_buf, const lv_color_t * src_buf, int32_t w);
+#if BLEND_RGB565_WIDE_MIX
+LV_ATTRIBUTE_FAST_MEM static void mix_row_rgb565_wide(lv_color_t * dest_buf, const lv_color_t * src_buf, int32_t w,
+                                                      lv_opa_t opa);
+#endif
+#endif /*BLEND_RGB565_WIDE*/
+
 #if LV_DRAW_COMPLEX
 static void map_blended(lv_color_t * dest_buf, const lv_area_t * dest_area, lv_coord_t dest_stride,
                         const lv_color_t * src_buf, lv_coord_t src_stride, lv_opa_t opa,
@@ -83,6 +107,17 @@ static inline lv_color_t color_blend_true_color_multiply(lv_color_t fg, lv_color
     }                                                                                               \
     mask_tmp_x++;
 
+#if BLEND_RGB565_WIDE
+/*The pixel loop of `fill_normal` with opacity, also keeping the pair versions of the cached colors up to date*/
+#define FILL_PREMULT_PX(dest_px)                                                        \
+    if(last_dest_color.full != (dest_px).full) {                                        \
+        last_dest_color = (dest_px);                                                    \
+        last_res_color = lv_color_mix_premult(color_premult, last_dest_color, opa_inv); \
+        last_dest_pair.px[0] = last_dest_pair.px[1] = last_dest_color;                  \
+        last_res_pair.px[0] = last_res_pair.px[1] = last_res_color;                     \
+    }                                                                                   \
+    (dest_px) = last_res_color;
+#endif
 
 /**********************
  *   GLOBAL FUNCTIONS
@@ -241,7 +276,11 @@ LV_ATTRIBUTE_FAST_MEM static void fill_normal(lv_color_t * dest_buf, const lv_ar
     if(mask == NULL) {
         if(opa >= LV_OPA_MAX) {
             for(y = 0; y < h; y++) {
+#if BLEND_RGB565_WIDE
+                fill_row_rgb565_wide(dest_buf, color, w);
+#else
                 lv_color_fill(dest_buf, color, w);
+#endif
                 dest_buf += dest_stride;
             }
         }
@@ -262,6 +301,39 @@ LV_ATTRIBUTE_FAST_MEM static void fill_normal(lv_color_t * dest_buf, const lv_ar
             lv_color_premult(color, opa, color_premult);
             lv_opa_t opa_inv = 255 - opa;
 
+#if BLEND_RGB565_WIDE
+            /*Pairs of pixels both equal to the last destination color (e.g. a plain background)
+             *are written with one 32 bit store; everything else goes through the same cache as below*/
+            px_pair_t last_dest_pair;
+            px_pair_t last_res_pair;
+            last_dest_pair.px[0] = last_dest_pair.px[1] = last_dest_color;
+            last_res_pair.px[0] = last_res_pair.px[1] = last_res_color;
+
+            for(y = 0; y < h; y++) {
+                x = 0;
+                if((lv_uintptr_t)dest_buf & 0x3) {
+                    FILL_PREMULT_PX(dest_buf[0])
+                    x = 1;
+                }
+                for(; x < w - 1; x += 2) {
+                    uint32_t * d32 = (uint32_t *)&dest_buf[x];
+                    if(*d32 == last_dest_pair.full) {
+                        *d32 = last_res_pair.full;
+                    }
+                    else {
+                        px_pair_t pair;
+                        pair.full = *d32;
+                        FILL_PREMULT_PX(pair.px[0])
+                        FILL_PREMULT_PX(pair.px[1])
+                        *d32 = pair.full;
+                    }
+                }
+                if(x < w) {
+                    FILL_PREMULT_PX(dest_buf[x])
+                }
+                dest_buf += dest_stride;
+            }
+#else
             for(y = 0; y < h; y++) {
                 for(x = 0; x < w; x++) {
                     if(last_dest_color.full != dest_buf[x].full) {
@@ -272,6 +344,7 @@ LV_ATTRIBUTE_FAST_MEM static void fill_normal(lv_color_t * dest_buf, const lv_ar
                 }
                 dest_buf += dest_stride;
             }
+#endif
         }
     }
     /*Masked*/
@@ -638,16 +711,24 @@ LV_ATTRIBUTE_FAST_MEM static void map_normal(lv_color_t * dest_buf, const lv_are
     if(mask == NULL) {
         if(opa >= LV_OPA_MAX) {
             for(y = 0; y < h; y++) {
+#if BLEND_RGB565_WIDE
+                copy_row_rgb565_wide(dest_buf, src_buf, w);
+#else
                 lv_memcpy(dest_buf, src_buf, w * sizeof(lv_color_t));
+#endif
                 dest_buf += dest_stride;
                 src_buf += src_stride;
             }
         }
         else {
             for(y = 0; y < h; y++) {
+#if BLEND_RGB565_WIDE_MIX
+                mix_row_rgb565_wide(dest_buf, src_buf, w, opa);
+#else
                 for(x = 0; x < w; x++) {
                     dest_buf[x] = lv_color_mix(src_buf[x], dest_buf[x], opa);
                 }
+#endif
                 dest_buf += dest_stride;
                 src_buf += src_stride;
             }
@@ -717,6 +798,174 @@ LV_ATTRIBUTE_FAST_MEM static void map_normal(lv_color_t * dest_buf, const lv_are
     }
 }
 
+#if BLEND_RGB565_WIDE
+
+/**
+ * Fill a row a machine word (2 or 4 pixels) at a time.
+ * Single pixels until the destination is word aligned, then whole words, then the remaining pixels.
+ */
+LV_ATTRIBUTE_FAST_MEM static void fill_row_rgb565_wide(lv_color_t * dest_buf, lv_color_t color, int32_t w)
+{
+    const int32_t word_px = sizeof(lv_uintptr_t) / sizeof(lv_color_t);
+    lv_uintptr_t c_word = color.full;
+    c_word |= c_word << 16;
+#ifdef LV_ARCH_64
+    c_word |= c_word << 32;
+#endif
+
+    while(w > 0 && ((lv_uintptr_t)dest_buf & (sizeof(lv_uintptr_t) - 1))) {
+        *dest_buf = color;
+        dest_buf++;
+        w--;
+    }
+
+    lv_uintptr_t * d_word = (lv_uintptr_t *)dest_buf;
+    while(w >= 4 * word_px) {
+        d_word[0] = c_word;
+        d_word[1] = c_word;
+        d_word[2] = c_word;
+        d_word[3] = c_word;
+        d_word += 4;
+        w -= 4 * word_px;
+    }
+    while(w >= word_px) {
+        *d_word = c_word;
+        d_word++;
+        w -= word_px;
+    }
+
+    dest_buf = (lv_color_t *)d_word;
+    while(w > 0) {
+        *dest_buf = color;
+        dest_buf++;
+        w--;
+    }
+}
+
+/**
+ * Copy a row a machine word at a time if the source and destination have the same alignment.
+ * Otherwise copy it pixel by pixel (`lv_memcpy` would fall back to bytes).
+ */
+LV_ATTRIBUTE_FAST_MEM static void copy_row_rgb565_wide(lv_color_t * dest_buf, const lv_color_t * src_buf, int32_t w)
+{
+    if((((lv_uintptr_t)dest_buf ^ (lv_uintptr_t)src_buf) & (sizeof(lv_uintptr_t) - 1)) == 0) {
+        const int32_t word_px = sizeof(lv_uintptr_t) / sizeof(lv_color_t);
+        while(w > 0 && ((lv_uintptr_t)dest_buf & (sizeof(lv_uintptr_t) - 1))) {
+            *dest_buf = *src_buf;
+            dest_buf++;
+            src_buf++;
+            w--;
+        }
+
+        lv_uintptr_t * d_word = (lv_uintptr_t *)dest_buf;
+        const lv_uintptr_t * s_word = (const lv_uintptr_t *)src_buf;
+        while(w >= 4 * word_px) {
+            d_word[0] = s_word[0];
+            d_word[1] = s_word[1];
+            d_word[2] = s_word[2];
+            d_word[3] = s_word[3];
+            d_word += 4;
+            s_word += 4;
+            w -= 4 * word_px;
+        }
+        while(w >= word_px) {
+            *d_word = *s_word;
+            d_word++;
+            s_word++;
+            w -= word_px;
+        }
+        dest_buf = (lv_color_t *)d_word;
+        src_buf = (const lv_color_t *)s_word;
+    }
+    else {
+        while(w >= 4) {
+            dest_buf[0] = src_buf[0];
+            dest_buf[1] = src_buf[1];
+            dest_buf[2] = src_buf[2];
+            dest_buf[3] = src_buf[3];
+            dest_buf += 4;
+            src_buf += 4;
+            w -= 4;
+        }
+    }
+
+    while(w > 0) {
+        *dest_buf = *src_buf;
+        dest_buf++;
+        src_buf++;
+        w--;
+    }
+}
+
+#if BLEND_RGB565_WIDE_MIX
+
+/**
+ * The 16 bit version of `lv_color_mix` with `mix` already scaled to 0..32:
+ * the pixels are spread to 0b00000111111000001111100000011111 so R, G and B are mixed with one multiplication.
+ */
+LV_ATTRIBUTE_FAST_MEM static inline uint16_t mix_rgb565(uint32_t fg, uint32_t bg, uint32_t mix)
+{
+    fg = (fg | (fg << 16)) & 0x7E0F81F;
+    bg = (bg | (bg << 16)) & 0x7E0F81F;
+    uint32_t result = ((((fg - bg) * mix) >> 5) + bg) & 0x7E0F81F;
+    return (uint16_t)((result >> 16) | result);
+}
+
+/**
+ * Blend a row of `src_buf` onto `dest_buf` with `opa`, two pixels per 32 bit load and store.
+ * Pairs where the source already equals the destination are skipped.
+ */
+LV_ATTRIBUTE_FAST_MEM static void mix_row_rgb565_wide(lv_color_t * dest_buf, const lv_color_t * src_buf, int32_t w,
+                                                      lv_opa_t opa)
+{
+    uint32_t mix = ((uint32_t)opa + 4) >> 3;
+
+    if(w > 0 && ((lv_uintptr_t)dest_buf & 0x3)) {
+        dest_buf->full = mix_rgb565(src_buf->full, dest_buf->full, mix);
+        dest_buf++;
+        src_buf++;
+        w--;
+    }
+
+    uint32_t * d32 = (uint32_t *)dest_buf;
+    px_pair_t d;
+    px_pair_t s;
+    if(((lv_uintptr_t)src_buf & 0x3) == 0) {
+        const uint32_t * s32 = (const uint32_t *)src_buf;
+        for(; w >= 2; w -= 2) {
+            s.full = *s32;
+            d.full = *d32;
+            if(s.full != d.full) {
+                d.px[0].full = mix_rgb565(s.px[0].full, d.px[0].full, mix);
+                d.px[1].full = mix_rgb565(s.px[1].full, d.px[1].full, mix);
+                *d32 = d.full;
+            }
+            d32++;
+            s32++;
+        }
+        src_buf = (const lv_color_t *)s32;
+    }
+    else {
+        for(; w >= 2; w -= 2) {
+            d.full = *d32;
+            d.px[0].full = mix_rgb565(src_buf[0].full, d.px[0].full, mix);
+            d.px[1].full = mix_rgb565(src_buf[1].full, d.px[1].full, mix);
+            *d32 = d.full;
+            d32++;
+            src_buf += 2;
+        }
+    }
+
+    dest_buf = (lv_color_t *)d32;
+    if(w > 0) {
+        dest_buf->full = mix_rgb565(src_buf->full, dest_buf->full, mix);
+    }
+}
+
+#endif /*BLEND_RGB565_WIDE_MIX*/
+
+#endif /*BLEND_RGB565_WIDE*/
+
 
 
 #if LV_COLOR_SCREEN_TRANSP
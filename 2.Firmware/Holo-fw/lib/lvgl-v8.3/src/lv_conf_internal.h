@@ -409,6 +409,16 @@
     #endif
 #endif
 
+/*1: fill, copy and blend RGB565 areas in the software renderer a word (2 or 4 pixels) at a time.
+ *The result is the same as with the pixel by pixel loops. Only used with LV_COLOR_DEPTH 16.*/
+#ifndef LV_DRAW_SW_RGB565_WIDE
+    #ifdef CONFIG_LV_DRAW_SW_RGB565_WIDE
+        #define LV_DRAW_SW_RGB565_WIDE CONFIG_LV_DRAW_SW_RGB565_WIDE
+    #else
+        #define LV_DRAW_SW_RGB565_WIDE 0
+    #endif
+#endif
+
 /*-------------
  * GPU
  *-----------*/
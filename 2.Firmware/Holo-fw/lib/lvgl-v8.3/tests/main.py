@@ -22,6 +22,8 @@ build_only_options = {
 test_options = {
     'OPTIONS_TEST_SYSHEAP': 'Test config, system heap, 32 bit color depth',
     'OPTIONS_TEST_DEFHEAP': 'Test config, LVGL heap, 32 bit color depth',
+    'OPTIONS_TEST_16BIT': 'Minimal config, 16 bit color depth, tests without screenshots',
+    'OPTIONS_TEST_16BIT_SWAP': 'Normal config, 16 bit color depth swapped, tests without screenshots',
 }
 
 
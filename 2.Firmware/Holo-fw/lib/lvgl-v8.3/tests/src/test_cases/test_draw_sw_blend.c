@@ -0,0 +1,176 @@
+#if LV_BUILD_TEST
+#include "../lvgl.h"
+#include "../src/draw/sw/lv_draw_sw.h"
+
+#include "unity/unity.h"
+
+#include <stdlib.h>
+
+/* The unmasked normal fill and map paths of lv_draw_sw_blend_basic() (word-wide with
+ * LV_DRAW_SW_RGB565_WIDE) must give exactly what the pixel by pixel loops give, for
+ * every alignment of the destination and source and every width. */
+
+#define BUF_W 48
+#define BUF_H 3
+
+void setUp(void);
+void tearDown(void);
+void test_blend_fill(void);
+void test_blend_map(void);
+
+static lv_color_t dest[BUF_W * BUF_H];
+static lv_color_t expected[BUF_W * BUF_H];
+static lv_color_t src[BUF_W * BUF_H + 1];
+
+void setUp(void)
+{
+    srand(1);
+    _lv_refr_set_disp_refreshing(lv_disp_get_default());
+}
+
+void tearDown(void)
+{
+    _lv_refr_set_disp_refreshing(NULL);
+}
+
+#if LV_COLOR_DEPTH == 16
+
+static void random_fill(lv_color_t * buf, uint32_t px_num)
+{
+    /* Few distinct colors so the color caches of the blend loops are exercised too */
+    static const uint16_t palette[] = {0x0000, 0xFFFF, 0x1234, 0xF800, 0x07E0};
+    uint32_t i;
+    for(i = 0; i < px_num; i++) {
+        buf[i].full = rand() % 3 ? palette[rand() % 5] : (uint16_t)rand();
+    }
+}
+
+static void blend(const lv_area_t * area, const lv_color_t * src_buf, lv_color_t color, lv_opa_t opa)
+{
+    lv_area_t buf_area = {0, 0, BUF_W - 1, BUF_H - 1};
+    lv_draw_ctx_t draw_ctx;
+    lv_memset_00(&draw_ctx, sizeof(draw_ctx));
+    draw_ctx.buf = dest;
+    draw_ctx.buf_area = &buf_area;
+    draw_ctx.clip_area = &buf_area;
+
+    lv_draw_sw_blend_dsc_t dsc;
+    lv_memset_00(&dsc, sizeof(dsc));
+    dsc.blend_area = area;
+    dsc.src_buf = src_buf;
+    dsc.color = color;
+    dsc.opa = opa;
+    dsc.blend_mode = LV_BLEND_MODE_NORMAL;
+    dsc.mask_res = LV_DRAW_MASK_RES_FULL_COVER;
+    lv_draw_sw_blend_basic(&draw_ctx, &dsc);
+}
+
+/* The loop of fill_normal() without LV_DRAW_SW_RGB565_WIDE */
+static void reference_fill(const lv_area_t * area, lv_color_t color, lv_opa_t opa)
+{
+    lv_coord_t x;
+    lv_coord_t y;
+    if(opa >= LV_OPA_MAX) {
+        for(y = area->y1; y <= area->y2; y++) {
+            for(x = area->x1; x <= area->x2; x++) expected[y * BUF_W + x] = color;
+        }
+        return;
+    }
+
+    lv_color_t last_dest_color = lv_color_black();
+    lv_color_t last_res_color = lv_color_mix(color, last_dest_color, opa);
+#if LV_COLOR_MIX_ROUND_OFS == 0
+    opa = (uint32_t)((uint32_t)opa + 4) >> 3;
+    opa = opa << 3;
+#endif
+    uint16_t color_premult[3];
+    lv_color_premult(color, opa, color_premult);
+    lv_opa_t opa_inv = 255 - opa;
+    for(y = area->y1; y <= area->y2; y++) {
+        for(x = area->x1; x <= area->x2; x++) {
+            lv_color_t * px = &expected[y * BUF_W + x];
+            if(last_dest_color.full != px->full) {
+                last_dest_color = *px;
+                last_res_color = lv_color_mix_premult(color_premult, *px, opa_inv);
+            }
+            *px = last_res_color;
+        }
+    }
+}
+
+static void reference_map(const lv_area_t * area, const lv_color_t * src_buf, lv_opa_t opa)
+{
+    lv_coord_t w = lv_area_get_width(area);
+    lv_coord_t x;
+    lv_coord_t y;
+    for(y = area->y1; y <= area->y2; y++) {
+        for(x = area->x1; x <= area->x2; x++) {
+            lv_color_t s = src_buf[(y - area->y1) * w + (x - area->x1)];
+            lv_color_t * px = &expected[y * BUF_W + x];
+            *px = opa >= LV_OPA_MAX ? s : lv_color_mix(s, *px, opa);
+        }
+    }
+}
+
+#endif /*LV_COLOR_DEPTH == 16*/
+
+void test_blend_fill(void)
+{
+#if LV_COLOR_DEPTH == 16
+    static const lv_opa_t opas[] = {LV_OPA_COVER, LV_OPA_MAX, 252, 200, LV_OPA_50, 77, 3};
+    lv_coord_t x1;
+    lv_coord_t w;
+    uint32_t i;
+    for(i = 0; i < sizeof(opas); i++) {
+        for(x1 = 0; x1 < 8; x1++) {
+            for(w = 1; x1 + w <= BUF_W; w++) {
+                lv_area_t area = {x1, 0, x1 + w - 1, BUF_H - 1};
+                lv_color_t color;
+                color.full = (uint16_t)rand();
+                random_fill(dest, BUF_W * BUF_H);
+                lv_memcpy(expected, dest, sizeof(dest));
+
+                blend(&area, NULL, color, opas[i]);
+                reference_fill(&area, color, opas[i]);
+                TEST_ASSERT_EQUAL_HEX16_ARRAY(expected, dest, BUF_W * BUF_H);
+            }
+        }
+    }
+#else
+    TEST_IGNORE_MESSAGE("needs LV_COLOR_DEPTH 16, run with OPTIONS_TEST_16BIT");
+#endif
+}
+
+void test_blend_map(void)
+{
+#if LV_COLOR_DEPTH == 16
+    lv_coord_t x1;
+    lv_coord_t w;
+    uint32_t opa;
+    uint32_t src_ofs;
+    for(opa = LV_OPA_MIN + 1; opa <= LV_OPA_COVER; opa += 9) {
+        for(src_ofs = 0; src_ofs < 2; src_ofs++) {
+            for(x1 = 0; x1 < 8; x1++) {
+                for(w = 1; x1 + w <= BUF_W; w++) {
+                    lv_area_t area = {x1, 0, x1 + w - 1, BUF_H - 1};
+                    /* src_ofs 1 puts the source half a word off the destination */
+                    const lv_color_t * src_buf = src + src_ofs;
+                    random_fill(dest, BUF_W * BUF_H);
+                    random_fill(src, BUF_W * BUF_H + 1);
+                    /* Some source pixels equal to the destination */
+                    src[src_ofs].full = dest[x1].full;
+                    lv_memcpy(expected, dest, sizeof(dest));
+
+                    blend(&area, src_buf, lv_color_black(), (lv_opa_t)opa);
+                    reference_map(&area, src_buf, (lv_opa_t)opa);
+                    TEST_ASSERT_EQUAL_HEX16_ARRAY(expected, dest, BUF_W * BUF_H);
+                }
+            }
+        }
+    }
+#else
+    TEST_IGNORE_MESSAGE("needs LV_COLOR_DEPTH 16, run with OPTIONS_TEST_16BIT");
+#endif
+}
+
+#endif
@@ -0,0 +1,113 @@
+#if LV_BUILD_TEST
+#include "../lvgl.h"
+
+#include "unity/unity.h"
+
+#include <stdio.h>
+
+/* Soak test for the built-in TLSF heap (Holo builds LVGL with its own pool,
+ * see HOLO_LV_MEM_POOL in lv_conf.h). Screens like the picture app's are
+ * created, loaded and deleted thousands of times; the heap must return to
+ * its baseline and fragmentation must stay bounded. */
+
+#define SOAK_WARMUP 200
+#define SOAK_ROUNDS 2000
+#define SOAK_LABELS 5
+#define SOAK_SLACK 256 /*bytes*/
+
+void setUp(void);
+void tearDown(void);
+void test_mem_soak_screens(void);
+
+static lv_style_t label_style;
+
+void setUp(void)
+{
+    lv_style_init(&label_style);
+    lv_style_set_text_color(&label_style, lv_color_white());
+    lv_style_set_text_font(&label_style, LV_FONT_DEFAULT);
+}
+
+void tearDown(void)
+{
+    lv_style_reset(&label_style);
+}
+
+static lv_obj_t * build_screen(uint32_t round)
+{
+    char text[64];
+    lv_obj_t * scr = lv_obj_create(NULL);
+    lv_obj_set_style_bg_color(scr, lv_color_black(), 0);
+    lv_img_create(scr);
+    for(int i = 0; i < SOAK_LABELS; i++) {
+        lv_obj_t * label = lv_label_create(scr);
+        lv_obj_add_style(label, &label_style, LV_STATE_DEFAULT);
+        lv_label_set_long_mode(label, LV_LABEL_LONG_SCROLL_CIRCULAR);
+        lv_obj_set_width(label, 200);
+        /* Varying text lengths so blocks of different sizes get interleaved */
+        snprintf(text, sizeof(text), "#ffffff %u%%# round %u label %d %.*s", (unsigned)(round % 101),
+                 (unsigned)round, i, (int)((round * 7 + i * 13) % 24), "........................");
+        lv_label_set_text(label, text);
+        lv_obj_align(label, LV_ALIGN_CENTER, 0, (i - SOAK_LABELS / 2) * 30);
+    }
+    return scr;
+}
+
+static lv_obj_t * swap_screen(lv_obj_t * old_scr, uint32_t round)
+{
+    lv_obj_t * scr = build_screen(round);
+    lv_scr_load(scr);
+    lv_refr_now(NULL);
+    if(old_scr) lv_obj_del(old_scr);
+    return scr;
+}
+
+static uint32_t heap_used(lv_mem_monitor_t * mon)
+{
+    lv_mem_monitor(mon);
+    return mon->total_size - mon->free_size;
+}
+
+void test_mem_soak_screens(void)
+{
+#if LV_MEM_CUSTOM == 0
+    lv_obj_t * home = lv_scr_act();
+    lv_mem_monitor_t mon;
+
+    /* Warm up first: LVGL keeps some buffers once allocated (lv_mem_buf,
+     * label scroll animations), so they belong in the baseline */
+    lv_obj_t * scr = NULL;
+    for(uint32_t round = 1; round <= SOAK_WARMUP; round++) {
+        scr = swap_screen(scr, round);
+    }
+    /* Baseline and final measurement use the same screen contents */
+    scr = swap_screen(scr, 0);
+    uint32_t baseline = heap_used(&mon);
+    uint32_t baseline_cnt = mon.used_cnt;
+    uint32_t worst_frag = 0;
+    uint32_t peak = 0;
+
+    for(uint32_t round = 1; round <= SOAK_ROUNDS; round++) {
+        scr = swap_screen(scr, round);
+        uint32_t used = heap_used(&mon);
+        if(mon.frag_pct > worst_frag) worst_frag = mon.frag_pct;
+        if(used > peak) peak = used;
+    }
+    scr = swap_screen(scr, 0);
+    uint32_t used = heap_used(&mon);
+    printf("mem soak: %d rounds, baseline %u bytes in %u blocks, peak %u, end %u bytes in %u blocks, "
+           "worst frag %u%%, end frag %u%%\n", SOAK_ROUNDS, (unsigned)baseline, (unsigned)baseline_cnt,
+           (unsigned)peak, (unsigned)used, (unsigned)mon.used_cnt, (unsigned)worst_frag, (unsigned)mon.frag_pct);
+
+    /* No block may leak; retained buffers may have grown to the largest request */
+    TEST_ASSERT_EQUAL_UINT32(baseline_cnt, mon.used_cnt);
+    TEST_ASSERT_UINT32_WITHIN(SOAK_SLACK, baseline, used);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(30, worst_frag);
+    TEST_ASSERT_EQUAL(LV_RES_OK, lv_mem_test());
+
+    lv_scr_load(home);
+    lv_obj_del(scr);
+#endif
+}
+
+#endif
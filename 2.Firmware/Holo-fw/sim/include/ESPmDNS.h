@@ -0,0 +1,28 @@
+// mDNS responder that only records what it would announce
+
+#ifndef SIM_ESPMDNS_H
+#define SIM_ESPMDNS_H
+
+#include "Arduino.h"
+
+class MDNSResponder
+{
+public:
+    bool begin(const char *hostName);
+    void end() {}
+    void setInstanceName(const char *name) { (void)name; }
+    void setInstanceName(const String &name) { (void)name; }
+    void addService(const char *service, const char *proto, uint16_t port);
+    bool addServiceTxt(const char *name, const char *proto, const char *key, const char *value)
+    {
+        (void)name;
+        (void)proto;
+        (void)key;
+        (void)value;
+        return true;
+    }
+};
+
+extern MDNSResponder MDNS;
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef SIM_ESP_H
+#define SIM_ESP_H
+
+#include <stdint.h>
+
+class EspClass
+{
+public:
+    uint32_t getHeapSize();
+    uint32_t getFreeHeap();
+    uint32_t getMinFreeHeap();
+    uint32_t getMaxAllocHeap();
+    uint32_t getPsramSize() { return 0; }
+    uint8_t getChipRevision() { return 3; }
+    uint32_t getCpuFreqMHz() { return 240; }
+    uint64_t getEfuseMac();
+    void restart();
+};
+
+extern EspClass ESP;
+
+#endif
@@ -0,0 +1,103 @@
+// Arduino-ESP32 FS API (core 1.0.6 semantics) on a host directory.
+// name() is the full path inside the file system, as the firmware expects.
+// Directories list their entries sorted by name, so runs are repeatable
+// (on the card the order is the FAT directory order).
+
+#ifndef SIM_FS_H
+#define SIM_FS_H
+
+#include <memory>
+#include <string>
+#include "Arduino.h"
+#include "Stream.h"
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs
+{
+
+enum SeekMode
+{
+    SeekSet = 0,
+    SeekCur = 1,
+    SeekEnd = 2
+};
+
+class FileImpl;
+typedef std::shared_ptr<FileImpl> FileImplPtr;
+
+class File : public Stream
+{
+private:
+    FileImplPtr m_impl;
+
+public:
+    File(FileImplPtr impl = FileImplPtr()) : m_impl(impl) {}
+
+    size_t write(uint8_t c);
+    size_t write(const uint8_t *buf, size_t size);
+    using Print::write;
+    int available();
+    int read();
+    int peek();
+    void flush();
+    size_t read(uint8_t *buf, size_t size);
+    size_t readBytes(char *buf, size_t length) { return read((uint8_t *)buf, length); }
+
+    bool seek(uint32_t pos, SeekMode mode);
+    bool seek(uint32_t pos) { return seek(pos, SeekSet); }
+    size_t position() const;
+    size_t size() const;
+    void close();
+    operator bool() const;
+    time_t getLastWrite();
+    const char *name() const;
+
+    boolean isDirectory(void);
+    File openNextFile(const char *mode = FILE_READ);
+    void rewindDirectory(void);
+};
+
+class FS
+{
+protected:
+    std::string m_root;
+    bool m_flat; // SPIFFS: no directories, "a/b" is just a name
+
+public:
+    FS(bool flat = false) : m_flat(flat) {}
+    void setRoot(const std::string &root) { m_root = root; }
+    const std::string &root() const { return m_root; }
+
+    File open(const char *path, const char *mode = FILE_READ);
+    File open(const String &path, const char *mode = FILE_READ) { return open(path.c_str(), mode); }
+
+    bool exists(const char *path);
+    bool exists(const String &path) { return exists(path.c_str()); }
+    bool remove(const char *path);
+    bool remove(const String &path) { return remove(path.c_str()); }
+    bool rename(const char *from, const char *to);
+    bool rename(const String &from, const String &to) { return rename(from.c_str(), to.c_str()); }
+    bool mkdir(const char *path);
+    bool mkdir(const String &path) { return mkdir(path.c_str()); }
+    bool rmdir(const char *path);
+    bool rmdir(const String &path) { return rmdir(path.c_str()); }
+
+    uint64_t totalBytes();
+    uint64_t usedBytes();
+
+    std::string hostPath(const char *path) const;
+};
+
+} // namespace fs
+
+using fs::File;
+using fs::FS;
+using fs::SeekCur;
+using fs::SeekEnd;
+using fs::SeekMode;
+using fs::SeekSet;
+
+#endif
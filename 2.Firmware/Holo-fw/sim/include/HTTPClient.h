@@ -0,0 +1,23 @@
+// Included by src/network.h but not used by the firmware; requests always fail
+
+#ifndef SIM_HTTPCLIENT_H
+#define SIM_HTTPCLIENT_H
+
+#include "Arduino.h"
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+
+class HTTPClient
+{
+public:
+    bool begin(const String &url)
+    {
+        (void)url;
+        return false;
+    }
+    void end() {}
+    int GET() { return HTTPC_ERROR_CONNECTION_REFUSED; }
+    String getString() { return String(); }
+};
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef SIM_I2CDEV_H
+#define SIM_I2CDEV_H
+
+// src/ includes I2Cdev.h before the MPU6050 class; nothing else is used
+#include "Wire.h"
+
+#endif
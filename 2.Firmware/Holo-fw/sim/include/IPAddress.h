@@ -0,0 +1,41 @@
+#ifndef SIM_IPADDRESS_H
+#define SIM_IPADDRESS_H
+
+#include <stdint.h>
+#include "Print.h"
+
+// Stored in network byte order like the Arduino core, so the uint32_t value
+// matches what lwIP (and src/wifi_manager.cpp's cache) uses.
+class IPAddress : public Printable
+{
+private:
+    union
+    {
+        uint8_t bytes[4];
+        uint32_t dword;
+    } m_address;
+
+public:
+    IPAddress() { m_address.dword = 0; }
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+    {
+        m_address.bytes[0] = a;
+        m_address.bytes[1] = b;
+        m_address.bytes[2] = c;
+        m_address.bytes[3] = d;
+    }
+    IPAddress(uint32_t address) { m_address.dword = address; }
+
+    operator uint32_t() const { return m_address.dword; }
+    bool operator==(const IPAddress &addr) const { return m_address.dword == addr.m_address.dword; }
+    bool operator!=(const IPAddress &addr) const { return m_address.dword != addr.m_address.dword; }
+    uint8_t operator[](int index) const { return m_address.bytes[index]; }
+    uint8_t &operator[](int index) { return m_address.bytes[index]; }
+
+    bool fromString(const char *address);
+    bool fromString(const String &address) { return fromString(address.c_str()); }
+    String toString() const;
+    size_t printTo(Print &p) const { return p.print(toString()); }
+};
+
+#endif
@@ -0,0 +1,92 @@
+// MPU6050 (with the MotionApps 2.0 DMP interface) replaying an IMU trace.
+//
+// The trace is what the firmware prints with IMU_TRACE (src/driver/imu.h):
+//   imu,<ms>,<ax>,<ay>,<az>,<gx>,<gy>,<gz>   raw FIFO samples
+//   quat,<ms>,<w>,<x>,<y>,<z>                DMP orientation
+// other lines are ignored. Sample times count from the first FIFO reset, so
+// a sample with ms <= millis() - <reset time> is in the FIFO. The samples were
+// logged after orient(), which is the identity for the boot orientation.
+// Without a trace, or once it has run out, the device lies still.
+// The gyro has the bias set with sim_imu_sensor() (none by default), which
+// the gyro offsets cancel as on the chip: each offset step is 4 LSB of data at
+// +-250dps. CalibrateGyro() sets the offsets that cancel it; accelerometer
+// offsets and CalibrateAccel() are stored but do not alter data.
+// With SimOptions::imu_absent the chip does not answer testConnection().
+// Register reads and FIFO transfers count as I2C traffic (sim_i2c_stats()).
+
+#ifndef SIM_MPU6050_6AXIS_MOTIONAPPS20_H
+#define SIM_MPU6050_6AXIS_MOTIONAPPS20_H
+
+#include "Arduino.h"
+
+#define MPU6050_DEFAULT_ADDRESS 0x68
+#define MPU6050_DLPF_BW_256 0x00
+#define MPU6050_DLPF_BW_188 0x01
+#define MPU6050_DLPF_BW_98 0x02
+#define MPU6050_DLPF_BW_42 0x03
+#define MPU6050_DLPF_BW_20 0x04
+#define MPU6050_DLPF_BW_10 0x05
+#define MPU6050_DLPF_BW_5 0x06
+#define MPU6050_INTERRUPT_DATA_RDY_BIT 0
+#define MPU6050_DMP_PACKET_SIZE 42
+
+class MPU6050
+{
+private:
+    uint8_t m_address;
+    int16_t m_offsets[6]; // gyro x/y/z, accel x/y/z
+    uint8_t m_dlpf = 0;
+    uint8_t m_rate = 0;
+    bool m_fifoEnabled = false;
+    bool m_dmpEnabled = false;
+
+    int16_t gyroOut(int axis, int16_t rate);
+
+public:
+    MPU6050(uint8_t address = MPU6050_DEFAULT_ADDRESS);
+
+    void initialize();
+    bool testConnection();
+
+    void getMotion6(int16_t *ax, int16_t *ay, int16_t *az, int16_t *gx, int16_t *gy, int16_t *gz);
+    int16_t getTemperature();
+
+    int16_t getXGyroOffset() { return m_offsets[0]; }
+    int16_t getYGyroOffset() { return m_offsets[1]; }
+    int16_t getZGyroOffset() { return m_offsets[2]; }
+    int16_t getXAccelOffset() { return m_offsets[3]; }
+    int16_t getYAccelOffset() { return m_offsets[4]; }
+    int16_t getZAccelOffset() { return m_offsets[5]; }
+    void setXGyroOffset(int16_t offset) { m_offsets[0] = offset; }
+    void setYGyroOffset(int16_t offset) { m_offsets[1] = offset; }
+    void setZGyroOffset(int16_t offset) { m_offsets[2] = offset; }
+    void setXAccelOffset(int16_t offset) { m_offsets[3] = offset; }
+    void setYAccelOffset(int16_t offset) { m_offsets[4] = offset; }
+    void setZAccelOffset(int16_t offset) { m_offsets[5] = offset; }
+    void CalibrateAccel(uint8_t loops = 15) { (void)loops; }
+    void CalibrateGyro(uint8_t loops = 15);
+    void PrintActiveOffsets();
+
+    void setDLPFMode(uint8_t mode) { m_dlpf = mode; }
+    void setRate(uint8_t rate) { m_rate = rate; }
+    void setFIFOEnabled(bool enabled) { m_fifoEnabled = enabled; }
+    void setAccelFIFOEnabled(bool enabled) { (void)enabled; }
+    void setXGyroFIFOEnabled(bool enabled) { (void)enabled; }
+    void setYGyroFIFOEnabled(bool enabled) { (void)enabled; }
+    void setZGyroFIFOEnabled(bool enabled) { (void)enabled; }
+    void setIntEnabled(uint8_t enabled) { (void)enabled; }
+    void setInterruptMode(bool mode) { (void)mode; }
+    void setInterruptDrive(bool drive) { (void)drive; }
+    void setInterruptLatch(bool latch) { (void)latch; }
+    void resetFIFO();
+    uint16_t getFIFOCount();
+    void getFIFOBytes(uint8_t *data, uint8_t length);
+
+    uint8_t dmpInitialize();
+    void setDMPEnabled(bool enabled);
+    uint16_t dmpGetFIFOPacketSize() { return MPU6050_DMP_PACKET_SIZE; }
+    uint8_t dmpGetQuaternion(int16_t *data, const uint8_t *packet);
+    uint8_t dmpGetGyro(int16_t *data, const uint8_t *packet);
+};
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef SIM_SD_H
+#define SIM_SD_H
+
+#include "FS.h"
+#include "SPI.h"
+
+typedef enum
+{
+    CARD_NONE,
+    CARD_MMC,
+    CARD_SD,
+    CARD_SDHC,
+    CARD_UNKNOWN
+} sdcard_type_t;
+
+namespace fs
+{
+
+// The card is the --sd directory; it is "inserted" when the directory exists
+class SDFS : public FS
+{
+private:
+    bool m_mounted = false;
+
+public:
+    bool begin(uint8_t ssPin = 5, SPIClass &spi = SPI, uint32_t frequency = 4000000,
+               const char *mountpoint = "/sd", uint8_t max_files = 5);
+    void end() { m_mounted = false; }
+    sdcard_type_t cardType() { return m_mounted ? CARD_SDHC : CARD_NONE; }
+    uint64_t cardSize() { return m_mounted ? 8ULL * 1024 * 1024 * 1024 : 0; }
+};
+
+} // namespace fs
+
+extern fs::SDFS SD;
+
+using namespace fs;
+
+#endif
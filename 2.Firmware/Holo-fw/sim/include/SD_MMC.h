@@ -0,0 +1,25 @@
+#ifndef SIM_SD_MMC_H
+#define SIM_SD_MMC_H
+
+#include "SD.h"
+
+namespace fs
+{
+
+// Same directory as SD; the firmware uses the SPI driver
+class SDMMCFS : public SDFS
+{
+public:
+    bool begin(const char *mountpoint = "/sdcard", bool mode1bit = false)
+    {
+        (void)mountpoint;
+        (void)mode1bit;
+        return SDFS::begin();
+    }
+};
+
+} // namespace fs
+
+extern fs::SDMMCFS SD_MMC;
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef SIM_SPI_H
+#define SIM_SPI_H
+
+#include <stdint.h>
+
+#define VSPI 3
+#define HSPI 2
+
+class SPIClass
+{
+public:
+    SPIClass(uint8_t bus = HSPI) { (void)bus; }
+    void begin(int8_t sck = -1, int8_t miso = -1, int8_t mosi = -1, int8_t ss = -1)
+    {
+        (void)sck;
+        (void)miso;
+        (void)mosi;
+        (void)ss;
+    }
+    void end() {}
+    void setFrequency(uint32_t freq) { (void)freq; }
+};
+
+extern SPIClass SPI;
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef SIM_SPIFFS_H
+#define SIM_SPIFFS_H
+
+#include "FS.h"
+
+namespace fs
+{
+
+// <flash_dir>/spiffs; names may contain '/' without directories existing
+class SPIFFSFS : public FS
+{
+public:
+    SPIFFSFS() : FS(true) {}
+    bool begin(bool formatOnFail = false, const char *basePath = "/spiffs", uint8_t maxOpenFiles = 10,
+               const char *partitionLabel = NULL);
+    bool format();
+    void end() {}
+};
+
+} // namespace fs
+
+extern fs::SPIFFSFS SPIFFS;
+
+#endif
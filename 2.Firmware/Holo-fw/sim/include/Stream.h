@@ -0,0 +1,28 @@
+#ifndef SIM_STREAM_H
+#define SIM_STREAM_H
+
+#include "Print.h"
+
+class Stream : public Print
+{
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    virtual size_t readBytes(uint8_t *buf, size_t len)
+    {
+        size_t count = 0;
+        for (int c; count < len && (c = read()) >= 0; ++count)
+        {
+            buf[count] = (uint8_t)c;
+        }
+        return count;
+    }
+    size_t readBytes(char *buf, size_t len) { return readBytes((uint8_t *)buf, len); }
+    void setTimeout(unsigned long timeout) { m_timeout = timeout; }
+
+protected:
+    unsigned long m_timeout = 1000;
+};
+
+#endif
@@ -0,0 +1,101 @@
+// TFT_eSPI drawing into the simulator framebuffer (sim.h).
+//
+// The framebuffer holds what the ST7789 would show, in drawing coordinates
+// (setRotation() is recorded, the mirror it selects is not applied). Byte
+// order follows the library: without swapBytes a uint16_t pixel goes out in
+// memory order, i.e. byte swapped on a little-endian CPU. Every call is
+// counted as SPI traffic: 11 bytes to set an address window plus 2 per pixel.
+
+#ifndef SIM_TFT_ESPI_H
+#define SIM_TFT_ESPI_H
+
+#include "Arduino.h"
+#include "sim.h"
+
+#define TFT_BLACK 0x0000
+#define TFT_NAVY 0x000F
+#define TFT_DARKGREEN 0x03E0
+#define TFT_MAROON 0x7800
+#define TFT_BLUE 0x001F
+#define TFT_GREEN 0x07E0
+#define TFT_CYAN 0x07FF
+#define TFT_RED 0xF800
+#define TFT_MAGENTA 0xF81F
+#define TFT_YELLOW 0xFFE0
+#define TFT_WHITE 0xFFFF
+
+#define TFT_MADCTL 0x36
+#define ST7789_DISPOFF 0x28
+#define ST7789_DISPON 0x29
+
+class TFT_eSPI
+{
+private:
+    int32_t m_width;
+    int32_t m_height;
+    uint8_t m_rotation = 0;
+    bool m_swapBytes = false;
+    bool m_dma = false;
+    // address window of pushColors()
+    int32_t m_winX0 = 0, m_winY0 = 0, m_winX1 = 0, m_winY1 = 0;
+    int32_t m_curX = 0, m_curY = 0;
+
+public:
+    TFT_eSPI(int16_t w = SIM_SCREEN_WIDTH, int16_t h = SIM_SCREEN_HEIGHT) : m_width(w), m_height(h) {}
+
+    void init(uint8_t tc = 0) { begin(tc); }
+    void begin(uint8_t tc = 0);
+
+    int16_t width() const { return m_width; }
+    int16_t height() const { return m_height; }
+    void setRotation(uint8_t r) { m_rotation = r; }
+    uint8_t getRotation() const { return m_rotation; }
+    void setSwapBytes(bool swap) { m_swapBytes = swap; }
+    bool getSwapBytes() const { return m_swapBytes; }
+
+    void writecommand(uint8_t c);
+    void writedata(uint8_t d);
+    uint8_t readcommand8(uint8_t cmd, uint8_t index = 0)
+    {
+        (void)cmd;
+        (void)index;
+        return 0;
+    }
+
+    void startWrite() {}
+    void endWrite() {}
+    void setAddrWindow(int32_t x, int32_t y, int32_t w, int32_t h);
+    void pushColors(uint16_t *data, uint32_t len, bool swap = true);
+    void pushColor(uint16_t color);
+
+    void pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t *data);
+    void pushImage(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t *data)
+    {
+        pushImage(x, y, w, h, (const uint16_t *)data);
+    }
+    void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color);
+    void fillScreen(uint32_t color) { fillRect(0, 0, m_width, m_height, color); }
+    void drawPixel(int32_t x, int32_t y, uint32_t color) { fillRect(x, y, 1, 1, color); }
+
+    // DMA transfers complete immediately
+    bool initDMA(bool ctrl_cs = false)
+    {
+        (void)ctrl_cs;
+        m_dma = true;
+        return true;
+    }
+    void deInitDMA() { m_dma = false; }
+    bool dmaBusy() { return false; }
+    void dmaWait() {}
+    void pushImageDMA(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t *data, uint16_t *buffer = NULL)
+    {
+        (void)buffer;
+        pushImage(x, y, w, h, (const uint16_t *)data);
+    }
+
+private:
+    void window(int32_t x, int32_t y, int32_t w, int32_t h);
+    void put(int32_t x, int32_t y, uint16_t color);
+};
+
+#endif
@@ -0,0 +1,158 @@
+// Arduino String on top of std::string, with the Arduino semantics that
+// src/ relies on (index -1 when not found, toInt() of garbage is 0, ...).
+
+#ifndef SIM_WSTRING_H
+#define SIM_WSTRING_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string>
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+class __FlashStringHelper;
+
+class String
+{
+private:
+    std::string m_str;
+
+public:
+    String(const char *cstr = "") : m_str(NULL == cstr ? "" : cstr) {}
+    String(const char *cstr, unsigned int len) : m_str(cstr, len) {}
+    String(const std::string &str) : m_str(str) {}
+    explicit String(char c) : m_str(1, c) {}
+    explicit String(unsigned char value, unsigned char base = DEC);
+    explicit String(int value, unsigned char base = DEC);
+    explicit String(unsigned int value, unsigned char base = DEC);
+    explicit String(long value, unsigned char base = DEC);
+    explicit String(unsigned long value, unsigned char base = DEC);
+    explicit String(long long value, unsigned char base = DEC);
+    explicit String(unsigned long long value, unsigned char base = DEC);
+    explicit String(float value, unsigned int decimals = 2);
+    explicit String(double value, unsigned int decimals = 2);
+
+    unsigned int length() const { return m_str.size(); }
+    bool isEmpty() const { return m_str.empty(); }
+    const char *c_str() const { return m_str.c_str(); }
+    bool reserve(unsigned int size)
+    {
+        m_str.reserve(size);
+        return true;
+    }
+
+    String &operator=(const char *cstr)
+    {
+        m_str = NULL == cstr ? "" : cstr;
+        return *this;
+    }
+
+    bool concat(const String &str)
+    {
+        m_str += str.m_str;
+        return true;
+    }
+    bool concat(const char *cstr)
+    {
+        m_str += NULL == cstr ? "" : cstr;
+        return true;
+    }
+    bool concat(char c)
+    {
+        m_str += c;
+        return true;
+    }
+    bool concat(int value) { return concat(String(value)); }
+    bool concat(unsigned int value) { return concat(String(value)); }
+    bool concat(long value) { return concat(String(value)); }
+    bool concat(unsigned long value) { return concat(String(value)); }
+    bool concat(float value) { return concat(String(value)); }
+    bool concat(double value) { return concat(String(value)); }
+
+    template <typename T>
+    String &operator+=(const T &value)
+    {
+        concat(value);
+        return *this;
+    }
+
+    bool equals(const String &str) const { return m_str == str.m_str; }
+    bool equals(const char *cstr) const { return m_str == (NULL == cstr ? "" : cstr); }
+    bool equalsIgnoreCase(const String &str) const;
+    bool operator==(const String &str) const { return equals(str); }
+    bool operator==(const char *cstr) const { return equals(cstr); }
+    bool operator!=(const String &str) const { return !equals(str); }
+    bool operator!=(const char *cstr) const { return !equals(cstr); }
+    bool operator<(const String &str) const { return m_str < str.m_str; }
+    int compareTo(const String &str) const { return m_str.compare(str.m_str); }
+
+    bool startsWith(const String &prefix) const { return 0 == m_str.compare(0, prefix.length(), prefix.m_str); }
+    bool endsWith(const String &suffix) const
+    {
+        return m_str.size() >= suffix.length() &&
+               0 == m_str.compare(m_str.size() - suffix.length(), suffix.length(), suffix.m_str);
+    }
+
+    char charAt(unsigned int index) const { return index < m_str.size() ? m_str[index] : 0; }
+    void setCharAt(unsigned int index, char c)
+    {
+        if (index < m_str.size())
+        {
+            m_str[index] = c;
+        }
+    }
+    char operator[](unsigned int index) const { return charAt(index); }
+    char &operator[](unsigned int index) { return m_str[index]; }
+    void getBytes(unsigned char *buf, unsigned int size, unsigned int index = 0) const;
+    void toCharArray(char *buf, unsigned int size, unsigned int index = 0) const
+    {
+        getBytes((unsigned char *)buf, size, index);
+    }
+
+    int indexOf(char c, unsigned int from = 0) const { return find(m_str.find(c, from)); }
+    int indexOf(const String &str, unsigned int from = 0) const { return find(m_str.find(str.m_str, from)); }
+    int lastIndexOf(char c) const { return find(m_str.rfind(c)); }
+    int lastIndexOf(const String &str) const { return find(m_str.rfind(str.m_str)); }
+    String substring(unsigned int begin) const { return substring(begin, m_str.size()); }
+    String substring(unsigned int begin, unsigned int end) const;
+
+    void replace(const String &find, const String &replace);
+    void remove(unsigned int index) { remove(index, (unsigned int)-1); }
+    void remove(unsigned int index, unsigned int count)
+    {
+        if (index < m_str.size())
+        {
+            m_str.erase(index, count);
+        }
+    }
+    void toLowerCase();
+    void toUpperCase();
+    void trim();
+
+    long toInt() const { return atol(m_str.c_str()); }
+    float toFloat() const { return (float)atof(m_str.c_str()); }
+    double toDouble() const { return atof(m_str.c_str()); }
+
+private:
+    static int find(size_t pos) { return std::string::npos == pos ? -1 : (int)pos; }
+};
+
+template <typename T>
+inline String operator+(const String &lhs, const T &rhs)
+{
+    String ret = lhs;
+    ret.concat(rhs);
+    return ret;
+}
+
+inline String operator+(const char *lhs, const String &rhs)
+{
+    String ret = lhs;
+    ret.concat(rhs);
+    return ret;
+}
+
+#endif
@@ -0,0 +1,140 @@
+// WiFi station on the host's loopback interface. With the connection times of
+// SimOptions at 0 begin() "connects" at once and reports
+// SYSTEM_EVENT_STA_GOT_IP from the calling thread; otherwise the events come
+// from a thread of their own (the event task on the device) after the scan
+// (skipped when begin() gets a BSSID and channel), the association and the
+// DHCP exchange (skipped after config() with a static address).
+
+#ifndef SIM_WIFI_H
+#define SIM_WIFI_H
+
+#include "Arduino.h"
+#include "IPAddress.h"
+#include "WiFiClient.h"
+#include "esp_wifi.h"
+
+typedef enum
+{
+    WL_NO_SHIELD = 255,
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL,
+    WL_SCAN_COMPLETED,
+    WL_CONNECTED,
+    WL_CONNECT_FAILED,
+    WL_CONNECTION_LOST,
+    WL_DISCONNECTED
+} wl_status_t;
+
+typedef enum
+{
+    SYSTEM_EVENT_WIFI_READY = 0,
+    SYSTEM_EVENT_SCAN_DONE,
+    SYSTEM_EVENT_STA_START,
+    SYSTEM_EVENT_STA_STOP,
+    SYSTEM_EVENT_STA_CONNECTED,
+    SYSTEM_EVENT_STA_DISCONNECTED,
+    SYSTEM_EVENT_STA_AUTHMODE_CHANGE,
+    SYSTEM_EVENT_STA_GOT_IP,
+    SYSTEM_EVENT_STA_LOST_IP,
+    SYSTEM_EVENT_MAX = 32
+} system_event_id_t;
+
+typedef void (*WiFiEventCb)(system_event_id_t event);
+
+class WiFiClass
+{
+private:
+    wifi_mode_t m_mode = WIFI_MODE_NULL;
+    wl_status_t m_status = WL_DISCONNECTED;
+    String m_ssid;
+    String m_hostname;
+    bool m_ap = false;
+    bool m_static_ip = false;
+    unsigned m_attempt = 0; // a pending connection only completes while this is unchanged
+    WiFiEventCb m_callbacks[4] = {NULL, NULL, NULL, NULL};
+
+    void event(system_event_id_t event);
+    void complete(unsigned attempt, uint32_t delay_ms, bool found);
+
+public:
+    wl_status_t begin(const char *ssid, const char *passphrase = NULL, int32_t channel = 0,
+                      const uint8_t *bssid = NULL, bool connect = true);
+    bool config(IPAddress local_ip, IPAddress gateway, IPAddress subnet, IPAddress dns1 = (uint32_t)0,
+                IPAddress dns2 = (uint32_t)0);
+    bool disconnect(bool wifioff = false, bool eraseap = false);
+    wl_status_t status() { return m_status; }
+    bool isConnected() { return WL_CONNECTED == m_status; }
+
+    bool mode(wifi_mode_t mode);
+    wifi_mode_t getMode() { return m_mode; }
+    bool enableSTA(bool enable);
+    bool enableAP(bool enable);
+    void persistent(bool persistent) { (void)persistent; }
+    bool setAutoConnect(bool autoConnect)
+    {
+        (void)autoConnect;
+        return true;
+    }
+    bool setAutoReconnect(bool autoReconnect)
+    {
+        (void)autoReconnect;
+        return true;
+    }
+    bool setSleep(bool enable)
+    {
+        (void)enable;
+        return true;
+    }
+    bool setHostname(const char *hostname);
+    const char *getHostname() { return m_hostname.c_str(); }
+    int onEvent(WiFiEventCb cb);
+
+    IPAddress localIP();
+    IPAddress subnetMask() { return IPAddress(255, 0, 0, 0); }
+    IPAddress gatewayIP() { return localIP(); }
+    IPAddress dnsIP(uint8_t dns_no = 0)
+    {
+        (void)dns_no;
+        return localIP();
+    }
+    uint8_t *macAddress(uint8_t *mac);
+    String macAddress();
+    String SSID() { return m_ssid; }
+    uint8_t *BSSID();
+    int32_t channel();
+    int32_t RSSI() { return isConnected() ? -40 : 0; }
+
+    int16_t scanNetworks() { return 0; }
+    String SSID(uint8_t index)
+    {
+        (void)index;
+        return String();
+    }
+    int32_t RSSI(uint8_t index)
+    {
+        (void)index;
+        return 0;
+    }
+    wifi_auth_mode_t encryptionType(uint8_t index)
+    {
+        (void)index;
+        return WIFI_AUTH_OPEN;
+    }
+
+    bool softAP(const char *ssid, const char *passphrase = NULL, int channel = 1, int ssid_hidden = 0,
+                int max_connection = 4);
+    bool softAPConfig(IPAddress local_ip, IPAddress gateway, IPAddress subnet)
+    {
+        (void)local_ip;
+        (void)gateway;
+        (void)subnet;
+        return true;
+    }
+    bool softAPdisconnect(bool wifioff = false);
+    IPAddress softAPIP() { return m_ap ? localIP() : IPAddress(); }
+    String softAPmacAddress() { return macAddress(); }
+};
+
+extern WiFiClass WiFi;
+
+#endif
@@ -0,0 +1,35 @@
+// TCP client over a host socket
+
+#ifndef SIM_WIFICLIENT_H
+#define SIM_WIFICLIENT_H
+
+#include "Arduino.h"
+#include "Client.h"
+
+class WiFiClient : public Client
+{
+private:
+    int m_fd = -1;
+
+public:
+    WiFiClient() {}
+    ~WiFiClient() { stop(); }
+    WiFiClient(const WiFiClient &) = delete;
+    WiFiClient &operator=(const WiFiClient &) = delete;
+
+    int connect(IPAddress ip, uint16_t port);
+    int connect(const char *host, uint16_t port);
+    size_t write(uint8_t data) { return write(&data, 1); }
+    size_t write(const uint8_t *buf, size_t size);
+    using Print::write;
+    int available();
+    int read();
+    int read(uint8_t *buf, size_t size);
+    int peek();
+    void flush() {}
+    void stop();
+    uint8_t connected();
+    operator bool() { return connected(); }
+};
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef SIM_WIFIMULTI_H
+#define SIM_WIFIMULTI_H
+
+#include "WiFi.h"
+#include <vector> // the core header brings it in and src/ relies on that
+
+class WiFiMulti
+{
+private:
+    String m_ssid;
+    String m_passphrase;
+
+public:
+    bool addAP(const char *ssid, const char *passphrase = NULL)
+    {
+        if (0 == m_ssid.length())
+        {
+            m_ssid = ssid;
+            m_passphrase = NULL == passphrase ? "" : passphrase;
+        }
+        return true;
+    }
+    uint8_t run(uint32_t connectTimeout = 5000)
+    {
+        (void)connectTimeout;
+        if (WL_CONNECTED != WiFi.status() && m_ssid.length() > 0)
+        {
+            WiFi.begin(m_ssid.c_str(), m_passphrase.c_str());
+        }
+        return WiFi.status();
+    }
+};
+
+#endif
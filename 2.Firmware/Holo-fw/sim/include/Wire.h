@@ -0,0 +1,42 @@
+// I2C master. The only device reached through Wire directly is the BH1750
+// light sensor (src/driver/ambient.cpp); it answers with a fixed reading.
+// The MPU6050 is simulated one level up, see MPU6050_6Axis_MotionApps20.h.
+// Transfers count as I2C traffic (sim_i2c_stats()).
+
+#ifndef SIM_WIRE_H
+#define SIM_WIRE_H
+
+#include "Arduino.h"
+
+class TwoWire : public Stream
+{
+private:
+    uint8_t m_rx[32];
+    uint8_t m_rxLen = 0;
+    uint8_t m_rxPos = 0;
+
+public:
+    bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0);
+    void setClock(uint32_t frequency) { (void)frequency; }
+    void beginTransmission(uint16_t address) { (void)address; }
+    uint8_t endTransmission(bool sendStop = true);
+    uint8_t requestFrom(uint16_t address, uint8_t size, bool sendStop = true);
+    size_t write(uint8_t data)
+    {
+        (void)data;
+        return 1;
+    }
+    size_t write(const uint8_t *data, size_t size)
+    {
+        (void)data;
+        return size;
+    }
+    using Print::write;
+    int available() { return m_rxLen - m_rxPos; }
+    int read() { return m_rxPos < m_rxLen ? m_rx[m_rxPos++] : -1; }
+    int peek() { return m_rxPos < m_rxLen ? m_rx[m_rxPos] : -1; }
+};
+
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef SIM_ESP32_HAL_TIMER_H
+#define SIM_ESP32_HAL_TIMER_H
+
+// Hardware timers are not simulated; src/ only includes the header.
+#include "esp32-hal.h"
+
+typedef struct hw_timer_s hw_timer_t;
+
+#endif
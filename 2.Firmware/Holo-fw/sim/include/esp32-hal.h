@@ -0,0 +1,44 @@
+// Timing and peripheral helpers of the ESP32 Arduino core (esp32-hal-*.h).
+// millis()/micros() come from the simulator clock, see sim.h.
+
+#ifndef SIM_ESP32_HAL_H
+#define SIM_ESP32_HAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_DATA_ATTR
+#define ESP_ERROR_CHECK(x) ((void)(x))
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield(void);
+
+double ledcSetup(uint8_t channel, double freq, uint8_t resolution_bits);
+void ledcAttachPin(uint8_t pin, uint8_t channel);
+void ledcDetachPin(uint8_t pin);
+void ledcWrite(uint8_t channel, uint32_t duty);
+uint32_t ledcRead(uint8_t channel);
+
+float temperatureRead(void);
+bool psramFound(void);
+// There is no PSRAM, so like on a board without it these fail
+void *ps_malloc(size_t size);
+void *ps_calloc(size_t n, size_t size);
+void *ps_realloc(void *ptr, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
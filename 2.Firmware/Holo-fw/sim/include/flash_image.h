@@ -0,0 +1,147 @@
+// File-backed NOR flash image for the simulator's partitions (esp_partition.h)
+// and the host tools.
+//
+// The image file is mapped into memory the way esp_partition_mmap() maps a
+// partition on the device, so code under test reads it through a plain
+// pointer. Writes follow NOR rules (bits only go from 1 to 0, anything else is
+// counted as a violation) and erases reset a 4 KB sector to 0xFF.
+// A power cut can be scheduled after a number of programmed bytes (an erase
+// counts as one): the write that crosses it stops half way, an erase hit by it
+// clears only the second half of the sector, and every later operation fails
+// until flash_image_power_on().
+// POSIX only (open/mmap).
+
+#ifndef SIM_FLASH_IMAGE_H
+#define SIM_FLASH_IMAGE_H
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define FLASH_IMAGE_SECTOR 4096
+
+struct FlashImage
+{
+    uint8_t *map;
+    uint32_t size;
+    int fd;
+    long budget; // bytes that can still be programmed before the power cut, < 0 for none
+    bool powered;
+    uint32_t writes;
+    uint32_t erases;
+    uint32_t violations;
+};
+
+// Maps `path`, creating it erased (0xFF) when it does not exist or has another size
+static inline bool flash_image_open(FlashImage *img, const char *path, uint32_t size)
+{
+    memset(img, 0, sizeof(*img));
+    img->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (img->fd < 0)
+    {
+        return false;
+    }
+    off_t cur = lseek(img->fd, 0, SEEK_END);
+    if (cur != (off_t)size)
+    {
+        static uint8_t erased[FLASH_IMAGE_SECTOR];
+        memset(erased, 0xFF, sizeof(erased));
+        if (0 != ftruncate(img->fd, 0))
+        {
+            return false;
+        }
+        for (uint32_t pos = 0; pos < size; pos += sizeof(erased))
+        {
+            if (write(img->fd, erased, sizeof(erased)) != (ssize_t)sizeof(erased))
+            {
+                return false;
+            }
+        }
+    }
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, img->fd, 0);
+    if (MAP_FAILED == map)
+    {
+        close(img->fd);
+        return false;
+    }
+    img->map = (uint8_t *)map;
+    img->size = size;
+    img->budget = -1;
+    img->powered = true;
+    return true;
+}
+
+static inline void flash_image_close(FlashImage *img)
+{
+    if (NULL != img->map)
+    {
+        msync(img->map, img->size, MS_SYNC);
+        munmap(img->map, img->size);
+        close(img->fd);
+    }
+    img->map = NULL;
+}
+
+static inline void flash_image_cut_after(FlashImage *img, long bytes)
+{
+    img->budget = bytes;
+}
+
+static inline void flash_image_power_on(FlashImage *img)
+{
+    img->budget = -1;
+    img->powered = true;
+}
+
+static inline bool flash_image_write(void *ctx, uint32_t offset, const void *data, uint32_t len)
+{
+    FlashImage *img = (FlashImage *)ctx;
+    if (!img->powered || offset + len > img->size)
+    {
+        return false;
+    }
+    ++img->writes;
+    const uint8_t *src = (const uint8_t *)data;
+    for (uint32_t i = 0; i < len; ++i)
+    {
+        if (0 == img->budget)
+        {
+            img->powered = false;
+            return false;
+        }
+        if (img->budget > 0)
+        {
+            --img->budget;
+        }
+        uint8_t &cell = img->map[offset + i];
+        img->violations += (src[i] & ~cell) ? 1 : 0;
+        cell &= src[i];
+    }
+    return true;
+}
+
+static inline bool flash_image_erase(void *ctx, uint32_t offset)
+{
+    FlashImage *img = (FlashImage *)ctx;
+    if (!img->powered || offset % FLASH_IMAGE_SECTOR || offset >= img->size)
+    {
+        return false;
+    }
+    ++img->erases;
+    if (0 == img->budget)
+    {
+        memset(img->map + offset + FLASH_IMAGE_SECTOR / 2, 0xFF, FLASH_IMAGE_SECTOR / 2);
+        img->powered = false;
+        return false;
+    }
+    if (img->budget > 0)
+    {
+        --img->budget;
+    }
+    memset(img->map + offset, 0xFF, FLASH_IMAGE_SECTOR);
+    return true;
+}
+
+#endif
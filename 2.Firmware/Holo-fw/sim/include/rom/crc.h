@@ -0,0 +1,18 @@
+#ifndef SIM_ROM_CRC_H
+#define SIM_ROM_CRC_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// CRC-32 (IEEE, reflected) as in the ESP32 ROM: chaining crc32_le(crc, ...) continues a checksum
+uint32_t crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,114 @@
+// Host simulator of the firmware.
+//
+// src/ is compiled unchanged against the shim headers in sim/include:
+//   SD card     a host directory (FS.h, SD.h, ff.h)
+//   flash       one image file per data partition of partitions-no-ota.csv
+//               (esp_partition.h); SPIFFS is a second host directory
+//   display     a 240x240 RGB565 framebuffer behind TFT_eSPI, optionally
+//               mirrored to an SDL window (build with -DSIM_SDL -lSDL2)
+//   IMU         MPU6050 whose FIFO replays an IMU_TRACE log (imu,/quat, lines)
+//   network     WiFi "connects" to the loopback interface; the servers bind
+//               real host sockets, ports below 1024 are moved up by an offset
+//   FreeRTOS    tasks and timers on host threads
+// sim_main.cpp runs setup() and loop() like the Arduino loop task; other host
+// programs can link the shims and drive parts of the firmware themselves; the
+// checks in tools/ share their scaffolding through sim_check.h.
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+
+#define SIM_SCREEN_WIDTH 240
+#define SIM_SCREEN_HEIGHT 240
+
+struct SimOptions
+{
+    const char *sd_dir;         // root of the SD card
+    const char *flash_dir;      // partition images and the SPIFFS directory
+    const char *partitions;     // partition table (csv)
+    const char *imu_trace;      // trace to replay, NULL for a device lying still
+    bool imu_absent;            // the MPU6050 does not answer on the bus
+    bool virtual_time;          // millis() only advances while the loop task delays or waits
+    int port_offset;            // added to ports below 1024 when binding
+    bool quiet;                 // drop Serial output
+    bool window;                // mirror the framebuffer to an SDL window
+    int window_scale;
+    int wifi_start_ms;          // WiFi.mode() starting the driver and lwIP
+    int wifi_scan_ms;           // WiFi connection times, all 0: connected at once
+    int wifi_assoc_ms;
+    int wifi_dhcp_ms;
+    int wifi_channel;           // of the access point; begin() with another channel finds nothing
+};
+
+// Fills in the defaults (./sd, ./flash, partitions-no-ota.csv, real time, offset 8000,
+// WiFi connected at once on channel 1)
+void sim_default_options(SimOptions *options);
+// Applies options; call before setup() or any other firmware code
+bool sim_begin(const SimOptions *options);
+void sim_end();
+
+// Marks the calling thread as the Arduino loop task (delay() advances virtual time there)
+void sim_set_loop_task();
+bool sim_on_loop_task();
+// Moves the virtual clock forward; ignored in real time
+void sim_advance_ms(uint32_t ms);
+uint64_t sim_now_us();
+// CPU time of the calling thread, less what the loop task spent stepping
+// virtual time in delay() and waits (the other tasks run then)
+uint64_t sim_thread_cpu_us();
+
+// Panel traffic: what would have gone over SPI
+struct SimPanelStats
+{
+    uint64_t bytes;    // pixel data and command/address bytes
+    uint64_t pixels;
+    uint32_t windows;  // address windows set (one per pushImage/pushColors call)
+    uint32_t fills;
+};
+
+// The panel as it would look: RGB565, row major, SIM_SCREEN_WIDTH x SIM_SCREEN_HEIGHT
+const uint16_t *sim_framebuffer();
+void sim_panel_stats(SimPanelStats *stats);
+void sim_panel_reset_stats();
+// 64-bit FNV-1a of the framebuffer
+uint64_t sim_framebuffer_hash();
+bool sim_write_ppm(const char *path);
+// Shows the framebuffer in the SDL window if there is one; false when it was closed
+bool sim_window_update();
+
+// SD card writes (File::write, f_write) stop short once `bytes` more bytes
+// went through, as on a full card; negative: no limit (the default)
+void sim_sd_limit_writes(long bytes);
+
+// How the firmware used WiFi and the network stack since start
+struct SimWifiStats
+{
+    uint32_t scans;      // begin() without a BSSID and channel
+    uint32_t dhcp;       // addresses handed out by DHCP
+    uint32_t static_ip;  // connections with a static address from config()
+    uint32_t not_found;  // begin() on a channel the access point is not on
+    uint32_t early_binds; // bind() before WiFi.mode() started the network stack
+};
+void sim_wifi_stats(SimWifiStats *stats);
+
+// The simulated MPU6050's gyro bias (raw LSB at +-250dps, before the offset
+// registers) and die temperature; by default no bias at 30 C
+void sim_imu_sensor(const float gyro_bias[3], float celsius);
+// What the MPU6050's data registers (getMotion6) read from now on, raw at
+// +-2g and +-250dps, until the FIFO or the trace moves on to another sample
+void sim_imu_motion(const int16_t accel[3], const int16_t gyro[3]);
+
+// I2C traffic: register accesses and FIFO reads of the MPU6050 and BH1750
+struct SimI2cStats
+{
+    uint32_t transfers;
+    uint32_t loop_transfers; // of those, made on the loop task
+};
+void sim_i2c_stats(SimI2cStats *stats);
+
+// Pending IMU trace samples; the trace is replayed against millis() from the
+// first FIFO reset on
+bool sim_imu_done();
+
+#endif
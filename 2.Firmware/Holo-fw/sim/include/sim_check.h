@@ -0,0 +1,74 @@
+// Scaffolding shared by the host checks in tools/*_check.cpp.
+//
+// check() prints one result line and counts the failures; a check ends with
+// "<name> check passed" or "<name> check FAILED (<failures>)" and exits
+// non-zero when a check failed. SimCheckDir is the temporary directory a check
+// keeps the simulated card and flash in. Header only: the checks that test a
+// module on its own build without the simulator.
+
+#ifndef SIM_CHECK_H
+#define SIM_CHECK_H
+
+#include "sim.h"
+
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include <string>
+
+static int failures = 0;
+
+static inline void check(bool ok, const char *what)
+{
+    printf("%s  %s\n", ok ? "ok  " : "FAIL", what);
+    failures += ok ? 0 : 1;
+}
+
+struct SimCheckDir
+{
+    std::string path;  // /tmp/<name>.XXXXXX
+    std::string sd;    // <path>/sd, created empty
+    std::string flash; // <path>/flash, left to sim_begin()
+};
+
+// Creates the directory of the check `name` and, with `options`, points the
+// SD card and the flash there; prints why and returns false when it cannot
+static inline bool sim_check_dir(const char *name, SimCheckDir *dir, SimOptions *options = NULL)
+{
+    std::string path = std::string("/tmp/") + name + ".XXXXXX";
+    if (NULL == mkdtemp(&path[0]))
+    {
+        fprintf(stderr, "%s: mkdtemp: ", name);
+        perror(NULL);
+        return false;
+    }
+    dir->path = path;
+    dir->sd = path + "/sd";
+    dir->flash = path + "/flash";
+    mkdir(dir->sd.c_str(), 0755);
+    if (NULL != options)
+    {
+        options->sd_dir = dir->sd.c_str();
+        options->flash_dir = dir->flash.c_str();
+    }
+    return true;
+}
+
+static inline int sim_check_remove_entry(const char *path, const struct stat *st, int flag, struct FTW *ftw)
+{
+    (void)st;
+    (void)flag;
+    (void)ftw;
+    remove(path);
+    return 0;
+}
+
+// Removes the directory with everything the check left in it
+static inline void sim_check_remove(const SimCheckDir &dir)
+{
+    nftw(dir.path.c_str(), sim_check_remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+#endif
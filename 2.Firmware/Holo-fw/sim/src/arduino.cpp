@@ -0,0 +1,645 @@
+// Arduino core on the host: clock, Serial, String, GPIO/LEDC stand-ins
+
+#include "Arduino.h"
+#include "sim_internal.h"
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <random>
+#include <set>
+#include <thread>
+
+#define SIM_LEDC_CHANNELS 16
+#define SIM_GPIO_NUM 40
+
+SimOptions sim_options;
+
+static std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+static std::atomic<uint64_t> virtual_us(0);
+static thread_local bool loop_task = false;
+static std::mt19937 prng(1);
+static std::mutex prng_lock;
+static uint32_t ledc_duty[SIM_LEDC_CHANNELS];
+static uint8_t gpio_level[SIM_GPIO_NUM];
+
+HardwareSerial Serial;
+EspClass ESP;
+
+// -------------------------------------------------------------------- clock
+//
+// In virtual time only the loop task moves the clock. Other threads report
+// their timed waits (sim_sleep_begin/end); delay() on the loop task then
+// steps the clock from one of their deadlines to the next and, after each
+// step, lets the threads it woke run until they wait again. A thread that
+// keeps running longer than SIM_SETTLE_US is assumed to be blocked outside
+// the simulator (select(), recv()) and no longer waited for.
+
+#define SIM_SETTLE_US 5000
+#define SIM_SETTLE_MAX_US 50000
+
+typedef std::chrono::steady_clock::time_point RealTime;
+
+static std::mutex sched_lock;
+static std::condition_variable sched_cv;
+static std::multiset<uint64_t> sched_deadlines;
+static std::map<std::thread::id, RealTime> sched_running; // woken threads and when they woke
+static thread_local bool sched_sleeping = false;
+static thread_local std::multiset<uint64_t>::iterator sched_slot;
+static thread_local uint64_t stepping_cpu_ns = 0; // CPU the loop task spent in advance_to()
+
+void sim_set_loop_task()
+{
+    loop_task = true;
+}
+
+bool sim_on_loop_task()
+{
+    return loop_task;
+}
+
+void sim_clock_begin()
+{
+    start_time = std::chrono::steady_clock::now();
+}
+
+uint64_t sim_now_us()
+{
+    if (sim_options.virtual_time)
+    {
+        return virtual_us.load();
+    }
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time)
+        .count();
+}
+
+void sim_sleep_begin(uint64_t deadline_us)
+{
+    if (!sim_options.virtual_time || loop_task)
+    {
+        return;
+    }
+    std::lock_guard<std::mutex> guard(sched_lock);
+    if (sched_sleeping)
+    {
+        sched_deadlines.erase(sched_slot);
+    }
+    sched_running.erase(std::this_thread::get_id());
+    sched_slot = sched_deadlines.insert(deadline_us);
+    sched_sleeping = true;
+    sched_cv.notify_all();
+}
+
+void sim_sleep_end()
+{
+    if (!sim_options.virtual_time || loop_task || !sched_sleeping)
+    {
+        return;
+    }
+    std::lock_guard<std::mutex> guard(sched_lock);
+    sched_deadlines.erase(sched_slot);
+    sched_running[std::this_thread::get_id()] = std::chrono::steady_clock::now();
+    sched_sleeping = false;
+}
+
+// Waits until no deadline up to now is pending and every woken thread waits again
+static void settle(std::unique_lock<std::mutex> &lock)
+{
+    RealTime start = std::chrono::steady_clock::now();
+    while (true)
+    {
+        RealTime now = std::chrono::steady_clock::now();
+        bool busy = !sched_deadlines.empty() && *sched_deadlines.begin() <= virtual_us.load();
+        for (auto it = sched_running.begin(); !busy && it != sched_running.end(); ++it)
+        {
+            busy = now - it->second < std::chrono::microseconds(SIM_SETTLE_US);
+        }
+        if (!busy || now - start > std::chrono::microseconds(SIM_SETTLE_MAX_US))
+        {
+            return;
+        }
+        sched_cv.wait_for(lock, std::chrono::microseconds(100));
+    }
+}
+
+static uint64_t thread_cpu_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+uint64_t sim_thread_cpu_us()
+{
+    return (thread_cpu_ns() - stepping_cpu_ns) / 1000;
+}
+
+static void advance_to(uint64_t target)
+{
+    uint64_t cpu_start = thread_cpu_ns();
+    std::unique_lock<std::mutex> lock(sched_lock);
+    settle(lock);
+    while (virtual_us.load() < target)
+    {
+        // Deadlines at or before now belong to threads that did not settle in time
+        auto next = sched_deadlines.upper_bound(virtual_us.load());
+        virtual_us = sched_deadlines.end() == next || *next > target ? target : *next;
+        sched_cv.notify_all();
+        settle(lock);
+    }
+    stepping_cpu_ns += thread_cpu_ns() - cpu_start;
+}
+
+void sim_advance_ms(uint32_t ms)
+{
+    if (sim_options.virtual_time)
+    {
+        advance_to(virtual_us.load() + (uint64_t)ms * 1000);
+    }
+}
+
+// Like on the device the counters are 32 bits wide and wrap
+extern "C" unsigned long millis(void)
+{
+    return (uint32_t)(sim_now_us() / 1000);
+}
+
+extern "C" unsigned long micros(void)
+{
+    return (uint32_t)sim_now_us();
+}
+
+extern "C" void delay(uint32_t ms)
+{
+    if (!sim_options.virtual_time)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    }
+    else if (loop_task)
+    {
+        sim_advance_ms(ms);
+    }
+    else
+    {
+        uint64_t deadline = sim_now_us() + (uint64_t)ms * 1000;
+        sim_sleep_begin(deadline);
+        {
+            std::unique_lock<std::mutex> lock(sched_lock);
+            sched_cv.wait(lock, [deadline] { return virtual_us.load() >= deadline; });
+        }
+        sim_sleep_end();
+    }
+}
+
+extern "C" void delayMicroseconds(uint32_t us)
+{
+    if (sim_options.virtual_time && loop_task)
+    {
+        virtual_us += us;
+        return;
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+extern "C" void yield(void)
+{
+    std::this_thread::yield();
+}
+
+// ---------------------------------------------------------------- peripherals
+
+extern "C" void pinMode(uint8_t pin, uint8_t mode)
+{
+    (void)pin;
+    (void)mode;
+}
+
+extern "C" void digitalWrite(uint8_t pin, uint8_t val)
+{
+    if (pin < SIM_GPIO_NUM)
+    {
+        gpio_level[pin] = val;
+    }
+}
+
+extern "C" int digitalRead(uint8_t pin)
+{
+    return pin < SIM_GPIO_NUM ? gpio_level[pin] : LOW;
+}
+
+extern "C" uint16_t analogRead(uint8_t pin)
+{
+    (void)pin;
+    return 0;
+}
+
+// Interrupt pins never fire; the firmware polls when none is wired (IMU_INT_PIN)
+extern "C" void attachInterrupt(uint8_t pin, void (*fn)(void), int mode)
+{
+    (void)pin;
+    (void)fn;
+    (void)mode;
+}
+
+extern "C" void detachInterrupt(uint8_t pin)
+{
+    (void)pin;
+}
+
+extern "C" double ledcSetup(uint8_t channel, double freq, uint8_t resolution_bits)
+{
+    (void)channel;
+    (void)resolution_bits;
+    return freq;
+}
+
+extern "C" void ledcAttachPin(uint8_t pin, uint8_t channel)
+{
+    (void)pin;
+    (void)channel;
+}
+
+extern "C" void ledcDetachPin(uint8_t pin)
+{
+    (void)pin;
+}
+
+extern "C" void ledcWrite(uint8_t channel, uint32_t duty)
+{
+    if (channel < SIM_LEDC_CHANNELS)
+    {
+        ledc_duty[channel] = duty;
+    }
+}
+
+extern "C" uint32_t ledcRead(uint8_t channel)
+{
+    return channel < SIM_LEDC_CHANNELS ? ledc_duty[channel] : 0;
+}
+
+extern "C" float temperatureRead(void)
+{
+    return 45.0f;
+}
+
+extern "C" bool psramFound(void)
+{
+    return false;
+}
+
+extern "C" void *ps_malloc(size_t size)
+{
+    (void)size;
+    return NULL;
+}
+
+extern "C" void *ps_calloc(size_t n, size_t size)
+{
+    (void)n;
+    (void)size;
+    return NULL;
+}
+
+extern "C" void *ps_realloc(void *ptr, size_t size)
+{
+    (void)ptr;
+    (void)size;
+    return NULL;
+}
+
+// Seeded, so runs are repeatable
+extern "C" uint32_t esp_random(void)
+{
+    std::lock_guard<std::mutex> guard(prng_lock);
+    return prng();
+}
+
+extern "C" void esp_restart(void)
+{
+    ESP.restart();
+}
+
+extern "C" uint32_t esp_get_free_heap_size(void)
+{
+    return ESP.getFreeHeap();
+}
+
+long random(long max)
+{
+    return max <= 0 ? 0 : (long)(esp_random() % (uint32_t)max);
+}
+
+long random(long min, long max)
+{
+    return max <= min ? min : min + random(max - min);
+}
+
+void randomSeed(unsigned long seed)
+{
+    std::lock_guard<std::mutex> guard(prng_lock);
+    prng.seed(seed);
+}
+
+long map(long x, long in_min, long in_max, long out_min, long out_max)
+{
+    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+// The host has no heap limit worth modelling; report what a running device has free
+uint32_t EspClass::getHeapSize()
+{
+    return 320 * 1024;
+}
+
+uint32_t EspClass::getFreeHeap()
+{
+    return 160 * 1024;
+}
+
+uint32_t EspClass::getMinFreeHeap()
+{
+    return 120 * 1024;
+}
+
+uint32_t EspClass::getMaxAllocHeap()
+{
+    return 110 * 1024;
+}
+
+uint64_t EspClass::getEfuseMac()
+{
+    return 0x5634129F6FA4ULL; // A4:6F:9F:12:34:56
+}
+
+void EspClass::restart()
+{
+    Serial.println("sim: ESP.restart()");
+    fflush(stdout);
+    _exit(0);
+}
+
+// ------------------------------------------------------------------ Serial
+
+size_t HardwareSerial::write(uint8_t c)
+{
+    if (!sim_options.quiet)
+    {
+        fputc(c, stdout);
+    }
+    return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *buf, size_t size)
+{
+    if (!sim_options.quiet)
+    {
+        fwrite(buf, 1, size, stdout);
+    }
+    return size;
+}
+
+void HardwareSerial::flush()
+{
+    fflush(stdout);
+}
+
+size_t Print::write(const uint8_t *buf, size_t size)
+{
+    size_t n = 0;
+    while (n < size && write(buf[n]))
+    {
+        ++n;
+    }
+    return n;
+}
+
+size_t Print::printf(const char *format, ...)
+{
+    char stack_buf[128];
+    char *buf = stack_buf;
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(buf, sizeof(stack_buf), format, args);
+    va_end(args);
+    if (len < 0)
+    {
+        return 0;
+    }
+    if (len >= (int)sizeof(stack_buf))
+    {
+        buf = (char *)malloc(len + 1);
+        va_start(args, format);
+        vsnprintf(buf, len + 1, format, args);
+        va_end(args);
+    }
+    size_t n = write((const uint8_t *)buf, len);
+    if (buf != stack_buf)
+    {
+        free(buf);
+    }
+    return n;
+}
+
+static void format_number(char *buf, size_t size, unsigned long long value, bool negative, int base)
+{
+    char digits[72];
+    int pos = sizeof(digits) - 1;
+    digits[pos] = 0;
+    base = base < 2 ? 10 : base;
+    do
+    {
+        int d = value % base;
+        digits[--pos] = d < 10 ? '0' + d : 'A' + d - 10;
+        value /= base;
+    } while (value > 0);
+    if (negative)
+    {
+        digits[--pos] = '-';
+    }
+    snprintf(buf, size, "%s", digits + pos);
+}
+
+size_t Print::print(long long value, int base)
+{
+    char buf[72];
+    if (10 == base && value < 0)
+    {
+        format_number(buf, sizeof(buf), 0ULL - (unsigned long long)value, true, base);
+    }
+    else
+    {
+        format_number(buf, sizeof(buf), (unsigned long long)value, false, base);
+    }
+    return write(buf);
+}
+
+size_t Print::print(unsigned long long value, int base)
+{
+    char buf[72];
+    format_number(buf, sizeof(buf), value, false, base);
+    return write(buf);
+}
+
+size_t Print::print(double value, int digits)
+{
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*f", digits, value);
+    return write(buf);
+}
+
+// ------------------------------------------------------------------ String
+
+static std::string number_string(unsigned long long value, bool negative, unsigned char base)
+{
+    char buf[72];
+    format_number(buf, sizeof(buf), value, negative, base);
+    if (16 == base)
+    {
+        // Arduino prints hex digits in lower case in String(value, HEX)
+        for (char *p = buf; *p; ++p)
+        {
+            *p = tolower(*p);
+        }
+    }
+    return buf;
+}
+
+static std::string signed_string(long long value, unsigned char base)
+{
+    if (10 == base && value < 0)
+    {
+        return number_string(0ULL - (unsigned long long)value, true, base);
+    }
+    return number_string((unsigned long long)value, false, base);
+}
+
+String::String(unsigned char value, unsigned char base) : m_str(number_string(value, false, base)) {}
+String::String(int value, unsigned char base) : m_str(signed_string(value, base)) {}
+String::String(unsigned int value, unsigned char base) : m_str(number_string(value, false, base)) {}
+String::String(long value, unsigned char base) : m_str(signed_string(value, base)) {}
+String::String(unsigned long value, unsigned char base) : m_str(number_string(value, false, base)) {}
+String::String(long long value, unsigned char base) : m_str(signed_string(value, base)) {}
+String::String(unsigned long long value, unsigned char base) : m_str(number_string(value, false, base)) {}
+
+String::String(float value, unsigned int decimals) : String((double)value, decimals) {}
+
+String::String(double value, unsigned int decimals)
+{
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*f", (int)decimals, value);
+    m_str = buf;
+}
+
+bool String::equalsIgnoreCase(const String &str) const
+{
+    return m_str.size() == str.m_str.size() && 0 == strcasecmp(m_str.c_str(), str.m_str.c_str());
+}
+
+void String::getBytes(unsigned char *buf, unsigned int size, unsigned int index) const
+{
+    if (0 == size || NULL == buf)
+    {
+        return;
+    }
+    if (index >= m_str.size())
+    {
+        buf[0] = 0;
+        return;
+    }
+    unsigned int n = m_str.size() - index;
+    n = n < size - 1 ? n : size - 1;
+    memcpy(buf, m_str.data() + index, n);
+    buf[n] = 0;
+}
+
+String String::substring(unsigned int begin, unsigned int end) const
+{
+    if (begin > end)
+    {
+        unsigned int temp = begin;
+        begin = end;
+        end = temp;
+    }
+    if (begin >= m_str.size())
+    {
+        return String();
+    }
+    end = end > m_str.size() ? m_str.size() : end;
+    return String(m_str.substr(begin, end - begin));
+}
+
+void String::replace(const String &find, const String &replace)
+{
+    if (find.m_str.empty())
+    {
+        return;
+    }
+    size_t pos = 0;
+    while (std::string::npos != (pos = m_str.find(find.m_str, pos)))
+    {
+        m_str.replace(pos, find.m_str.size(), replace.m_str);
+        pos += replace.m_str.size();
+    }
+}
+
+void String::toLowerCase()
+{
+    for (char &c : m_str)
+    {
+        c = tolower((unsigned char)c);
+    }
+}
+
+void String::toUpperCase()
+{
+    for (char &c : m_str)
+    {
+        c = toupper((unsigned char)c);
+    }
+}
+
+void String::trim()
+{
+    size_t begin = 0;
+    size_t end = m_str.size();
+    while (begin < end && isspace((unsigned char)m_str[begin]))
+    {
+        ++begin;
+    }
+    while (end > begin && isspace((unsigned char)m_str[end - 1]))
+    {
+        --end;
+    }
+    m_str = m_str.substr(begin, end - begin);
+}
+
+// ---------------------------------------------------------------- IPAddress
+
+bool IPAddress::fromString(const char *address)
+{
+    unsigned int a, b, c, d;
+    char tail;
+    if (4 != sscanf(address, "%u.%u.%u.%u%c", &a, &b, &c, &d, &tail) || a > 255 || b > 255 || c > 255 ||
+        d > 255)
+    {
+        return false;
+    }
+    *this = IPAddress(a, b, c, d);
+    return true;
+}
+
+String IPAddress::toString() const
+{
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%u.%u.%u.%u", m_address.bytes[0], m_address.bytes[1], m_address.bytes[2],
+             m_address.bytes[3]);
+    return String(buf);
+}
@@ -0,0 +1,374 @@
+// ESP-IDF pieces: flash partitions, ROM CRC, heap capabilities, RMT/LEDC/GPIO
+
+#include "Arduino.h"
+#include "sim_internal.h"
+
+#include <driver/gpio.h>
+#include <driver/ledc.h>
+#include <driver/rmt.h>
+#include <esp_partition.h>
+#include <flash_image.h>
+#include <rom/crc.h>
+
+#include <ctype.h>
+#include <sys/stat.h>
+
+#include <mutex>
+
+#define SIM_MAX_PARTITIONS 16
+
+struct SimPartition
+{
+    esp_partition_t info;
+    FlashImage image;
+    bool opened;
+};
+
+static SimPartition partitions[SIM_MAX_PARTITIONS];
+static int partition_num = 0;
+static std::mutex flash_lock;
+static uint32_t fade_duty[LEDC_CHANNEL_MAX];
+
+// ----------------------------------------------------------------- partitions
+
+static bool parse_subtype(const char *text, esp_partition_type_t type, esp_partition_subtype_t *out)
+{
+    static const struct
+    {
+        const char *name;
+        esp_partition_subtype_t subtype;
+    } names[] = {{"ota", ESP_PARTITION_SUBTYPE_DATA_OTA},
+                 {"phy", ESP_PARTITION_SUBTYPE_DATA_PHY},
+                 {"nvs", ESP_PARTITION_SUBTYPE_DATA_NVS},
+                 {"spiffs", ESP_PARTITION_SUBTYPE_DATA_SPIFFS}};
+    char *end;
+    unsigned long value = strtoul(text, &end, 0);
+    if (end != text && 0 == *end)
+    {
+        *out = (esp_partition_subtype_t)value;
+        return true;
+    }
+    if (ESP_PARTITION_TYPE_DATA != type)
+    {
+        *out = (esp_partition_subtype_t)0; // app subtypes are not looked up
+        return true;
+    }
+    for (size_t pos = 0; pos < sizeof(names) / sizeof(names[0]); ++pos)
+    {
+        if (!strcmp(text, names[pos].name))
+        {
+            *out = names[pos].subtype;
+            return true;
+        }
+    }
+    return false;
+}
+
+static char *trim(char *text)
+{
+    while (isspace((unsigned char)*text))
+    {
+        ++text;
+    }
+    char *end = text + strlen(text);
+    while (end > text && isspace((unsigned char)end[-1]))
+    {
+        *--end = 0;
+    }
+    return text;
+}
+
+bool sim_partitions_load()
+{
+    FILE *fp = fopen(sim_options.partitions, "r");
+    if (NULL == fp)
+    {
+        fprintf(stderr, "sim: cannot open partition table %s\n", sim_options.partitions);
+        return false;
+    }
+    mkdir(sim_options.flash_dir, 0755);
+    partition_num = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), fp) && partition_num < SIM_MAX_PARTITIONS)
+    {
+        char *fields[6] = {NULL};
+        int count = 0;
+        char *hash = strchr(line, '#');
+        if (NULL != hash)
+        {
+            *hash = 0;
+        }
+        for (char *save = NULL, *tok = strtok_r(line, ",", &save); tok && count < 6;
+             tok = strtok_r(NULL, ",", &save))
+        {
+            fields[count++] = trim(tok);
+        }
+        if (count < 5 || 0 == *fields[0])
+        {
+            continue;
+        }
+        SimPartition &part = partitions[partition_num];
+        memset(&part, 0, sizeof(part));
+        part.info.type = !strcmp(fields[1], "app") ? ESP_PARTITION_TYPE_APP : ESP_PARTITION_TYPE_DATA;
+        if (!parse_subtype(fields[2], part.info.type, &part.info.subtype))
+        {
+            fprintf(stderr, "sim: unknown partition subtype %s\n", fields[2]);
+            continue;
+        }
+        part.info.address = strtoul(fields[3], NULL, 0);
+        part.info.size = strtoul(fields[4], NULL, 0);
+        snprintf(part.info.label, sizeof(part.info.label), "%s", fields[0]);
+        ++partition_num;
+    }
+    fclose(fp);
+    return partition_num > 0;
+}
+
+// Opens the image on first use; an existing shorter file is padded with 0xFF
+static bool partition_open(SimPartition *part)
+{
+    if (part->opened)
+    {
+        return true;
+    }
+    std::string path = sim_flash_path((std::string(part->info.label) + ".bin").c_str());
+    struct stat st;
+    if (0 == stat(path.c_str(), &st) && st.st_size < (off_t)part->info.size)
+    {
+        FILE *fp = fopen(path.c_str(), "ab");
+        if (NULL == fp)
+        {
+            return false;
+        }
+        for (off_t pos = st.st_size; pos < (off_t)part->info.size; ++pos)
+        {
+            fputc(0xFF, fp);
+        }
+        fclose(fp);
+    }
+    else if (0 == stat(path.c_str(), &st) && st.st_size > (off_t)part->info.size)
+    {
+        fprintf(stderr, "sim: %s is larger than partition %s\n", path.c_str(), part->info.label);
+        return false;
+    }
+    if (!flash_image_open(&part->image, path.c_str(), part->info.size))
+    {
+        fprintf(stderr, "sim: cannot map %s\n", path.c_str());
+        return false;
+    }
+    part->opened = true;
+    return true;
+}
+
+extern "C" const esp_partition_t *esp_partition_find_first(esp_partition_type_t type,
+                                                           esp_partition_subtype_t subtype, const char *label)
+{
+    std::lock_guard<std::mutex> guard(flash_lock);
+    for (int pos = 0; pos < partition_num; ++pos)
+    {
+        SimPartition &part = partitions[pos];
+        if (part.info.type != type ||
+            (ESP_PARTITION_SUBTYPE_ANY != subtype && part.info.subtype != subtype) ||
+            (NULL != label && strcmp(part.info.label, label)))
+        {
+            continue;
+        }
+        if (ESP_PARTITION_TYPE_DATA == type && !partition_open(&part))
+        {
+            return NULL;
+        }
+        return &part.info;
+    }
+    return NULL;
+}
+
+static SimPartition *find_part(const esp_partition_t *partition)
+{
+    for (int pos = 0; pos < partition_num; ++pos)
+    {
+        if (&partitions[pos].info == partition && partitions[pos].opened)
+        {
+            return &partitions[pos];
+        }
+    }
+    return NULL;
+}
+
+extern "C" esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst,
+                                        size_t size)
+{
+    std::lock_guard<std::mutex> guard(flash_lock);
+    SimPartition *part = find_part(partition);
+    if (NULL == part || src_offset + size > part->info.size)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(dst, part->image.map + src_offset, size);
+    return ESP_OK;
+}
+
+extern "C" esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src,
+                                         size_t size)
+{
+    std::lock_guard<std::mutex> guard(flash_lock);
+    SimPartition *part = find_part(partition);
+    if (NULL == part || dst_offset + size > part->info.size)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return flash_image_write(&part->image, dst_offset, src, size) ? ESP_OK : ESP_FAIL;
+}
+
+extern "C" esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size)
+{
+    std::lock_guard<std::mutex> guard(flash_lock);
+    SimPartition *part = find_part(partition);
+    if (NULL == part || offset % FLASH_IMAGE_SECTOR || size % FLASH_IMAGE_SECTOR ||
+        offset + size > part->info.size)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (size_t pos = offset; pos < offset + size; pos += FLASH_IMAGE_SECTOR)
+    {
+        if (!flash_image_erase(&part->image, pos))
+        {
+            return ESP_FAIL;
+        }
+    }
+    return ESP_OK;
+}
+
+// The whole image is mapped while the partition is open, unmapping is a no-op
+extern "C" esp_err_t esp_partition_mmap(const esp_partition_t *partition, size_t offset, size_t size,
+                                        spi_flash_mmap_memory_t memory, const void **out_ptr,
+                                        spi_flash_mmap_handle_t *out_handle)
+{
+    (void)memory;
+    std::lock_guard<std::mutex> guard(flash_lock);
+    SimPartition *part = find_part(partition);
+    if (NULL == part || offset + size > part->info.size)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out_ptr = part->image.map + offset;
+    *out_handle = (spi_flash_mmap_handle_t)(part - partitions);
+    return ESP_OK;
+}
+
+extern "C" void spi_flash_munmap(spi_flash_mmap_handle_t handle)
+{
+    (void)handle;
+}
+
+void sim_partitions_close()
+{
+    std::lock_guard<std::mutex> guard(flash_lock);
+    for (int pos = 0; pos < partition_num; ++pos)
+    {
+        if (partitions[pos].opened)
+        {
+            flash_image_close(&partitions[pos].image);
+            partitions[pos].opened = false;
+        }
+    }
+}
+
+// --------------------------------------------------------------------- misc
+
+extern "C" uint32_t crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+    crc = ~crc;
+    for (uint32_t pos = 0; pos < len; ++pos)
+    {
+        crc ^= buf[pos];
+        for (int bit = 0; bit < 8; ++bit)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+extern "C" size_t heap_caps_get_free_size(uint32_t caps)
+{
+    (void)caps;
+    return ESP.getFreeHeap();
+}
+
+extern "C" size_t heap_caps_get_largest_free_block(uint32_t caps)
+{
+    (void)caps;
+    return ESP.getMaxAllocHeap();
+}
+
+extern "C" void heap_caps_dump_all(void)
+{
+}
+
+extern "C" esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+    digitalWrite(gpio_num, level);
+    return ESP_OK;
+}
+
+extern "C" esp_err_t gpio_set_direction(gpio_num_t gpio_num, gpio_mode_t mode)
+{
+    (void)gpio_num;
+    (void)mode;
+    return ESP_OK;
+}
+
+extern "C" esp_err_t rmt_config(const rmt_config_t *rmt_param)
+{
+    (void)rmt_param;
+    return ESP_OK;
+}
+
+extern "C" esp_err_t rmt_driver_install(rmt_channel_t channel, size_t rx_buf_size, int intr_alloc_flags)
+{
+    (void)channel;
+    (void)rx_buf_size;
+    (void)intr_alloc_flags;
+    return ESP_OK;
+}
+
+extern "C" esp_err_t rmt_write_items(rmt_channel_t channel, const rmt_item32_t *rmt_item, int item_num,
+                                     bool wait_tx_done)
+{
+    (void)channel;
+    (void)rmt_item;
+    (void)item_num;
+    (void)wait_tx_done;
+    return ESP_OK;
+}
+
+extern "C" esp_err_t ledc_fade_func_install(int intr_alloc_flags)
+{
+    (void)intr_alloc_flags;
+    return ESP_OK;
+}
+
+extern "C" esp_err_t ledc_set_fade_with_time(ledc_mode_t speed_mode, ledc_channel_t channel, uint32_t target_duty,
+                                             int max_fade_time_ms)
+{
+    (void)speed_mode;
+    (void)max_fade_time_ms;
+    if (channel >= LEDC_CHANNEL_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    fade_duty[channel] = target_duty;
+    return ESP_OK;
+}
+
+extern "C" esp_err_t ledc_fade_start(ledc_mode_t speed_mode, ledc_channel_t channel, ledc_fade_mode_t fade_mode)
+{
+    (void)speed_mode;
+    (void)fade_mode;
+    if (channel >= LEDC_CHANNEL_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ledcWrite(channel, fade_duty[channel]);
+    return ESP_OK;
+}
@@ -0,0 +1,577 @@
+// FreeRTOS API on pthreads, see sim/include/freertos/FreeRTOS.h
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/timers.h"
+#include "freertos/event_groups.h"
+#include "esp32-hal.h"
+#include "sim_internal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <thread>
+
+struct SimTask
+{
+    TaskFunction_t fn;
+    void *param;
+    char name[16];
+    UBaseType_t priority;
+    BaseType_t core;
+    std::mutex lock;
+    std::condition_variable notify_cv;
+    uint32_t notify;
+};
+
+static thread_local SimTask *current_task = NULL;
+
+// Waits on `cv` until `ready()` or until `ticks` ms of the simulator clock have passed.
+// Waiters poll in real time, so a virtual clock moved by the loop task also ends their
+// wait. A wait on the loop task itself moves the clock while it polls, as nothing
+// else would: the tasks it waits for may be in delay() themselves.
+template <typename Ready>
+static bool wait_for(std::unique_lock<std::mutex> &lock, std::condition_variable &cv, TickType_t ticks,
+                     Ready ready)
+{
+    if (ready())
+    {
+        return true;
+    }
+    bool forever = portMAX_DELAY == ticks;
+    bool advance = sim_options.virtual_time && sim_on_loop_task();
+    if (forever && !advance)
+    {
+        sim_sleep_begin(UINT64_MAX);
+        cv.wait(lock, ready);
+        sim_sleep_end();
+        return true;
+    }
+    uint64_t end = forever ? UINT64_MAX : sim_now_us() + (uint64_t)ticks * 1000;
+    bool met = true;
+    sim_sleep_begin(end);
+    while (!ready())
+    {
+        uint64_t now = sim_now_us();
+        if (now >= end)
+        {
+            met = false;
+            break;
+        }
+        if (advance)
+        {
+            lock.unlock();
+            sim_advance_ms(1);
+            lock.lock();
+            continue;
+        }
+        uint64_t left = end - now;
+        cv.wait_for(lock, std::chrono::microseconds(left < 1000 ? left : 1000));
+    }
+    sim_sleep_end();
+    return met;
+}
+
+static void *task_entry(void *param)
+{
+    SimTask *task = (SimTask *)param;
+    current_task = task;
+    pthread_setname_np(pthread_self(), task->name);
+    task->fn(task->param);
+    // Returning from a task is an error on FreeRTOS; treat it as vTaskDelete(NULL)
+    return NULL;
+}
+
+extern "C" BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth,
+                                              void *param, UBaseType_t priority, TaskHandle_t *created,
+                                              BaseType_t core)
+{
+    SimTask *task = new SimTask();
+    task->fn = fn;
+    task->param = param;
+    snprintf(task->name, sizeof(task->name), "%s", NULL == name ? "task" : name);
+    task->priority = priority;
+    task->core = core;
+    task->notify = 0;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    // Host stack frames are larger than on Xtensa
+    size_t stack = (size_t)stack_depth * 8;
+    pthread_attr_setstacksize(&attr, stack < 256 * 1024 ? 256 * 1024 : stack);
+    pthread_t thread;
+    int ret = pthread_create(&thread, &attr, task_entry, task);
+    pthread_attr_destroy(&attr);
+    if (0 != ret)
+    {
+        delete task;
+        return pdFAIL;
+    }
+    if (NULL != created)
+    {
+        *created = task;
+    }
+    return pdPASS;
+}
+
+extern "C" BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *param,
+                                  UBaseType_t priority, TaskHandle_t *created)
+{
+    return xTaskCreatePinnedToCore(fn, name, stack_depth, param, priority, created, tskNO_AFFINITY);
+}
+
+extern "C" void vTaskDelete(TaskHandle_t task)
+{
+    if (NULL == task || task == current_task)
+    {
+        // The handle may still be held elsewhere, so it is not freed
+        pthread_exit(NULL);
+    }
+    fprintf(stderr, "sim: deleting another task is not supported (%s)\n", task->name);
+}
+
+extern "C" void vTaskDelay(TickType_t ticks)
+{
+    delay(ticks);
+}
+
+extern "C" void vTaskDelayUntil(TickType_t *previous_wake, TickType_t increment)
+{
+    TickType_t target = *previous_wake + increment;
+    int32_t left = (int32_t)(target - xTaskGetTickCount());
+    if (left > 0)
+    {
+        delay(left);
+    }
+    *previous_wake = target;
+}
+
+extern "C" TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)millis();
+}
+
+extern "C" TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return current_task;
+}
+
+extern "C" const char *pcTaskGetTaskName(TaskHandle_t task)
+{
+    task = NULL == task ? current_task : task;
+    return NULL == task ? "loopTask" : task->name;
+}
+
+extern "C" UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+    (void)task;
+    return 0;
+}
+
+extern "C" uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks)
+{
+    SimTask *task = current_task;
+    if (NULL == task)
+    {
+        delay(ticks);
+        return 0;
+    }
+    std::unique_lock<std::mutex> lock(task->lock);
+    wait_for(lock, task->notify_cv, ticks, [task] { return task->notify > 0; });
+    uint32_t value = task->notify;
+    if (value > 0)
+    {
+        task->notify = clear_on_exit ? 0 : value - 1;
+    }
+    return value;
+}
+
+extern "C" BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    {
+        std::lock_guard<std::mutex> guard(task->lock);
+        ++task->notify;
+    }
+    task->notify_cv.notify_all();
+    return pdPASS;
+}
+
+extern "C" void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken)
+{
+    xTaskNotifyGive(task);
+    if (NULL != woken)
+    {
+        *woken = pdTRUE;
+    }
+}
+
+extern "C" void vPortEnterCritical(portMUX_TYPE *mux)
+{
+    pthread_mutex_lock(&mux->mutex);
+}
+
+extern "C" void vPortExitCritical(portMUX_TYPE *mux)
+{
+    pthread_mutex_unlock(&mux->mutex);
+}
+
+extern "C" void vPortCPUInitializeMutex(portMUX_TYPE *mux)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&mux->mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+extern "C" BaseType_t xPortGetCoreID(void)
+{
+    // loop() runs on core 1, tasks on the core they were pinned to
+    return NULL == current_task ? 1 : (tskNO_AFFINITY == current_task->core ? 0 : current_task->core);
+}
+
+extern "C" void *pvPortMalloc(size_t size)
+{
+    return malloc(size);
+}
+
+extern "C" void vPortFree(void *ptr)
+{
+    free(ptr);
+}
+
+// ---------------------------------------------------------------- semaphores
+
+enum SIM_SEM_KIND
+{
+    SIM_SEM_MUTEX,
+    SIM_SEM_RECURSIVE,
+    SIM_SEM_COUNTING
+};
+
+struct SimSemaphore
+{
+    SIM_SEM_KIND kind;
+    std::mutex lock;
+    std::condition_variable cv;
+    UBaseType_t count;
+    UBaseType_t max_count;
+    pthread_t owner;
+    UBaseType_t depth;
+};
+
+static SemaphoreHandle_t create_semaphore(SIM_SEM_KIND kind, UBaseType_t max_count, UBaseType_t count)
+{
+    SimSemaphore *sem = new SimSemaphore();
+    sem->kind = kind;
+    sem->max_count = max_count;
+    sem->count = count;
+    sem->depth = 0;
+    return sem;
+}
+
+extern "C" SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return create_semaphore(SIM_SEM_MUTEX, 1, 1);
+}
+
+extern "C" SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void)
+{
+    return create_semaphore(SIM_SEM_RECURSIVE, 1, 1);
+}
+
+extern "C" SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return create_semaphore(SIM_SEM_COUNTING, 1, 0);
+}
+
+extern "C" SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count)
+{
+    return create_semaphore(SIM_SEM_COUNTING, max_count, initial_count);
+}
+
+extern "C" void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+    delete sem;
+}
+
+extern "C" BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    std::unique_lock<std::mutex> lock(sem->lock);
+    if (!wait_for(lock, sem->cv, ticks, [sem] { return sem->count > 0; }))
+    {
+        return pdFALSE;
+    }
+    --sem->count;
+    sem->owner = pthread_self();
+    return pdTRUE;
+}
+
+extern "C" BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    {
+        std::lock_guard<std::mutex> guard(sem->lock);
+        if (sem->count >= sem->max_count)
+        {
+            return pdFALSE;
+        }
+        ++sem->count;
+    }
+    sem->cv.notify_one();
+    return pdTRUE;
+}
+
+extern "C" BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    {
+        std::lock_guard<std::mutex> guard(sem->lock);
+        if (sem->depth > 0 && pthread_equal(sem->owner, pthread_self()))
+        {
+            ++sem->depth;
+            return pdTRUE;
+        }
+    }
+    if (pdTRUE != xSemaphoreTake(sem, ticks))
+    {
+        return pdFALSE;
+    }
+    std::lock_guard<std::mutex> guard(sem->lock);
+    sem->depth = 1;
+    return pdTRUE;
+}
+
+extern "C" BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t sem)
+{
+    {
+        std::lock_guard<std::mutex> guard(sem->lock);
+        if (0 == sem->depth || !pthread_equal(sem->owner, pthread_self()))
+        {
+            return pdFALSE;
+        }
+        if (--sem->depth > 0)
+        {
+            return pdTRUE;
+        }
+    }
+    return xSemaphoreGive(sem);
+}
+
+extern "C" BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t *woken)
+{
+    if (NULL != woken)
+    {
+        *woken = pdTRUE;
+    }
+    return xSemaphoreGive(sem);
+}
+
+// -------------------------------------------------------------- event groups
+
+struct SimEventGroup
+{
+    std::mutex lock;
+    std::condition_variable cv;
+    EventBits_t bits;
+};
+
+extern "C" EventGroupHandle_t xEventGroupCreate(void)
+{
+    SimEventGroup *group = new SimEventGroup();
+    group->bits = 0;
+    return group;
+}
+
+extern "C" EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits)
+{
+    EventBits_t value;
+    {
+        std::lock_guard<std::mutex> guard(group->lock);
+        group->bits |= bits;
+        value = group->bits;
+    }
+    group->cv.notify_all();
+    return value;
+}
+
+extern "C" EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits)
+{
+    std::lock_guard<std::mutex> guard(group->lock);
+    EventBits_t value = group->bits;
+    group->bits &= ~bits;
+    return value;
+}
+
+extern "C" EventBits_t xEventGroupGetBits(EventGroupHandle_t group)
+{
+    std::lock_guard<std::mutex> guard(group->lock);
+    return group->bits;
+}
+
+extern "C" EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear_on_exit,
+                                           BaseType_t wait_for_all, TickType_t ticks)
+{
+    std::unique_lock<std::mutex> lock(group->lock);
+    auto ready = [group, bits, wait_for_all] {
+        return wait_for_all ? bits == (group->bits & bits) : 0 != (group->bits & bits);
+    };
+    bool met = wait_for(lock, group->cv, ticks, ready);
+    EventBits_t value = group->bits;
+    if (met && clear_on_exit)
+    {
+        group->bits &= ~bits;
+    }
+    return value;
+}
+
+// -------------------------------------------------------------------- timers
+
+struct SimTimer
+{
+    char name[16];
+    TickType_t period;
+    bool auto_reload;
+    void *id;
+    TimerCallbackFunction_t callback;
+    bool active;
+    bool deleted;
+    uint32_t expiry;
+};
+
+static std::mutex timer_lock;
+static std::condition_variable timer_cv;
+static std::list<SimTimer *> timers;
+static bool timer_thread_started = false;
+
+static void timer_service()
+{
+    pthread_setname_np(pthread_self(), "Tmr Svc");
+    std::unique_lock<std::mutex> lock(timer_lock);
+    while (true)
+    {
+        uint32_t now = (uint32_t)millis();
+        SimTimer *next = NULL;
+        for (auto it = timers.begin(); it != timers.end();)
+        {
+            SimTimer *timer = *it;
+            if (timer->deleted)
+            {
+                it = timers.erase(it);
+                delete timer;
+                continue;
+            }
+            if (timer->active && (NULL == next || (int32_t)(timer->expiry - next->expiry) < 0))
+            {
+                next = timer;
+            }
+            ++it;
+        }
+        SimTimer *due = NULL != next && (int32_t)(next->expiry - now) <= 0 ? next : NULL;
+        if (NULL == due)
+        {
+            // The virtual clock is moved by the loop task, so poll in real time
+            sim_sleep_begin(NULL == next ? UINT64_MAX
+                                         : sim_now_us() + (uint64_t)(int32_t)(next->expiry - now) * 1000);
+            timer_cv.wait_for(lock, std::chrono::milliseconds(1));
+            continue;
+        }
+        sim_sleep_end();
+        if (due->auto_reload)
+        {
+            due->expiry += due->period;
+            if ((int32_t)(due->expiry - now) < 0)
+            {
+                due->expiry = now + due->period;
+            }
+        }
+        else
+        {
+            due->active = false;
+        }
+        lock.unlock();
+        due->callback(due);
+        lock.lock();
+    }
+}
+
+extern "C" TimerHandle_t xTimerCreate(const char *name, TickType_t period, UBaseType_t auto_reload, void *id,
+                                      TimerCallbackFunction_t callback)
+{
+    SimTimer *timer = new SimTimer();
+    snprintf(timer->name, sizeof(timer->name), "%s", NULL == name ? "timer" : name);
+    timer->period = 0 == period ? 1 : period;
+    timer->auto_reload = auto_reload;
+    timer->id = id;
+    timer->callback = callback;
+    timer->active = false;
+    timer->deleted = false;
+    timer->expiry = 0;
+
+    std::lock_guard<std::mutex> guard(timer_lock);
+    timers.push_back(timer);
+    if (!timer_thread_started)
+    {
+        timer_thread_started = true;
+        std::thread(timer_service).detach();
+    }
+    return timer;
+}
+
+extern "C" BaseType_t xTimerStart(TimerHandle_t timer, TickType_t ticks)
+{
+    (void)ticks;
+    std::lock_guard<std::mutex> guard(timer_lock);
+    timer->active = true;
+    timer->expiry = (uint32_t)millis() + timer->period;
+    timer_cv.notify_all();
+    return pdPASS;
+}
+
+extern "C" BaseType_t xTimerReset(TimerHandle_t timer, TickType_t ticks)
+{
+    return xTimerStart(timer, ticks);
+}
+
+extern "C" BaseType_t xTimerStop(TimerHandle_t timer, TickType_t ticks)
+{
+    (void)ticks;
+    std::lock_guard<std::mutex> guard(timer_lock);
+    timer->active = false;
+    return pdPASS;
+}
+
+extern "C" BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t period, TickType_t ticks)
+{
+    (void)ticks;
+    std::lock_guard<std::mutex> guard(timer_lock);
+    timer->period = 0 == period ? 1 : period;
+    timer->active = true;
+    timer->expiry = (uint32_t)millis() + timer->period;
+    return pdPASS;
+}
+
+extern "C" BaseType_t xTimerDelete(TimerHandle_t timer, TickType_t ticks)
+{
+    (void)ticks;
+    std::lock_guard<std::mutex> guard(timer_lock);
+    timer->active = false;
+    timer->deleted = true;
+    return pdPASS;
+}
+
+extern "C" BaseType_t xTimerIsTimerActive(TimerHandle_t timer)
+{
+    std::lock_guard<std::mutex> guard(timer_lock);
+    return timer->active ? pdTRUE : pdFALSE;
+}
+
+extern "C" void *pvTimerGetTimerID(TimerHandle_t timer)
+{
+    return timer->id;
+}
@@ -0,0 +1,555 @@
+// SD card, SPIFFS and FatFs on host directories
+
+#include "FS.h"
+#include "SD.h"
+#include "SD_MMC.h"
+#include "SPIFFS.h"
+#include "ff.h"
+#include "sim_internal.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+fs::SDFS SD;
+fs::SDMMCFS SD_MMC;
+fs::SPIFFSFS SPIFFS;
+SPIClass SPI;
+
+namespace fs
+{
+
+class FileImpl
+{
+public:
+    std::string name;      // path inside the file system
+    std::string host_path;
+    FILE *fp = NULL;
+    bool is_dir = false;
+    bool on_card = false; // counts against sim_sd_limit_writes()
+    std::vector<std::string> entries; // sorted directory listing, read on first use
+    bool listed = false;
+    size_t next = 0;
+
+    ~FileImpl()
+    {
+        if (NULL != fp)
+        {
+            fclose(fp);
+        }
+    }
+};
+
+} // namespace fs
+
+static std::string join(const std::string &dir, const char *name)
+{
+    if (dir.empty() || '/' == dir.back())
+    {
+        return dir + name;
+    }
+    return dir + "/" + name;
+}
+
+// Normalizes a firmware path: leading '/', no trailing '/' except for the root
+static std::string normalize(const char *path)
+{
+    std::string ret = NULL == path ? "/" : path;
+    if (ret.empty() || '/' != ret[0])
+    {
+        ret = "/" + ret;
+    }
+    while (ret.size() > 1 && '/' == ret.back())
+    {
+        ret.pop_back();
+    }
+    return ret;
+}
+
+static void make_parents(const std::string &host_path)
+{
+    for (size_t pos = host_path.find('/', 1); std::string::npos != pos; pos = host_path.find('/', pos + 1))
+    {
+        ::mkdir(host_path.substr(0, pos).c_str(), 0755);
+    }
+}
+
+std::string sim_sd_path(const char *path)
+{
+    return SD.hostPath(path);
+}
+
+std::string sim_flash_path(const char *name)
+{
+    return join(sim_options.flash_dir, name);
+}
+
+static std::atomic<long> sd_write_room(-1);
+
+void sim_sd_limit_writes(long bytes)
+{
+    sd_write_room = bytes;
+}
+
+// How much of a `size` byte write fits under sim_sd_limit_writes()
+static size_t sd_write_allowance(size_t size)
+{
+    long room = sd_write_room.load();
+    while (room >= 0)
+    {
+        size_t allowed = (size_t)room < size ? (size_t)room : size;
+        if (sd_write_room.compare_exchange_weak(room, room - (long)allowed))
+        {
+            return allowed;
+        }
+    }
+    return size;
+}
+
+// ---------------------------------------------------------------------- File
+
+size_t fs::File::write(uint8_t c)
+{
+    return write(&c, 1);
+}
+
+size_t fs::File::write(const uint8_t *buf, size_t size)
+{
+    if (!m_impl || NULL == m_impl->fp)
+    {
+        return 0;
+    }
+    return fwrite(buf, 1, m_impl->on_card ? sd_write_allowance(size) : size, m_impl->fp);
+}
+
+int fs::File::available()
+{
+    if (!m_impl || NULL == m_impl->fp)
+    {
+        return 0;
+    }
+    size_t pos = position();
+    size_t len = size();
+    return len > pos ? (int)(len - pos) : 0;
+}
+
+int fs::File::read()
+{
+    uint8_t c;
+    return 1 == read(&c, 1) ? c : -1;
+}
+
+int fs::File::peek()
+{
+    if (!m_impl || NULL == m_impl->fp)
+    {
+        return -1;
+    }
+    int c = fgetc(m_impl->fp);
+    if (EOF != c)
+    {
+        ungetc(c, m_impl->fp);
+    }
+    return EOF == c ? -1 : c;
+}
+
+void fs::File::flush()
+{
+    if (m_impl && NULL != m_impl->fp)
+    {
+        fflush(m_impl->fp);
+    }
+}
+
+size_t fs::File::read(uint8_t *buf, size_t size)
+{
+    if (!m_impl || NULL == m_impl->fp)
+    {
+        return 0;
+    }
+    return fread(buf, 1, size, m_impl->fp);
+}
+
+bool fs::File::seek(uint32_t pos, SeekMode mode)
+{
+    if (!m_impl || NULL == m_impl->fp)
+    {
+        return false;
+    }
+    int whence = SeekSet == mode ? SEEK_SET : (SeekCur == mode ? SEEK_CUR : SEEK_END);
+    return 0 == fseek(m_impl->fp, pos, whence);
+}
+
+size_t fs::File::position() const
+{
+    if (!m_impl || NULL == m_impl->fp)
+    {
+        return 0;
+    }
+    long pos = ftell(m_impl->fp);
+    return pos < 0 ? 0 : (size_t)pos;
+}
+
+size_t fs::File::size() const
+{
+    if (!m_impl || NULL == m_impl->fp)
+    {
+        return 0;
+    }
+    fflush(m_impl->fp);
+    struct stat st;
+    return 0 == fstat(fileno(m_impl->fp), &st) ? (size_t)st.st_size : 0;
+}
+
+void fs::File::close()
+{
+    m_impl.reset();
+}
+
+fs::File::operator bool() const
+{
+    return (bool)m_impl;
+}
+
+time_t fs::File::getLastWrite()
+{
+    struct stat st;
+    if (!m_impl || 0 != stat(m_impl->host_path.c_str(), &st))
+    {
+        return 0;
+    }
+    return st.st_mtime;
+}
+
+const char *fs::File::name() const
+{
+    return m_impl ? m_impl->name.c_str() : NULL;
+}
+
+boolean fs::File::isDirectory(void)
+{
+    return m_impl && m_impl->is_dir;
+}
+
+fs::File fs::File::openNextFile(const char *mode)
+{
+    (void)mode;
+    if (!m_impl || !m_impl->is_dir)
+    {
+        return File();
+    }
+    if (!m_impl->listed)
+    {
+        m_impl->listed = true;
+        DIR *dir = opendir(m_impl->host_path.c_str());
+        if (NULL != dir)
+        {
+            for (struct dirent *ent; NULL != (ent = readdir(dir));)
+            {
+                if (0 != strcmp(ent->d_name, ".") && 0 != strcmp(ent->d_name, ".."))
+                {
+                    m_impl->entries.push_back(ent->d_name);
+                }
+            }
+            closedir(dir);
+        }
+        std::sort(m_impl->entries.begin(), m_impl->entries.end());
+    }
+    while (m_impl->next < m_impl->entries.size())
+    {
+        const std::string &entry = m_impl->entries[m_impl->next++];
+        auto impl = std::make_shared<FileImpl>();
+        impl->name = join(m_impl->name, entry.c_str());
+        impl->host_path = join(m_impl->host_path, entry.c_str());
+        struct stat st;
+        if (0 != stat(impl->host_path.c_str(), &st))
+        {
+            continue; // removed since the listing
+        }
+        impl->is_dir = S_ISDIR(st.st_mode);
+        if (!impl->is_dir && NULL == (impl->fp = fopen(impl->host_path.c_str(), "rb")))
+        {
+            continue;
+        }
+        return File(impl);
+    }
+    return File();
+}
+
+void fs::File::rewindDirectory(void)
+{
+    if (m_impl)
+    {
+        m_impl->listed = false;
+        m_impl->entries.clear();
+        m_impl->next = 0;
+    }
+}
+
+// ------------------------------------------------------------------------ FS
+
+std::string fs::FS::hostPath(const char *path) const
+{
+    std::string name = normalize(path);
+    return "/" == name ? m_root : m_root + name;
+}
+
+fs::File fs::FS::open(const char *path, const char *mode)
+{
+    if (m_root.empty())
+    {
+        return File();
+    }
+    auto impl = std::make_shared<FileImpl>();
+    impl->name = normalize(path);
+    impl->host_path = hostPath(path);
+    impl->on_card = !m_flat;
+
+    struct stat st;
+    bool exists = 0 == stat(impl->host_path.c_str(), &st);
+    if ('r' == mode[0] && exists && S_ISDIR(st.st_mode))
+    {
+        impl->is_dir = true;
+        return File(impl);
+    }
+    if ('r' == mode[0] && !exists)
+    {
+        return File();
+    }
+    if (m_flat && 'r' != mode[0])
+    {
+        make_parents(impl->host_path);
+    }
+    const char *host_mode = 'w' == mode[0] ? "wb" : ('a' == mode[0] ? "ab" : "rb");
+    if ('+' == mode[1])
+    {
+        host_mode = 'w' == mode[0] ? "wb+" : ('a' == mode[0] ? "ab+" : "rb+");
+    }
+    impl->fp = fopen(impl->host_path.c_str(), host_mode);
+    if (NULL == impl->fp)
+    {
+        return File();
+    }
+    return File(impl);
+}
+
+bool fs::FS::exists(const char *path)
+{
+    struct stat st;
+    return !m_root.empty() && 0 == stat(hostPath(path).c_str(), &st);
+}
+
+bool fs::FS::remove(const char *path)
+{
+    return !m_root.empty() && 0 == unlink(hostPath(path).c_str());
+}
+
+bool fs::FS::rename(const char *from, const char *to)
+{
+    return !m_root.empty() && 0 == ::rename(hostPath(from).c_str(), hostPath(to).c_str());
+}
+
+bool fs::FS::mkdir(const char *path)
+{
+    return !m_root.empty() && (0 == ::mkdir(hostPath(path).c_str(), 0755) || EEXIST == errno);
+}
+
+bool fs::FS::rmdir(const char *path)
+{
+    return !m_root.empty() && 0 == ::rmdir(hostPath(path).c_str());
+}
+
+uint64_t fs::FS::totalBytes()
+{
+    struct statvfs st;
+    if (m_root.empty() || 0 != statvfs(m_root.c_str(), &st))
+    {
+        return 0;
+    }
+    return (uint64_t)st.f_blocks * st.f_frsize;
+}
+
+uint64_t fs::FS::usedBytes()
+{
+    struct statvfs st;
+    if (m_root.empty() || 0 != statvfs(m_root.c_str(), &st))
+    {
+        return 0;
+    }
+    return (uint64_t)(st.f_blocks - st.f_bfree) * st.f_frsize;
+}
+
+bool fs::SDFS::begin(uint8_t ssPin, SPIClass &spi, uint32_t frequency, const char *mountpoint,
+                     uint8_t max_files)
+{
+    (void)ssPin;
+    (void)spi;
+    (void)frequency;
+    (void)mountpoint;
+    (void)max_files;
+    struct stat st;
+    m_mounted = 0 == stat(sim_options.sd_dir, &st) && S_ISDIR(st.st_mode);
+    setRoot(m_mounted ? sim_options.sd_dir : "");
+    return m_mounted;
+}
+
+bool fs::SPIFFSFS::begin(bool formatOnFail, const char *basePath, uint8_t maxOpenFiles,
+                         const char *partitionLabel)
+{
+    (void)basePath;
+    (void)maxOpenFiles;
+    (void)partitionLabel;
+    std::string root = sim_flash_path("spiffs");
+    struct stat st;
+    if (0 != stat(root.c_str(), &st))
+    {
+        if (!formatOnFail || 0 != ::mkdir(root.c_str(), 0755))
+        {
+            return false;
+        }
+    }
+    setRoot(root);
+    return true;
+}
+
+bool fs::SPIFFSFS::format()
+{
+    std::string cmd = "rm -rf '" + sim_flash_path("spiffs") + "'/*";
+    return 0 == system(cmd.c_str());
+}
+
+// -------------------------------------------------------------------- FatFs
+
+extern "C" FRESULT f_open(FIL *fp, const TCHAR *path, BYTE mode)
+{
+    if (SD.root().empty())
+    {
+        return FR_NOT_READY;
+    }
+    std::string host_path = SD.hostPath(path);
+    struct stat st;
+    bool exists = 0 == stat(host_path.c_str(), &st);
+    if (exists && S_ISDIR(st.st_mode))
+    {
+        return FR_NO_FILE;
+    }
+    const char *host_mode = "rb";
+    if (mode & FA_WRITE)
+    {
+        if (!exists && !(mode & (FA_OPEN_ALWAYS | FA_CREATE_ALWAYS | FA_CREATE_NEW)))
+        {
+            return FR_NO_FILE;
+        }
+        if (exists && (mode & FA_CREATE_NEW) && !(mode & FA_OPEN_ALWAYS))
+        {
+            return FR_EXIST;
+        }
+        host_mode = (exists && !(mode & FA_CREATE_ALWAYS)) ? "rb+" : "wb+";
+    }
+    else if (!exists)
+    {
+        return FR_NO_FILE;
+    }
+    fp->fp = fopen(host_path.c_str(), host_mode);
+    if (NULL == fp->fp)
+    {
+        return FR_DENIED;
+    }
+    fp->fptr = 0;
+    fp->obj_size = exists && !(mode & FA_CREATE_ALWAYS) ? (FSIZE_t)st.st_size : 0;
+    if (FA_OPEN_APPEND == (mode & FA_OPEN_APPEND))
+    {
+        fseek(fp->fp, 0, SEEK_END);
+        fp->fptr = fp->obj_size;
+    }
+    return FR_OK;
+}
+
+extern "C" FRESULT f_close(FIL *fp)
+{
+    if (NULL == fp->fp)
+    {
+        return FR_INVALID_OBJECT;
+    }
+    fclose(fp->fp);
+    fp->fp = NULL;
+    return FR_OK;
+}
+
+extern "C" FRESULT f_read(FIL *fp, void *buff, UINT btr, UINT *br)
+{
+    size_t n = fread(buff, 1, btr, fp->fp);
+    fp->fptr += n;
+    *br = n;
+    return ferror(fp->fp) ? FR_DISK_ERR : FR_OK;
+}
+
+extern "C" FRESULT f_write(FIL *fp, const void *buff, UINT btw, UINT *bw)
+{
+    size_t n = fwrite(buff, 1, sd_write_allowance(btw), fp->fp);
+    fp->fptr += n;
+    fp->obj_size = fp->fptr > fp->obj_size ? fp->fptr : fp->obj_size;
+    *bw = n;
+    return n == btw ? FR_OK : FR_DISK_ERR;
+}
+
+extern "C" FRESULT f_lseek(FIL *fp, FSIZE_t ofs)
+{
+    if (0 != fseek(fp->fp, ofs, SEEK_SET))
+    {
+        return FR_DISK_ERR;
+    }
+    fp->fptr = ofs;
+    return FR_OK;
+}
+
+extern "C" FRESULT f_truncate(FIL *fp)
+{
+    fflush(fp->fp);
+    if (0 != ftruncate(fileno(fp->fp), fp->fptr))
+    {
+        return FR_DISK_ERR;
+    }
+    fp->obj_size = fp->fptr;
+    return FR_OK;
+}
+
+extern "C" FRESULT f_opendir(FF_DIR *dp, const TCHAR *path)
+{
+    if (SD.root().empty())
+    {
+        return FR_NOT_READY;
+    }
+    dp->handle = opendir(SD.hostPath(path).c_str());
+    return NULL == dp->handle ? FR_NO_PATH : FR_OK;
+}
+
+extern "C" FRESULT f_closedir(FF_DIR *dp)
+{
+    if (NULL != dp->handle)
+    {
+        closedir((DIR *)dp->handle);
+        dp->handle = NULL;
+    }
+    return FR_OK;
+}
+
+// An empty name marks the end of the directory, as in FatFs
+extern "C" FRESULT f_readdir(FF_DIR *dp, FILINFO *fno)
+{
+    memset(fno, 0, sizeof(FILINFO));
+    struct dirent *ent = readdir((DIR *)dp->handle);
+    if (NULL == ent)
+    {
+        return FR_OK;
+    }
+    snprintf(fno->fname, sizeof(fno->fname), "%s", ent->d_name);
+    fno->fattrib = DT_DIR == ent->d_type ? AM_DIR : AM_ARC;
+    return FR_OK;
+}
@@ -0,0 +1,399 @@
+// MPU6050 and BH1750 on the host: FIFO replay of an IMU trace, a drifting gyro bias, fixed light
+
+#include "MPU6050_6Axis_MotionApps20.h"
+#include "Wire.h"
+#include "sim_internal.h"
+
+#include <math.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#define SIM_FIFO_SIZE 1024
+#define SIM_RAW_BYTES 12
+#define SIM_DMP_PERIOD_MS 10 // DMP FIFO rate 100Hz
+#define SIM_QUAT_ONE 16384.0f
+#define SIM_TEMPERATURE_C 30.0f     // raw / 340 + 36.53
+#define SIM_GYRO_OFFSET_LSB 4       // offset registers count in +-1000dps steps, data in +-250dps
+#define SIM_DMP_GYRO_DIV 8          // the DMP runs the gyro at +-2000dps
+#define SIM_LIGHT_RAW 300           // 250 lx at the default resolution
+
+struct TraceSample
+{
+    uint32_t ms;
+    int16_t v[6]; // ax ay az gx gy gz
+};
+
+struct TraceQuat
+{
+    uint32_t ms;
+    int16_t q[4];
+    int16_t gyro[3];
+};
+
+static std::vector<TraceSample> trace_raw;
+static std::vector<TraceQuat> trace_quat;
+static std::mutex fifo_lock;
+static bool fifo_started = false;
+static uint32_t fifo_origin; // millis() at the first FIFO reset
+static size_t raw_next;      // next trace sample not yet in the FIFO
+static size_t quat_next;
+static uint32_t still_next_ms; // next generated sample once the trace is over
+static TraceSample last_sample = {0, {0, 0, 16384, 0, 0, 0}};
+static float gyro_bias[3] = {0, 0, 0};
+static float temperature_c = SIM_TEMPERATURE_C;
+static std::atomic<uint32_t> i2c_transfers(0);
+static std::atomic<uint32_t> i2c_loop_transfers(0);
+
+void sim_i2c_transfer()
+{
+    ++i2c_transfers;
+    if (sim_on_loop_task())
+    {
+        ++i2c_loop_transfers;
+    }
+}
+
+void sim_i2c_stats(SimI2cStats *stats)
+{
+    stats->transfers = i2c_transfers.load();
+    stats->loop_transfers = i2c_loop_transfers.load();
+}
+
+void sim_imu_sensor(const float bias[3], float celsius)
+{
+    std::lock_guard<std::mutex> guard(fifo_lock);
+    memcpy(gyro_bias, bias, sizeof(gyro_bias));
+    temperature_c = celsius;
+}
+
+void sim_imu_motion(const int16_t accel[3], const int16_t gyro[3])
+{
+    std::lock_guard<std::mutex> guard(fifo_lock);
+    memcpy(last_sample.v, accel, 3 * sizeof(int16_t));
+    memcpy(last_sample.v + 3, gyro, 3 * sizeof(int16_t));
+}
+
+TwoWire Wire;
+
+bool TwoWire::begin(int sda, int scl, uint32_t frequency)
+{
+    (void)sda;
+    (void)scl;
+    (void)frequency;
+    return true;
+}
+
+uint8_t TwoWire::requestFrom(uint16_t address, uint8_t size, bool sendStop)
+{
+    (void)address;
+    (void)sendStop;
+    sim_i2c_transfer();
+    if (size > sizeof(m_rx))
+    {
+        size = sizeof(m_rx);
+    }
+    memset(m_rx, 0, size);
+    if (size >= 2)
+    {
+        m_rx[0] = SIM_LIGHT_RAW >> 8;
+        m_rx[1] = SIM_LIGHT_RAW & 0xFF;
+    }
+    m_rxLen = size;
+    m_rxPos = 0;
+    return size;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop)
+{
+    (void)sendStop;
+    sim_i2c_transfer();
+    return 0;
+}
+
+bool sim_imu_load()
+{
+    trace_raw.clear();
+    trace_quat.clear();
+    if (NULL == sim_options.imu_trace)
+    {
+        return true;
+    }
+    FILE *fp = fopen(sim_options.imu_trace, "r");
+    if (NULL == fp)
+    {
+        fprintf(stderr, "sim: cannot open IMU trace %s\n", sim_options.imu_trace);
+        return false;
+    }
+    char line[256];
+    int16_t gyro[3] = {0, 0, 0};
+    while (fgets(line, sizeof(line), fp))
+    {
+        unsigned ms;
+        int v[6];
+        float q[4];
+        if (7 == sscanf(line, "imu,%u,%d,%d,%d,%d,%d,%d", &ms, &v[0], &v[1], &v[2], &v[3], &v[4], &v[5]))
+        {
+            TraceSample sample = {ms, {(int16_t)v[0], (int16_t)v[1], (int16_t)v[2], (int16_t)v[3],
+                                       (int16_t)v[4], (int16_t)v[5]}};
+            trace_raw.push_back(sample);
+            gyro[0] = sample.v[3];
+            gyro[1] = sample.v[4];
+            gyro[2] = sample.v[5];
+        }
+        else if (5 == sscanf(line, "quat,%u,%f,%f,%f,%f", &ms, &q[0], &q[1], &q[2], &q[3]))
+        {
+            // The DMP packet carries the gyro too; take the latest raw sample's
+            TraceQuat quat = {ms,
+                              {(int16_t)(q[0] * SIM_QUAT_ONE), (int16_t)(q[1] * SIM_QUAT_ONE),
+                               (int16_t)(q[2] * SIM_QUAT_ONE), (int16_t)(q[3] * SIM_QUAT_ONE)},
+                              {gyro[0], gyro[1], gyro[2]}};
+            trace_quat.push_back(quat);
+        }
+    }
+    fclose(fp);
+    if (!sim_options.quiet)
+    {
+        printf("sim: IMU trace %u samples, %u orientations\n", (unsigned)trace_raw.size(),
+               (unsigned)trace_quat.size());
+    }
+    return true;
+}
+
+bool sim_imu_done()
+{
+    std::lock_guard<std::mutex> guard(fifo_lock);
+    return raw_next >= trace_raw.size() && quat_next >= trace_quat.size();
+}
+
+static inline void put16(uint8_t *dst, int16_t value)
+{
+    dst[0] = (uint8_t)((uint16_t)value >> 8);
+    dst[1] = (uint8_t)value;
+}
+
+static inline int16_t get16(const uint8_t *src)
+{
+    return (int16_t)((src[0] << 8) | src[1]);
+}
+
+MPU6050::MPU6050(uint8_t address) : m_address(address)
+{
+    memset(m_offsets, 0, sizeof(m_offsets));
+}
+
+// What the gyro reports for `rate`: the bias, less what the offsets take away
+int16_t MPU6050::gyroOut(int axis, int16_t rate)
+{
+    long value = rate + lroundf(gyro_bias[axis]) + SIM_GYRO_OFFSET_LSB * (long)m_offsets[axis];
+    return (int16_t)(value < -32768 ? -32768 : value > 32767 ? 32767 : value);
+}
+
+bool MPU6050::testConnection()
+{
+    sim_i2c_transfer();
+    return !sim_options.imu_absent;
+}
+
+void MPU6050::initialize()
+{
+    sim_i2c_transfer();
+    m_dlpf = 0;
+    m_rate = 0;
+    m_fifoEnabled = false;
+    m_dmpEnabled = false;
+}
+
+void MPU6050::getMotion6(int16_t *ax, int16_t *ay, int16_t *az, int16_t *gx, int16_t *gy, int16_t *gz)
+{
+    sim_i2c_transfer();
+    std::lock_guard<std::mutex> guard(fifo_lock);
+    *ax = last_sample.v[0];
+    *ay = last_sample.v[1];
+    *az = last_sample.v[2];
+    *gx = gyroOut(0, last_sample.v[3]);
+    *gy = gyroOut(1, last_sample.v[4]);
+    *gz = gyroOut(2, last_sample.v[5]);
+}
+
+int16_t MPU6050::getTemperature()
+{
+    sim_i2c_transfer();
+    std::lock_guard<std::mutex> guard(fifo_lock);
+    return (int16_t)lroundf((temperature_c - 36.53f) * 340);
+}
+
+// The library's PID loop ends with offsets that cancel the bias
+void MPU6050::CalibrateGyro(uint8_t loops)
+{
+    (void)loops;
+    std::lock_guard<std::mutex> guard(fifo_lock);
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        m_offsets[axis] = (int16_t)-lroundf(gyro_bias[axis] / SIM_GYRO_OFFSET_LSB);
+    }
+}
+
+void MPU6050::PrintActiveOffsets()
+{
+    Serial.printf("Active offsets: %d %d %d %d %d %d\n", m_offsets[3], m_offsets[4], m_offsets[5], m_offsets[0],
+                  m_offsets[1], m_offsets[2]);
+}
+
+void MPU6050::resetFIFO()
+{
+    sim_i2c_transfer();
+    std::lock_guard<std::mutex> guard(fifo_lock);
+    uint32_t now = millis();
+    if (!fifo_started)
+    {
+        fifo_started = true;
+        fifo_origin = now;
+        still_next_ms = 0;
+        return;
+    }
+    // Whatever was queued is lost, in both streams
+    uint32_t elapsed = now - fifo_origin;
+    while (raw_next < trace_raw.size() && trace_raw[raw_next].ms <= elapsed)
+    {
+        last_sample = trace_raw[raw_next++];
+    }
+    while (quat_next < trace_quat.size() && trace_quat[quat_next].ms <= elapsed)
+    {
+        ++quat_next;
+    }
+    if (still_next_ms <= elapsed)
+    {
+        still_next_ms = elapsed + 1;
+    }
+}
+
+// Samples of the current stream that are due; generated still samples
+// continue once the trace has run out
+static uint32_t fifo_pending(bool dmp, uint32_t period)
+{
+    uint32_t elapsed = millis() - fifo_origin;
+    uint32_t count = 0;
+    if (dmp)
+    {
+        for (size_t pos = quat_next; pos < trace_quat.size() && trace_quat[pos].ms <= elapsed; ++pos)
+        {
+            ++count;
+        }
+        if (quat_next < trace_quat.size())
+        {
+            return count;
+        }
+    }
+    else
+    {
+        for (size_t pos = raw_next; pos < trace_raw.size() && trace_raw[pos].ms <= elapsed; ++pos)
+        {
+            ++count;
+        }
+        if (raw_next < trace_raw.size())
+        {
+            return count;
+        }
+    }
+    if (still_next_ms <= elapsed)
+    {
+        count += (elapsed - still_next_ms) / period + 1;
+    }
+    return count;
+}
+
+uint16_t MPU6050::getFIFOCount()
+{
+    sim_i2c_transfer();
+    std::lock_guard<std::mutex> guard(fifo_lock);
+    if (!m_fifoEnabled || !fifo_started)
+    {
+        return 0;
+    }
+    uint32_t size = m_dmpEnabled ? MPU6050_DMP_PACKET_SIZE : SIM_RAW_BYTES;
+    uint32_t period = m_dmpEnabled ? SIM_DMP_PERIOD_MS : 1 + m_rate;
+    uint32_t bytes = fifo_pending(m_dmpEnabled, period) * size;
+    return bytes > SIM_FIFO_SIZE ? SIM_FIFO_SIZE : (uint16_t)bytes;
+}
+
+void MPU6050::getFIFOBytes(uint8_t *data, uint8_t length)
+{
+    sim_i2c_transfer();
+    std::lock_guard<std::mutex> guard(fifo_lock);
+    memset(data, 0, length);
+    uint32_t size = m_dmpEnabled ? MPU6050_DMP_PACKET_SIZE : SIM_RAW_BYTES;
+    uint32_t period = m_dmpEnabled ? SIM_DMP_PERIOD_MS : 1 + m_rate;
+    for (uint32_t offset = 0; offset + size <= length; offset += size)
+    {
+        uint8_t *packet = data + offset;
+        if (m_dmpEnabled)
+        {
+            TraceQuat quat = {still_next_ms, {(int16_t)SIM_QUAT_ONE, 0, 0, 0}, {0, 0, 0}};
+            if (quat_next < trace_quat.size())
+            {
+                quat = trace_quat[quat_next++];
+                still_next_ms = quat.ms + period;
+            }
+            else
+            {
+                still_next_ms += period;
+            }
+            for (int axis = 0; axis < 4; ++axis)
+            {
+                put16(packet + axis * 4, quat.q[axis]);
+            }
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                put16(packet + 16 + axis * 4, quat.gyro[axis] / SIM_DMP_GYRO_DIV);
+            }
+        }
+        else
+        {
+            if (raw_next < trace_raw.size())
+            {
+                last_sample = trace_raw[raw_next++];
+                still_next_ms = last_sample.ms + period;
+            }
+            else
+            {
+                TraceSample still = {still_next_ms, {0, 0, 16384, 0, 0, 0}};
+                last_sample = still;
+                still_next_ms += period;
+            }
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                put16(packet + axis * 2, last_sample.v[axis]);
+                put16(packet + 6 + axis * 2, gyroOut(axis, last_sample.v[3 + axis]));
+            }
+        }
+    }
+}
+
+uint8_t MPU6050::dmpInitialize()
+{
+    return 0;
+}
+
+void MPU6050::setDMPEnabled(bool enabled)
+{
+    m_dmpEnabled = enabled;
+}
+
+uint8_t MPU6050::dmpGetQuaternion(int16_t *data, const uint8_t *packet)
+{
+    for (int axis = 0; axis < 4; ++axis)
+    {
+        data[axis] = get16(packet + axis * 4);
+    }
+    return 0;
+}
+
+uint8_t MPU6050::dmpGetGyro(int16_t *data, const uint8_t *packet)
+{
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        data[axis] = get16(packet + 16 + axis * 4);
+    }
+    return 0;
+}
@@ -0,0 +1,446 @@
+// WiFi on the loopback interface, mDNS stand-in, TCP client and the bind()
+// wrapper that moves privileged ports
+
+#include "WiFi.h"
+#include "ESPmDNS.h"
+#include "sim_internal.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <mutex>
+#include <thread>
+
+#define SIM_MAC {0xA4, 0x6F, 0x9F, 0x12, 0x34, 0x56}
+#define SIM_TCP_SND_BUF 5744 // CONFIG_TCP_SND_BUF_DEFAULT of the Arduino core
+
+WiFiClass WiFi;
+MDNSResponder MDNS;
+
+static std::mutex wifi_lock;
+static SimWifiStats wifi_stats;
+
+// Linked with -Wl,--wrap=bind: the servers keep their device ports, which
+// below 1024 would need root on the host. Listening TCP sockets get lwIP's
+// send buffer (accepted connections inherit it), so a client that stops
+// reading fills it after a few KB as on the device, not after megabytes.
+// On the device lwIP only runs once WiFi.mode() started it; earlier binds
+// are counted (SimWifiStats::early_binds).
+extern "C" int __real_bind(int fd, const struct sockaddr *addr, socklen_t len);
+
+extern "C" int __wrap_bind(int fd, const struct sockaddr *addr, socklen_t len)
+{
+    if (WIFI_MODE_NULL == WiFi.getMode())
+    {
+        std::lock_guard<std::mutex> lock(wifi_lock);
+        ++wifi_stats.early_binds;
+        if (!sim_options.quiet)
+        {
+            fprintf(stderr, "sim: bind() before WiFi.mode(): the network stack is not up on the device\n");
+        }
+    }
+    int type = 0;
+    socklen_t type_len = sizeof(type);
+    if (0 == getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &type_len) && SOCK_STREAM == type)
+    {
+        int sndbuf = SIM_TCP_SND_BUF;
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+    }
+    if (NULL != addr && AF_INET == addr->sa_family && len >= (socklen_t)sizeof(sockaddr_in))
+    {
+        sockaddr_in moved = *(const sockaddr_in *)addr;
+        uint16_t port = ntohs(moved.sin_port);
+        if (port > 0 && port < 1024)
+        {
+            moved.sin_port = htons(port + sim_options.port_offset);
+            int ret = __real_bind(fd, (const sockaddr *)&moved, sizeof(moved));
+            if (0 == ret && !sim_options.quiet)
+            {
+                printf("sim: port %u bound as %u\n", port, port + sim_options.port_offset);
+            }
+            return ret;
+        }
+    }
+    return __real_bind(fd, addr, len);
+}
+
+// ---------------------------------------------------------------------- WiFi
+
+void WiFiClass::event(system_event_id_t event)
+{
+    for (size_t pos = 0; pos < sizeof(m_callbacks) / sizeof(m_callbacks[0]); ++pos)
+    {
+        if (NULL != m_callbacks[pos])
+        {
+            m_callbacks[pos](event);
+        }
+    }
+}
+
+void sim_wifi_stats(SimWifiStats *stats)
+{
+    std::lock_guard<std::mutex> lock(wifi_lock);
+    *stats = wifi_stats;
+}
+
+wl_status_t WiFiClass::begin(const char *ssid, const char *passphrase, int32_t channel, const uint8_t *bssid,
+                             bool connect)
+{
+    (void)passphrase;
+    if (WIFI_MODE_NULL == m_mode)
+    {
+        m_mode = WIFI_MODE_STA;
+    }
+    m_ssid = ssid;
+    if (!connect)
+    {
+        return m_status;
+    }
+    bool scan = NULL == bssid || channel <= 0;
+    bool found = scan || channel == sim_options.wifi_channel;
+    uint32_t delay_ms = sim_options.wifi_assoc_ms;
+    if (found)
+    {
+        delay_ms += (scan ? sim_options.wifi_scan_ms : 0) + (m_static_ip ? 0 : sim_options.wifi_dhcp_ms);
+    }
+    unsigned attempt;
+    {
+        std::lock_guard<std::mutex> lock(wifi_lock);
+        attempt = ++m_attempt;
+        wifi_stats.scans += scan ? 1 : 0;
+    }
+    if (0 == delay_ms)
+    {
+        complete(attempt, 0, found);
+    }
+    else
+    {
+        std::thread([this, attempt, delay_ms, found]() { complete(attempt, delay_ms, found); }).detach();
+    }
+    return m_status;
+}
+
+// Ends the connection attempt `attempt` unless disconnect() or another begin() came first
+void WiFiClass::complete(unsigned attempt, uint32_t delay_ms, bool found)
+{
+    if (delay_ms > 0)
+    {
+        delay(delay_ms);
+    }
+    {
+        std::lock_guard<std::mutex> lock(wifi_lock);
+        if (attempt != m_attempt)
+        {
+            return;
+        }
+        if (!found)
+        {
+            ++wifi_stats.not_found;
+            m_status = WL_NO_SSID_AVAIL;
+        }
+        else
+        {
+            ++(m_static_ip ? wifi_stats.static_ip : wifi_stats.dhcp);
+            m_status = WL_CONNECTED;
+        }
+    }
+    if (!found)
+    {
+        event(SYSTEM_EVENT_STA_DISCONNECTED);
+        return;
+    }
+    event(SYSTEM_EVENT_STA_CONNECTED);
+    event(SYSTEM_EVENT_STA_GOT_IP);
+}
+
+bool WiFiClass::config(IPAddress local_ip, IPAddress gateway, IPAddress subnet, IPAddress dns1, IPAddress dns2)
+{
+    // The address is always the loopback one; only whether DHCP runs matters
+    (void)gateway;
+    (void)subnet;
+    (void)dns1;
+    (void)dns2;
+    m_static_ip = 0 != (uint32_t)local_ip;
+    return true;
+}
+
+int32_t WiFiClass::channel()
+{
+    return isConnected() ? sim_options.wifi_channel : 0;
+}
+
+bool WiFiClass::disconnect(bool wifioff, bool eraseap)
+{
+    (void)eraseap;
+    bool was_connected;
+    {
+        std::lock_guard<std::mutex> lock(wifi_lock);
+        ++m_attempt;
+        was_connected = WL_CONNECTED == m_status;
+        m_status = WL_DISCONNECTED;
+    }
+    if (was_connected)
+    {
+        event(SYSTEM_EVENT_STA_DISCONNECTED);
+    }
+    if (wifioff)
+    {
+        m_mode = WIFI_MODE_NULL;
+    }
+    return true;
+}
+
+bool WiFiClass::mode(wifi_mode_t mode)
+{
+    if (WIFI_MODE_NULL == m_mode && WIFI_MODE_NULL != mode && sim_options.wifi_start_ms > 0)
+    {
+        delay(sim_options.wifi_start_ms);
+    }
+    m_mode = mode;
+    if (WIFI_MODE_NULL == mode)
+    {
+        m_status = WL_DISCONNECTED;
+        m_ap = false;
+    }
+    return true;
+}
+
+bool WiFiClass::enableSTA(bool enable)
+{
+    if (!enable)
+    {
+        m_status = WL_DISCONNECTED;
+    }
+    return true;
+}
+
+bool WiFiClass::enableAP(bool enable)
+{
+    m_ap = enable && m_ap;
+    return true;
+}
+
+bool WiFiClass::setHostname(const char *hostname)
+{
+    m_hostname = hostname;
+    return true;
+}
+
+int WiFiClass::onEvent(WiFiEventCb cb)
+{
+    for (size_t pos = 0; pos < sizeof(m_callbacks) / sizeof(m_callbacks[0]); ++pos)
+    {
+        if (NULL == m_callbacks[pos])
+        {
+            m_callbacks[pos] = cb;
+            return (int)pos;
+        }
+    }
+    return -1;
+}
+
+IPAddress WiFiClass::localIP()
+{
+    return isConnected() || m_ap ? IPAddress(127, 0, 0, 1) : IPAddress();
+}
+
+uint8_t *WiFiClass::macAddress(uint8_t *mac)
+{
+    static const uint8_t sim_mac[6] = SIM_MAC;
+    memcpy(mac, sim_mac, sizeof(sim_mac));
+    return mac;
+}
+
+String WiFiClass::macAddress()
+{
+    uint8_t mac[6];
+    char text[18];
+    macAddress(mac);
+    snprintf(text, sizeof(text), "%02X:%02X:%02X:%02X:%02X:%02X", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    return String(text);
+}
+
+uint8_t *WiFiClass::BSSID()
+{
+    static uint8_t bssid[6] = {0x02, 0, 0, 0, 0, 0x01};
+    return bssid;
+}
+
+bool WiFiClass::softAP(const char *ssid, const char *passphrase, int channel, int ssid_hidden, int max_connection)
+{
+    (void)passphrase;
+    (void)channel;
+    (void)ssid_hidden;
+    (void)max_connection;
+    if (WIFI_MODE_NULL == m_mode)
+    {
+        m_mode = WIFI_MODE_AP;
+    }
+    m_ap = true;
+    if (!sim_options.quiet)
+    {
+        printf("sim: soft AP %s on 127.0.0.1\n", ssid);
+    }
+    return true;
+}
+
+bool WiFiClass::softAPdisconnect(bool wifioff)
+{
+    m_ap = false;
+    if (wifioff)
+    {
+        m_mode = WIFI_MODE_NULL;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------- mDNS
+
+bool MDNSResponder::begin(const char *hostName)
+{
+    if (!sim_options.quiet)
+    {
+        printf("sim: mDNS host %s.local (not announced)\n", hostName);
+    }
+    return true;
+}
+
+void MDNSResponder::addService(const char *service, const char *proto, uint16_t port)
+{
+    (void)service;
+    (void)proto;
+    (void)port;
+}
+
+// ---------------------------------------------------------------- WiFiClient
+
+int WiFiClient::connect(IPAddress ip, uint16_t port)
+{
+    stop();
+    m_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (m_fd < 0)
+    {
+        return 0;
+    }
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = (uint32_t)ip;
+    if (0 != ::connect(m_fd, (sockaddr *)&addr, sizeof(addr)))
+    {
+        stop();
+        return 0;
+    }
+    int one = 1;
+    setsockopt(m_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return 1;
+}
+
+int WiFiClient::connect(const char *host, uint16_t port)
+{
+    addrinfo hints;
+    addrinfo *result = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (0 != getaddrinfo(host, NULL, &hints, &result) || NULL == result)
+    {
+        return 0;
+    }
+    IPAddress ip((uint32_t)((sockaddr_in *)result->ai_addr)->sin_addr.s_addr);
+    freeaddrinfo(result);
+    return connect(ip, port);
+}
+
+size_t WiFiClient::write(const uint8_t *buf, size_t size)
+{
+    size_t sent = 0;
+    while (m_fd >= 0 && sent < size)
+    {
+        ssize_t len = send(m_fd, buf + sent, size - sent, MSG_NOSIGNAL);
+        if (len <= 0)
+        {
+            if (len < 0 && EINTR == errno)
+            {
+                continue;
+            }
+            stop();
+            break;
+        }
+        sent += len;
+    }
+    return sent;
+}
+
+int WiFiClient::available()
+{
+    int count = 0;
+    if (m_fd < 0 || 0 != ioctl(m_fd, FIONREAD, &count))
+    {
+        return 0;
+    }
+    return count;
+}
+
+int WiFiClient::read()
+{
+    uint8_t c;
+    return 1 == read(&c, 1) ? c : -1;
+}
+
+int WiFiClient::read(uint8_t *buf, size_t size)
+{
+    if (m_fd < 0)
+    {
+        return -1;
+    }
+    ssize_t len = recv(m_fd, buf, size, MSG_DONTWAIT);
+    if (0 == len)
+    {
+        stop();
+        return -1;
+    }
+    return len < 0 ? -1 : (int)len;
+}
+
+int WiFiClient::peek()
+{
+    uint8_t c;
+    if (m_fd < 0 || 1 != recv(m_fd, &c, 1, MSG_DONTWAIT | MSG_PEEK))
+    {
+        return -1;
+    }
+    return c;
+}
+
+void WiFiClient::stop()
+{
+    if (m_fd >= 0)
+    {
+        close(m_fd);
+        m_fd = -1;
+    }
+}
+
+uint8_t WiFiClient::connected()
+{
+    if (m_fd < 0)
+    {
+        return 0;
+    }
+    uint8_t c;
+    ssize_t len = recv(m_fd, &c, 1, MSG_DONTWAIT | MSG_PEEK);
+    if (0 == len || (len < 0 && EAGAIN != errno && EWOULDBLOCK != errno && EINTR != errno))
+    {
+        stop();
+        return 0;
+    }
+    return 1;
+}
@@ -0,0 +1,271 @@
+// ST7789 panel behind TFT_eSPI: framebuffer, SPI traffic counters and the
+// optional SDL window
+
+#include "TFT_eSPI.h"
+#include "sim_internal.h"
+
+#ifdef SIM_SDL
+#include <SDL2/SDL.h>
+#endif
+
+#define SIM_WINDOW_BYTES 11 // CASET+4, RASET+4, RAMWR
+
+static uint16_t framebuffer[SIM_SCREEN_WIDTH * SIM_SCREEN_HEIGHT];
+static SimPanelStats stats;
+
+static inline uint16_t swap16(uint16_t value)
+{
+    return (uint16_t)((value << 8) | (value >> 8));
+}
+
+const uint16_t *sim_framebuffer()
+{
+    return framebuffer;
+}
+
+void sim_panel_stats(SimPanelStats *out)
+{
+    *out = stats;
+}
+
+void sim_panel_reset_stats()
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
+uint64_t sim_framebuffer_hash()
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (uint32_t pos = 0; pos < SIM_SCREEN_WIDTH * SIM_SCREEN_HEIGHT; ++pos)
+    {
+        hash = (hash ^ (framebuffer[pos] & 0xFF)) * 0x100000001b3ULL;
+        hash = (hash ^ (framebuffer[pos] >> 8)) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+bool sim_write_ppm(const char *path)
+{
+    FILE *fp = fopen(path, "wb");
+    if (NULL == fp)
+    {
+        return false;
+    }
+    fprintf(fp, "P6\n%d %d\n255\n", SIM_SCREEN_WIDTH, SIM_SCREEN_HEIGHT);
+    for (uint32_t pos = 0; pos < SIM_SCREEN_WIDTH * SIM_SCREEN_HEIGHT; ++pos)
+    {
+        uint16_t c = framebuffer[pos];
+        uint8_t rgb[3] = {(uint8_t)(((c >> 11) & 0x1F) * 255 / 31), (uint8_t)(((c >> 5) & 0x3F) * 255 / 63),
+                          (uint8_t)((c & 0x1F) * 255 / 31)};
+        fwrite(rgb, 1, sizeof(rgb), fp);
+    }
+    return 0 == fclose(fp);
+}
+
+// ------------------------------------------------------------------- TFT_eSPI
+
+void TFT_eSPI::begin(uint8_t tc)
+{
+    (void)tc;
+    // Panel RAM is random after power-up; start from black so runs compare
+    memset(framebuffer, 0, sizeof(framebuffer));
+}
+
+void TFT_eSPI::writecommand(uint8_t c)
+{
+    (void)c;
+    stats.bytes += 1;
+}
+
+void TFT_eSPI::writedata(uint8_t d)
+{
+    (void)d;
+    stats.bytes += 1;
+}
+
+void TFT_eSPI::window(int32_t x, int32_t y, int32_t w, int32_t h)
+{
+    m_winX0 = x;
+    m_winY0 = y;
+    m_winX1 = x + w - 1;
+    m_winY1 = y + h - 1;
+    m_curX = x;
+    m_curY = y;
+    stats.bytes += SIM_WINDOW_BYTES;
+    ++stats.windows;
+}
+
+void TFT_eSPI::put(int32_t x, int32_t y, uint16_t color)
+{
+    if (x >= 0 && y >= 0 && x < SIM_SCREEN_WIDTH && y < SIM_SCREEN_HEIGHT)
+    {
+        framebuffer[y * SIM_SCREEN_WIDTH + x] = color;
+    }
+}
+
+void TFT_eSPI::setAddrWindow(int32_t x, int32_t y, int32_t w, int32_t h)
+{
+    window(x, y, w, h);
+}
+
+void TFT_eSPI::pushColor(uint16_t color)
+{
+    pushColors(&color, 1, true);
+}
+
+void TFT_eSPI::pushColors(uint16_t *data, uint32_t len, bool swap)
+{
+    stats.bytes += (uint64_t)len * 2;
+    stats.pixels += len;
+    for (uint32_t pos = 0; pos < len; ++pos)
+    {
+        put(m_curX, m_curY, swap ? data[pos] : swap16(data[pos]));
+        if (++m_curX > m_winX1)
+        {
+            m_curX = m_winX0;
+            if (++m_curY > m_winY1)
+            {
+                m_curY = m_winY0;
+            }
+        }
+    }
+}
+
+void TFT_eSPI::pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t *data)
+{
+    // Clipped to the screen like the library, only the visible part is sent
+    int32_t dx = x < 0 ? -x : 0;
+    int32_t dy = y < 0 ? -y : 0;
+    int32_t dw = (x + w > m_width ? m_width - x : w) - dx;
+    int32_t dh = (y + h > m_height ? m_height - y : h) - dy;
+    if (dw <= 0 || dh <= 0)
+    {
+        return;
+    }
+    window(x + dx, y + dy, dw, dh);
+    stats.bytes += (uint64_t)dw * dh * 2;
+    stats.pixels += (uint64_t)dw * dh;
+    for (int32_t row = 0; row < dh; ++row)
+    {
+        const uint16_t *src = data + (row + dy) * w + dx;
+        uint16_t *dst = framebuffer + (y + dy + row) * SIM_SCREEN_WIDTH + x + dx;
+        for (int32_t col = 0; col < dw; ++col)
+        {
+            dst[col] = m_swapBytes ? src[col] : swap16(src[col]);
+        }
+    }
+}
+
+void TFT_eSPI::fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color)
+{
+    int32_t x1 = x + w > m_width ? m_width : x + w;
+    int32_t y1 = y + h > m_height ? m_height : y + h;
+    x = x < 0 ? 0 : x;
+    y = y < 0 ? 0 : y;
+    if (x1 <= x || y1 <= y)
+    {
+        return;
+    }
+    window(x, y, x1 - x, y1 - y);
+    stats.bytes += (uint64_t)(x1 - x) * (y1 - y) * 2;
+    stats.pixels += (uint64_t)(x1 - x) * (y1 - y);
+    ++stats.fills;
+    for (int32_t row = y; row < y1; ++row)
+    {
+        for (int32_t col = x; col < x1; ++col)
+        {
+            framebuffer[row * SIM_SCREEN_WIDTH + col] = (uint16_t)color;
+        }
+    }
+}
+
+// ---------------------------------------------------------------- SDL window
+
+#ifdef SIM_SDL
+
+static SDL_Window *sdl_window = NULL;
+static SDL_Renderer *sdl_renderer = NULL;
+static SDL_Texture *sdl_texture = NULL;
+
+bool sim_window_open()
+{
+    if (0 != SDL_Init(SDL_INIT_VIDEO))
+    {
+        fprintf(stderr, "sim: SDL_Init failed: %s\n", SDL_GetError());
+        return false;
+    }
+    int scale = sim_options.window_scale > 0 ? sim_options.window_scale : 2;
+    sdl_window = SDL_CreateWindow("Holo", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+                                  SIM_SCREEN_WIDTH * scale, SIM_SCREEN_HEIGHT * scale, 0);
+    sdl_renderer = NULL == sdl_window ? NULL : SDL_CreateRenderer(sdl_window, -1, 0);
+    sdl_texture = NULL == sdl_renderer ? NULL
+                                       : SDL_CreateTexture(sdl_renderer, SDL_PIXELFORMAT_RGB565,
+                                                           SDL_TEXTUREACCESS_STREAMING, SIM_SCREEN_WIDTH,
+                                                           SIM_SCREEN_HEIGHT);
+    if (NULL == sdl_texture)
+    {
+        fprintf(stderr, "sim: SDL window failed: %s\n", SDL_GetError());
+        sim_window_close();
+        return false;
+    }
+    return true;
+}
+
+void sim_window_close()
+{
+    if (NULL != sdl_texture)
+    {
+        SDL_DestroyTexture(sdl_texture);
+    }
+    if (NULL != sdl_renderer)
+    {
+        SDL_DestroyRenderer(sdl_renderer);
+    }
+    if (NULL != sdl_window)
+    {
+        SDL_DestroyWindow(sdl_window);
+    }
+    sdl_texture = NULL;
+    sdl_renderer = NULL;
+    sdl_window = NULL;
+    SDL_Quit();
+}
+
+bool sim_window_update()
+{
+    if (NULL == sdl_texture)
+    {
+        return true;
+    }
+    SDL_Event event;
+    while (SDL_PollEvent(&event))
+    {
+        if (SDL_QUIT == event.type)
+        {
+            return false;
+        }
+    }
+    SDL_UpdateTexture(sdl_texture, NULL, framebuffer, SIM_SCREEN_WIDTH * sizeof(uint16_t));
+    SDL_RenderCopy(sdl_renderer, sdl_texture, NULL, NULL);
+    SDL_RenderPresent(sdl_renderer);
+    return true;
+}
+
+#else
+
+bool sim_window_open()
+{
+    fprintf(stderr, "sim: built without SDL (-DSIM_SDL), running headless\n");
+    return false;
+}
+
+void sim_window_close()
+{
+}
+
+bool sim_window_update()
+{
+    return true;
+}
+
+#endif
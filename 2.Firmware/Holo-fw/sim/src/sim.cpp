@@ -0,0 +1,46 @@
+// Simulator setup shared by sim_main.cpp and other host programs
+
+#include "sim_internal.h"
+
+#include <string.h>
+
+void sim_default_options(SimOptions *options)
+{
+    memset(options, 0, sizeof(*options));
+    options->sd_dir = "sd";
+    options->flash_dir = "flash";
+    options->partitions = "partitions-no-ota.csv";
+    options->imu_trace = NULL;
+    options->virtual_time = false;
+    options->port_offset = 8000;
+    options->quiet = false;
+    options->window = false;
+    options->window_scale = 2;
+    options->wifi_channel = 1;
+}
+
+bool sim_begin(const SimOptions *options)
+{
+    sim_options = *options;
+    sim_clock_begin();
+    // Serial goes to stdout; keep it in order with the simulator's stderr lines
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    if (!sim_partitions_load() || !sim_imu_load())
+    {
+        return false;
+    }
+    if (sim_options.window && !sim_window_open())
+    {
+        sim_options.window = false;
+    }
+    return true;
+}
+
+void sim_end()
+{
+    sim_partitions_close();
+    if (sim_options.window)
+    {
+        sim_window_close();
+    }
+}
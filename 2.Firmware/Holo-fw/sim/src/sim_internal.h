@@ -0,0 +1,34 @@
+// State shared by the shim implementations (not for firmware code)
+
+#ifndef SIM_INTERNAL_H
+#define SIM_INTERNAL_H
+
+#include "sim.h"
+
+#include <string>
+
+extern SimOptions sim_options;
+
+// Host path of an SD card path ("/picture/a.jpg" -> "<sd_dir>/picture/a.jpg")
+std::string sim_sd_path(const char *path);
+// Host path of a file in the flash directory
+std::string sim_flash_path(const char *name);
+
+// A thread other than the loop task is about to wait until `deadline_us` of
+// the simulator clock (UINT64_MAX: until something else wakes it), and has
+// stopped waiting; lets delay() on the loop task step virtual time with it
+void sim_sleep_begin(uint64_t deadline_us);
+void sim_sleep_end();
+
+// Real time starts over: millis() counts from sim_begin() like from power-on
+void sim_clock_begin();
+
+bool sim_partitions_load();
+void sim_partitions_close();
+bool sim_imu_load();
+// Counts one I2C transfer by the calling thread (sim_i2c_stats())
+void sim_i2c_transfer();
+bool sim_window_open();
+void sim_window_close();
+
+#endif
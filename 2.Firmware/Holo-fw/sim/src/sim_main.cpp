@@ -0,0 +1,157 @@
+// Runs the firmware on the host: setup() once, then loop() until a limit is
+// reached or the SDL window is closed.
+//
+//   .pio/build/native/program [options]
+//     --sd DIR            SD card root (./sd)
+//     --flash DIR         partition images and SPIFFS (./flash)
+//     --partitions CSV    partition table (partitions-no-ota.csv)
+//     --imu TRACE         IMU_TRACE log to replay
+//     --virtual-time      millis() only moves with delay() on the loop task
+//     --port-offset N     added to ports below 1024 (8000: http on 8080)
+//     --ms N              stop after N ms of simulator time
+//     --loops N           stop after N loop() calls
+//     --until-imu-done    stop when the IMU trace has been replayed
+//     --dump FILE         write the final screen as a PPM image
+//     --window [SCALE]    show the screen (needs a -DSIM_SDL build)
+//     --quiet             drop Serial output
+// On exit the framebuffer hash and panel traffic are printed.
+
+#include "Arduino.h"
+#include "sim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [--sd DIR] [--flash DIR] [--partitions CSV] [--imu TRACE] [--virtual-time]\n"
+            "          [--port-offset N] [--ms N] [--loops N] [--until-imu-done] [--dump FILE]\n"
+            "          [--window [SCALE]] [--quiet]\n",
+            prog);
+}
+
+int main(int argc, char **argv)
+{
+    SimOptions options;
+    sim_default_options(&options);
+    uint64_t limit_ms = 0;
+    uint64_t limit_loops = 0;
+    bool until_imu_done = false;
+    const char *dump = NULL;
+
+    for (int pos = 1; pos < argc; ++pos)
+    {
+        const char *arg = argv[pos];
+        bool has_value = pos + 1 < argc;
+        if (!strcmp(arg, "--sd") && has_value)
+        {
+            options.sd_dir = argv[++pos];
+        }
+        else if (!strcmp(arg, "--flash") && has_value)
+        {
+            options.flash_dir = argv[++pos];
+        }
+        else if (!strcmp(arg, "--partitions") && has_value)
+        {
+            options.partitions = argv[++pos];
+        }
+        else if (!strcmp(arg, "--imu") && has_value)
+        {
+            options.imu_trace = argv[++pos];
+        }
+        else if (!strcmp(arg, "--virtual-time"))
+        {
+            options.virtual_time = true;
+        }
+        else if (!strcmp(arg, "--port-offset") && has_value)
+        {
+            options.port_offset = atoi(argv[++pos]);
+        }
+        else if (!strcmp(arg, "--ms") && has_value)
+        {
+            limit_ms = strtoull(argv[++pos], NULL, 10);
+        }
+        else if (!strcmp(arg, "--loops") && has_value)
+        {
+            limit_loops = strtoull(argv[++pos], NULL, 10);
+        }
+        else if (!strcmp(arg, "--until-imu-done"))
+        {
+            until_imu_done = true;
+        }
+        else if (!strcmp(arg, "--dump") && has_value)
+        {
+            dump = argv[++pos];
+        }
+        else if (!strcmp(arg, "--window"))
+        {
+            options.window = true;
+            if (has_value && argv[pos + 1][0] != '-')
+            {
+                options.window_scale = atoi(argv[++pos]);
+            }
+        }
+        else if (!strcmp(arg, "--quiet"))
+        {
+            options.quiet = true;
+        }
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (!sim_begin(&options))
+    {
+        return 1;
+    }
+
+    sim_set_loop_task();
+    setup();
+    uint64_t start_us = sim_now_us();
+    uint64_t loops = 0;
+    uint64_t shown_us = 0;
+    while (true)
+    {
+        uint64_t before = sim_now_us();
+        loop();
+        ++loops;
+        // A loop() that never waits would freeze the virtual clock
+        if (options.virtual_time && sim_now_us() == before)
+        {
+            sim_advance_ms(1);
+        }
+        uint64_t now = sim_now_us();
+        if (options.window && now - shown_us >= 16000)
+        {
+            shown_us = now;
+            if (!sim_window_update())
+            {
+                break;
+            }
+        }
+        if ((limit_ms && now - start_us >= limit_ms * 1000) || (limit_loops && loops >= limit_loops) ||
+            (until_imu_done && sim_imu_done()))
+        {
+            break;
+        }
+    }
+
+    SimPanelStats stats;
+    sim_panel_stats(&stats);
+    fprintf(stderr, "sim: %llu loops in %llu ms, screen %016llx, panel %llu bytes %llu pixels %u windows\n",
+            (unsigned long long)loops, (unsigned long long)((sim_now_us() - start_us) / 1000),
+            (unsigned long long)sim_framebuffer_hash(), (unsigned long long)stats.bytes,
+            (unsigned long long)stats.pixels, stats.windows);
+    if (NULL != dump && !sim_write_ppm(dump))
+    {
+        fprintf(stderr, "sim: cannot write %s\n", dump);
+    }
+    sim_end();
+    // Firmware tasks never return; leave without running static destructors under them
+    fflush(stdout);
+    _exit(0);
+}
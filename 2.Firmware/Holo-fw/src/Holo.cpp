@@ -9,21 +9,34 @@
 #include <ESPmDNS.h>
 #include <DNSServer.h>
 #include <HTTPClient.h>
-WebServer fiber_server(80);
+#include <rom/crc.h>
+#include "ff.h"
+#include "http_server.h"
+#include "discovery.h"
+#include "file_server.h"
+#include "mqtt_status.h"
+#include "wifi_manager.h"
+HttpServer fiber_server(80);
 
 #include "driver/lv_port_indev.h"
 #include "driver/lv_port_fs.h"
 
 #include "common.h"
+#include "sys/boot.h"
+#include "sys/settings.h"
+#include "driver/backlight.h"
+#include "driver/assets.h"
 #include "app/picture/picture.h"
+#include "app/picture/live_stream.h"
 
 SysUtilConfig sys_cfg;
 SysMpuConfig mpu_cfg;
 RgbConfig g_rgb_cfg;
 
 static bool isCheckAction = false;
-ImuAction *act_info; // 存放mpu6050返回的数据
-File uploadFile;
+ImuAction *act_info = &mpu.action_info; // 存放mpu6050返回的数据（初始化完成前为空闲状态）
+File uploadFile[HTTP_MAX_CLIENTS]; // 每个连接各自的上传文件
+String device_name = ""; // 用于设备发现，为空时使用 holo-<MAC后三字节>
 
 TimerHandle_t xTimerAction = NULL;
 void actionCheckHandle(TimerHandle_t xTimer)
@@ -40,17 +53,6 @@ void returnFail(String msg)
 {
   fiber_server.send(500, "text/plain", msg + "\r\n");
 }
-String readConfig(File& file)
-{
-  String ret="";
-  if(file.available())
-  {
-    ret = file.readStringUntil('\n');
-    ret.replace("\r", "");
-  }
-  
-  return ret;
-}
 String getValue(String data, char separator, int index)
 {
     int found = 0;
@@ -70,60 +72,32 @@ String getValue(String data, char separator, int index)
     return found > index ? data.substring(strIndex[0], strIndex[1]) : "";
 }
 
+// config.txt（开机时导入设置，见 sys/settings.h）中的
+//   ssid / pass_word            第一组（优先）WiFi账号
+//   ssid_1 / pass_word_1 ...    其余账号，按编号顺序尝试
+//   device_name                 设备名称
 void wifi_init()
 {
-    File config_file;
-    config_file = SD.open("/config.txt",FILE_READ);
-    String wifi_name = "fiberpunk";
-    String wifi_psd = "fiberpunk-holo";
-
-
-    String tmp_str = "";
-    //ssid
-    tmp_str = readConfig(config_file);
-    if (tmp_str.indexOf("ssid")!=-1)
-    {
-        wifi_name = getValue(tmp_str, ':', 1);
-    }
-    //password
-    tmp_str = readConfig(config_file);   
-    if(tmp_str.indexOf("pass_word")!=-1)
+    String wifi_name[WIFI_MAX_CREDENTIALS];
+    String wifi_psd[WIFI_MAX_CREDENTIALS];
+    wifi_name[0] = settings_get_str(SETTINGS_TXT_PREFIX "ssid", "fiberpunk");
+    wifi_psd[0] = settings_get_str(SETTINGS_TXT_PREFIX "pass_word", "fiberpunk-holo");
+    char key[KV_KEY_MAX + 1];
+    for (int i = 1; i < WIFI_MAX_CREDENTIALS; ++i)
     {
-        wifi_psd = getValue(tmp_str, ':', 1);   
+        snprintf(key, sizeof(key), SETTINGS_TXT_PREFIX "ssid_%d", i);
+        wifi_name[i] = settings_get_str(key);
+        snprintf(key, sizeof(key), SETTINGS_TXT_PREFIX "pass_word_%d", i);
+        wifi_psd[i] = settings_get_str(key);
     }
-        // //device name
-        // tmp_str = readConfig(config_file);
-        // if (tmp_str.indexOf("device_name")!=-1)
-        // {
-        //     cf_name = getValue(tmp_str, ':', 1);
-        // }
+    device_name = settings_get_str(SETTINGS_TXT_PREFIX "device_name");
 
-    WiFi.mode(WIFI_STA);
-    WiFi.persistent(false); 
-    WiFi.setAutoConnect(false);
-    WiFi.begin((const char*)wifi_name.c_str(), (const char*)wifi_psd.c_str());
-    uint8_t i = 0;
-    while (WiFi.status() != WL_CONNECTED && i++ < 20) 
+    for (int i = 0; i < WIFI_MAX_CREDENTIALS; ++i)
     {
-        rgb.setBrightness(0).setRGB(0, 64, 64);
-        //totaly wait 10 seconds
-        delay(500);
-        Serial.print(wifi_name);
-        rgb.setBrightness(0.2).setRGB(128, 0, 0);
+        wifi_manager_add(wifi_name[i], wifi_psd[i]);
     }
-    if (i == 21) 
-    {
-        Serial.print("connect failed!");
-        rgb.setBrightness(0.1).setRGB(128, 0, 0);
-
-    }
-    else{
-        rgb.setBrightness(0.1).setRGB(0, 150, 0);
-        Serial.print("connect successful!");
-        String ip = "Beam-Holo:" + WiFi.localIP().toString();
-        Serial.print(ip);
-    }
-
+    // 不等待连接结果，后续由 loop() 中的 wifi_manager_process() 推进
+    wifi_manager_begin();
 }
 void fbhandleFileUpload() 
 {
@@ -131,33 +105,275 @@ void fbhandleFileUpload()
   {
     return;
   }
-  HTTPUpload& upload = fiber_server.upload();
+  HttpUpload& upload = fiber_server.upload();
+  File &file = uploadFile[fiber_server.clientSlot()];
   if (upload.status == UPLOAD_FILE_START) 
   {
     if (SD.exists((char *)upload.filename.c_str())) 
     {
       SD.remove((char *)upload.filename.c_str());
     }
-    uploadFile = SD.open(upload.filename.c_str(), FILE_WRITE);
+    file = SD.open(upload.filename.c_str(), FILE_WRITE);
     // DBG_OUTPUT_PORT.print("Upload: START, filename: "); DBG_OUTPUT_PORT.println(upload.filename);
   } 
   else if (upload.status == UPLOAD_FILE_WRITE) 
   {
-    if (uploadFile) 
+    if (file) 
     {
-      uploadFile.write(upload.buf, upload.currentSize);
+      file.write(upload.buf, upload.currentSize);
     }
     // DBG_OUTPUT_PORT.print("Upload: WRITE, Bytes: "); DBG_OUTPUT_PORT.println(upload.currentSize);
-  } else if (upload.status == UPLOAD_FILE_END) 
+  } else if (upload.status == UPLOAD_FILE_END || upload.status == UPLOAD_FILE_ABORTED) 
   {
-    if (uploadFile) 
+    if (file) 
     {
-      uploadFile.close();
+      file.close();
     }
+    picture_request_rescan();
     // DBG_OUTPUT_PORT.print("Upload: END, Size: "); DBG_OUTPUT_PORT.println(upload.totalSize);
   }
 }
 
+// 断点续传：分块先缓存在内存中，CRC32校验通过后才追加到 "<path>.part"，
+// 因此 .part 文件的长度就是已确认(committed)的长度
+#define UPLOAD_PART_SUFFIX ".part"
+#define UPLOAD_CHUNK_MAX_SIZE (16 * 1024)
+
+struct ChunkUpload
+{
+  String part_path;    // 临时文件路径
+  uint32_t offset;     // 本分块在文件中的偏移
+  uint32_t expect_crc; // 客户端给出的CRC32
+  uint32_t crc;        // 实际收到数据的CRC32
+  uint8_t *buf;        // 分块缓存
+  uint32_t len;
+  int code;            // 返回给客户端的状态码
+  String msg;
+};
+static ChunkUpload chunk_upload[HTTP_MAX_CLIENTS]; // 每个连接各自的分块状态
+
+static uint32_t committedLength(const String &part_path)
+{
+  File part = SD.open(part_path.c_str(), FILE_READ);
+  if (!part)
+  {
+    return 0;
+  }
+  uint32_t len = part.size();
+  part.close();
+  return len;
+}
+
+static void returnCommitted(int code, const String &path, uint32_t committed)
+{
+  String output = "{\"path\":\"";
+  output += path;
+  output += "\",\"committed\":";
+  output += committed;
+  output += ",\"chunk_max\":";
+  output += UPLOAD_CHUNK_MAX_SIZE;
+  output += "}";
+  fiber_server.send(code, "text/json", output);
+}
+
+static void releaseChunkBuffer(ChunkUpload &chunk)
+{
+  if (NULL != chunk.buf)
+  {
+    free(chunk.buf);
+    chunk.buf = NULL;
+  }
+  chunk.len = 0;
+}
+
+// SD库的File没有截断接口，直接用FatFs（SD卡挂在0号驱动器上）
+static bool truncatePart(const String &part_path, uint32_t len)
+{
+  FIL fil;
+  if (FR_OK != f_open(&fil, part_path.c_str(), FA_WRITE | FA_OPEN_EXISTING))
+  {
+    return false;
+  }
+  FRESULT res = f_lseek(&fil, len);
+  if (FR_OK == res)
+  {
+    res = f_truncate(&fil);
+  }
+  f_close(&fil);
+  return FR_OK == res;
+}
+
+void handleUploadStatus()
+{
+  if (!fiber_server.hasArg("path"))
+  {
+    return returnFail("BAD ARGS");
+  }
+  String path = fiber_server.arg("path");
+  returnCommitted(200, path, committedLength(path + UPLOAD_PART_SUFFIX));
+}
+
+void fbhandleChunkUpload()
+{
+  HttpUpload &upload = fiber_server.upload();
+  ChunkUpload &chunk = chunk_upload[fiber_server.clientSlot()];
+  if (upload.status == UPLOAD_FILE_START)
+  {
+    releaseChunkBuffer(chunk);
+    chunk.code = 200;
+    chunk.msg = "";
+    if (!fiber_server.hasArg("path") || !fiber_server.hasArg("offset") || !fiber_server.hasArg("crc"))
+    {
+      chunk.code = 500;
+      chunk.msg = "BAD ARGS";
+      return;
+    }
+    chunk.part_path = fiber_server.arg("path") + UPLOAD_PART_SUFFIX;
+    chunk.offset = strtoul(fiber_server.arg("offset").c_str(), NULL, 10);
+    chunk.expect_crc = strtoul(fiber_server.arg("crc").c_str(), NULL, 16);
+    chunk.crc = 0;
+    // 只接受紧接在已确认数据之后的分块，否则让客户端从committed处重发
+    if (chunk.offset != committedLength(chunk.part_path))
+    {
+      chunk.code = 409;
+      chunk.msg = "OFFSET MISMATCH";
+      return;
+    }
+    chunk.buf = (uint8_t *)malloc(UPLOAD_CHUNK_MAX_SIZE);
+    if (NULL == chunk.buf)
+    {
+      chunk.code = 500;
+      chunk.msg = "NO MEMORY";
+    }
+  }
+  else if (upload.status == UPLOAD_FILE_WRITE)
+  {
+    if (NULL == chunk.buf)
+    {
+      return;
+    }
+    if (chunk.len + upload.currentSize > UPLOAD_CHUNK_MAX_SIZE)
+    {
+      releaseChunkBuffer(chunk);
+      chunk.code = 413;
+      chunk.msg = "CHUNK TOO LARGE";
+      return;
+    }
+    memcpy(chunk.buf + chunk.len, upload.buf, upload.currentSize);
+    chunk.len += upload.currentSize;
+    chunk.crc = crc32_le(chunk.crc, upload.buf, upload.currentSize);
+  }
+  else if (upload.status == UPLOAD_FILE_END)
+  {
+    if (NULL == chunk.buf)
+    {
+      return;
+    }
+    if (chunk.crc != chunk.expect_crc)
+    {
+      chunk.code = 422;
+      chunk.msg = "CRC MISMATCH";
+    }
+    else
+    {
+      File part = SD.open(chunk.part_path.c_str(), FILE_APPEND);
+      bool opened = part;
+      uint32_t committed = opened ? part.size() : 0;
+      // 开始时的检查不够：同一分块的重试可能在另一个连接上先写完（各连接的状态独立），再追加就重复了
+      bool stale = opened && committed != chunk.offset;
+      bool written = opened && !stale && part.write(chunk.buf, chunk.len) == chunk.len;
+      if (opened)
+      {
+        part.close();
+      }
+      if (stale)
+      {
+        chunk.code = 409;
+        chunk.msg = "OFFSET MISMATCH";
+      }
+      else if (!written)
+      {
+        chunk.code = 500;
+        chunk.msg = "WRITE FAILED";
+        // 写了一半（如卡满）时截回写入前的长度，.part 里只留校验过的分块
+        if (opened && !truncatePart(chunk.part_path, committed))
+        {
+          SD.remove(chunk.part_path.c_str());
+        }
+      }
+      picture_touch_catalog();
+    }
+    releaseChunkBuffer(chunk);
+  }
+  else if (upload.status == UPLOAD_FILE_ABORTED)
+  {
+    // 连接中断：丢弃未校验的分块，.part 保持在上一个完整分块的位置
+    releaseChunkBuffer(chunk);
+    chunk.code = 500;
+    chunk.msg = "ABORTED";
+  }
+}
+
+void handleUploadChunk()
+{
+  String path = fiber_server.arg("path");
+  ChunkUpload &chunk = chunk_upload[fiber_server.clientSlot()];
+  int code = chunk.code;
+  chunk.code = 0; // 该连接的下一个请求必须重新带上分块数据
+  if (code == 0)
+  {
+    return returnFail("NO DATA");
+  }
+  if (code != 200 && code != 409)
+  {
+    fiber_server.send(code, "text/plain", chunk.msg + "\r\n");
+    return;
+  }
+  returnCommitted(code, path, committedLength(path + UPLOAD_PART_SUFFIX));
+}
+
+void handleUploadCommit()
+{
+  if (!fiber_server.hasArg("path") || !fiber_server.hasArg("size"))
+  {
+    return returnFail("BAD ARGS");
+  }
+  String path = fiber_server.arg("path");
+  String part_path = path + UPLOAD_PART_SUFFIX;
+  uint32_t size = strtoul(fiber_server.arg("size").c_str(), NULL, 10);
+  uint32_t committed = committedLength(part_path);
+  if (path == "/" || committed != size)
+  {
+    return returnCommitted(409, path, committed);
+  }
+  // FAT不支持覆盖式rename，先删旧文件再改名
+  if (SD.exists(path.c_str()))
+  {
+    SD.remove(path.c_str());
+  }
+  if (!SD.rename(part_path.c_str(), path.c_str()))
+  {
+    return returnFail("RENAME FAILED");
+  }
+  picture_request_rescan();
+  returnOK();
+}
+
+void handleUploadAbort()
+{
+  if (!fiber_server.hasArg("path"))
+  {
+    return returnFail("BAD ARGS");
+  }
+  String part_path = fiber_server.arg("path") + UPLOAD_PART_SUFFIX;
+  if (SD.exists(part_path.c_str()))
+  {
+    SD.remove(part_path.c_str());
+    picture_touch_catalog();
+  }
+  returnOK();
+}
+
 void deleteRecursive(String path) 
 {
   File file = SD.open((char *)path.c_str());
@@ -207,14 +423,129 @@ void handleDelete()
     returnFail("No SD Card");
   }
   deleteRecursive(path);
+  picture_request_rescan();
   returnOK();
 }
+// /list 的输出先写进固定大小的缓存，写满再整块发送，避免每个条目都拼接String
+#define LIST_BUF_SIZE 1024
+#define LIST_DEFAULT_LIMIT 0xFFFFFFFF
+
+struct ListWriter
+{
+  char buf[LIST_BUF_SIZE];
+  size_t len;
+};
+
+static ListWriter list_writer; // 处理函数在服务任务中串行执行，共用一份
+
+static void listFlush(ListWriter &w)
+{
+  fiber_server.sendContent(w.buf, w.len);
+  w.len = 0;
+}
+
+static void listWrite(ListWriter &w, const char *str, size_t len)
+{
+  while (len > 0)
+  {
+    size_t room = LIST_BUF_SIZE - w.len;
+    size_t copy_len = len < room ? len : room;
+    memcpy(w.buf + w.len, str, copy_len);
+    w.len += copy_len;
+    str += copy_len;
+    len -= copy_len;
+    if (LIST_BUF_SIZE == w.len)
+    {
+      listFlush(w);
+    }
+  }
+}
+
+static void listWrite(ListWriter &w, const char *str)
+{
+  listWrite(w, str, strlen(str));
+}
+
+static void listWriteUInt(ListWriter &w, unsigned long value)
+{
+  char num[12];
+  listWrite(w, num, snprintf(num, sizeof(num), "%lu", value));
+}
+
+// 写入JSON字符串，对引号、反斜杠和控制字符转义
+static void listWriteString(ListWriter &w, const char *str)
+{
+  listWrite(w, "\"", 1);
+  const char *run = str;
+  for (; *str; ++str)
+  {
+    unsigned char ch = (unsigned char)*str;
+    if (ch != '"' && ch != '\\' && ch >= 0x20)
+    {
+      continue;
+    }
+    listWrite(w, run, str - run);
+    char esc[8];
+    if (ch == '"' || ch == '\\')
+    {
+      esc[0] = '\\';
+      esc[1] = ch;
+      listWrite(w, esc, 2);
+    }
+    else
+    {
+      listWrite(w, esc, snprintf(esc, sizeof(esc), "\\u%04x", ch));
+    }
+    run = str + 1;
+  }
+  listWrite(w, run, str - run);
+  listWrite(w, "\"", 1);
+}
+
+// If-None-Match 可以是 "*" 或逗号分隔的ETag列表，逐项完整比较（弱比较，忽略W/前缀）
+static bool etagMatches(const char *header, const String &etag)
+{
+  while (*header)
+  {
+    size_t len = strcspn(header, ",");
+    const char *tag = header;
+    const char *end = header + len;
+    header = *end ? end + 1 : end;
+    while (tag < end && (' ' == *tag || '\t' == *tag))
+    {
+      ++tag;
+    }
+    while (end > tag && (' ' == end[-1] || '\t' == end[-1]))
+    {
+      --end;
+    }
+    if (end - tag > 2 && 'W' == tag[0] && '/' == tag[1])
+    {
+      tag += 2;
+    }
+    if ((1 == end - tag && '*' == *tag) ||
+        ((size_t)(end - tag) == etag.length() && 0 == strncmp(tag, etag.c_str(), end - tag)))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
 void printDirectory() 
 {
   if (!fiber_server.hasArg("dir")) 
   {
     return returnFail("BAD ARGS");
   }
+  // 文件列表只会经由HTTP修改，版本号没变时客户端可以直接使用缓存
+  String etag = picture_catalog_etag();
+  if (etagMatches(fiber_server.header("If-None-Match").c_str(), etag))
+  {
+    fiber_server.sendHeader("ETag", etag);
+    fiber_server.send(304);
+    return;
+  }
   String path = fiber_server.arg("dir");
   if (path != "/" && !SD.exists((char *)path.c_str())) 
   {
@@ -227,37 +558,95 @@ void printDirectory()
     dir.close();
     return returnFail("NOT DIR");
   }
+
+  // 带 offset/limit 时分页返回 {"offset":..,"next":..,"entries":[..]}，否则保持原来的数组格式
+  bool paged = fiber_server.hasArg("offset") || fiber_server.hasArg("limit");
+  unsigned long offset = strtoul(fiber_server.arg("offset").c_str(), NULL, 10);
+  unsigned long limit = LIST_DEFAULT_LIMIT;
+  if (fiber_server.hasArg("limit"))
+  {
+    limit = strtoul(fiber_server.arg("limit").c_str(), NULL, 10);
+  }
+  String fields = fiber_server.arg("fields");
+  bool with_size = fields.indexOf("size") != -1;
+  bool with_mtime = fields.indexOf("mtime") != -1;
+
   dir.rewindDirectory();
   fiber_server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  fiber_server.sendHeader("ETag", etag);
+  fiber_server.sendHeader("Cache-Control", "no-cache");
   fiber_server.send(200, "text/json", "");
-  WiFiClient client = fiber_server.client();
 
-  fiber_server.sendContent("[");
-  for(int cnt = 0; true; ++cnt)
-   {
+  ListWriter &w = list_writer;
+  w.len = 0;
+  if (paged)
+  {
+    listWrite(w, "{\"offset\":");
+    listWriteUInt(w, offset);
+    listWrite(w, ",\"entries\":[");
+  }
+  else
+  {
+    listWrite(w, "[");
+  }
+  unsigned long index = 0;
+  unsigned long count = 0;
+  bool more = false;
+  while (true)
+  {
     File entry = dir.openNextFile();
-    if(!entry) 
+    if (!entry) 
     {
       break;
     }
-
-    String output;
-    if(cnt > 0)
+    if (index++ < offset)
     {
-      output = ',';
+      entry.close();
+      continue;
     }
-
-    output += "{\"type\":\"";
-    output += (entry.isDirectory()) ? "dir" : "file";
-    output += "\",\"name\":\"";
-    output += entry.name();
-    output += "\"";
-    output += "}";
-    fiber_server.sendContent(output);
+    if (count == limit)
+    {
+      // 只需知道后面还有没有条目
+      entry.close();
+      more = true;
+      break;
+    }
+    listWrite(w, count++ > 0 ? ",{\"type\":\"" : "{\"type\":\"");
+    listWrite(w, entry.isDirectory() ? "dir" : "file");
+    listWrite(w, "\",\"name\":");
+    listWriteString(w, entry.name());
+    if (with_size)
+    {
+      listWrite(w, ",\"size\":");
+      listWriteUInt(w, entry.size());
+    }
+    if (with_mtime)
+    {
+      listWrite(w, ",\"mtime\":");
+      listWriteUInt(w, (unsigned long)entry.getLastWrite());
+    }
+    listWrite(w, "}");
     entry.close();
   }
-  fiber_server.sendContent("]");
   dir.close();
+  if (paged)
+  {
+    listWrite(w, "],\"next\":");
+    if (more)
+    {
+      listWriteUInt(w, offset + count);
+    }
+    else
+    {
+      listWrite(w, "null");
+    }
+    listWrite(w, "}");
+  }
+  else
+  {
+    listWrite(w, "]");
+  }
+  listFlush(w);
 }
 void handleCreate() 
 {
@@ -271,7 +660,7 @@ void handleCreate()
     returnFail("Dir existed");
   }
   SD.mkdir((char *)path.c_str());
-  picture_init();
+  picture_request_rescan();
   returnOK();
 }
 
@@ -279,7 +668,7 @@ void updateStatus()
 {
     if (!fiber_server.hasArg("stu")) 
     {
-        fiber_server.send(500, "text/plain", "");
+        return fiber_server.send(500, "text/plain", "");
     }
     String op = fiber_server.arg("stu")+"\n";
     // DBG_OUTPUT_PORT.print(op);
@@ -302,63 +691,88 @@ void reportDevice()
   fiber_server.send(200, "text/plain",ip);
 }
 
-void setup()
+// 启动步骤：屏幕/LVGL相关在主任务执行，其余可并行的放到独立任务中（见 sys/boot.h）
+static void boot_spiffs()
 {
-    Serial.begin(115200);
-
-    Serial.println(F("\nAIO (All in one) version " AIO_VERSION "\n"));
-    Serial.flush();
-    // MAC ID可用作芯片唯一标识
-    Serial.print(F("ChipID(EfuseMac): "));
-    Serial.println(ESP.getEfuseMac());
-
-
     // 需要放在Setup里初始化
     if (!SPIFFS.begin(true))
     {
         Serial.println("SPIFFS Mount Failed");
-        return;
     }
+}
 
-        /*** Init screen ***/
+static void boot_assets()
+{
+    // 只映射并检查索引，字体和图片在使用时直接从flash读取
+    assets_init();
+}
+
+static void boot_settings()
+{
+    settings_init();
+}
+
+static void boot_config()
+{
+    // 用户在SD卡上编辑的配置，内容变化时才重新导入
+    settings_import_txt("/config.txt");
+}
+
+static void boot_screen()
+{
     screen.init(4,95);
-    /*** Init on-board RGB ***/
+}
+
+static void boot_rgb()
+{
     rgb.init();
     rgb.setBrightness(0.05).setRGB(0, 64, 64);
+}
 
-    /*** Init ambient-light sensor ***/
+static void boot_ambient()
+{
     ambLight.init(ONE_TIME_H_RESOLUTION_MODE);
+}
 
-    /*** Init micro SD-Card ***/
+static void boot_sd()
+{
     tf.init();
+}
 
+static void boot_imu()
+{
+    // 自动校准耗时较长，在后台完成，期间动作检测使用空闲状态
     mpu.init(0, 1,&mpu_cfg);
-        /*** 以此作为MPU6050初始化完成的标志 ***/
-    RgbConfig *rgb_cfg = &g_rgb_cfg;
-    // 初始化RGB灯 HSV色彩模式
-    RgbParam rgb_setting = {LED_MODE_HSV,
-                            rgb_cfg->min_value_0, rgb_cfg->min_value_1, rgb_cfg->min_value_2,
-                            rgb_cfg->max_value_0, rgb_cfg->max_value_1, rgb_cfg->max_value_2,
-                            rgb_cfg->step_0, rgb_cfg->step_1, rgb_cfg->step_2,
-                            rgb_cfg->min_brightness, rgb_cfg->max_brightness,
-                            rgb_cfg->brightness_step, rgb_cfg->time};
-
-    // rgb_thread_init(&rgb_setting);
-
+    // 之后MPU6050和光感都由I2C总线任务访问
+    ambLight.startSampling();
+    i2c_bus_begin();
+    /*** 以此作为MPU6050初始化完成的标志 ***/
     act_info = mpu.getAction();
     // 定义一个mpu6050的动作检测定时器
     xTimerAction = xTimerCreate("Action Check",
                                 200 / portTICK_PERIOD_MS,
                                 pdTRUE, (void *)0, actionCheckHandle);
     xTimerStart(xTimerAction, 0);
+}
 
+static void boot_backlight()
+{
+    backlight_init();
+}
+
+static void boot_lv_fs()
+{
     // lv_port_fs_init();
     lv_fs_fatfs_init();
+}
 
-    
-
-    wifi_init();
+static void boot_picture()
+{
     picture_init();
+}
+
+static void boot_services()
+{
     fiber_server.on("/status", HTTP_GET, updateStatus);
     fiber_server.on("/find", HTTP_GET, reportDevice); 
     fiber_server.on("/list", HTTP_GET, printDirectory);
@@ -367,15 +781,57 @@ void setup()
     fiber_server.on("/edit", HTTP_POST, []() {
     returnOK();
   }, fbhandleFileUpload);
+    fiber_server.on("/upload/status", HTTP_GET, handleUploadStatus);
+    fiber_server.on("/upload/chunk", HTTP_POST, handleUploadChunk, fbhandleChunkUpload);
+    fiber_server.on("/upload/commit", HTTP_GET, handleUploadCommit);
+    fiber_server.on("/upload/abort", HTTP_GET, handleUploadAbort);
 
+    // 套接字都在这里创建：依赖wifi步骤，此时lwIP已启动
     fiber_server.begin();
+    live_stream_init();
+    file_server_init();
+    discovery_init(device_name.c_str());
+    mqtt_status_init();
+}
+
+void setup()
+{
+    Serial.begin(115200);
+
+    Serial.println(F("\nAIO (All in one) version " AIO_VERSION "\n"));
+    Serial.flush();
+    // MAC ID可用作芯片唯一标识
+    Serial.print(F("ChipID(EfuseMac): "));
+    Serial.println(ESP.getEfuseMac());
+
+    int settings = boot_add("settings", boot_settings, 0, BOOT_ON_TASK);
+    int assets = boot_add("assets", boot_assets, 0, BOOT_ON_TASK);
+    int spiffs = boot_add("spiffs", boot_spiffs, 0, BOOT_ON_TASK);
+    int screen_id = boot_add("screen", boot_screen, 0, BOOT_ON_MAIN);
+    int rgb_id = boot_add("rgb", boot_rgb, 0, BOOT_ON_TASK);
+    int ambient = boot_add("ambient", boot_ambient, 0, BOOT_ON_TASK);
+    int sd = boot_add("sd", boot_sd, 0, BOOT_ON_TASK);
+    int config = boot_add("config", boot_config, BOOT_DEP(settings) | BOOT_DEP(sd), BOOT_ON_TASK);
+    // 光感与MPU6050共用I2C总线，需串行初始化
+    boot_add("imu", boot_imu, BOOT_DEP(ambient) | BOOT_DEP(settings), BOOT_ON_BACKGROUND);
+    // 自动调光任务会等待I2C总线任务启动后再读取光感
+    boot_add("backlight", boot_backlight, BOOT_DEP(screen_id) | BOOT_DEP(config), BOOT_ON_TASK);
+    int lv_fs = boot_add("lv_fs", boot_lv_fs, BOOT_DEP(screen_id), BOOT_ON_MAIN);
+    int wifi = boot_add("wifi", wifi_init, BOOT_DEP(config) | BOOT_DEP(rgb_id), BOOT_ON_TASK);
+    int picture = boot_add("picture", boot_picture,
+                           BOOT_DEP(screen_id) | BOOT_DEP(spiffs) | BOOT_DEP(sd) | BOOT_DEP(lv_fs) |
+                               BOOT_DEP(settings) | BOOT_DEP(assets),
+                           BOOT_ON_MAIN);
+    boot_add("services", boot_services, BOOT_DEP(wifi) | BOOT_DEP(picture), BOOT_ON_TASK);
+    boot_run();
+    Serial.printf("Setup done in %lu ms\n", millis());
 }
 
 
 
 void loop()
 {
-    fiber_server.handleClient();
+    wifi_manager_process();
     screen.routine();
     if (isCheckAction)
     {
@@ -3,6 +3,8 @@
 
 #include <SD.h>
 
+class LabelOverlay;
+
 class PlayDocoderBase
 {
 public:
@@ -40,6 +42,8 @@ public:
     // 由此保存环境当前的高低位置换，以便退出视频播放的时候还原回去。
     static uint8_t *m_displayBufWithDma[2];
     static bool m_dmaBufferSel;
+    static const LabelOverlay *m_overlay; // 推送之前混合进每个图块的文字，可为NULL
+    static int16_t m_bottom;              // 图块只推送到这一行之前（下面留给状态栏）
 
 public:
     MjpegPlayDocoder(File *file, bool isUseDMA = false);
@@ -0,0 +1,166 @@
+#include "frame_cache.h"
+#include "common.h"
+
+struct CachedFrame
+{
+    String path;
+    uint8_t *data; // NULL表示空闲
+    uint32_t size;
+    uint32_t last_use;
+};
+
+static CachedFrame slots[FRAME_CACHE_SLOTS];
+static size_t budget = FRAME_CACHE_BUDGET;
+static size_t total_size = 0;
+static uint32_t use_clock = 0;
+static bool use_psram = false;
+static CachedFrame *pinned = NULL; // 最近一次 frame_cache_get() 返回的帧（正在显示），不淘汰
+
+void frame_cache_begin()
+{
+    use_psram = psramFound();
+    budget = use_psram ? FRAME_CACHE_PSRAM_BUDGET : FRAME_CACHE_BUDGET;
+}
+
+static void release_slot(CachedFrame *slot)
+{
+    if (slot == pinned)
+    {
+        pinned = NULL;
+    }
+    free(slot->data);
+    slot->data = NULL;
+    slot->path = "";
+    total_size -= slot->size;
+    slot->size = 0;
+}
+
+void frame_cache_clear()
+{
+    for (int pos = 0; pos < FRAME_CACHE_SLOTS; ++pos)
+    {
+        if (NULL != slots[pos].data)
+        {
+            release_slot(&slots[pos]);
+        }
+    }
+}
+
+static CachedFrame *find_slot(const String &path)
+{
+    for (int pos = 0; pos < FRAME_CACHE_SLOTS; ++pos)
+    {
+        if (NULL != slots[pos].data && slots[pos].path == path)
+        {
+            slots[pos].last_use = ++use_clock;
+            return &slots[pos];
+        }
+    }
+    return NULL;
+}
+
+// 淘汰最久未使用的一帧，没有可淘汰的返回false
+static bool evict_oldest()
+{
+    CachedFrame *oldest = NULL;
+    for (int pos = 0; pos < FRAME_CACHE_SLOTS; ++pos)
+    {
+        if (NULL != slots[pos].data && &slots[pos] != pinned &&
+            (NULL == oldest || slots[pos].last_use < oldest->last_use))
+        {
+            oldest = &slots[pos];
+        }
+    }
+    if (NULL == oldest)
+    {
+        return false;
+    }
+    release_slot(oldest);
+    return true;
+}
+
+static CachedFrame *load_slot(const String &path)
+{
+    File file = tf.open(path);
+    if (!file)
+    {
+        return NULL;
+    }
+    uint32_t size = file.size();
+    if (0 == size || size > budget)
+    {
+        file.close();
+        return NULL;
+    }
+
+    // 腾出空间和空闲的槽位
+    CachedFrame *slot = NULL;
+    while (true)
+    {
+        slot = NULL;
+        for (int pos = 0; pos < FRAME_CACHE_SLOTS && NULL == slot; ++pos)
+        {
+            if (NULL == slots[pos].data)
+            {
+                slot = &slots[pos];
+            }
+        }
+        bool heap_ok = use_psram || ESP.getFreeHeap() >= size + FRAME_CACHE_MIN_FREE_HEAP;
+        if (NULL != slot && total_size + size <= budget && heap_ok)
+        {
+            break;
+        }
+        if (!evict_oldest())
+        {
+            file.close();
+            return NULL;
+        }
+    }
+
+    uint8_t *data = (uint8_t *)(use_psram ? ps_malloc(size) : malloc(size));
+    if (NULL == data)
+    {
+        file.close();
+        return NULL;
+    }
+    if (file.read(data, size) != size)
+    {
+        free(data);
+        file.close();
+        return NULL;
+    }
+    file.close();
+
+    slot->path = path;
+    slot->data = data;
+    slot->size = size;
+    slot->last_use = ++use_clock;
+    total_size += size;
+    return slot;
+}
+
+const uint8_t *frame_cache_get(const String &path, uint32_t *size)
+{
+    CachedFrame *slot = find_slot(path);
+    if (NULL == slot)
+    {
+        pinned = NULL; // 当前帧不再显示，可以为新帧腾出空间
+        slot = load_slot(path);
+    }
+    pinned = slot;
+    if (NULL == slot)
+    {
+        return NULL;
+    }
+    *size = slot->size;
+    return slot->data;
+}
+
+bool frame_cache_prefetch(const String &path)
+{
+    if (NULL != find_slot(path))
+    {
+        return false;
+    }
+    return NULL != load_slot(path);
+}
@@ -0,0 +1,21 @@
+#ifndef FRAME_CACHE_H
+#define FRAME_CACHE_H
+
+#include <Arduino.h>
+
+// 转台模式的帧缓存：按路径缓存整张JPEG，转动时可以任意跳帧而不必每次读SD卡
+// 空间不足时淘汰最久未使用的帧；有PSRAM时放在PSRAM中并使用更大的容量
+#define FRAME_CACHE_SLOTS 16
+#define FRAME_CACHE_BUDGET (48 * 1024)         // 内部RAM中的总容量（字节）
+#define FRAME_CACHE_PSRAM_BUDGET (1024 * 1024) // PSRAM中的总容量（字节）
+#define FRAME_CACHE_MIN_FREE_HEAP (40 * 1024)  // 剩余堆低于该值时不再缓存
+
+void frame_cache_begin();
+// 释放全部缓存
+void frame_cache_clear();
+// 取出一帧，未缓存时从SD卡读入；失败返回NULL（此时应直接从SD卡解码）
+const uint8_t *frame_cache_get(const String &path, uint32_t *size);
+// 预读一帧（已缓存时只更新使用顺序），返回是否读取了SD卡
+bool frame_cache_prefetch(const String &path);
+
+#endif
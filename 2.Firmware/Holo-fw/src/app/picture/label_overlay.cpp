@@ -0,0 +1,140 @@
+#include "label_overlay.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// RGB565 展开成 0b00000111111000001111100000011111，R、G、B 用一次乘法混合（与 lv_color_mix 相同）
+#define RGB565_SPREAD_MASK 0x07E0F81FUL
+
+LabelOverlay::LabelOverlay() : m_strip(NULL), m_width(0), m_height(0), m_stride(0),
+                               m_win_x(0), m_win_y(0), m_win_w(0), m_color(0xFFFF),
+                               m_period(1), m_start(0), m_scroll_ms(0)
+{
+}
+
+LabelOverlay::~LabelOverlay()
+{
+    clear();
+}
+
+bool LabelOverlay::begin(uint16_t width, uint16_t height)
+{
+    clear();
+    if (0 == width || 0 == height || width > LABEL_OVERLAY_MAX_WIDTH)
+    {
+        return false;
+    }
+    m_stride = (width + 1) / 2;
+    m_strip = (uint8_t *)calloc((uint32_t)m_stride * height, 1);
+    if (NULL == m_strip)
+    {
+        return false;
+    }
+    m_width = width;
+    m_height = height;
+    setScroll(0);
+    return true;
+}
+
+void LabelOverlay::setAlpha(uint16_t x, uint16_t y, uint8_t alpha)
+{
+    if (NULL == m_strip || x >= m_width || y >= m_height)
+    {
+        return;
+    }
+    uint8_t *cell = &m_strip[y * m_stride + (x >> 1)];
+    uint8_t shift = (x & 1) << 2;
+    *cell = (*cell & ~(0x0F << shift)) | ((alpha >> 4) << shift);
+}
+
+void LabelOverlay::clear()
+{
+    free(m_strip);
+    m_strip = NULL;
+    m_width = 0;
+    m_height = 0;
+    m_stride = 0;
+}
+
+void LabelOverlay::setWindow(int16_t x, int16_t y, uint16_t width)
+{
+    m_win_x = x;
+    m_win_y = y;
+    m_win_w = width;
+    layout();
+}
+
+void LabelOverlay::advance(uint32_t ms)
+{
+    setScroll(m_scroll_ms + ms);
+}
+
+void LabelOverlay::setScroll(uint32_t ms)
+{
+    m_scroll_ms = ms;
+    layout();
+}
+
+void LabelOverlay::layout()
+{
+    if (m_width <= m_win_w)
+    {
+        // 居中：窗口第0列对应条带的 -pad 处
+        m_period = m_win_w > 0 ? m_win_w : 1;
+        m_start = (m_win_w - (m_win_w - m_width) / 2) % m_period;
+        return;
+    }
+    m_period = m_width + LABEL_OVERLAY_GAP;
+    // 滚过一整圈所用的时间是 m_period 秒的整数倍，在此处回绕不会跳动
+    m_scroll_ms %= m_period * 1000;
+    m_start = m_scroll_ms * LABEL_OVERLAY_SPEED / 1000 % m_period;
+}
+
+void LabelOverlay::compose(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t *block) const
+{
+    if (NULL == m_strip || 0 == m_win_w)
+    {
+        return;
+    }
+    // 图块与窗口的交集
+    int32_t x0 = x > m_win_x ? x : m_win_x;
+    int32_t x1 = x + w < m_win_x + m_win_w ? x + w : m_win_x + m_win_w;
+    int32_t y0 = y > m_win_y ? y : m_win_y;
+    int32_t y1 = y + h < m_win_y + m_height ? y + h : m_win_y + m_height;
+    if (x0 >= x1 || y0 >= y1)
+    {
+        return;
+    }
+
+    uint32_t fg = ((uint32_t)m_color | ((uint32_t)m_color << 16)) & RGB565_SPREAD_MASK;
+    uint32_t u0 = (m_start + (x0 - m_win_x)) % m_period;
+    for (int32_t row = y0; row < y1; ++row)
+    {
+        const uint8_t *src = m_strip + (row - m_win_y) * m_stride;
+        uint16_t *dst = block + (row - y) * w + (x0 - x);
+        uint32_t u = u0;
+        for (int32_t col = x0; col < x1; ++col, ++dst)
+        {
+            if (u < m_width)
+            {
+                uint32_t alpha = (src[u >> 1] >> ((u & 1) << 2)) & 0x0F;
+                if (15 == alpha)
+                {
+                    *dst = m_color;
+                }
+                else if (0 != alpha)
+                {
+                    // 4bpp 的透明度按 LVGL 的方式换算为 0~255，再取 5 位
+                    uint32_t mix = (alpha * 17 + 4) >> 3;
+                    uint32_t bg = ((uint32_t)*dst | ((uint32_t)*dst << 16)) & RGB565_SPREAD_MASK;
+                    uint32_t result = ((((fg - bg) * mix) >> 5) + bg) & RGB565_SPREAD_MASK;
+                    *dst = (uint16_t)((result >> 16) | result);
+                }
+            }
+            if (++u == m_period)
+            {
+                u = 0;
+            }
+        }
+    }
+}
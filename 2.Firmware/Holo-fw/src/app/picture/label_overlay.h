@@ -0,0 +1,52 @@
+#ifndef LABEL_OVERLAY_H
+#define LABEL_OVERLAY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 叠加在图片/视频上的滚动文字（模型名称）
+// 文字只渲染一次到透明度条带（4bpp，与字体的位深相同），JPEG解码出的每个图块在推送到屏幕之前
+// 按当前的滚动位置混合进文字，屏幕每帧只写一次，不再与LVGL标签的滚动动画争抢屏幕
+// 只依赖标准头文件，可在PC上编译（见 tools/label_overlay_check.cpp）
+#define LABEL_OVERLAY_MAX_WIDTH 512 // 条带的最大宽度（像素）
+#define LABEL_OVERLAY_GAP 40        // 循环滚动时文字首尾之间的空白（像素）
+#define LABEL_OVERLAY_SPEED 40      // 滚动速度（像素/秒）
+
+class LabelOverlay
+{
+private:
+    uint8_t *m_strip; // 每字节两个像素，低4位在左
+    uint16_t m_width;
+    uint16_t m_height;
+    uint16_t m_stride;
+    int16_t m_win_x;
+    int16_t m_win_y;
+    uint16_t m_win_w;
+    uint16_t m_color; // RGB565
+    uint32_t m_period; // 窗口第0列对应的条带位置按此循环
+    uint32_t m_start;  // 窗口第0列当前对应的条带位置
+    uint32_t m_scroll_ms;
+
+    void layout();
+
+public:
+    LabelOverlay();
+    ~LabelOverlay();
+    // 分配 width x height 的空白条带，之后用 setAlpha() 画入文字
+    bool begin(uint16_t width, uint16_t height);
+    void setAlpha(uint16_t x, uint16_t y, uint8_t alpha);
+    void clear(); // 释放条带，不再叠加
+    bool active() const { return NULL != m_strip; }
+
+    // 文字显示的区域，高度等于条带的高度；文字比窗口窄时居中不滚动，否则循环滚动
+    void setWindow(int16_t x, int16_t y, uint16_t width);
+    void setColor(uint16_t rgb565) { m_color = rgb565; }
+    void advance(uint32_t ms); // 按 LABEL_OVERLAY_SPEED 滚动
+    void setScroll(uint32_t ms);
+
+    // 把文字混合进一个图块（RGB565，w*h 连续存放），(x, y) 为图块在屏幕上的位置
+    void compose(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t *block) const;
+    uint32_t ramUsage() const { return (uint32_t)m_stride * m_height; }
+};
+
+#endif
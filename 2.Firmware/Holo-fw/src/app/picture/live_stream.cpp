@@ -0,0 +1,519 @@
+#include "live_stream.h"
+
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+
+#ifdef ARDUINO
+#include <lwip/sockets.h>
+#else
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#define LIVE_ACK_QUEUE_SIZE 16
+#define LIVE_ACK_BACKLOG_SIZE (4 * LIVE_ACK_QUEUE_SIZE * LIVE_ACK_SIZE) // 发不出去的确认最多积压这么多字节，再多就断开连接
+#define LIVE_DISCARD_SIZE 512
+
+enum LIVE_SLOT_STATE : unsigned char
+{
+    LIVE_SLOT_FREE = 0,
+    LIVE_SLOT_FILLING,  // 接收任务正在写入
+    LIVE_SLOT_READY,    // 等待显示
+    LIVE_SLOT_DECODING  // loop任务正在解码
+};
+
+struct LiveFrame
+{
+    uint8_t *buf;
+    uint32_t len;
+    uint32_t seq;
+    uint32_t ts;  // 发送端时间戳
+    uint32_t due; // 本地的显示时间
+    LIVE_SLOT_STATE state;
+    bool orphan; // 解码过程中连接已断开，归还时释放缓存
+};
+
+struct LiveAck
+{
+    uint32_t seq;
+    uint32_t ts;
+    uint32_t status;
+};
+
+// 帧缓存在接收任务和loop任务之间共享，状态切换都在锁内完成
+static LiveFrame frames[LIVE_FRAME_SLOTS];
+static LiveFrame *decoding_frame = NULL;
+static LiveAck ack_queue[LIVE_ACK_QUEUE_SIZE];
+static uint8_t ack_num = 0;
+static portMUX_TYPE live_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static volatile bool client_connected = false;
+static volatile bool frame_received = false;
+static volatile uint32_t last_frame_millis = 0;
+
+// 以下只在接收任务中访问
+static int listen_fd = -1;
+static int client_fd = -1;
+static uint8_t ack_out[LIVE_ACK_BACKLOG_SIZE]; // 已取出但还没发出去的确认
+static uint32_t ack_out_len = 0;
+static uint8_t frame_head[LIVE_FRAME_HEAD_SIZE];
+static uint32_t head_got = 0;
+static LiveFrame *filling_frame = NULL; // NULL 表示丢弃本帧数据
+static uint32_t body_len = 0;
+static uint32_t body_got = 0;
+static uint32_t cur_seq = 0;
+static uint32_t cur_ts = 0;
+static int32_t clock_offset = 0; // 本地时间 - 发送端时间 的最小值（即网络延迟最小的那一帧）
+static bool clock_valid = false;
+
+static uint32_t read_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void write_le32(uint8_t *p, uint32_t value)
+{
+    p[0] = value;
+    p[1] = value >> 8;
+    p[2] = value >> 16;
+    p[3] = value >> 24;
+}
+
+// 需在锁内调用
+static void queue_ack(uint32_t seq, uint32_t ts, uint32_t status)
+{
+    if (ack_num >= LIVE_ACK_QUEUE_SIZE)
+    {
+        return; // 发送端会因确认超时自行恢复
+    }
+    ack_queue[ack_num].seq = seq;
+    ack_queue[ack_num].ts = ts;
+    ack_queue[ack_num].status = status;
+    ++ack_num;
+}
+
+// 发送端长时间不收确认时积压会超出上限，返回false
+static bool flush_acks()
+{
+    LiveAck acks[LIVE_ACK_QUEUE_SIZE];
+    portENTER_CRITICAL(&live_mux);
+    uint8_t num = ack_num;
+    memcpy(acks, ack_queue, num * sizeof(LiveAck));
+    ack_num = 0;
+    portEXIT_CRITICAL(&live_mux);
+
+    if (client_fd < 0)
+    {
+        return true;
+    }
+    if (ack_out_len + num * LIVE_ACK_SIZE > LIVE_ACK_BACKLOG_SIZE)
+    {
+        Serial.println(F("LiveStream: ack backlog overflow"));
+        return false;
+    }
+    for (int pos = 0; pos < num; ++pos)
+    {
+        uint8_t *out = ack_out + ack_out_len;
+        write_le32(out, acks[pos].seq);
+        write_le32(out + 4, acks[pos].ts);
+        write_le32(out + 8, acks[pos].status);
+        ack_out_len += LIVE_ACK_SIZE;
+    }
+    if (0 == ack_out_len)
+    {
+        return true;
+    }
+    // 非阻塞发送可能只发出一部分，剩下的留到下一轮select再发，否则确认的分帧就错位了
+    int len = ::send(client_fd, ack_out, ack_out_len, MSG_NOSIGNAL);
+    if (len < 0)
+    {
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    ack_out_len -= len;
+    memmove(ack_out, ack_out + len, ack_out_len);
+    return true;
+}
+
+// 取一个空闲缓存；没有空闲时丢弃最早的待显示帧（解码跟不上网络）
+static LiveFrame *take_slot()
+{
+    LiveFrame *slot = NULL;
+    portENTER_CRITICAL(&live_mux);
+    for (int pos = 0; pos < LIVE_FRAME_SLOTS; ++pos)
+    {
+        if (LIVE_SLOT_FREE == frames[pos].state && NULL != frames[pos].buf)
+        {
+            slot = &frames[pos];
+            break;
+        }
+    }
+    if (NULL == slot)
+    {
+        for (int pos = 0; pos < LIVE_FRAME_SLOTS; ++pos)
+        {
+            if (LIVE_SLOT_READY == frames[pos].state &&
+                (NULL == slot || (int32_t)(frames[pos].seq - slot->seq) < 0))
+            {
+                slot = &frames[pos];
+            }
+        }
+        if (NULL != slot)
+        {
+            queue_ack(slot->seq, slot->ts, LIVE_ACK_DROPPED);
+        }
+    }
+    if (NULL != slot)
+    {
+        slot->state = LIVE_SLOT_FILLING;
+    }
+    portEXIT_CRITICAL(&live_mux);
+    return slot;
+}
+
+static void finish_frame()
+{
+    uint32_t now = millis();
+    int32_t offset = (int32_t)(now - cur_ts);
+    // 以最快到达的帧为基准估计时钟差，其余帧按同样的延迟排队播放，吸收网络抖动
+    if (!clock_valid || offset < clock_offset)
+    {
+        clock_offset = offset;
+        clock_valid = true;
+    }
+    portENTER_CRITICAL(&live_mux);
+    if (NULL != filling_frame)
+    {
+        filling_frame->len = body_len;
+        filling_frame->seq = cur_seq;
+        filling_frame->ts = cur_ts;
+        filling_frame->due = cur_ts + clock_offset + LIVE_JITTER_DELAY;
+        filling_frame->state = LIVE_SLOT_READY;
+    }
+    else
+    {
+        queue_ack(cur_seq, cur_ts, LIVE_ACK_DROPPED);
+    }
+    portEXIT_CRITICAL(&live_mux);
+    filling_frame = NULL;
+    last_frame_millis = now;
+    frame_received = true;
+}
+
+static bool parse_head()
+{
+    if (memcmp(frame_head, LIVE_FRAME_MAGIC, 4))
+    {
+        Serial.println(F("LiveStream: bad frame head"));
+        return false;
+    }
+    body_len = read_le32(frame_head + 4);
+    cur_seq = read_le32(frame_head + 8);
+    cur_ts = read_le32(frame_head + 12);
+    body_got = 0;
+    filling_frame = body_len <= LIVE_FRAME_MAX_SIZE ? take_slot() : NULL;
+    return true;
+}
+
+static void close_client()
+{
+    if (client_fd < 0)
+    {
+        return;
+    }
+    close(client_fd);
+    client_fd = -1;
+    ack_out_len = 0;
+    uint8_t *release_buf[LIVE_FRAME_SLOTS];
+    portENTER_CRITICAL(&live_mux);
+    client_connected = false;
+    frame_received = false;
+    ack_num = 0;
+    for (int pos = 0; pos < LIVE_FRAME_SLOTS; ++pos)
+    {
+        release_buf[pos] = NULL;
+        if (LIVE_SLOT_DECODING == frames[pos].state)
+        {
+            frames[pos].orphan = true;
+            continue;
+        }
+        release_buf[pos] = frames[pos].buf;
+        frames[pos].buf = NULL;
+        frames[pos].state = LIVE_SLOT_FREE;
+    }
+    portEXIT_CRITICAL(&live_mux);
+    for (int pos = 0; pos < LIVE_FRAME_SLOTS; ++pos)
+    {
+        free(release_buf[pos]);
+    }
+    filling_frame = NULL;
+    Serial.println(F("LiveStream: client closed"));
+}
+
+static void accept_client()
+{
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd < 0)
+    {
+        return;
+    }
+    if (client_fd >= 0)
+    {
+        // 同一时间只接受一路推流
+        close(fd);
+        return;
+    }
+    // 帧缓存只在有推流时占用（上一路连接中仍在解码的那一帧归还时才释放）
+    bool ok = true;
+    for (int pos = 0; pos < LIVE_FRAME_SLOTS; ++pos)
+    {
+        portENTER_CRITICAL(&live_mux);
+        bool need = NULL == frames[pos].buf && LIVE_SLOT_FREE == frames[pos].state;
+        portEXIT_CRITICAL(&live_mux);
+        if (!need)
+        {
+            continue;
+        }
+        uint8_t *buf = (uint8_t *)malloc(LIVE_FRAME_MAX_SIZE);
+        ok = ok && NULL != buf;
+        portENTER_CRITICAL(&live_mux);
+        frames[pos].buf = buf;
+        portEXIT_CRITICAL(&live_mux);
+    }
+    client_fd = fd;
+    if (!ok)
+    {
+        Serial.println(F("LiveStream: no memory"));
+        close_client();
+        return;
+    }
+    fcntl(client_fd, F_SETFL, O_NONBLOCK);
+    int enable = 1;
+    setsockopt(client_fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    head_got = 0;
+    filling_frame = NULL;
+    clock_valid = false;
+    client_connected = true;
+    Serial.println(F("LiveStream: client connected"));
+}
+
+// 读取当前可用的数据，连接断开或协议错误时返回false
+static bool read_client()
+{
+    static uint8_t discard[LIVE_DISCARD_SIZE];
+    while (true)
+    {
+        int len;
+        if (head_got < LIVE_FRAME_HEAD_SIZE)
+        {
+            len = recv(client_fd, frame_head + head_got, LIVE_FRAME_HEAD_SIZE - head_got, 0);
+            if (len > 0)
+            {
+                head_got += len;
+                if (LIVE_FRAME_HEAD_SIZE == head_got)
+                {
+                    if (!parse_head())
+                    {
+                        return false;
+                    }
+                    if (0 == body_len)
+                    {
+                        finish_frame();
+                        head_got = 0;
+                        if (!flush_acks())
+                        {
+                            return false;
+                        }
+                    }
+                }
+                continue;
+            }
+        }
+        else
+        {
+            uint32_t left = body_len - body_got;
+            if (NULL != filling_frame)
+            {
+                len = recv(client_fd, filling_frame->buf + body_got, left, 0);
+            }
+            else
+            {
+                len = recv(client_fd, discard, left < LIVE_DISCARD_SIZE ? left : LIVE_DISCARD_SIZE, 0);
+            }
+            if (len > 0)
+            {
+                body_got += len;
+            }
+        }
+        if (0 == len)
+        {
+            return false;
+        }
+        if (len < 0)
+        {
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        if (LIVE_FRAME_HEAD_SIZE == head_got && body_got == body_len)
+        {
+            finish_frame();
+            head_got = 0;
+            // 一次可能读到很多帧，每帧之后就发出确认，以免确认队列溢出
+            if (!flush_acks())
+            {
+                return false;
+            }
+        }
+    }
+}
+
+static void live_stream_task(void *param)
+{
+    fd_set read_fds;
+    fd_set write_fds;
+    struct timeval tv;
+    while (true)
+    {
+        FD_ZERO(&read_fds);
+        FD_ZERO(&write_fds);
+        FD_SET(listen_fd, &read_fds);
+        int max_fd = listen_fd;
+        if (client_fd >= 0)
+        {
+            FD_SET(client_fd, &read_fds);
+            if (ack_out_len > 0)
+            {
+                FD_SET(client_fd, &write_fds); // 有积压的确认时等可写再发
+            }
+            max_fd = client_fd > max_fd ? client_fd : max_fd;
+        }
+        tv.tv_sec = 0;
+        tv.tv_usec = LIVE_SELECT_TIMEOUT * 1000;
+        int ready = select(max_fd + 1, &read_fds, &write_fds, NULL, &tv);
+        if (ready < 0)
+        {
+            vTaskDelay(10 / portTICK_PERIOD_MS);
+            continue;
+        }
+        if (ready > 0 && client_fd >= 0 && FD_ISSET(client_fd, &read_fds) && !read_client())
+        {
+            close_client();
+        }
+        if (ready > 0 && FD_ISSET(listen_fd, &read_fds))
+        {
+            accept_client();
+        }
+        if (!flush_acks())
+        {
+            close_client();
+        }
+    }
+}
+
+bool live_stream_init()
+{
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0)
+    {
+        Serial.println(F("LiveStream: socket failed"));
+        return false;
+    }
+    int enable = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+    struct sockaddr_in server_addr;
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    server_addr.sin_port = htons(LIVE_STREAM_PORT);
+    if (bind(listen_fd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0 ||
+        listen(listen_fd, 1) < 0)
+    {
+        Serial.println(F("LiveStream: bind/listen failed"));
+        close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+    fcntl(listen_fd, F_SETFL, O_NONBLOCK);
+
+    xTaskCreatePinnedToCore(live_stream_task, "live_stream", LIVE_TASK_STACK_SIZE,
+                            NULL, LIVE_TASK_PRIORITY, NULL, LIVE_TASK_CORE);
+    return true;
+}
+
+bool live_stream_active()
+{
+    return client_connected && frame_received &&
+           (uint32_t)(millis() - last_frame_millis) < LIVE_IDLE_TIMEOUT;
+}
+
+const uint8_t *live_stream_acquire(uint32_t *len)
+{
+    uint32_t now = millis();
+    LiveFrame *frame = NULL;
+    portENTER_CRITICAL(&live_mux);
+    if (NULL == decoding_frame)
+    {
+        // 选出已到期的最新一帧，更早的到期帧已经来不及显示
+        for (int pos = 0; pos < LIVE_FRAME_SLOTS; ++pos)
+        {
+            LiveFrame *cur = &frames[pos];
+            if (LIVE_SLOT_READY != cur->state || (int32_t)(now - cur->due) < 0)
+            {
+                continue;
+            }
+            if (NULL == frame)
+            {
+                frame = cur;
+                continue;
+            }
+            LiveFrame *older = cur;
+            if ((int32_t)(cur->seq - frame->seq) > 0)
+            {
+                older = frame;
+                frame = cur;
+            }
+            older->state = LIVE_SLOT_FREE;
+            queue_ack(older->seq, older->ts, LIVE_ACK_DROPPED);
+        }
+        if (NULL != frame)
+        {
+            frame->state = LIVE_SLOT_DECODING;
+            decoding_frame = frame;
+            *len = frame->len;
+        }
+    }
+    portEXIT_CRITICAL(&live_mux);
+    return NULL != frame ? frame->buf : NULL;
+}
+
+void live_stream_release()
+{
+    uint8_t *release_buf = NULL;
+    portENTER_CRITICAL(&live_mux);
+    LiveFrame *frame = decoding_frame;
+    decoding_frame = NULL;
+    if (NULL != frame)
+    {
+        if (frame->orphan)
+        {
+            release_buf = frame->buf;
+            frame->buf = NULL;
+            frame->orphan = false;
+        }
+        else
+        {
+            queue_ack(frame->seq, frame->ts, LIVE_ACK_SHOWN);
+        }
+        frame->state = LIVE_SLOT_FREE;
+    }
+    portEXIT_CRITICAL(&live_mux);
+    free(release_buf);
+}
@@ -0,0 +1,39 @@
+#ifndef LIVE_STREAM_H
+#define LIVE_STREAM_H
+
+#include <Arduino.h>
+
+// 实时画面推流：电脑端通过TCP连续发送JPEG帧，不经过SD卡直接显示
+// 每帧前带16字节帧头（小端）：
+//   "HLV1" | 帧长度 uint32 | 序号 uint32 | 发送端时间戳 uint32 (ms)
+// 每帧处理完后回复12字节确认（小端）：
+//   序号 uint32 | 原样返回的时间戳 uint32 | 状态 uint32 (LIVE_ACK_*)
+// 发送端据此控制在途帧数（背压）并统计端到端延迟
+#define LIVE_STREAM_PORT 8081
+#define LIVE_FRAME_MAGIC "HLV1"
+#define LIVE_FRAME_HEAD_SIZE 16
+#define LIVE_ACK_SIZE 12
+
+#define LIVE_ACK_SHOWN 0   // 已显示
+#define LIVE_ACK_DROPPED 1 // 解码跟不上或帧过大，被丢弃
+
+#define LIVE_FRAME_SLOTS 4             // 抖动缓冲的帧数
+#define LIVE_FRAME_MAX_SIZE (16 * 1024) // 单帧JPEG的最大长度
+#define LIVE_JITTER_DELAY 40           // 抖动缓冲的播放延迟（ms）
+#define LIVE_IDLE_TIMEOUT 2000         // 超过该时间没有新帧则退出实时模式（ms）
+#define LIVE_SELECT_TIMEOUT 10         // 事件等待的超时时间（ms）
+
+#define LIVE_TASK_STACK_SIZE 4096
+#define LIVE_TASK_PRIORITY 2
+#define LIVE_TASK_CORE 0
+
+bool live_stream_init();
+
+// 以下接口在 loop 任务中调用
+bool live_stream_active(); // 有推流连接且最近收到过帧
+// 取出到期应显示的最新一帧（更早的到期帧直接丢弃），没有则返回NULL
+const uint8_t *live_stream_acquire(uint32_t *len);
+// 当前帧显示完毕，归还缓存并回复确认
+void live_stream_release();
+
+#endif
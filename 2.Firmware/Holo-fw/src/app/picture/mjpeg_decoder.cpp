@@ -1,4 +1,5 @@
 #include "docoder.h"
+#include "label_overlay.h"
 #include "common.h"
 #include <TJpg_Decoder.h>
 // #include "MjpegClass.h"
@@ -22,14 +23,23 @@
 bool MjpegPlayDocoder::m_isUseDMA = 0;
 uint8_t *MjpegPlayDocoder::m_displayBufWithDma[2];
 bool MjpegPlayDocoder::m_dmaBufferSel = false;
+const LabelOverlay *MjpegPlayDocoder::m_overlay = NULL;
+int16_t MjpegPlayDocoder::m_bottom = VIDEO_HEIGHT;
 
 // This next function will be called during decoding of the jpeg file to render each
 // 16x16 or 8x8 image tile (Minimum Coding Unit) to the tft->
 bool MjpegPlayDocoder::tft_output(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t *bitmap)
 {
     // Stop further decoding as image is running off bottom of screen
-    if (y >= tft->height())
+    if (y >= tft->height() || y >= m_bottom)
         return 0;
+    if (y + h > m_bottom)
+        h = m_bottom - y;
+
+    if (NULL != m_overlay)
+    {
+        m_overlay->compose(x, y, w, h, bitmap);
+    }
 
     // STM32F767 processor takes 43ms just to decode (and not draw) jpeg (-Os compile option)
     // Total time to decode and also draw to TFT:
@@ -181,8 +191,6 @@ bool MjpegPlayDocoder::video_start()
 bool MjpegPlayDocoder::video_play_screen(void)
 {
     // Read video
-    uint32_t l = 0;
-
     if (m_isUseDMA)
     {
         // 一帧数据大概3000B 240M主频时花费50ms  80M时需要150ms
@@ -1,15 +1,17 @@
 #include "picture.h"
 #include "picture_gui.h"
 #include "common.h"
+#include "sys/settings.h"
+#include "driver/assets.h"
 
 // Include the jpeg decoder library
 #include <TJpg_Decoder.h>
 
 #define PICTURE_APP_NAME "Picture"
 
-// 相册的持久化配置
-#define PICTURE_CONFIG_PATH "/picture.cfg"
-#define MEDIA_CONFIG_PATH "/media.cfg"
+// 相册的持久化配置（保存在设置中，见 sys/settings.h）
+#define PICTURE_INTERVAL_KEY "pic.interval"
+#define PICTURE_INTERVAL_DEFAULT 300
 struct PIC_Config
 {
     unsigned long switchInterval; // 自动播放下一张的时间间隔 ms
@@ -17,6 +19,11 @@ struct PIC_Config
 
 #include "docoder.h"
 #include "DMADrawer.h"
+#include "live_stream.h"
+#include "turntable.h"
+#include "frame_cache.h"
+#include "label_overlay.h"
+#include "print_hud.h"
 
 #define MEDIA_PLAYER_APP_NAME "Media"
 
@@ -26,6 +33,24 @@ struct PIC_Config
 #define NO_TRIGGER_ENTER_FREQ_160M 90000UL // 无操作规定时间后进入设置160M主频（90s）
 #define NO_TRIGGER_ENTER_FREQ_80M 120000UL // 无操作规定时间后进入设置160M主频（120s）
 
+// 转台模式：图片模型中前倾长按（GO_FORWORD）进入，转动设备即转动模型，后倾长按（RETURN）退出
+#define TURNTABLE_MAX_FRAMES 72 // 序列最多的帧数（1.jpg ~ N.jpg）
+#define TURNTABLE_DEGREES 360   // 转动多少度看完整个序列
+#define TURNTABLE_PREFETCH 2    // 沿转动方向预读的帧数
+
+// 模型名称叠加在图片/视频上（取代LVGL的滚动标签，见 label_overlay.h）
+#define NAME_OVERLAY_X 20
+#define NAME_OVERLAY_BOTTOM 216 // 文字底边，留在图片（20,20起的200x200）以内
+#define NAME_OVERLAY_WIDTH 200
+#define NAME_OVERLAY_COLOR TFT_WHITE
+LV_FONT_DECLARE(lv_font_montserrat_24);
+
+// 资源分区中的内容（见 driver/assets.h），没有烧录时不显示
+#define NAME_FALLBACK_FONT "font/ch_font_20" // 模型名称中 montserrat 没有的字（中文）
+#define EMPTY_IMAGE "img/no_model"           // SD卡上没有模型时显示的JPEG
+static lv_font_t name_font;                  // montserrat_24 的副本，fallback 指向资源分区中的字体
+static bool empty_shown = false;
+
 
 ACTIVE_TYPE pre_statu;
 uint8_t pre_play_type;//记录上一次播放的是图片还是视屏,0 播放图片, 1播放视屏
@@ -37,36 +62,13 @@ void update_print_status(int pro, int head, int temp);
 
 void write_config(PIC_Config *cfg)
 {
-    char tmp[16];
-    // 将配置数据保存在文件中（持久化）
-    String w_data;
-    memset(tmp, 0, 16);
-    snprintf(tmp, 16, "%lu\n", cfg->switchInterval);
-    w_data += tmp;
-    g_flashCfg.writeFile(PICTURE_CONFIG_PATH, w_data.c_str());
+    settings_set_u32(PICTURE_INTERVAL_KEY, cfg->switchInterval);
 }
 
 void read_config(PIC_Config *cfg)
 {
-    // 如果有需要持久化配置文件 可以调用此函数将数据存在flash中
-    // 配置文件名最好以APP名为开头 以".cfg"结尾，以免多个APP读取混乱
-    char info[128] = {0};
-    uint16_t size = g_flashCfg.readFile(PICTURE_CONFIG_PATH, (uint8_t *)info);
-    info[size] = 0;
-    if (size == 0)
-    {
-        // 默认值
-        cfg->switchInterval = 300; // 是否自动播放下一个（0不切换 默认10000毫秒）
-        write_config(cfg);
-    }
-    else
-    {
-        // 解析数据
-        // char *param[1] = {0};
-        // analyseParam(info, 1, param);
-        // cfg->switchInterval = atol(param[0]);
-        cfg->switchInterval = 300;
-    }
+    // 自动播放下一张的间隔 ms，没有保存过时使用默认值
+    cfg->switchInterval = settings_get_u32(PICTURE_INTERVAL_KEY, PICTURE_INTERVAL_DEFAULT);
 }
 
 struct MP_Config
@@ -95,7 +97,6 @@ struct PictureAppRunData
     bool tftSwapStatus;
 };
 
-static MP_Config video_cfg_data;
 static MediaAppRunData *video_run_data = NULL;
 
 static PIC_Config cfg_data;
@@ -104,15 +105,49 @@ static std::vector<String> print_file;
 static int current_file_index = 0;
 static int current_file_name_index = 0;
 
+// HTTP服务运行在独立的任务中，涉及文件列表和LVGL的更新统一交给 picture_process() 执行
+struct PrintStatus
+{
+    int progress;
+    int head_temp;
+    int bed_temp;
+    bool dirty;
+};
+static volatile bool catalog_dirty = false;
+// 文件列表的版本号：SD卡内容经HTTP修改后递增，加上开机随机数用作 /list 的ETag
+// HTTP和文件服务两个任务都会递增，用临界区保护
+static volatile uint32_t catalog_generation = 0;
+static portMUX_TYPE catalog_mux = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t catalog_nonce = 0;
+static PrintStatus pending_print_status = {0, 0, 0, false};
+static bool live_mode = false; // 正在显示网络推流的画面
+static bool scrub_mode = false; // 转台模式
+static TurntableScrub scrub;
+static int scrub_frames = 0;
+static int scrub_base = 0;   // 进入转台模式时显示的帧
+static int scrub_shown = -1; // 当前显示的帧（0开始）
+static int scrub_dir = 1;    // 最近的转动方向，用于预读
+static uint32_t scrub_generation = 0;
+static portMUX_TYPE print_status_mux = portMUX_INITIALIZER_UNLOCKED;
+static LabelOverlay name_overlay;
+static String name_overlay_text;
+static unsigned long name_overlay_millis = 0;
+
 // This next function will be called during decoding of the jpeg file to
 // render each block to the TFT.  If you use a different TFT library
 // you will need to adapt this function to suit.
 bool tft_output(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t *bitmap)
 {
     // Stop further decoding as image is running off bottom of screen
-    if (y >= tft->height())
+    // 底部的打印状态栏由LVGL绘制（print_hud.h），图块只推送到它的上方
+    int16_t bottom = print_hud_top();
+    if (y >= tft->height() || y >= bottom)
         return 0;
+    if (y + h > bottom)
+        h = bottom - y; // 图块按行连续存放，截掉下面的行即可
 
+    // 推送之前混合进模型名称，屏幕只写一次
+    name_overlay.compose(x, y, w, h, bitmap);
     // This function will clip the image block rendering automatically at the TFT boundaries
     tft->pushImage(x, y, w, h, bitmap);
 
@@ -123,6 +158,93 @@ bool tft_output(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t *bitmap)
     return 1;
 }
 
+// 按LVGL绘制文字的方式把 txt 光栅化进 name_overlay，draw 为 false 时只量宽度
+static int name_overlay_raster(const char *txt, bool draw)
+{
+    const lv_font_t *font = &name_font;
+    int width = 0;
+    int pen = 0;
+    uint32_t pos = 0;
+    uint32_t letter = _lv_txt_encoded_next(txt, &pos);
+    while (0 != letter)
+    {
+        uint32_t next_pos = pos;
+        uint32_t letter_next = _lv_txt_encoded_next(txt, &next_pos);
+        lv_font_glyph_dsc_t g;
+        if (lv_font_get_glyph_dsc(font, &g, letter, letter_next))
+        {
+            int glyph_x = pen + g.ofs_x;
+            int glyph_y = (font->line_height - font->base_line) - g.box_h - g.ofs_y;
+            if (glyph_x + g.box_w > width)
+            {
+                width = glyph_x + g.box_w;
+            }
+            const uint8_t *bitmap = draw ? lv_font_get_glyph_bitmap(g.resolved_font, letter) : NULL;
+            if (NULL != bitmap)
+            {
+                // 字模按行连续存放，高位在前
+                uint8_t bpp = 3 == g.bpp ? 4 : g.bpp;
+                uint32_t value_max = (1 << bpp) - 1;
+                uint32_t bit = 0;
+                for (int row = 0; row < g.box_h; ++row)
+                {
+                    for (int col = 0; col < g.box_w; ++col, bit += bpp)
+                    {
+                        uint32_t value = (bitmap[bit >> 3] >> (8 - bpp - (bit & 7))) & value_max;
+                        if (0 != value && glyph_x + col >= 0 && glyph_y + row >= 0)
+                        {
+                            name_overlay.setAlpha(glyph_x + col, glyph_y + row, value * 255 / value_max);
+                        }
+                    }
+                }
+            }
+            pen += g.adv_w;
+        }
+        letter = letter_next;
+        pos = next_pos;
+    }
+    return pen > width ? pen : width;
+}
+
+// 文字变化时才重新渲染，滚动只改变偏移
+static void name_overlay_show(const String &text)
+{
+    if (text == name_overlay_text)
+    {
+        return;
+    }
+    name_overlay_text = text;
+    name_overlay.clear();
+    int width = name_overlay_raster(text.c_str(), false);
+    if (0 == width)
+    {
+        return;
+    }
+    // 过长的名称截断到 LABEL_OVERLAY_MAX_WIDTH
+    uint16_t height = lv_font_get_line_height(&name_font);
+    if (width > LABEL_OVERLAY_MAX_WIDTH)
+    {
+        width = LABEL_OVERLAY_MAX_WIDTH;
+    }
+    if (!name_overlay.begin(width, height))
+    {
+        Serial.println(F("Name overlay: out of memory"));
+        return;
+    }
+    name_overlay_raster(text.c_str(), true);
+    name_overlay.setColor(NAME_OVERLAY_COLOR);
+    name_overlay.setWindow(NAME_OVERLAY_X, NAME_OVERLAY_BOTTOM - height, NAME_OVERLAY_WIDTH);
+    name_overlay_millis = millis();
+}
+
+// 每帧解码前调用，按经过的时间滚动
+static void name_overlay_tick()
+{
+    unsigned long now = millis();
+    name_overlay.advance(now - name_overlay_millis);
+    name_overlay_millis = now;
+}
+
 File_Info *get_next_file(File_Info *p_cur_file, int direction)
 {
     // 得到 p_cur_file 的下一个 类型为FILE_TYPE_FILE 的文件（即下一个非文件夹文件）
@@ -205,7 +327,7 @@ void update_all_img_dir()
         }
         else 
         {
-            if(String(entry.name()).endsWith(".mjpeg") || String(entry.name()).endsWith(".MJPEG"));
+            if(String(entry.name()).endsWith(".mjpeg") || String(entry.name()).endsWith(".MJPEG"))
             {
                 print_file.push_back(entry.name());
             }
@@ -216,6 +338,7 @@ void update_all_img_dir()
 void picture_init()
 {
     photo_gui_init();
+    catalog_nonce = esp_random();
     // 获取配置信息
     read_config(&cfg_data);
     // 初始化运行时参数
@@ -224,6 +347,7 @@ void picture_init()
     run_data->image_file = NULL;
     run_data->pfile = NULL;
     video_run_init();
+    frame_cache_begin();
 
 
     // 保存系统的tft设置参数 用于退出时恢复设置
@@ -235,13 +359,63 @@ void picture_init()
     TJpgDec.setJpgScale(1);
     // The decoder must be given the exact name of the rendering function above
     TJpgDec.setCallback(tft_output);
+    MjpegPlayDocoder::m_overlay = &name_overlay;
+    name_font = lv_font_montserrat_24;
+    name_font.fallback = asset_font(NAME_FALLBACK_FONT);
+}
 
+void update_print_status(int pro, int head, int temp)
+{
+    portENTER_CRITICAL(&print_status_mux);
+    pending_print_status.progress = pro;
+    pending_print_status.head_temp = head;
+    pending_print_status.bed_temp = temp;
+    pending_print_status.dirty = true;
+    portEXIT_CRITICAL(&print_status_mux);
+}
 
+void picture_touch_catalog()
+{
+    portENTER_CRITICAL(&catalog_mux);
+    ++catalog_generation;
+    portEXIT_CRITICAL(&catalog_mux);
 }
 
-void update_print_status(int pro, int head, int temp)
+void picture_request_rescan()
+{
+    picture_touch_catalog();
+    catalog_dirty = true;
+}
+
+String picture_catalog_etag()
+{
+    char etag[24];
+    snprintf(etag, sizeof(etag), "\"%08x-%u\"", (unsigned)catalog_nonce, (unsigned)catalog_generation);
+    return String(etag);
+}
+
+static void apply_pending_updates()
 {
-    display_print_status(pro,head,temp);
+    if (catalog_dirty)
+    {
+        catalog_dirty = false;
+        update_all_img_dir();
+        if (current_file_index >= (int)print_file.size())
+        {
+            current_file_index = 0;
+        }
+    }
+
+    PrintStatus status;
+    portENTER_CRITICAL(&print_status_mux);
+    status = pending_print_status;
+    pending_print_status.dirty = false;
+    portEXIT_CRITICAL(&print_status_mux);
+    if (status.dirty)
+    {
+        display_print_status(status.progress, status.head_temp, status.bed_temp);
+    }
+    print_hud_refresh(millis());
 }
 
 void video_check_start()
@@ -263,22 +437,195 @@ void video_check_start()
         Serial.println("Here in video close file");
         video_start(true, p_current_file);
         cfg_data.switchInterval = 15;
-        display_piclabel("",LV_SCR_LOAD_ANIM_FADE_ON);
+        // 视频显示去掉路径和扩展名的文件名
+        name_overlay_show(p_current_file.substring(1, p_current_file.lastIndexOf('.')));
+    }
+}
+
+static String scrub_frame_path(int frame)
+{
+    return print_file[current_file_index] + "/" + String(frame + 1) + ".jpg";
+}
+
+static bool scrub_begin()
+{
+    String dir = print_file[current_file_index];
+    if (dir.endsWith(".mjpeg") || dir.endsWith(".MJPEG"))
+    {
+        return false;
     }
+    int frames = 0;
+    while (frames < TURNTABLE_MAX_FRAMES && SD.exists(dir + "/" + String(frames + 1) + ".jpg"))
+    {
+        ++frames;
+    }
+    if (frames < 2 || !mpu.setOrientationMode(true))
+    {
+        return false;
+    }
+    scrub.begin(frames, TURNTABLE_DEGREES, TURNTABLE_YAW);
+    scrub_frames = frames;
+    // current_file_name_index 是下一张要显示的图片（1开始）
+    scrub_base = ((current_file_name_index - 2) % frames + frames) % frames;
+    scrub_shown = -1;
+    scrub_generation = catalog_generation;
+    scrub_mode = true;
+    TJpgDec.setJpgScale(1);
+    TJpgDec.setCallback(tft_output);
+    Serial.printf("Turntable: %s, %d frames\n", dir.c_str(), frames);
+    return true;
+}
+
+static void scrub_end()
+{
+    scrub_mode = false;
+    mpu.setOrientationMode(false);
+    frame_cache_clear();
+    // 从当前帧继续自动播放
+    if (scrub_shown >= 0)
+    {
+        current_file_name_index = scrub_shown + 2 > scrub_frames ? 1 : scrub_shown + 2;
+    }
+    run_data->pic_perMillis = 0; // 间接强制更新
+    Serial.println(F("Turntable: exit"));
+}
+
+static void scrub_show(int frame)
+{
+    String path = scrub_frame_path(frame);
+    uint32_t jpg_size;
+    const uint8_t *jpg = frame_cache_get(path, &jpg_size);
+    if (NULL != jpg)
+    {
+        TJpgDec.drawJpg(20, 20, jpg, jpg_size);
+    }
+    else
+    {
+        TJpgDec.drawSdJpg(20, 20, path);
+    }
+    scrub_shown = frame;
+}
+
+// 空闲时沿转动方向预读，每次最多读一帧，避免占用太长时间
+static void scrub_prefetch()
+{
+    for (int ahead = 1; ahead <= TURNTABLE_PREFETCH + 1; ++ahead)
+    {
+        // 先沿转动方向预读，最后是反方向的相邻帧
+        int step = ahead <= TURNTABLE_PREFETCH ? ahead * scrub_dir : -scrub_dir;
+        int frame = ((scrub_shown + step) % scrub_frames + scrub_frames) % scrub_frames;
+        if (frame_cache_prefetch(scrub_frame_path(frame)))
+        {
+            break;
+        }
+    }
+}
+
+static bool scrub_process(const ImuAction *act_info)
+{
+    if (!scrub_mode)
+    {
+        if (GO_FORWORD != act_info->active || 0 == print_file.size() || !scrub_begin())
+        {
+            return false;
+        }
+    }
+    // 文件列表变化后模型可能已被删除
+    if (RETURN == act_info->active || scrub_generation != catalog_generation)
+    {
+        scrub_end();
+        return false;
+    }
+
+    float quat[4];
+    uint32_t quat_ms;
+    int frame = scrub_shown < 0 ? scrub_base : scrub_shown;
+    if (mpu.getOrientation(quat, &quat_ms))
+    {
+        frame = (scrub_base + scrub.update(quat, quat_ms)) % scrub_frames;
+        if (scrub.speed() > 1)
+        {
+            scrub_dir = 1;
+        }
+        else if (scrub.speed() < -1)
+        {
+            scrub_dir = -1;
+        }
+    }
+    if (frame != scrub_shown)
+    {
+        scrub_show(frame);
+    }
+    else
+    {
+        scrub_prefetch();
+        delay(5);
+    }
+    return true;
+}
+
+// 网络推流优先于相册播放，推流结束后恢复原来的播放
+static bool live_stream_process()
+{
+    if (!live_stream_active())
+    {
+        if (live_mode)
+        {
+            live_mode = false;
+            tft->fillScreen(TFT_BLACK);
+            if (print_file.size() > 0)
+            {
+                video_check_start();
+            }
+            run_data->pic_perMillis = 0; // 间接强制更新
+        }
+        return false;
+    }
+    if (!live_mode)
+    {
+        live_mode = true;
+        release_player_docoder();
+        video_run_data->file.close();
+        pre_play_type = 0;
+        name_overlay_show("");
+        tft->fillScreen(TFT_BLACK);
+        TJpgDec.setJpgScale(1);
+        TJpgDec.setCallback(tft_output);
+    }
+    uint32_t jpg_size;
+    const uint8_t *jpg = live_stream_acquire(&jpg_size);
+    if (NULL != jpg)
+    {
+        TJpgDec.drawJpg(0, 0, jpg, jpg_size);
+        live_stream_release();
+    }
+    else
+    {
+        delay(1);
+    }
+    return true;
 }
 
 void picture_process(const ImuAction *act_info)
 {
-    lv_scr_load_anim_t anim_type = LV_SCR_LOAD_ANIM_FADE_ON;
+    apply_pending_updates();
+    if (live_stream_process())
+    {
+        return;
+    }
+    if (scrub_process(act_info))
+    {
+        return;
+    }
     if(print_file.size()>0)
     {
+        empty_shown = false;
         if (TURN_RIGHT == act_info->active)
         {
             if(act_info->active==pre_statu)
             {
                 if (doDelayMillisTime(1000, &run_data->pic_perMillis, false) == true)
                 {
-                    anim_type = LV_SCR_LOAD_ANIM_OVER_RIGHT;
                     current_file_index += 1;
                     current_file_index = (current_file_index % print_file.size());
                     current_file_name_index = 1;
@@ -286,7 +633,6 @@ void picture_process(const ImuAction *act_info)
             }
             else
             {
-                    anim_type = LV_SCR_LOAD_ANIM_OVER_RIGHT;
                     current_file_index += 1;
                     current_file_index = (current_file_index % print_file.size());
                     current_file_name_index = 1;
@@ -300,8 +646,7 @@ void picture_process(const ImuAction *act_info)
             {
                 if (doDelayMillisTime(1000, &run_data->pic_perMillis, false) == true)
                 {
-                    anim_type = LV_SCR_LOAD_ANIM_MOVE_LEFT;
-                    current_file_index -= 1;
+                        current_file_index -= 1;
                     current_file_index = ((current_file_index + print_file.size()) % print_file.size());
                     if(current_file_index<0)
                         current_file_index = 0;
@@ -310,7 +655,6 @@ void picture_process(const ImuAction *act_info)
             }
             else
             {
-                anim_type = LV_SCR_LOAD_ANIM_MOVE_LEFT;
                 current_file_index -= 1;
                 current_file_index = ((current_file_index + print_file.size()) % print_file.size());
                 if(current_file_index<0)
@@ -332,6 +676,8 @@ void picture_process(const ImuAction *act_info)
                 if (video_run_data->file.available())
                 {
                     // 播放一帧数据
+                    name_overlay_tick();
+                    MjpegPlayDocoder::m_bottom = print_hud_top();
                     video_run_data->player_docoder->video_play_screen();
                 }
                 
@@ -342,7 +688,7 @@ void picture_process(const ImuAction *act_info)
                 {
                     release_player_docoder();
                     video_run_data->file.close(); 
-                    cfg_data.switchInterval = 300;
+                    read_config(&cfg_data); // 恢复图片的播放间隔
                     tft->fillScreen(TFT_BLACK);
                     TJpgDec.setJpgScale(1);
                     TJpgDec.setCallback(tft_output);
@@ -354,10 +700,11 @@ void picture_process(const ImuAction *act_info)
                 if(current_file_name_index>11)
                     current_file_name_index = 1;
                 
-                TJpgDec.drawSdJpg(20, 20, display_full_name);
                 // init_piclabel();
                 String disp_name =  print_file[current_file_index].substring(1,print_file[current_file_index].length()) + ".gco";
-                display_piclabel(disp_name.c_str(),anim_type);
+                name_overlay_show(disp_name);
+                name_overlay_tick();
+                TJpgDec.drawSdJpg(20, 20, display_full_name);
                 pre_play_type = 0;
                 
             }
@@ -367,6 +714,18 @@ void picture_process(const ImuAction *act_info)
         }
         pre_statu = act_info->active;
     }
+    else if (!empty_shown)
+    {
+        // 提示图片直接从映射的flash解码，不经过文件系统
+        uint32_t jpg_size;
+        const uint8_t *jpg = asset_data(EMPTY_IMAGE, &jpg_size, ASSET_TYPE_JPEG);
+        if (NULL != jpg)
+        {
+            name_overlay_show("");
+            TJpgDec.drawJpg(20, 20, jpg, jpg_size);
+        }
+        empty_shown = true;
+    }
 
     if(pre_play_type)
         delay(15);
@@ -386,6 +745,8 @@ void picture_background_task(AppController *sys,
 int picture_exit_callback(void *param)
 {
     photo_gui_del();
+    name_overlay.clear();
+    name_overlay_text = "";
     // 释放文件名链表
     release_file_info(run_data->image_file);
     // 恢复此前的驱动参数
@@ -1,6 +1,7 @@
 #ifndef APP_PICTURE_H
 #define APP_PICTURE_H
 
+#include <Arduino.h>
 #include "sys/interface.h"
 
 #define IMAGE_PATH "/image"
@@ -8,5 +9,8 @@
 extern void picture_init();
 extern void picture_process(const ImuAction *act_info);
 extern void update_print_status(int pro, int head, int temp);
+extern void picture_request_rescan();
+extern void picture_touch_catalog();
+extern String picture_catalog_etag();
 
 #endif
\ No newline at end of file
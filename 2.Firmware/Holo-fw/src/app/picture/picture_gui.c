@@ -1,4 +1,5 @@
 #include "picture_gui.h"
+#include "print_hud.h"
 
 #include "driver/lv_port_indev.h"
 #include "lvgl.h"
@@ -8,14 +9,9 @@ lv_obj_t *image_scr = NULL;
 lv_obj_t *photo_image = NULL;
 lv_obj_t *photo_label = NULL;
 
-lv_obj_t *progress_label = NULL;
-lv_obj_t *head_temp_label = NULL;
-lv_obj_t *bed_temp_label = NULL;
-
 
 static lv_style_t default_style;
 static lv_style_t label_style;
-static lv_style_t print_style;
 
 LV_FONT_DECLARE(lv_font_montserrat_24);
 LV_FONT_DECLARE(lv_font_montserrat_14);
@@ -38,43 +34,8 @@ void photo_gui_init()
     lv_style_set_text_font(&label_style, &lv_font_montserrat_24);
 
 
-    lv_style_init(&print_style);
-    // lv_style_set_bg_color(&label_style, lv_color_hex(0x000000));
-    lv_style_set_text_opa(&print_style, LV_OPA_COVER);
-    lv_style_set_text_color(&print_style, lv_color_hex(0xffffff));
-    lv_style_set_text_font(&print_style, &lv_font_montserrat_16);
-
-#if 0 //用于显示打印信息的状态
-    photo_label = lv_label_create(image_scr);
-    lv_obj_add_style(photo_label, &label_style, LV_STATE_DEFAULT);
-    lv_label_set_long_mode(photo_label, LV_LABEL_LONG_SCROLL_CIRCULAR); 
-    lv_obj_set_width(photo_label, 120);
-    lv_obj_align(photo_label, LV_ALIGN_LEFT_MID, 0, 90);
-   
-
-    progress_label = lv_label_create(image_scr); 
-    lv_obj_add_style(progress_label, &label_style, LV_STATE_DEFAULT);
-    lv_label_set_long_mode(progress_label, LV_LABEL_LONG_WRAP); 
-    lv_label_set_recolor(progress_label, true);  
-    lv_obj_set_width(progress_label, 120);
-    lv_obj_align(progress_label, LV_ALIGN_RIGHT_MID, 0, 90);
-
-
-    head_temp_label = lv_label_create(image_scr); 
-    lv_obj_add_style(head_temp_label, &print_style, LV_STATE_DEFAULT);
-    lv_label_set_long_mode(head_temp_label, LV_LABEL_LONG_WRAP); 
-    lv_label_set_recolor(head_temp_label, true);  
-    lv_obj_set_width(head_temp_label, 120);
-    lv_obj_align(head_temp_label, LV_ALIGN_LEFT_MID, 0, 70);
-
-
-    bed_temp_label = lv_label_create(image_scr); 
-    lv_obj_add_style(bed_temp_label, &print_style, LV_STATE_DEFAULT);
-    lv_label_set_long_mode(bed_temp_label, LV_LABEL_LONG_WRAP); 
-    lv_label_set_recolor(bed_temp_label, true);  
-    lv_obj_set_width(bed_temp_label, 120);
-    lv_obj_align(bed_temp_label, LV_ALIGN_RIGHT_MID, 0, 70);
-#endif
+    // 打印状态栏（进度、温度），只重绘变化的字段
+    print_hud_create(image_scr, &lv_font_montserrat_16);
 
 
 #if 1
@@ -83,9 +44,10 @@ void photo_gui_init()
     lv_label_set_long_mode(photo_label, LV_LABEL_LONG_SCROLL_CIRCULAR); 
     lv_obj_set_width(photo_label, 200);
     lv_obj_align(photo_label, LV_ALIGN_CENTER, 0, 90);
+    // 模型名称改由 picture.cpp 叠加在解码出的图块上（label_overlay.h），标签保持为空
+    lv_label_set_text(photo_label, "");
 #endif
 
-    // display_print_status(0,1,1);
     lv_scr_load(image_scr);
 }
 
@@ -137,23 +99,13 @@ void display_piclabel(const char *content, lv_scr_load_anim_t anim_type)
 
 void display_print_status(int progress, int head_temp, int bed_temp)
 {
-    char cmd[48] = {0};
-
-    sprintf(cmd," #00ff00 Pro:#%d\%", progress);
-    lv_label_set_text(progress_label,cmd);
-    lv_event_send(progress_label,LV_EVENT_REFRESH,NULL);
-
-    sprintf(cmd," Head: #ff0000 %d#", head_temp);
-    lv_label_set_text(head_temp_label,cmd);
-    lv_event_send(head_temp_label,LV_EVENT_REFRESH,NULL);
-
-    sprintf(cmd," Bed: #ff0000 %d#", bed_temp);
-    lv_label_set_text(bed_temp_label,cmd);
-    lv_event_send(bed_temp_label,LV_EVENT_REFRESH,NULL);  
+    // 由 picture_process() 按 PRINT_HUD_INTERVAL 限速刷新
+    print_hud_set(progress, head_temp, bed_temp);
 }
 
 void photo_gui_del(void)
 {
+    print_hud_delete();
     if (NULL != photo_image)
     {
         lv_obj_clean(photo_image); // 清空此前页面
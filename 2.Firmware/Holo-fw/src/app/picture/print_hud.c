@@ -0,0 +1,133 @@
+#include "print_hud.h"
+
+#include "stdio.h"
+
+static lv_obj_t *hud_bar = NULL;
+static lv_obj_t *hud_field[PRINT_HUD_FIELDS] = {NULL};
+static int hud_shown[PRINT_HUD_FIELDS];   // 标签上当前的数值
+static int hud_pending[PRINT_HUD_FIELDS]; // print_hud_set() 收到的最新数值
+static bool hud_has_pending = false;
+static bool hud_has_shown = false;
+static uint32_t hud_refresh_ms = 0;
+static lv_style_t hud_style;
+
+static const char *const hud_format[PRINT_HUD_FIELDS] = {
+    "#00ff00 Pro:# %d%%",
+    "Head: #ff0000 %d#",
+    "Bed: #ff0000 %d#",
+};
+static const lv_align_t hud_align[PRINT_HUD_FIELDS] = {
+    LV_ALIGN_LEFT_MID,
+    LV_ALIGN_CENTER,
+    LV_ALIGN_RIGHT_MID,
+};
+
+void print_hud_create(lv_obj_t *parent, const lv_font_t *font)
+{
+    print_hud_delete();
+
+    lv_style_init(&hud_style);
+    lv_style_set_bg_color(&hud_style, lv_color_hex(0x000000));
+    lv_style_set_bg_opa(&hud_style, LV_OPA_COVER);
+    lv_style_set_border_width(&hud_style, 0);
+    lv_style_set_radius(&hud_style, 0);
+    lv_style_set_pad_all(&hud_style, 0);
+    lv_style_set_text_color(&hud_style, lv_color_hex(0xffffff));
+    lv_style_set_text_font(&hud_style, font);
+
+    hud_bar = lv_obj_create(parent);
+    // 不用主题的样式（阴影、滚动条等会扩大重绘的区域）
+    // 状态栏始终存在（空的时候与黑色背景相同），而不是先隐藏再显示：
+    // LVGL 会把对象的重绘区域向外扩大几个像素，显示整个状态栏时会波及上方的图片，
+    // 而标签的重绘区域会被裁剪在状态栏之内（见下面的 row）
+    lv_obj_remove_style_all(hud_bar);
+    lv_obj_add_style(hud_bar, &hud_style, LV_STATE_DEFAULT);
+    lv_obj_clear_flag(hud_bar, LV_OBJ_FLAG_SCROLLABLE | LV_OBJ_FLAG_CLICKABLE);
+    lv_obj_set_size(hud_bar, lv_pct(100), PRINT_HUD_MARGIN + PRINT_HUD_HEIGHT);
+    lv_obj_align(hud_bar, LV_ALIGN_BOTTOM_MID, 0, 0);
+
+    // 标签放在状态栏底部的一行里：子对象的重绘区域被裁剪到父对象外扩 5 像素的范围，
+    // 这一行比状态栏的上沿低 PRINT_HUD_MARGIN，标签的重绘区域（连同标签自身的外扩）就不会超出状态栏
+    lv_obj_t *row = lv_obj_create(hud_bar);
+    lv_obj_remove_style_all(row);
+    lv_obj_clear_flag(row, LV_OBJ_FLAG_SCROLLABLE | LV_OBJ_FLAG_CLICKABLE);
+    lv_obj_set_size(row, lv_pct(100), PRINT_HUD_HEIGHT);
+    lv_obj_align(row, LV_ALIGN_BOTTOM_MID, 0, 0);
+
+    for (int i = 0; i < PRINT_HUD_FIELDS; ++i)
+    {
+        // 固定大小：文字变化时不会引起重新布局，只重绘这一个标签
+        hud_field[i] = lv_label_create(row);
+        lv_label_set_long_mode(hud_field[i], LV_LABEL_LONG_CLIP);
+        lv_label_set_recolor(hud_field[i], true);
+        lv_label_set_text_static(hud_field[i], "");
+        lv_obj_set_style_text_align(hud_field[i], LV_TEXT_ALIGN_CENTER, 0);
+        lv_obj_set_size(hud_field[i], lv_pct(33), PRINT_HUD_HEIGHT);
+        lv_obj_align(hud_field[i], hud_align[i], 0, 0);
+    }
+    lv_obj_update_layout(hud_bar);
+
+    hud_has_pending = false;
+    hud_has_shown = false;
+}
+
+void print_hud_delete(void)
+{
+    if (NULL != hud_bar)
+    {
+        lv_obj_del(hud_bar);
+        hud_bar = NULL;
+        lv_style_reset(&hud_style);
+    }
+    for (int i = 0; i < PRINT_HUD_FIELDS; ++i)
+    {
+        hud_field[i] = NULL;
+    }
+}
+
+void print_hud_set(int progress, int head_temp, int bed_temp)
+{
+    hud_pending[0] = progress;
+    hud_pending[1] = head_temp;
+    hud_pending[2] = bed_temp;
+    hud_has_pending = true;
+}
+
+int print_hud_refresh(uint32_t now_ms)
+{
+    if (NULL == hud_bar || !hud_has_pending)
+    {
+        return 0;
+    }
+    if (hud_has_shown && now_ms - hud_refresh_ms < PRINT_HUD_INTERVAL)
+    {
+        return 0;
+    }
+    hud_has_pending = false;
+    hud_refresh_ms = now_ms;
+
+    int rendered = 0;
+    char text[32];
+    for (int i = 0; i < PRINT_HUD_FIELDS; ++i)
+    {
+        if (hud_has_shown && hud_shown[i] == hud_pending[i])
+        {
+            continue;
+        }
+        hud_shown[i] = hud_pending[i];
+        snprintf(text, sizeof(text), hud_format[i], hud_shown[i]);
+        lv_label_set_text(hud_field[i], text);
+        ++rendered;
+    }
+    hud_has_shown = true;
+    return rendered;
+}
+
+lv_coord_t print_hud_top(void)
+{
+    if (NULL == hud_bar || !hud_has_shown)
+    {
+        return lv_disp_get_ver_res(NULL);
+    }
+    return hud_bar->coords.y1;
+}
@@ -0,0 +1,34 @@
+#ifndef APP_PICTURE_PRINT_HUD_H
+#define APP_PICTURE_PRINT_HUD_H
+
+// 屏幕底部的打印状态栏（进度、喷头温度、热床温度）
+// 每个字段是固定大小的标签，只有数值变化的字段才重新设置文字，LVGL只重绘该标签的区域；
+// 收到第一次状态后图片/视频的图块不再推送到它所在的行（见 print_hud_top()），底部这一条由LVGL独占
+#define PRINT_HUD_HEIGHT 20     // 文字行的高度（像素）
+// LVGL 把每个重绘区域向外扩大 5 像素（lv_obj_get_transformed_area() 的安全余量），
+// 状态栏在文字行上方多留这么高，标签的重绘区域就不会超出状态栏、波及上方的图片
+#define PRINT_HUD_MARGIN 5
+#define PRINT_HUD_INTERVAL 1000 // 两次刷新之间的最小间隔 ms，期间到达的数值只保留最新的
+#define PRINT_HUD_FIELDS 3
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include "lvgl.h"
+
+    void print_hud_create(lv_obj_t *parent, const lv_font_t *font);
+    void print_hud_delete(void);
+    // 记录最新的状态，由 print_hud_refresh() 显示
+    void print_hud_set(int progress, int head_temp, int bed_temp);
+    // 距上次刷新超过 PRINT_HUD_INTERVAL 时写入变化的字段，返回重新渲染的字段数
+    int print_hud_refresh(uint32_t now_ms);
+    // 收到过状态时返回状态栏的上沿（包括 PRINT_HUD_MARGIN），否则返回屏幕高度
+    lv_coord_t print_hud_top(void);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif
@@ -0,0 +1,97 @@
+#include "turntable.h"
+
+#include <math.h>
+
+#define TURNTABLE_PI 3.14159265f
+#define TURNTABLE_RAD_TO_DEG (180.0f / TURNTABLE_PI)
+
+// 一阶低通的系数：截止频率cutoff（Hz），采样间隔dt（s）
+static float smoothing_alpha(float cutoff, float dt)
+{
+    float tau = 1.0f / (2 * TURNTABLE_PI * cutoff);
+    return 1.0f / (1.0f + tau / dt);
+}
+
+TurntableScrub::TurntableScrub()
+{
+    begin(1, 360, TURNTABLE_YAW);
+}
+
+void TurntableScrub::begin(int frames, float degrees, TURNTABLE_AXIS axis)
+{
+    m_frames = frames > 0 ? frames : 1;
+    m_frame_degrees = degrees / m_frames;
+    m_axis = axis;
+    m_primed = false;
+    m_unwrapped = 0;
+    m_filtered = 0;
+    m_speed = 0;
+    m_step = 0;
+}
+
+float TurntableScrub::axisAngle(const float q[4], TURNTABLE_AXIS axis)
+{
+    float w = q[0], x = q[1], y = q[2], z = q[3];
+    switch (axis)
+    {
+    case TURNTABLE_ROLL:
+        return atan2f(2 * (w * x + y * z), 1 - 2 * (x * x + y * y)) * TURNTABLE_RAD_TO_DEG;
+    case TURNTABLE_PITCH:
+    {
+        float s = 2 * (w * y - z * x);
+        s = s > 1 ? 1 : (s < -1 ? -1 : s);
+        return asinf(s) * TURNTABLE_RAD_TO_DEG;
+    }
+    default:
+        return atan2f(2 * (w * z + x * y), 1 - 2 * (y * y + z * z)) * TURNTABLE_RAD_TO_DEG;
+    }
+}
+
+int TurntableScrub::update(const float q[4], uint32_t ms)
+{
+    float raw = axisAngle(q, m_axis);
+    if (!m_primed)
+    {
+        m_primed = true;
+        m_last_raw = raw;
+        m_last_ms = ms;
+        return frame();
+    }
+
+    // 跨过±180°时展开，保证角度连续
+    float delta = raw - m_last_raw;
+    if (delta > 180)
+    {
+        delta -= 360;
+    }
+    else if (delta < -180)
+    {
+        delta += 360;
+    }
+    m_last_raw = raw;
+    m_unwrapped += delta;
+
+    float dt = (ms - m_last_ms) / 1000.0f;
+    m_last_ms = ms;
+    if (dt <= 0)
+    {
+        dt = 0.001f;
+    }
+    float speed = (m_unwrapped - m_filtered) / dt;
+    m_speed += smoothing_alpha(TURNTABLE_D_CUTOFF, dt) * (speed - m_speed);
+    float cutoff = TURNTABLE_MIN_CUTOFF + TURNTABLE_BETA * fabsf(m_speed);
+    m_filtered += smoothing_alpha(cutoff, dt) * (m_unwrapped - m_filtered);
+
+    // 越过当前帧的边界（加上滞回）才换帧
+    float position = m_filtered / m_frame_degrees;
+    if (position > m_step + 0.5f + TURNTABLE_HYSTERESIS || position < m_step - 0.5f - TURNTABLE_HYSTERESIS)
+    {
+        m_step = (int32_t)floorf(position + 0.5f);
+    }
+    return frame();
+}
+
+int TurntableScrub::frame() const
+{
+    return ((m_step % m_frames) + m_frames) % m_frames;
+}
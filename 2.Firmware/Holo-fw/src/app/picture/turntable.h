@@ -0,0 +1,51 @@
+#ifndef TURNTABLE_H
+#define TURNTABLE_H
+
+#include <stdint.h>
+
+// 转台模式：把设备的姿态（DMP输出的四元数）映射为模型序列中的帧号，转动设备即转动模型
+// 只依赖标准头文件，可在PC上编译（见 tools/scrub_replay.cpp）
+//
+// 角度先经过 One Euro 滤波：慢速转动时截止频率低、画面稳定，
+// 快速转动时截止频率随角速度升高、延迟小；帧边界再加滞回避免在两帧之间来回跳
+#define TURNTABLE_MIN_CUTOFF 1.0f // 静止时的截止频率（Hz）
+#define TURNTABLE_BETA 0.02f      // 截止频率随角速度（度/秒）增加的系数
+#define TURNTABLE_D_CUTOFF 1.0f   // 角速度估计的截止频率（Hz）
+#define TURNTABLE_HYSTERESIS 0.2f // 帧边界的滞回（帧宽的比例）
+
+enum TURNTABLE_AXIS : unsigned char
+{
+    TURNTABLE_YAW = 0, // 绕竖直轴转动（放在桌面上旋转）
+    TURNTABLE_ROLL,    // 左右倾斜
+    TURNTABLE_PITCH    // 前后倾斜
+};
+
+class TurntableScrub
+{
+private:
+    int m_frames;
+    float m_frame_degrees; // 每帧对应的角度
+    TURNTABLE_AXIS m_axis;
+
+    bool m_primed;
+    uint32_t m_last_ms;
+    float m_last_raw;  // 上一次的原始角度（-180~180）
+    float m_unwrapped; // 展开后的连续角度，相对进入转台模式时的姿态
+    float m_filtered;
+    float m_speed; // 滤波后的角速度（度/秒）
+    int32_t m_step; // 当前帧（未取模，可为负）
+
+public:
+    TurntableScrub();
+    // frames: 序列的帧数；degrees: 转过多少度走完整个序列；以调用后的第一个姿态为起点
+    void begin(int frames, float degrees, TURNTABLE_AXIS axis);
+    // q: w, x, y, z；ms: 采样时间。返回应显示的帧（0 ~ frames-1）
+    int update(const float q[4], uint32_t ms);
+    int frame() const;
+    float angle() const { return m_filtered; } // 滤波后的相对角度（度）
+    float speed() const { return m_speed; }
+
+    static float axisAngle(const float q[4], TURNTABLE_AXIS axis);
+};
+
+#endif
@@ -6,7 +6,7 @@ SdCard tf;
 Pixel rgb;
 // Config g_cfg;       // 全局配置文件
 Network g_network;  // 网络连接
-FlashFS g_flashCfg; // flash中的文件系统（替代原先的Preferences）
+FlashFS g_flashCfg; // flash中的文件系统（设置已移到 sys/settings.h）
 Display screen;     // 屏幕对象
 Ambient ambLight;   // 光线传感器对象
 
@@ -21,7 +21,7 @@ extern SdCard tf;
 extern Pixel rgb;
 // extern Config g_cfg;       // 全局配置文件
 extern Network g_network;  // 网络连接
-extern FlashFS g_flashCfg; // flash中的文件系统（替代原先的Preferences）
+extern FlashFS g_flashCfg; // flash中的文件系统（设置已移到 sys/settings.h）
 extern Display screen;     // 屏幕对象
 extern Ambient ambLight;   // 光纤传感器对象
 
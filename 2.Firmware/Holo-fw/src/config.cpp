@@ -2,38 +2,28 @@
 #include "common.h"
 #include "config.h"
 
-Preferences prefs;        // 声明Preferences对象
-
 void config_read(const char *file_path, Config *cfg)
 {
     // cfg->ssid = tf.readFileLine(file_path, 1);        // line-1 for WiFi ssid
     // cfg->password = tf.readFileLine(file_path, 2);    // line-2 for WiFi password
     // return cfg->ssid+cfg->password+cfg->cityname+cfg->language+cfg->weather_key;
 
-    prefs.begin("sys"); // 打开命名空间mynamespace
-    cfg->backLight = prefs.getUChar("backLight", 80);
-    cfg->rotation = prefs.getUChar("rotation", 4);
-    cfg->auto_calibration_mpu = prefs.getUChar("auto_mpu", 1);
-    cfg->mpu_order = prefs.getUChar("mpu_order", 0);
-    cfg->ssid = prefs.getString("ssid", "");
-    cfg->password = prefs.getString("password", "");
-    prefs.end(); // 关闭当前命名空间
-
-    prefs.begin("zhixin"); // 打开命名空间mynamespace
-    cfg->cityname = prefs.getString("cityname", "BeiJing");
-    cfg->language = prefs.getString("language", "zh-Hans");
-    cfg->weather_key = prefs.getString("weather_key", "");
-    prefs.end(); // 关闭当前命名空间
-
-    prefs.begin("tianqi"); // 打开命名空间mynamespace
-    cfg->tianqi_appid = prefs.getString("tianqi_aid", "");
-    cfg->tianqi_appsecret = prefs.getString("tianqi_as", "");
-    cfg->tianqi_addr = prefs.getString("tianqi_addr", "北京");
-    prefs.end(); // 关闭当前命名空间
-
-    prefs.begin("other"); // 打开命名空间mynamespace
-    cfg->bili_uid = prefs.getString("bili_uid", "");
-    prefs.end(); // 关闭当前命名空间
+    cfg->backLight = settings_get_u32("sys.backLight", 80);
+    cfg->rotation = settings_get_u32("sys.rotation", 4);
+    cfg->auto_calibration_mpu = settings_get_u32("sys.auto_mpu", 1);
+    cfg->mpu_order = settings_get_u32("sys.mpu_order", 0);
+    cfg->ssid = settings_get_str("sys.ssid", "");
+    cfg->password = settings_get_str("sys.password", "");
+
+    cfg->cityname = settings_get_str("zhixin.cityname", "BeiJing");
+    cfg->language = settings_get_str("zhixin.language", "zh-Hans");
+    cfg->weather_key = settings_get_str("zhixin.weather_key", "");
+
+    cfg->tianqi_appid = settings_get_str("tianqi.tianqi_aid", "");
+    cfg->tianqi_appsecret = settings_get_str("tianqi.tianqi_as", "");
+    cfg->tianqi_addr = settings_get_str("tianqi.tianqi_addr", "北京");
+
+    cfg->bili_uid = settings_get_str("other.bili_uid", "");
 
     // if (0 == cfg->auto_calibration_mpu)
     // {
@@ -88,30 +78,22 @@ void config_save(const char *file_path, Config *cfg)
     // tf.deleteFile(file_path);
     // tf.writeFile(file_path, res.c_str());
 
-    prefs.begin("sys"); // 打开命名空间mynamespace
-    prefs.putUChar("backLight", cfg->backLight);
-    prefs.putUChar("rotation", cfg->rotation);
-    prefs.putUChar("auto_mpu", cfg->auto_calibration_mpu);
-    prefs.putUChar("mpu_order", cfg->mpu_order);
-    prefs.putString("ssid", cfg->ssid);
-    prefs.putString("password", cfg->password);
-    prefs.end(); // 关闭当前命名空间
-
-    prefs.begin("zhixin"); // 打开命名空间mynamespace
-    prefs.putString("cityname", cfg->cityname);
-    prefs.putString("language", cfg->language);
-    prefs.putString("weather_key", cfg->weather_key);
-    prefs.end(); // 关闭当前命名空间
-
-    prefs.begin("tianqi"); // 打开命名空间mynamespace
-    prefs.putString("tianqi_aid", cfg->tianqi_appid);
-    prefs.putString("tianqi_as", cfg->tianqi_appsecret);
-    prefs.putString("tianqi_addr", cfg->tianqi_addr);
-    prefs.end(); // 关闭当前命名空间
-
-    prefs.begin("other"); // 打开命名空间mynamespace
-    prefs.putString("bili_uid", cfg->bili_uid);
-    prefs.end(); // 关闭当前命名空间
+    settings_set_u32("sys.backLight", cfg->backLight);
+    settings_set_u32("sys.rotation", cfg->rotation);
+    settings_set_u32("sys.auto_mpu", cfg->auto_calibration_mpu);
+    settings_set_u32("sys.mpu_order", cfg->mpu_order);
+    settings_set_str("sys.ssid", cfg->ssid.c_str());
+    settings_set_str("sys.password", cfg->password.c_str());
+
+    settings_set_str("zhixin.cityname", cfg->cityname.c_str());
+    settings_set_str("zhixin.language", cfg->language.c_str());
+    settings_set_str("zhixin.weather_key", cfg->weather_key.c_str());
+
+    settings_set_str("tianqi.tianqi_aid", cfg->tianqi_appid.c_str());
+    settings_set_str("tianqi.tianqi_as", cfg->tianqi_appsecret.c_str());
+    settings_set_str("tianqi.tianqi_addr", cfg->tianqi_addr.c_str());
+
+    settings_set_str("other.bili_uid", cfg->bili_uid.c_str());
 
     // config_read("/wifi.txt", &g_cfg);
     // // 立即更改屏幕方向
@@ -123,25 +105,20 @@ void config_save(const char *file_path, Config *cfg)
 void mpu_config_read(const char *file_path, Config *cfg)
 {
 
-    prefs.begin("MPU_Config"); // 打开命名空间mynamespace
-    cfg->mpu_config.x_gyro_offset = prefs.getInt("x_gyro_offset", 0);
-    cfg->mpu_config.y_gyro_offset = prefs.getInt("y_gyro_offset", 0);
-    cfg->mpu_config.z_gyro_offset = prefs.getInt("z_gyro_offset", 0);
-    cfg->mpu_config.x_accel_offset = prefs.getInt("x_accel_offset", 0);
-    cfg->mpu_config.y_accel_offset = prefs.getInt("y_accel_offset", 0);
-    cfg->mpu_config.z_accel_offset = prefs.getInt("z_accel_offset", 0);
-    prefs.end(); // 关闭当前命名空间
+    cfg->mpu_config.x_gyro_offset = settings_get_i32(IMU_CALI_PREFIX "x_gyro", 0);
+    cfg->mpu_config.y_gyro_offset = settings_get_i32(IMU_CALI_PREFIX "y_gyro", 0);
+    cfg->mpu_config.z_gyro_offset = settings_get_i32(IMU_CALI_PREFIX "z_gyro", 0);
+    cfg->mpu_config.x_accel_offset = settings_get_i32(IMU_CALI_PREFIX "x_accel", 0);
+    cfg->mpu_config.y_accel_offset = settings_get_i32(IMU_CALI_PREFIX "y_accel", 0);
+    cfg->mpu_config.z_accel_offset = settings_get_i32(IMU_CALI_PREFIX "z_accel", 0);
 }
 
 void mpu_config_save(const char *file_path, Config *cfg)
 {
-    prefs.begin("MPU_Config"); // 打开命名空间mynamespace
-    prefs.putInt("x_gyro_offset", cfg->mpu_config.x_gyro_offset);
-    prefs.putInt("y_gyro_offset", cfg->mpu_config.y_gyro_offset);
-    prefs.putInt("z_gyro_offset", cfg->mpu_config.z_gyro_offset);
-    prefs.putInt("x_accel_offset", cfg->mpu_config.x_accel_offset);
-    prefs.putInt("y_accel_offset", cfg->mpu_config.y_accel_offset);
-    prefs.putInt("z_accel_offset", cfg->mpu_config.z_accel_offset);
-
-    prefs.end(); // 关闭当前命名空间
+    settings_set_i32(IMU_CALI_PREFIX "x_gyro", cfg->mpu_config.x_gyro_offset);
+    settings_set_i32(IMU_CALI_PREFIX "y_gyro", cfg->mpu_config.y_gyro_offset);
+    settings_set_i32(IMU_CALI_PREFIX "z_gyro", cfg->mpu_config.z_gyro_offset);
+    settings_set_i32(IMU_CALI_PREFIX "x_accel", cfg->mpu_config.x_accel_offset);
+    settings_set_i32(IMU_CALI_PREFIX "y_accel", cfg->mpu_config.y_accel_offset);
+    settings_set_i32(IMU_CALI_PREFIX "z_accel", cfg->mpu_config.z_accel_offset);
 }
\ No newline at end of file
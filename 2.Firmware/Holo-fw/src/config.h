@@ -1,9 +1,7 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 #include <WString.h>
-#include <Preferences.h>
-
-extern Preferences prefs;       // 声明Preferences对象
+#include "sys/settings.h" // 各项保存在设置中，键名为原先的 "命名空间.键名"，陀螺仪校准与IMU共用 "imu.*"
 
 struct MPU_Config
 {
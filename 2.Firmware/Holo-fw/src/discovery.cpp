@@ -0,0 +1,167 @@
+#include "discovery.h"
+#include "common.h"
+#include "app/picture/picture.h"
+
+#include <WiFi.h>
+#include <ESPmDNS.h>
+#include <lwip/sockets.h>
+
+struct DiscoveryInfo
+{
+    char name[32];
+    char name_json[64];   // 转义后写入JSON回复的名称
+    char host[24];        // mDNS主机名（不含 .local）
+    char gen[24];         // 与 /list 的ETag相同（不含引号）
+    uint32_t free_kb;
+    unsigned long free_millis; // 上次统计剩余空间的时间
+    bool free_stale;           // 文件列表变化后尚未重新统计
+};
+
+static DiscoveryInfo info;
+static int discovery_fd = -1;
+
+// 文件列表的代号只是比较字符串，每次回复前更新
+static bool refresh_gen()
+{
+    String etag = picture_catalog_etag();
+    String gen = etag.substring(1, etag.length() - 1);
+    if (!strcmp(gen.c_str(), info.gen))
+    {
+        return false;
+    }
+    snprintf(info.gen, sizeof(info.gen), "%s", gen.c_str());
+    info.free_stale = true;
+    return true;
+}
+
+// 剩余空间需要遍历FAT表，只在文件列表变化或超过刷新间隔时重新统计，
+// 且放在回复发出之后，回复中使用上次统计的结果
+static bool refresh_free()
+{
+    if (!info.free_stale && millis() - info.free_millis < DISCOVERY_FREE_REFRESH)
+    {
+        return false;
+    }
+    info.free_kb = (uint32_t)((SD.totalBytes() - SD.usedBytes()) >> 10);
+    info.free_millis = millis();
+    info.free_stale = false;
+    return true;
+}
+
+// 设备名称来自用户的配置文件，写入JSON前转义引号、反斜杠和控制字符
+static void escape_name(char *out, size_t size, const char *name)
+{
+    size_t len = 0;
+    for (; *name && len + 2 < size; ++name)
+    {
+        unsigned char ch = (unsigned char)*name;
+        if ('"' == ch || '\\' == ch)
+        {
+            out[len++] = '\\';
+            out[len++] = ch;
+        }
+        else
+        {
+            out[len++] = ch < 0x20 ? ' ' : ch;
+        }
+    }
+    out[len] = 0;
+}
+
+static void update_mdns_txt()
+{
+    char free_kb[12];
+    snprintf(free_kb, sizeof(free_kb), "%u", (unsigned)info.free_kb);
+    MDNS.addServiceTxt(DISCOVERY_MDNS_SERVICE, "_tcp", "free_kb", free_kb);
+    MDNS.addServiceTxt(DISCOVERY_MDNS_SERVICE, "_tcp", "gen", info.gen);
+}
+
+static int build_reply(char *buf, size_t size)
+{
+    return snprintf(buf, size,
+                    "{\"name\":\"%s\",\"host\":\"%s.local\",\"ip\":\"%s\","
+                    "\"version\":\"" AIO_VERSION "\",\"http\":%d,\"free_kb\":%u,\"gen\":\"%s\"}",
+                    info.name_json, info.host, WiFi.localIP().toString().c_str(),
+                    DISCOVERY_HTTP_PORT, (unsigned)info.free_kb, info.gen);
+}
+
+static void discovery_task(void *param)
+{
+    char rx[16];
+    char reply[DISCOVERY_REPLY_SIZE];
+    while (true)
+    {
+        struct sockaddr_in from;
+        socklen_t from_len = sizeof(from);
+        int len = recvfrom(discovery_fd, rx, sizeof(rx), 0, (struct sockaddr *)&from, &from_len);
+        bool changed = refresh_gen();
+        if (len >= (int)strlen(DISCOVERY_PROBE) && !memcmp(rx, DISCOVERY_PROBE, strlen(DISCOVERY_PROBE)))
+        {
+            int reply_len = build_reply(reply, sizeof(reply));
+            if (reply_len > 0 && reply_len < (int)sizeof(reply))
+            {
+                sendto(discovery_fd, reply, reply_len, 0, (struct sockaddr *)&from, from_len);
+            }
+        }
+        if (refresh_free() || changed)
+        {
+            update_mdns_txt();
+        }
+    }
+}
+
+bool discovery_init(const char *device_name)
+{
+    uint8_t mac[6];
+    WiFi.macAddress(mac);
+    snprintf(info.host, sizeof(info.host), "holo-%02x%02x%02x", mac[3], mac[4], mac[5]);
+    snprintf(info.name, sizeof(info.name), "%s", (NULL != device_name && *device_name) ? device_name : info.host);
+    escape_name(info.name_json, sizeof(info.name_json), info.name);
+    info.gen[0] = 0;
+    refresh_gen();
+    refresh_free();
+
+    if (MDNS.begin(info.host))
+    {
+        MDNS.setInstanceName(info.name);
+        MDNS.addService("_http", "_tcp", DISCOVERY_HTTP_PORT);
+        MDNS.addService(DISCOVERY_MDNS_SERVICE, "_tcp", DISCOVERY_HTTP_PORT);
+        MDNS.addServiceTxt(DISCOVERY_MDNS_SERVICE, "_tcp", "name", info.name);
+        MDNS.addServiceTxt(DISCOVERY_MDNS_SERVICE, "_tcp", "version", AIO_VERSION);
+        update_mdns_txt();
+        Serial.printf("MDNS responder started: %s.local\n", info.host);
+    }
+    else
+    {
+        Serial.println(F("Error setting up MDNS responder!"));
+    }
+
+    discovery_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (discovery_fd < 0)
+    {
+        Serial.println(F("Discovery: socket failed"));
+        return false;
+    }
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(DISCOVERY_PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(discovery_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        Serial.println(F("Discovery: bind failed"));
+        close(discovery_fd);
+        discovery_fd = -1;
+        return false;
+    }
+    // 超时返回以便定期刷新mDNS的TXT记录
+    struct timeval tv;
+    tv.tv_sec = DISCOVERY_POLL_TIMEOUT / 1000;
+    tv.tv_usec = (DISCOVERY_POLL_TIMEOUT % 1000) * 1000;
+    setsockopt(discovery_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    xTaskCreatePinnedToCore(discovery_task, "discovery", DISCOVERY_TASK_STACK_SIZE, NULL,
+                            DISCOVERY_TASK_PRIORITY, NULL, DISCOVERY_TASK_CORE);
+    Serial.printf("Discovery listening on udp %d\n", DISCOVERY_PORT);
+    return true;
+}
@@ -0,0 +1,26 @@
+#ifndef DISCOVERY_H
+#define DISCOVERY_H
+
+#include <Arduino.h>
+
+// 局域网设备发现：
+//   1. UDP广播探测：客户端向 DISCOVERY_PORT 广播 DISCOVERY_PROBE，设备单播回复一个JSON包
+//   2. mDNS服务：_holo._tcp，TXT记录中携带相同的信息
+#define DISCOVERY_PORT 50505
+#define DISCOVERY_PROBE "HOLO?"
+#define DISCOVERY_MDNS_SERVICE "_holo"
+#define DISCOVERY_HTTP_PORT 80
+#define DISCOVERY_REPLY_SIZE 320
+
+#define DISCOVERY_POLL_TIMEOUT 1000    // 无探测包时检查一次状态变化（ms）
+#define DISCOVERY_FREE_REFRESH 60000   // SD卡剩余空间的最长刷新间隔（ms）
+
+#define DISCOVERY_TASK_STACK_SIZE 3072
+#define DISCOVERY_TASK_PRIORITY 1
+#define DISCOVERY_TASK_CORE 0
+
+// 在WiFi启动（lwIP初始化）之后调用，不必等待连接成功：
+// 套接字绑定在 INADDR_ANY，mDNS在取得IP后自动开始应答
+bool discovery_init(const char *device_name);
+
+#endif
@@ -26,31 +26,51 @@ void Ambient::init(int mode)
     Wire.endTransmission();
 }
 
-unsigned int Ambient::getLux()
+static void ambient_bus_job(void *param)
 {
-    if (millis() - last_time > sample_time)
-    {
-        last_time = millis();
-        Wire.requestFrom(ADDRESS_BH1750FVI, 2); //ask Arduino to read back 2 bytes from the sensor
-        highByte = Wire.read();                 // get the high byte
-        lowByte = Wire.read();                  // get the low byte
+    ((Ambient *)param)->poll();
+}
 
-        sensorOut = (highByte << 8) | lowByte;
-        illuminance = sensorOut / 1.2;
+bool Ambient::startSampling()
+{
+    // 光感不急，让MPU6050优先使用总线
+    return i2c_bus_add("ambient", ambient_bus_job, this, sample_time, I2C_PRIORITY_LOW) >= 0;
+}
 
-        for (int i = 4; i > 0; i--)
-            lux[i] = lux[i - 1];
-        lux[0] = illuminance;
+void Ambient::poll()
+{
+    Wire.requestFrom(ADDRESS_BH1750FVI, 2); //ask Arduino to read back 2 bytes from the sensor
+    highByte = Wire.read();                 // get the high byte
+    lowByte = Wire.read();                  // get the low byte
 
-        Wire.beginTransmission(ADDRESS_BH1750FVI); //"notify" the matching device
-        Wire.write(mMode);                         //set operation mode
-        Wire.endTransmission();
-    }
+    sensorOut = (highByte << 8) | lowByte;
+    illuminance = sensorOut / 1.2;
+
+    for (int i = 4; i > 0; i--)
+        lux[i] = lux[i - 1];
+    lux[0] = illuminance;
+
+    Wire.beginTransmission(ADDRESS_BH1750FVI); //"notify" the matching device
+    Wire.write(mMode);                         //set operation mode
+    Wire.endTransmission();
 
     unsigned int avg = 0;
     for (int i = 4; i >= 0; i--)
         avg += lux[i];
     avg /= 5;
+    avg_lux.write(avg);
+}
+
+unsigned int Ambient::getLux()
+{
+    // 总线任务未启动时（初始化阶段）仍在调用者的任务中读取
+    if (!i2c_bus_running() && millis() - last_time > sample_time)
+    {
+        last_time = millis();
+        poll();
+    }
 
+    unsigned int avg = 0;
+    avg_lux.read(&avg);
     return avg;
 }
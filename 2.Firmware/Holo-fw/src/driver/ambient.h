@@ -2,6 +2,7 @@
 #define AMBIENT_H
 
 #include <Wire.h>
+#include "i2c_bus.h"
 
 #define ADDRESS_BH1750FVI 0x23           //ADDR="L" for this module
 #define ONE_TIME_H_RESOLUTION_MODE 0x20  // 1lux for 120ms
@@ -18,11 +19,15 @@ private:
     unsigned int illuminance = 0;
 
     unsigned int lux[5];
-    long sample_time = 125;
-    long last_time;
+    unsigned long sample_time = 125;
+    unsigned long last_time;
+    Snapshot<unsigned int> avg_lux; // 最近5次的平均值，总线任务写入
 
 public:
     void init(int mode);
+    // 之后由I2C总线任务按测量周期读取，getLux() 不再访问总线
+    bool startSampling();
+    void poll(); // 读取一次测量结果并开始下一次测量
     unsigned int getLux();
 };
 
@@ -0,0 +1,111 @@
+#include "assets.h"
+#include "lv_font_stream.h"
+
+#include <Arduino.h>
+#include <esp_partition.h>
+
+static AssetPack pack;
+static spi_flash_mmap_handle_t map_handle;
+// 按索引位置保存已创建的图片描述和字体
+static lv_img_dsc_t **img_dscs = NULL;
+static lv_font_t **fonts = NULL;
+
+bool assets_init()
+{
+    const esp_partition_t *partition = esp_partition_find_first(
+        ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)ASSETS_PARTITION_SUBTYPE, ASSETS_PARTITION);
+    if (NULL == partition)
+    {
+        Serial.println(F("Assets: partition " ASSETS_PARTITION " not found"));
+        return false;
+    }
+    // 只映射，不读取：索引之外的数据在使用时才经过flash cache
+    const void *map = NULL;
+    if (ESP_OK != esp_partition_mmap(partition, 0, partition->size, SPI_FLASH_MMAP_DATA, &map, &map_handle))
+    {
+        Serial.println(F("Assets: mmap failed"));
+        return false;
+    }
+    unsigned long start = micros();
+    if (!pack.open((const uint8_t *)map, partition->size))
+    {
+        spi_flash_munmap(map_handle);
+        Serial.println(F("Assets: no valid image in partition"));
+        return false;
+    }
+    img_dscs = (lv_img_dsc_t **)calloc(pack.count(), sizeof(lv_img_dsc_t *));
+    fonts = (lv_font_t **)calloc(pack.count(), sizeof(lv_font_t *));
+    if (NULL == img_dscs || NULL == fonts)
+    {
+        pack.close();
+        return false;
+    }
+    Serial.printf("Assets: %u entries, %u bytes in %lu us\n", pack.count(), pack.imageSize(), micros() - start);
+    return true;
+}
+
+const uint8_t *asset_data(const char *name, uint32_t *size, uint8_t type)
+{
+    Asset asset;
+    if (!pack.find(name, &asset, type))
+    {
+        return NULL;
+    }
+    if (NULL != size)
+    {
+        *size = asset.size;
+    }
+    return asset.data;
+}
+
+const lv_img_dsc_t *asset_img(const char *name)
+{
+    int index = pack.indexOf(name);
+    if (index < 0)
+    {
+        return NULL;
+    }
+    if (NULL == img_dscs[index])
+    {
+        Asset asset;
+        AssetImgInfo info;
+        pack.at(index, &asset);
+        if (!asset_img_info(asset, &info))
+        {
+            Serial.printf("Assets: %s is not an image\n", name);
+            return NULL;
+        }
+        lv_img_dsc_t *dsc = (lv_img_dsc_t *)calloc(1, sizeof(lv_img_dsc_t));
+        if (NULL == dsc)
+        {
+            return NULL;
+        }
+        dsc->header.cf = info.cf;
+        dsc->header.w = info.w;
+        dsc->header.h = info.h;
+        dsc->data_size = info.pixel_size;
+        dsc->data = info.pixels;
+        img_dscs[index] = dsc;
+    }
+    return img_dscs[index];
+}
+
+lv_font_t *asset_font(const char *name)
+{
+    int index = pack.indexOf(name);
+    if (index < 0)
+    {
+        return NULL;
+    }
+    if (NULL == fonts[index])
+    {
+        Asset asset;
+        pack.at(index, &asset);
+        fonts[index] = ASSET_TYPE_FONT == asset.type ? lv_font_stream_map(asset.data, asset.size) : NULL;
+        if (NULL == fonts[index])
+        {
+            Serial.printf("Assets: %s is not a font\n", name);
+        }
+    }
+    return fonts[index];
+}
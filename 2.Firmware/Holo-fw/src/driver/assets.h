@@ -0,0 +1,25 @@
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include <lvgl.h>
+#include "sys/asset_pack.h"
+
+// 资源分区中的字体和图片（格式见 sys/asset_pack.h，由 tools/asset_pack.py 生成并烧录）
+// 分区映射到地址空间后，字体、图片和JPEG都直接使用映射中的数据，不复制到内存
+// 名称不含扩展名，如 "font/ch_font_20"、"img/no_model"
+#define ASSETS_PARTITION "assets"
+#define ASSETS_PARTITION_SUBTYPE 0x41
+
+// 映射分区并检查索引，没有烧录资源时返回false，之后的查找都返回NULL
+bool assets_init();
+
+// 任意任务中都可调用；JPEG可直接交给 TJpgDec.drawJpg()
+const uint8_t *asset_data(const char *name, uint32_t *size, uint8_t type = 0xFF);
+
+// 以下只在LVGL所在的任务中调用，同一个名称返回同一个对象，不需要释放
+// 可直接用于 lv_img_set_src()
+const lv_img_dsc_t *asset_img(const char *name);
+// 可用于样式或作为其它字体的 fallback
+lv_font_t *asset_font(const char *name);
+
+#endif
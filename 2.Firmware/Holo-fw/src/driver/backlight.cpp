@@ -0,0 +1,77 @@
+#include "backlight.h"
+#include "common.h"
+#include "sys/settings.h"
+#include <driver/ledc.h>
+
+// Arduino的ledc通道0~7属于高速组，通道号与IDF一致
+#define BACKLIGHT_LEDC_MODE LEDC_HIGH_SPEED_MODE
+#define BACKLIGHT_LEDC_CHANNEL ((ledc_channel_t)LCD_BL_PWM_CHANNEL)
+#define BACKLIGHT_DUTY_MAX 255 // 与 Display::init 中的8位分辨率一致
+
+static BacklightCurve curve;
+static LuxFilter filter;
+static uint8_t current_percent = 0xFF; // 未知，首次必定调整
+static bool fade_ready = false;
+
+void backlight_fade_to(uint8_t percent, uint32_t fade_ms)
+{
+    percent = constrain(percent, BACKLIGHT_MIN_PERCENT, 100);
+    // 背光为低电平点亮，占空比与 Display::setBackLight 一样取反
+    uint32_t duty = BACKLIGHT_DUTY_MAX - percent * BACKLIGHT_DUTY_MAX / 100;
+    if (!fade_ready)
+    {
+        // 已安装时返回错误，可忽略
+        ledc_fade_func_install(0);
+        fade_ready = true;
+    }
+    if (ESP_OK != ledc_set_fade_with_time(BACKLIGHT_LEDC_MODE, BACKLIGHT_LEDC_CHANNEL, duty, fade_ms) ||
+        ESP_OK != ledc_fade_start(BACKLIGHT_LEDC_MODE, BACKLIGHT_LEDC_CHANNEL, LEDC_FADE_NO_WAIT))
+    {
+        ledcWrite(LCD_BL_PWM_CHANNEL, duty);
+    }
+    current_percent = percent;
+}
+
+static void backlight_task(void *param)
+{
+    // 光感由I2C总线任务读取，总线启动前 getLux() 会在本任务中访问Wire
+    while (!i2c_bus_running())
+    {
+        vTaskDelay(BACKLIGHT_INTERVAL / portTICK_PERIOD_MS);
+    }
+    vTaskDelay(BACKLIGHT_SETTLE_MS / portTICK_PERIOD_MS);
+
+    filter.reset();
+    TickType_t last_wake = xTaskGetTickCount();
+    while (true)
+    {
+        float lux = filter.update(ambLight.getLux(), BACKLIGHT_INTERVAL / 1000.0f);
+        uint8_t target = curve.map(lux);
+        if (abs((int)target - (int)current_percent) >= BACKLIGHT_DEADBAND)
+        {
+            backlight_fade_to(target, BACKLIGHT_FADE_MS);
+        }
+        vTaskDelayUntil(&last_wake, BACKLIGHT_INTERVAL / portTICK_PERIOD_MS);
+    }
+}
+
+bool backlight_init()
+{
+    String mode = settings_get_str(SETTINGS_TXT_PREFIX "backlight", "auto");
+    mode.trim();
+    String curve_text = settings_get_str(SETTINGS_TXT_PREFIX "backlight_curve");
+    curve_text.trim();
+    if (curve_text.length() > 0 && !curve.parse(curve_text.c_str()))
+    {
+        Serial.println(F("Backlight: invalid backlight_curve, using default"));
+    }
+
+    if (mode != "auto")
+    {
+        backlight_fade_to(mode.toInt(), BACKLIGHT_FADE_MS);
+        Serial.printf("Backlight fixed at %u%%\n", current_percent);
+        return true;
+    }
+    return pdPASS == xTaskCreatePinnedToCore(backlight_task, "backlight", BACKLIGHT_TASK_STACK_SIZE, NULL,
+                                             BACKLIGHT_TASK_PRIORITY, NULL, BACKLIGHT_TASK_CORE);
+}
@@ -0,0 +1,28 @@
+#ifndef BACKLIGHT_H
+#define BACKLIGHT_H
+
+#include <Arduino.h>
+#include "backlight_curve.h"
+
+// 根据环境光自动调节背光（滤波与映射曲线见 backlight_curve.h）
+// config.txt 中的可选配置（任意行，key:value，开机时导入设置，见 sys/settings.h）：
+//   backlight:auto                            跟随环境光（默认）
+//   backlight:60                              固定亮度（%）
+//   backlight_curve:0=5,10=20,100=45,500=75,2000=100   lux=亮度%
+// 亮度变化由LEDC硬件渐变完成，不占用CPU
+#define BACKLIGHT_INTERVAL 250  // 读取光感的间隔（ms）
+#define BACKLIGHT_SETTLE_MS 800 // 光感开始采样后等待其均值稳定（ms）
+#define BACKLIGHT_DEADBAND 3    // 目标亮度变化小于该值（%）时不调整
+#define BACKLIGHT_FADE_MS 600   // 每次调整的渐变时间（ms）
+#define BACKLIGHT_MIN_PERCENT 2 // 任何配置下都不完全关闭背光
+
+#define BACKLIGHT_TASK_STACK_SIZE 2048
+#define BACKLIGHT_TASK_PRIORITY 1
+#define BACKLIGHT_TASK_CORE 0
+
+// 读取配置；自动模式下启动调节任务（光感数据由I2C总线任务提供）
+bool backlight_init();
+// 渐变到指定亮度（%）
+void backlight_fade_to(uint8_t percent, uint32_t fade_ms);
+
+#endif
@@ -0,0 +1,95 @@
+#include "backlight_curve.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+static float lux_level(float lux)
+{
+    return log10f((lux > 0 ? lux : 0) + 1);
+}
+
+BacklightCurve::BacklightCurve() : m_num(0)
+{
+    parse(BACKLIGHT_CURVE_DEFAULT);
+}
+
+bool BacklightCurve::parse(const char *text)
+{
+    BacklightPoint points[BACKLIGHT_CURVE_MAX_POINTS];
+    uint8_t num = 0;
+    const char *pos = text;
+    while (*pos)
+    {
+        char *end;
+        long lux = strtol(pos, &end, 10);
+        if (end == pos || '=' != *end || lux < 0)
+        {
+            return false;
+        }
+        pos = end + 1;
+        long percent = strtol(pos, &end, 10);
+        if (end == pos || percent < 0 || percent > 100 || num >= BACKLIGHT_CURVE_MAX_POINTS)
+        {
+            return false;
+        }
+        float level = lux_level(lux);
+        if (num > 0 && level <= points[num - 1].level)
+        {
+            return false;
+        }
+        points[num].level = level;
+        points[num].percent = percent;
+        ++num;
+        pos = end;
+        while (',' == *pos || ' ' == *pos)
+        {
+            ++pos;
+        }
+    }
+    if (0 == num)
+    {
+        return false;
+    }
+    for (int idx = 0; idx < num; ++idx)
+    {
+        m_points[idx] = points[idx];
+    }
+    m_num = num;
+    return true;
+}
+
+uint8_t BacklightCurve::map(float lux) const
+{
+    float level = lux_level(lux);
+    if (level <= m_points[0].level)
+    {
+        return m_points[0].percent;
+    }
+    for (int idx = 1; idx < m_num; ++idx)
+    {
+        if (level <= m_points[idx].level)
+        {
+            const BacklightPoint &low = m_points[idx - 1];
+            const BacklightPoint &high = m_points[idx];
+            float ratio = (level - low.level) / (high.level - low.level);
+            return (uint8_t)(low.percent + ratio * (high.percent - low.percent) + 0.5f);
+        }
+    }
+    return m_points[m_num - 1].percent;
+}
+
+float LuxFilter::update(float lux, float dt)
+{
+    float level = lux_level(lux);
+    if (!m_primed)
+    {
+        m_primed = true;
+        m_level = level;
+    }
+    else
+    {
+        float tau = level > m_level ? BACKLIGHT_RISE_TAU : BACKLIGHT_FALL_TAU;
+        m_level += (level - m_level) * (dt / (tau + dt));
+    }
+    return powf(10, m_level) - 1;
+}
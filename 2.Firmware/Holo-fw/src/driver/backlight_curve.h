@@ -0,0 +1,46 @@
+#ifndef BACKLIGHT_CURVE_H
+#define BACKLIGHT_CURVE_H
+
+#include <stdint.h>
+
+// 环境光 -> 屏幕亮度的映射，只依赖标准头文件，可在PC上编译检查
+// 人眼对亮度的感受接近对数，滤波和插值都在 log10(lux + 1) 上进行
+#define BACKLIGHT_CURVE_MAX_POINTS 8
+#define BACKLIGHT_CURVE_DEFAULT "0=5,10=20,100=45,500=75,2000=100" // lux=亮度%，lux递增
+#define BACKLIGHT_RISE_TAU 1.0f // 变亮的时间常数（s），开灯时尽快跟上
+#define BACKLIGHT_FALL_TAU 6.0f // 变暗的时间常数（s），避免人影晃过就变暗
+
+struct BacklightPoint
+{
+    float level; // log10(lux + 1)
+    uint8_t percent;
+};
+
+class BacklightCurve
+{
+private:
+    BacklightPoint m_points[BACKLIGHT_CURVE_MAX_POINTS];
+    uint8_t m_num;
+
+public:
+    BacklightCurve();
+    // 格式 "lux=亮度%,..."，lux须递增；格式错误时返回false并保留原来的曲线
+    bool parse(const char *text);
+    uint8_t map(float lux) const; // 返回亮度（0-100）
+};
+
+// 非对称一阶低通：变亮快、变暗慢
+class LuxFilter
+{
+private:
+    bool m_primed;
+    float m_level;
+
+public:
+    LuxFilter() : m_primed(false), m_level(0) {}
+    void reset() { m_primed = false; }
+    // dt: 距上次调用的时间（s），返回滤波后的lux
+    float update(float lux, float dt);
+};
+
+#endif
@@ -9,6 +9,7 @@
 static lv_disp_draw_buf_t disp_buf;
 static lv_disp_drv_t disp_drv;
 static lv_color_t buf[SCREEN_HOR_RES * LV_HOR_RES_MAX_LEN];
+static unsigned long mem_report_millis = 0;
 
 void my_print(const char * buf)
 {
@@ -76,6 +77,25 @@ void Display::init(uint8_t rotation, uint8_t backLight)
 void Display::routine()
 {
     lv_task_handler();
+#if LV_MEM_CUSTOM == 0
+    if (doDelayMillisTime(LV_MEM_REPORT_INTERVAL, &mem_report_millis, false))
+    {
+        memReport();
+    }
+#endif
+}
+
+void Display::memReport()
+{
+#if LV_MEM_CUSTOM == 0
+    lv_mem_monitor_t mon;
+    lv_mem_monitor(&mon);
+    Serial.printf("LVGL pool: %u/%u bytes used (%u%%), peak %u, largest free %u, frag %u%%\n",
+                  mon.total_size - mon.free_size, mon.total_size, mon.used_pct,
+                  mon.max_used, mon.free_biggest_size, mon.frag_pct);
+#else
+    Serial.println(F("LVGL pool: disabled, using system heap"));
+#endif
 }
 
 void Display::setBackLight(float duty)
@@ -3,12 +3,16 @@
 
 #include <lvgl.h>
 
+// LVGL使用独立内存池时（lv_conf.h 中的 HOLO_LV_MEM_POOL）定期打印其使用情况
+#define LV_MEM_REPORT_INTERVAL 600000 // ms
+
 class Display
 {
 public:
     void init(uint8_t rotation, uint8_t backLight);
     void routine();
     void setBackLight(float);
+    void memReport(); // 打印LVGL内存池的占用、最高占用和碎片率
 };
 
 #endif
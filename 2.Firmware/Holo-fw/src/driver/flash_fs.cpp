@@ -341,7 +341,7 @@ void FlashFS::testFileIO(const char *path)
         }
         Serial.println("");
         end = millis() - start;
-        Serial.printf("- %u bytes read in %u ms\r\n", flen, end);
+        Serial.printf("- %u bytes read in %u ms\r\n", (unsigned)flen, (unsigned)end);
         file.close();
     }
     else
@@ -0,0 +1,160 @@
+#include "gesture.h"
+
+const char *active_type_info[] = {"TURN_RIGHT", "RETURN",
+                                  "TURN_LEFT", "UP",
+                                  "DOWN", "GO_FORWORD",
+                                  "SHAKE", "UNKNOWN"};
+
+GestureRecognizer::GestureRecognizer()
+{
+    reset();
+}
+
+void GestureRecognizer::reset()
+{
+    m_primed = false;
+    m_fast_x = m_fast_y = 0;
+    m_slow_x = m_slow_y = 0;
+    m_shake_x.sign = m_shake_y.sign = 0;
+    m_shake_x.swings = m_shake_y.swings = 0;
+    m_quiet_until = 0;
+    m_state = UNKNOWN;
+    m_candidate = UNKNOWN;
+    m_held = false;
+}
+
+bool GestureRecognizer::feedShake(ShakeAxis *axis, int32_t level, uint32_t ms)
+{
+    int8_t sign = level > GESTURE_SHAKE_LEVEL ? 1 : (level < -GESTURE_SHAKE_LEVEL ? -1 : 0);
+    if (0 == sign || sign == axis->sign)
+    {
+        return false;
+    }
+    axis->sign = sign;
+    if (0 == axis->swings || ms - axis->first_ms > GESTURE_SHAKE_WINDOW_MS)
+    {
+        // 距第一次反转太久，重新计数
+        axis->swings = 1;
+        axis->first_ms = ms;
+        return false;
+    }
+    if (++axis->swings < GESTURE_SHAKE_SWINGS)
+    {
+        return false;
+    }
+    axis->swings = 0;
+    return true;
+}
+
+ACTIVE_TYPE GestureRecognizer::candidate() const
+{
+    // 与原先的判断顺序一致：先左右再前后
+    if (m_fast_y > GESTURE_TURN_ON)
+    {
+        return TURN_LEFT;
+    }
+    if (m_fast_y < -GESTURE_TURN_ON)
+    {
+        return TURN_RIGHT;
+    }
+    if (m_fast_x > GESTURE_TILT_ON)
+    {
+        return UP;
+    }
+    if (m_fast_x < -GESTURE_TILT_ON)
+    {
+        return DOWN;
+    }
+    return UNKNOWN;
+}
+
+bool GestureRecognizer::holding(ACTIVE_TYPE state) const
+{
+    switch (state)
+    {
+    case TURN_LEFT:
+        return m_fast_y > GESTURE_TURN_OFF;
+    case TURN_RIGHT:
+        return m_fast_y < -GESTURE_TURN_OFF;
+    case UP:
+        return m_fast_x > GESTURE_TILT_OFF;
+    case DOWN:
+        return m_fast_x < -GESTURE_TILT_OFF;
+    default:
+        return false;
+    }
+}
+
+ACTIVE_TYPE GestureRecognizer::feed(const GestureSample &sample)
+{
+    uint32_t ms = sample.ms;
+    if (!m_primed)
+    {
+        m_primed = true;
+        m_fast_x = m_slow_x = sample.ax;
+        m_fast_y = m_slow_y = sample.ay;
+    }
+    m_fast_x += (sample.ax - m_fast_x) >> GESTURE_FAST_SHIFT;
+    m_fast_y += (sample.ay - m_fast_y) >> GESTURE_FAST_SHIFT;
+    m_slow_x += (sample.ax - m_slow_x) >> GESTURE_SLOW_SHIFT;
+    m_slow_y += (sample.ay - m_slow_y) >> GESTURE_SLOW_SHIFT;
+
+    // 摇晃优先：来回晃动时加速度也会短暂超过倾斜阈值
+    bool shake_x = feedShake(&m_shake_x, sample.ax - m_slow_x, ms);
+    bool shake_y = feedShake(&m_shake_y, sample.ay - m_slow_y, ms);
+    if (shake_x || shake_y)
+    {
+        m_state = UNKNOWN;
+        m_candidate = UNKNOWN;
+        m_quiet_until = ms + GESTURE_SHAKE_QUIET_MS;
+        return SHAKE;
+    }
+    if ((int32_t)(ms - m_quiet_until) < 0)
+    {
+        return UNKNOWN;
+    }
+
+    if (UNKNOWN != m_state && !holding(m_state))
+    {
+        m_state = UNKNOWN;
+    }
+
+    if (UNKNOWN == m_state)
+    {
+        ACTIVE_TYPE type = candidate();
+        if (UNKNOWN == type || type != m_candidate)
+        {
+            m_candidate = type;
+            m_candidate_ms = ms;
+            return UNKNOWN;
+        }
+        if (ms - m_candidate_ms < GESTURE_DWELL_MS)
+        {
+            return UNKNOWN;
+        }
+        m_state = type;
+        m_candidate = UNKNOWN;
+        m_enter_ms = m_candidate_ms;
+        m_report_ms = ms;
+        m_held = false;
+        return type;
+    }
+
+    if (UP == m_state || DOWN == m_state)
+    {
+        // 前后倾斜保持一段时间升级为"长按"，每次倾斜只上报一次
+        if (!m_held && ms - m_enter_ms >= GESTURE_HOLD_MS)
+        {
+            m_held = true;
+            return UP == m_state ? GO_FORWORD : RETURN;
+        }
+        return UNKNOWN;
+    }
+
+    if (ms - m_report_ms >= GESTURE_REPEAT_MS)
+    {
+        m_report_ms = ms;
+        return m_state;
+    }
+    return UNKNOWN;
+}
@@ -0,0 +1,83 @@
+#ifndef GESTURE_H
+#define GESTURE_H
+
+#include <stdint.h>
+
+// 动作识别只依赖标准头文件，可在PC上编译（见 tools/gesture_replay.cpp）
+
+extern const char *active_type_info[];
+
+enum ACTIVE_TYPE
+{
+    TURN_RIGHT = 0,
+    RETURN,
+    TURN_LEFT,
+    UP,
+    DOWN,
+    GO_FORWORD,
+    SHAKE,
+    UNKNOWN
+};
+
+// 输入为固定采样率的连续样本（已做方向变换，±2g量程下1g=16384）
+#define GESTURE_SAMPLE_PERIOD 10  // 采样周期（ms）
+#define GESTURE_FAST_SHIFT 2      // 倾斜检测的低通滤波：y += (x - y) >> 2，约40ms
+#define GESTURE_SLOW_SHIFT 4      // 摇晃检测用于去除重力的低通滤波，约160ms
+#define GESTURE_TURN_ON 4000      // 左右倾斜的触发阈值
+#define GESTURE_TURN_OFF 2500     // 左右倾斜的释放阈值
+#define GESTURE_TILT_ON 5000      // 前后倾斜的触发阈值
+#define GESTURE_TILT_OFF 3000     // 前后倾斜的释放阈值
+#define GESTURE_DWELL_MS 80       // 超过阈值持续该时间才算倾斜（滤掉摇晃的单次峰值）
+#define GESTURE_REPEAT_MS 200     // 保持左右倾斜时重复上报的间隔
+#define GESTURE_HOLD_MS 500       // 前后倾斜保持该时间视为长按
+#define GESTURE_SHAKE_LEVEL 3000  // 去除重力后的加速度幅度
+#define GESTURE_SHAKE_SWINGS 4    // 窗口内方向反转的次数
+#define GESTURE_SHAKE_WINDOW_MS 600
+#define GESTURE_SHAKE_QUIET_MS 300 // 识别出摇晃后暂停识别的时间
+
+struct GestureSample
+{
+    uint32_t ms; // 采样时间，由样本序号换算，不受读取延迟影响
+    int16_t ax;
+    int16_t ay;
+    int16_t az;
+    int16_t gx;
+    int16_t gy;
+    int16_t gz;
+};
+
+class GestureRecognizer
+{
+private:
+    struct ShakeAxis
+    {
+        int8_t sign; // 上一次大幅运动的方向
+        uint8_t swings;
+        uint32_t first_ms;
+    };
+
+    bool m_primed;
+    int32_t m_fast_x, m_fast_y; // 低通后的加速度（用于倾斜）
+    int32_t m_slow_x, m_slow_y; // 重力分量（用于摇晃）
+    ShakeAxis m_shake_x, m_shake_y;
+    uint32_t m_quiet_until;
+
+    ACTIVE_TYPE m_state;     // 当前保持的倾斜
+    ACTIVE_TYPE m_candidate; // 超过阈值但还未满足保持时间的倾斜
+    uint32_t m_candidate_ms;
+    uint32_t m_enter_ms;
+    uint32_t m_report_ms;
+    bool m_held;
+
+    bool feedShake(ShakeAxis *axis, int32_t level, uint32_t ms);
+    ACTIVE_TYPE candidate() const;
+    bool holding(ACTIVE_TYPE state) const;
+
+public:
+    GestureRecognizer();
+    void reset();
+    // 每个样本调用一次，识别出动作时返回其类型，否则返回UNKNOWN
+    ACTIVE_TYPE feed(const GestureSample &sample);
+};
+
+#endif
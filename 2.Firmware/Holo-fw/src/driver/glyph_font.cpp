@@ -0,0 +1,260 @@
+#include "glyph_font.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+GlyphFont::GlyphFont() : m_read(NULL), m_ctx(NULL), m_unicode(NULL), m_bitmaps(NULL),
+                         m_slots(NULL), m_slot_num(0), m_clock(0), m_last(NULL),
+                         m_map(NULL), m_map_size(0), m_mapped_unicode(0)
+{
+    memset(&m_header, 0, sizeof(m_header));
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+// 逐字段解析，不依赖结构体的内存布局
+static bool parse_header(const uint8_t *raw, GlyphFontHeader *header)
+{
+    header->magic = raw[0] | (raw[1] << 8) | (raw[2] << 16) | ((uint32_t)raw[3] << 24);
+    header->count = raw[4] | (raw[5] << 8);
+    header->bpp = raw[6];
+    header->line_height = raw[7];
+    header->base_line = (int8_t)raw[8];
+    header->reserved = raw[9];
+    header->max_bitmap = raw[10] | (raw[11] << 8);
+    header->dsc_offset = raw[12] | (raw[13] << 8) | (raw[14] << 16) | ((uint32_t)raw[15] << 24);
+    header->bitmap_offset = raw[16] | (raw[17] << 8) | (raw[18] << 16) | ((uint32_t)raw[19] << 24);
+    return GLYPH_FONT_MAGIC == header->magic && 0 != header->count &&
+           (1 == header->bpp || 2 == header->bpp || 4 == header->bpp || 8 == header->bpp);
+}
+
+bool GlyphFont::open(GlyphReadFunc read, void *ctx, uint16_t cache_slots)
+{
+    close();
+    m_read = read;
+    m_ctx = ctx;
+    uint8_t raw[GLYPH_FONT_HEADER_SIZE];
+    if (!read(ctx, 0, raw, sizeof(raw)) || !parse_header(raw, &m_header) || 0 == cache_slots)
+    {
+        return false;
+    }
+
+    uint16_t *unicode = (uint16_t *)malloc(m_header.count * sizeof(uint16_t));
+    m_unicode = unicode;
+    m_slots = (Slot *)calloc(cache_slots, sizeof(Slot));
+    m_bitmaps = (uint8_t *)malloc((uint32_t)cache_slots * (m_header.max_bitmap ? m_header.max_bitmap : 1));
+    if (NULL == unicode || NULL == m_slots || NULL == m_bitmaps ||
+        !read(ctx, sizeof(raw), unicode, m_header.count * sizeof(uint16_t)))
+    {
+        close();
+        return false;
+    }
+    // 文件为小端，与ESP32和PC一致
+    m_slot_num = cache_slots;
+    for (int pos = 0; pos < m_slot_num; ++pos)
+    {
+        m_slots[pos].bitmap = m_bitmaps + pos * m_header.max_bitmap;
+    }
+    return true;
+}
+
+bool GlyphFont::openMapped(const uint8_t *data, uint32_t size)
+{
+    close();
+    if (size < GLYPH_FONT_HEADER_SIZE || ((uintptr_t)data & 1) || !parse_header(data, &m_header))
+    {
+        return false;
+    }
+    // 码表、字形描述和字模都留在映射中，字模的范围在查找时检查
+    if (GLYPH_FONT_HEADER_SIZE + m_header.count * sizeof(uint16_t) > m_header.dsc_offset ||
+        m_header.dsc_offset + (uint32_t)m_header.count * GLYPH_FONT_DSC_SIZE > size ||
+        m_header.bitmap_offset > size)
+    {
+        return false;
+    }
+    m_map = data;
+    m_map_size = size;
+    m_unicode = (const uint16_t *)(data + GLYPH_FONT_HEADER_SIZE);
+    return true;
+}
+
+void GlyphFont::close()
+{
+    if (NULL == m_map)
+    {
+        free((void *)m_unicode);
+    }
+    m_map = NULL;
+    m_map_size = 0;
+    m_mapped_unicode = 0;
+    free(m_slots);
+    free(m_bitmaps);
+    m_unicode = NULL;
+    m_slots = NULL;
+    m_bitmaps = NULL;
+    m_slot_num = 0;
+    m_last = NULL;
+}
+
+int GlyphFont::find(uint32_t unicode) const
+{
+    int low = 0, high = m_header.count - 1;
+    while (low <= high)
+    {
+        int mid = (low + high) >> 1;
+        if (unicode < m_unicode[mid])
+        {
+            high = mid - 1;
+        }
+        else if (unicode > m_unicode[mid])
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            return mid;
+        }
+    }
+    return -1;
+}
+
+GlyphFont::Slot *GlyphFont::lookup(uint32_t unicode)
+{
+    if (0 == m_slot_num || 0 == unicode)
+    {
+        return NULL;
+    }
+    ++m_clock;
+    if (NULL != m_last && m_last->unicode == unicode)
+    {
+        ++m_stats.hits;
+        m_last->used = m_clock;
+        return m_last;
+    }
+
+    Slot *victim = &m_slots[0];
+    for (int pos = 0; pos < m_slot_num; ++pos)
+    {
+        Slot *slot = &m_slots[pos];
+        if (slot->unicode == unicode)
+        {
+            ++m_stats.hits;
+            slot->used = m_clock;
+            m_last = slot;
+            return slot;
+        }
+        if (slot->used < victim->used)
+        {
+            victim = slot;
+        }
+    }
+
+    ++m_stats.misses;
+    int index = find(unicode);
+    if (index < 0)
+    {
+        return NULL;
+    }
+    uint8_t raw[GLYPH_FONT_DSC_SIZE];
+    ++m_stats.reads;
+    victim->unicode = 0; // 读取失败时不留下半个字形
+    if (m_last == victim)
+    {
+        m_last = NULL;
+    }
+    if (!m_read(m_ctx, m_header.dsc_offset + index * GLYPH_FONT_DSC_SIZE, raw, sizeof(raw)))
+    {
+        return NULL;
+    }
+    GlyphDsc *dsc = &victim->dsc;
+    dsc->bitmap_offset = raw[0] | (raw[1] << 8) | ((uint32_t)raw[2] << 16);
+    dsc->adv_w = raw[3];
+    dsc->box_w = raw[4];
+    dsc->box_h = raw[5];
+    dsc->ofs_x = (int8_t)raw[6];
+    dsc->ofs_y = (int8_t)raw[7];
+    dsc->bitmap_size = (dsc->box_w * m_header.bpp + 7) / 8 * dsc->box_h;
+    if (dsc->bitmap_size > m_header.max_bitmap)
+    {
+        return NULL;
+    }
+    victim->unicode = unicode;
+    victim->used = m_clock;
+    victim->loaded = false;
+    m_last = victim;
+    return victim;
+}
+
+const GlyphDsc *GlyphFont::lookupMapped(uint32_t unicode)
+{
+    ++m_stats.hits;
+    if (0 != unicode && unicode == m_mapped_unicode)
+    {
+        return &m_mapped;
+    }
+    m_mapped_unicode = 0;
+    int index = 0 == unicode ? -1 : find(unicode);
+    if (index < 0)
+    {
+        return NULL;
+    }
+    const uint8_t *raw = m_map + m_header.dsc_offset + index * GLYPH_FONT_DSC_SIZE;
+    GlyphDsc *dsc = &m_mapped;
+    dsc->bitmap_offset = raw[0] | (raw[1] << 8) | ((uint32_t)raw[2] << 16);
+    dsc->adv_w = raw[3];
+    dsc->box_w = raw[4];
+    dsc->box_h = raw[5];
+    dsc->ofs_x = (int8_t)raw[6];
+    dsc->ofs_y = (int8_t)raw[7];
+    dsc->bitmap_size = (dsc->box_w * m_header.bpp + 7) / 8 * dsc->box_h;
+    if (dsc->bitmap_offset + dsc->bitmap_size > m_map_size - m_header.bitmap_offset)
+    {
+        return NULL;
+    }
+    m_mapped_unicode = unicode;
+    return dsc;
+}
+
+const GlyphDsc *GlyphFont::glyph(uint32_t unicode)
+{
+    if (NULL != m_map)
+    {
+        return lookupMapped(unicode);
+    }
+    Slot *slot = lookup(unicode);
+    return NULL == slot ? NULL : &slot->dsc;
+}
+
+const uint8_t *GlyphFont::bitmap(uint32_t unicode)
+{
+    if (NULL != m_map)
+    {
+        const GlyphDsc *dsc = lookupMapped(unicode);
+        return NULL == dsc ? NULL : m_map + m_header.bitmap_offset + dsc->bitmap_offset;
+    }
+    Slot *slot = lookup(unicode);
+    if (NULL == slot)
+    {
+        return NULL;
+    }
+    if (!slot->loaded)
+    {
+        ++m_stats.reads;
+        if (slot->dsc.bitmap_size > 0 &&
+            !m_read(m_ctx, m_header.bitmap_offset + slot->dsc.bitmap_offset, slot->bitmap, slot->dsc.bitmap_size))
+        {
+            return NULL;
+        }
+        slot->loaded = true;
+    }
+    return slot->bitmap;
+}
+
+uint32_t GlyphFont::ramUsage() const
+{
+    if (NULL != m_map)
+    {
+        return sizeof(GlyphFont);
+    }
+    return sizeof(GlyphFont) + m_header.count * sizeof(uint16_t) +
+           m_slot_num * (sizeof(Slot) + m_header.max_bitmap);
+}
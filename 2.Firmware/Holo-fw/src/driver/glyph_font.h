@@ -0,0 +1,99 @@
+#ifndef GLYPH_FONT_H
+#define GLYPH_FONT_H
+
+#include <stdint.h>
+
+// 存放在文件中的点阵字体，字模按需读取并缓存（LRU）
+// 字体在内存映射的flash中时（如资源分区，见 sys/asset_pack.h）用 openMapped() 直接指向映射，不占用缓存
+// 只依赖标准头文件，可在PC上编译（见 tools/font_bench.cpp），文件由 tools/font_pack.py 生成
+// 文件格式（小端）：
+//   GlyphFontHeader                  20字节
+//   uint16_t unicode[count]          升序，常驻内存用于二分查找
+//   8字节 x count 字形描述            偏移(3) adv_w box_w box_h ofs_x ofs_y
+//   字模数据                          每行 (box_w * bpp + 7) / 8 字节
+#define GLYPH_FONT_MAGIC 0x314e4648 // "HFN1"
+#define GLYPH_FONT_HEADER_SIZE 20
+#define GLYPH_FONT_DSC_SIZE 8
+#define GLYPH_CACHE_SLOTS 32 // 缓存的字形数，每个占用 max_bitmap 字节
+
+struct GlyphFontHeader
+{
+    uint32_t magic;
+    uint16_t count;
+    uint8_t bpp;
+    uint8_t line_height;
+    int8_t base_line;
+    uint8_t reserved;
+    uint16_t max_bitmap;    // 最大的字模字节数
+    uint32_t dsc_offset;    // 字形描述在文件中的位置
+    uint32_t bitmap_offset; // 字模数据在文件中的位置
+};
+
+struct GlyphDsc
+{
+    uint32_t bitmap_offset; // 相对字模数据的偏移
+    uint16_t bitmap_size;
+    uint8_t adv_w;
+    uint8_t box_w;
+    uint8_t box_h;
+    int8_t ofs_x;
+    int8_t ofs_y;
+};
+
+// 从文件的offset处读取len字节，成功返回true
+typedef bool (*GlyphReadFunc)(void *ctx, uint32_t offset, void *buf, uint32_t len);
+
+struct GlyphCacheStats
+{
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t reads; // 读取文件的次数（字形描述和字模各算一次）
+};
+
+class GlyphFont
+{
+private:
+    struct Slot
+    {
+        uint32_t unicode; // 0表示空
+        uint32_t used;    // 最近一次使用的序号
+        bool loaded;      // 字模已读入
+        GlyphDsc dsc;
+        uint8_t *bitmap;
+    };
+
+    GlyphReadFunc m_read;
+    void *m_ctx;
+    GlyphFontHeader m_header;
+    const uint16_t *m_unicode;
+    uint8_t *m_bitmaps;
+    Slot *m_slots;
+    uint16_t m_slot_num;
+    uint32_t m_clock;
+    Slot *m_last; // 同一个字先取描述再取字模，直接命中
+    GlyphCacheStats m_stats;
+    const uint8_t *m_map; // openMapped() 时为整个字体
+    uint32_t m_map_size;
+    uint32_t m_mapped_unicode;
+    GlyphDsc m_mapped; // 映射模式下最近一次查到的字形
+
+    int find(uint32_t unicode) const;
+    Slot *lookup(uint32_t unicode);
+    const GlyphDsc *lookupMapped(uint32_t unicode);
+
+public:
+    GlyphFont();
+    ~GlyphFont() { close(); }
+    bool open(GlyphReadFunc read, void *ctx, uint16_t cache_slots = GLYPH_CACHE_SLOTS);
+    // data 须2字节对齐，在 close() 之前保持有效
+    bool openMapped(const uint8_t *data, uint32_t size);
+    void close();
+    const GlyphFontHeader &header() const { return m_header; }
+    // 字体中没有该字时返回NULL；返回值在下一次调用前有效
+    const GlyphDsc *glyph(uint32_t unicode);
+    const uint8_t *bitmap(uint32_t unicode);
+    const GlyphCacheStats &stats() const { return m_stats; }
+    uint32_t ramUsage() const; // 索引与缓存占用的内存
+};
+
+#endif
@@ -0,0 +1,191 @@
+#include "i2c_bus.h"
+
+struct I2cJob
+{
+    const char *name;
+    I2cJobFunc fn;
+    void *param;
+    uint32_t period_us;
+    I2C_JOB_PRIORITY priority;
+    uint32_t next_us;  // 下一次到期的时间
+    uint32_t max_us;   // 单次最长耗时，用于判断低优先级传输能否插空
+    uint32_t count;
+    uint64_t busy_us;  // 累计占用总线的时间
+    uint32_t skipped;  // 低优先级传输因让路而推迟的次数
+};
+
+static I2cJob jobs[I2C_BUS_MAX_JOBS];
+static uint8_t job_num = 0;
+static TaskHandle_t bus_task = NULL;
+static volatile bool wake_high = false;
+
+int i2c_bus_add(const char *name, I2cJobFunc fn, void *param,
+                uint32_t period_ms, I2C_JOB_PRIORITY priority)
+{
+    if (NULL != bus_task || job_num >= I2C_BUS_MAX_JOBS || 0 == period_ms)
+    {
+        Serial.printf("I2C bus: can't add %s\n", name);
+        return -1;
+    }
+    I2cJob *job = &jobs[job_num];
+    memset(job, 0, sizeof(I2cJob));
+    job->name = name;
+    job->fn = fn;
+    job->param = param;
+    job->period_us = period_ms * 1000;
+    job->priority = priority;
+    return job_num++;
+}
+
+static void run_job(I2cJob *job, uint32_t now)
+{
+    uint32_t begin = micros();
+    job->fn(job->param);
+    uint32_t took = micros() - begin;
+    job->busy_us += took;
+    ++job->count;
+    if (took > job->max_us)
+    {
+        job->max_us = took;
+    }
+    // 按周期对齐；落后太多（如切换DMP）时从现在重新计时
+    job->next_us += job->period_us;
+    if ((int32_t)(job->next_us - now) < 0)
+    {
+        job->next_us = now + job->period_us;
+    }
+}
+
+// 距离下一次高优先级传输的时间（us）
+static int32_t next_high_in(uint32_t now)
+{
+    int32_t nearest = INT32_MAX;
+    for (int pos = 0; pos < job_num; ++pos)
+    {
+        if (I2C_PRIORITY_HIGH == jobs[pos].priority)
+        {
+            int32_t left = (int32_t)(jobs[pos].next_us - now);
+            nearest = left < nearest ? left : nearest;
+        }
+    }
+    return nearest;
+}
+
+static void bus_task_entry(void *param)
+{
+    uint32_t report_ms = millis();
+    while (true)
+    {
+        uint32_t now = micros();
+        if (wake_high)
+        {
+            // 中断通知FIFO里已有一批数据，不必等到周期
+            wake_high = false;
+            for (int pos = 0; pos < job_num; ++pos)
+            {
+                if (I2C_PRIORITY_HIGH == jobs[pos].priority)
+                {
+                    jobs[pos].next_us = now;
+                }
+            }
+        }
+
+        // 先执行所有到期的高优先级传输
+        for (int pos = 0; pos < job_num; ++pos)
+        {
+            I2cJob *job = &jobs[pos];
+            if (I2C_PRIORITY_HIGH == job->priority && (int32_t)(job->next_us - now) <= 0)
+            {
+                run_job(job, now);
+                now = micros();
+            }
+        }
+        // 再把到期的低优先级传输插进空档，时间不够就推迟到下一个空档
+        for (int pos = 0; pos < job_num; ++pos)
+        {
+            I2cJob *job = &jobs[pos];
+            if (I2C_PRIORITY_LOW != job->priority || (int32_t)(job->next_us - now) > 0)
+            {
+                continue;
+            }
+            if (next_high_in(now) < (int32_t)(job->max_us + I2C_BUS_GUARD_US))
+            {
+                ++job->skipped;
+                continue;
+            }
+            run_job(job, now);
+            now = micros();
+        }
+
+        // 睡到下一次到期
+        int32_t sleep_us = INT32_MAX;
+        for (int pos = 0; pos < job_num; ++pos)
+        {
+            int32_t left = (int32_t)(jobs[pos].next_us - now);
+            sleep_us = left < sleep_us ? left : sleep_us;
+        }
+        TickType_t ticks = sleep_us > 0 ? pdMS_TO_TICKS(sleep_us / 1000) : 0;
+        ulTaskNotifyTake(pdTRUE, ticks > 0 ? ticks : 1);
+
+        if (millis() - report_ms >= I2C_BUS_REPORT_INTERVAL)
+        {
+            report_ms = millis();
+            i2c_bus_report();
+        }
+    }
+}
+
+bool i2c_bus_begin()
+{
+    if (NULL != bus_task)
+    {
+        return true;
+    }
+    uint32_t now = micros();
+    for (int pos = 0; pos < job_num; ++pos)
+    {
+        jobs[pos].next_us = now;
+    }
+    if (pdPASS != xTaskCreatePinnedToCore(bus_task_entry, "i2c_bus", I2C_BUS_TASK_STACK, NULL,
+                                          I2C_BUS_TASK_PRIORITY, &bus_task, I2C_BUS_TASK_CORE))
+    {
+        bus_task = NULL;
+        Serial.println(F("I2C bus: task create failed"));
+        return false;
+    }
+    return true;
+}
+
+bool i2c_bus_running()
+{
+    return NULL != bus_task;
+}
+
+void IRAM_ATTR i2c_bus_wake_from_isr()
+{
+    if (NULL == bus_task)
+    {
+        return;
+    }
+    wake_high = true;
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(bus_task, &woken);
+    if (woken)
+    {
+        portYIELD_FROM_ISR();
+    }
+}
+
+void i2c_bus_report()
+{
+    uint32_t uptime_ms = millis();
+    Serial.println(F("I2C bus:"));
+    for (int pos = 0; pos < job_num; ++pos)
+    {
+        const I2cJob *job = &jobs[pos];
+        Serial.printf("  %-10s %8u reads, %6lu ms on bus (max %u us), %u deferred\n",
+                      job->name, job->count, (unsigned long)(job->busy_us / 1000),
+                      job->max_us, job->skipped);
+    }
+    Serial.printf("  uptime %u ms\n", uptime_ms);
+}
@@ -0,0 +1,73 @@
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#include <Arduino.h>
+
+// I2C总线调度：MPU6050与BH1750共用同一组引脚（IMU_I2C_SDA/AMB_I2C_SDA），
+// i2c_bus_begin() 之后所有传输都在总线任务中按周期串行执行，主循环不再访问Wire
+//   I2C_PRIORITY_HIGH  到期即执行（MPU6050的FIFO）
+//   I2C_PRIORITY_LOW   只在距离下一次高优先级传输还有足够时间时执行（光感）
+// 结果通过 Snapshot 发布，读取方不加锁、不阻塞
+#define I2C_BUS_MAX_JOBS 4
+#define I2C_BUS_TASK_STACK 4096 // 切换DMP时 dmpInitialize() 在本任务中执行
+#define I2C_BUS_TASK_PRIORITY 3
+#define I2C_BUS_TASK_CORE 0
+#define I2C_BUS_GUARD_US 500            // 低优先级传输的预估耗时之外再留出的余量
+#define I2C_BUS_REPORT_INTERVAL 600000  // 打印总线统计的间隔（ms）
+
+enum I2C_JOB_PRIORITY : unsigned char
+{
+    I2C_PRIORITY_HIGH = 0,
+    I2C_PRIORITY_LOW
+};
+
+typedef void (*I2cJobFunc)(void *param);
+
+// 在 i2c_bus_begin() 之前添加，返回编号，失败返回-1
+int i2c_bus_add(const char *name, I2cJobFunc fn, void *param,
+                uint32_t period_ms, I2C_JOB_PRIORITY priority);
+bool i2c_bus_begin();
+bool i2c_bus_running();
+// 在数据就绪中断中调用：立即执行高优先级传输
+void i2c_bus_wake_from_isr();
+// 打印各传输的次数和占用总线的时间（这些时间原先都花在主循环中）
+void i2c_bus_report();
+
+// 单写多读的快照（seqlock）：写入方在写之前和之后各把序号加一，
+// 读取方发现序号为奇数或前后不一致（读的过程中被写入）时重读。
+// 只能有一个写入方；写入只是一次拷贝，读取方最多重试几次
+template <typename T>
+class Snapshot
+{
+private:
+    volatile uint32_t m_seq = 0;
+    T m_value;
+
+public:
+    void write(const T &value)
+    {
+        ++m_seq;
+        __sync_synchronize();
+        memcpy((void *)&m_value, &value, sizeof(T));
+        __sync_synchronize();
+        ++m_seq;
+    }
+
+    // 返回本次读到的版本号，0表示还没有写入过
+    uint32_t read(T *value) const
+    {
+        uint32_t seq;
+        do
+        {
+            seq = m_seq;
+            __sync_synchronize();
+            memcpy(value, (const void *)&m_value, sizeof(T));
+            __sync_synchronize();
+        } while ((seq & 1) || seq != m_seq);
+        return seq;
+    }
+
+    uint32_t version() const { return m_seq; }
+};
+
+#endif
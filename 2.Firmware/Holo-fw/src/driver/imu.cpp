@@ -1,10 +1,45 @@
 #include "imu.h"
 #include "common.h"
+#include "sys/settings.h"
+#include "i2c_bus.h"
+#include <time.h>
 
-const char *active_type_info[] = {"TURN_RIGHT", "RETURN",
-                                  "TURN_LEFT", "UP",
-                                  "DOWN", "GO_FORWORD",
-                                  "SHAKE", "UNKNOWN"};
+static volatile uint8_t int_count = 0;
+
+// 数据就绪中断：每攒够一批样本唤醒I2C总线任务读取FIFO
+static void IRAM_ATTR imu_data_ready_isr()
+{
+    if (++int_count < IMU_FIFO_BURST)
+    {
+        return;
+    }
+    int_count = 0;
+    i2c_bus_wake_from_isr();
+}
+
+static void imu_bus_job(void *param)
+{
+    ((IMU *)param)->busPoll();
+}
+
+// 保存时和现在都是同步过的unix时间才能判断新旧；开机秒数无从比较，只看温度。
+// 校准时间晚于现在说明时钟有误，同样重新校准
+static bool calibration_stale(uint32_t timestamp)
+{
+    time_t now = time(NULL);
+    if (now <= (time_t)IMU_TIME_VALID || timestamp <= IMU_TIME_VALID)
+    {
+        return false;
+    }
+    return (uint32_t)now < timestamp || (uint32_t)now - timestamp > IMU_CALI_MAX_AGE;
+}
+
+// DMP包中的陀螺仪换算到轮询时的±250dps量程，超出量程的部分饱和
+static int16_t dmp_gyro_raw(int16_t value)
+{
+    int32_t raw = (int32_t)value * IMU_DMP_GYRO_SCALE;
+    return raw > INT16_MAX ? INT16_MAX : (raw < INT16_MIN ? INT16_MIN : (int16_t)raw);
+}
 
 IMU::IMU()
 {
@@ -19,6 +54,23 @@ IMU::IMU()
     }
     act_info_history_ind = ACTION_HISTORY_BUF_LEN - 1;
     this->order = 0; // 表示方位
+    m_cfg = NULL;
+    m_recalibrate = false;
+    m_biasTracker.reset();
+    m_lastSaveMillis = 0;
+    m_savePending = false;
+    m_present = false;
+    m_sampling = false;
+    m_ringHead = m_ringTail = 0;
+    m_ringDropped = 0;
+    m_ringMux = portMUX_INITIALIZER_UNLOCKED;
+    m_sampleCount = 0;
+    m_eventHead = m_eventNum = 0;
+    m_pending = ACTIVE_TYPE::UNKNOWN;
+    m_pendingMillis = 0;
+    m_waitLevel = false;
+    m_wantMode = m_mode = IMU_FIFO_RAW;
+    m_orientationSeen = 0;
 }
 
 void IMU::init(uint8_t order, uint8_t auto_calibration,
@@ -36,39 +88,44 @@ void IMU::init(uint8_t order, uint8_t auto_calibration,
 
     if (!mpu.testConnection())
     {
+        // 之后不再访问MPU6050，Wire留给总线任务（光感）
         Serial.print(F("Unable to connect to MPU6050.\n"));
         return;
     }
 
-    Serial.print(F("Initialization MPU6050 now, Please don't move.\n"));
     mpu.initialize();
+    m_cfg = mpu_cfg;
 
     if (auto_calibration == 0)
     {
         // supply your own gyro offsets here, scaled for min sensitivity
-        mpu.setXGyroOffset(mpu_cfg->x_gyro_offset);
-        mpu.setYGyroOffset(mpu_cfg->y_gyro_offset);
-        mpu.setZGyroOffset(mpu_cfg->z_gyro_offset);
-        mpu.setXAccelOffset(mpu_cfg->x_accel_offset);
-        mpu.setYAccelOffset(mpu_cfg->y_accel_offset);
-        mpu.setZAccelOffset(mpu_cfg->z_accel_offset); // 1688 factory default for my test chip
+        applyOffsets(mpu_cfg);
     }
     else
     {
-        // 启动自动校准
-        // 7次循环自动校正
-        mpu.CalibrateAccel(7);
-        mpu.CalibrateGyro(7);
-        mpu.PrintActiveOffsets();
-
-        mpu_cfg->x_gyro_offset = mpu.getXGyroOffset();
-        mpu_cfg->y_gyro_offset = mpu.getYGyroOffset();
-        mpu_cfg->z_gyro_offset = mpu.getZGyroOffset();
-        mpu_cfg->x_accel_offset = mpu.getXAccelOffset();
-        mpu_cfg->y_accel_offset = mpu.getYAccelOffset();
-        mpu_cfg->z_accel_offset = mpu.getZAccelOffset();
+        int16_t temperature = readTemperature();
+        if (loadCalibration(mpu_cfg) && abs(temperature - mpu_cfg->temperature) <= IMU_CALI_TEMP_DELTA &&
+            !calibration_stale(mpu_cfg->timestamp))
+        {
+            // 复用保存的校准数据，零偏的小幅漂移交给后台增量校准
+            Serial.printf("MPU6050 use stored calibration (%d.%02d C)\n",
+                          mpu_cfg->temperature / 100, abs(mpu_cfg->temperature % 100));
+            applyOffsets(mpu_cfg);
+        }
+        else
+        {
+            fullCalibration(mpu_cfg);
+            saveCalibration(mpu_cfg);
+        }
+        m_recalibrate = true;
     }
 
+    if (!startSampling())
+    {
+        Serial.print(F("MPU6050 FIFO sampling unavailable, fall back to polling.\n"));
+    }
+    // 初始化在后台任务中进行，完成之前主循环不读取
+    m_present = true;
     Serial.print(F("Initialization MPU6050 success.\n"));
 }
 
@@ -89,8 +146,23 @@ bool IMU::Encoder_GetIsPush(void)
 ImuAction *IMU::update(int interval)
 {
     getVirtureMotion6(&action_info);
+    if (ACTIVE_TYPE::UNKNOWN != m_pending)
+    {
+        // 前后倾斜待定期间每次采样都检查，不再阻塞等待
+        resolvePending();
+        return &action_info;
+    }
+    if (m_waitLevel)
+    {
+        // 长按后继续保持倾斜不算新的动作
+        if (action_info.v_ax <= 5000 && action_info.v_ax >= -5000)
+        {
+            m_waitLevel = false;
+        }
+        return &action_info;
+    }
     // 原先判断的只是加速度，现在要加上陀螺仪
-    if (millis() - last_update_time > interval)
+    if (millis() - last_update_time > (unsigned long)interval)
     {
         if (!action_info.isValid)
         {
@@ -123,29 +195,14 @@ ImuAction *IMU::update(int interval)
         {
             if (action_info.v_ax > 5000)
             {
-                action_info.isValid = 1;
-                action_info.active = ACTIVE_TYPE::UP;
-                delay(500);
-                getVirtureMotion6(&action_info);
-                if (action_info.v_ax > 5000)
-                {
-                    action_info.isValid = 1;
-                    action_info.active = ACTIVE_TYPE::GO_FORWORD;
-                    encoder_state = LV_INDEV_STATE_PR;
-                }
+                // 先不上报，保持一段时间后再区分"UP"和"GO_FORWORD"
+                m_pending = ACTIVE_TYPE::UP;
+                m_pendingMillis = millis();
             }
             else if (action_info.v_ax < -5000)
             {
-                action_info.isValid = 1;
-                action_info.active = ACTIVE_TYPE::DOWN;
-                delay(500);
-                getVirtureMotion6(&action_info);
-                if (action_info.v_ax < -5000)
-                {
-                    action_info.isValid = 1;
-                    action_info.active = ACTIVE_TYPE::RETURN;
-                    encoder_state = LV_INDEV_STATE_REL;
-                }
+                m_pending = ACTIVE_TYPE::DOWN;
+                m_pendingMillis = millis();
             }
             else if (action_info.v_ax > 1000 || action_info.v_ax < -1000)
             {
@@ -164,11 +221,54 @@ ImuAction *IMU::update(int interval)
     return &action_info;
 }
 
+void IMU::resolvePending()
+{
+    bool holding = ACTIVE_TYPE::UP == m_pending ? action_info.v_ax > 5000 : action_info.v_ax < -5000;
+    if (holding && millis() - m_pendingMillis < IMU_HOLD_TIME)
+    {
+        return;
+    }
+    // 保持到时间为长按；提前回正则立即上报短按，不必等满时间
+    action_info.isValid = 1;
+    if (!holding)
+    {
+        action_info.active = m_pending;
+    }
+    else if (ACTIVE_TYPE::UP == m_pending)
+    {
+        m_waitLevel = true;
+        action_info.active = ACTIVE_TYPE::GO_FORWORD;
+        encoder_state = LV_INDEV_STATE_PR;
+    }
+    else
+    {
+        m_waitLevel = true;
+        action_info.active = ACTIVE_TYPE::RETURN;
+        encoder_state = LV_INDEV_STATE_REL;
+    }
+    m_pending = ACTIVE_TYPE::UNKNOWN;
+    last_update_time = millis();
+}
+
 ImuAction *IMU::getAction(void)
 {
+    if (m_sampling)
+    {
+        return getBufferedAction();
+    }
+    if (!m_present || i2c_bus_running())
+    {
+        // 没有MPU6050，或总线任务已接管Wire而IMU不在其中：主循环不能再访问Wire
+        return &action_info;
+    }
     // 基本方法: 通过对近来的动作数据简单的分析，确定出动作的类型
     ImuAction tmp_info;
     getVirtureMotion6(&tmp_info);
+    if (m_savePending)
+    {
+        m_savePending = false;
+        saveCalibration(m_cfg);
+    }
 
     // Serial.printf("gx = %d\tgy = %d\tgz = %d", tmp_info.v_gx, tmp_info.v_gy, tmp_info.v_gz);
     // Serial.printf("\tax = %d\tay = %d\taz = %d\n", tmp_info.v_ax, tmp_info.v_ay, tmp_info.v_az);
@@ -260,36 +360,498 @@ ImuAction *IMU::getAction(void)
 
 void IMU::getVirtureMotion6(ImuAction *action_info)
 {
+    if (!m_present || i2c_bus_running())
+    {
+        // 没有MPU6050，或Wire归总线任务所有：取它最近读到的样本，没有时视为静止
+        GestureSample latest = {0, 0, 0, 16384, 0, 0, 0};
+        if (m_sampling)
+        {
+            m_latest.read(&latest);
+        }
+        action_info->v_ax = latest.ax;
+        action_info->v_ay = latest.ay;
+        action_info->v_az = latest.az;
+        action_info->v_gx = latest.gx;
+        action_info->v_gy = latest.gy;
+        action_info->v_gz = latest.gz;
+        return;
+    }
     mpu.getMotion6(&(action_info->v_ax), &(action_info->v_ay),
                    &(action_info->v_az), &(action_info->v_gx),
                    &(action_info->v_gy), &(action_info->v_gz));
+    m_rawAccel[0] = action_info->v_ax;
+    m_rawAccel[1] = action_info->v_ay;
+    m_rawAccel[2] = action_info->v_az;
+    m_rawGyro[0] = action_info->v_gx;
+    m_rawGyro[1] = action_info->v_gy;
+    m_rawGyro[2] = action_info->v_gz;
+    recalibrationTick();
+
+    orient(action_info->v_ax, action_info->v_ay, action_info->v_az,
+           action_info->v_gx, action_info->v_gy, action_info->v_gz);
+}
 
+void IMU::orient(int16_t &ax, int16_t &ay, int16_t &az, int16_t &gx, int16_t &gy, int16_t &gz)
+{
     if (order & X_DIR_TYPE)
     {
-        action_info->v_ax = -action_info->v_ax;
-        action_info->v_gx = -action_info->v_gx;
+        ax = -ax;
+        gx = -gx;
     }
 
     if (order & Y_DIR_TYPE)
     {
-        action_info->v_ay = -action_info->v_ay;
-        action_info->v_gy = -action_info->v_gy;
+        ay = -ay;
+        gy = -gy;
     }
 
     if (order & Z_DIR_TYPE)
     {
-        action_info->v_az = -action_info->v_az;
-        action_info->v_gz = -action_info->v_gz;
+        az = -az;
+        gz = -gz;
     }
 
     if (order & XY_DIR_TYPE)
     {
         int16_t swap_tmp;
-        swap_tmp = action_info->v_ax;
-        action_info->v_ax = action_info->v_ay;
-        action_info->v_ay = swap_tmp;
-        swap_tmp = action_info->v_gx;
-        action_info->v_gx = action_info->v_gy;
-        action_info->v_gy = swap_tmp;
-    }
-}
\ No newline at end of file
+        swap_tmp = ax;
+        ax = ay;
+        ay = swap_tmp;
+        swap_tmp = gx;
+        gx = gy;
+        gy = swap_tmp;
+    }
+}
+
+int16_t IMU::readTemperature()
+{
+    // 数据手册：温度(℃) = raw / 340 + 36.53
+    return (int32_t)mpu.getTemperature() * 100 / 340 + 3653;
+}
+
+void IMU::applyOffsets(const SysMpuConfig *cfg)
+{
+    mpu.setXGyroOffset(cfg->x_gyro_offset);
+    mpu.setYGyroOffset(cfg->y_gyro_offset);
+    mpu.setZGyroOffset(cfg->z_gyro_offset);
+    mpu.setXAccelOffset(cfg->x_accel_offset);
+    mpu.setYAccelOffset(cfg->y_accel_offset);
+    mpu.setZAccelOffset(cfg->z_accel_offset); // 1688 factory default for my test chip
+}
+
+void IMU::fullCalibration(SysMpuConfig *cfg)
+{
+    Serial.print(F("Initialization MPU6050 now, Please don't move.\n"));
+    // 启动自动校准
+    // 7次循环自动校正
+    mpu.CalibrateAccel(7);
+    mpu.CalibrateGyro(7);
+    mpu.PrintActiveOffsets();
+
+    cfg->x_gyro_offset = mpu.getXGyroOffset();
+    cfg->y_gyro_offset = mpu.getYGyroOffset();
+    cfg->z_gyro_offset = mpu.getZGyroOffset();
+    cfg->x_accel_offset = mpu.getXAccelOffset();
+    cfg->y_accel_offset = mpu.getYAccelOffset();
+    cfg->z_accel_offset = mpu.getZAccelOffset();
+    cfg->temperature = readTemperature();
+    cfg->valid = 1;
+}
+
+bool IMU::loadCalibration(SysMpuConfig *cfg)
+{
+    cfg->valid = settings_get_u32(IMU_CALI_PREFIX "valid", 0);
+    cfg->x_gyro_offset = settings_get_i32(IMU_CALI_PREFIX "x_gyro", 0);
+    cfg->y_gyro_offset = settings_get_i32(IMU_CALI_PREFIX "y_gyro", 0);
+    cfg->z_gyro_offset = settings_get_i32(IMU_CALI_PREFIX "z_gyro", 0);
+    cfg->x_accel_offset = settings_get_i32(IMU_CALI_PREFIX "x_accel", 0);
+    cfg->y_accel_offset = settings_get_i32(IMU_CALI_PREFIX "y_accel", 0);
+    cfg->z_accel_offset = settings_get_i32(IMU_CALI_PREFIX "z_accel", 0);
+    cfg->temperature = settings_get_i32(IMU_CALI_PREFIX "temp", 0);
+    cfg->timestamp = settings_get_u32(IMU_CALI_PREFIX "time", 0);
+    return cfg->valid;
+}
+
+void IMU::saveCalibration(const SysMpuConfig *cfg)
+{
+    SysMpuConfig saved = *cfg;
+    // 未同步网络时间时记录开机后的秒数
+    time_t now = time(NULL);
+    saved.timestamp = now > (time_t)IMU_TIME_VALID ? (uint32_t)now : millis() / 1000;
+
+    // 一次批量修改，掉电时不会留下一半新一半旧的offset
+    if (settings_begin())
+    {
+        settings_set_i32(IMU_CALI_PREFIX "x_gyro", saved.x_gyro_offset);
+        settings_set_i32(IMU_CALI_PREFIX "y_gyro", saved.y_gyro_offset);
+        settings_set_i32(IMU_CALI_PREFIX "z_gyro", saved.z_gyro_offset);
+        settings_set_i32(IMU_CALI_PREFIX "x_accel", saved.x_accel_offset);
+        settings_set_i32(IMU_CALI_PREFIX "y_accel", saved.y_accel_offset);
+        settings_set_i32(IMU_CALI_PREFIX "z_accel", saved.z_accel_offset);
+        settings_set_i32(IMU_CALI_PREFIX "temp", saved.temperature);
+        settings_set_u32(IMU_CALI_PREFIX "time", saved.timestamp);
+        settings_set_u32(IMU_CALI_PREFIX "valid", 1);
+        settings_commit();
+    }
+    m_lastSaveMillis = millis();
+}
+
+void IMU::recalibrationTick()
+{
+    int16_t bias[3];
+    if (!m_recalibrate || NULL == m_cfg || !m_biasTracker.feed(m_rawGyro, m_rawAccel, bias))
+    {
+        return;
+    }
+    if (abs(bias[0]) < IMU_RECAL_MIN_BIAS && abs(bias[1]) < IMU_RECAL_MIN_BIAS &&
+        abs(bias[2]) < IMU_RECAL_MIN_BIAS)
+    {
+        // 校准仍然准确：很久没保存过时更新校准时间，免得开机时被当作过期数据
+        if (millis() - m_lastSaveMillis >= IMU_CALI_REFRESH_INTERVAL)
+        {
+            m_cfg->temperature = readTemperature();
+            m_savePending = true;
+        }
+        return;
+    }
+    // offset寄存器以±1000dps量程为单位，是±250dps量程原始值的4倍
+    m_cfg->x_gyro_offset -= (bias[0] + (bias[0] > 0 ? 2 : -2)) / 4;
+    m_cfg->y_gyro_offset -= (bias[1] + (bias[1] > 0 ? 2 : -2)) / 4;
+    m_cfg->z_gyro_offset -= (bias[2] + (bias[2] > 0 ? 2 : -2)) / 4;
+    m_cfg->temperature = readTemperature();
+    mpu.setXGyroOffset(m_cfg->x_gyro_offset);
+    mpu.setYGyroOffset(m_cfg->y_gyro_offset);
+    mpu.setZGyroOffset(m_cfg->z_gyro_offset);
+    Serial.printf("MPU6050 gyro bias %d %d %d, offsets %d %d %d\n", bias[0], bias[1], bias[2],
+                  m_cfg->x_gyro_offset, m_cfg->y_gyro_offset, m_cfg->z_gyro_offset);
+    // 限制写flash的频率
+    if (millis() - m_lastSaveMillis >= IMU_CALI_SAVE_INTERVAL)
+    {
+        m_savePending = true;
+    }
+}
+
+void IMU::configureRawFifo()
+{
+    // 陀螺仪输出率1kHz（DLPF 42Hz），分频后得到固定的采样率
+    mpu.setDLPFMode(MPU6050_DLPF_BW_42);
+    mpu.setRate(IMU_SAMPLE_DIV);
+    mpu.setFIFOEnabled(false);
+    mpu.setAccelFIFOEnabled(true);
+    mpu.setXGyroFIFOEnabled(true);
+    mpu.setYGyroFIFOEnabled(true);
+    mpu.setZGyroFIFOEnabled(true);
+    mpu.resetFIFO();
+    mpu.setFIFOEnabled(true);
+
+    // 同时清除DMP模式设置的中断
+    mpu.setIntEnabled(IMU_INT_PIN >= 0 ? 1 << MPU6050_INTERRUPT_DATA_RDY_BIT : 0);
+    if (IMU_INT_PIN >= 0)
+    {
+        mpu.setInterruptMode(false);  // 高电平有效
+        mpu.setInterruptDrive(false); // 推挽输出
+        mpu.setInterruptLatch(false); // 50us脉冲
+    }
+}
+
+bool IMU::startSampling()
+{
+    configureRawFifo();
+
+    if (i2c_bus_add("imu", imu_bus_job, this, IMU_FIFO_BURST * GESTURE_SAMPLE_PERIOD, I2C_PRIORITY_HIGH) < 0)
+    {
+        mpu.setFIFOEnabled(false);
+        return false;
+    }
+    m_sampling = true;
+
+    if (IMU_INT_PIN >= 0)
+    {
+        pinMode(IMU_INT_PIN, INPUT);
+        attachInterrupt(IMU_INT_PIN, imu_data_ready_isr, RISING);
+    }
+    return true;
+}
+
+void IMU::busPoll()
+{
+    if (m_wantMode != m_mode)
+    {
+        switchMode(m_wantMode);
+    }
+    if (IMU_FIFO_DMP == m_mode)
+    {
+        readDmpFifo();
+    }
+    else
+    {
+        readFifo();
+    }
+}
+
+void IMU::switchMode(IMU_FIFO_MODE mode)
+{
+    if (IMU_FIFO_DMP == mode)
+    {
+        // dmpInitialize() 会复位芯片，之后要重新写入校准数据
+        if (0 == mpu.dmpInitialize())
+        {
+            applyOffsets(m_cfg);
+            mpu.setDMPEnabled(true);
+            m_mode = IMU_FIFO_DMP;
+            Serial.print(F("MPU6050 DMP orientation on\n"));
+            return;
+        }
+        Serial.print(F("MPU6050 DMP init failed\n"));
+        m_wantMode = IMU_FIFO_RAW;
+    }
+    else
+    {
+        mpu.setDMPEnabled(false);
+        Serial.print(F("MPU6050 DMP orientation off\n"));
+    }
+    // 恢复原始数据的量程、时钟和FIFO设置
+    mpu.initialize();
+    applyOffsets(m_cfg);
+    configureRawFifo();
+    m_mode = IMU_FIFO_RAW;
+}
+
+void IMU::readFifo()
+{
+    uint8_t buf[IMU_FIFO_SAMPLE_BYTES * 20]; // getFIFOBytes() 单次最多读255字节
+    uint16_t count = mpu.getFIFOCount();
+    if (count >= IMU_FIFO_SIZE - IMU_FIFO_SAMPLE_BYTES)
+    {
+        // FIFO已溢出，数据不再按样本对齐，只能清空重来
+        Serial.print(F("MPU6050 FIFO overflow\n"));
+        mpu.resetFIFO();
+        return;
+    }
+    count -= count % IMU_FIFO_SAMPLE_BYTES;
+    while (count > 0)
+    {
+        uint16_t len = count < sizeof(buf) ? count : sizeof(buf);
+        mpu.getFIFOBytes(buf, len);
+        count -= len;
+        for (uint8_t *p = buf; p < buf + len; p += IMU_FIFO_SAMPLE_BYTES)
+        {
+            GestureSample sample;
+            sample.ms = m_sampleCount * GESTURE_SAMPLE_PERIOD;
+            sample.ax = (int16_t)((p[0] << 8) | p[1]);
+            sample.ay = (int16_t)((p[2] << 8) | p[3]);
+            sample.az = (int16_t)((p[4] << 8) | p[5]);
+            sample.gx = (int16_t)((p[6] << 8) | p[7]);
+            sample.gy = (int16_t)((p[8] << 8) | p[9]);
+            sample.gz = (int16_t)((p[10] << 8) | p[11]);
+
+            if (0 == m_sampleCount % IMU_RECAL_DECIMATION)
+            {
+                m_rawAccel[0] = sample.ax;
+                m_rawAccel[1] = sample.ay;
+                m_rawAccel[2] = sample.az;
+                m_rawGyro[0] = sample.gx;
+                m_rawGyro[1] = sample.gy;
+                m_rawGyro[2] = sample.gz;
+                recalibrationTick();
+            }
+            ++m_sampleCount;
+            pushSample(&sample);
+        }
+    }
+}
+
+void IMU::readDmpFifo()
+{
+    uint8_t packet[64];
+    uint16_t size = mpu.dmpGetFIFOPacketSize();
+    uint16_t count = mpu.getFIFOCount();
+    if (count > IMU_FIFO_SIZE - size)
+    {
+        Serial.print(F("MPU6050 FIFO overflow\n"));
+        mpu.resetFIFO();
+        return;
+    }
+    for (; count >= size; count -= size)
+    {
+        int16_t quat[4];
+        mpu.getFIFOBytes(packet, size);
+        mpu.dmpGetQuaternion(quat, packet);
+        float w = quat[0] / IMU_DMP_QUAT_ONE;
+        float x = quat[1] / IMU_DMP_QUAT_ONE;
+        float y = quat[2] / IMU_DMP_QUAT_ONE;
+        float z = quat[3] / IMU_DMP_QUAT_ONE;
+
+        // 动作识别仍然需要样本：由姿态算出重力方向代替加速度，倾斜类动作照常识别
+        GestureSample sample;
+        int16_t gyro[3];
+        mpu.dmpGetGyro(gyro, packet);
+        sample.ms = m_sampleCount * GESTURE_SAMPLE_PERIOD;
+        sample.ax = (int16_t)(2 * (x * z - w * y) * 16384);
+        sample.ay = (int16_t)(2 * (w * x + y * z) * 16384);
+        sample.az = (int16_t)((w * w - x * x - y * y + z * z) * 16384);
+        sample.gx = dmp_gyro_raw(gyro[0]);
+        sample.gy = dmp_gyro_raw(gyro[1]);
+        sample.gz = dmp_gyro_raw(gyro[2]);
+        ++m_sampleCount;
+
+        ImuOrientation orientation = {{w, x, y, z}, sample.ms};
+        m_orientation.write(orientation);
+        pushSample(&sample);
+    }
+}
+
+void IMU::pushSample(GestureSample *sample)
+{
+    orient(sample->ax, sample->ay, sample->az, sample->gx, sample->gy, sample->gz);
+    m_latest.write(*sample);
+
+    portENTER_CRITICAL(&m_ringMux);
+    if (m_ringHead - m_ringTail >= IMU_RING_LEN)
+    {
+        ++m_ringTail;
+        ++m_ringDropped;
+    }
+    m_ring[m_ringHead % IMU_RING_LEN] = *sample;
+    ++m_ringHead;
+    portEXIT_CRITICAL(&m_ringMux);
+}
+
+bool IMU::setOrientationMode(bool enable)
+{
+    if (!m_sampling)
+    {
+        return false;
+    }
+    m_wantMode = enable ? IMU_FIFO_DMP : IMU_FIFO_RAW;
+    return true;
+}
+
+bool IMU::getOrientation(float q[4], uint32_t *ms)
+{
+    ImuOrientation orientation;
+    uint32_t seq = m_orientation.read(&orientation);
+    if (IMU_FIFO_DMP != m_mode || 0 == seq || seq == m_orientationSeen)
+    {
+        return false;
+    }
+    m_orientationSeen = seq;
+    memcpy(q, orientation.q, sizeof(orientation.q));
+    *ms = orientation.ms;
+#ifdef IMU_TRACE
+    Serial.printf("quat,%u,%.5f,%.5f,%.5f,%.5f\n", *ms, q[0], q[1], q[2], q[3]);
+#endif
+    return true;
+}
+
+bool IMU::popSample(GestureSample *sample)
+{
+    bool ret = false;
+    portENTER_CRITICAL(&m_ringMux);
+    if (m_ringTail != m_ringHead)
+    {
+        *sample = m_ring[m_ringTail % IMU_RING_LEN];
+        ++m_ringTail;
+        ret = true;
+    }
+    portEXIT_CRITICAL(&m_ringMux);
+    return ret;
+}
+
+void IMU::pushEvent(ACTIVE_TYPE type)
+{
+    if (m_eventNum >= IMU_EVENT_LEN)
+    {
+        // 主循环来不及处理时保留最新的动作
+        m_eventHead = (m_eventHead + 1) % IMU_EVENT_LEN;
+        --m_eventNum;
+    }
+    m_events[(m_eventHead + m_eventNum) % IMU_EVENT_LEN] = type;
+    ++m_eventNum;
+}
+
+ImuAction *IMU::getBufferedAction()
+{
+    GestureSample sample;
+    bool updated = false;
+    while (popSample(&sample))
+    {
+        updated = true;
+        ACTIVE_TYPE type = m_recognizer.feed(sample);
+#ifdef IMU_TRACE
+        Serial.printf("imu,%u,%d,%d,%d,%d,%d,%d\n", sample.ms, sample.ax, sample.ay, sample.az,
+                      sample.gx, sample.gy, sample.gz);
+        if (UNKNOWN != type)
+        {
+            Serial.printf("event,%u,%s\n", sample.ms, active_type_info[type]);
+        }
+#endif
+        if (UNKNOWN != type)
+        {
+            pushEvent(type);
+        }
+    }
+    if (updated)
+    {
+        action_info.v_ax = sample.ax;
+        action_info.v_ay = sample.ay;
+        action_info.v_az = sample.az;
+        action_info.v_gx = sample.gx;
+        action_info.v_gy = sample.gy;
+        action_info.v_gz = sample.gz;
+    }
+    if (m_savePending)
+    {
+        m_savePending = false;
+        saveCalibration(m_cfg);
+    }
+
+    // 每次只交出一个动作，其余的留给下次调用
+    if (!action_info.isValid && m_eventNum > 0)
+    {
+        action_info.isValid = 1;
+        action_info.active = m_events[m_eventHead];
+        m_eventHead = (m_eventHead + 1) % IMU_EVENT_LEN;
+        --m_eventNum;
+    }
+    return &action_info;
+}
+
+void GyroBiasTracker::reset()
+{
+    sum[0] = sum[1] = sum[2] = 0;
+    count = 0;
+}
+
+bool GyroBiasTracker::feed(const int16_t gyro[3], const int16_t accel[3], int16_t bias[3])
+{
+    bool still = true;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        if (abs(gyro[axis]) > IMU_STILL_GYRO_LIMIT ||
+            (count > 0 && abs(accel[axis] - last_accel[axis]) > IMU_STILL_ACCEL_DELTA))
+        {
+            still = false;
+        }
+        last_accel[axis] = accel[axis];
+    }
+    if (!still)
+    {
+        reset();
+        return false;
+    }
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        sum[axis] += gyro[axis];
+    }
+    if (++count < IMU_RECAL_SAMPLES)
+    {
+        return false;
+    }
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        bias[axis] = sum[axis] / count;
+    }
+    reset();
+    return true;
+}
@@ -2,28 +2,17 @@
 #define IMU_H
 
 #include <I2Cdev.h>
-#include <MPU6050.h>
+#include <MPU6050_6Axis_MotionApps20.h> // 带DMP的MPU6050类型（转台模式用DMP输出姿态）
 #include "lv_port_indev.h"
+#include "gesture.h"
+#include "i2c_bus.h"
 #include <list>
 #define ACTION_HISTORY_BUF_LEN 5
+#define IMU_HOLD_TIME 500 // update() 中前后倾斜保持该时间（ms）视为长按
 
 extern int32_t encoder_diff;
 extern lv_indev_state_t encoder_state;
 
-extern const char *active_type_info[];
-
-enum ACTIVE_TYPE
-{
-    TURN_RIGHT = 0,
-    RETURN,
-    TURN_LEFT,
-    UP,
-    DOWN,
-    GO_FORWORD,
-    SHAKE,
-    UNKNOWN
-};
-
 // 方向类型
 enum MPU_DIR_TYPE
 {
@@ -43,6 +32,62 @@ struct SysMpuConfig
     int16_t x_accel_offset;
     int16_t y_accel_offset;
     int16_t z_accel_offset;
+
+    int16_t temperature; // 校准时的芯片温度（0.01℃）
+    uint32_t timestamp;  // 校准时间（unix时间，未同步时为开机后的秒数）
+    uint8_t valid;       // 是否已有校准数据
+};
+
+// 校准数据保存在设置中（见 sys/settings.h），开机时温度相差不大则直接复用，跳过完整校准
+#define IMU_CALI_PREFIX "imu."
+#define IMU_CALI_TEMP_DELTA 800          // 温度变化超过该值（0.01℃）时重新完整校准
+#define IMU_CALI_SAVE_INTERVAL 600000UL  // 后台校准结果写入flash的最小间隔（ms）
+#define IMU_CALI_REFRESH_INTERVAL 86400000UL // 零偏无需调整时，隔这么久也重新保存一次以更新校准时间（ms）
+#define IMU_CALI_MAX_AGE (30UL * 24 * 3600) // 校准时间早于该时长（s）时重新完整校准
+#define IMU_TIME_VALID 1600000000UL      // 大于该值的时间视为已同步的unix时间
+
+// 后台增量校准：设备静止时统计陀螺仪的零偏并修正offset
+#define IMU_STILL_GYRO_LIMIT 300  // 静止时陀螺仪原始值的上限（±250dps量程下约2.3dps）
+#define IMU_STILL_ACCEL_DELTA 400 // 相邻两次采样加速度原始值的最大变化
+#define IMU_RECAL_SAMPLES 64      // 连续静止的采样次数达到该值后更新一次零偏
+#define IMU_RECAL_MIN_BIAS 4      // 零偏（原始值）小于该值时不调整
+
+struct GyroBiasTracker
+{
+    int32_t sum[3];
+    int16_t last_accel[3];
+    uint16_t count;
+
+    void reset();
+    // 输入一次原始采样，连续静止足够久时返回true，平均零偏写入bias
+    bool feed(const int16_t gyro[3], const int16_t accel[3], int16_t bias[3]);
+};
+
+// FIFO采样：MPU6050以固定采样率写入FIFO，I2C总线任务（见 i2c_bus.h）成批读出放入环形缓冲区，
+// getAction() 在主循环中把新样本交给 GestureRecognizer
+#define IMU_INT_PIN -1              // MPU6050 INT引脚，未连接时为-1（按固定间隔读取FIFO）
+#define IMU_SAMPLE_DIV (GESTURE_SAMPLE_PERIOD - 1) // 1kHz/(1+div)，DLPF开启时陀螺仪输出率为1kHz
+#define IMU_FIFO_SAMPLE_BYTES 12    // 加速度+陀螺仪
+#define IMU_FIFO_SIZE 1024
+#define IMU_FIFO_BURST 4            // 每攒够这么多个样本读一次FIFO
+#define IMU_RING_LEN 128            // 环形缓冲区（样本数），主循环卡顿时丢弃最旧的样本
+#define IMU_EVENT_LEN 4             // 待处理的动作
+#define IMU_RECAL_DECIMATION 20     // 后台增量校准每隔多少个样本取一次
+#define IMU_DMP_QUAT_ONE 16384.0f  // DMP四元数的定点比例
+#define IMU_DMP_GYRO_SCALE 8        // DMP包中的陀螺仪为±2000dps量程，乘以该值换算为±250dps量程的原始值
+// #define IMU_TRACE                // 打开后从串口输出全部样本和识别结果（供 tools/gesture_replay.cpp 回放）
+
+// FIFO中的数据格式
+enum IMU_FIFO_MODE : unsigned char
+{
+    IMU_FIFO_RAW = 0, // 加速度+陀螺仪原始数据
+    IMU_FIFO_DMP      // DMP姿态数据包（四元数）
+};
+
+struct ImuOrientation
+{
+    float q[4]; // w, x, y, z
+    uint32_t ms;
 };
 
 struct ImuAction
@@ -65,6 +110,34 @@ private:
     int flag;
     long last_update_time;
     uint8_t order; // 表示方位，x与y是否对换
+    SysMpuConfig *m_cfg;
+    bool m_recalibrate; // 是否进行后台增量校准
+    GyroBiasTracker m_biasTracker;
+    int16_t m_rawGyro[3]; // 最近一次未经方向变换的原始数据
+    int16_t m_rawAccel[3];
+    unsigned long m_lastSaveMillis;
+    volatile bool m_savePending; // 由主循环写flash，不阻塞I2C总线任务的采样
+
+    volatile bool m_present; // MPU6050已连接并完成初始化（后台任务中）
+    bool m_sampling; // 已由I2C总线任务读取FIFO
+    Snapshot<GestureSample> m_latest; // 最新的样本（已做方向变换），总线任务写入
+    GestureRecognizer m_recognizer;
+    GestureSample m_ring[IMU_RING_LEN];
+    uint32_t m_ringHead; // 写入计数（采样任务）
+    uint32_t m_ringTail; // 读取计数（主循环）
+    uint32_t m_ringDropped;
+    portMUX_TYPE m_ringMux;
+    uint32_t m_sampleCount;
+    ACTIVE_TYPE m_events[IMU_EVENT_LEN];
+    uint8_t m_eventHead;
+    uint8_t m_eventNum;
+    volatile IMU_FIFO_MODE m_wantMode; // 由主循环设置，采样任务负责切换
+    IMU_FIFO_MODE m_mode;
+    Snapshot<ImuOrientation> m_orientation; // 最新的姿态，总线任务写入
+    uint32_t m_orientationSeen;
+    ACTIVE_TYPE m_pending; // update() 中待区分的前后倾斜（UP/DOWN）
+    unsigned long m_pendingMillis;
+    bool m_waitLevel; // 长按已上报，回正前不再识别前后倾斜
 
 public:
     ImuAction action_info;
@@ -81,6 +154,30 @@ public:
     ImuAction *update(int interval);
     ImuAction *getAction(void); // 获取动作
     void getVirtureMotion6(ImuAction *action_info);
+    void busPoll(); // 在I2C总线任务中周期执行：读取FIFO
+    // 打开后FIFO改为输出DMP姿态，用 getOrientation() 读取；需要FIFO采样可用
+    bool setOrientationMode(bool enable);
+    // 取出最新的姿态四元数（w, x, y, z），自上次读取后没有新数据时返回false
+    bool getOrientation(float q[4], uint32_t *ms);
+
+private:
+    int16_t readTemperature(); // 0.01℃
+    void applyOffsets(const SysMpuConfig *cfg);
+    void fullCalibration(SysMpuConfig *cfg);
+    bool loadCalibration(SysMpuConfig *cfg);
+    void saveCalibration(const SysMpuConfig *cfg);
+    void recalibrationTick();
+    void resolvePending();
+    void orient(int16_t &ax, int16_t &ay, int16_t &az, int16_t &gx, int16_t &gy, int16_t &gz);
+    bool startSampling();
+    void configureRawFifo();
+    void switchMode(IMU_FIFO_MODE mode);
+    void readFifo();
+    void readDmpFifo();
+    void pushSample(GestureSample *sample);
+    bool popSample(GestureSample *sample);
+    void pushEvent(ACTIVE_TYPE type);
+    ImuAction *getBufferedAction();
 };
 
 #endif
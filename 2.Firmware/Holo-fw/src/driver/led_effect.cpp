@@ -0,0 +1,204 @@
+#include "led_effect.h"
+
+#include <math.h>
+#include <string.h>
+
+static uint8_t gamma_table[256];
+static LedColor hue_table[256]; // 饱和度和亮度最大时各色相的颜色
+
+static inline uint8_t scale8(uint8_t value, uint8_t scale)
+{
+    return (uint8_t)(((uint16_t)value * (scale + 1)) >> 8);
+}
+
+void led_tables_init()
+{
+    for (int pos = 0; pos < 256; ++pos)
+    {
+        uint8_t value = (uint8_t)(powf(pos / 255.0f, LED_GAMMA) * 255 + 0.5f);
+        // 非零输入至少点亮一级，避免渐变的暗端提前熄灭
+        gamma_table[pos] = (pos > 0 && 0 == value) ? 1 : value;
+
+        // 六段线性的色相环
+        int sector = pos * 6 / 256;
+        uint8_t up = (uint8_t)(pos * 6 - sector * 256);
+        uint8_t down = 255 - up;
+        LedColor *color = &hue_table[pos];
+        switch (sector)
+        {
+        case 0: *color = {255, up, 0}; break;
+        case 1: *color = {down, 255, 0}; break;
+        case 2: *color = {0, 255, up}; break;
+        case 3: *color = {0, down, 255}; break;
+        case 4: *color = {up, 0, 255}; break;
+        default: *color = {255, 0, down}; break;
+        }
+    }
+}
+
+uint8_t led_gamma(uint8_t value)
+{
+    return gamma_table[value];
+}
+
+void led_hsv_to_rgb(uint8_t hue, uint8_t sat, uint8_t val, LedColor *out)
+{
+    const LedColor &base = hue_table[hue];
+    // 饱和度向白色插值，再按亮度缩放
+    out->r = scale8(val, 255 - scale8(sat, 255 - base.r));
+    out->g = scale8(val, 255 - scale8(sat, 255 - base.g));
+    out->b = scale8(val, 255 - scale8(sat, 255 - base.b));
+}
+
+LedEffect::LedEffect() : m_pos(0), m_brightness(0), m_brightness_step(0), m_duty(255),
+                         m_hsv(false), m_rainbow(false)
+{
+    memset(&m_param, 0, sizeof(m_param));
+    memset(m_value, 0, sizeof(m_value));
+    memset(m_step, 0, sizeof(m_step));
+}
+
+void LedEffect::setRGB(uint8_t r, uint8_t g, uint8_t b)
+{
+    m_param.effect = LED_EFFECT_SOLID;
+    m_hsv = false;
+    m_rainbow = false;
+    m_value[0] = r;
+    m_value[1] = g;
+    m_value[2] = b;
+}
+
+void LedEffect::setHSV(uint8_t h, uint8_t s, uint8_t v)
+{
+    setRGB(h, s, v);
+    m_hsv = true;
+}
+
+void LedEffect::setRainbow(uint8_t first_hue, uint8_t last_hue)
+{
+    setRGB(first_hue, last_hue, 0);
+    m_rainbow = true;
+}
+
+void LedEffect::setDuty(uint8_t duty)
+{
+    m_duty = duty;
+}
+
+void LedEffect::start(const LedEffectParam &param)
+{
+    m_param = param;
+    for (int ch = 0; ch < 3; ++ch)
+    {
+        m_value[ch] = param.min_value[ch];
+        m_step[ch] = param.step[ch];
+    }
+    m_pos = 0;
+    m_brightness = param.min_brightness;
+    m_brightness_step = param.brightness_step;
+    m_hsv = LED_EFFECT_HSV_CYCLE == param.effect;
+    m_rainbow = false;
+}
+
+// 在[min, max]之间往返，到达端点时反向
+static void bounce(int16_t *value, int8_t *step, uint8_t min_value, uint8_t max_value)
+{
+    *value += *step;
+    if (*value >= max_value)
+    {
+        *value = max_value;
+        *step = -*step;
+    }
+    else if (*value <= min_value)
+    {
+        *value = min_value;
+        *step = -*step;
+    }
+}
+
+void LedEffect::step()
+{
+    if (LED_EFFECT_HSV_CYCLE == m_param.effect)
+    {
+        for (int ch = 0; ch < 3; ++ch)
+        {
+            bounce(&m_value[ch], &m_step[ch], m_param.min_value[ch], m_param.max_value[ch]);
+        }
+    }
+    else if (LED_EFFECT_RGB_CYCLE == m_param.effect)
+    {
+        // 所有通道共用第一个步长：R、G、B 依次升到最大，再按 B、G、R 依次降到最小
+        int8_t step = m_step[0];
+        int16_t *value = &m_value[m_pos];
+        uint8_t min_value = m_param.min_value[m_pos];
+        uint8_t max_value = m_param.max_value[m_pos];
+        *value += step;
+        if (step > 0 && *value >= max_value)
+        {
+            *value = max_value;
+            if (m_pos < 2)
+            {
+                ++m_pos;
+            }
+            else
+            {
+                m_step[0] = -step;
+            }
+        }
+        else if (step < 0 && *value <= min_value)
+        {
+            *value = min_value;
+            if (m_pos > 0)
+            {
+                --m_pos;
+            }
+            else
+            {
+                m_step[0] = -step;
+            }
+        }
+    }
+    else
+    {
+        return;
+    }
+
+    m_brightness += m_brightness_step;
+    if (m_brightness >= m_param.max_brightness)
+    {
+        m_brightness = m_param.max_brightness;
+        m_brightness_step = -m_brightness_step;
+    }
+    else if (m_brightness <= m_param.min_brightness)
+    {
+        m_brightness = m_param.min_brightness;
+        m_brightness_step = -m_brightness_step;
+    }
+}
+
+void LedEffect::render(LedColor *frame, int num) const
+{
+    // 固定颜色沿用原来的线性占空比，效果的亮度渐变按感知亮度经gamma校正
+    uint8_t scale = animated() ? gamma_table[m_brightness >> 8] : m_duty;
+    for (int pos = 0; pos < num; ++pos)
+    {
+        LedColor color;
+        if (m_rainbow)
+        {
+            int span = (int)(uint8_t)m_value[1] - (uint8_t)m_value[0];
+            uint8_t hue = m_value[0] + (num > 1 ? span * pos / (num - 1) : 0);
+            led_hsv_to_rgb(hue, 255, 255, &color);
+        }
+        else if (m_hsv)
+        {
+            led_hsv_to_rgb(m_value[0], m_value[1], m_value[2], &color);
+        }
+        else
+        {
+            color = {(uint8_t)m_value[0], (uint8_t)m_value[1], (uint8_t)m_value[2]};
+        }
+        frame[pos].r = scale8(color.r, scale);
+        frame[pos].g = scale8(color.g, scale);
+        frame[pos].b = scale8(color.b, scale);
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef LED_EFFECT_H
+#define LED_EFFECT_H
+
+#include <stdint.h>
+
+// RGB灯效果生成：只依赖标准头文件，可在PC上编译（见 tools/led_effect_check.cpp）
+// 全部为整数运算，查表在 led_tables_init() 中一次性生成，定时器回调里不做浮点运算
+#define LED_GAMMA 2.2f
+#define LED_BRIGHTNESS_MAX 65535 // 效果亮度的满量程（16位定点，便于小步长渐变）
+
+enum LED_EFFECT : unsigned char
+{
+    LED_EFFECT_SOLID = 0, // 固定颜色（RGB/HSV/彩虹）
+    LED_EFFECT_RGB_CYCLE, // R->G->B 依次渐变（原 led_rgbOnTimer）
+    LED_EFFECT_HSV_CYCLE  // H、S、V 各自往返（原 led_hsvOnTimer）
+};
+
+struct LedColor
+{
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+};
+
+struct LedEffectParam
+{
+    LED_EFFECT effect;
+    uint8_t min_value[3]; // RGB或HSV
+    uint8_t max_value[3];
+    int8_t step[3];
+    uint16_t min_brightness; // 感知亮度，输出前经过gamma校正
+    uint16_t max_brightness;
+    int16_t brightness_step;
+};
+
+void led_tables_init();
+uint8_t led_gamma(uint8_t value);
+// hue 0-255 对应一整圈色相
+void led_hsv_to_rgb(uint8_t hue, uint8_t sat, uint8_t val, LedColor *out);
+
+class LedEffect
+{
+private:
+    LedEffectParam m_param;
+    int16_t m_value[3]; // 当前的R/G/B或H/S/V
+    int8_t m_step[3];
+    uint8_t m_pos;      // RGB_CYCLE 当前调整的通道
+    int32_t m_brightness;
+    int16_t m_brightness_step;
+    uint8_t m_duty;     // 固定颜色的输出占空比（线性，与原 setBrightness 一致）
+    bool m_hsv;         // 固定颜色以HSV给出
+    bool m_rainbow;
+
+public:
+    LedEffect();
+    void setRGB(uint8_t r, uint8_t g, uint8_t b);
+    void setHSV(uint8_t h, uint8_t s, uint8_t v);
+    void setRainbow(uint8_t first_hue, uint8_t last_hue); // 各灯珠色相从first到last
+    void setDuty(uint8_t duty);
+    void start(const LedEffectParam &param);
+    bool animated() const { return LED_EFFECT_SOLID != m_param.effect; }
+    void step(); // 效果前进一步（定时器的一个周期）
+    void render(LedColor *frame, int num) const;
+};
+
+#endif
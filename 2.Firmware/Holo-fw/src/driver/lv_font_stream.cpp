@@ -0,0 +1,128 @@
+#include "lv_font_stream.h"
+#include <Arduino.h>
+
+struct StreamFont
+{
+    lv_font_t font; // 须放在第一个，lv_font_t* 与 StreamFont* 可互相转换
+    lv_fs_file_t file;
+    uint32_t pos; // 文件当前位置，连续读取时省去seek
+    bool mapped;  // 字体在映射的flash中，没有打开文件
+    GlyphFont glyphs;
+};
+
+static bool stream_read(void *ctx, uint32_t offset, void *buf, uint32_t len)
+{
+    StreamFont *stream = (StreamFont *)ctx;
+    if (stream->pos != offset && LV_FS_RES_OK != lv_fs_seek(&stream->file, offset, LV_FS_SEEK_SET))
+    {
+        return false;
+    }
+    uint32_t read_len = 0;
+    if (LV_FS_RES_OK != lv_fs_read(&stream->file, buf, len, &read_len) || read_len != len)
+    {
+        stream->pos = UINT32_MAX;
+        return false;
+    }
+    stream->pos = offset + len;
+    return true;
+}
+
+static bool stream_get_glyph_dsc(const lv_font_t *font, lv_font_glyph_dsc_t *dsc_out,
+                                 uint32_t unicode_letter, uint32_t unicode_letter_next)
+{
+    StreamFont *stream = (StreamFont *)font->dsc;
+    const GlyphDsc *glyph = stream->glyphs.glyph(unicode_letter);
+    if (NULL == glyph)
+    {
+        return false;
+    }
+    dsc_out->adv_w = glyph->adv_w;
+    dsc_out->box_w = glyph->box_w;
+    dsc_out->box_h = glyph->box_h;
+    dsc_out->ofs_x = glyph->ofs_x;
+    dsc_out->ofs_y = glyph->ofs_y;
+    dsc_out->bpp = stream->glyphs.header().bpp;
+    dsc_out->is_placeholder = 0;
+    return true;
+}
+
+static const uint8_t *stream_get_glyph_bitmap(const lv_font_t *font, uint32_t unicode_letter)
+{
+    StreamFont *stream = (StreamFont *)font->dsc;
+    return stream->glyphs.bitmap(unicode_letter);
+}
+
+static lv_font_t *stream_font_init(StreamFont *stream)
+{
+    const GlyphFontHeader &header = stream->glyphs.header();
+    lv_font_t *font = &stream->font;
+    font->get_glyph_dsc = stream_get_glyph_dsc;
+    font->get_glyph_bitmap = stream_get_glyph_bitmap;
+    font->line_height = header.line_height;
+    font->base_line = header.base_line;
+    font->subpx = LV_FONT_SUBPX_NONE;
+    font->dsc = stream;
+    font->fallback = NULL;
+    return font;
+}
+
+lv_font_t *lv_font_stream_open(const char *path, uint16_t cache_slots)
+{
+    StreamFont *stream = new StreamFont();
+    if (LV_FS_RES_OK != lv_fs_open(&stream->file, path, LV_FS_MODE_RD))
+    {
+        Serial.printf("Font %s: open failed\n", path);
+        delete stream;
+        return NULL;
+    }
+    stream->pos = 0;
+    stream->mapped = false;
+    if (!stream->glyphs.open(stream_read, stream, cache_slots))
+    {
+        Serial.printf("Font %s: invalid font file\n", path);
+        lv_fs_close(&stream->file);
+        delete stream;
+        return NULL;
+    }
+    lv_font_t *font = stream_font_init(stream);
+    Serial.printf("Font %s: %u glyphs, %u bytes in RAM\n", path, stream->glyphs.header().count,
+                  stream->glyphs.ramUsage());
+    return font;
+}
+
+lv_font_t *lv_font_stream_map(const uint8_t *data, uint32_t size)
+{
+    StreamFont *stream = new StreamFont();
+    stream->mapped = true;
+    if (!stream->glyphs.openMapped(data, size))
+    {
+        delete stream;
+        return NULL;
+    }
+    return stream_font_init(stream);
+}
+
+void lv_font_stream_close(lv_font_t *font)
+{
+    if (NULL == font)
+    {
+        return;
+    }
+    StreamFont *stream = (StreamFont *)font->dsc;
+    stream->glyphs.close();
+    if (!stream->mapped)
+    {
+        lv_fs_close(&stream->file);
+    }
+    delete stream;
+}
+
+void lv_font_stream_report(const lv_font_t *font)
+{
+    const StreamFont *stream = (const StreamFont *)font->dsc;
+    const GlyphCacheStats &stats = stream->glyphs.stats();
+    uint32_t total = stats.hits + stats.misses;
+    Serial.printf("Font cache: %u hits, %u misses (%u%% hit), %u reads, %u bytes in RAM\n",
+                  stats.hits, stats.misses, total ? stats.hits * 100 / total : 0,
+                  stats.reads, stream->glyphs.ramUsage());
+}
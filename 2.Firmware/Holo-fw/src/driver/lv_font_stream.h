@@ -0,0 +1,20 @@
+#ifndef LV_FONT_STREAM_H
+#define LV_FONT_STREAM_H
+
+#include <lvgl.h>
+#include "glyph_font.h"
+
+// 以 lv_font_t 的形式使用文件中的字体（格式见 glyph_font.h）
+// 例：lv_font_t *font = lv_font_stream_open("S:/font/ch_font_20.bin");
+//     lv_style_set_text_font(&style, font);
+// 只有索引（每字2字节）和缓存常驻内存，字模在绘制时才从文件读取
+
+// 失败返回NULL
+lv_font_t *lv_font_stream_open(const char *path, uint16_t cache_slots = GLYPH_CACHE_SLOTS);
+// 字体在内存映射的flash中（如资源分区，见 driver/assets.h），字形描述和字模直接指向映射，不占用缓存
+lv_font_t *lv_font_stream_map(const uint8_t *data, uint32_t size);
+void lv_font_stream_close(lv_font_t *font);
+// 打印缓存命中率和内存占用
+void lv_font_stream_report(const lv_font_t *font);
+
+#endif
@@ -11,8 +11,7 @@
 #include "lv_port_indev.h"
 
 static void encoder_init(void);
-static bool encoder_read(lv_indev_drv_t* indev_drv, lv_indev_data_t* data);
-static void encoder_handler(void);
+static void encoder_read(lv_indev_drv_t* indev_drv, lv_indev_data_t* data);
 
 
 lv_indev_t* indev_encoder;
@@ -75,23 +74,11 @@ static void encoder_init(void)
 }
 
 /* Will be called by the library to read the encoder */
-static bool encoder_read(lv_indev_drv_t* indev_drv, lv_indev_data_t* data)
+static void encoder_read(lv_indev_drv_t* indev_drv, lv_indev_data_t* data)
 {
 
 	data->enc_diff = encoder_diff;
 	data->state = encoder_state;
 
 	encoder_diff = 0;
-	/*Return `false` because we are not buffering and no more data to read*/
-	return false;
-}
-
-/*Call this function in an interrupt to process encoder events (turn, press)*/
-static void encoder_handler(void)
-{
-	/*Your code comes here*/
-
-
-	encoder_diff += 0;
-	encoder_state = LV_INDEV_STATE_REL;
 }
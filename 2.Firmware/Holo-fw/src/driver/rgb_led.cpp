@@ -1,27 +1,93 @@
 #include "rgb_led.h"
 #include "common.h"
-// #include <esp32-hal-timer.h>
+
+// RMT时钟 80MHz/2，一个tick为25ns
+#define RGB_RMT_CLK_DIV 2
+#define WS2812_T0H 16    // 0.4us
+#define WS2812_T0L 34    // 0.85us
+#define WS2812_T1H 32    // 0.8us
+#define WS2812_T1L 18    // 0.45us
+#define WS2812_RESET 3200 // 80us低电平，保证下一帧从第一颗灯珠开始
 
 void Pixel::init()
 {
-    FastLED.addLeds<WS2812, RGB_LED_PIN, GRB>(rgb_buffers, RGB_LED_NUM);
-    FastLED.setBrightness(200);
+    led_tables_init();
+    m_lock = xSemaphoreCreateMutex();
+
+    rmt_config_t config = {};
+    config.rmt_mode = RMT_MODE_TX;
+    config.channel = RGB_RMT_CHANNEL;
+    config.gpio_num = (gpio_num_t)RGB_LED_PIN;
+    config.mem_block_num = 1;
+    config.clk_div = RGB_RMT_CLK_DIV;
+    config.tx_config.loop_en = false;
+    config.tx_config.carrier_en = false;
+    config.tx_config.idle_output_en = true;
+    config.tx_config.idle_level = RMT_IDLE_LEVEL_LOW;
+    rmt_config(&config);
+    rmt_driver_install(config.channel, 0, 0);
+
+    // 帧尾的复位低电平（duration1为0同时作为结束标志）
+    rmt_item32_t *reset = &m_items[RGB_LED_NUM * 24];
+    reset->level0 = 0;
+    reset->duration0 = WS2812_RESET;
+    reset->level1 = 0;
+    reset->duration1 = 0;
+}
+
+// 调用方需持有 m_lock
+void Pixel::show()
+{
+    m_effect.render(m_frame, RGB_LED_NUM);
+    if (m_sent_valid && 0 == memcmp(m_frame, m_sent, sizeof(m_frame)))
+    {
+        return;
+    }
+    memcpy(m_sent, m_frame, sizeof(m_frame));
+    m_sent_valid = true;
+
+    rmt_item32_t *item = m_items;
+    for (int pos = 0; pos < RGB_LED_NUM; ++pos)
+    {
+        // WS2812 的顺序为GRB，高位在前
+        uint32_t grb = (m_frame[pos].g << 16) | (m_frame[pos].r << 8) | m_frame[pos].b;
+        for (int bit = 23; bit >= 0; --bit, ++item)
+        {
+            bool one = grb & (1UL << bit);
+            item->level0 = 1;
+            item->duration0 = one ? WS2812_T1H : WS2812_T0H;
+            item->level1 = 0;
+            item->duration1 = one ? WS2812_T1L : WS2812_T0L;
+        }
+    }
+    // 只在上一帧尚未发完时（约100us）等待，数据拷入RMT内存后立即返回
+    rmt_write_items(RGB_RMT_CHANNEL, m_items, RGB_LED_NUM * 24 + 1, false);
 }
 
 Pixel &Pixel::setRGB(int r, int g, int b)
 {
-    rgb_buffers[0] = CRGB(r, g, b);
-    rgb_buffers[1] = CRGB(r, g, b);
-    FastLED.show();
+    if (NULL == m_lock)
+    {
+        return *this;
+    }
+    xSemaphoreTake(m_lock, portMAX_DELAY);
+    m_effect.setRGB(constrain(r, 0, 255), constrain(g, 0, 255), constrain(b, 0, 255));
+    show();
+    xSemaphoreGive(m_lock);
 
     return *this;
 }
 
 Pixel &Pixel::setHVS(uint8_t ih, uint8_t is, uint8_t iv)
 {
-    rgb_buffers[0].setHSV(ih, is, iv);
-    rgb_buffers[1].setHSV(ih, is, iv);
-    FastLED.show();
+    if (NULL == m_lock)
+    {
+        return *this;
+    }
+    xSemaphoreTake(m_lock, portMAX_DELAY);
+    m_effect.setHSV(ih, is, iv);
+    show();
+    xSemaphoreGive(m_lock);
 
     return *this;
 }
@@ -30,201 +96,100 @@ Pixel &Pixel::fill_rainbow(int min_r, int max_r,
                            int min_g, int max_g,
                            int min_b, int max_b)
 {
-    fill_gradient(rgb_buffers, 0, CHSV(50, 255, 255), 29, CHSV(150, 255, 255), SHORTEST_HUES);
-    FastLED.show();
+    if (NULL == m_lock)
+    {
+        return *this;
+    }
+    xSemaphoreTake(m_lock, portMAX_DELAY);
+    m_effect.setRainbow(50, 150);
+    show();
+    xSemaphoreGive(m_lock);
 
     return *this;
 }
 
 Pixel &Pixel::setBrightness(float duty)
 {
+    if (NULL == m_lock)
+    {
+        return *this;
+    }
     duty = constrain(duty, 0, 1);
-    FastLED.setBrightness((uint8_t)(255 * duty));
-    FastLED.show();
+    xSemaphoreTake(m_lock, portMAX_DELAY);
+    m_effect.setDuty((uint8_t)(255 * duty));
+    show();
+    xSemaphoreGive(m_lock);
 
     return *this;
 }
 
-RgbParam g_rgb;
-hw_timer_t *rgb_timer;
-RgbRunStatus rgb_status;
-TimerHandle_t xTimer_rgb = NULL;
-
-void rgb_thread_init(RgbParam *rgb_setting)
+void Pixel::onTimer(TimerHandle_t timer)
 {
-    // // 80Mh主频
-    // rgb_timer = timerBegin(0, 80, true);
-    // timerAttachInterrupt(rgb_timer, &led_rgbOnTimer, true);
-    // //  操作的定时器 定时时长
-    // timerAlarmWrite(rgb_timer, 1000000, true);
-    // timerAlarmEnable(rgb_timer); // 使能报警器
-    // Serial.print("timerAlarmWrite\n");
-    set_rgb(rgb_setting);
-}
-
-void led_hsvOnTimer(TimerHandle_t xTimer)
-{
-    // HSV色彩的控制
-    rgb_status.current_h += g_rgb.step_h;
-    if (rgb_status.current_h >= g_rgb.max_value_h)
-    {
-        g_rgb.step_h = (-1) * g_rgb.step_h;
-        rgb_status.current_h = g_rgb.max_value_h;
-    }
-    else if (rgb_status.current_h <= g_rgb.min_value_h)
+    Pixel *pixel = (Pixel *)pvTimerGetTimerID(timer);
+    // 在定时器任务中执行，拿不到锁时跳过这一步，不阻塞其它定时器
+    if (pdTRUE != xSemaphoreTake(pixel->m_lock, 0))
     {
-        g_rgb.step_h = (-1) * g_rgb.step_h;
-        rgb_status.current_h = g_rgb.min_value_h;
-    }
-
-    rgb_status.current_s += g_rgb.step_s;
-    if (rgb_status.current_s >= g_rgb.max_value_s)
-    {
-        g_rgb.step_s = (-1) * g_rgb.step_s;
-        rgb_status.current_s = g_rgb.max_value_s;
-    }
-    else if (rgb_status.current_s <= g_rgb.min_value_s)
-    {
-        g_rgb.step_s = (-1) * g_rgb.step_s;
-        rgb_status.current_s = g_rgb.min_value_s;
+        return;
     }
+    pixel->m_effect.step();
+    pixel->show();
+    xSemaphoreGive(pixel->m_lock);
+}
 
-    rgb_status.current_v += g_rgb.step_v;
-    if (rgb_status.current_v >= g_rgb.max_value_v)
-    {
-        g_rgb.step_v = (-1) * g_rgb.step_v;
-        rgb_status.current_v = g_rgb.max_value_v;
-    }
-    else if (rgb_status.current_v <= g_rgb.min_value_v)
+void Pixel::startEffect(const LedEffectParam &param, int period_ms)
+{
+    if (NULL == m_lock)
     {
-        g_rgb.step_v = (-1) * g_rgb.step_v;
-        rgb_status.current_v = g_rgb.min_value_v;
+        return;
     }
-    
-    // 计算当前背光值
-    count_cur_brightness();
-    // rgb_status.current_brightness = g_rgb.max_brightness;
-
-    // 设置HSV状态
-    rgb.setHVS(rgb_status.current_h,
-               rgb_status.current_s,
-               rgb_status.current_v)
-        .setBrightness(rgb_status.current_brightness);
+    stopEffect();
+    xSemaphoreTake(m_lock, portMAX_DELAY);
+    m_effect.start(param);
+    show();
+    xSemaphoreGive(m_lock);
+
+    TickType_t period = period_ms / portTICK_PERIOD_MS;
+    m_timer = xTimerCreate("rgb contorller", period > 0 ? period : 1,
+                           pdTRUE, this, onTimer);
+    xTimerStart(m_timer, 0); //开启定时器
 }
 
-// void IRAM_ATTR led_rgbOnTimer()
-void led_rgbOnTimer(TimerHandle_t xTimer)
+void Pixel::stopEffect()
 {
-    // RGB色彩的控制
-    if (0 == rgb_status.pos) // 控制到R
-    {
-        rgb_status.current_r += g_rgb.step_r;
-        if (rgb_status.current_r >= g_rgb.max_value_r && g_rgb.step_r > 0)
-        {
-            rgb_status.pos = 1;
-            rgb_status.current_r = g_rgb.max_value_r;
-        }
-        else if (rgb_status.current_r <= g_rgb.min_value_r && g_rgb.step_r < 0)
-        {
-            g_rgb.step_r = (-1) * g_rgb.step_r;
-            rgb_status.current_r = g_rgb.min_value_r;
-        }
-    }
-    else if (1 == rgb_status.pos) // 控制到G
-    {
-        rgb_status.current_g += g_rgb.step_r;
-        if (rgb_status.current_g >= g_rgb.max_value_g && g_rgb.step_r > 0)
-        {
-            rgb_status.pos = 2;
-            rgb_status.current_g = g_rgb.max_value_g;
-        }
-        else if (rgb_status.current_g <= g_rgb.min_value_g && g_rgb.step_r < 0)
-        {
-            rgb_status.pos = 0;
-            rgb_status.current_g = g_rgb.min_value_g;
-        }
-    }
-    else if (2 == rgb_status.pos) // 控制到B
+    if (NULL != m_timer)
     {
-        rgb_status.current_b += g_rgb.step_r;
-        if (rgb_status.current_b >= g_rgb.max_value_b && g_rgb.step_r > 0)
-        {
-            g_rgb.step_r = (-1) * g_rgb.step_r;
-            rgb_status.current_b = g_rgb.max_value_b;
-        }
-        else if (rgb_status.current_b <= g_rgb.min_value_b && g_rgb.step_r < 0)
-        {
-            rgb_status.pos = 1;
-            rgb_status.current_b = g_rgb.min_value_b;
-        }
+        xTimerDelete(m_timer, 0);
+        m_timer = NULL;
     }
-
-    // 计算当前背光值
-    count_cur_brightness();
-
-    // 设置RGB状态
-    rgb.setRGB(rgb_status.current_r,
-               rgb_status.current_g,
-               rgb_status.current_b)
-        .setBrightness(rgb_status.current_brightness);
 }
 
-void count_cur_brightness(void)
+void rgb_thread_init(RgbParam *rgb_setting)
 {
-    // 背光的控制
-    rgb_status.current_brightness += g_rgb.brightness_step;
-    if (rgb_status.current_brightness >= g_rgb.max_brightness)
-    {
-        rgb_status.current_brightness = g_rgb.max_brightness;
-        g_rgb.brightness_step = (-1) * g_rgb.brightness_step;
-    }
-    else if (rgb_status.current_brightness <= g_rgb.min_brightness)
-    {
-        rgb_status.current_brightness = g_rgb.min_brightness;
-        g_rgb.brightness_step = (-1) * g_rgb.brightness_step;
-    }
+    set_rgb(rgb_setting);
 }
 
 void set_rgb(RgbParam *rgb_setting)
 {
-    g_rgb = *rgb_setting;
-    if (NULL != xTimer_rgb)
-    {
-        xTimerStop(xTimer_rgb, 0);
-        xTimer_rgb = NULL;
-    }
-
-    if (LED_MODE_RGB == g_rgb.mode)
-    {
-        rgb_status.current_r = g_rgb.min_value_r;
-        rgb_status.current_g = g_rgb.min_value_g;
-        rgb_status.current_b = g_rgb.min_value_b;
-        rgb_status.current_brightness = g_rgb.min_brightness;
-        rgb_status.pos = 0;
-        xTimer_rgb = xTimerCreate("rgb contorller",
-                                  g_rgb.time / portTICK_PERIOD_MS,
-                                  pdTRUE, (void *)0, led_rgbOnTimer);
-    }
-    else if (LED_MODE_HSV == g_rgb.mode)
-    {
-        rgb_status.current_h = g_rgb.min_value_h;
-        rgb_status.current_s = g_rgb.min_value_s;
-        rgb_status.current_v = g_rgb.min_value_v;
-        rgb_status.current_brightness = g_rgb.min_brightness;
-        rgb_status.pos = 0;
-        xTimer_rgb = xTimerCreate("rgb contorller",
-                                  g_rgb.time / portTICK_PERIOD_MS,
-                                  pdTRUE, (void *)0, led_hsvOnTimer);
-    }
-    xTimerStart(xTimer_rgb, 0); //开启定时器
+    // 浮点的亮度参数在这里一次性换算为定点，定时器中只做整数运算
+    LedEffectParam param;
+    param.effect = LED_MODE_HSV == rgb_setting->mode ? LED_EFFECT_HSV_CYCLE : LED_EFFECT_RGB_CYCLE;
+    param.min_value[0] = rgb_setting->min_value_r;
+    param.min_value[1] = rgb_setting->min_value_g;
+    param.min_value[2] = rgb_setting->min_value_b;
+    param.max_value[0] = rgb_setting->max_value_r;
+    param.max_value[1] = rgb_setting->max_value_g;
+    param.max_value[2] = rgb_setting->max_value_b;
+    param.step[0] = rgb_setting->step_r;
+    param.step[1] = rgb_setting->step_g;
+    param.step[2] = rgb_setting->step_b;
+    param.min_brightness = constrain(rgb_setting->min_brightness, 0, 1) * LED_BRIGHTNESS_MAX;
+    param.max_brightness = constrain(rgb_setting->max_brightness, 0, 1) * LED_BRIGHTNESS_MAX;
+    param.brightness_step = constrain(rgb_setting->brightness_step * LED_BRIGHTNESS_MAX,
+                                      INT16_MIN, INT16_MAX);
+    rgb.startEffect(param, rgb_setting->time);
 }
 
 void rgb_thread_del(void)
 {
-    // timerEnd(rgb_timer);
-    if (NULL != xTimer_rgb)
-    {
-        xTimerStop(xTimer_rgb, 0);
-        xTimer_rgb = NULL;
-    }
-}
\ No newline at end of file
+    rgb.stopEffect();
+}
@@ -1,19 +1,33 @@
 #ifndef RGB_H
 #define RGB_H
 
-#include <FastLED.h>
-#include <esp32-hal-timer.h>
+#include <Arduino.h>
+#include <driver/rmt.h>
+#include "led_effect.h"
 
 #define RGB_LED_NUM 2
 #define RGB_LED_PIN 27
+#define RGB_RMT_CHANNEL RMT_CHANNEL_0
 
 #define LED_MODE_RGB 0
 #define LED_MODE_HSV 1
 
+// WS2812由RMT发送：2颗灯珠共48位，加上复位低电平只占用一个RMT内存块，
+// 写入后立即返回，不需要补充数据的中断，也不会像 FastLED.show() 那样等待发送完成。
+// 颜色与效果的设置只改写状态并刷新一帧，效果由定时器逐步生成
 class Pixel
 {
 private:
-    CRGB rgb_buffers[RGB_LED_NUM];
+    LedEffect m_effect;
+    LedColor m_frame[RGB_LED_NUM];
+    LedColor m_sent[RGB_LED_NUM]; // 上一次发送的内容，未变化时不重复发送
+    rmt_item32_t m_items[RGB_LED_NUM * 24 + 1];
+    SemaphoreHandle_t m_lock = NULL;
+    TimerHandle_t m_timer = NULL;
+    bool m_sent_valid = false;
+
+    void show();
+    static void onTimer(TimerHandle_t timer);
 
 public:
     void init();
@@ -27,6 +41,10 @@ public:
                         int min_b, int max_b);
 
     Pixel &setBrightness(float duty);
+
+    // period_ms: 效果每一步的间隔
+    void startEffect(const LedEffectParam &param, int period_ms);
+    void stopEffect();
 };
 
 struct RgbConfig
@@ -105,37 +123,10 @@ struct RgbParam
     int time; // 定时器的时间
 };
 
-struct RgbRunStatus
-{
-    union
-    {
-        uint8_t current_r;
-        uint8_t current_h;
-    };
-    union
-    {
-        uint8_t current_g;
-        uint8_t current_s;
-    };
-    union
-    {
-        uint8_t current_b;
-        uint8_t current_v;
-    };
-    uint8_t pos;
-    float current_brightness;
-};
-
 void rgb_thread_init(RgbParam *rgb_setting);
 
 void set_rgb(RgbParam *rgb_setting);
 
-void led_rgbOnTimer(TimerHandle_t xTimer);
-// void IRAM_ATTR led_rgbOnTimer();
-void led_hsvOnTimer(TimerHandle_t xTimer);
-
-void count_cur_brightness(void);
-
 void rgb_thread_del(void);
 
 #endif
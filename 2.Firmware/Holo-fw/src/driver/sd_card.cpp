@@ -117,7 +117,7 @@ void SdCard::init()
     }
 
     uint64_t cardSize = SD.cardSize() / (1024 * 1024);
-    Serial.printf("SD Card Size: %lluMB\n", cardSize);
+    Serial.printf("SD Card Size: %lluMB\n", (unsigned long long)cardSize);
 }
 
 void SdCard::listDir(const char *dirname, uint8_t levels)
@@ -193,8 +193,7 @@ File_Info *SdCard::listDir(const char *dirname)
     head_file->file_type = FILE_TYPE_FOLDER;
     head_file->file_name = (char *)malloc(dir_len);
     // 将文件夹名赋值给头节点（当作这个节点的文件名）
-    strncpy(head_file->file_name, dirname, dir_len - 1);
-    head_file->file_name[dir_len - 1] = 0;
+    memcpy(head_file->file_name, dirname, dir_len);
     head_file->front_node = NULL;
     head_file->next_node = NULL;
 
@@ -224,9 +223,8 @@ File_Info *SdCard::listDir(const char *dirname)
         file_node = file_node->next_node;
 
         // 船家创建新节点的文件名
-        file_node->file_name = (char *)malloc(filename_len);
-        strncpy(file_node->file_name, fn, filename_len); //
-        file_node->file_name[filename_len] = 0;          //
+        file_node->file_name = (char *)malloc(filename_len + 1);
+        memcpy(file_node->file_name, fn, filename_len + 1);
         // 下一个节点赋空
         file_node->next_node = NULL;
 
@@ -420,7 +418,7 @@ boolean SdCard::deleteFile(const char *path)
 
 boolean SdCard::deleteFile(const String &path)
 {
-    Serial.printf("Deleting file: %s\n", path);
+    Serial.printf("Deleting file: %s\n", path.c_str());
     if (tf_vfs->remove(path))
     {
         Serial.println("File deleted");
@@ -500,7 +498,7 @@ void SdCard::fileIO(const char *path)
             len -= toRead;
         }
         end = millis() - start;
-        Serial.printf("%u bytes read for %u ms\n", flen, end);
+        Serial.printf("%u bytes read for %u ms\n", (unsigned)flen, (unsigned)end);
         file.close();
     }
     else
@@ -0,0 +1,413 @@
+#include "file_server.h"
+#include "common.h"
+#include "app/picture/picture.h"
+
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+
+#ifdef ARDUINO
+#include <lwip/sockets.h>
+#else
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+// SD卡上的实现。连续读写同一个文件时保持文件打开，不必每一帧都重新查找FAT
+class SdFileBackend : public FileBackend
+{
+private:
+    File m_file;
+    char m_path[FILE_PATH_MAX];
+    bool m_writing;
+    bool m_changed; // 有修改，关闭时通知图片列表重新扫描
+
+    bool isCached(const char *path, bool writing)
+    {
+        return m_file && m_writing == writing && 0 == strcmp(m_path, path);
+    }
+
+    void changed()
+    {
+        m_changed = true;
+    }
+
+public:
+    SdFileBackend() : m_writing(false), m_changed(false)
+    {
+        m_path[0] = 0;
+    }
+
+    // 关闭缓存的文件，空闲或断开连接时调用
+    void flush()
+    {
+        if (m_file)
+        {
+            m_file.close();
+        }
+        m_path[0] = 0;
+        if (m_changed)
+        {
+            m_changed = false;
+            picture_request_rescan();
+        }
+    }
+
+    FILE_ENTRY_TYPE stat(const char *path, uint32_t *size)
+    {
+        if (isCached(path, true) || isCached(path, false))
+        {
+            *size = m_file.size();
+            return FILE_ENTRY_FILE;
+        }
+        File file = SD.open(path);
+        if (!file)
+        {
+            return FILE_ENTRY_NONE;
+        }
+        FILE_ENTRY_TYPE type = file.isDirectory() ? FILE_ENTRY_DIR : FILE_ENTRY_FILE;
+        *size = FILE_ENTRY_DIR == type ? 0 : file.size();
+        file.close();
+        return type;
+    }
+
+    bool mkdir(const char *path)
+    {
+        changed();
+        return SD.mkdir(path);
+    }
+
+    bool remove(const char *path)
+    {
+        uint32_t size;
+        FILE_ENTRY_TYPE type = stat(path, &size);
+        flush();
+        changed();
+        return FILE_ENTRY_DIR == type ? SD.rmdir(path) : SD.remove(path);
+    }
+
+    bool rename(const char *from, const char *to)
+    {
+        flush();
+        changed();
+        return SD.rename(from, to);
+    }
+
+    int32_t read(const char *path, uint32_t offset, uint8_t *buf, uint32_t len)
+    {
+        if (!isCached(path, false))
+        {
+            flush();
+            m_file = SD.open(path, FILE_READ);
+            if (!m_file || m_file.isDirectory())
+            {
+                flush();
+                return -1;
+            }
+            strcpy(m_path, path);
+            m_writing = false;
+        }
+        if (offset >= m_file.size())
+        {
+            return 0;
+        }
+        if (m_file.position() != offset && !m_file.seek(offset))
+        {
+            return -1;
+        }
+        return m_file.read(buf, len);
+    }
+
+    bool write(const char *path, uint32_t offset, const uint8_t *data, uint32_t len)
+    {
+        // 续写时文件位置就在末尾（FileService 已检查 offset 等于文件长度）
+        if (0 == offset || !isCached(path, true))
+        {
+            flush();
+            m_file = SD.open(path, 0 == offset ? FILE_WRITE : FILE_APPEND);
+            if (!m_file)
+            {
+                return false;
+            }
+            strcpy(m_path, path);
+            m_writing = true;
+        }
+        changed();
+        return 0 == len || m_file.write(data, len) == len;
+    }
+
+    bool list(const char *path, uint32_t offset, FileListFunc visit, void *ctx)
+    {
+        File dir = SD.open(path);
+        if (!dir || !dir.isDirectory())
+        {
+            return false;
+        }
+        uint32_t index = 0;
+        bool ok = true;
+        while (true)
+        {
+            File entry = dir.openNextFile();
+            if (!entry)
+            {
+                break;
+            }
+            if (index++ < offset)
+            {
+                entry.close();
+                continue;
+            }
+            // name() 是完整路径，只保留最后一级
+            const char *name = entry.name();
+            const char *slash = strrchr(name, '/');
+            bool is_dir = entry.isDirectory();
+            ok = visit(ctx, NULL == slash ? name : slash + 1, is_dir ? FILE_ENTRY_DIR : FILE_ENTRY_FILE,
+                       is_dir ? 0 : entry.size());
+            entry.close();
+            if (!ok)
+            {
+                break;
+            }
+        }
+        dir.close();
+        return ok;
+    }
+};
+
+struct FileClient
+{
+    int fd;
+    FileConn conn;
+    unsigned long last_active;
+};
+
+static SdFileBackend sd_backend;
+static FileService service(&sd_backend);
+static FileClient clients[FILE_MAX_CLIENTS];
+static int listen_fd = -1;
+static unsigned long last_request = 0;
+
+static void close_client(FileClient *c)
+{
+    close(c->fd);
+    c->fd = -1;
+    free(c->conn.rx);
+    free(c->conn.tx);
+    c->conn.rx = NULL;
+    c->conn.tx = NULL;
+    sd_backend.flush();
+}
+
+static void accept_client()
+{
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd < 0)
+    {
+        return;
+    }
+    FileClient *c = NULL;
+    for (int pos = 0; pos < FILE_MAX_CLIENTS; ++pos)
+    {
+        if (clients[pos].fd < 0)
+        {
+            c = &clients[pos];
+            break;
+        }
+    }
+    uint8_t *rx = NULL == c ? NULL : (uint8_t *)malloc(FILE_RX_BUF_SIZE);
+    uint8_t *tx = NULL == rx ? NULL : (uint8_t *)malloc(FILE_TX_BUF_SIZE);
+    if (NULL == tx)
+    {
+        // 连接数已满或内存不足
+        free(rx);
+        close(fd);
+        return;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    int enable = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    c->fd = fd;
+    c->conn.rx = rx;
+    c->conn.rx_len = 0;
+    c->conn.tx = tx;
+    c->conn.tx_len = 0;
+    c->last_active = millis();
+}
+
+// 尽量发出发送缓存中的数据，剩余部分移到缓存开头
+static bool send_client(FileClient *c)
+{
+    uint32_t sent = 0;
+    while (sent < c->conn.tx_len)
+    {
+        int len = send(c->fd, c->conn.tx + sent, c->conn.tx_len - sent, MSG_NOSIGNAL);
+        if (len <= 0)
+        {
+            if (len < 0 && (EAGAIN == errno || EWOULDBLOCK == errno))
+            {
+                break;
+            }
+            return false;
+        }
+        sent += len;
+    }
+    if (sent > 0)
+    {
+        memmove(c->conn.tx, c->conn.tx + sent, c->conn.tx_len - sent);
+        c->conn.tx_len -= sent;
+    }
+    return true;
+}
+
+// 读取并处理当前可用的请求，连接断开或协议错误时返回false
+static bool serve_client(FileClient *c)
+{
+    while (true)
+    {
+        uint32_t room = FILE_RX_BUF_SIZE - c->conn.rx_len;
+        int len = 0;
+        if (room > 0)
+        {
+            len = recv(c->fd, c->conn.rx + c->conn.rx_len, room, 0);
+            if (0 == len)
+            {
+                return false;
+            }
+            if (len < 0 && EAGAIN != errno && EWOULDBLOCK != errno)
+            {
+                return false;
+            }
+        }
+        if (len > 0)
+        {
+            c->conn.rx_len += len;
+            c->last_active = millis();
+            last_request = c->last_active;
+        }
+        uint32_t rx_before = c->conn.rx_len;
+        // 出错之前的请求照常回复
+        bool ok = file_conn_process(&service, &c->conn);
+        if (!send_client(c) || !ok)
+        {
+            return false;
+        }
+        // 没有新数据，或发送缓存满了处理不动，等下一次select
+        if (len <= 0 && rx_before == c->conn.rx_len)
+        {
+            return true;
+        }
+    }
+}
+
+static void file_server_task(void *param)
+{
+    fd_set read_fds;
+    fd_set write_fds;
+    struct timeval tv;
+    while (true)
+    {
+        FD_ZERO(&read_fds);
+        FD_ZERO(&write_fds);
+        FD_SET(listen_fd, &read_fds);
+        int max_fd = listen_fd;
+        for (int pos = 0; pos < FILE_MAX_CLIENTS; ++pos)
+        {
+            FileClient *c = &clients[pos];
+            if (c->fd < 0)
+            {
+                continue;
+            }
+            // 回复没发完时先不读新的请求，由对端的TCP窗口形成背压
+            if (c->conn.tx_len > 0)
+            {
+                FD_SET(c->fd, &write_fds);
+            }
+            else
+            {
+                FD_SET(c->fd, &read_fds);
+            }
+            max_fd = c->fd > max_fd ? c->fd : max_fd;
+        }
+        tv.tv_sec = 0;
+        tv.tv_usec = FILE_SELECT_TIMEOUT * 1000;
+        int ready = select(max_fd + 1, &read_fds, &write_fds, NULL, &tv);
+        if (ready < 0)
+        {
+            vTaskDelay(10 / portTICK_PERIOD_MS);
+            continue;
+        }
+        if (ready > 0 && FD_ISSET(listen_fd, &read_fds))
+        {
+            accept_client();
+        }
+        unsigned long now = millis();
+        for (int pos = 0; pos < FILE_MAX_CLIENTS; ++pos)
+        {
+            FileClient *c = &clients[pos];
+            if (c->fd < 0)
+            {
+                continue;
+            }
+            bool ok = true;
+            if (ready > 0 && (FD_ISSET(c->fd, &read_fds) || FD_ISSET(c->fd, &write_fds)))
+            {
+                ok = send_client(c) && serve_client(c);
+            }
+            else if (now - c->last_active > FILE_IDLE_TIMEOUT)
+            {
+                ok = false;
+            }
+            if (!ok)
+            {
+                close_client(c);
+            }
+        }
+        if (now - last_request > FILE_FLUSH_TIMEOUT)
+        {
+            sd_backend.flush();
+        }
+    }
+}
+
+bool file_server_init()
+{
+    for (int pos = 0; pos < FILE_MAX_CLIENTS; ++pos)
+    {
+        clients[pos].fd = -1;
+    }
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0)
+    {
+        Serial.println(F("FileServer: socket failed"));
+        return false;
+    }
+    int enable = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+    struct sockaddr_in server_addr;
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    server_addr.sin_port = htons(FILE_SERVER_PORT);
+    if (bind(listen_fd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0 ||
+        listen(listen_fd, FILE_MAX_CLIENTS) < 0)
+    {
+        Serial.println(F("FileServer: bind/listen failed"));
+        close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+    fcntl(listen_fd, F_SETFL, O_NONBLOCK);
+
+    xTaskCreatePinnedToCore(file_server_task, "file_server", FILE_TASK_STACK_SIZE,
+                            NULL, FILE_TASK_PRIORITY, NULL, FILE_TASK_CORE);
+    return true;
+}
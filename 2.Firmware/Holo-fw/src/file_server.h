@@ -0,0 +1,21 @@
+#ifndef FILE_SERVER_H
+#define FILE_SERVER_H
+
+#include <Arduino.h>
+#include "file_service.h"
+
+// SD卡文件管理的二进制协议服务（协议见 file_service.h），比 HTTP 的 /list /edit 开销小，
+// 请求可以流水线发送（见 tools/holo_files.py）
+#define FILE_SERVER_PORT 8082
+#define FILE_MAX_CLIENTS 2          // 收发缓存在连接建立时才分配
+#define FILE_IDLE_TIMEOUT 30000     // 空闲连接的超时时间（ms）
+#define FILE_FLUSH_TIMEOUT 500      // 没有新请求多久之后关闭缓存的文件（ms）
+#define FILE_SELECT_TIMEOUT 100     // 事件等待的超时时间（ms）
+
+#define FILE_TASK_STACK_SIZE 6144   // 递归删除时每层约300字节
+#define FILE_TASK_PRIORITY 2
+#define FILE_TASK_CORE 0
+
+bool file_server_init();
+
+#endif
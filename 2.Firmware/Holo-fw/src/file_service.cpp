@@ -0,0 +1,357 @@
+#include "file_service.h"
+
+#include <string.h>
+
+static void put_u16(uint8_t *p, uint16_t value)
+{
+    p[0] = (uint8_t)(value >> 8);
+    p[1] = (uint8_t)value;
+}
+
+static void put_u32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)(value >> 24);
+    p[1] = (uint8_t)(value >> 16);
+    p[2] = (uint8_t)(value >> 8);
+    p[3] = (uint8_t)value;
+}
+
+static bool valid_path(const char *path)
+{
+    return NULL != path && '/' == path[0] && strlen(path) < FILE_PATH_MAX;
+}
+
+struct ListCtx
+{
+    MsgWriter *out;
+    uint16_t count;
+    uint16_t limit;
+    bool more; // 还有没有写进本帧的条目
+};
+
+static bool list_entry(void *ctx, const char *name, FILE_ENTRY_TYPE type, uint32_t size)
+{
+    ListCtx *list = (ListCtx *)ctx;
+    uint32_t name_len = strlen(name) + 1;
+    if (list->count == list->limit || list->out->room() < 1 + 4 + 2 + name_len)
+    {
+        list->more = true;
+        return false;
+    }
+    list->out->u8(type);
+    list->out->u32(size);
+    list->out->str(name);
+    ++list->count;
+    return true;
+}
+
+// 递归删除时每次取出一批名称，删除之后再从头遍历，不在遍历过程中修改目录
+#define FILE_DELETE_BATCH 256
+
+struct NameBatch
+{
+    char names[FILE_DELETE_BATCH];
+    uint32_t len;
+    uint8_t num;
+};
+
+static bool collect_name(void *ctx, const char *name, FILE_ENTRY_TYPE, uint32_t)
+{
+    NameBatch *batch = (NameBatch *)ctx;
+    uint32_t name_len = strlen(name) + 1;
+    if (batch->len + name_len > FILE_DELETE_BATCH)
+    {
+        return false;
+    }
+    memcpy(batch->names + batch->len, name, name_len);
+    batch->len += name_len;
+    ++batch->num;
+    return true;
+}
+
+// path 指向一个 FILE_PATH_MAX 的缓存，子项的路径临时拼接在 path_len 之后
+MSG_STATUS FileService::removeTree(char *path, uint32_t path_len, int depth)
+{
+    uint32_t size;
+    FILE_ENTRY_TYPE type = m_fs->stat(path, &size);
+    if (FILE_ENTRY_NONE == type)
+    {
+        return MSG_ERR_NOT_FOUND;
+    }
+    if (FILE_ENTRY_DIR == type)
+    {
+        if (depth >= FILE_DELETE_DEPTH)
+        {
+            return MSG_ERR_IO;
+        }
+        while (true)
+        {
+            NameBatch batch;
+            batch.len = 0;
+            batch.num = 0;
+            m_fs->list(path, 0, collect_name, &batch);
+            if (0 == batch.num)
+            {
+                break;
+            }
+            const char *name = batch.names;
+            for (uint8_t i = 0; i < batch.num; ++i, name += strlen(name) + 1)
+            {
+                uint32_t sep = 1 == path_len ? 0 : 1; // 根目录下不重复'/'
+                uint32_t child_len = path_len + sep + strlen(name);
+                if (child_len >= FILE_PATH_MAX)
+                {
+                    return MSG_ERR_IO;
+                }
+                path[path_len] = '/';
+                strcpy(path + path_len + sep, name);
+                MSG_STATUS status = removeTree(path, child_len, depth + 1);
+                path[path_len] = 0;
+                if (MSG_OK != status)
+                {
+                    return status;
+                }
+            }
+        }
+    }
+    return m_fs->remove(path) ? MSG_OK : MSG_ERR_IO;
+}
+
+uint32_t FileService::handle(const uint8_t *req, uint32_t len, uint8_t *out)
+{
+    MsgHead head;
+    head.decode(req);
+    if (!head.isLegal() || head.m_msg_len != len || MODULE_TYPE_C_FILE_MANAGER != head.m_to_who)
+    {
+        return 0;
+    }
+    MsgReader in(req + MSG_HEAD_SIZE, len - MSG_HEAD_SIZE);
+    uint16_t tag = in.u16();
+    if (!in.ok())
+    {
+        return 0;
+    }
+    MsgWriter res(out, FILE_MAX_FRAME);
+    res.reserve(MSG_HEAD_SIZE);
+    res.u16(tag);
+    uint32_t status_pos = res.length();
+    res.u8(MSG_OK);
+
+    MSG_STATUS status = MSG_OK;
+    uint32_t size = 0;
+    switch (head.m_action_type)
+    {
+    case AT_FREE_STATUS:
+        break;
+    case AT_DIR_LIST:
+    {
+        const char *path = in.str();
+        uint32_t offset = in.u32();
+        uint16_t limit = in.u16();
+        if (!in.ok() || !valid_path(path))
+        {
+            status = MSG_ERR_BAD_REQUEST;
+            break;
+        }
+        FILE_ENTRY_TYPE type = m_fs->stat(path, &size);
+        if (FILE_ENTRY_DIR != type)
+        {
+            status = FILE_ENTRY_NONE == type ? MSG_ERR_NOT_FOUND : MSG_ERR_NOT_DIR;
+            break;
+        }
+        // count 和 next 遍历完才知道，先留出位置
+        uint8_t *list_head = res.reserve(6);
+        ListCtx list = {&res, 0, limit, false};
+        if (!m_fs->list(path, offset, list_entry, &list) && !list.more)
+        {
+            status = MSG_ERR_IO;
+            break;
+        }
+        put_u16(list_head, list.count);
+        put_u32(list_head + 2, list.more ? offset + list.count : FILE_LIST_END);
+        break;
+    }
+    case AT_DIR_CREATE:
+    case AT_FILE_CREATE:
+    {
+        const char *path = in.str();
+        if (!in.ok() || !valid_path(path))
+        {
+            status = MSG_ERR_BAD_REQUEST;
+            break;
+        }
+        FILE_ENTRY_TYPE type = m_fs->stat(path, &size);
+        if (AT_DIR_CREATE == head.m_action_type)
+        {
+            status = FILE_ENTRY_NONE != type ? MSG_ERR_EXISTS : m_fs->mkdir(path) ? MSG_OK : MSG_ERR_IO;
+        }
+        else
+        {
+            status = FILE_ENTRY_DIR == type ? MSG_ERR_EXISTS : m_fs->write(path, 0, NULL, 0) ? MSG_OK : MSG_ERR_IO;
+        }
+        break;
+    }
+    case AT_DIR_REMOVE:
+    case AT_FILE_REMOVE:
+    {
+        const char *path = in.str();
+        if (!in.ok() || !valid_path(path) || 0 == path[1])
+        {
+            status = MSG_ERR_BAD_REQUEST;
+            break;
+        }
+        if (AT_DIR_REMOVE == head.m_action_type)
+        {
+            char tree[FILE_PATH_MAX];
+            strcpy(tree, path);
+            status = removeTree(tree, strlen(tree), 0);
+        }
+        else
+        {
+            FILE_ENTRY_TYPE type = m_fs->stat(path, &size);
+            status = FILE_ENTRY_NONE == type ? MSG_ERR_NOT_FOUND : m_fs->remove(path) ? MSG_OK : MSG_ERR_IO;
+        }
+        break;
+    }
+    case AT_DIR_RENAME:
+    case AT_FILE_RENAME:
+    {
+        const char *from = in.str();
+        const char *to = in.str();
+        if (!in.ok() || !valid_path(from) || !valid_path(to))
+        {
+            status = MSG_ERR_BAD_REQUEST;
+        }
+        else if (FILE_ENTRY_NONE == m_fs->stat(from, &size))
+        {
+            status = MSG_ERR_NOT_FOUND;
+        }
+        else if (FILE_ENTRY_NONE != m_fs->stat(to, &size))
+        {
+            status = MSG_ERR_EXISTS;
+        }
+        else
+        {
+            status = m_fs->rename(from, to) ? MSG_OK : MSG_ERR_IO;
+        }
+        break;
+    }
+    case AT_FILE_GET_INFO:
+    {
+        const char *path = in.str();
+        if (!in.ok() || !valid_path(path))
+        {
+            status = MSG_ERR_BAD_REQUEST;
+            break;
+        }
+        FILE_ENTRY_TYPE type = m_fs->stat(path, &size);
+        if (FILE_ENTRY_NONE == type)
+        {
+            status = MSG_ERR_NOT_FOUND;
+            break;
+        }
+        res.u8(type);
+        res.u32(size);
+        break;
+    }
+    case AT_FILE_READ:
+    {
+        const char *path = in.str();
+        uint32_t offset = in.u32();
+        uint32_t want = in.u16();
+        if (!in.ok() || !valid_path(path))
+        {
+            status = MSG_ERR_BAD_REQUEST;
+            break;
+        }
+        // 直接读进回复帧，超过一帧的部分由客户端再次请求
+        uint32_t data_pos = res.length();
+        want = want < res.room() ? want : res.room();
+        int32_t got = m_fs->read(path, offset, res.reserve(want), want);
+        if (got < 0)
+        {
+            FILE_ENTRY_TYPE type = m_fs->stat(path, &size);
+            status = FILE_ENTRY_NONE == type ? MSG_ERR_NOT_FOUND : FILE_ENTRY_DIR == type ? MSG_ERR_NOT_DIR : MSG_ERR_IO;
+            break;
+        }
+        res.truncate(data_pos + got);
+        break;
+    }
+    case AT_FILE_WRITE:
+    {
+        const char *path = in.str();
+        uint32_t offset = in.u32();
+        uint32_t data_len;
+        const uint8_t *data = in.rest(&data_len);
+        if (!in.ok() || !valid_path(path))
+        {
+            status = MSG_ERR_BAD_REQUEST;
+            break;
+        }
+        FILE_ENTRY_TYPE type = m_fs->stat(path, &size);
+        if (FILE_ENTRY_DIR == type)
+        {
+            status = MSG_ERR_EXISTS;
+            break;
+        }
+        if (0 != offset && (FILE_ENTRY_NONE == type || size != offset))
+        {
+            // 回复当前长度，客户端从这里续传
+            status = MSG_ERR_OFFSET;
+            res.u32(FILE_ENTRY_NONE == type ? 0 : size);
+            break;
+        }
+        if (!m_fs->write(path, offset, data, data_len))
+        {
+            status = MSG_ERR_IO;
+            break;
+        }
+        res.u32(offset + data_len);
+        break;
+    }
+    default:
+        status = MSG_ERR_UNSUPPORTED;
+        break;
+    }
+
+    if (MSG_OK != status && MSG_ERR_OFFSET != status)
+    {
+        res.truncate(status_pos + 1);
+    }
+    out[status_pos] = status;
+    MsgHead reply(MODULE_TYPE_C_FILE_MANAGER, MODULE_TYPE_CUBIC_FILE_MANAGER);
+    reply.m_action_type = head.m_action_type;
+    reply.m_msg_len = res.length();
+    reply.encode(out);
+    return res.length();
+}
+
+bool file_conn_process(FileService *service, FileConn *conn)
+{
+    uint32_t pos = 0;
+    bool ok = true;
+    while (conn->tx_len + FILE_MAX_FRAME <= FILE_TX_BUF_SIZE)
+    {
+        int32_t len = msg_frame_length(conn->rx + pos, conn->rx_len - pos, FILE_MAX_FRAME);
+        if (len <= 0)
+        {
+            ok = 0 == len;
+            break;
+        }
+        uint32_t out_len = service->handle(conn->rx + pos, len, conn->tx + conn->tx_len);
+        if (0 == out_len)
+        {
+            ok = false;
+            break;
+        }
+        conn->tx_len += out_len;
+        pos += len;
+    }
+    // 只移动最后不完整的请求，已处理的请求不做拷贝
+    if (pos > 0)
+    {
+        memmove(conn->rx, conn->rx + pos, conn->rx_len - pos);
+        conn->rx_len -= pos;
+    }
+    return ok;
+}
@@ -0,0 +1,85 @@
+#ifndef FILE_SERVICE_H
+#define FILE_SERVICE_H
+
+#include "message.h"
+
+// 基于 MsgHead 的文件管理协议：一个常连接上连续发送请求（可流水线，不必等待回复），按请求顺序回复
+// 只依赖标准头文件，可在PC上编译（见 tools/file_service_check.cpp），网络部分见 file_server.h
+// 请求：MsgHead(from=CUBIC_FILE_MANAGER, to=C_FILE_MANAGER, action) | tag uint16 | 字段
+// 回复：MsgHead(from=C_FILE_MANAGER, to=CUBIC_FILE_MANAGER, action) | tag uint16 | status uint8 | 字段
+// tag 由客户端任意指定，原样返回；字段编码见 MsgReader。路径都以'/'开头
+//   AT_FREE_STATUS      -                                   -
+//   AT_DIR_LIST         path offset(4) limit(2)             count(2) next(4) count x [type(1) size(4) name]
+//                       一帧放不下时提前结束，next 为下一次的 offset，没有更多时为 0xFFFFFFFF
+//   AT_DIR_CREATE       path                                -
+//   AT_DIR_REMOVE       path                                -         （递归删除）
+//   AT_FILE_CREATE      path                                -         （已存在时清空）
+//   AT_FILE_REMOVE      path                                -
+//   AT_FILE_RENAME      from to                             -         （AT_DIR_RENAME 相同）
+//   AT_FILE_GET_INFO    path                                type(1) size(4)
+//   AT_FILE_READ        path offset(4) len(2)               data      （到文件末尾时变短）
+//   AT_FILE_WRITE       path offset(4) data                 size(4)   （offset 须等于当前长度，0 表示新建）
+// 失败时 status 不为 MSG_OK，之后没有字段；只有 MSG_ERR_OFFSET 带当前长度 size(4)
+// 请求和数据在接收缓存中原地解析，写入的数据直接从接收缓存写进文件，读出的数据直接读进发送缓存
+#define FILE_MAX_FRAME 4096                       // 一帧的最大长度（请求和回复）
+#define FILE_RX_BUF_SIZE (2 * FILE_MAX_FRAME)     // 可以同时容纳多个流水线请求
+#define FILE_TX_BUF_SIZE (2 * FILE_MAX_FRAME)     // 回复攒够再发送，剩余空间不足一帧时先发送
+#define FILE_PATH_MAX 128
+#define FILE_DELETE_DEPTH 8                       // 递归删除的最大目录深度
+#define FILE_LIST_END 0xFFFFFFFF
+
+enum FILE_ENTRY_TYPE : unsigned char
+{
+    FILE_ENTRY_NONE = 0,
+    FILE_ENTRY_FILE,
+    FILE_ENTRY_DIR
+};
+
+// 遍历目录时每项调用一次，name 不含路径，返回false停止遍历
+typedef bool (*FileListFunc)(void *ctx, const char *name, FILE_ENTRY_TYPE type, uint32_t size);
+
+// 文件系统的接口：设备上是SD卡（file_server.cpp），PC上是一个本地目录
+class FileBackend
+{
+public:
+    virtual ~FileBackend() {}
+    virtual FILE_ENTRY_TYPE stat(const char *path, uint32_t *size) = 0;
+    virtual bool mkdir(const char *path) = 0;
+    virtual bool remove(const char *path) = 0; // 文件或空目录
+    virtual bool rename(const char *from, const char *to) = 0;
+    // 返回读到的字节数，失败返回-1
+    virtual int32_t read(const char *path, uint32_t offset, uint8_t *buf, uint32_t len) = 0;
+    // offset 为0时新建（清空）文件，否则追加在 offset 处
+    virtual bool write(const char *path, uint32_t offset, const uint8_t *data, uint32_t len) = 0;
+    // 从第 offset 项开始遍历
+    virtual bool list(const char *path, uint32_t offset, FileListFunc visit, void *ctx) = 0;
+};
+
+class FileService
+{
+private:
+    FileBackend *m_fs;
+
+    MSG_STATUS removeTree(char *path, uint32_t path_len, int depth);
+
+public:
+    FileService(FileBackend *fs) : m_fs(fs) {}
+    // 处理一帧完整的请求，回复写入 out（至少 FILE_MAX_FRAME 字节），返回回复的长度
+    // 请求不是发给文件管理的返回0，应断开连接
+    uint32_t handle(const uint8_t *req, uint32_t len, uint8_t *out);
+};
+
+// 一个连接的收发缓存
+struct FileConn
+{
+    uint8_t *rx;
+    uint32_t rx_len;
+    uint8_t *tx;
+    uint32_t tx_len;
+};
+
+// 依次处理接收缓存中所有完整的请求，回复追加到发送缓存；发送缓存放不下一帧时停下，
+// 发送之后再调用；处理过的请求从接收缓存移除。帧头非法时返回false，应断开连接
+bool file_conn_process(FileService *service, FileConn *conn);
+
+#endif
@@ -0,0 +1,1270 @@
+#include "http_server.h"
+
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <strings.h>
+
+#ifdef ARDUINO
+#include <lwip/sockets.h>
+#else
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#define HTTP_CONTENT_LENGTH_NOT_SET ((size_t)-2)
+
+static void http_server_task(void *param)
+{
+    ((HttpServer *)param)->run();
+}
+
+static const char *status_text(int code)
+{
+    switch (code)
+    {
+    case 200:
+        return "OK";
+    case 206:
+        return "Partial Content";
+    case 304:
+        return "Not Modified";
+    case 400:
+        return "Bad Request";
+    case 404:
+        return "Not Found";
+    case 405:
+        return "Method Not Allowed";
+    case 409:
+        return "Conflict";
+    case 413:
+        return "Payload Too Large";
+    case 422:
+        return "Unprocessable Entity";
+    case 431:
+        return "Request Header Fields Too Large";
+    case 500:
+        return "Internal Server Error";
+    case 501:
+        return "Not Implemented";
+    case 503:
+        return "Service Unavailable";
+    default:
+        return "";
+    }
+}
+
+// 在 data 中查找 pattern，返回下标，找不到返回-1
+static long find_bytes(const uint8_t *data, size_t len, const char *pattern, size_t pattern_len)
+{
+    if (0 == pattern_len || len < pattern_len)
+    {
+        return -1;
+    }
+    for (size_t pos = 0; pos + pattern_len <= len; ++pos)
+    {
+        if (data[pos] == (uint8_t)pattern[0] && 0 == memcmp(data + pos, pattern, pattern_len))
+        {
+            return (long)pos;
+        }
+    }
+    return -1;
+}
+
+static int hex_value(char ch)
+{
+    if (ch >= '0' && ch <= '9')
+        return ch - '0';
+    if (ch >= 'a' && ch <= 'f')
+        return ch - 'a' + 10;
+    if (ch >= 'A' && ch <= 'F')
+        return ch - 'A' + 10;
+    return -1;
+}
+
+// 原地做URL解码
+static void url_decode(char *str, bool plus_as_space)
+{
+    char *dst = str;
+    for (char *src = str; *src != 0; ++src, ++dst)
+    {
+        if ('%' == *src && hex_value(src[1]) >= 0 && hex_value(src[2]) >= 0)
+        {
+            *dst = (char)(hex_value(src[1]) << 4 | hex_value(src[2]));
+            src += 2;
+        }
+        else if ('+' == *src && plus_as_space)
+        {
+            *dst = ' ';
+        }
+        else
+        {
+            *dst = *src;
+        }
+    }
+    *dst = 0;
+}
+
+// 不认识的方法返回false（回复501，不能当成GET处理）
+static bool parse_method(const char *name, HTTPMethod *method)
+{
+    if (!strcmp(name, "GET"))
+        *method = HTTP_GET;
+    else if (!strcmp(name, "POST"))
+        *method = HTTP_POST;
+    else if (!strcmp(name, "DELETE"))
+        *method = HTTP_DELETE;
+    else if (!strcmp(name, "PUT"))
+        *method = HTTP_PUT;
+    else if (!strcmp(name, "PATCH"))
+        *method = HTTP_PATCH;
+    else if (!strcmp(name, "HEAD"))
+        *method = HTTP_HEAD;
+    else if (!strcmp(name, "OPTIONS"))
+        *method = HTTP_OPTIONS;
+    else
+        return false;
+    return true;
+}
+
+static const char *method_name(HTTPMethod method)
+{
+    switch (method)
+    {
+    case HTTP_GET:
+        return "GET";
+    case HTTP_POST:
+        return "POST";
+    case HTTP_DELETE:
+        return "DELETE";
+    case HTTP_PUT:
+        return "PUT";
+    case HTTP_PATCH:
+        return "PATCH";
+    case HTTP_HEAD:
+        return "HEAD";
+    case HTTP_OPTIONS:
+        return "OPTIONS";
+    default:
+        return "";
+    }
+}
+
+// 从 Content-Disposition 中取出 key="value"
+static bool extract_quoted(const char *line, const char *key, char *out, size_t out_size)
+{
+    const char *start = strstr(line, key);
+    if (NULL == start)
+    {
+        return false;
+    }
+    start += strlen(key);
+    const char *end = strchr(start, '"');
+    if (NULL == end)
+    {
+        return false;
+    }
+    size_t len = end - start;
+    if (len >= out_size)
+    {
+        len = out_size - 1;
+    }
+    memcpy(out, start, len);
+    out[len] = 0;
+    return true;
+}
+
+HttpServer::HttpServer(uint16_t port)
+{
+    m_port = port;
+    m_listen_fd = -1;
+    m_route_num = 0;
+    m_cur = NULL;
+    m_upload_owner = NULL;
+    m_responded = false;
+    m_chunked = false;
+    m_content_length = HTTP_CONTENT_LENGTH_NOT_SET;
+    m_extra_headers_len = 0;
+    m_tx_len = 0;
+    for (int pos = 0; pos < HTTP_MAX_CLIENTS; ++pos)
+    {
+        m_conns[pos].fd = -1;
+        m_conns[pos].state = HTTP_CONN_FREE;
+        m_conns[pos].tx = NULL;
+        m_conns[pos].tx_head = 0;
+        m_conns[pos].tx_len = 0;
+    }
+}
+
+void HttpServer::on(const char *uri, HTTPMethod method, THandlerFunction fn)
+{
+    on(uri, method, fn, NULL);
+}
+
+void HttpServer::on(const char *uri, HTTPMethod method, THandlerFunction fn, THandlerFunction ufn)
+{
+    if (m_route_num >= HTTP_MAX_ROUTES)
+    {
+        Serial.printf("HttpServer: too many routes, drop %s\n", uri);
+        return;
+    }
+    m_routes[m_route_num].uri = uri;
+    m_routes[m_route_num].method = method;
+    m_routes[m_route_num].fn = fn;
+    m_routes[m_route_num].ufn = ufn;
+    ++m_route_num;
+}
+
+bool HttpServer::begin()
+{
+    m_listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (m_listen_fd < 0)
+    {
+        Serial.println(F("HttpServer: socket failed"));
+        return false;
+    }
+    int enable = 1;
+    setsockopt(m_listen_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+    struct sockaddr_in server_addr;
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    server_addr.sin_port = htons(m_port);
+    if (bind(m_listen_fd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0 ||
+        listen(m_listen_fd, HTTP_MAX_CLIENTS) < 0)
+    {
+        Serial.println(F("HttpServer: bind/listen failed"));
+        close(m_listen_fd);
+        m_listen_fd = -1;
+        return false;
+    }
+    fcntl(m_listen_fd, F_SETFL, O_NONBLOCK);
+
+    xTaskCreatePinnedToCore(http_server_task, "http_server", HTTP_TASK_STACK_SIZE,
+                            this, HTTP_TASK_PRIORITY, NULL, HTTP_TASK_CORE);
+    return true;
+}
+
+void HttpServer::run()
+{
+    fd_set read_fds;
+    fd_set write_fds;
+    struct timeval tv;
+    while (true)
+    {
+        FD_ZERO(&read_fds);
+        FD_ZERO(&write_fds);
+        FD_SET(m_listen_fd, &read_fds);
+        int max_fd = m_listen_fd;
+        for (int pos = 0; pos < HTTP_MAX_CLIENTS; ++pos)
+        {
+            HttpConn *c = &m_conns[pos];
+            if (HTTP_CONN_FREE == c->state)
+            {
+                continue;
+            }
+            // 有积压时先把回复发完，再读后面的请求
+            FD_SET(c->fd, NULL != c->tx ? &write_fds : &read_fds);
+            if (c->fd > max_fd)
+            {
+                max_fd = c->fd;
+            }
+        }
+
+        tv.tv_sec = 0;
+        tv.tv_usec = HTTP_SELECT_TIMEOUT * 1000;
+        int ready = select(max_fd + 1, &read_fds, &write_fds, NULL, &tv);
+        if (ready < 0)
+        {
+            vTaskDelay(10 / portTICK_PERIOD_MS);
+            continue;
+        }
+        if (ready > 0 && FD_ISSET(m_listen_fd, &read_fds))
+        {
+            acceptClient();
+        }
+
+        unsigned long now = millis();
+        for (int pos = 0; pos < HTTP_MAX_CLIENTS; ++pos)
+        {
+            HttpConn *c = &m_conns[pos];
+            if (HTTP_CONN_FREE == c->state)
+            {
+                continue;
+            }
+            if (ready > 0 && FD_ISSET(c->fd, &write_fds))
+            {
+                if (!sendBacklog(c))
+                {
+                    closeConn(c);
+                    continue;
+                }
+                if (NULL == c->tx && HTTP_CONN_CLOSING != c->state)
+                {
+                    // 处理积压期间已经收到的请求（pipelining）
+                    processConn(c);
+                }
+            }
+            else if (ready > 0 && FD_ISSET(c->fd, &read_fds))
+            {
+                if (!readConn(c))
+                {
+                    closeConn(c);
+                    continue;
+                }
+                processConn(c);
+            }
+            else if (now - c->last_active > HTTP_KEEP_ALIVE_TIMEOUT)
+            {
+                dropBacklog(c);
+                c->state = HTTP_CONN_CLOSING;
+            }
+
+            // 要关闭的连接也先把积压的回复发完
+            if (HTTP_CONN_CLOSING == c->state && NULL == c->tx)
+            {
+                closeConn(c);
+            }
+        }
+    }
+}
+
+void HttpServer::acceptClient()
+{
+    struct sockaddr_in client_addr;
+    socklen_t addr_len = sizeof(client_addr);
+    int fd = accept(m_listen_fd, (struct sockaddr *)&client_addr, &addr_len);
+    if (fd < 0)
+    {
+        return;
+    }
+
+    HttpConn *c = NULL;
+    for (int pos = 0; pos < HTTP_MAX_CLIENTS; ++pos)
+    {
+        if (HTTP_CONN_FREE == m_conns[pos].state)
+        {
+            c = &m_conns[pos];
+            break;
+        }
+    }
+    if (NULL == c)
+    {
+        // 连接数已满
+        static const char busy[] = "HTTP/1.1 503 Service Unavailable\r\n"
+                                   "Connection: close\r\nContent-Length: 0\r\n\r\n";
+        ::send(fd, busy, sizeof(busy) - 1, MSG_NOSIGNAL);
+        close(fd);
+        return;
+    }
+
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    int enable = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    c->fd = fd;
+    c->rx_len = 0;
+    c->head_len = 0;
+    c->last_active = millis();
+    resetRequest(c);
+    c->state = HTTP_CONN_HEAD;
+}
+
+void HttpServer::closeConn(HttpConn *c)
+{
+    if (HTTP_MP_PART_DATA == c->mp_state && c->mp_is_file)
+    {
+        // 上传途中断开
+        callUpload(c, UPLOAD_FILE_ABORTED, NULL, 0);
+    }
+    if (m_upload_owner == c)
+    {
+        m_upload_owner = NULL;
+    }
+    dropBacklog(c);
+    close(c->fd);
+    c->fd = -1;
+    c->state = HTTP_CONN_FREE;
+    resetRequest(c);
+}
+
+void HttpServer::resetRequest(HttpConn *c)
+{
+    c->http11 = false;
+    c->keep_alive = false;
+    c->method = HTTP_GET;
+    c->path = "";
+    c->arg_num = 0;
+    c->hdr_num = 0;
+    c->body_left = 0;
+    c->route = -1;
+    c->form_body = false;
+    c->mp_state = HTTP_MP_NONE;
+    c->boundary_len = 0;
+    c->mp_is_file = false;
+    c->upload_total = 0;
+}
+
+bool HttpServer::readConn(HttpConn *c)
+{
+    size_t room = HTTP_RX_BUF_SIZE - c->rx_len;
+    if (0 == room)
+    {
+        // 缓存已满 且处理不了（请求头过大等）
+        return false;
+    }
+    int len = recv(c->fd, c->rx + c->rx_len, room, 0);
+    if (len > 0)
+    {
+        c->rx_len += len;
+        c->last_active = millis();
+        return true;
+    }
+    if (len < 0 && (EAGAIN == errno || EWOULDBLOCK == errno))
+    {
+        return true;
+    }
+    // 对端关闭或出错
+    return false;
+}
+
+void HttpServer::processConn(HttpConn *c)
+{
+    while ((HTTP_CONN_HEAD == c->state || HTTP_CONN_BODY == c->state) && NULL == c->tx)
+    {
+        if (HTTP_CONN_HEAD == c->state)
+        {
+            long head_end = find_bytes(c->rx, c->rx_len, "\r\n\r\n", 4);
+            if (head_end < 0)
+            {
+                if (c->rx_len >= HTTP_MAX_HEAD_SIZE)
+                {
+                    failConn(c, 431, "HEADER TOO LARGE");
+                }
+                return;
+            }
+            if (head_end + 4 > HTTP_MAX_HEAD_SIZE)
+            {
+                failConn(c, 431, "HEADER TOO LARGE");
+                return;
+            }
+            int code = parseHead(c, head_end);
+            if (0 != code)
+            {
+                failConn(c, code, 501 == code ? "NOT IMPLEMENTED" : "BAD REQUEST");
+                return;
+            }
+            c->state = HTTP_CONN_BODY;
+        }
+
+        size_t avail = c->rx_len - c->head_len;
+        if (avail > c->body_left)
+        {
+            avail = c->body_left;
+        }
+        if (HTTP_MP_NONE != c->mp_state)
+        {
+            size_t used = parseMultipart(c, c->rx + c->head_len, avail, avail == c->body_left);
+            if (HTTP_CONN_CLOSING == c->state)
+            {
+                return;
+            }
+            consumeBody(c, used);
+            if (0 == used && c->body_left > 0)
+            {
+                if (HTTP_RX_BUF_SIZE == c->rx_len)
+                {
+                    // 窗口已满但解析不出任何东西（分段头过大）
+                    failConn(c, 400, "BAD MULTIPART");
+                }
+                return;
+            }
+        }
+        else if (c->form_body)
+        {
+            // 表单参数和请求头一样原地保存，要等整个请求体收齐
+            if (c->body_left > HTTP_RX_BUF_SIZE - c->head_len)
+            {
+                failConn(c, 413, "FORM TOO LARGE");
+                return;
+            }
+            if (avail < c->body_left)
+            {
+                return;
+            }
+            parseForm(c);
+        }
+        else
+        {
+            // 没有上传处理函数的请求体直接丢弃
+            consumeBody(c, avail);
+            if (0 == avail && c->body_left > 0)
+            {
+                return;
+            }
+        }
+
+        if (0 == c->body_left)
+        {
+            dispatch(c);
+            finishRequest(c);
+        }
+    }
+}
+
+// 返回0表示成功，否则为要回复的错误码
+int HttpServer::parseHead(HttpConn *c, size_t head_end)
+{
+    c->rx[head_end] = 0;
+    c->head_len = head_end + 4;
+
+    // 请求行: METHOD URI VERSION
+    char *line = (char *)c->rx;
+    char *next = strstr(line, "\r\n");
+    if (NULL != next)
+    {
+        *next = 0;
+        next += 2;
+    }
+    char *uri = strchr(line, ' ');
+    if (NULL == uri)
+    {
+        return 400;
+    }
+    *uri++ = 0;
+    char *version = strchr(uri, ' ');
+    if (NULL == version)
+    {
+        return 400;
+    }
+    *version++ = 0;
+    c->http11 = (0 == strcmp(version, "HTTP/1.1"));
+    if (!parse_method(line, &c->method))
+    {
+        return 501;
+    }
+
+    char *query = strchr(uri, '?');
+    if (NULL != query)
+    {
+        *query++ = 0;
+        parseQuery(c, query);
+    }
+    url_decode(uri, false);
+    c->path = uri;
+
+    // 请求头: 原地切分为 name/value
+    while (NULL != next && 0 != *next)
+    {
+        line = next;
+        next = strstr(line, "\r\n");
+        if (NULL != next)
+        {
+            *next = 0;
+            next += 2;
+        }
+        char *value = strchr(line, ':');
+        if (NULL == value || c->hdr_num >= HTTP_MAX_HEADERS)
+        {
+            continue;
+        }
+        *value++ = 0;
+        while (' ' == *value || '\t' == *value)
+        {
+            ++value;
+        }
+        c->hdr_name[c->hdr_num] = line;
+        c->hdr_value[c->hdr_num] = value;
+        ++c->hdr_num;
+    }
+
+    c->keep_alive = c->http11;
+    const char *connection = findHeader(c, "Connection");
+    if (NULL != connection)
+    {
+        if (!strcasecmp(connection, "close"))
+        {
+            c->keep_alive = false;
+        }
+        else if (!strcasecmp(connection, "keep-alive"))
+        {
+            c->keep_alive = true;
+        }
+    }
+    if (NULL != findHeader(c, "Transfer-Encoding"))
+    {
+        // 不支持分块编码的请求体
+        return 400;
+    }
+    const char *content_length = findHeader(c, "Content-Length");
+    c->body_left = (NULL != content_length) ? strtoul(content_length, NULL, 10) : 0;
+
+    c->route = -1;
+    for (int pos = 0; pos < m_route_num; ++pos)
+    {
+        if (!strcmp(m_routes[pos].uri, c->path) &&
+            (HTTP_ANY == m_routes[pos].method || c->method == m_routes[pos].method))
+        {
+            c->route = pos;
+            break;
+        }
+    }
+
+    const char *content_type = findHeader(c, "Content-Type");
+    if (c->route >= 0 && c->body_left > 0 && NULL != content_type &&
+        !strncasecmp(content_type, "application/x-www-form-urlencoded", 33))
+    {
+        c->form_body = true;
+    }
+    if (c->route >= 0 && m_routes[c->route].ufn && c->body_left > 0 &&
+        NULL != content_type && !strncasecmp(content_type, "multipart/form-data", 19))
+    {
+        const char *boundary = strstr(content_type, "boundary=");
+        if (NULL == boundary)
+        {
+            return 400;
+        }
+        boundary += 9;
+        size_t boundary_len = strcspn(boundary, ";");
+        if ('"' == *boundary)
+        {
+            ++boundary;
+            boundary_len = strcspn(boundary, "\"");
+        }
+        if (0 == boundary_len || boundary_len + 5 > sizeof(c->boundary))
+        {
+            return 400;
+        }
+        memcpy(c->boundary, "\r\n--", 4);
+        memcpy(c->boundary + 4, boundary, boundary_len);
+        c->boundary_len = boundary_len + 4;
+        c->boundary[c->boundary_len] = 0;
+        c->mp_state = HTTP_MP_PREAMBLE;
+    }
+    return 0;
+}
+
+void HttpServer::parseQuery(HttpConn *c, char *query)
+{
+    while (NULL != query && 0 != *query && c->arg_num < HTTP_MAX_ARGS)
+    {
+        char *next = strchr(query, '&');
+        if (NULL != next)
+        {
+            *next++ = 0;
+        }
+        char *value = strchr(query, '=');
+        if (NULL != value)
+        {
+            *value++ = 0;
+        }
+        else
+        {
+            value = query + strlen(query); // 空字符串
+        }
+        url_decode(query, true);
+        url_decode(value, true);
+        c->arg_name[c->arg_num] = query;
+        c->arg_value[c->arg_num] = value;
+        ++c->arg_num;
+        query = next;
+    }
+}
+
+// 请求体已收齐：前移3字节覆盖请求头结尾的 "\n\r\n" 空出结束符的位置，
+// 再按查询串解析，之后请求体算作请求头的一部分，直到 finishRequest
+void HttpServer::parseForm(HttpConn *c)
+{
+    char *form = (char *)c->rx + c->head_len - 3;
+    memmove(form, c->rx + c->head_len, c->body_left);
+    form[c->body_left] = 0;
+    c->head_len += c->body_left;
+    c->body_left = 0;
+    parseQuery(c, form);
+}
+
+const char *HttpServer::findHeader(HttpConn *c, const char *name)
+{
+    for (int pos = 0; pos < c->hdr_num; ++pos)
+    {
+        if (!strcasecmp(c->hdr_name[pos], name))
+        {
+            return c->hdr_value[pos];
+        }
+    }
+    return NULL;
+}
+
+void HttpServer::consumeBody(HttpConn *c, size_t len)
+{
+    if (0 == len)
+    {
+        return;
+    }
+    uint8_t *body = c->rx + c->head_len;
+    memmove(body, body + len, c->rx_len - c->head_len - len);
+    c->rx_len -= len;
+    c->body_left -= len;
+}
+
+size_t HttpServer::parseMultipart(HttpConn *c, uint8_t *data, size_t len, bool is_last)
+{
+    size_t used = 0;
+    while (used < len)
+    {
+        uint8_t *cur = data + used;
+        size_t cur_len = len - used;
+        switch (c->mp_state)
+        {
+        case HTTP_MP_PREAMBLE:
+        {
+            // 第一个分隔符前面没有 "\r\n"
+            const char *delim = c->boundary + 2;
+            size_t delim_len = c->boundary_len - 2;
+            long pos = find_bytes(cur, cur_len, delim, delim_len);
+            if (pos < 0)
+            {
+                if (is_last)
+                {
+                    failConn(c, 400, "BAD MULTIPART");
+                    return used;
+                }
+                return used + (cur_len >= delim_len ? cur_len - (delim_len - 1) : 0);
+            }
+            if (pos + delim_len + 2 > cur_len)
+            {
+                return used + pos; // 等分隔符后面的两个字节
+            }
+            bool is_end = ('-' == cur[pos + delim_len] && '-' == cur[pos + delim_len + 1]);
+            used += pos + delim_len + 2;
+            c->mp_state = is_end ? HTTP_MP_DONE : HTTP_MP_PART_HEADERS;
+        }
+        break;
+        case HTTP_MP_PART_HEADERS:
+        {
+            long head_end = find_bytes(cur, cur_len, "\r\n\r\n", 4);
+            if (head_end < 0)
+            {
+                if (is_last)
+                {
+                    failConn(c, 400, "BAD MULTIPART");
+                }
+                return used;
+            }
+            cur[head_end] = 0;
+            c->mp_is_file = false;
+            c->upload_name[0] = 0;
+            c->upload_filename[0] = 0;
+            c->upload_type[0] = 0;
+            char *line = (char *)cur;
+            while (NULL != line)
+            {
+                char *next = strstr(line, "\r\n");
+                if (NULL != next)
+                {
+                    *next = 0;
+                    next += 2;
+                }
+                if (!strncasecmp(line, "Content-Disposition:", 20))
+                {
+                    extract_quoted(line, " name=\"", c->upload_name, sizeof(c->upload_name));
+                    c->mp_is_file = extract_quoted(line, "filename=\"", c->upload_filename,
+                                                   sizeof(c->upload_filename));
+                }
+                else if (!strncasecmp(line, "Content-Type:", 13))
+                {
+                    const char *type = line + 13;
+                    while (' ' == *type)
+                    {
+                        ++type;
+                    }
+                    strncpy(c->upload_type, type, sizeof(c->upload_type) - 1);
+                    c->upload_type[sizeof(c->upload_type) - 1] = 0;
+                }
+                line = next;
+            }
+            used += head_end + 4;
+            c->mp_state = HTTP_MP_PART_DATA;
+            if (c->mp_is_file)
+            {
+                c->upload_total = 0;
+                callUpload(c, UPLOAD_FILE_START, NULL, 0);
+            }
+        }
+        break;
+        case HTTP_MP_PART_DATA:
+        {
+            long pos = find_bytes(cur, cur_len, c->boundary, c->boundary_len);
+            if (pos < 0)
+            {
+                if (is_last)
+                {
+                    failConn(c, 400, "BAD MULTIPART");
+                    return used;
+                }
+                // 保留可能是分隔符开头的尾部数据
+                size_t safe = cur_len >= c->boundary_len ? cur_len - (c->boundary_len - 1) : 0;
+                if (safe > 0 && c->mp_is_file)
+                {
+                    callUpload(c, UPLOAD_FILE_WRITE, cur, safe);
+                }
+                return used + safe;
+            }
+            if (pos > 0 && c->mp_is_file)
+            {
+                callUpload(c, UPLOAD_FILE_WRITE, cur, pos);
+            }
+            if ((size_t)pos + c->boundary_len + 2 > cur_len)
+            {
+                return used + pos;
+            }
+            if (c->mp_is_file)
+            {
+                callUpload(c, UPLOAD_FILE_END, NULL, 0);
+                c->mp_is_file = false;
+            }
+            const uint8_t *tail = cur + pos + c->boundary_len;
+            used += pos + c->boundary_len + 2;
+            c->mp_state = ('-' == tail[0] && '-' == tail[1]) ? HTTP_MP_DONE : HTTP_MP_PART_HEADERS;
+        }
+        break;
+        default:
+            // 结束分隔符之后的数据直接丢弃
+            return len;
+        }
+    }
+    return used;
+}
+
+void HttpServer::callUpload(HttpConn *c, HTTPUploadStatus status, const uint8_t *buf, size_t len)
+{
+    if (c->route < 0 || !m_routes[c->route].ufn)
+    {
+        return;
+    }
+    if (m_upload_owner != c || UPLOAD_FILE_START == status)
+    {
+        // 多个连接交替上传时，切换共享的 m_upload 字段
+        m_upload.filename = c->upload_filename;
+        m_upload.name = c->upload_name;
+        m_upload.type = c->upload_type;
+        m_upload_owner = c;
+    }
+    if (UPLOAD_FILE_WRITE == status)
+    {
+        c->upload_total += len;
+    }
+    m_upload.status = status;
+    m_upload.buf = buf;
+    m_upload.currentSize = len;
+    m_upload.totalSize = c->upload_total;
+
+    HttpConn *prev = m_cur;
+    m_cur = c;
+    m_routes[c->route].ufn();
+    m_cur = prev;
+}
+
+void HttpServer::beginResponse(HttpConn *c)
+{
+    m_cur = c;
+    m_responded = false;
+    m_chunked = false;
+    m_content_length = HTTP_CONTENT_LENGTH_NOT_SET;
+    m_extra_headers_len = 0;
+    m_tx_len = 0;
+}
+
+void HttpServer::endResponse()
+{
+    if (m_chunked)
+    {
+        writeData("0\r\n\r\n", 5);
+    }
+    flush();
+    m_cur = NULL;
+}
+
+void HttpServer::failConn(HttpConn *c, int code, const char *msg)
+{
+    beginResponse(c);
+    c->keep_alive = false;
+    send(code, "text/plain", msg);
+    endResponse();
+    c->state = HTTP_CONN_CLOSING;
+}
+
+void HttpServer::dispatch(HttpConn *c)
+{
+    beginResponse(c);
+    if (c->route < 0)
+    {
+        // 路径存在但方法不对时回复405，并列出允许的方法
+        String allow;
+        for (int pos = 0; pos < m_route_num; ++pos)
+        {
+            if (!strcmp(m_routes[pos].uri, c->path) && HTTP_ANY != m_routes[pos].method)
+            {
+                allow += allow.length() > 0 ? ", " : "";
+                allow += method_name(m_routes[pos].method);
+            }
+        }
+        if (allow.length() > 0)
+        {
+            sendHeader("Allow", allow);
+            send(405, "text/plain", "Method not allowed");
+        }
+        else
+        {
+            send(404, "text/plain", "Not found");
+        }
+    }
+    else
+    {
+        m_routes[c->route].fn();
+        if (!m_responded)
+        {
+            send(500, "text/plain", "No response");
+        }
+    }
+    endResponse();
+}
+
+void HttpServer::finishRequest(HttpConn *c)
+{
+    if (HTTP_CONN_CLOSING == c->state || !c->keep_alive)
+    {
+        c->state = HTTP_CONN_CLOSING;
+        return;
+    }
+    // 保留已经收到的下一个请求（pipelining）
+    memmove(c->rx, c->rx + c->head_len, c->rx_len - c->head_len);
+    c->rx_len -= c->head_len;
+    c->head_len = 0;
+    resetRequest(c);
+    c->state = HTTP_CONN_HEAD;
+}
+
+String HttpServer::uri()
+{
+    return String(NULL != m_cur ? m_cur->path : "");
+}
+
+HTTPMethod HttpServer::method()
+{
+    return NULL != m_cur ? m_cur->method : HTTP_GET;
+}
+
+int HttpServer::args()
+{
+    return NULL != m_cur ? m_cur->arg_num : 0;
+}
+
+String HttpServer::arg(int i)
+{
+    if (NULL == m_cur || i < 0 || i >= m_cur->arg_num)
+    {
+        return String();
+    }
+    return String(m_cur->arg_value[i]);
+}
+
+String HttpServer::arg(const char *name)
+{
+    for (int pos = 0; NULL != m_cur && pos < m_cur->arg_num; ++pos)
+    {
+        if (!strcmp(m_cur->arg_name[pos], name))
+        {
+            return String(m_cur->arg_value[pos]);
+        }
+    }
+    return String();
+}
+
+bool HttpServer::hasArg(const char *name)
+{
+    for (int pos = 0; NULL != m_cur && pos < m_cur->arg_num; ++pos)
+    {
+        if (!strcmp(m_cur->arg_name[pos], name))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+String HttpServer::header(const char *name)
+{
+    const char *value = NULL != m_cur ? findHeader(m_cur, name) : NULL;
+    return String(NULL != value ? value : "");
+}
+
+bool HttpServer::hasHeader(const char *name)
+{
+    return NULL != m_cur && NULL != findHeader(m_cur, name);
+}
+
+int HttpServer::clientSlot()
+{
+    return NULL != m_cur ? (int)(m_cur - m_conns) : -1;
+}
+
+HttpUpload &HttpServer::upload()
+{
+    return m_upload;
+}
+
+void HttpServer::setContentLength(size_t content_length)
+{
+    m_content_length = content_length;
+}
+
+void HttpServer::sendHeader(const char *name, const String &value)
+{
+    int len = snprintf(m_extra_headers + m_extra_headers_len,
+                       sizeof(m_extra_headers) - m_extra_headers_len,
+                       "%s: %s\r\n", name, value.c_str());
+    if (len > 0 && m_extra_headers_len + len < sizeof(m_extra_headers))
+    {
+        m_extra_headers_len += len;
+    }
+}
+
+void HttpServer::send(int code, const char *content_type, const String &content)
+{
+    if (NULL == m_cur)
+    {
+        return;
+    }
+    if (m_responded)
+    {
+        Serial.printf("HttpServer: %s already responded\n", m_cur->path);
+        return;
+    }
+    m_responded = true;
+
+    if (CONTENT_LENGTH_UNKNOWN == m_content_length)
+    {
+        sendStatusLine(code, content_type, CONTENT_LENGTH_UNKNOWN);
+        sendContent(content.c_str(), content.length());
+        return;
+    }
+    size_t content_length = content.length();
+    if (HTTP_CONTENT_LENGTH_NOT_SET != m_content_length)
+    {
+        // 已指定长度，正文随后通过sendContent发送
+        content_length = m_content_length;
+    }
+    sendStatusLine(code, content_type, content_length);
+    writeData(content.c_str(), content.length());
+}
+
+void HttpServer::sendContent(const String &content)
+{
+    sendContent(content.c_str(), content.length());
+}
+
+void HttpServer::sendContent(const char *content, size_t len)
+{
+    if (NULL == m_cur || !m_responded || 0 == len)
+    {
+        return;
+    }
+    if (m_chunked)
+    {
+        char chunk_head[12];
+        int head_len = snprintf(chunk_head, sizeof(chunk_head), "%x\r\n", (unsigned)len);
+        writeData(chunk_head, head_len);
+        writeData(content, len);
+        writeData("\r\n", 2);
+    }
+    else
+    {
+        writeData(content, len);
+    }
+}
+
+void HttpServer::sendStatusLine(int code, const char *content_type, size_t content_length)
+{
+    char line[96];
+    int len = snprintf(line, sizeof(line), "HTTP/1.%d %d %s\r\n",
+                       m_cur->http11 ? 1 : 0, code, status_text(code));
+    writeData(line, len);
+    if (NULL != content_type)
+    {
+        len = snprintf(line, sizeof(line), "Content-Type: %s\r\n", content_type);
+        writeData(line, len);
+    }
+    if (CONTENT_LENGTH_UNKNOWN == content_length)
+    {
+        if (m_cur->http11)
+        {
+            m_chunked = true;
+            writeData("Transfer-Encoding: chunked\r\n", 28);
+        }
+        else
+        {
+            // HTTP/1.0 只能靠断开连接来结束正文
+            m_cur->keep_alive = false;
+        }
+    }
+    else if (304 != code)
+    {
+        // 304 不带正文，也不应声明长度
+        len = snprintf(line, sizeof(line), "Content-Length: %u\r\n", (unsigned)content_length);
+        writeData(line, len);
+    }
+    if (m_cur->keep_alive)
+    {
+        writeData("Connection: keep-alive\r\n", 24);
+    }
+    else
+    {
+        writeData("Connection: close\r\n", 19);
+    }
+    writeData(m_extra_headers, m_extra_headers_len);
+    writeData("\r\n", 2);
+}
+
+void HttpServer::writeData(const void *data, size_t len)
+{
+    const uint8_t *src = (const uint8_t *)data;
+    while (len > 0)
+    {
+        size_t room = HTTP_TX_BUF_SIZE - m_tx_len;
+        size_t copy_len = len < room ? len : room;
+        memcpy(m_tx + m_tx_len, src, copy_len);
+        m_tx_len += copy_len;
+        src += copy_len;
+        len -= copy_len;
+        if (HTTP_TX_BUF_SIZE == m_tx_len)
+        {
+            flush();
+        }
+    }
+}
+
+void HttpServer::flush()
+{
+    if (m_tx_len > 0 && NULL != m_cur && HTTP_CONN_CLOSING != m_cur->state)
+    {
+        if (!writeRaw(m_cur, m_tx, m_tx_len))
+        {
+            dropBacklog(m_cur);
+            m_cur->state = HTTP_CONN_CLOSING;
+        }
+    }
+    m_tx_len = 0;
+}
+
+// 不阻塞发送：发不出去的部分放进该连接的积压，由 run() 在可写时继续发送，
+// 其他连接不受影响。只有积压已满（单个回复很大且对端读得慢）时才等这个连接，
+// HTTP_SEND_STALL_TIMEOUT 内没有进展就放弃它
+bool HttpServer::writeRaw(HttpConn *c, const uint8_t *data, size_t len)
+{
+    if (NULL == c->tx)
+    {
+        while (len > 0)
+        {
+            int sent = ::send(c->fd, data, len, MSG_NOSIGNAL);
+            if (sent > 0)
+            {
+                data += sent;
+                len -= sent;
+                continue;
+            }
+            if (sent < 0 && (EAGAIN == errno || EWOULDBLOCK == errno))
+            {
+                break;
+            }
+            return false;
+        }
+        if (0 == len)
+        {
+            return true;
+        }
+        c->tx = (uint8_t *)malloc(HTTP_TX_BACKLOG_SIZE);
+        if (NULL == c->tx)
+        {
+            return false;
+        }
+        c->tx_head = 0;
+        c->tx_len = 0;
+    }
+    while (len > 0)
+    {
+        if (HTTP_TX_BACKLOG_SIZE == c->tx_len && c->tx_head > 0)
+        {
+            memmove(c->tx, c->tx + c->tx_head, c->tx_len - c->tx_head);
+            c->tx_len -= c->tx_head;
+            c->tx_head = 0;
+        }
+        size_t room = HTTP_TX_BACKLOG_SIZE - c->tx_len;
+        if (0 == room)
+        {
+            fd_set write_fds;
+            FD_ZERO(&write_fds);
+            FD_SET(c->fd, &write_fds);
+            struct timeval tv = {0, HTTP_SEND_STALL_TIMEOUT * 1000};
+            size_t head = c->tx_head;
+            if (select(c->fd + 1, NULL, &write_fds, NULL, &tv) <= 0 || !sendBacklog(c) ||
+                (NULL != c->tx && head == c->tx_head))
+            {
+                return false;
+            }
+            if (NULL == c->tx)
+            {
+                // 积压已全部发出
+                return writeRaw(c, data, len);
+            }
+            continue;
+        }
+        size_t copy_len = len < room ? len : room;
+        memcpy(c->tx + c->tx_len, data, copy_len);
+        c->tx_len += copy_len;
+        data += copy_len;
+        len -= copy_len;
+    }
+    return true;
+}
+
+// 发送积压的数据，发完后释放；对端出错时返回false
+bool HttpServer::sendBacklog(HttpConn *c)
+{
+    while (NULL != c->tx && c->tx_head < c->tx_len)
+    {
+        int sent = ::send(c->fd, c->tx + c->tx_head, c->tx_len - c->tx_head, MSG_NOSIGNAL);
+        if (sent > 0)
+        {
+            c->tx_head += sent;
+            c->last_active = millis();
+            continue;
+        }
+        if (sent < 0 && (EAGAIN == errno || EWOULDBLOCK == errno))
+        {
+            return true;
+        }
+        return false;
+    }
+    dropBacklog(c);
+    return true;
+}
+
+void HttpServer::dropBacklog(HttpConn *c)
+{
+    if (NULL != c->tx)
+    {
+        free(c->tx);
+        c->tx = NULL;
+    }
+    c->tx_head = 0;
+    c->tx_len = 0;
+}
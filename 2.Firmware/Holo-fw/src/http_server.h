@@ -0,0 +1,174 @@
+#ifndef HTTP_SERVER_H
+#define HTTP_SERVER_H
+
+#include <Arduino.h>
+#include <functional>
+#include <WebServer.h> // 复用 HTTPMethod / HTTPUploadStatus / CONTENT_LENGTH_UNKNOWN 的定义
+
+#define HTTP_MAX_CLIENTS 4           // 同时保持的连接数
+#define HTTP_RX_BUF_SIZE 2048        // 每个连接的接收缓存
+#define HTTP_MAX_HEAD_SIZE 1024      // 请求行+请求头的最大长度（其余部分作为请求体的窗口）
+#define HTTP_TX_BUF_SIZE 1460        // 发送缓存（处理函数串行执行，所有连接共用）
+#define HTTP_TX_BACKLOG_SIZE 8192    // 每个连接的发送积压（按需分配），对端读得慢时先存在这里
+#define HTTP_MAX_ARGS 8
+#define HTTP_MAX_HEADERS 12
+#define HTTP_MAX_ROUTES 16
+#define HTTP_FILENAME_MAX_LEN 100
+#define HTTP_KEEP_ALIVE_TIMEOUT 5000 // 空闲连接的超时时间（ms）
+#define HTTP_SEND_STALL_TIMEOUT 200  // 积压已满时等待该连接发出数据的最长时间（ms），没有进展就断开
+#define HTTP_SELECT_TIMEOUT 100      // 事件等待的超时时间（ms）
+
+#define HTTP_TASK_STACK_SIZE 8192
+#define HTTP_TASK_PRIORITY 2
+#define HTTP_TASK_CORE 0 // loop() 跑在core1，服务端放到core0
+
+struct HttpUpload
+{
+    HTTPUploadStatus status;
+    String filename;
+    String name;
+    String type;
+    size_t totalSize;
+    size_t currentSize;
+    const uint8_t *buf; // 直接指向连接的接收缓存，不做拷贝
+};
+
+enum HTTP_CONN_STATE : unsigned char
+{
+    HTTP_CONN_FREE = 0,
+    HTTP_CONN_HEAD, // 等待完整的请求头
+    HTTP_CONN_BODY, // 读取请求体
+    HTTP_CONN_CLOSING
+};
+
+enum HTTP_MULTIPART_STATE : unsigned char
+{
+    HTTP_MP_NONE = 0,
+    HTTP_MP_PREAMBLE,
+    HTTP_MP_PART_HEADERS,
+    HTTP_MP_PART_DATA,
+    HTTP_MP_DONE
+};
+
+struct HttpConn
+{
+    int fd;
+    HTTP_CONN_STATE state;
+    uint8_t rx[HTTP_RX_BUF_SIZE];
+    size_t rx_len;   // 缓存中的有效数据长度
+    size_t head_len; // rx[0, head_len) 保存已解析的请求头（参数均指向这里）
+    unsigned long last_active;
+    bool http11;
+    bool keep_alive;
+
+    HTTPMethod method;
+    const char *path;
+    const char *arg_name[HTTP_MAX_ARGS];
+    const char *arg_value[HTTP_MAX_ARGS];
+    uint8_t arg_num;
+    const char *hdr_name[HTTP_MAX_HEADERS];
+    const char *hdr_value[HTTP_MAX_HEADERS];
+    uint8_t hdr_num;
+    size_t body_left; // 还未处理的请求体长度
+    int route;        // 匹配到的路由下标 -1为未匹配
+    bool form_body;   // application/x-www-form-urlencoded 请求体，收齐后解析为参数
+
+    uint8_t *tx;    // 发送积压，为NULL时没有积压
+    size_t tx_head; // tx[tx_head, tx_len) 还未发出
+    size_t tx_len;
+
+    HTTP_MULTIPART_STATE mp_state;
+    char boundary[80]; // "\r\n--" + boundary
+    uint8_t boundary_len;
+    bool mp_is_file;
+    char upload_filename[HTTP_FILENAME_MAX_LEN];
+    char upload_name[32];
+    char upload_type[48];
+    size_t upload_total;
+};
+
+class HttpServer
+{
+public:
+    typedef std::function<void(void)> THandlerFunction;
+
+private:
+    struct Route
+    {
+        const char *uri;
+        HTTPMethod method;
+        THandlerFunction fn;
+        THandlerFunction ufn;
+    };
+
+    uint16_t m_port;
+    int m_listen_fd;
+    Route m_routes[HTTP_MAX_ROUTES];
+    uint8_t m_route_num;
+    HttpConn m_conns[HTTP_MAX_CLIENTS];
+    HttpConn *m_upload_owner; // m_upload 中文件名等字段所属的连接
+
+    // 当前正在处理的请求（处理函数都在服务任务中串行调用）
+    HttpConn *m_cur;
+    HttpUpload m_upload;
+    bool m_responded;
+    bool m_chunked;
+    size_t m_content_length;
+    char m_extra_headers[256];
+    size_t m_extra_headers_len;
+    uint8_t m_tx[HTTP_TX_BUF_SIZE];
+    size_t m_tx_len;
+
+public:
+    HttpServer(uint16_t port = 80);
+    void on(const char *uri, HTTPMethod method, THandlerFunction fn);
+    void on(const char *uri, HTTPMethod method, THandlerFunction fn, THandlerFunction ufn);
+    bool begin(); // 创建监听socket并启动服务任务
+    void run();   // 服务任务的主循环
+
+    // 以下接口只能在处理函数中调用
+    String uri();
+    HTTPMethod method();
+    int args();
+    String arg(int i);
+    String arg(const char *name);
+    bool hasArg(const char *name);
+    String header(const char *name);
+    bool hasHeader(const char *name);
+    int clientSlot(); // 当前连接的下标，用于保存每个连接自己的上下文
+    HttpUpload &upload();
+
+    void setContentLength(size_t content_length);
+    void sendHeader(const char *name, const String &value);
+    void send(int code, const char *content_type = NULL, const String &content = String(""));
+    void sendContent(const String &content);
+    void sendContent(const char *content, size_t len);
+
+private:
+    void acceptClient();
+    void closeConn(HttpConn *c);
+    void resetRequest(HttpConn *c);
+    bool readConn(HttpConn *c);
+    void processConn(HttpConn *c);
+    int parseHead(HttpConn *c, size_t head_end);
+    void parseQuery(HttpConn *c, char *query);
+    void parseForm(HttpConn *c);
+    const char *findHeader(HttpConn *c, const char *name);
+    void consumeBody(HttpConn *c, size_t len);
+    size_t parseMultipart(HttpConn *c, uint8_t *data, size_t len, bool is_last);
+    void callUpload(HttpConn *c, HTTPUploadStatus status, const uint8_t *buf, size_t len);
+    void beginResponse(HttpConn *c);
+    void endResponse();
+    void failConn(HttpConn *c, int code, const char *msg);
+    void dispatch(HttpConn *c);
+    void finishRequest(HttpConn *c);
+
+    void sendStatusLine(int code, const char *content_type, size_t content_length);
+    void writeData(const void *data, size_t len);
+    void flush();
+    bool writeRaw(HttpConn *c, const uint8_t *data, size_t len);
+    bool sendBacklog(HttpConn *c);
+    void dropBacklog(HttpConn *c);
+};
+
+#endif
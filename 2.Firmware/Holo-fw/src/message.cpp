@@ -3,8 +3,8 @@
 
 MsgHead::MsgHead(MODULE_TYPE from_who, MODULE_TYPE to_who)
 {
-    m_header_mark = 0x2323;
-    m_msg_len = 7;
+    m_header_mark = MSG_HEADER_MARK;
+    m_msg_len = MSG_HEAD_SIZE;
     m_from_who = from_who;
     m_to_who = to_who;
     m_action_type = AT_UNKNOWN;
@@ -16,12 +16,12 @@ uint32_t MsgHead::decode(const uint8_t *msg)
     {
         return 0;
     }
-    m_msg_len = msg[2] << 8 + msg[3];
-    // m_msg_len = ntohs(msg[2] << 8 + msg[3]);
+    m_header_mark = (msg[0] << 8) | msg[1];
+    m_msg_len = (msg[2] << 8) | msg[3];
     m_from_who = (MODULE_TYPE)msg[4];
     m_to_who = (MODULE_TYPE)msg[5];
     m_action_type = (ACTION_TYPE)msg[6];
-    return 7;
+    return MSG_HEAD_SIZE;
 }
 
 uint32_t MsgHead::encode(uint8_t *msg)
@@ -30,21 +30,19 @@ uint32_t MsgHead::encode(uint8_t *msg)
     {
         return 0;
     }
-    msg[0] = 0x23;
-    msg[1] = 0x23;
+    msg[0] = (uint8_t)(MSG_HEADER_MARK >> 8);
+    msg[1] = (uint8_t)(MSG_HEADER_MARK & 0x00FF);
     msg[2] = (uint8_t)(m_msg_len >> 8);
     msg[3] = (uint8_t)(m_msg_len & 0x00FF);
     msg[4] = (uint8_t)m_from_who;
     msg[5] = (uint8_t)m_to_who;
     msg[6] = (uint8_t)m_action_type;
-    // uint16_t msg_len = htons(m_msg_len);
-    // memcpy((uint8_t *)&msg_len, &msg[4], 2);
-    return 7;
+    return MSG_HEAD_SIZE;
 }
 
 bool MsgHead::isLegal()
 {
-    if (m_header_mark != 0x2323)
+    if (m_header_mark != MSG_HEADER_MARK || m_msg_len < MSG_HEAD_SIZE)
     {
         return false;
     }
@@ -76,12 +74,12 @@ uint32_t SettingsMsg::decode(const uint8_t *msg)
     // setting数据的后面是以空格隔开的数据段 一般三段
     const char *p_ch = (const char *)msg + index;
     //
-    strncpy(m_prefs_name, p_ch, 15);
+    strncpy(m_prefs_name, p_ch, sizeof(m_prefs_name) - 1);
     for (; *p_ch != 0x00; ++p_ch)
         ;
     p_ch++;
 
-    strncpy(m_key, p_ch, 16);
+    strncpy(m_key, p_ch, sizeof(m_key) - 1);
     for (; *p_ch != 0x00; ++p_ch)
         ;
     p_ch++;
@@ -108,7 +106,7 @@ uint32_t SettingsMsg::decode(const uint8_t *msg)
     break;
     case VALUE_TYPE_STRING:
     {
-        strncpy((char *)m_value, p_ch, 16);
+        strncpy((char *)m_value, p_ch, sizeof(m_value) - 1);
         for (; (*p_ch != ' ') && (*p_ch != '\r'); ++p_ch)
             ;
         p_ch++;
@@ -176,112 +174,152 @@ bool SettingsMsg::isLegal()
 }
 
 /********************************************************/
-/* FileSystem
+/* MsgReader / MsgWriter
 *********************************************************/
 
-FileSystem::FileSystem(ACTION_TYPE action_type)
+MsgReader::MsgReader(const uint8_t *data, uint32_t len) : m_pos(data), m_end(data + len), m_ok(NULL != data)
 {
-    m_msg_head.m_from_who = MODULE_TYPE_CUBIC_FILE_MANAGER;
-    m_msg_head.m_to_who = MODULE_TYPE_C_FILE_MANAGER;
-    m_msg_head.m_action_type = action_type;
-};
+}
 
-uint32_t FileSystem::decode(const uint8_t *msg)
+const uint8_t *MsgReader::bytes(uint32_t len)
 {
-    if (NULL == msg)
+    if (!m_ok || len > (uint32_t)(m_end - m_pos))
     {
-        return 0;
+        m_ok = false;
+        return NULL;
     }
-    uint32_t index = m_msg_head.decode(msg);
-    m_msg_head.m_action_type = (ACTION_TYPE)msg[index];
-    return index + 1;
+    const uint8_t *data = m_pos;
+    m_pos += len;
+    return data;
 }
 
-uint32_t FileSystem::encode(uint8_t *msg)
+uint8_t MsgReader::u8()
 {
-    if (NULL == msg)
+    const uint8_t *p = bytes(1);
+    return NULL == p ? 0 : p[0];
+}
+
+uint16_t MsgReader::u16()
+{
+    const uint8_t *p = bytes(2);
+    return NULL == p ? 0 : (p[0] << 8) | p[1];
+}
+
+uint32_t MsgReader::u32()
+{
+    const uint8_t *p = bytes(4);
+    return NULL == p ? 0 : ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+const char *MsgReader::str()
+{
+    uint16_t len = u16();
+    const uint8_t *p = bytes(len);
+    // 长度含结尾的'\0'，中间不能再有'\0'，这样可以直接当作C字符串使用
+    if (NULL == p || 0 == len || 0 != p[len - 1] || NULL != memchr(p, 0, len - 1))
     {
-        return false;
+        m_ok = false;
+        return NULL;
     }
-    uint32_t index = m_msg_head.encode(msg);
-    msg[index] = (uint8_t)m_msg_head.m_action_type;
-    return index + 1;
+    return (const char *)p;
 }
 
-/********************************************************/
-/* DirCreate
-*********************************************************/
+const uint8_t *MsgReader::rest(uint32_t *len)
+{
+    *len = m_ok ? m_end - m_pos : 0;
+    return bytes(*len);
+}
 
-DirCreate::DirCreate(const char *dir_name)
+MsgWriter::MsgWriter(uint8_t *buf, uint32_t cap) : m_buf(buf), m_cap(cap), m_len(0), m_ok(NULL != buf)
 {
-    m_file_system.m_msg_head.m_action_type = AT_DIR_CREATE;
-    strncpy(m_dir_path, dir_name, 99);
-};
+}
 
-uint32_t DirCreate::decode(const uint8_t *msg)
+uint8_t *MsgWriter::reserve(uint32_t len)
 {
-    if (NULL == msg)
+    if (!m_ok || len > m_cap - m_len)
     {
-        return 0;
+        m_ok = false;
+        return NULL;
     }
-    uint32_t index = m_file_system.decode(msg);
-    memcpy(m_dir_path, (char *)&msg[index], 99);
-    return index + strlen((char *)&msg[index]);
+    uint8_t *p = m_buf + m_len;
+    m_len += len;
+    return p;
 }
 
-uint32_t DirCreate::encode(uint8_t *msg)
+void MsgWriter::truncate(uint32_t len)
 {
-    if (NULL == msg)
+    if (len < m_len)
     {
-        return false;
+        m_len = len;
     }
-    uint32_t index = m_file_system.encode(msg);
-    strncpy((char *)&msg[index], m_dir_path, 99);
-    return index + strlen(m_dir_path);
 }
 
-/********************************************************/
-/* DirList
-*********************************************************/
+void MsgWriter::u8(uint8_t value)
+{
+    uint8_t *p = reserve(1);
+    if (NULL != p)
+    {
+        p[0] = value;
+    }
+}
 
-DirList::DirList(const char *dir_path, const char *dir_info)
+void MsgWriter::u16(uint16_t value)
 {
-    m_file_system.m_msg_head.m_action_type = AT_DIR_LIST;
+    uint8_t *p = reserve(2);
+    if (NULL != p)
+    {
+        p[0] = (uint8_t)(value >> 8);
+        p[1] = (uint8_t)value;
+    }
+}
 
-    if (NULL != dir_path)
+void MsgWriter::u32(uint32_t value)
+{
+    uint8_t *p = reserve(4);
+    if (NULL != p)
     {
-        memcpy(m_dir_path, dir_path, 99);
+        p[0] = (uint8_t)(value >> 24);
+        p[1] = (uint8_t)(value >> 16);
+        p[2] = (uint8_t)(value >> 8);
+        p[3] = (uint8_t)value;
     }
-    if (NULL != dir_info)
+}
+
+void MsgWriter::str(const char *value)
+{
+    uint32_t len = strlen(value) + 1;
+    if (len > 0xFFFF)
     {
-        memcpy(m_dir_info, dir_info, 400);
+        m_ok = false;
+        return;
     }
-};
+    u16((uint16_t)len);
+    bytes(value, len);
+}
 
-uint32_t DirList::decode(const uint8_t *msg)
+void MsgWriter::bytes(const void *data, uint32_t len)
 {
-    if (NULL == msg)
+    uint8_t *p = reserve(len);
+    if (NULL != p)
     {
-        return 0;
+        memcpy(p, data, len);
     }
-    uint32_t index = m_file_system.decode(msg);
-    memcpy(m_dir_path, (char *)&msg[index], 99);
-    memcpy(m_dir_info, (char *)&msg[index + 99], 400);
-    m_dir_path[98] = 0;
-    m_dir_info[399] = 0;
-    return index + 499;
 }
 
-uint32_t DirList::encode(uint8_t *msg)
+int32_t msg_frame_length(const uint8_t *buf, uint32_t len, uint32_t max_len)
 {
-    if (NULL == msg)
+    if (len >= 2 && MSG_HEADER_MARK != ((buf[0] << 8) | buf[1]))
     {
-        return false;
+        return -1;
     }
-    uint32_t index = m_file_system.encode(msg);
-    strncpy((char *)&msg[index], m_dir_path, 99);
-    strncpy((char *)&msg[index + 99], m_dir_info, 400);
-    m_file_system.m_msg_head.m_msg_len = index + 499;
-    m_file_system.encode(msg);
-    return index + 499;
-}
\ No newline at end of file
+    if (len < 4)
+    {
+        return 0;
+    }
+    uint32_t frame_len = (buf[2] << 8) | buf[3];
+    if (frame_len < MSG_HEAD_SIZE || frame_len > max_len)
+    {
+        return -1;
+    }
+    return frame_len <= len ? (int32_t)frame_len : 0;
+}
@@ -4,6 +4,12 @@
 #include "stdint.h"
 #include <string.h>
 
+// 二进制消息：每帧以7字节的 MsgHead 开头（大端）
+//   "##"(0x2323) | 整帧长度 uint16 | from | to | action
+// 文件管理协议建立在它上面（见 file_service.h）
+#define MSG_HEADER_MARK 0x2323
+#define MSG_HEAD_SIZE 7
+
 enum MODULE_TYPE : unsigned char
 {
     MODULE_TYPE_UNKNOW = 0,
@@ -79,43 +85,66 @@ public:
     uint32_t encode(uint8_t *msg);
 };
 
-class FileSystem
+// 文件管理的回复状态
+enum MSG_STATUS : unsigned char
 {
-public:
-    MsgHead m_msg_head;
-
-public:
-    FileSystem(ACTION_TYPE action_type = AT_FREE_STATUS);
-    ~FileSystem(){};
-    uint32_t decode(const uint8_t *msg);
-    uint32_t encode(uint8_t *msg);
+    MSG_OK = 0,
+    MSG_ERR_BAD_REQUEST, // 字段缺失或越界
+    MSG_ERR_UNSUPPORTED, // 未知的 action
+    MSG_ERR_NOT_FOUND,
+    MSG_ERR_EXISTS,
+    MSG_ERR_NOT_DIR,
+    MSG_ERR_OFFSET, // 写入的偏移不等于文件当前长度（回复中带当前长度，用于续传）
+    MSG_ERR_IO
 };
 
-class DirCreate
+// 按顺序读取一帧中的字段，字符串和数据直接指向帧所在的缓存，不做拷贝
+// 字段：整数为大端；字符串为 长度uint16（含结尾'\0'）+ 内容 + '\0'
+// 越界或格式不对之后 ok() 返回false，后续读取都返回 0/NULL
+class MsgReader
 {
-public:
-    FileSystem m_file_system;
-    char m_dir_path[99];
+private:
+    const uint8_t *m_pos;
+    const uint8_t *m_end;
+    bool m_ok;
 
 public:
-    DirCreate(const char *dir_name = NULL);
-    ~DirCreate(){};
-    uint32_t decode(const uint8_t *msg);
-    uint32_t encode(uint8_t *msg);
+    MsgReader(const uint8_t *data, uint32_t len);
+    bool ok() const { return m_ok; }
+    uint32_t left() const { return m_end - m_pos; }
+    uint8_t u8();
+    uint16_t u16();
+    uint32_t u32();
+    const char *str();
+    const uint8_t *bytes(uint32_t len);
+    const uint8_t *rest(uint32_t *len); // 剩余的全部数据
 };
 
-class DirList
+// 按顺序把字段写入调用方的缓存，空间不足之后 ok() 返回false
+class MsgWriter
 {
-public:
-    FileSystem m_file_system;
-    char m_dir_path[99];
-    char m_dir_info[400];   // 用来承载子文件的文件名 多个文件名之间使用\t分隔
+private:
+    uint8_t *m_buf;
+    uint32_t m_cap;
+    uint32_t m_len;
+    bool m_ok;
 
 public:
-    DirList(const char *dir_path = NULL, const char *dir_info = NULL);
-    ~DirList(){};
-    uint32_t decode(const uint8_t *msg);
-    uint32_t encode(uint8_t *msg);
+    MsgWriter(uint8_t *buf, uint32_t cap);
+    bool ok() const { return m_ok; }
+    uint32_t length() const { return m_len; }
+    uint32_t room() const { return m_cap - m_len; }
+    void u8(uint8_t value);
+    void u16(uint16_t value);
+    void u32(uint32_t value);
+    void str(const char *value);
+    void bytes(const void *data, uint32_t len);
+    // 预留 len 字节由调用方直接填充（如从文件读入），返回写入位置
+    uint8_t *reserve(uint32_t len);
+    void truncate(uint32_t len);
 };
 
-#endif
\ No newline at end of file
+// buf 开头是一帧完整的数据时返回帧长度，数据还不够返回0，帧头非法或超过 max_len 返回-1
+int32_t msg_frame_length(const uint8_t *buf, uint32_t len, uint32_t max_len);
+
+#endif
@@ -0,0 +1,154 @@
+#include "mqtt_status.h"
+#include "common.h"
+#include "sys/settings.h"
+#include "app/picture/picture.h"
+
+#include <WiFi.h>
+#include <PubSubClient.h>
+
+struct MqttConfig
+{
+    String host;
+    uint16_t port;
+    String user;
+    String pass;
+    String topic;
+    String client_id;
+};
+
+static MqttConfig mqtt_cfg;
+static WiFiClient mqtt_net;
+static PubSubClient mqtt_client(mqtt_net);
+
+// 单项更新时与其它两项的最新值合并
+static int status_progress = 0;
+static int status_head = 0;
+static int status_bed = 0;
+
+static void mqtt_callback(char *topic, uint8_t *payload, unsigned int length)
+{
+    char value[MQTT_PAYLOAD_MAX_LEN + 1];
+    if (length > MQTT_PAYLOAD_MAX_LEN)
+    {
+        length = MQTT_PAYLOAD_MAX_LEN;
+    }
+    memcpy(value, payload, length);
+    value[length] = 0;
+
+    const char *sub = topic + mqtt_cfg.topic.length();
+    if (0 == *sub)
+    {
+        // "prog;head;bed"
+        char *next = value;
+        status_progress = strtol(next, &next, 10);
+        if (';' == *next)
+        {
+            status_head = strtol(next + 1, &next, 10);
+        }
+        if (';' == *next)
+        {
+            status_bed = strtol(next + 1, &next, 10);
+        }
+    }
+    else if (!strcmp(sub, "/progress"))
+    {
+        status_progress = atoi(value);
+    }
+    else if (!strcmp(sub, "/head"))
+    {
+        status_head = atoi(value);
+    }
+    else if (!strcmp(sub, "/bed"))
+    {
+        status_bed = atoi(value);
+    }
+    else
+    {
+        return;
+    }
+    // 连续到达的多条消息只记录最新值，界面每帧最多刷新一次（见 picture_process）
+    update_print_status(status_progress, status_head, status_bed);
+}
+
+static bool mqtt_connect()
+{
+    bool ok;
+    if (mqtt_cfg.user.length() > 0)
+    {
+        ok = mqtt_client.connect(mqtt_cfg.client_id.c_str(), mqtt_cfg.user.c_str(), mqtt_cfg.pass.c_str());
+    }
+    else
+    {
+        ok = mqtt_client.connect(mqtt_cfg.client_id.c_str());
+    }
+    if (!ok)
+    {
+        Serial.printf("MQTT connect failed, state %d\n", mqtt_client.state());
+        return false;
+    }
+    String sub_topic = mqtt_cfg.topic + "/+";
+    mqtt_client.subscribe(mqtt_cfg.topic.c_str());
+    mqtt_client.subscribe(sub_topic.c_str());
+    Serial.printf("MQTT connected, topic %s\n", mqtt_cfg.topic.c_str());
+    return true;
+}
+
+static void mqtt_task(void *param)
+{
+    unsigned long retry_interval = MQTT_RECONNECT_MIN;
+    unsigned long last_retry = 0;
+    bool first = true;
+    while (true)
+    {
+        if (mqtt_client.connected())
+        {
+            mqtt_client.loop();
+        }
+        else if (WiFi.status() == WL_CONNECTED &&
+                 (first || millis() - last_retry >= retry_interval))
+        {
+            first = false;
+            last_retry = millis();
+            if (mqtt_connect())
+            {
+                retry_interval = MQTT_RECONNECT_MIN;
+            }
+            else if (retry_interval < MQTT_RECONNECT_MAX)
+            {
+                retry_interval = min(retry_interval * 2, (unsigned long)MQTT_RECONNECT_MAX);
+            }
+        }
+        vTaskDelay(MQTT_LOOP_INTERVAL / portTICK_PERIOD_MS);
+    }
+}
+
+static void read_mqtt_config()
+{
+    mqtt_cfg.host = settings_get_str(SETTINGS_TXT_PREFIX "mqtt_host");
+    String port = settings_get_str(SETTINGS_TXT_PREFIX "mqtt_port");
+    mqtt_cfg.port = port.length() > 0 ? port.toInt() : MQTT_DEFAULT_PORT;
+    mqtt_cfg.user = settings_get_str(SETTINGS_TXT_PREFIX "mqtt_user");
+    mqtt_cfg.pass = settings_get_str(SETTINGS_TXT_PREFIX "mqtt_pass");
+    mqtt_cfg.topic = settings_get_str(SETTINGS_TXT_PREFIX "mqtt_topic", MQTT_DEFAULT_TOPIC);
+}
+
+bool mqtt_status_init()
+{
+    read_mqtt_config();
+    if (0 == mqtt_cfg.host.length())
+    {
+        return false;
+    }
+    uint8_t mac[6];
+    WiFi.macAddress(mac);
+    char client_id[16];
+    snprintf(client_id, sizeof(client_id), "holo-%02x%02x%02x", mac[3], mac[4], mac[5]);
+    mqtt_cfg.client_id = client_id;
+
+    mqtt_client.setServer(mqtt_cfg.host.c_str(), mqtt_cfg.port);
+    mqtt_client.setCallback(mqtt_callback);
+    xTaskCreatePinnedToCore(mqtt_task, "mqtt", MQTT_TASK_STACK_SIZE, NULL,
+                            MQTT_TASK_PRIORITY, NULL, MQTT_TASK_CORE);
+    Serial.printf("MQTT broker %s:%u\n", mqtt_cfg.host.c_str(), mqtt_cfg.port);
+    return true;
+}
@@ -0,0 +1,29 @@
+#ifndef MQTT_STATUS_H
+#define MQTT_STATUS_H
+
+#include <Arduino.h>
+
+// 通过MQTT订阅打印机状态（替代轮询 GET /status）
+// config.txt 中的可选配置（任意行，key:value，开机时导入设置，见 sys/settings.h）：
+//   mqtt_host:192.168.1.10
+//   mqtt_port:1883
+//   mqtt_user:xxx
+//   mqtt_pass:xxx
+//   mqtt_topic:holo/printer
+// 订阅 <topic>（内容与 /status 的 stu 参数相同 "prog;head;bed"）
+// 以及 <topic>/progress、<topic>/head、<topic>/bed（单个数值）
+#define MQTT_DEFAULT_PORT 1883
+#define MQTT_DEFAULT_TOPIC "holo/printer"
+#define MQTT_PAYLOAD_MAX_LEN 32
+#define MQTT_RECONNECT_MIN 1000   // 重连间隔（ms），失败后逐次加倍
+#define MQTT_RECONNECT_MAX 30000
+#define MQTT_LOOP_INTERVAL 10     // 处理一次收发的间隔（ms）
+
+#define MQTT_TASK_STACK_SIZE 4096
+#define MQTT_TASK_PRIORITY 1
+#define MQTT_TASK_CORE 0
+
+// 读取配置，未配置 mqtt_host 时不启动
+bool mqtt_status_init();
+
+#endif
@@ -0,0 +1,186 @@
+#include "asset_pack.h"
+
+#include <string.h>
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *data, uint32_t len)
+{
+    // 半字节查表，与 zlib.crc32 相同（打包工具用它计算）
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+    crc = ~crc;
+    while (len--)
+    {
+        crc ^= *data++;
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+static uint32_t read_u16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t read_u32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+AssetPack::AssetPack() : m_map(NULL), m_size(0), m_count(0)
+{
+}
+
+bool AssetPack::open(const uint8_t *map, uint32_t size)
+{
+    close();
+    if (size < ASSET_HEADER_SIZE || ASSET_MAGIC != read_u32(map) || ASSET_FORMAT_VERSION != read_u16(map + 4))
+    {
+        return false;
+    }
+    uint16_t count = read_u16(map + 6);
+    uint32_t image_size = read_u32(map + 8);
+    uint32_t index_end = ASSET_HEADER_SIZE + (uint32_t)count * ASSET_ENTRY_SIZE;
+    if (image_size > size || index_end > image_size)
+    {
+        return false;
+    }
+    uint32_t crc = crc32_update(0, map + 4, 8);
+    if (read_u32(map + 12) != crc32_update(crc, map + ASSET_HEADER_SIZE, index_end - ASSET_HEADER_SIZE))
+    {
+        return false;
+    }
+    // 索引通过了 crc 仍检查一遍边界和顺序，之后的查找不再检查
+    const char *prev = NULL;
+    for (uint16_t index = 0; index < count; ++index)
+    {
+        const uint8_t *raw = map + ASSET_HEADER_SIZE + index * ASSET_ENTRY_SIZE;
+        const char *name = (const char *)raw;
+        uint32_t offset = read_u32(raw + 24);
+        uint32_t len = read_u32(raw + 28);
+        if (0 != name[ASSET_NAME_MAX] || 0 == name[0] || (NULL != prev && strcmp(prev, name) >= 0) ||
+            offset % ASSET_ALIGN || offset < index_end || offset > image_size || len > image_size - offset)
+        {
+            return false;
+        }
+        prev = name;
+    }
+    m_map = map;
+    m_size = image_size;
+    m_count = count;
+    return true;
+}
+
+void AssetPack::close()
+{
+    m_map = NULL;
+    m_size = 0;
+    m_count = 0;
+}
+
+const uint8_t *AssetPack::entry(uint16_t index) const
+{
+    return m_map + ASSET_HEADER_SIZE + index * ASSET_ENTRY_SIZE;
+}
+
+bool AssetPack::at(uint16_t index, Asset *asset) const
+{
+    if (index >= m_count)
+    {
+        return false;
+    }
+    const uint8_t *raw = entry(index);
+    asset->name = (const char *)raw;
+    asset->data = m_map + read_u32(raw + 24);
+    asset->size = read_u32(raw + 28);
+    asset->crc = read_u32(raw + 32);
+    asset->type = raw[36];
+    return true;
+}
+
+int AssetPack::indexOf(const char *name) const
+{
+    int low = 0, high = m_count - 1;
+    while (low <= high)
+    {
+        int mid = (low + high) >> 1;
+        int cmp = strcmp(name, (const char *)entry(mid));
+        if (cmp < 0)
+        {
+            high = mid - 1;
+        }
+        else if (cmp > 0)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            return mid;
+        }
+    }
+    return -1;
+}
+
+bool AssetPack::find(const char *name, Asset *asset, uint8_t type) const
+{
+    int index = indexOf(name);
+    return index >= 0 && at(index, asset) && (0xFF == type || type == asset->type);
+}
+
+bool AssetPack::verify(const Asset &asset) const
+{
+    return asset.crc == crc32_update(0, asset.data, asset.size);
+}
+
+bool asset_img_info(const Asset &asset, AssetImgInfo *info)
+{
+    if (ASSET_TYPE_IMG != asset.type || asset.size < 4)
+    {
+        return false;
+    }
+    // lv_img_header_t：cf(5) always_zero(3) reserved(2) w(11) h(11)，从低位开始
+    uint32_t header = read_u32(asset.data);
+    if (0 != (header & 0xE0))
+    {
+        return false;
+    }
+    info->cf = header & 0x1F;
+    info->w = (header >> 10) & 0x7FF;
+    info->h = header >> 21;
+    info->pixels = asset.data + 4;
+    info->pixel_size = asset.size - 4;
+    uint32_t pixels = (uint32_t)info->w * info->h;
+    uint32_t expect;
+    switch (info->cf)
+    {
+    case 4: // LV_IMG_CF_TRUE_COLOR
+    case 6: // LV_IMG_CF_TRUE_COLOR_CHROMA_KEYED
+        expect = pixels * ASSET_COLOR_DEPTH / 8;
+        break;
+    case 5: // LV_IMG_CF_TRUE_COLOR_ALPHA
+        expect = pixels * (ASSET_COLOR_DEPTH / 8 + 1);
+        break;
+    case 7: // LV_IMG_CF_INDEXED_1BIT ~ 8BIT，调色板每色4字节
+    case 8:
+    case 9:
+    case 10:
+    {
+        uint8_t bpp = 1 << (info->cf - 7);
+        expect = 4 * (1 << bpp) + (info->w * bpp + 7) / 8 * info->h;
+        break;
+    }
+    case 11: // LV_IMG_CF_ALPHA_1BIT ~ 8BIT
+    case 12:
+    case 13:
+    case 14:
+    {
+        uint8_t bpp = 1 << (info->cf - 11);
+        expect = (info->w * bpp + 7) / 8 * info->h;
+        break;
+    }
+    default:
+        return false;
+    }
+    return 0 != pixels && expect == info->pixel_size;
+}
@@ -0,0 +1,80 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 只读资源包：字体、系统图片等由 tools/asset_pack.py 打包成一个镜像，烧录到单独的分区，
+// 映射后直接把指向flash的指针交给LVGL和TJpgDec使用，不复制到内存，开机也不遍历文件系统
+// 只依赖标准头文件，可在PC上编译（见 tools/asset_check.cpp）
+// 镜像格式（小端）：
+//   16 字节的包头                    magic version count size crc
+//   count 个 40 字节的索引项          name[24] offset size crc type reserved[3]，按名称升序
+//   各项数据                         按 ASSET_ALIGN 对齐
+// 包头的 crc 覆盖包头其余字段和整个索引，open() 只检查它；各项数据的 crc 由 verify() 按需检查
+#define ASSET_MAGIC 0x31534148 // "HAS1"
+#define ASSET_FORMAT_VERSION 1
+#define ASSET_HEADER_SIZE 16
+#define ASSET_ENTRY_SIZE 40
+#define ASSET_NAME_MAX 23 // 名称如 "font/ch_font_20"，不含扩展名
+#define ASSET_ALIGN 32    // flash cache 行的大小
+#define ASSET_COLOR_DEPTH 16 // 与 lv_conf.h 中的 LV_COLOR_DEPTH 一致
+
+enum ASSET_TYPE : uint8_t
+{
+    ASSET_TYPE_RAW = 0,
+    ASSET_TYPE_FONT, // 点阵字体，格式见 driver/glyph_font.h
+    ASSET_TYPE_IMG,  // LVGL 的二进制图片：4字节的 lv_img_header_t 后接像素
+    ASSET_TYPE_JPEG
+};
+
+struct Asset
+{
+    const char *name; // 指向映射中的索引
+    const uint8_t *data;
+    uint32_t size;
+    uint32_t crc;
+    uint8_t type;
+};
+
+// ASSET_TYPE_IMG 的图片头
+struct AssetImgInfo
+{
+    uint8_t cf; // lv_img_cf_t
+    uint16_t w;
+    uint16_t h;
+    const uint8_t *pixels;
+    uint32_t pixel_size;
+};
+
+class AssetPack
+{
+private:
+    const uint8_t *m_map;
+    uint32_t m_size; // 镜像的大小（不是分区的大小）
+    uint16_t m_count;
+
+    const uint8_t *entry(uint16_t index) const;
+
+public:
+    AssetPack();
+    // map 为整个分区的映射，size 为分区大小；镜像无效时返回false
+    bool open(const uint8_t *map, uint32_t size);
+    void close();
+    bool isOpen() const { return NULL != m_map; }
+    uint16_t count() const { return m_count; }
+    uint32_t imageSize() const { return m_size; }
+
+    // 二分查找，没有时返回 -1
+    int indexOf(const char *name) const;
+    // type 不为 0xFF 时还要求类型一致
+    bool find(const char *name, Asset *asset, uint8_t type = 0xFF) const;
+    bool at(uint16_t index, Asset *asset) const;
+    // 计算数据的 crc，需要读一遍数据
+    bool verify(const Asset &asset) const;
+};
+
+// 解析并检查 ASSET_TYPE_IMG 的图片头，像素数据的长度须与格式和尺寸相符
+bool asset_img_info(const Asset &asset, AssetImgInfo *info);
+
+#endif
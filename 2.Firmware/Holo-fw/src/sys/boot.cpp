@@ -0,0 +1,215 @@
+#include "boot.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/event_groups.h>
+#include <freertos/semphr.h>
+
+struct BootStage
+{
+    const char *name;
+    BootFunc fn;
+    uint32_t deps;
+    BOOT_RUN_ON run_on;
+    int core;
+    unsigned long start; // 相对于 boot_run() 开始的时间（ms）
+    unsigned long end;
+};
+
+static BootStage stages[BOOT_MAX_STAGES];
+static uint8_t stage_num = 0;
+static uint32_t background_mask = 0;
+static unsigned long boot_begin = 0;
+
+// 调度状态：各任务结束时自行启动新满足依赖的步骤，不必等主任务空闲
+static SemaphoreHandle_t sched_lock = NULL;
+static EventGroupHandle_t done_group = NULL; // 用于唤醒等待中的主任务
+static uint32_t started = 0;
+static uint32_t done = 0;
+
+int boot_add(const char *name, BootFunc fn, uint32_t deps, BOOT_RUN_ON run_on)
+{
+    if (stage_num >= BOOT_MAX_STAGES || (deps & ~(BOOT_DEP(stage_num) - 1)) || (deps & background_mask))
+    {
+        Serial.printf("Boot: bad stage %s\n", name);
+        return -1;
+    }
+    BootStage *stage = &stages[stage_num];
+    stage->name = name;
+    stage->fn = fn;
+    stage->deps = deps;
+    stage->run_on = run_on;
+    stage->core = -1;
+    if (BOOT_ON_BACKGROUND == run_on)
+    {
+        background_mask |= BOOT_DEP(stage_num);
+    }
+    return stage_num++;
+}
+
+static void run_stage(BootStage *stage)
+{
+    stage->core = xPortGetCoreID();
+    stage->start = millis() - boot_begin;
+    stage->fn();
+    stage->end = millis() - boot_begin;
+}
+
+static void launch_ready_tasks();
+
+static void finish_stage(BootStage *stage)
+{
+    xSemaphoreTake(sched_lock, portMAX_DELAY);
+    done |= BOOT_DEP(stage - stages);
+    xSemaphoreGive(sched_lock);
+    launch_ready_tasks();
+    xEventGroupSetBits(done_group, BOOT_DEP(stage - stages));
+}
+
+static void boot_task(void *param)
+{
+    BootStage *stage = (BootStage *)param;
+    run_stage(stage);
+    if (BOOT_ON_BACKGROUND == stage->run_on)
+    {
+        Serial.printf("Boot: %s done in %lu ms (background, %lu ms after boot_run)\n",
+                      stage->name, stage->end - stage->start, stage->end);
+    }
+    finish_stage(stage);
+    vTaskDelete(NULL);
+}
+
+static void launch_ready_tasks()
+{
+    xSemaphoreTake(sched_lock, portMAX_DELAY);
+    for (int pos = 0; pos < stage_num; ++pos)
+    {
+        BootStage *stage = &stages[pos];
+        if (BOOT_ON_MAIN == stage->run_on || (started & BOOT_DEP(pos)) || (stage->deps & ~done))
+        {
+            continue;
+        }
+        started |= BOOT_DEP(pos);
+        if (pdPASS != xTaskCreate(boot_task, stage->name, BOOT_TASK_STACK_SIZE,
+                                  stage, BOOT_TASK_PRIORITY, NULL))
+        {
+            // 内存不足时交给主任务串行执行
+            stage->run_on = BOOT_ON_MAIN;
+            started &= ~BOOT_DEP(pos);
+        }
+    }
+    xSemaphoreGive(sched_lock);
+}
+
+// 取一个可在主任务执行的步骤
+static BootStage *take_main_stage()
+{
+    BootStage *main_stage = NULL;
+    xSemaphoreTake(sched_lock, portMAX_DELAY);
+    for (int pos = 0; pos < stage_num; ++pos)
+    {
+        BootStage *stage = &stages[pos];
+        if (BOOT_ON_MAIN == stage->run_on && !(started & BOOT_DEP(pos)) && !(stage->deps & ~done))
+        {
+            started |= BOOT_DEP(pos);
+            main_stage = stage;
+            break;
+        }
+    }
+    xSemaphoreGive(sched_lock);
+    return main_stage;
+}
+
+static void print_report(unsigned long total)
+{
+    // 关键路径：按添加顺序（即拓扑序）累计每个步骤最长的依赖链
+    unsigned long path_len[BOOT_MAX_STAGES];
+    int path_prev[BOOT_MAX_STAGES];
+    unsigned long busy = 0;
+    int last = -1;
+    for (int pos = 0; pos < stage_num; ++pos)
+    {
+        BootStage *stage = &stages[pos];
+        if (BOOT_ON_BACKGROUND == stage->run_on)
+        {
+            path_len[pos] = 0;
+            path_prev[pos] = -1;
+            continue;
+        }
+        unsigned long took = stage->end - stage->start;
+        busy += took;
+        path_len[pos] = took;
+        path_prev[pos] = -1;
+        for (int dep = 0; dep < pos; ++dep)
+        {
+            if ((stage->deps & BOOT_DEP(dep)) && path_len[dep] + took > path_len[pos])
+            {
+                path_len[pos] = path_len[dep] + took;
+                path_prev[pos] = dep;
+            }
+        }
+        if (last < 0 || path_len[pos] > path_len[last])
+        {
+            last = pos;
+        }
+    }
+
+    Serial.println(F("Boot report:"));
+    Serial.println(F("  stage            core  start    end   took"));
+    for (int pos = 0; pos < stage_num; ++pos)
+    {
+        BootStage *stage = &stages[pos];
+        if (BOOT_ON_BACKGROUND == stage->run_on)
+        {
+            Serial.printf("  %-16s %4d %6lu      -      -\n", stage->name, stage->core, stage->start);
+            continue;
+        }
+        Serial.printf("  %-16s %4d %6lu %6lu %6lu\n", stage->name, stage->core,
+                      stage->start, stage->end, stage->end - stage->start);
+    }
+    Serial.printf("  total %lu ms, sum of stages %lu ms, critical path %lu ms:",
+                  total, busy, last >= 0 ? path_len[last] : 0);
+    // 逆序取出关键路径再正序打印
+    int chain[BOOT_MAX_STAGES];
+    int chain_len = 0;
+    for (int pos = last; pos >= 0; pos = path_prev[pos])
+    {
+        chain[chain_len++] = pos;
+    }
+    while (chain_len > 0)
+    {
+        Serial.printf(" %s", stages[chain[--chain_len]].name);
+    }
+    Serial.println();
+}
+
+void boot_run()
+{
+    boot_begin = millis();
+    sched_lock = xSemaphoreCreateMutex();
+    done_group = xEventGroupCreate();
+    uint32_t all = (BOOT_DEP(stage_num) - 1) & ~background_mask;
+
+    while (true)
+    {
+        launch_ready_tasks();
+        BootStage *main_stage = take_main_stage();
+        if (NULL != main_stage)
+        {
+            run_stage(main_stage);
+            finish_stage(main_stage);
+            continue;
+        }
+        xSemaphoreTake(sched_lock, portMAX_DELAY);
+        uint32_t waiting = started & ~done & all;
+        bool finished = (done & all) == all;
+        xSemaphoreGive(sched_lock);
+        if (finished || 0 == waiting)
+        {
+            break;
+        }
+        // 本任务没有可执行的步骤，等待任一并行步骤完成
+        xEventGroupWaitBits(done_group, waiting, pdFALSE, pdFALSE, portMAX_DELAY);
+    }
+    print_report(millis() - boot_begin);
+}
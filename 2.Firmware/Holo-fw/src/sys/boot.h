@@ -0,0 +1,30 @@
+#ifndef BOOT_H
+#define BOOT_H
+
+#include <Arduino.h>
+
+// 启动编排：各初始化步骤声明依赖后由 boot_run() 调度
+//   BOOT_ON_MAIN        在调用 boot_run() 的任务中执行（LVGL/屏幕相关必须在这里）
+//   BOOT_ON_TASK        在独立任务中与其它步骤并行执行
+//   BOOT_ON_BACKGROUND  同上，但 boot_run() 不等待其完成（不能被其它步骤依赖）
+// 依赖只能指向之前添加的步骤，因此不会出现环
+#define BOOT_MAX_STAGES 16
+#define BOOT_DEP(id) (1UL << (id))
+#define BOOT_TASK_STACK_SIZE 8192
+#define BOOT_TASK_PRIORITY 1
+
+enum BOOT_RUN_ON : unsigned char
+{
+    BOOT_ON_MAIN = 0,
+    BOOT_ON_TASK,
+    BOOT_ON_BACKGROUND
+};
+
+typedef void (*BootFunc)(void);
+
+// 返回步骤编号，失败返回-1
+int boot_add(const char *name, BootFunc fn, uint32_t deps, BOOT_RUN_ON run_on);
+// 执行全部步骤并打印各步骤的耗时和关键路径
+void boot_run();
+
+#endif
@@ -0,0 +1,692 @@
+#include "kv_store.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define KV_ALIGN(len) (((len) + 3) & ~3UL)
+#define KV_COMMIT_SIZE KV_ALIGN(KV_RECORD_HEADER_SIZE + 4)
+#define KV_BATCH_MAX (KV_SECTOR_SIZE - KV_SECTOR_HEADER_SIZE - KV_COMMIT_SIZE)
+#define KV_RECORD_SIZE(rec) KV_ALIGN(KV_RECORD_HEADER_SIZE + (rec)[1] + ((rec)[2] | ((rec)[3] << 8)))
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *data, uint32_t len)
+{
+    // 半字节查表，开机扫描时每个字节两次查表
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+    crc = ~crc;
+    while (len--)
+    {
+        crc ^= *data++;
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+static uint32_t read_u16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t read_u32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void write_u32(uint8_t *p, uint32_t value)
+{
+    p[0] = value;
+    p[1] = value >> 8;
+    p[2] = value >> 16;
+    p[3] = value >> 24;
+}
+
+static uint32_t key_hash(const char *key, uint32_t len)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261UL;
+    for (uint32_t i = 0; i < len; ++i)
+    {
+        hash = (hash ^ (uint8_t)key[i]) * 16777619UL;
+    }
+    return hash;
+}
+
+// 编码一条记录，返回对齐后的长度，填充字节保持擦除状态（0xFF）
+static uint32_t encode_record(uint8_t *out, uint8_t type, const char *key, uint8_t key_len,
+                              const void *value, uint16_t len)
+{
+    uint32_t size = KV_ALIGN(KV_RECORD_HEADER_SIZE + key_len + len);
+    out[0] = type;
+    out[1] = key_len;
+    out[2] = len;
+    out[3] = len >> 8;
+    memcpy(out + KV_RECORD_HEADER_SIZE, key, key_len);
+    memcpy(out + KV_RECORD_HEADER_SIZE + key_len, value, len);
+    memset(out + KV_RECORD_HEADER_SIZE + key_len + len, 0xFF, size - KV_RECORD_HEADER_SIZE - key_len - len);
+    uint32_t crc = crc32_update(0, out, 4);
+    crc = crc32_update(crc, out + KV_RECORD_HEADER_SIZE, key_len + len);
+    write_u32(out + 4, crc);
+    return size;
+}
+
+static bool is_value_type(uint8_t type)
+{
+    return type >= KV_TYPE_U32 && type <= KV_TYPE_BLOB;
+}
+
+KvStore::KvStore() : m_sector_num(0), m_tail(0), m_write(0), m_next_seq(1), m_entry_num(0),
+                     m_batch(NULL), m_batch_len(0), m_batch_count(0), m_in_batch(false), m_opened(false)
+{
+    memset(&m_flash, 0, sizeof(m_flash));
+    memset(m_seq, 0, sizeof(m_seq));
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+// offset 处有效记录的长度；不是有效记录（擦除状态、写了一半、越过扇区）时返回0
+uint32_t KvStore::recordSize(uint32_t offset, uint32_t end) const
+{
+    if (offset + KV_RECORD_HEADER_SIZE > end)
+    {
+        return 0;
+    }
+    const uint8_t *rec = m_flash.map + offset;
+    uint8_t type = rec[0];
+    uint8_t base = type & ~KV_TYPE_FLAGS;
+    uint32_t key_len = rec[1];
+    uint32_t len = read_u16(rec + 2);
+    if (KV_TYPE_COMMIT == type)
+    {
+        if (0 != key_len || 4 != len)
+        {
+            return 0;
+        }
+    }
+    else if (KV_TYPE_DELETED == base)
+    {
+        if (0 == key_len || key_len > KV_KEY_MAX || 0 != len)
+        {
+            return 0;
+        }
+    }
+    else if (!is_value_type(base) || 0 == key_len || key_len > KV_KEY_MAX || len > KV_VALUE_MAX)
+    {
+        return 0;
+    }
+    uint32_t size = KV_ALIGN(KV_RECORD_HEADER_SIZE + key_len + len);
+    if (offset + size > end)
+    {
+        return 0;
+    }
+    uint32_t crc = crc32_update(0, rec, 4);
+    crc = crc32_update(crc, rec + KV_RECORD_HEADER_SIZE, key_len + len);
+    return crc == read_u32(rec + 4) ? size : 0;
+}
+
+int KvStore::findEntry(const char *key, uint32_t hash) const
+{
+    uint32_t key_len = strlen(key);
+    for (int i = 0; i < m_entry_num; ++i)
+    {
+        if (m_entries[i].hash != hash)
+        {
+            continue;
+        }
+        const uint8_t *rec = m_flash.map + m_entries[i].offset;
+        if (rec[1] == key_len && !memcmp(rec + KV_RECORD_HEADER_SIZE, key, key_len))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// 让 offset 处的记录（已校验）生效
+bool KvStore::applyRecord(uint32_t offset)
+{
+    const uint8_t *rec = m_flash.map + offset;
+    char key[KV_KEY_MAX + 1];
+    memcpy(key, rec + KV_RECORD_HEADER_SIZE, rec[1]);
+    key[rec[1]] = 0;
+    uint32_t hash = key_hash(key, rec[1]);
+    int pos = findEntry(key, hash);
+    if (KV_TYPE_DELETED == (rec[0] & ~KV_TYPE_FLAGS))
+    {
+        if (pos >= 0)
+        {
+            m_entries[pos] = m_entries[--m_entry_num];
+        }
+        return true;
+    }
+    if (pos < 0)
+    {
+        if (m_entry_num >= KV_MAX_KEYS)
+        {
+            return false;
+        }
+        pos = m_entry_num++;
+        m_entries[pos].hash = hash;
+    }
+    m_entries[pos].offset = offset;
+    return true;
+}
+
+// 按顺序应用一个扇区的记录，返回扇区中空闲空间的起点
+uint32_t KvStore::scanSector(uint16_t sector)
+{
+    uint32_t offset = sector * KV_SECTOR_SIZE + KV_SECTOR_HEADER_SIZE;
+    uint32_t end = (sector + 1) * KV_SECTOR_SIZE;
+    uint32_t batch_start = 0;
+    uint32_t batch_count = 0;
+    while (offset < end)
+    {
+        uint32_t size = recordSize(offset, end);
+        if (0 == size)
+        {
+            // 到扇区末尾都是擦除状态时日志到此为止，否则是掉电时写了一半的记录：
+            // 逐个对齐位置向后找，上次开机后的记录写在它的后面
+            uint32_t pos = offset;
+            while (pos < end && 0xFF == m_flash.map[pos])
+            {
+                ++pos;
+            }
+            if (pos == end)
+            {
+                break;
+            }
+            batch_count = 0;
+            offset += 4;
+            continue;
+        }
+        uint8_t type = m_flash.map[offset];
+        if (type & KV_TYPE_BATCH_START)
+        {
+            batch_start = offset;
+            batch_count = 1;
+        }
+        else if (type & KV_TYPE_BATCH)
+        {
+            batch_count += batch_count > 0 ? 1 : 0;
+        }
+        else if (KV_TYPE_COMMIT == type)
+        {
+            if (batch_count > 0 && read_u32(m_flash.map + offset + KV_RECORD_HEADER_SIZE) == batch_count)
+            {
+                for (uint32_t pos = batch_start; pos < offset; pos += recordSize(pos, end))
+                {
+                    applyRecord(pos);
+                    ++m_stats.records;
+                }
+            }
+            batch_count = 0;
+        }
+        else
+        {
+            // 前面未提交的批量修改作废
+            batch_count = 0;
+            applyRecord(offset);
+            ++m_stats.records;
+        }
+        offset += size;
+    }
+    return offset;
+}
+
+bool KvStore::formatSector(uint16_t sector)
+{
+    uint32_t base = sector * KV_SECTOR_SIZE;
+    ++m_stats.erases;
+    if (!m_flash.erase(m_flash.ctx, base))
+    {
+        return false;
+    }
+    uint8_t header[KV_SECTOR_HEADER_SIZE];
+    write_u32(header, KV_MAGIC);
+    header[4] = KV_FORMAT_VERSION;
+    header[5] = KV_FORMAT_VERSION >> 8;
+    header[6] = 0xFF;
+    header[7] = 0xFF;
+    write_u32(header + 8, m_next_seq);
+    write_u32(header + 12, crc32_update(0, header, 12));
+    ++m_stats.writes;
+    if (!m_flash.write(m_flash.ctx, base, header, sizeof(header)))
+    {
+        m_seq[sector] = 0;
+        return false;
+    }
+    m_seq[sector] = m_next_seq++;
+    return true;
+}
+
+bool KvStore::open(const KvFlash &flash)
+{
+    close();
+    m_flash = flash;
+    m_sector_num = flash.size / KV_SECTOR_SIZE;
+    if (NULL == flash.map || 0 != flash.size % KV_SECTOR_SIZE ||
+        m_sector_num < KV_MIN_SECTORS || m_sector_num > KV_MAX_SECTORS)
+    {
+        return false;
+    }
+    memset(&m_stats, 0, sizeof(m_stats));
+    m_entry_num = 0;
+    m_next_seq = 1;
+
+    // 扇区头有效的扇区按序号排序，其余都是空闲扇区
+    uint16_t order[KV_MAX_SECTORS];
+    uint16_t used = 0;
+    for (uint16_t sector = 0; sector < m_sector_num; ++sector)
+    {
+        const uint8_t *header = m_flash.map + sector * KV_SECTOR_SIZE;
+        m_seq[sector] = 0;
+        if (KV_MAGIC != read_u32(header) || KV_FORMAT_VERSION != read_u16(header + 4) ||
+            crc32_update(0, header, 12) != read_u32(header + 12) || 0 == read_u32(header + 8))
+        {
+            continue;
+        }
+        m_seq[sector] = read_u32(header + 8);
+        uint16_t pos = used++;
+        while (pos > 0 && m_seq[order[pos - 1]] > m_seq[sector])
+        {
+            order[pos] = order[pos - 1];
+            --pos;
+        }
+        order[pos] = sector;
+    }
+
+    for (uint16_t i = 0; i < used; ++i)
+    {
+        m_write = scanSector(order[i]);
+    }
+    if (used > 0)
+    {
+        m_tail = order[used - 1];
+        m_next_seq = m_seq[m_tail] + 1;
+    }
+    else
+    {
+        if (!formatSector(0))
+        {
+            return false;
+        }
+        m_tail = 0;
+        m_write = KV_SECTOR_HEADER_SIZE;
+    }
+    m_opened = true;
+    return true;
+}
+
+void KvStore::close()
+{
+    abort();
+    m_opened = false;
+    m_entry_num = 0;
+}
+
+// 保证当前扇区还有 len 字节，不够时换到空闲扇区，空闲扇区只剩备用的一个时先整理最旧的扇区
+bool KvStore::reserve(uint32_t len, bool allow_collect)
+{
+    if (len > KV_SECTOR_SIZE - KV_SECTOR_HEADER_SIZE)
+    {
+        return false;
+    }
+    for (int round = 0; m_write + len > (m_tail + 1U) * KV_SECTOR_SIZE; ++round)
+    {
+        // 整理了所有扇区仍然放不下：有效数据已占满分区
+        if (round > 2 * m_sector_num)
+        {
+            return false;
+        }
+        uint16_t free_num = 0;
+        for (uint16_t sector = 0; sector < m_sector_num; ++sector)
+        {
+            free_num += 0 == m_seq[sector];
+        }
+        if (allow_collect && free_num <= 1)
+        {
+            if (!collect())
+            {
+                return false;
+            }
+            continue;
+        }
+        if (0 == free_num)
+        {
+            return false;
+        }
+        uint16_t sector = m_tail;
+        do
+        {
+            sector = (sector + 1) % m_sector_num;
+        } while (0 != m_seq[sector]);
+        if (!formatSector(sector))
+        {
+            return false;
+        }
+        m_tail = sector;
+        m_write = sector * KV_SECTOR_SIZE + KV_SECTOR_HEADER_SIZE;
+    }
+    return true;
+}
+
+// 把最旧扇区中仍然有效的记录复制到日志末尾，然后擦除该扇区
+// 复制完成前掉电时旧扇区还在，复制出的记录序号更大，扫描结果不变
+bool KvStore::collect()
+{
+    uint16_t oldest = m_sector_num;
+    for (uint16_t sector = 0; sector < m_sector_num; ++sector)
+    {
+        if (0 != m_seq[sector] && sector != m_tail && (oldest == m_sector_num || m_seq[sector] < m_seq[oldest]))
+        {
+            oldest = sector;
+        }
+    }
+    if (oldest == m_sector_num)
+    {
+        return false;
+    }
+
+    uint32_t offset = oldest * KV_SECTOR_SIZE + KV_SECTOR_HEADER_SIZE;
+    uint32_t end = (oldest + 1) * KV_SECTOR_SIZE;
+    uint8_t record[KV_RECORD_HEADER_SIZE + KV_KEY_MAX + KV_VALUE_MAX + 4];
+    for (uint32_t size; offset < end && 0 != (size = recordSize(offset, end)); offset += size)
+    {
+        const uint8_t *rec = m_flash.map + offset;
+        if (!is_value_type(rec[0] & ~KV_TYPE_FLAGS))
+        {
+            continue;
+        }
+        int pos;
+        for (pos = 0; pos < m_entry_num && m_entries[pos].offset != offset; ++pos)
+        {
+        }
+        if (pos == m_entry_num)
+        {
+            continue;
+        }
+        // 索引中的记录都已提交，复制时去掉批量标记
+        uint32_t len = encode_record(record, rec[0] & ~KV_TYPE_FLAGS, (const char *)rec + KV_RECORD_HEADER_SIZE,
+                                     rec[1], rec + KV_RECORD_HEADER_SIZE + rec[1], read_u16(rec + 2));
+        if (!append(record, len, false, &m_entries[pos].offset))
+        {
+            return false;
+        }
+    }
+
+    ++m_stats.collections;
+    ++m_stats.erases;
+    m_seq[oldest] = 0;
+    return m_flash.erase(m_flash.ctx, oldest * KV_SECTOR_SIZE);
+}
+
+bool KvStore::append(const uint8_t *data, uint32_t len, bool allow_collect, uint32_t *offset)
+{
+    if (!reserve(len, allow_collect))
+    {
+        return false;
+    }
+    ++m_stats.writes;
+    if (!m_flash.write(m_flash.ctx, m_write, data, len))
+    {
+        // 写入失败的位置状态未知，跳过这一段
+        m_write += len;
+        return false;
+    }
+    *offset = m_write;
+    m_write += len;
+    return true;
+}
+
+const uint8_t *KvStore::lookup(const char *key, uint8_t type, uint16_t *len) const
+{
+    if (!m_opened)
+    {
+        return NULL;
+    }
+    int pos = findEntry(key, key_hash(key, strlen(key)));
+    if (pos < 0)
+    {
+        return NULL;
+    }
+    const uint8_t *rec = m_flash.map + m_entries[pos].offset;
+    if ((rec[0] & ~KV_TYPE_FLAGS) != type)
+    {
+        return NULL;
+    }
+    *len = read_u16(rec + 2);
+    return rec + KV_RECORD_HEADER_SIZE + rec[1];
+}
+
+bool KvStore::put(const char *key, uint8_t type, const void *value, uint16_t len)
+{
+    uint32_t key_len = strlen(key);
+    if (!m_opened || 0 == key_len || key_len > KV_KEY_MAX || len > KV_VALUE_MAX)
+    {
+        return false;
+    }
+    int pos = findEntry(key, key_hash(key, key_len));
+    bool exists = pos >= 0;
+    // 索引已满时不能再加新的键（批量修改按记录数保守估计）
+    if (!exists && KV_TYPE_DELETED != type && m_entry_num + m_batch_count >= KV_MAX_KEYS)
+    {
+        return false;
+    }
+    if (!m_in_batch)
+    {
+        // 与当前值相同时不写（批量修改中同一个键可能先后改成不同的值，不做比较）
+        uint16_t old_len = 0;
+        if (KV_TYPE_DELETED == type)
+        {
+            if (!exists)
+            {
+                return true;
+            }
+        }
+        else
+        {
+            const uint8_t *old = lookup(key, type, &old_len);
+            if (NULL != old && old_len == len && !memcmp(old, value, len))
+            {
+                return true;
+            }
+        }
+    }
+
+    uint32_t size = KV_ALIGN(KV_RECORD_HEADER_SIZE + key_len + len);
+    // 有效数据的上限，替换的旧值在批量修改提交前仍然有效
+    uint32_t live = liveBytes() + size;
+    live -= exists && !m_in_batch ? KV_RECORD_SIZE(m_flash.map + m_entries[pos].offset) : 0;
+    if (KV_TYPE_DELETED != type && live > (m_sector_num - 2U) * (KV_SECTOR_SIZE - KV_SECTOR_HEADER_SIZE))
+    {
+        return false;
+    }
+    if (m_in_batch)
+    {
+        if (m_batch_len + size > KV_BATCH_MAX)
+        {
+            return false;
+        }
+        uint8_t flags = 0 == m_batch_count ? KV_TYPE_FLAGS : KV_TYPE_BATCH;
+        encode_record(m_batch + m_batch_len, type | flags, key, key_len, value, len);
+        m_batch_len += size;
+        ++m_batch_count;
+        return true;
+    }
+
+    uint8_t record[KV_RECORD_HEADER_SIZE + KV_KEY_MAX + KV_VALUE_MAX + 4];
+    encode_record(record, type, key, key_len, value, len);
+    uint32_t offset;
+    return append(record, size, true, &offset) && applyRecord(offset);
+}
+
+bool KvStore::setU32(const char *key, uint32_t value)
+{
+    uint8_t raw[4];
+    write_u32(raw, value);
+    return put(key, KV_TYPE_U32, raw, sizeof(raw));
+}
+
+bool KvStore::setI32(const char *key, int32_t value)
+{
+    uint8_t raw[4];
+    write_u32(raw, (uint32_t)value);
+    return put(key, KV_TYPE_I32, raw, sizeof(raw));
+}
+
+bool KvStore::setStr(const char *key, const char *value)
+{
+    uint32_t len = strlen(value) + 1;
+    return len <= KV_VALUE_MAX && put(key, KV_TYPE_STR, value, len);
+}
+
+bool KvStore::setBlob(const char *key, const void *data, uint16_t len)
+{
+    return put(key, KV_TYPE_BLOB, data, len);
+}
+
+bool KvStore::remove(const char *key)
+{
+    return put(key, KV_TYPE_DELETED, NULL, 0);
+}
+
+uint32_t KvStore::getU32(const char *key, uint32_t def) const
+{
+    uint16_t len;
+    const uint8_t *value = lookup(key, KV_TYPE_U32, &len);
+    return NULL != value && 4 == len ? read_u32(value) : def;
+}
+
+int32_t KvStore::getI32(const char *key, int32_t def) const
+{
+    uint16_t len;
+    const uint8_t *value = lookup(key, KV_TYPE_I32, &len);
+    return NULL != value && 4 == len ? (int32_t)read_u32(value) : def;
+}
+
+const char *KvStore::getStr(const char *key, const char *def) const
+{
+    uint16_t len;
+    const uint8_t *value = lookup(key, KV_TYPE_STR, &len);
+    return NULL != value && len > 0 && 0 == value[len - 1] ? (const char *)value : def;
+}
+
+bool KvStore::getBlob(const char *key, void *data, uint16_t len) const
+{
+    uint16_t saved_len;
+    const uint8_t *value = lookup(key, KV_TYPE_BLOB, &saved_len);
+    if (NULL == value || saved_len != len)
+    {
+        return false;
+    }
+    memcpy(data, value, len);
+    return true;
+}
+
+bool KvStore::contains(const char *key) const
+{
+    return m_opened && findEntry(key, key_hash(key, strlen(key))) >= 0;
+}
+
+void KvStore::forEach(KvVisitFunc visit, void *ctx) const
+{
+    char key[KV_KEY_MAX + 1];
+    for (int i = 0; m_opened && i < m_entry_num; ++i)
+    {
+        const uint8_t *rec = m_flash.map + m_entries[i].offset;
+        memcpy(key, rec + KV_RECORD_HEADER_SIZE, rec[1]);
+        key[rec[1]] = 0;
+        if (!visit(ctx, key, rec[0] & ~KV_TYPE_FLAGS, rec + KV_RECORD_HEADER_SIZE + rec[1], read_u16(rec + 2)))
+        {
+            break;
+        }
+    }
+}
+
+bool KvStore::begin()
+{
+    if (!m_opened || m_in_batch)
+    {
+        return false;
+    }
+    m_batch = (uint8_t *)malloc(KV_BATCH_MAX + KV_COMMIT_SIZE);
+    if (NULL == m_batch)
+    {
+        return false;
+    }
+    m_batch_len = 0;
+    m_batch_count = 0;
+    m_in_batch = true;
+    return true;
+}
+
+bool KvStore::commit()
+{
+    if (!m_in_batch)
+    {
+        return false;
+    }
+    bool ok = true;
+    if (m_batch_count > 0)
+    {
+        uint8_t count[4];
+        write_u32(count, m_batch_count);
+        uint32_t len = m_batch_len + encode_record(m_batch + m_batch_len, KV_TYPE_COMMIT, "", 0, count, 4);
+        uint32_t offset;
+        // 整理只移动已提交的记录，批量修改和提交记录一次写入同一个扇区
+        ok = append(m_batch, len, true, &offset);
+        uint32_t end = offset + m_batch_len;
+        for (uint32_t pos = offset, size; ok && pos < end; pos += size)
+        {
+            size = recordSize(pos, end);
+            ok = 0 != size && applyRecord(pos);
+        }
+    }
+    abort();
+    return ok;
+}
+
+void KvStore::abort()
+{
+    free(m_batch);
+    m_batch = NULL;
+    m_batch_len = 0;
+    m_batch_count = 0;
+    m_in_batch = false;
+}
+
+KvStats KvStore::stats() const
+{
+    KvStats stats = m_stats;
+    stats.sectors = m_sector_num;
+    stats.free_sectors = 0;
+    stats.used_bytes = 0;
+    for (uint16_t sector = 0; sector < m_sector_num; ++sector)
+    {
+        if (0 == m_seq[sector])
+        {
+            ++stats.free_sectors;
+        }
+        else if (sector == m_tail)
+        {
+            stats.used_bytes += m_write - sector * KV_SECTOR_SIZE;
+        }
+        else
+        {
+            stats.used_bytes += KV_SECTOR_SIZE;
+        }
+    }
+    stats.keys = m_entry_num;
+    stats.live_bytes = liveBytes();
+    return stats;
+}
+
+uint32_t KvStore::liveBytes() const
+{
+    uint32_t bytes = 0;
+    for (int i = 0; i < m_entry_num; ++i)
+    {
+        bytes += KV_RECORD_SIZE(m_flash.map + m_entries[i].offset);
+    }
+    return bytes + m_batch_len;
+}
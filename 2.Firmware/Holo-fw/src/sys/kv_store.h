@@ -0,0 +1,142 @@
+#ifndef KV_STORE_H
+#define KV_STORE_H
+
+#include <stdint.h>
+
+// 建立在一个原始flash分区上的键值存储：只追加的日志，旧扇区在空间不足时整理（压缩）
+// 只依赖标准头文件，可在PC上编译（见 tools/kv_store_check.cpp）
+// 读取通过分区的内存映射进行：open() 按扇区序号顺序扫描一遍建立索引，之后的读取直接指向映射的flash
+// 分区格式（小端）：
+//   每个扇区开头是 16 字节的扇区头    magic version reserved seq crc
+//   其后是4字节对齐的记录             type key_len val_len(2) crc(4) key[key_len] value[val_len]
+// 记录的 crc 覆盖记录头和内容，写到一半掉电的记录校验不过，扫描时跳过，之后的记录写在它后面
+// begin()/commit() 之间的多个修改先放在内存中，提交时连同提交记录一次写入，
+// 扫描时没有提交记录的批量修改整体丢弃
+// 不是线程安全的，多任务使用时由调用方加锁（见 sys/settings.h）
+#define KV_MAGIC 0x31564b48 // "HKV1"
+#define KV_FORMAT_VERSION 1  // 格式变化时递增，版本不同的扇区视为空扇区
+#define KV_SECTOR_SIZE 4096
+#define KV_MIN_SECTORS 3 // 整理需要一个空闲扇区作为备用，有效数据最多占用 (扇区数 - 2) 个扇区，留出写删除记录的空间
+#define KV_MAX_SECTORS 32
+#define KV_MAX_KEYS 96
+#define KV_KEY_MAX 31
+#define KV_VALUE_MAX 256
+#define KV_SECTOR_HEADER_SIZE 16
+#define KV_RECORD_HEADER_SIZE 8
+
+enum KV_TYPE : uint8_t
+{
+    KV_TYPE_U32 = 1,
+    KV_TYPE_I32,
+    KV_TYPE_STR, // 保存时带结尾的 '\0'，可直接使用映射中的字符串
+    KV_TYPE_BLOB,
+    KV_TYPE_DELETED = 0x20, // 删除记录（没有值）
+    KV_TYPE_COMMIT = 0x21,  // 批量修改的提交记录，值为本批的记录数
+    KV_TYPE_ERASED = 0xFF
+};
+#define KV_TYPE_BATCH 0x40       // 记录属于一次批量修改
+#define KV_TYPE_BATCH_START 0x80 // 批量修改的第一条记录
+#define KV_TYPE_FLAGS (KV_TYPE_BATCH | KV_TYPE_BATCH_START)
+
+// 分区的访问方式：整个分区的只读映射 + 写入/擦除函数
+// 写入只能把位从1变为0（NOR flash），擦除以 KV_SECTOR_SIZE 为单位，成功返回true
+typedef bool (*KvWriteFunc)(void *ctx, uint32_t offset, const void *data, uint32_t len);
+typedef bool (*KvEraseFunc)(void *ctx, uint32_t offset);
+
+struct KvFlash
+{
+    const uint8_t *map; // 写入/擦除后的内容必须立即反映在映射中
+    uint32_t size;      // KV_SECTOR_SIZE 的整数倍
+    KvWriteFunc write;
+    KvEraseFunc erase;
+    void *ctx;
+};
+
+struct KvStats
+{
+    uint16_t sectors;
+    uint16_t free_sectors;
+    uint16_t keys;
+    uint32_t records;    // open() 扫描到的有效记录数
+    uint32_t used_bytes; // 日志占用的字节数（不含空闲扇区）
+    uint32_t live_bytes; // 其中当前有效的记录
+    uint32_t collections;
+    uint32_t writes;
+    uint32_t erases;
+};
+
+// 遍历时的回调，返回false停止遍历
+typedef bool (*KvVisitFunc)(void *ctx, const char *key, uint8_t type, const void *value, uint16_t len);
+
+class KvStore
+{
+private:
+    struct Entry
+    {
+        uint32_t hash;
+        uint32_t offset; // 记录在分区中的位置
+    };
+
+    KvFlash m_flash;
+    uint16_t m_sector_num;
+    uint32_t m_seq[KV_MAX_SECTORS]; // 各扇区的序号，0表示空闲
+    uint16_t m_tail;                // 正在追加的扇区
+    uint32_t m_write;               // 下一条记录的位置（分区内偏移）
+    uint32_t m_next_seq;
+    Entry m_entries[KV_MAX_KEYS];
+    uint16_t m_entry_num;
+    uint8_t *m_batch; // 批量修改的记录
+    uint32_t m_batch_len;
+    uint32_t m_batch_count;
+    bool m_in_batch;
+    bool m_opened;
+    KvStats m_stats;
+
+    int findEntry(const char *key, uint32_t hash) const;
+    bool applyRecord(uint32_t offset);
+    uint32_t recordSize(uint32_t offset, uint32_t end) const;
+    uint32_t scanSector(uint16_t sector);
+    bool formatSector(uint16_t sector);
+    bool reserve(uint32_t len, bool allow_collect);
+    bool collect();
+    bool append(const uint8_t *data, uint32_t len, bool allow_collect, uint32_t *offset);
+    bool put(const char *key, uint8_t type, const void *value, uint16_t len);
+    const uint8_t *lookup(const char *key, uint8_t type, uint16_t *len) const;
+    uint32_t liveBytes() const;
+
+public:
+    KvStore();
+    ~KvStore() { close(); }
+    // 扫描分区建立索引，分区中没有有效数据时格式化为空
+    bool open(const KvFlash &flash);
+    void close();
+    bool isOpen() const { return m_opened; }
+
+    // 值没有变化时不写flash（批量修改中除外）
+    bool setU32(const char *key, uint32_t value);
+    bool setI32(const char *key, int32_t value);
+    bool setStr(const char *key, const char *value);
+    bool setBlob(const char *key, const void *data, uint16_t len);
+    bool remove(const char *key);
+
+    // 不存在或类型不符时返回默认值
+    uint32_t getU32(const char *key, uint32_t def) const;
+    int32_t getI32(const char *key, int32_t def) const;
+    // 返回指向映射的指针，在下一次修改前有效
+    const char *getStr(const char *key, const char *def) const;
+    // 长度必须与保存时一致
+    bool getBlob(const char *key, void *data, uint16_t len) const;
+    bool contains(const char *key) const;
+    // 遍历当前有效的键（不含未提交的修改）
+    void forEach(KvVisitFunc visit, void *ctx) const;
+
+    // 批量修改：commit() 之前的修改都不可见，提交后一起生效（掉电时要么全部生效，要么全部丢弃）
+    // 一次批量修改的总长度不能超过一个扇区
+    bool begin();
+    bool commit();
+    void abort();
+
+    KvStats stats() const;
+};
+
+#endif
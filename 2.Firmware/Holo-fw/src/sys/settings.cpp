@@ -0,0 +1,307 @@
+#include "settings.h"
+
+#include <SD.h>
+#include <esp_partition.h>
+#include <rom/crc.h>
+
+static KvStore store;
+static SemaphoreHandle_t store_lock = NULL; // 递归锁：批量修改期间同一任务可以继续读写
+static const esp_partition_t *partition = NULL;
+static spi_flash_mmap_handle_t map_handle;
+
+// esp_partition_write/erase 之后IDF会刷新映射区域的cache，映射中的内容立即更新
+static bool partition_write(void *ctx, uint32_t offset, const void *data, uint32_t len)
+{
+    return ESP_OK == esp_partition_write(partition, offset, data, len);
+}
+
+static bool partition_erase(void *ctx, uint32_t offset)
+{
+    return ESP_OK == esp_partition_erase_range(partition, offset, KV_SECTOR_SIZE);
+}
+
+static bool lock()
+{
+    return NULL != store_lock && pdTRUE == xSemaphoreTakeRecursive(store_lock, portMAX_DELAY);
+}
+
+static void unlock()
+{
+    xSemaphoreGiveRecursive(store_lock);
+}
+
+bool settings_init()
+{
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                         (esp_partition_subtype_t)SETTINGS_PARTITION_SUBTYPE, SETTINGS_PARTITION);
+    if (NULL == partition)
+    {
+        Serial.println(F("Settings: partition " SETTINGS_PARTITION " not found"));
+        return false;
+    }
+    const void *map = NULL;
+    if (ESP_OK != esp_partition_mmap(partition, 0, partition->size, SPI_FLASH_MMAP_DATA, &map, &map_handle))
+    {
+        Serial.println(F("Settings: mmap failed"));
+        return false;
+    }
+    KvFlash flash = {(const uint8_t *)map, partition->size, partition_write, partition_erase, NULL};
+    unsigned long start = micros();
+    if (!store.open(flash))
+    {
+        Serial.println(F("Settings: open failed"));
+        return false;
+    }
+    store_lock = xSemaphoreCreateRecursiveMutex();
+    KvStats stats = store.stats();
+    Serial.printf("Settings: %u keys from %u records in %lu us\n", stats.keys, stats.records, micros() - start);
+    return true;
+}
+
+struct TxtLine
+{
+    const char *key;
+    const char *value;
+};
+
+struct TxtImport
+{
+    TxtLine lines[SETTINGS_TXT_MAX_LINES];
+    int num;
+};
+
+static bool remove_stale(void *ctx, const char *key, uint8_t type, const void *value, uint16_t len)
+{
+    const TxtImport *import = (const TxtImport *)ctx;
+    if (strncmp(key, SETTINGS_TXT_PREFIX, strlen(SETTINGS_TXT_PREFIX)))
+    {
+        return true;
+    }
+    for (int i = 0; i < import->num; ++i)
+    {
+        if (!strcmp(key + strlen(SETTINGS_TXT_PREFIX), import->lines[i].key))
+        {
+            return true;
+        }
+    }
+    // 批量修改提交前索引不变，遍历中删除是安全的
+    store.remove(key);
+    return true;
+}
+
+// config.txt 每行一项 key:value，与上次导入时的 CRC 相同则不解析
+bool settings_import_txt(const char *path)
+{
+    File file = SD.open(path, FILE_READ);
+    if (!file)
+    {
+        return false;
+    }
+    size_t size = file.size();
+    char *text = size <= SETTINGS_TXT_MAX_SIZE ? (char *)malloc(size + 1) : NULL;
+    if (NULL == text)
+    {
+        file.close();
+        Serial.printf("Settings: %s is too large\n", path);
+        return false;
+    }
+    size = file.read((uint8_t *)text, size);
+    file.close();
+    text[size] = 0;
+    uint32_t crc = crc32_le(0, (const uint8_t *)text, size);
+    if (crc == settings_get_u32(SETTINGS_TXT_CRC_KEY, 0))
+    {
+        free(text);
+        return true;
+    }
+
+    // 原地切分为 key/value，同一个键以最后一行为准
+    TxtImport *import = (TxtImport *)malloc(sizeof(TxtImport));
+    if (NULL == import)
+    {
+        free(text);
+        return false;
+    }
+    import->num = 0;
+    char *line = text;
+    while (NULL != line && 0 != *line)
+    {
+        char *next = strchr(line, '\n');
+        if (NULL != next)
+        {
+            *next++ = 0;
+        }
+        line[strcspn(line, "\r")] = 0;
+        char *sep = strchr(line, ':');
+        if (NULL != sep && sep != line && sep - line + strlen(SETTINGS_TXT_PREFIX) <= KV_KEY_MAX &&
+            strlen(sep + 1) < KV_VALUE_MAX)
+        {
+            *sep = 0;
+            int pos = 0;
+            while (pos < import->num && strcmp(import->lines[pos].key, line))
+            {
+                ++pos;
+            }
+            if (pos < SETTINGS_TXT_MAX_LINES)
+            {
+                import->lines[pos].key = line;
+                import->lines[pos].value = sep + 1;
+                import->num += pos == import->num ? 1 : 0;
+            }
+        }
+        line = next;
+    }
+
+    bool ok = lock();
+    if (ok)
+    {
+        ok = store.begin();
+        if (ok)
+        {
+            store.forEach(remove_stale, import);
+        }
+        char key[KV_KEY_MAX + 1];
+        for (int i = 0; ok && i < import->num; ++i)
+        {
+            snprintf(key, sizeof(key), SETTINGS_TXT_PREFIX "%s", import->lines[i].key);
+            const char *old = store.getStr(key, NULL);
+            if (NULL == old || strcmp(old, import->lines[i].value))
+            {
+                ok = store.setStr(key, import->lines[i].value);
+            }
+        }
+        ok = ok && store.setU32(SETTINGS_TXT_CRC_KEY, crc) && store.commit();
+        store.abort();
+        unlock();
+    }
+    Serial.printf("Settings: imported %d keys from %s%s\n", import->num, path, ok ? "" : " failed");
+    free(import);
+    free(text);
+    return ok;
+}
+
+uint32_t settings_get_u32(const char *key, uint32_t def)
+{
+    if (!lock())
+    {
+        return def;
+    }
+    uint32_t value = store.getU32(key, def);
+    unlock();
+    return value;
+}
+
+int32_t settings_get_i32(const char *key, int32_t def)
+{
+    if (!lock())
+    {
+        return def;
+    }
+    int32_t value = store.getI32(key, def);
+    unlock();
+    return value;
+}
+
+String settings_get_str(const char *key, const char *def)
+{
+    if (!lock())
+    {
+        return def;
+    }
+    // 复制出来，映射中的内容在下一次修改（整理）后可能失效
+    String value = store.getStr(key, def);
+    unlock();
+    return value;
+}
+
+bool settings_get_blob(const char *key, void *data, uint16_t len)
+{
+    if (!lock())
+    {
+        return false;
+    }
+    bool ok = store.getBlob(key, data, len);
+    unlock();
+    return ok;
+}
+
+bool settings_set_u32(const char *key, uint32_t value)
+{
+    if (!lock())
+    {
+        return false;
+    }
+    bool ok = store.setU32(key, value);
+    unlock();
+    return ok;
+}
+
+bool settings_set_i32(const char *key, int32_t value)
+{
+    if (!lock())
+    {
+        return false;
+    }
+    bool ok = store.setI32(key, value);
+    unlock();
+    return ok;
+}
+
+bool settings_set_str(const char *key, const char *value)
+{
+    if (!lock())
+    {
+        return false;
+    }
+    bool ok = store.setStr(key, value);
+    unlock();
+    return ok;
+}
+
+bool settings_set_blob(const char *key, const void *data, uint16_t len)
+{
+    if (!lock())
+    {
+        return false;
+    }
+    bool ok = store.setBlob(key, data, len);
+    unlock();
+    return ok;
+}
+
+bool settings_remove(const char *key)
+{
+    if (!lock())
+    {
+        return false;
+    }
+    bool ok = store.remove(key);
+    unlock();
+    return ok;
+}
+
+bool settings_begin()
+{
+    if (!lock())
+    {
+        return false;
+    }
+    if (!store.begin())
+    {
+        unlock();
+        return false;
+    }
+    // 锁一直持有到 settings_commit()
+    return true;
+}
+
+bool settings_commit()
+{
+    if (NULL == store_lock)
+    {
+        return false;
+    }
+    bool ok = store.commit();
+    unlock();
+    return ok;
+}
@@ -0,0 +1,38 @@
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+#include <Arduino.h>
+#include "kv_store.h"
+
+// 全部持久化设置：存放在 "kvstore" 分区中的键值存储（见 sys/kv_store.h、partitions-no-ota.csv），
+// 取代原先的 Preferences(NVS) 和 SPIFFS 中的 *.cfg 文件
+// 键名以模块为前缀，如 "imu.x_gyro"、"wifi.cache"、"pic.interval"
+// SD卡上的 config.txt 仍由用户编辑，内容变化时整体导入为 "txt.<key>" 字符串（一次批量修改），
+// 之后各模块从这里读取，不再逐行解析文件；SD卡上没有 config.txt 时沿用上次导入的内容
+// 所有函数可在任意任务中调用
+#define SETTINGS_PARTITION "kvstore"
+#define SETTINGS_PARTITION_SUBTYPE 0x40
+#define SETTINGS_TXT_PREFIX "txt."
+#define SETTINGS_TXT_CRC_KEY "sys.txt_crc"
+#define SETTINGS_TXT_MAX_SIZE 2048
+#define SETTINGS_TXT_MAX_LINES 48
+
+// 映射分区并扫描一遍建立索引
+bool settings_init();
+bool settings_import_txt(const char *path);
+
+uint32_t settings_get_u32(const char *key, uint32_t def);
+int32_t settings_get_i32(const char *key, int32_t def);
+String settings_get_str(const char *key, const char *def = "");
+bool settings_get_blob(const char *key, void *data, uint16_t len);
+bool settings_set_u32(const char *key, uint32_t value);
+bool settings_set_i32(const char *key, int32_t value);
+bool settings_set_str(const char *key, const char *value);
+bool settings_set_blob(const char *key, const void *data, uint16_t len);
+bool settings_remove(const char *key);
+
+// 批量修改：settings_commit() 时一起生效，期间其它任务的修改等待提交
+bool settings_begin();
+bool settings_commit();
+
+#endif
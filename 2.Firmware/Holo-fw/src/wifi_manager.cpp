@@ -0,0 +1,231 @@
+#include "wifi_manager.h"
+#include "common.h"
+#include "sys/settings.h"
+
+#include <WiFi.h>
+
+#define WIFI_ATTEMPT_FAST -1 // 正在使用缓存信息快速连接
+
+enum WIFI_STATE : unsigned char
+{
+    WIFI_STATE_IDLE = 0,
+    WIFI_STATE_CONNECTING,
+    WIFI_STATE_CONNECTED,
+    WIFI_STATE_WAIT_RETRY
+};
+
+struct WifiCredential
+{
+    String ssid;
+    String password;
+};
+
+// 上次成功连接的AP，保存在设置中（旧版本保存的IP租约长度不同，读取时被忽略）
+struct WifiCache
+{
+    char ssid[33];
+    uint8_t bssid[6];
+    uint8_t channel;
+};
+
+static WifiCredential credentials[WIFI_MAX_CREDENTIALS];
+static uint8_t credential_num = 0;
+static WifiCache cache;
+static bool cache_valid = false;
+
+static WIFI_STATE state = WIFI_STATE_IDLE;
+static int attempt = WIFI_ATTEMPT_FAST; // 当前尝试的账号下标
+static unsigned long attempt_millis = 0;
+static unsigned long connect_begin_millis = 0; // 本轮连接开始的时间，用于统计耗时
+
+// WiFi事件在系统的事件任务中回调，只记录标志，由 wifi_manager_process() 处理
+static volatile bool event_got_ip = false;
+static volatile bool event_disconnected = false;
+
+static void wifi_event(system_event_id_t event)
+{
+    if (SYSTEM_EVENT_STA_GOT_IP == event)
+    {
+        event_got_ip = true;
+    }
+    else if (SYSTEM_EVENT_STA_DISCONNECTED == event)
+    {
+        event_disconnected = true;
+    }
+}
+
+static void read_cache()
+{
+    cache_valid = settings_get_blob(WIFI_CACHE_KEY, &cache, sizeof(cache));
+    cache.ssid[sizeof(cache.ssid) - 1] = 0;
+}
+
+static void write_cache(const WifiCache &new_cache)
+{
+    // 内容没变时不写flash
+    if (cache_valid && !memcmp(&cache, &new_cache, sizeof(cache)))
+    {
+        return;
+    }
+    cache = new_cache;
+    cache_valid = true;
+    settings_set_blob(WIFI_CACHE_KEY, &cache, sizeof(cache));
+}
+
+static void clear_cache()
+{
+    cache_valid = false;
+    settings_remove(WIFI_CACHE_KEY);
+}
+
+static int find_credential(const char *ssid)
+{
+    for (int pos = 0; pos < credential_num; ++pos)
+    {
+        if (credentials[pos].ssid == ssid)
+        {
+            return pos;
+        }
+    }
+    return -1;
+}
+
+static void start_attempt(int index)
+{
+    attempt = index;
+    attempt_millis = millis();
+    state = WIFI_STATE_CONNECTING;
+    WiFi.disconnect();
+    event_got_ip = false;
+    event_disconnected = false;
+    // 始终使用DHCP
+    WiFi.config(IPAddress((uint32_t)0), IPAddress((uint32_t)0), IPAddress((uint32_t)0));
+
+    if (WIFI_ATTEMPT_FAST == index)
+    {
+        const WifiCredential &cred = credentials[find_credential(cache.ssid)];
+        Serial.printf("WiFi: fast connect %s ch%u\n", cache.ssid, cache.channel);
+        WiFi.begin(cred.ssid.c_str(), cred.password.c_str(), cache.channel, cache.bssid);
+    }
+    else
+    {
+        Serial.printf("WiFi: connect %s\n", credentials[index].ssid.c_str());
+        WiFi.begin(credentials[index].ssid.c_str(), credentials[index].password.c_str());
+    }
+    rgb.setBrightness(0.1).setRGB(0, 64, 64);
+}
+
+static void start_round()
+{
+    connect_begin_millis = millis();
+    if (cache_valid && find_credential(cache.ssid) >= 0)
+    {
+        start_attempt(WIFI_ATTEMPT_FAST);
+    }
+    else if (credential_num > 0)
+    {
+        start_attempt(0);
+    }
+}
+
+static void on_connected()
+{
+    state = WIFI_STATE_CONNECTED;
+    event_disconnected = false; // 忽略连接过程中的断开事件
+    unsigned long now = millis();
+    Serial.printf("WiFi: connected %s ip %s in %lu ms (%lu ms after boot)\n",
+                  WiFi.SSID().c_str(), WiFi.localIP().toString().c_str(),
+                  now - connect_begin_millis, now);
+    rgb.setBrightness(0.1).setRGB(0, 150, 0);
+
+    WifiCache new_cache;
+    memset(&new_cache, 0, sizeof(new_cache));
+    snprintf(new_cache.ssid, sizeof(new_cache.ssid), "%s", WiFi.SSID().c_str());
+    memcpy(new_cache.bssid, WiFi.BSSID(), sizeof(new_cache.bssid));
+    new_cache.channel = WiFi.channel();
+    write_cache(new_cache);
+}
+
+bool wifi_manager_add(const String &ssid, const String &password)
+{
+    if (credential_num >= WIFI_MAX_CREDENTIALS || 0 == ssid.length())
+    {
+        return false;
+    }
+    credentials[credential_num].ssid = ssid;
+    credentials[credential_num].password = password;
+    ++credential_num;
+    return true;
+}
+
+void wifi_manager_begin()
+{
+    read_cache();
+    WiFi.onEvent(wifi_event);
+    WiFi.mode(WIFI_STA);
+    WiFi.persistent(false);
+    WiFi.setAutoConnect(false);
+    WiFi.setAutoReconnect(false); // 断线重连由本模块负责
+    start_round();
+}
+
+void wifi_manager_process()
+{
+    if (event_got_ip)
+    {
+        event_got_ip = false;
+        on_connected();
+    }
+
+    unsigned long now = millis();
+    switch (state)
+    {
+    case WIFI_STATE_CONNECTING:
+    {
+        unsigned long timeout = WIFI_ATTEMPT_FAST == attempt ? WIFI_FAST_CONNECT_TIMEOUT : WIFI_CONNECT_TIMEOUT;
+        if (now - attempt_millis < timeout)
+        {
+            break;
+        }
+        if (WIFI_ATTEMPT_FAST == attempt)
+        {
+            // 缓存的AP已失效，回到完整的扫描流程
+            Serial.println(F("WiFi: fast connect failed"));
+            clear_cache();
+        }
+        if (attempt + 1 < credential_num)
+        {
+            start_attempt(attempt + 1);
+        }
+        else
+        {
+            Serial.println(F("WiFi: connect failed!"));
+            WiFi.disconnect();
+            rgb.setBrightness(0.1).setRGB(128, 0, 0);
+            state = WIFI_STATE_WAIT_RETRY;
+            attempt_millis = now;
+        }
+    }
+    break;
+    case WIFI_STATE_CONNECTED:
+        if (event_disconnected)
+        {
+            Serial.println(F("WiFi: disconnected"));
+            start_round();
+        }
+        break;
+    case WIFI_STATE_WAIT_RETRY:
+        if (now - attempt_millis >= WIFI_RETRY_INTERVAL)
+        {
+            start_round();
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+bool wifi_manager_connected()
+{
+    return WIFI_STATE_CONNECTED == state;
+}
@@ -0,0 +1,23 @@
+#ifndef WIFI_MANAGER_H
+#define WIFI_MANAGER_H
+
+#include <Arduino.h>
+
+// 非阻塞的WiFi连接：
+//   1. 先用上次成功连接的 BSSID/信道快速连接（跳过扫描）
+//      IP地址仍由DHCP获取：缓存的租约可能已过期并分配给了其它设备，不作为静态IP复用
+//   2. 失败后按优先级依次尝试 config.txt 中的各组账号
+//   3. 全部失败则等待一段时间后重新开始
+// 连接过程由WiFi事件和 wifi_manager_process() 推进，不阻塞启动和显示
+#define WIFI_MAX_CREDENTIALS 4
+#define WIFI_FAST_CONNECT_TIMEOUT 5000 // 快速连接（含DHCP）的超时时间（ms）
+#define WIFI_CONNECT_TIMEOUT 10000     // 每组账号的超时时间（ms）
+#define WIFI_RETRY_INTERVAL 30000      // 全部失败后的重试间隔（ms）
+#define WIFI_CACHE_KEY "wifi.cache"    // 快速连接信息在设置中的键名
+
+bool wifi_manager_add(const String &ssid, const String &password); // 按优先级顺序添加
+void wifi_manager_begin();
+void wifi_manager_process(); // 在 loop() 中调用
+bool wifi_manager_connected();
+
+#endif
@@ -0,0 +1,274 @@
+// Host-side loader, checks and benchmark for the asset partition (sys/asset_pack.*).
+//
+// Maps an image written by asset_pack.py read-only, the way the firmware maps
+// the "assets" partition, and uses it in place: every entry is looked up by
+// name and its CRC verified, images are parsed like driver/assets.cpp does for
+// lv_img_set_src(), and every glyph of every font is read through
+// GlyphFont::openMapped() and compared with the streamed reader
+// (GlyphFont::open() with an LRU cache) on the same bytes. Damaged copies of
+// the image (header, index, data, truncated partition) must be rejected.
+// Ends with the time open() and lookups take and the RAM a font needs in
+// each mode. Exits non-zero when a check fails.
+//
+//     python3 asset_pack.py assets.bin font/ch_font_20=../src/resource/font/ch_font_20.c img/
+//     g++ -O2 -I../src/sys -I../src/driver -I../sim/include -o asset_check asset_check.cpp ../src/sys/asset_pack.cpp ../src/driver/glyph_font.cpp
+//     ./asset_check assets.bin
+
+#include "asset_pack.h"
+#include "glyph_font.h"
+#include "sim_check.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#define PARTITION_SIZE 0x80000 // "assets" in partitions-no-ota.csv
+
+struct Memory
+{
+    const uint8_t *data;
+    uint32_t size;
+};
+
+static bool memory_read(void *ctx, uint32_t offset, void *buf, uint32_t len)
+{
+    const Memory *mem = (const Memory *)ctx;
+    if (offset > mem->size || len > mem->size - offset)
+    {
+        return false;
+    }
+    memcpy(buf, mem->data + offset, len);
+    return true;
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Every glyph must look the same through the mapping and through the stream
+static bool check_font(const Asset &asset, uint32_t *glyphs, uint32_t *stream_ram)
+{
+    GlyphFont mapped;
+    GlyphFont streamed;
+    Memory mem = {asset.data, asset.size};
+    if (!mapped.openMapped(asset.data, asset.size) || !streamed.open(memory_read, &mem))
+    {
+        return false;
+    }
+    const GlyphFontHeader &header = mapped.header();
+    const uint16_t *codes = (const uint16_t *)(asset.data + GLYPH_FONT_HEADER_SIZE);
+    for (uint32_t i = 0; i < header.count; ++i)
+    {
+        GlyphDsc expect;
+        const GlyphDsc *dsc = streamed.glyph(codes[i]);
+        if (NULL == dsc)
+        {
+            return false;
+        }
+        expect = *dsc;
+        std::vector<uint8_t> bitmap(streamed.bitmap(codes[i]), streamed.bitmap(codes[i]) + expect.bitmap_size);
+        dsc = mapped.glyph(codes[i]);
+        const uint8_t *in_place = mapped.bitmap(codes[i]);
+        if (NULL == dsc || NULL == in_place || dsc->bitmap_offset != expect.bitmap_offset ||
+            dsc->bitmap_size != expect.bitmap_size || dsc->adv_w != expect.adv_w || dsc->box_w != expect.box_w ||
+            dsc->box_h != expect.box_h || dsc->ofs_x != expect.ofs_x || dsc->ofs_y != expect.ofs_y ||
+            0 != memcmp(in_place, bitmap.data(), bitmap.size()) ||
+            in_place < asset.data || in_place + bitmap.size() > asset.data + asset.size)
+        {
+            printf("      glyph U+%04X differs\n", codes[i]);
+            return false;
+        }
+    }
+    *glyphs = header.count;
+    *stream_ram = streamed.ramUsage();
+    return NULL == mapped.glyph(0xFFFF) && mapped.ramUsage() == sizeof(GlyphFont);
+}
+
+// A copy of the image in a buffer of partition size, erased beyond the image
+static std::vector<uint8_t> partition_copy(const uint8_t *map, uint32_t size)
+{
+    std::vector<uint8_t> copy(size > PARTITION_SIZE ? size : PARTITION_SIZE, 0xFF);
+    memcpy(copy.data(), map, size);
+    return copy;
+}
+
+static void check_damage(const uint8_t *map, uint32_t size, const AssetPack &pack)
+{
+    AssetPack other;
+    std::vector<uint8_t> copy = partition_copy(map, size);
+    check(other.open(copy.data(), copy.size()), "opens inside a larger erased partition");
+    check(!other.open(copy.data(), size - 1), "a partition smaller than the image is rejected");
+
+    copy[0] ^= 0x01;
+    check(!other.open(copy.data(), copy.size()), "a damaged magic is rejected");
+    copy[0] ^= 0x01;
+
+    copy[4] = ASSET_FORMAT_VERSION + 1;
+    check(!other.open(copy.data(), copy.size()), "another format version is rejected");
+    copy[4] = ASSET_FORMAT_VERSION;
+
+    bool index_ok = true;
+    for (uint32_t pos = 6; pos < ASSET_HEADER_SIZE + pack.count() * (uint32_t)ASSET_ENTRY_SIZE; pos += 7)
+    {
+        copy[pos] ^= 0x10;
+        index_ok = index_ok && !other.open(copy.data(), copy.size());
+        copy[pos] ^= 0x10;
+    }
+    check(index_ok, "a flipped bit anywhere in the header or index is rejected");
+
+    bool data_ok = true;
+    for (uint16_t i = 0; i < pack.count(); ++i)
+    {
+        Asset asset;
+        pack.at(i, &asset);
+        if (0 == asset.size)
+        {
+            continue;
+        }
+        uint8_t *byte = copy.data() + (asset.data - map) + asset.size / 2;
+        *byte ^= 0x80;
+        Asset damaged;
+        data_ok = data_ok && other.open(copy.data(), copy.size()) && other.at(i, &damaged) && !other.verify(damaged);
+        *byte ^= 0x80;
+    }
+    check(data_ok, "a flipped bit in any entry's data fails verify() but not open()");
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s assets.bin\n", argv[0]);
+        return 2;
+    }
+    int fd = open(argv[1], O_RDONLY);
+    struct stat st;
+    if (fd < 0 || 0 != fstat(fd, &st) || st.st_size < ASSET_HEADER_SIZE)
+    {
+        fprintf(stderr, "%s: cannot open\n", argv[1]);
+        return 2;
+    }
+    uint32_t size = st.st_size;
+    void *addr = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (MAP_FAILED == addr)
+    {
+        fprintf(stderr, "%s: mmap failed\n", argv[1]);
+        return 2;
+    }
+    const uint8_t *map = (const uint8_t *)addr;
+
+    AssetPack pack;
+    check(pack.open(map, size) && pack.imageSize() == size, "the image opens and its size matches the file");
+    if (!pack.isOpen())
+    {
+        return 1;
+    }
+    check(size <= PARTITION_SIZE, "the image fits the partition");
+
+    bool found = true, verified = true, aligned = true, images = true, fonts = true;
+    uint32_t font_num = 0, img_num = 0, jpeg_num = 0, glyph_num = 0, stream_ram = 0;
+    for (uint16_t i = 0; i < pack.count(); ++i)
+    {
+        Asset asset, by_name;
+        pack.at(i, &asset);
+        found = found && pack.indexOf(asset.name) == i && pack.find(asset.name, &by_name, asset.type) &&
+                by_name.data == asset.data;
+        verified = verified && pack.verify(asset);
+        aligned = aligned && 0 == (asset.data - map) % ASSET_ALIGN;
+        const char *type = "raw";
+        if (ASSET_TYPE_IMG == asset.type)
+        {
+            AssetImgInfo info;
+            bool ok = asset_img_info(asset, &info);
+            images = images && ok;
+            ++img_num;
+            type = "img";
+            if (ok)
+            {
+                printf("      %-24s img   cf %u %ux%u\n", asset.name, info.cf, info.w, info.h);
+            }
+        }
+        else if (ASSET_TYPE_FONT == asset.type)
+        {
+            uint32_t glyphs = 0, ram = 0;
+            bool ok = check_font(asset, &glyphs, &ram);
+            fonts = fonts && ok;
+            ++font_num;
+            glyph_num += glyphs;
+            stream_ram += ram;
+            type = "font";
+            printf("      %-24s font  %u glyphs, %u bytes in place (streamed: %u bytes of RAM)\n",
+                   asset.name, glyphs, asset.size, ram);
+        }
+        else if (ASSET_TYPE_JPEG == asset.type)
+        {
+            // TJpgDec needs the SOI marker at the start of the buffer
+            images = images && asset.size > 2 && 0xFF == asset.data[0] && 0xD8 == asset.data[1];
+            ++jpeg_num;
+            type = "jpeg";
+        }
+        if (ASSET_TYPE_FONT != asset.type && ASSET_TYPE_IMG != asset.type)
+        {
+            printf("      %-24s %-5s %u bytes\n", asset.name, type, asset.size);
+        }
+    }
+    Asset missing;
+    check(found && !pack.find("no/such/asset", &missing) && !pack.find("", &missing),
+          "every entry is found by name, unknown names are not");
+    check(verified, "every entry's data matches its CRC");
+    check(aligned, "every entry is aligned to ASSET_ALIGN");
+    check(images, "every image header matches its data");
+    check(fonts, "every glyph read in place equals the streamed glyph");
+    check_damage(map, size, pack);
+
+    // Boot cost: open() checks the header and index, nothing else is touched
+    const int rounds = 2000;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i)
+    {
+        pack.open(map, size);
+    }
+    double open_us = seconds_since(start) / rounds * 1e6;
+    std::vector<std::string> names;
+    for (uint16_t i = 0; i < pack.count(); ++i)
+    {
+        Asset asset;
+        pack.at(i, &asset);
+        names.push_back(asset.name);
+    }
+    const int lookups = 1000000;
+    int hits = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < lookups; ++i)
+    {
+        hits += pack.indexOf(names[i % names.size()].c_str()) >= 0;
+    }
+    double find_ns = seconds_since(start) / lookups * 1e9;
+    printf("      %u entries (%u fonts with %u glyphs, %u images, %u jpeg), %u bytes\n",
+           pack.count(), font_num, glyph_num, img_num, jpeg_num, size);
+    printf("      open(): %.2f us, lookup by name: %.0f ns (%d hits)\n", open_us, find_ns, hits);
+    if (font_num > 0)
+    {
+        printf("      fonts in RAM: %u bytes streamed with cache, %u bytes in place\n",
+               stream_ram, (uint32_t)(font_num * sizeof(GlyphFont)));
+    }
+
+    munmap(addr, size);
+    close(fd);
+    if (failures)
+    {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,233 @@
+#!/usr/bin/env python3
+"""Pack fonts and system images into the read-only asset partition image
+described in src/sys/asset_pack.h. The firmware maps the partition and hands
+pointers into it straight to LVGL and TJpgDec (see src/driver/assets.h).
+
+Inputs are files or directories. A directory is walked recursively and every
+file is named by its path relative to the directory, without extension; use
+name=path to pick a name explicitly. The type follows the extension:
+
+    .c      font generated by Lvgl Font Tool, converted with font_pack.py
+    .bin    font written by font_pack.py ("HFN1"), otherwise an LVGL binary image
+    .png    converted to an LVGL true color image (RGB565, with alpha if present)
+    .jpg    JPEG, drawn with TJpgDec.drawJpg()
+    other   raw bytes
+
+    python3 asset_pack.py assets.bin font/ch_font_20=../src/resource/font/ch_font_20.c img/
+    esptool.py --chip esp32 write_flash 0x37C000 assets.bin
+
+The offset and size of the partition are read from partitions-no-ota.csv.
+"""
+
+import argparse
+import os
+import struct
+import sys
+import zlib
+
+import font_pack
+
+MAGIC = 0x31534148  # "HAS1"
+VERSION = 1
+HEADER_FORMAT = "<IHHII"
+ENTRY_FORMAT = "<24sIII B3x"
+NAME_MAX = 23
+ALIGN = 32
+
+TYPE_RAW = 0
+TYPE_FONT = 1
+TYPE_IMG = 2
+TYPE_JPEG = 3
+TYPE_NAMES = {TYPE_RAW: "raw", TYPE_FONT: "font", TYPE_IMG: "img", TYPE_JPEG: "jpeg"}
+
+LV_IMG_CF_TRUE_COLOR = 4
+LV_IMG_CF_TRUE_COLOR_ALPHA = 5
+
+PARTITION_NAME = "assets"
+PARTITIONS = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "partitions-no-ota.csv")
+
+
+def png_decode(data, path):
+    """Decode a non-interlaced 8-bit PNG into rows of (r, g, b, a) tuples."""
+    if data[:8] != b"\x89PNG\r\n\x1a\n":
+        sys.exit("asset_pack: %s is not a PNG file" % path)
+    pos = 8
+    idat = bytearray()
+    palette = []
+    alpha = b""
+    while pos < len(data):
+        length, kind = struct.unpack(">I4s", data[pos:pos + 8])
+        body = data[pos + 8:pos + 8 + length]
+        pos += 12 + length
+        if kind == b"IHDR":
+            width, height, depth, color, _, _, interlace = struct.unpack(">IIBBBBB", body)
+        elif kind == b"PLTE":
+            palette = [tuple(body[i:i + 3]) for i in range(0, len(body), 3)]
+        elif kind == b"tRNS":
+            alpha = body
+        elif kind == b"IDAT":
+            idat += body
+    channels = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}.get(color)
+    if depth != 8 or channels is None or interlace:
+        sys.exit("asset_pack: %s must be an 8-bit non-interlaced PNG" % path)
+
+    raw = zlib.decompress(bytes(idat))
+    stride = width * channels
+    prev = bytearray(stride)
+    rows = []
+    for y in range(height):
+        kind = raw[y * (stride + 1)]
+        line = bytearray(raw[y * (stride + 1) + 1:(y + 1) * (stride + 1)])
+        for x in range(stride):
+            left = line[x - channels] if x >= channels else 0
+            up = prev[x]
+            corner = prev[x - channels] if x >= channels else 0
+            if kind == 1:
+                line[x] = (line[x] + left) & 0xFF
+            elif kind == 2:
+                line[x] = (line[x] + up) & 0xFF
+            elif kind == 3:
+                line[x] = (line[x] + (left + up) // 2) & 0xFF
+            elif kind == 4:
+                estimate = left + up - corner
+                pa, pb, pc = abs(estimate - left), abs(estimate - up), abs(estimate - corner)
+                line[x] = (line[x] + (left if pa <= pb and pa <= pc else up if pb <= pc else corner)) & 0xFF
+        prev = line
+        row = []
+        for x in range(width):
+            pixel = line[x * channels:(x + 1) * channels]
+            if color == 0:
+                row.append((pixel[0], pixel[0], pixel[0], 255))
+            elif color == 2:
+                row.append((pixel[0], pixel[1], pixel[2], 255))
+            elif color == 3:
+                index = pixel[0]
+                row.append(palette[index] + (alpha[index] if index < len(alpha) else 255,))
+            elif color == 4:
+                row.append((pixel[0], pixel[0], pixel[0], pixel[1]))
+            else:
+                row.append(tuple(pixel))
+        rows.append(row)
+    return width, height, rows
+
+
+def lv_img_header(cf, width, height):
+    if width >= 1 << 11 or height >= 1 << 11:
+        sys.exit("asset_pack: images are limited to 2047x2047")
+    return struct.pack("<I", cf | (width << 10) | (height << 21))
+
+
+def png_to_lv_img(data, path):
+    width, height, rows = png_decode(data, path)
+    has_alpha = any(pixel[3] != 255 for row in rows for pixel in row)
+    out = bytearray(lv_img_header(LV_IMG_CF_TRUE_COLOR_ALPHA if has_alpha else LV_IMG_CF_TRUE_COLOR,
+                                  width, height))
+    for row in rows:
+        for r, g, b, a in row:
+            # RGB565, low byte first (LV_COLOR_16_SWAP is 0)
+            out += struct.pack("<H", ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3))
+            if has_alpha:
+                out.append(a)
+    return bytes(out)
+
+
+def check_lv_img(data, path):
+    if len(data) < 4:
+        sys.exit("asset_pack: %s is too short for an LVGL image" % path)
+    header = struct.unpack("<I", data[:4])[0]
+    cf, width, height = header & 0x1F, (header >> 10) & 0x7FF, header >> 21
+    size = {LV_IMG_CF_TRUE_COLOR: 2, LV_IMG_CF_TRUE_COLOR_ALPHA: 3, 6: 2}.get(cf, 0) * width * height
+    if header & 0xE0 or (size and size != len(data) - 4):
+        sys.exit("asset_pack: %s is not an LVGL binary image with 16-bit colors" % path)
+
+
+def load(path):
+    ext = os.path.splitext(path)[1].lower()
+    if ext == ".c":
+        return TYPE_FONT, font_pack.pack(font_pack.parse(path))[0]
+    with open(path, "rb") as file:
+        data = file.read()
+    if ext == ".bin":
+        if data[:4] == struct.pack("<I", font_pack.MAGIC):
+            return TYPE_FONT, data
+        check_lv_img(data, path)
+        return TYPE_IMG, data
+    if ext == ".png":
+        return TYPE_IMG, png_to_lv_img(data, path)
+    if ext in (".jpg", ".jpeg"):
+        return TYPE_JPEG, data
+    return TYPE_RAW, data
+
+
+def collect(inputs):
+    files = {}
+    for spec in inputs:
+        name, sep, path = spec.partition("=")
+        if not sep:
+            name, path = None, spec
+        if os.path.isdir(path):
+            for root, _, names in os.walk(path):
+                for file_name in names:
+                    full = os.path.join(root, file_name)
+                    rel = os.path.splitext(os.path.relpath(full, path))[0].replace(os.sep, "/")
+                    files[(name + "/" + rel) if name else rel] = full
+        else:
+            files[name or os.path.splitext(os.path.basename(path))[0]] = path
+    for name in files:
+        if not name or len(name.encode("utf-8")) > NAME_MAX:
+            sys.exit("asset_pack: name '%s' must be 1 to %d bytes" % (name, NAME_MAX))
+    return files
+
+
+def build(entries):
+    # Sorted by bytes, matching the strcmp() binary search in the firmware
+    entries = sorted(entries, key=lambda entry: entry[0].encode("utf-8"))
+    header_size = struct.calcsize(HEADER_FORMAT)
+    data_start = header_size + len(entries) * struct.calcsize(ENTRY_FORMAT)
+    index = bytearray()
+    blobs = bytearray()
+    for name, kind, data in entries:
+        # Pad with 0xFF like erased flash
+        blobs += b"\xff" * (-(data_start + len(blobs)) % ALIGN)
+        offset = data_start + len(blobs)
+        index += struct.pack(ENTRY_FORMAT, name.encode("utf-8"), offset, len(data), zlib.crc32(data), kind)
+        blobs += data
+    size = data_start + len(blobs)
+    fields = struct.pack("<HHI", VERSION, len(entries), size)
+    crc = zlib.crc32(bytes(index), zlib.crc32(fields))
+    return struct.pack(HEADER_FORMAT, MAGIC, VERSION, len(entries), size, crc) + bytes(index) + bytes(blobs)
+
+
+def find_partition(path):
+    with open(path) as file:
+        for line in file:
+            fields = [field.strip() for field in line.split("#")[0].split(",")]
+            if len(fields) >= 5 and fields[0] == PARTITION_NAME:
+                return int(fields[3], 0), int(fields[4], 0)
+    sys.exit("asset_pack: no '%s' partition in %s" % (PARTITION_NAME, path))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("output", help="image to write")
+    parser.add_argument("inputs", nargs="+", help="files, directories or name=path")
+    parser.add_argument("--partitions", default=PARTITIONS, help="partition table (default: %(default)s)")
+    args = parser.parse_args()
+
+    offset, limit = find_partition(args.partitions)
+    entries = []
+    for name, path in sorted(collect(args.inputs).items()):
+        kind, data = load(path)
+        entries.append((name, kind, data))
+        print("  %-24s %-5s %8d bytes" % (name, TYPE_NAMES[kind], len(data)))
+    image = build(entries)
+    if len(image) > limit:
+        sys.exit("asset_pack: image is %d bytes, the partition holds %d" % (len(image), limit))
+    with open(args.output, "wb") as file:
+        file.write(image)
+    print("%s: %d entries, %d of %d bytes" % (args.output, len(entries), len(image), limit))
+    print("flash with: esptool.py --chip esp32 write_flash 0x%X %s" % (offset, args.output))
+
+
+if __name__ == "__main__":
+    main()
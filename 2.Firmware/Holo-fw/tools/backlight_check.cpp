@@ -0,0 +1,134 @@
+// Host-side checks for the backlight filter and curve (driver/backlight_curve.*).
+//
+// Runs the lux filter and curve over synthetic lighting scenarios at the
+// firmware's sampling interval and reports how the target brightness moves.
+// Exits non-zero when a check fails.
+//
+//     g++ -O2 -I../src/driver -I../sim/include -o backlight_check backlight_check.cpp ../src/driver/backlight_curve.cpp
+//     ./backlight_check [-v] [--curve "0=5,10=20,100=45,500=75,2000=100"]
+
+#include "backlight_curve.h"
+#include "sim_check.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INTERVAL_MS 250 // BACKLIGHT_INTERVAL
+#define DEADBAND 3      // BACKLIGHT_DEADBAND
+
+static bool verbose = false;
+
+// Feed a lux profile through filter + curve with the firmware's dead band.
+// Returns the applied brightness after each step in out[].
+static int simulate(const BacklightCurve &curve, float (*lux_at)(int ms), int duration_ms, int *out)
+{
+    LuxFilter filter;
+    int applied = -1;
+    int adjustments = 0;
+    int steps = 0;
+    for (int ms = 0; ms < duration_ms; ms += INTERVAL_MS)
+    {
+        int target = curve.map(filter.update(lux_at(ms), INTERVAL_MS / 1000.0f));
+        if (applied < 0 || abs(target - applied) >= DEADBAND)
+        {
+            applied = target;
+            ++adjustments;
+            if (verbose)
+            {
+                printf("    %6d ms  lux %7.1f  -> %3d%%\n", ms, lux_at(ms), applied);
+            }
+        }
+        out[steps++] = applied;
+    }
+    return adjustments;
+}
+
+static float lamp_on(int ms) { return ms < 2000 ? 3 : 300; }
+static float lamp_off(int ms) { return ms < 2000 ? 300 : 3; }
+static float hand_shadow(int ms) { return (ms >= 2000 && ms < 2500) ? 15 : 250; }
+// Fluorescent-like flicker between neighbouring readings
+static float noisy(int ms) { return (ms / INTERVAL_MS) % 2 ? 180 : 220; }
+
+static int first_at(const int *trace, int steps, int value, bool rising)
+{
+    for (int pos = 0; pos < steps; ++pos)
+    {
+        if (rising ? trace[pos] >= value : trace[pos] <= value)
+        {
+            return pos * INTERVAL_MS;
+        }
+    }
+    return -1;
+}
+
+int main(int argc, char **argv)
+{
+    BacklightCurve curve;
+    for (int pos = 1; pos < argc; ++pos)
+    {
+        if (!strcmp(argv[pos], "-v"))
+        {
+            verbose = true;
+        }
+        else if (!strcmp(argv[pos], "--curve") && pos + 1 < argc)
+        {
+            if (!curve.parse(argv[++pos]))
+            {
+                fprintf(stderr, "invalid curve: %s\n", argv[pos]);
+                return 2;
+            }
+        }
+    }
+
+    // Curve
+    int last = -1;
+    bool monotonic = true;
+    for (float lux = 0; lux <= 5000; lux += 1)
+    {
+        int percent = curve.map(lux);
+        monotonic = monotonic && percent >= last && percent <= 100;
+        last = percent;
+    }
+    check(monotonic, "curve is monotonic and within 0-100%");
+    BacklightCurve probe;
+    check(!probe.parse("100=50,10=20"), "rejects decreasing lux");
+    check(!probe.parse("0=5,10=120"), "rejects brightness above 100%");
+    check(!probe.parse("0:5"), "rejects malformed pairs");
+    check(!probe.parse(""), "rejects empty curve");
+    check(probe.map(0) == BacklightCurve().map(0), "failed parse keeps previous curve");
+    check(probe.parse("0=10, 1000=90") && probe.map(0) == 10 && probe.map(5000) == 90,
+          "clamps outside the configured range");
+
+    // Filter
+    const int duration = 20000;
+    int trace[duration / INTERVAL_MS];
+    int steps = duration / INTERVAL_MS;
+    int bright = curve.map(300), dark = curve.map(3);
+
+    simulate(curve, lamp_on, duration, trace);
+    int rise_ms = first_at(trace, steps, bright - DEADBAND, true) - 2000;
+    printf("    lamp on: %d%% -> %d%% in %d ms\n", dark, bright, rise_ms);
+    check(rise_ms >= 0 && rise_ms <= 4000, "brightens within 4 s of a lamp turning on");
+
+    simulate(curve, lamp_off, duration, trace);
+    int fall_ms = first_at(trace, steps, dark + DEADBAND, false) - 2000;
+    printf("    lamp off: %d%% -> %d%% in %d ms\n", bright, dark, fall_ms);
+    check(fall_ms > rise_ms, "dims slower than it brightens");
+
+    simulate(curve, hand_shadow, duration, trace);
+    int lowest = 100;
+    for (int pos = 0; pos < steps; ++pos)
+    {
+        lowest = trace[pos] < lowest ? trace[pos] : lowest;
+    }
+    printf("    hand shadow: %d%% dipped to %d%%\n", curve.map(250), lowest);
+    check(curve.map(250) - lowest <= 10, "a 0.5 s shadow dips brightness by 10% at most");
+
+    int adjustments = simulate(curve, noisy, duration, trace);
+    printf("    noisy light: %d adjustments in %d s\n", adjustments, duration / 1000);
+    check(adjustments <= 1, "dead band holds brightness under flickering light");
+
+    printf("%s\n", failures ? "FAILED" : "all checks passed");
+    return failures ? 1 : 0;
+}
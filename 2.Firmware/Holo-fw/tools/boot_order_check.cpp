@@ -0,0 +1,174 @@
+// Host check of the boot stage ordering (sys/boot.*, setup() in Holo.cpp) on the simulator (sim/).
+//
+// Boots the firmware once with every driver replaced by the simulator's
+// stand-ins and reads the boot report that boot_run() prints. Every stage
+// must start only after the stages whose resources it uses have ended (the
+// table below, written from what each stage touches, not copied from
+// setup()), and no socket may be bound before the wifi stage started the
+// network stack with WiFi.mode(): on the device lwIP is not up before that
+// and socket()/bind() fail. WiFi.mode() is made to take CHECK_WIFI_START_MS
+// so that a stage which binds without waiting for wifi runs first and is
+// caught, however the stages happen to be scheduled.
+// Exits non-zero when a check fails.
+//
+//     pio run -e boot_order_check
+//     .pio/build/boot_order_check/program [--partitions CSV]
+
+#include "Arduino.h"
+#include "sim.h"
+#include "sim_check.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <map>
+#include <string>
+
+#define CHECK_WIFI_START_MS 1000
+
+// Stage -> stages that must have ended before it starts
+struct Order
+{
+    const char *stage;
+    const char *after;
+    const char *why;
+};
+
+static const Order orders[] = {
+    {"config", "settings", "config.txt is imported into the settings store"},
+    {"config", "sd", "config.txt is on the card"},
+    {"imu", "ambient", "the IMU shares the I2C bus with the light sensor"},
+    {"imu", "settings", "the calibration is kept in the settings"},
+    {"backlight", "screen", "the backlight drives the panel's PWM"},
+    {"backlight", "config", "the curve comes from config.txt"},
+    {"lv_fs", "screen", "LVGL is started by the screen"},
+    {"wifi", "config", "the credentials come from config.txt"},
+    {"wifi", "rgb", "the LED shows the connection state"},
+    {"picture", "screen", "the app draws with LVGL"},
+    {"picture", "lv_fs", "images are opened through the LVGL file system"},
+    {"picture", "sd", "the catalog is read from the card"},
+    {"picture", "assets", "the fallback font and the empty-card image are assets"},
+    {"services", "wifi", "the servers need lwIP"},
+    {"services", "picture", "the servers report the picture catalog"},
+};
+
+struct Stage
+{
+    long start;
+    long end; // -1 for background stages
+};
+
+// "  name  core  start  end  took" lines between "Boot report:" and "  total"
+static std::map<std::string, Stage> parse_report(const std::string &log)
+{
+    std::map<std::string, Stage> stages;
+    size_t pos = log.find("Boot report:");
+    if (std::string::npos == pos)
+    {
+        return stages;
+    }
+    pos = log.find('\n', log.find('\n', pos) + 1); // past the column titles
+    while (std::string::npos != pos && pos + 1 < log.size())
+    {
+        size_t next = log.find('\n', pos + 1);
+        std::string line = log.substr(pos + 1, std::string::npos == next ? std::string::npos : next - pos - 1);
+        pos = next;
+        char name[32];
+        int core;
+        long start;
+        char end[16];
+        if (0 == line.compare(0, 8, "  total ") || 4 != sscanf(line.c_str(), "%31s %d %ld %15s", name, &core, &start, end))
+        {
+            break;
+        }
+        stages[name] = {start, '-' == end[0] ? -1 : atol(end)};
+    }
+    return stages;
+}
+
+int main(int argc, char **argv)
+{
+    SimOptions options;
+    sim_default_options(&options);
+    options.wifi_start_ms = CHECK_WIFI_START_MS;
+    for (int pos = 1; pos < argc; ++pos)
+    {
+        if (!strcmp(argv[pos], "--partitions") && pos + 1 < argc)
+        {
+            options.partitions = argv[++pos];
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--partitions CSV]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    SimCheckDir work;
+    if (!sim_check_dir("boot_order_check", &work, &options))
+    {
+        return 2;
+    }
+    std::string log_path = work.path + "/serial.log";
+    if (!sim_begin(&options))
+    {
+        sim_check_remove(work);
+        return 2;
+    }
+
+    // Serial goes to stdout: keep what setup() prints
+    fflush(stdout);
+    int saved_stdout = dup(STDOUT_FILENO);
+    int log_fd = open(log_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    dup2(log_fd, STDOUT_FILENO);
+    sim_set_loop_task();
+    setup();
+    fflush(stdout);
+    dup2(saved_stdout, STDOUT_FILENO);
+    close(log_fd);
+    close(saved_stdout);
+
+    std::string log;
+    FILE *fp = fopen(log_path.c_str(), "r");
+    char buf[4096];
+    size_t len;
+    while (NULL != fp && (len = fread(buf, 1, sizeof(buf), fp)) > 0)
+    {
+        log.append(buf, len);
+    }
+    if (NULL != fp)
+    {
+        fclose(fp);
+    }
+
+    std::map<std::string, Stage> stages = parse_report(log);
+    check(stages.size() >= 14, "boot_run() reports every stage");
+    for (const Order &order : orders)
+    {
+        auto stage = stages.find(order.stage);
+        auto after = stages.find(order.after);
+        bool ok = stages.end() != stage && stages.end() != after && after->second.end >= 0 &&
+                  stage->second.start >= after->second.end;
+        char what[160];
+        snprintf(what, sizeof(what), "%s after %s: %s", order.stage, order.after, order.why);
+        check(ok, what);
+        if (!ok && stages.end() != stage && stages.end() != after)
+        {
+            printf("      %s starts at %ld ms, %s ends at %ld ms\n", order.stage, stage->second.start, order.after,
+                   after->second.end);
+        }
+    }
+    SimWifiStats wifi;
+    sim_wifi_stats(&wifi);
+    check(0 == wifi.early_binds, "no socket is bound before WiFi.mode() started the network stack");
+
+    sim_end();
+    sim_check_remove(work);
+    printf(failures ? "boot order check FAILED (%d)\n" : "boot order check passed\n", failures);
+    fflush(stdout);
+    // Firmware tasks never return; leave without running static destructors under them
+    _exit(failures ? 1 : 0);
+}
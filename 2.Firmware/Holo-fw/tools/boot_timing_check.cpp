@@ -0,0 +1,171 @@
+// Host simulation of the WiFi part of boot (wifi_manager.*) on the simulator (sim/).
+//
+// Boots the firmware several times in a row on the same flash, each boot in
+// a child process of its own, with the simulated access point taking typical
+// ESP32 times to scan, associate and hand out a DHCP lease. Reports when
+// wifi_manager_connected() first holds after boot and checks:
+//   - the first boot scans and gets its address from DHCP
+//   - the next boot reuses the cached BSSID and channel, skips the scan and
+//     is faster by about the scan time, but still asks DHCP for the address:
+//     a lease cached from an earlier boot is never reused as a static IP
+//   - after the access point moved to another channel the fast connect fails
+//     within WIFI_FAST_CONNECT_TIMEOUT, the full scan connects, and the boot
+//     after that is fast again on the new channel
+// Exits non-zero when a check fails.
+//
+//     pio run -e boot_timing_check
+//     .pio/build/boot_timing_check/program [--partitions CSV]
+
+#include "Arduino.h"
+#include "sim.h"
+#include "sim_check.h"
+#include "wifi_manager.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <string>
+#include <thread>
+
+#define CHECK_SCAN_MS 1500  // active scan of all channels
+#define CHECK_ASSOC_MS 300  // authentication, association and the WPA2 handshake
+#define CHECK_DHCP_MS 700   // DISCOVER/OFFER/REQUEST/ACK
+#define CHECK_SLACK_MS 400  // boot work before wifi_init() and polling
+#define CHECK_BOOT_TIMEOUT_MS 20000
+
+struct BootResult
+{
+    long connected_ms; // millis() when first connected, -1: not within CHECK_BOOT_TIMEOUT_MS
+    SimWifiStats wifi;
+};
+
+static void loop_task()
+{
+    sim_set_loop_task();
+    while (true)
+    {
+        loop();
+    }
+}
+
+// Runs in the child: boots and reports through `fd`
+static void boot_child(const SimOptions &options, int fd)
+{
+    BootResult result;
+    memset(&result, 0, sizeof(result));
+    result.connected_ms = -1;
+    if (sim_begin(&options))
+    {
+        sim_set_loop_task();
+        setup();
+        std::thread(loop_task).detach();
+        while (millis() < CHECK_BOOT_TIMEOUT_MS)
+        {
+            if (wifi_manager_connected())
+            {
+                result.connected_ms = millis();
+                break;
+            }
+            usleep(2000);
+        }
+        sim_wifi_stats(&result.wifi);
+    }
+    (void)!write(fd, &result, sizeof(result));
+    _exit(0);
+}
+
+static bool boot(const SimOptions &options, BootResult *result)
+{
+    int fds[2];
+    if (0 != pipe(fds))
+    {
+        return false;
+    }
+    pid_t pid = fork();
+    if (0 == pid)
+    {
+        close(fds[0]);
+        boot_child(options, fds[1]);
+    }
+    close(fds[1]);
+    bool ok = pid > 0 && sizeof(*result) == read(fds[0], result, sizeof(*result));
+    close(fds[0]);
+    if (pid > 0)
+    {
+        waitpid(pid, NULL, 0);
+    }
+    return ok;
+}
+
+static void report(const char *name, const BootResult &result)
+{
+    printf("      %-22s connected after %5ld ms  (scans %u, DHCP %u, static IP %u, AP not found %u)\n", name,
+           result.connected_ms, (unsigned)result.wifi.scans, (unsigned)result.wifi.dhcp,
+           (unsigned)result.wifi.static_ip, (unsigned)result.wifi.not_found);
+}
+
+int main(int argc, char **argv)
+{
+    SimOptions options;
+    sim_default_options(&options);
+    options.quiet = true;
+    options.wifi_scan_ms = CHECK_SCAN_MS;
+    options.wifi_assoc_ms = CHECK_ASSOC_MS;
+    options.wifi_dhcp_ms = CHECK_DHCP_MS;
+    for (int pos = 1; pos < argc; ++pos)
+    {
+        if (!strcmp(argv[pos], "--partitions") && pos + 1 < argc)
+        {
+            options.partitions = argv[++pos];
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--partitions CSV]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    SimCheckDir work;
+    if (!sim_check_dir("boot_timing_check", &work, &options))
+    {
+        return 2;
+    }
+    // Each boot listens on the same ports again; keep them apart from other checks
+    options.port_offset = 9000;
+
+    BootResult first, warm, moved, after_move;
+    bool booted = boot(options, &first) && boot(options, &warm);
+    options.wifi_channel = 6;
+    booted = booted && boot(options, &moved) && boot(options, &after_move);
+    check(booted, "the firmware boots four times");
+    if (booted)
+    {
+        report("first boot", first);
+        report("cached AP", warm);
+        report("AP on another channel", moved);
+        report("after that", after_move);
+
+        long full_ms = CHECK_SCAN_MS + CHECK_ASSOC_MS + CHECK_DHCP_MS;
+        check(first.connected_ms >= full_ms && first.connected_ms < full_ms + CHECK_SLACK_MS &&
+                  1 == first.wifi.scans && 1 == first.wifi.dhcp,
+              "the first boot scans and uses DHCP");
+        check(warm.connected_ms >= 0 && 0 == warm.wifi.scans &&
+                  warm.connected_ms < first.connected_ms - CHECK_SCAN_MS + CHECK_SLACK_MS,
+              "with the cached AP the scan is skipped");
+        check(1 == warm.wifi.dhcp && 0 == warm.wifi.static_ip && 0 == first.wifi.static_ip,
+              "the cached lease is not reused as a static IP");
+        check(1 == moved.wifi.not_found && 1 == moved.wifi.scans && moved.connected_ms >= WIFI_FAST_CONNECT_TIMEOUT &&
+                  moved.connected_ms < WIFI_FAST_CONNECT_TIMEOUT + full_ms + CHECK_SLACK_MS,
+              "a stale cache falls back to the full scan");
+        check(after_move.connected_ms >= 0 && 0 == after_move.wifi.scans &&
+                  after_move.connected_ms < first.connected_ms - CHECK_SCAN_MS + CHECK_SLACK_MS,
+              "the next boot is fast again on the new channel");
+    }
+
+    sim_check_remove(work);
+    printf(failures ? "boot timing check FAILED (%d)\n" : "boot timing check passed\n", failures);
+    return failures ? 1 : 0;
+}
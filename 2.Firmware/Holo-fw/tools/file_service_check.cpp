@@ -0,0 +1,785 @@
+// Host-side checks and benchmark for the binary file protocol (file_service.*, message.*).
+//
+// Runs FileService on a temporary directory through a POSIX FileBackend, the
+// way file_server.cpp runs it on the SD card. Checks the MsgHead codec (the
+// length used to be decoded from the wrong bytes), every action including
+// errors, paging of large directories, recursive removal, resumable writes,
+// and that pipelined requests split into random TCP-sized pieces are all
+// answered in order by file_conn_process(). Malformed frames must close the
+// connection instead of being answered.
+// Ends with a transfer over a loopback socket with a simulated Wi-Fi round
+// trip, sending one request at a time and then pipelined, and with the bytes
+// each chunk costs on the wire compared to the HTTP upload.
+// Exits non-zero when a check fails.
+//
+//     g++ -O2 -I../src -I../sim/include -o file_service_check file_service_check.cpp ../src/file_service.cpp ../src/message.cpp -lpthread
+//     ./file_service_check [rtt_ms]
+
+#include "file_service.h"
+#include "sim_check.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+static double seconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// A directory on the host standing in for the SD card. Entries are listed in
+// name order so paging is deterministic.
+class PosixBackend : public FileBackend
+{
+private:
+    std::string m_root;
+
+    std::string full(const char *path) { return m_root + path; }
+
+public:
+    int reads = 0; // read() calls, to see that one request does one read
+
+    PosixBackend(const std::string &root) : m_root(root) {}
+
+    FILE_ENTRY_TYPE stat(const char *path, uint32_t *size)
+    {
+        struct stat st;
+        if (0 != ::stat(full(path).c_str(), &st))
+        {
+            return FILE_ENTRY_NONE;
+        }
+        *size = S_ISDIR(st.st_mode) ? 0 : st.st_size;
+        return S_ISDIR(st.st_mode) ? FILE_ENTRY_DIR : FILE_ENTRY_FILE;
+    }
+
+    bool mkdir(const char *path) { return 0 == ::mkdir(full(path).c_str(), 0755); }
+
+    bool remove(const char *path) { return 0 == ::remove(full(path).c_str()); }
+
+    bool rename(const char *from, const char *to) { return 0 == ::rename(full(from).c_str(), full(to).c_str()); }
+
+    int32_t read(const char *path, uint32_t offset, uint8_t *buf, uint32_t len)
+    {
+        ++reads;
+        int fd = open(full(path).c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return -1;
+        }
+        ssize_t got = pread(fd, buf, len, offset);
+        close(fd);
+        return got;
+    }
+
+    bool write(const char *path, uint32_t offset, const uint8_t *data, uint32_t len)
+    {
+        int fd = open(full(path).c_str(), O_WRONLY | O_CREAT | (0 == offset ? O_TRUNC : O_APPEND), 0644);
+        if (fd < 0)
+        {
+            return false;
+        }
+        bool ok = 0 == len || ::write(fd, data, len) == (ssize_t)len;
+        close(fd);
+        return ok;
+    }
+
+    bool list(const char *path, uint32_t offset, FileListFunc visit, void *ctx)
+    {
+        DIR *dir = opendir(full(path).c_str());
+        if (NULL == dir)
+        {
+            return false;
+        }
+        std::vector<std::string> names;
+        while (struct dirent *entry = readdir(dir))
+        {
+            if (strcmp(entry->d_name, ".") && strcmp(entry->d_name, ".."))
+            {
+                names.push_back(entry->d_name);
+            }
+        }
+        closedir(dir);
+        std::sort(names.begin(), names.end());
+        for (size_t i = offset; i < names.size(); ++i)
+        {
+            std::string child = std::string(path) + (strcmp(path, "/") ? "/" : "") + names[i];
+            uint32_t size = 0;
+            FILE_ENTRY_TYPE type = stat(child.c_str(), &size);
+            if (!visit(ctx, names[i].c_str(), type, size))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// Client side: builds requests and parses replies with the same codec
+typedef std::vector<uint8_t> Bytes;
+
+struct Request
+{
+    Bytes frame;
+    MsgWriter out;
+    ACTION_TYPE action;
+
+    Request(ACTION_TYPE action, uint16_t tag) : frame(FILE_MAX_FRAME), out(frame.data(), FILE_MAX_FRAME), action(action)
+    {
+        out.reserve(MSG_HEAD_SIZE);
+        out.u16(tag);
+    }
+
+    Bytes done()
+    {
+        MsgHead head(MODULE_TYPE_CUBIC_FILE_MANAGER, MODULE_TYPE_C_FILE_MANAGER);
+        head.m_action_type = action;
+        head.m_msg_len = out.length();
+        head.encode(frame.data());
+        return Bytes(frame.begin(), frame.begin() + out.length());
+    }
+};
+
+static Bytes path_request(ACTION_TYPE action, const char *path, uint16_t tag = 1)
+{
+    Request req(action, tag);
+    req.out.str(path);
+    return req.done();
+}
+
+static Bytes rename_request(ACTION_TYPE action, const char *from, const char *to, uint16_t tag = 1)
+{
+    Request req(action, tag);
+    req.out.str(from);
+    req.out.str(to);
+    return req.done();
+}
+
+static Bytes read_request(const char *path, uint32_t offset, uint16_t len, uint16_t tag = 1)
+{
+    Request req(AT_FILE_READ, tag);
+    req.out.str(path);
+    req.out.u32(offset);
+    req.out.u16(len);
+    return req.done();
+}
+
+static Bytes write_request(const char *path, uint32_t offset, const uint8_t *data, uint32_t len, uint16_t tag = 1)
+{
+    Request req(AT_FILE_WRITE, tag);
+    req.out.str(path);
+    req.out.u32(offset);
+    req.out.bytes(data, len);
+    return req.done();
+}
+
+static Bytes list_request(const char *path, uint32_t offset, uint16_t limit, uint16_t tag = 1)
+{
+    Request req(AT_DIR_LIST, tag);
+    req.out.str(path);
+    req.out.u32(offset);
+    req.out.u16(limit);
+    return req.done();
+}
+
+struct Reply
+{
+    bool valid = false;
+    ACTION_TYPE action = AT_UNKNOWN;
+    uint16_t tag = 0;
+    uint8_t status = 0xFF;
+    Bytes fields;
+};
+
+static Reply parse_reply(const uint8_t *frame, uint32_t len)
+{
+    Reply reply;
+    MsgHead head;
+    head.decode(frame);
+    if (!head.isLegal() || head.m_msg_len != len || MODULE_TYPE_C_FILE_MANAGER != head.m_from_who ||
+        MODULE_TYPE_CUBIC_FILE_MANAGER != head.m_to_who)
+    {
+        return reply;
+    }
+    MsgReader in(frame + MSG_HEAD_SIZE, len - MSG_HEAD_SIZE);
+    reply.tag = in.u16();
+    reply.status = in.u8();
+    uint32_t rest_len;
+    const uint8_t *rest = in.rest(&rest_len);
+    reply.valid = in.ok();
+    reply.action = head.m_action_type;
+    reply.fields.assign(rest, rest + rest_len);
+    return reply;
+}
+
+static Reply call(FileService &service, const Bytes &req)
+{
+    Bytes out(FILE_MAX_FRAME);
+    uint32_t len = service.handle(req.data(), req.size(), out.data());
+    return 0 == len ? Reply() : parse_reply(out.data(), len);
+}
+
+static uint32_t field_u32(const Reply &reply, uint32_t pos)
+{
+    MsgReader in(reply.fields.data(), reply.fields.size());
+    in.bytes(pos);
+    return in.u32();
+}
+
+static Bytes random_bytes(std::mt19937 &rng, uint32_t len)
+{
+    Bytes data(len);
+    for (auto &byte : data)
+    {
+        byte = rng();
+    }
+    return data;
+}
+
+static Bytes read_file(const std::string &path)
+{
+    Bytes data;
+    FILE *file = fopen(path.c_str(), "rb");
+    if (NULL == file)
+    {
+        return data;
+    }
+    uint8_t buf[4096];
+    size_t len;
+    while ((len = fread(buf, 1, sizeof(buf), file)) > 0)
+    {
+        data.insert(data.end(), buf, buf + len);
+    }
+    fclose(file);
+    return data;
+}
+
+static void check_codec()
+{
+    // The header is big-endian: "##", length, from, to, action
+    uint8_t raw[MSG_HEAD_SIZE] = {0x23, 0x23, 0x01, 0x02, MODULE_TYPE_CUBIC_FILE_MANAGER,
+                                  MODULE_TYPE_C_FILE_MANAGER, AT_FILE_READ};
+    MsgHead head;
+    head.decode(raw);
+    check(head.isLegal() && 0x0102 == head.m_msg_len && MODULE_TYPE_C_FILE_MANAGER == head.m_to_who &&
+              AT_FILE_READ == head.m_action_type,
+          "MsgHead decodes the mark and the length from their own bytes");
+    uint8_t again[MSG_HEAD_SIZE];
+    check(MSG_HEAD_SIZE == head.encode(again) && 0 == memcmp(raw, again, MSG_HEAD_SIZE),
+          "MsgHead encodes back to the same bytes");
+
+    uint8_t buf[64];
+    MsgWriter out(buf, sizeof(buf));
+    out.u8(0xA5);
+    out.u16(0x1234);
+    out.u32(0xDEADBEEF);
+    out.str("name");
+    out.bytes("xyz", 3);
+    MsgReader in(buf, out.length());
+    bool ok = 0xA5 == in.u8() && 0x1234 == in.u16() && 0xDEADBEEF == in.u32();
+    const char *name = in.str();
+    ok = ok && NULL != name && 0 == strcmp(name, "name") && name > (const char *)buf &&
+         name < (const char *)buf + sizeof(buf);
+    const uint8_t *bytes = in.bytes(3);
+    ok = ok && bytes == buf + out.length() - 3 && 0 == in.left() && in.ok();
+    check(ok, "fields read back equal, strings and data point into the frame");
+
+    MsgReader past(buf, 3);
+    past.u32();
+    check(!past.ok() && 0 == past.u8() && NULL == past.str(), "reading past the end fails and stays failed");
+
+    uint8_t bad[] = {0x00, 0x03, 'a', 'b', 'c'};
+    MsgReader no_nul(bad, sizeof(bad));
+    uint8_t inner[] = {0x00, 0x03, 'a', 0, 0};
+    MsgReader early_nul(inner, sizeof(inner));
+    check(NULL == no_nul.str() && NULL == early_nul.str(), "strings without their NUL or with an inner NUL fail");
+
+    MsgWriter small(buf, 4);
+    small.u32(1);
+    small.u8(2);
+    check(!small.ok() && 4 == small.length(), "writing past the capacity fails without overflowing");
+
+    uint8_t frame[16] = {0x23, 0x23, 0x00, 0x09, 1, 2, 1, 0, 0};
+    check(0 == msg_frame_length(frame, 3, 64) && 0 == msg_frame_length(frame, 8, 64) &&
+              9 == msg_frame_length(frame, 16, 64),
+          "frame length waits for the whole frame");
+    frame[0] = 0x24;
+    bool bad_mark = -1 == msg_frame_length(frame, 16, 64);
+    frame[0] = 0x23;
+    frame[3] = 0x06;
+    bool too_short = -1 == msg_frame_length(frame, 16, 64);
+    frame[2] = 0x10;
+    bool too_long = -1 == msg_frame_length(frame, 16, 64);
+    check(bad_mark && too_short && too_long, "bad marks, lengths below the header and oversized frames are rejected");
+}
+
+static void check_actions(FileService &service, PosixBackend &fs, const std::string &root)
+{
+    Reply reply = call(service, path_request(AT_FREE_STATUS, "/", 0xBEEF));
+    check(reply.valid && MSG_OK == reply.status && 0xBEEF == reply.tag && AT_FREE_STATUS == reply.action,
+          "a ping is answered with its tag and action");
+
+    check(MSG_OK == call(service, path_request(AT_DIR_CREATE, "/a")).status &&
+              MSG_ERR_EXISTS == call(service, path_request(AT_DIR_CREATE, "/a")).status,
+          "mkdir creates once, then reports it exists");
+    check(MSG_OK == call(service, path_request(AT_FILE_CREATE, "/a/f.txt")).status &&
+              MSG_ERR_EXISTS == call(service, path_request(AT_FILE_CREATE, "/a")).status,
+          "a file is created, a directory is not overwritten by one");
+
+    const char text[] = "hello holo";
+    reply = call(service, write_request("/a/f.txt", 0, (const uint8_t *)text, 10));
+    check(MSG_OK == reply.status && 10 == field_u32(reply, 0), "a write answers the new size");
+    reply = call(service, write_request("/a/f.txt", 10, (const uint8_t *)"!", 1));
+    check(MSG_OK == reply.status && 11 == field_u32(reply, 0) && "hello holo!" == std::string(
+              (const char *)read_file(root + "/a/f.txt").data(), 11),
+          "a write at the current size appends");
+    reply = call(service, write_request("/a/f.txt", 5, (const uint8_t *)"x", 1));
+    check(MSG_ERR_OFFSET == reply.status && 11 == field_u32(reply, 0) && 11 == read_file(root + "/a/f.txt").size(),
+          "a write at another offset is refused and answers the size to resume from");
+    reply = call(service, write_request("/a/new.bin", 4, (const uint8_t *)"x", 1));
+    check(MSG_ERR_OFFSET == reply.status && 0 == field_u32(reply, 0), "resuming a missing file answers size 0");
+
+    reply = call(service, path_request(AT_FILE_GET_INFO, "/a/f.txt"));
+    check(MSG_OK == reply.status && 5 == reply.fields.size() && FILE_ENTRY_FILE == reply.fields[0] &&
+              11 == field_u32(reply, 1),
+          "info reports type and size");
+    reply = call(service, path_request(AT_FILE_GET_INFO, "/a"));
+    check(MSG_OK == reply.status && FILE_ENTRY_DIR == reply.fields[0], "info reports directories");
+    check(MSG_ERR_NOT_FOUND == call(service, path_request(AT_FILE_GET_INFO, "/nope")).status,
+          "info of a missing path is not found");
+
+    int reads = fs.reads;
+    reply = call(service, read_request("/a/f.txt", 6, 100));
+    check(MSG_OK == reply.status && "holo!" == std::string(reply.fields.begin(), reply.fields.end()) &&
+              fs.reads == reads + 1,
+          "a read past the end is short, with one backend read");
+    reply = call(service, read_request("/a/f.txt", 11, 100));
+    check(MSG_OK == reply.status && reply.fields.empty(), "a read at the end is empty");
+    check(MSG_ERR_NOT_FOUND == call(service, read_request("/nope", 0, 10)).status &&
+              MSG_ERR_NOT_DIR == call(service, read_request("/a", 0, 10)).status,
+          "reading a missing file or a directory fails");
+    reply = call(service, read_request("/a/f.txt", 0, 0xFFFF));
+    check(MSG_OK == reply.status && 11 == reply.fields.size(), "a read asking for more than a frame is clipped");
+
+    check(MSG_OK == call(service, rename_request(AT_FILE_RENAME, "/a/f.txt", "/a/g.txt")).status &&
+              MSG_ERR_NOT_FOUND == call(service, path_request(AT_FILE_GET_INFO, "/a/f.txt")).status,
+          "a file is renamed");
+    call(service, path_request(AT_FILE_CREATE, "/a/h.txt"));
+    check(MSG_ERR_EXISTS == call(service, rename_request(AT_FILE_RENAME, "/a/g.txt", "/a/h.txt")).status &&
+              MSG_ERR_NOT_FOUND == call(service, rename_request(AT_FILE_RENAME, "/a/x", "/a/y")).status,
+          "renaming onto an existing path or from a missing one fails");
+    check(MSG_OK == call(service, rename_request(AT_DIR_RENAME, "/a", "/b")).status, "a directory is renamed");
+
+    check(MSG_OK == call(service, path_request(AT_FILE_REMOVE, "/b/h.txt")).status &&
+              MSG_ERR_NOT_FOUND == call(service, path_request(AT_FILE_REMOVE, "/b/h.txt")).status,
+          "a file is removed once");
+
+    // A tree deeper and wider than one batch of names
+    std::string dir = "/b";
+    for (int depth = 0; depth < 4; ++depth)
+    {
+        dir += "/d" + std::to_string(depth);
+        call(service, path_request(AT_DIR_CREATE, dir.c_str()));
+        for (int i = 0; i < 40; ++i)
+        {
+            call(service, path_request(AT_FILE_CREATE, (dir + "/file_with_a_long_name_" + std::to_string(i)).c_str()));
+        }
+    }
+    check(MSG_OK == call(service, path_request(AT_DIR_REMOVE, "/b")).status &&
+              MSG_ERR_NOT_FOUND == call(service, path_request(AT_FILE_GET_INFO, "/b")).status,
+          "a directory is removed with everything below it");
+    check(MSG_ERR_BAD_REQUEST == call(service, path_request(AT_DIR_REMOVE, "/")).status,
+          "the root cannot be removed");
+
+    dir = "";
+    for (int depth = 0; depth <= FILE_DELETE_DEPTH + 1; ++depth)
+    {
+        dir += "/n";
+        call(service, path_request(AT_DIR_CREATE, dir.c_str()));
+    }
+    check(MSG_ERR_IO == call(service, path_request(AT_DIR_REMOVE, "/n")).status,
+          "removal stops at FILE_DELETE_DEPTH instead of recursing without bound");
+    system(("rm -rf '" + root + "/n'").c_str());
+
+    check(MSG_ERR_BAD_REQUEST == call(service, path_request(AT_FILE_GET_INFO, "relative")).status &&
+              MSG_ERR_BAD_REQUEST == call(service, path_request(AT_FILE_GET_INFO, std::string(FILE_PATH_MAX, '/').c_str())).status,
+          "relative and overlong paths are refused");
+    Request missing(AT_FILE_READ, 7);
+    missing.out.str("/x");
+    check(MSG_ERR_BAD_REQUEST == call(service, missing.done()).status, "a request missing fields is refused");
+    Request unknown(AT_SETTING_GET, 7);
+    reply = call(service, unknown.done());
+    check(MSG_ERR_UNSUPPORTED == reply.status && 7 == reply.tag && reply.fields.empty(),
+          "an unknown action is answered as unsupported");
+
+    Bytes wrong = path_request(AT_FILE_GET_INFO, "/");
+    wrong[5] = MODULE_TYPE_CUBIC_SETTINGS;
+    Bytes out(FILE_MAX_FRAME);
+    check(0 == service.handle(wrong.data(), wrong.size(), out.data()),
+          "a frame for another module is not answered");
+}
+
+// Lists a directory page by page the way a client does
+static std::vector<std::string> list_all(FileService &service, const char *path, uint16_t limit, int *pages)
+{
+    std::vector<std::string> names;
+    uint32_t offset = 0;
+    *pages = 0;
+    while (FILE_LIST_END != offset && *pages < 1000)
+    {
+        Reply reply = call(service, list_request(path, offset, limit));
+        ++*pages;
+        if (MSG_OK != reply.status)
+        {
+            break;
+        }
+        MsgReader in(reply.fields.data(), reply.fields.size());
+        uint16_t count = in.u16();
+        uint32_t next = in.u32();
+        for (uint16_t i = 0; i < count; ++i)
+        {
+            in.u8();
+            in.u32();
+            const char *name = in.str();
+            names.push_back(in.ok() ? name : "");
+        }
+        if (!in.ok() || 0 != in.left())
+        {
+            names.push_back("<malformed>");
+            break;
+        }
+        offset = next;
+    }
+    return names;
+}
+
+static void check_list(FileService &service)
+{
+    call(service, path_request(AT_DIR_CREATE, "/many"));
+    std::vector<std::string> expect;
+    for (int i = 0; i < 300; ++i)
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "picture_%03d_with_a_name_long_enough_to_fill_frames.jpg", i);
+        expect.push_back(name);
+        call(service, path_request(AT_FILE_CREATE, ("/many/" + expect.back()).c_str()));
+    }
+    int pages = 0;
+    check(list_all(service, "/many", 0xFFFF, &pages) == expect && pages > 1,
+          "a listing larger than a frame continues from next");
+    check(list_all(service, "/many", 7, &pages) == expect && 43 == pages, "a listing honours its limit");
+    Reply reply = call(service, list_request("/many", 300, 10));
+    check(MSG_OK == reply.status && 0 == reply.fields[1] && FILE_LIST_END == field_u32(reply, 2),
+          "a listing past the end is empty and ends");
+    check(MSG_ERR_NOT_FOUND == call(service, list_request("/none", 0, 10)).status, "listing a missing path fails");
+    call(service, path_request(AT_FILE_CREATE, "/plain"));
+    check(MSG_ERR_NOT_DIR == call(service, list_request("/plain", 0, 10)).status, "listing a file fails");
+    call(service, path_request(AT_DIR_REMOVE, "/many"));
+    call(service, path_request(AT_FILE_REMOVE, "/plain"));
+}
+
+// Feeds a byte stream into a connection in pieces, sending whatever it answers
+static Bytes run_conn(FileService &service, const Bytes &stream, std::mt19937 &rng, bool *closed)
+{
+    Bytes rx(FILE_RX_BUF_SIZE), tx(FILE_TX_BUF_SIZE), sent;
+    FileConn conn = {rx.data(), 0, tx.data(), 0};
+    size_t pos = 0;
+    *closed = false;
+    while (true)
+    {
+        uint32_t piece = std::min<size_t>({(size_t)(rng() % 1460 + 1), stream.size() - pos,
+                                           (size_t)(FILE_RX_BUF_SIZE - conn.rx_len)});
+        memcpy(conn.rx + conn.rx_len, stream.data() + pos, piece);
+        conn.rx_len += piece;
+        pos += piece;
+        *closed = !file_conn_process(&service, &conn);
+        if (*closed)
+        {
+            // Replies before the bad frame still go out
+            sent.insert(sent.end(), conn.tx, conn.tx + conn.tx_len);
+            break;
+        }
+        // The socket takes a random part of the pending replies
+        uint32_t out = conn.tx_len > 0 ? rng() % conn.tx_len + 1 : 0;
+        sent.insert(sent.end(), conn.tx, conn.tx + out);
+        memmove(conn.tx, conn.tx + out, conn.tx_len - out);
+        conn.tx_len -= out;
+        if (pos == stream.size() && 0 == piece && 0 == out)
+        {
+            break;
+        }
+    }
+    return sent;
+}
+
+static std::vector<Reply> split_replies(const Bytes &stream)
+{
+    std::vector<Reply> replies;
+    size_t pos = 0;
+    while (pos < stream.size())
+    {
+        int32_t len = msg_frame_length(stream.data() + pos, stream.size() - pos, FILE_MAX_FRAME);
+        if (len <= 0)
+        {
+            replies.push_back(Reply());
+            break;
+        }
+        replies.push_back(parse_reply(stream.data() + pos, len));
+        pos += len;
+    }
+    return replies;
+}
+
+static void check_pipeline(FileService &service, const std::string &root, std::mt19937 &rng)
+{
+    // 1 MB written in chunks, read back, with pings between: all sent at once
+    Bytes file = random_bytes(rng, 1 << 20);
+    const uint32_t chunk = FILE_MAX_FRAME - 64;
+    Bytes stream;
+    std::vector<uint16_t> tags;
+    uint16_t tag = 100;
+    for (uint32_t offset = 0; offset < file.size(); offset += chunk, ++tag)
+    {
+        uint32_t len = std::min<uint32_t>(chunk, file.size() - offset);
+        Bytes req = write_request("/big.bin", offset, file.data() + offset, len, tag);
+        stream.insert(stream.end(), req.begin(), req.end());
+        tags.push_back(tag);
+        if (0 == tag % 16)
+        {
+            req = path_request(AT_FREE_STATUS, "/", ++tag);
+            stream.insert(stream.end(), req.begin(), req.end());
+            tags.push_back(tag);
+        }
+    }
+    bool closed;
+    std::vector<Reply> replies = split_replies(run_conn(service, stream, rng, &closed));
+    bool in_order = !closed && replies.size() == tags.size();
+    for (size_t i = 0; in_order && i < replies.size(); ++i)
+    {
+        in_order = replies[i].valid && MSG_OK == replies[i].status && replies[i].tag == tags[i];
+    }
+    check(in_order, "pipelined writes in random pieces are all answered, in order");
+    check(read_file(root + "/big.bin") == file, "the 1 MB file arrives intact");
+
+    stream.clear();
+    tags.clear();
+    const uint16_t read_len = FILE_MAX_FRAME - 16;
+    for (uint32_t offset = 0; offset < file.size(); offset += read_len)
+    {
+        Bytes req = read_request("/big.bin", offset, read_len, ++tag);
+        stream.insert(stream.end(), req.begin(), req.end());
+        tags.push_back(tag);
+    }
+    replies = split_replies(run_conn(service, stream, rng, &closed));
+    Bytes back;
+    in_order = !closed && replies.size() == tags.size();
+    for (size_t i = 0; in_order && i < replies.size(); ++i)
+    {
+        in_order = replies[i].valid && MSG_OK == replies[i].status && replies[i].tag == tags[i];
+        back.insert(back.end(), replies[i].fields.begin(), replies[i].fields.end());
+    }
+    check(in_order && back == file, "pipelined reads return the file, in order");
+
+    // A malformed frame after good ones: the good ones are answered, then the connection closes
+    stream = path_request(AT_FREE_STATUS, "/", 1);
+    Bytes garbage = {0x23, 0x24, 0x00, 0x10, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    stream.insert(stream.end(), garbage.begin(), garbage.end());
+    replies = split_replies(run_conn(service, stream, rng, &closed));
+    check(closed && 1 == replies.size() && 1 == replies[0].tag, "a bad header closes the connection after earlier replies");
+    stream = {0x23, 0x23, 0xFF, 0xFF};
+    run_conn(service, stream, rng, &closed);
+    check(closed, "a frame longer than FILE_MAX_FRAME closes the connection");
+    stream = path_request(AT_FREE_STATUS, "/", 1);
+    stream[4] = MODULE_TYPE_CUBIC_SETTINGS;
+    stream[5] = MODULE_TYPE_TOOL_SETTINGS;
+    replies = split_replies(run_conn(service, stream, rng, &closed));
+    check(closed && replies.empty(), "a frame for another module closes the connection");
+    call(service, path_request(AT_FILE_REMOVE, "/big.bin"));
+}
+
+// Loopback transfer. The server sleeps rtt before answering each batch it
+// reads, standing in for the Wi-Fi round trip that dominates on the device.
+static void serve_socket(int listen_fd, FileService *service, int rtt_us)
+{
+    int fd = accept(listen_fd, NULL, NULL);
+    int enable = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    Bytes rx(FILE_RX_BUF_SIZE), tx(FILE_TX_BUF_SIZE);
+    FileConn conn = {rx.data(), 0, tx.data(), 0};
+    while (true)
+    {
+        ssize_t len = recv(fd, conn.rx + conn.rx_len, FILE_RX_BUF_SIZE - conn.rx_len, 0);
+        if (len <= 0)
+        {
+            break;
+        }
+        conn.rx_len += len;
+        std::this_thread::sleep_for(std::chrono::microseconds(rtt_us));
+        do
+        {
+            if (!file_conn_process(service, &conn))
+            {
+                close(fd);
+                return;
+            }
+            if (conn.tx_len > 0 && send(fd, conn.tx, conn.tx_len, 0) != (ssize_t)conn.tx_len)
+            {
+                close(fd);
+                return;
+            }
+            conn.tx_len = 0;
+        } while (msg_frame_length(conn.rx, conn.rx_len, FILE_MAX_FRAME) > 0);
+    }
+    close(fd);
+}
+
+static bool recv_all(int fd, uint8_t *buf, uint32_t len)
+{
+    while (len > 0)
+    {
+        ssize_t got = recv(fd, buf, len, 0);
+        if (got <= 0)
+        {
+            return false;
+        }
+        buf += got;
+        len -= got;
+    }
+    return true;
+}
+
+static bool recv_reply(int fd, Reply *reply)
+{
+    uint8_t frame[FILE_MAX_FRAME];
+    if (!recv_all(fd, frame, MSG_HEAD_SIZE))
+    {
+        return false;
+    }
+    int32_t len = msg_frame_length(frame, FILE_MAX_FRAME, FILE_MAX_FRAME);
+    if (len <= 0 || !recv_all(fd, frame + MSG_HEAD_SIZE, len - MSG_HEAD_SIZE))
+    {
+        return false;
+    }
+    *reply = parse_reply(frame, len);
+    return reply->valid;
+}
+
+// Uploads data with `window` requests in flight, returns the seconds it took
+static double upload(FileService &service, const Bytes &data, int window, int rtt_us, bool *ok)
+{
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    socklen_t addr_len = sizeof(addr);
+    bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr));
+    listen(listen_fd, 1);
+    getsockname(listen_fd, (struct sockaddr *)&addr, &addr_len);
+    std::thread server(serve_socket, listen_fd, &service, rtt_us);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    *ok = 0 == connect(fd, (struct sockaddr *)&addr, sizeof(addr));
+    int enable = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+    const uint32_t chunk = FILE_MAX_FRAME - 64;
+    uint32_t chunks = (data.size() + chunk - 1) / chunk;
+    uint32_t sent = 0, answered = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (*ok && answered < chunks)
+    {
+        while (sent < chunks && sent - answered < (uint32_t)window)
+        {
+            uint32_t offset = sent * chunk;
+            Bytes req = write_request("/bench.bin", offset, data.data() + offset,
+                                      std::min<uint32_t>(chunk, data.size() - offset), sent);
+            *ok = *ok && send(fd, req.data(), req.size(), 0) == (ssize_t)req.size();
+            ++sent;
+        }
+        Reply reply;
+        *ok = *ok && recv_reply(fd, &reply) && MSG_OK == reply.status && reply.tag == (uint16_t)answered;
+        ++answered;
+    }
+    double seconds = seconds_since(start);
+    close(fd);
+    server.join();
+    close(listen_fd);
+    return seconds;
+}
+
+static void bench(FileService &service, const std::string &root, std::mt19937 &rng, int rtt_us)
+{
+    Bytes data = random_bytes(rng, 512 * 1024);
+    bool ok_single, ok_pipelined;
+    double single = upload(service, data, 1, rtt_us, &ok_single);
+    double pipelined = upload(service, data, 8, rtt_us, &ok_pipelined);
+    check(ok_single && ok_pipelined && read_file(root + "/bench.bin") == data,
+          "uploads over a socket, one at a time and pipelined, arrive intact");
+    printf("      512 KB upload, simulated rtt %.1f ms: one request at a time %.0f KB/s, 8 in flight %.0f KB/s\n",
+           rtt_us / 1000.0, 512 / single, 512 / pipelined);
+
+    // Wire cost of one chunk: this protocol vs the multipart POST to /upload/chunk
+    const uint32_t chunk = FILE_MAX_FRAME - 64;
+    uint32_t binary = write_request("/picture/model.jpg", 0, data.data(), chunk).size() - chunk + MSG_HEAD_SIZE + 2 + 1 + 4;
+    char http[1024];
+    int http_len = snprintf(http, sizeof(http),
+                            "POST /upload/chunk?path=/picture/model.jpg&offset=0 HTTP/1.1\r\n"
+                            "Host: 192.168.1.100\r\nUser-Agent: python-requests/2.31.0\r\n"
+                            "Accept-Encoding: gzip, deflate\r\nAccept: */*\r\nConnection: keep-alive\r\n"
+                            "Content-Length: %u\r\n"
+                            "Content-Type: multipart/form-data; boundary=4c2b0c0f9c3e4a1fb6a0c4bb9f0e0d11\r\n\r\n"
+                            "--4c2b0c0f9c3e4a1fb6a0c4bb9f0e0d11\r\n"
+                            "Content-Disposition: form-data; name=\"data\"; filename=\"model.jpg\"\r\n\r\n"
+                            "\r\n--4c2b0c0f9c3e4a1fb6a0c4bb9f0e0d11--\r\n"
+                            "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: 0\r\n"
+                            "Connection: keep-alive\r\n\r\n",
+                            chunk + 160);
+    printf("      overhead per %u byte chunk (request + reply): %u bytes binary, %d bytes HTTP\n",
+           chunk, binary, http_len);
+    call(service, path_request(AT_FILE_REMOVE, "/bench.bin"));
+}
+
+int main(int argc, char **argv)
+{
+    double rtt_ms = argc > 1 ? atof(argv[1]) : 2.0;
+    SimCheckDir work;
+    if (!sim_check_dir("file_service_check", &work))
+    {
+        return 2;
+    }
+    // The card the service works on
+    const std::string &root = work.sd;
+    PosixBackend fs(root);
+    FileService service(&fs);
+    std::mt19937 rng(48);
+
+    check_codec();
+    check_actions(service, fs, root);
+    check_list(service);
+    check_pipeline(service, root, rng);
+    bench(service, root, rng, (int)(rtt_ms * 1000));
+
+    sim_check_remove(work);
+    if (failures)
+    {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
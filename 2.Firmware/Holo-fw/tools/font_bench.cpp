@@ -0,0 +1,163 @@
+// Measure the streamed font (driver/glyph_font.*) on the host.
+//
+// Loads a font written by font_pack.py through a stdio read callback and
+// replays text the way LVGL touches glyphs: a descriptor lookup per letter
+// while laying out, then descriptor + bitmap per letter while drawing. Text is
+// drawn from the font's own glyphs with a Zipf-like distribution (a few
+// characters dominate real labels). Reports the cache hit rate and file reads
+// per cache size, lookup time, RAM used and the flash the compiled-in font
+// would have taken.
+//
+//     python3 font_pack.py ../src/resource/font/ch_font_20.c ch_font_20.bin
+//     g++ -O2 -I../src/driver -o font_bench font_bench.cpp ../src/driver/glyph_font.cpp
+//     ./font_bench ch_font_20.bin [--letters 200000] [--label 8] [--redraw 4]
+//
+// --redraw is how often each label is drawn before the text changes (LVGL
+// redraws a label whenever an area over it is invalidated).
+
+#include "glyph_font.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+struct FileSource
+{
+    FILE *file;
+    uint32_t reads;
+    uint64_t bytes;
+};
+
+static bool file_read(void *ctx, uint32_t offset, void *buf, uint32_t len)
+{
+    FileSource *source = (FileSource *)ctx;
+    ++source->reads;
+    source->bytes += len;
+    return 0 == fseek(source->file, offset, SEEK_SET) && len == fread(buf, 1, len, source->file);
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = NULL;
+    int letters = 200000;
+    int label = 8; // letters per label
+    int redraw = 4;
+    for (int pos = 1; pos < argc; ++pos)
+    {
+        if (!strcmp(argv[pos], "--letters") && pos + 1 < argc)
+        {
+            letters = atoi(argv[++pos]);
+        }
+        else if (!strcmp(argv[pos], "--label") && pos + 1 < argc)
+        {
+            label = atoi(argv[++pos]);
+        }
+        else if (!strcmp(argv[pos], "--redraw") && pos + 1 < argc)
+        {
+            redraw = atoi(argv[++pos]);
+        }
+        else
+        {
+            path = argv[pos];
+        }
+    }
+    if (NULL == path || label < 1 || redraw < 1)
+    {
+        fprintf(stderr, "usage: %s font.bin [--letters n] [--label n] [--redraw n]\n", argv[0]);
+        return 2;
+    }
+    FileSource source = {fopen(path, "rb"), 0, 0};
+    if (NULL == source.file)
+    {
+        perror(path);
+        return 2;
+    }
+    fseek(source.file, 0, SEEK_END);
+    long file_size = ftell(source.file);
+
+    // Code points of the font, read straight from the index
+    GlyphFont probe;
+    if (!probe.open(file_read, &source, 1))
+    {
+        fprintf(stderr, "%s: not a font_pack.py font\n", path);
+        return 2;
+    }
+    const GlyphFontHeader header = probe.header();
+    std::vector<uint16_t> codes(header.count);
+    file_read(&source, GLYPH_FONT_HEADER_SIZE, codes.data(), header.count * 2);
+
+    // Zipf-like text, shuffled so frequent letters are spread over the range
+    std::mt19937 rng(1);
+    std::vector<uint16_t> by_rank = codes;
+    std::shuffle(by_rank.begin(), by_rank.end(), rng);
+    std::vector<double> weights(by_rank.size());
+    for (size_t rank = 0; rank < weights.size(); ++rank)
+    {
+        weights[rank] = 1.0 / (rank + 1);
+    }
+    std::discrete_distribution<int> pick(weights.begin(), weights.end());
+    std::vector<uint16_t> text(letters);
+    for (int pos = 0; pos < letters; ++pos)
+    {
+        text[pos] = by_rank[pick(rng)];
+    }
+
+    printf("%s: %d glyphs, %ld bytes on SD/flash\n", path, header.count, file_size);
+    // lv_font_fmt_txt: bitmaps + 8-byte glyph_dsc + 2-byte unicode_list
+    printf("compiled-in ch_font_20.c would take %ld bytes of app flash\n",
+           (long)(file_size - GLYPH_FONT_HEADER_SIZE));
+    printf("%d letters in labels of %d, each drawn %d times\n", letters, label, redraw);
+    printf("%6s %10s %8s %10s %10s %12s\n", "slots", "RAM", "hit %", "reads", "read KB", "ns/letter");
+
+    const uint16_t slot_sizes[] = {8, 16, 32, 64, 128};
+    for (uint16_t slots : slot_sizes)
+    {
+        GlyphFont font;
+        font.open(file_read, &source, slots);
+        source.reads = 0;
+        source.bytes = 0;
+        volatile uint32_t sink = 0;
+        auto begin = std::chrono::steady_clock::now();
+        for (int start = 0; start < letters; start += label)
+        {
+            int end = start + label < letters ? start + label : letters;
+            // Layout pass, then draw pass
+            for (int pos = start; pos < end; ++pos)
+            {
+                sink += font.glyph(text[pos])->adv_w;
+            }
+            for (int pass = 0; pass < redraw; ++pass)
+            {
+                for (int pos = start; pos < end; ++pos)
+                {
+                    sink += font.glyph(text[pos])->box_w;
+                    sink += font.bitmap(text[pos])[0];
+                }
+            }
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+        const GlyphCacheStats &stats = font.stats();
+        printf("%6u %10u %8.1f %10u %10.1f %12.1f\n", slots, font.ramUsage(),
+               100.0 * stats.hits / (stats.hits + stats.misses), source.reads,
+               source.bytes / 1024.0, ns / letters);
+    }
+
+    // Index lookup alone (binary search over the resident code point list)
+    auto begin = std::chrono::steady_clock::now();
+    volatile int found = 0;
+    for (int pos = 0; pos < letters; ++pos)
+    {
+        found += std::binary_search(codes.begin(), codes.end(), text[pos]);
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+    printf("index binary search: %.1f ns/letter (%d found)\n", ns / letters, (int)found);
+
+    fclose(source.file);
+    return 0;
+}
@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+"""Convert a font generated by Lvgl Font Tool (e.g. src/resource/font/ch_font_20.c)
+into the binary format read by driver/glyph_font.* and driver/lv_font_stream.*.
+
+Copy the output to the SD card and open it with
+lv_font_stream_open("S:/font/ch_font_20.bin").
+
+    python3 font_pack.py ../src/resource/font/ch_font_20.c ch_font_20.bin
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+MAGIC = 0x314E4648  # "HFN1"
+HEADER_FORMAT = "<IHBBbBHII"
+DSC_FORMAT = "<BBBBBBbb"  # 24-bit offset, adv_w, box_w, box_h, ofs_x, ofs_y
+
+DSC_RE = re.compile(
+    r"\{\s*\.bitmap_index\s*=\s*(\d+),\s*\.adv_w\s*=\s*(-?\d+),\s*\.box_h\s*=\s*(-?\d+),"
+    r"\s*\.box_w\s*=\s*(-?\d+),\s*\.ofs_x\s*=\s*(-?\d+),\s*\.ofs_y\s*=\s*(-?\d+)\s*\}")
+
+
+def array_body(source, name):
+    match = re.search(r"\b%s\[\]\s*=\s*\{" % re.escape(name), source)
+    if match is None:
+        sys.exit("font_pack: array %s not found" % name)
+    end = source.index("};", match.end())
+    return source[match.end():end]
+
+
+def strip_comments(text):
+    # One pass, leftmost first: the glyph previews start with "//*"
+    return re.sub(r"//[^\n]*|/\*.*?\*/", "", text, flags=re.S)
+
+
+def field(source, name):
+    match = re.search(r"\.%s\s*=\s*(-?\d+)" % name, source)
+    if match is None:
+        sys.exit("font_pack: field %s not found" % name)
+    return int(match.group(1))
+
+
+def parse(path):
+    with open(path, encoding="utf-8") as file:
+        source = file.read()
+    bitmap = bytes(int(value, 16) for value in
+                   re.findall(r"0x([0-9a-fA-F]{2})", strip_comments(array_body(source, "glyph_bitmap"))))
+    dscs = [tuple(int(value) for value in match.groups())
+            for match in DSC_RE.finditer(array_body(source, "glyph_dsc"))]
+    unicode_name = re.search(r"\.unicode_list\s*=\s*(\w+)", source).group(1)
+    unicodes = [int(value, 16) for value in
+                re.findall(r"0x([0-9a-fA-F]+)", strip_comments(array_body(source, unicode_name)))]
+    # The generator appends a 0x0000 terminator that is not part of list_length
+    unicodes = unicodes[:field(source, "list_length")]
+    if len(dscs) != len(unicodes):
+        sys.exit("font_pack: %d glyph descriptors but %d code points" % (len(dscs), len(unicodes)))
+    return {
+        "bitmap": bitmap,
+        "dscs": dscs,
+        "unicodes": unicodes,
+        "bpp": field(source, "bpp"),
+        "line_height": field(source, "line_height"),
+        "base_line": field(source, "base_line"),
+    }
+
+
+def pack(font):
+    bpp = font["bpp"]
+    glyphs = sorted(zip(font["unicodes"], font["dscs"]))
+    if glyphs[-1][0] > 0xFFFF:
+        sys.exit("font_pack: only code points up to U+FFFF are supported")
+    if len(set(code for code, _ in glyphs)) != len(glyphs):
+        sys.exit("font_pack: duplicate code points")
+
+    bitmaps = bytearray()
+    records = bytearray()
+    max_bitmap = 0
+    for code, (index, adv_w, box_h, box_w, ofs_x, ofs_y) in glyphs:
+        size = (box_w * bpp + 7) // 8 * box_h
+        data = font["bitmap"][index:index + size]
+        if len(data) != size:
+            sys.exit("font_pack: glyph U+%04X runs past the bitmap" % code)
+        offset = len(bitmaps)
+        bitmaps += data
+        max_bitmap = max(max_bitmap, size)
+        records += struct.pack(DSC_FORMAT, offset & 0xFF, (offset >> 8) & 0xFF, offset >> 16,
+                               adv_w, box_w, box_h, ofs_x, ofs_y)
+    if len(bitmaps) >= 1 << 24:
+        sys.exit("font_pack: bitmap data exceeds 16 MB")
+
+    header_size = struct.calcsize(HEADER_FORMAT)
+    index = struct.pack("<%dH" % len(glyphs), *(code for code, _ in glyphs))
+    dsc_offset = header_size + len(index)
+    bitmap_offset = dsc_offset + len(records)
+    header = struct.pack(HEADER_FORMAT, MAGIC, len(glyphs), bpp, font["line_height"],
+                         font["base_line"], 0, max_bitmap, dsc_offset, bitmap_offset)
+    return header + index + records + bytes(bitmaps), max_bitmap
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("source", help="font .c file generated by Lvgl Font Tool")
+    parser.add_argument("output", help="binary font file to write")
+    args = parser.parse_args()
+
+    font = parse(args.source)
+    data, max_bitmap = pack(font)
+    with open(args.output, "wb") as file:
+        file.write(data)
+    count = len(font["unicodes"])
+    print("%s: %d glyphs, %d bpp, %d bytes (bitmaps %d, index %d), largest glyph %d bytes"
+          % (args.output, count, font["bpp"], len(data), len(font["bitmap"]), count * 2, max_bitmap))
+
+
+if __name__ == "__main__":
+    main()
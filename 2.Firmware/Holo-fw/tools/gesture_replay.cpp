@@ -0,0 +1,256 @@
+// Replay recorded IMU traces through the on-device gesture recognizer.
+//
+// Record a trace by building the firmware with IMU_TRACE defined (driver/imu.h)
+// and saving the serial output. Every sample is logged as
+//     imu,<ms>,<ax>,<ay>,<az>,<gx>,<gy>,<gz>
+// Then annotate the gestures actually performed with lines such as
+//     label,<ms>,TURN_LEFT
+// where <ms> is when the movement started. Any other lines are ignored, so the
+// firmware's own "event,..." lines can stay in the file.
+//
+// For every label the first recognized event of the same type within
+// --window ms is a hit; its latency is event time - label time, less
+// GESTURE_HOLD_MS for the long presses (GO_FORWORD, RETURN), which wait for
+// it by design. Events that match no label (other than the periodic repeats
+// of a held tilt) are reported as false positives.
+//
+// Exits non-zero when the accuracy over all traces is below --min-accuracy
+// percent, the slowest hit takes longer than --max-latency ms, or there are
+// more false positives than --max-unexpected percent of the labels.
+// gesture_traces/ holds labelled traces of every gesture and of handling
+// that is no gesture; run them after changing the recognizer or its
+// thresholds (driver/gesture.h).
+//
+//     g++ -O2 -I../src/driver -o gesture_replay gesture_replay.cpp ../src/driver/gesture.cpp
+//     ./gesture_replay [--window 800] [--min-accuracy 95] [--max-latency 550] [--max-unexpected 5] [-v]
+//                      gesture_traces/*.log
+
+#include "gesture.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+struct Mark
+{
+    uint32_t ms;
+    ACTIVE_TYPE type;
+    bool matched;
+};
+
+struct Totals
+{
+    int labels = 0;
+    int hits = 0;
+    int events = 0;
+    int false_events = 0;
+    std::vector<uint32_t> latency;
+};
+
+static ACTIVE_TYPE parse_type(const char *name)
+{
+    for (int type = 0; type < UNKNOWN; ++type)
+    {
+        if (!strcmp(name, active_type_info[type]))
+        {
+            return (ACTIVE_TYPE)type;
+        }
+    }
+    return UNKNOWN;
+}
+
+// Delay that a gesture has by design, not counted as latency
+static uint32_t designed_delay(ACTIVE_TYPE type)
+{
+    return GO_FORWORD == type || RETURN == type ? GESTURE_HOLD_MS : 0;
+}
+
+static bool replay(const char *path, uint32_t window, bool verbose, Totals *totals)
+{
+    FILE *file = fopen(path, "r");
+    if (NULL == file)
+    {
+        perror(path);
+        return false;
+    }
+
+    GestureRecognizer recognizer;
+    std::vector<Mark> labels;
+    std::vector<Mark> events;
+    char line[256];
+    while (fgets(line, sizeof(line), file))
+    {
+        unsigned ms;
+        int ax, ay, az, gx, gy, gz;
+        char name[32];
+        if (7 == sscanf(line, "imu,%u,%d,%d,%d,%d,%d,%d", &ms, &ax, &ay, &az, &gx, &gy, &gz))
+        {
+            GestureSample sample = {ms, (int16_t)ax, (int16_t)ay, (int16_t)az,
+                                    (int16_t)gx, (int16_t)gy, (int16_t)gz};
+            ACTIVE_TYPE type = recognizer.feed(sample);
+            if (UNKNOWN != type)
+            {
+                events.push_back({ms, type, false});
+            }
+        }
+        else if (2 == sscanf(line, "label,%u,%31[A-Z_]", &ms, name))
+        {
+            ACTIVE_TYPE type = parse_type(name);
+            if (UNKNOWN == type)
+            {
+                fprintf(stderr, "%s: unknown gesture %s\n", path, name);
+                continue;
+            }
+            labels.push_back({ms, type, false});
+        }
+    }
+    fclose(file);
+
+    int hits = 0;
+    for (Mark &label : labels)
+    {
+        for (Mark &event : events)
+        {
+            if (!event.matched && event.type == label.type &&
+                event.ms >= label.ms && event.ms - label.ms <= window)
+            {
+                uint32_t delay = designed_delay(label.type);
+                uint32_t latency = event.ms - label.ms > delay ? event.ms - label.ms - delay : 0;
+                event.matched = label.matched = true;
+                totals->latency.push_back(latency);
+                ++hits;
+                if (verbose)
+                {
+                    printf("  %8u %-10s hit  +%u ms\n", label.ms, active_type_info[label.type], latency);
+                }
+                break;
+            }
+        }
+        if (verbose && !label.matched)
+        {
+            printf("  %8u %-10s MISSED\n", label.ms, active_type_info[label.type]);
+        }
+    }
+    int false_events = 0;
+    for (size_t pos = 0; pos < events.size(); ++pos)
+    {
+        const Mark &event = events[pos];
+        // 保持左右倾斜时的重复上报不算误识别
+        bool repeat = pos > 0 && events[pos - 1].type == event.type &&
+                      event.ms - events[pos - 1].ms <= GESTURE_REPEAT_MS + GESTURE_SAMPLE_PERIOD;
+        if (repeat)
+        {
+            events[pos].matched = true;
+        }
+        else if (!event.matched)
+        {
+            ++false_events;
+            if (verbose)
+            {
+                printf("  %8u %-10s unexpected\n", event.ms, active_type_info[event.type]);
+            }
+        }
+    }
+
+    printf("%s: %d/%zu gestures recognized, %d unexpected events\n",
+           path, hits, labels.size(), false_events);
+    totals->labels += labels.size();
+    totals->hits += hits;
+    totals->events += events.size();
+    totals->false_events += false_events;
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t window = 800;
+    double min_accuracy = 95;
+    uint32_t max_latency = 550; // a shake waits for GESTURE_SHAKE_SWINGS reversals
+    double max_unexpected = 5;
+    bool verbose = false;
+    std::vector<const char *> paths;
+    for (int pos = 1; pos < argc; ++pos)
+    {
+        if (!strcmp(argv[pos], "--window") && pos + 1 < argc)
+        {
+            window = strtoul(argv[++pos], NULL, 10);
+        }
+        else if (!strcmp(argv[pos], "--min-accuracy") && pos + 1 < argc)
+        {
+            min_accuracy = atof(argv[++pos]);
+        }
+        else if (!strcmp(argv[pos], "--max-latency") && pos + 1 < argc)
+        {
+            max_latency = strtoul(argv[++pos], NULL, 10);
+        }
+        else if (!strcmp(argv[pos], "--max-unexpected") && pos + 1 < argc)
+        {
+            max_unexpected = atof(argv[++pos]);
+        }
+        else if (!strcmp(argv[pos], "-v"))
+        {
+            verbose = true;
+        }
+        else
+        {
+            paths.push_back(argv[pos]);
+        }
+    }
+    if (paths.empty())
+    {
+        fprintf(stderr,
+                "usage: %s [--window ms] [--min-accuracy %%] [--max-latency ms] [--max-unexpected %%] [-v] "
+                "trace.log...\n",
+                argv[0]);
+        return 2;
+    }
+
+    Totals totals;
+    for (const char *path : paths)
+    {
+        if (!replay(path, window, verbose, &totals))
+        {
+            return 2;
+        }
+    }
+
+    double accuracy = totals.labels ? 100.0 * totals.hits / totals.labels : 0.0;
+    double unexpected = totals.labels ? 100.0 * totals.false_events / totals.labels : 0.0;
+    printf("accuracy %.1f%% (%d/%d), %d of %d events unexpected\n", accuracy, totals.hits, totals.labels,
+           totals.false_events, totals.events);
+    uint32_t slowest = 0;
+    if (!totals.latency.empty())
+    {
+        std::vector<uint32_t> &lat = totals.latency;
+        std::sort(lat.begin(), lat.end());
+        unsigned long sum = 0;
+        for (uint32_t value : lat)
+        {
+            sum += value;
+        }
+        slowest = lat.back();
+        printf("latency ms: avg %.1f  p50 %u  p95 %u  max %u\n", (double)sum / lat.size(),
+               lat[lat.size() / 2], lat[lat.size() * 95 / 100], lat.back());
+    }
+
+    int failures = 0;
+    if (0 == totals.labels || accuracy < min_accuracy)
+    {
+        printf("FAIL  accuracy %.1f%% is below %.1f%%\n", accuracy, min_accuracy);
+        ++failures;
+    }
+    if (slowest > max_latency)
+    {
+        printf("FAIL  latency %u ms is above %u ms\n", slowest, max_latency);
+        ++failures;
+    }
+    if (unexpected > max_unexpected)
+    {
+        printf("FAIL  %.1f%% unexpected events is above %.1f%%\n", unexpected, max_unexpected);
+        ++failures;
+    }
+    return failures ? 1 : 0;
+}
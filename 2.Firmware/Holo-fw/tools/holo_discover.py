@@ -0,0 +1,68 @@
+#!/usr/bin/env python3
+"""Find Holo devices on the local network.
+
+Broadcasts one UDP probe and prints every device that answers within the
+timeout. Each answer is a single JSON packet, see HoloWebAPI.md.
+
+    python3 holo_discover.py [--timeout 1.0] [--address 255.255.255.255] [--json]
+"""
+
+import argparse
+import json
+import socket
+import time
+
+DISCOVERY_PORT = 50505
+DISCOVERY_PROBE = b"HOLO?"
+
+
+def discover(address="255.255.255.255", port=DISCOVERY_PORT, timeout=1.0):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_BROADCAST, 1)
+    sock.bind(("", 0))
+    devices = {}
+    try:
+        sock.sendto(DISCOVERY_PROBE, (address, port))
+        deadline = time.monotonic() + timeout
+        while True:
+            left = deadline - time.monotonic()
+            if left <= 0:
+                break
+            sock.settimeout(left)
+            try:
+                data, peer = sock.recvfrom(1024)
+            except socket.timeout:
+                break
+            try:
+                info = json.loads(data.decode("utf-8"))
+            except ValueError:
+                continue
+            info.setdefault("ip", peer[0])
+            devices[peer[0]] = info
+    finally:
+        sock.close()
+    return list(devices.values())
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--address", default="255.255.255.255",
+                        help="broadcast (or unicast) address to probe")
+    parser.add_argument("--port", type=int, default=DISCOVERY_PORT)
+    parser.add_argument("--timeout", type=float, default=1.0,
+                        help="seconds to wait for answers")
+    parser.add_argument("--json", action="store_true", help="print raw JSON")
+    args = parser.parse_args()
+
+    devices = discover(args.address, args.port, args.timeout)
+    if args.json:
+        print(json.dumps(devices, indent=2))
+        return
+    for dev in devices:
+        print("{ip:<15}  {name:<20}  v{version:<8}  free {free_kb} KB  gen {gen}".format(**dev))
+    if not devices:
+        print("no device found")
+
+
+if __name__ == "__main__":
+    main()
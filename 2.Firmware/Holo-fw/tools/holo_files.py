@@ -0,0 +1,285 @@
+#!/usr/bin/env python3
+"""Manage files on a Holo's SD card over the binary file protocol (port 8082).
+
+The protocol is described in src/file_service.h: every request is a MsgHead
+frame with a tag, and the device answers in order. Requests are pipelined, up
+to --window in flight, so a transfer is not limited to one chunk per round
+trip. "bench" uploads and downloads the same file over this protocol and over
+the HTTP server (/edit, /list) for comparison.
+
+    python3 holo_files.py 192.168.1.133 ls /
+    python3 holo_files.py 192.168.1.133 put model.jpg /picture/model.jpg
+    python3 holo_files.py 192.168.1.133 get /picture/model.jpg model.jpg
+    python3 holo_files.py 192.168.1.133 mkdir /picture/new
+    python3 holo_files.py 192.168.1.133 mv /picture/a.jpg /picture/b.jpg
+    python3 holo_files.py 192.168.1.133 rm /picture/new
+    python3 holo_files.py 192.168.1.133 bench 1048576
+"""
+
+import argparse
+import http.client
+import os
+import socket
+import struct
+import sys
+import time
+import uuid
+
+FILE_SERVER_PORT = 8082
+HTTP_PORT = 80
+HEADER_MARK = 0x2323
+HEAD_FORMAT = ">HHBBB"
+HEAD_SIZE = struct.calcsize(HEAD_FORMAT)
+MAX_FRAME = 4096
+CHUNK = MAX_FRAME - 64  # room for the header, tag and path
+LIST_END = 0xFFFFFFFF
+
+MODULE_CUBIC_FILE_MANAGER = 1
+MODULE_C_FILE_MANAGER = 2
+
+AT_FREE_STATUS = 1
+AT_DIR_CREATE = 2
+AT_DIR_REMOVE = 3
+AT_DIR_RENAME = 4
+AT_DIR_LIST = 5
+AT_FILE_CREATE = 6
+AT_FILE_WRITE = 7
+AT_FILE_READ = 8
+AT_FILE_REMOVE = 9
+AT_FILE_RENAME = 10
+AT_FILE_GET_INFO = 11
+
+STATUS_NAMES = ["ok", "bad request", "unsupported", "not found", "exists", "not a directory",
+                "offset mismatch", "I/O error"]
+STATUS_OFFSET = 6
+ENTRY_FILE = 1
+ENTRY_DIR = 2
+
+
+def pack_str(value):
+    data = value.encode("utf-8") + b"\0"
+    return struct.pack(">H", len(data)) + data
+
+
+class FileError(Exception):
+    def __init__(self, status, what):
+        name = STATUS_NAMES[status] if status < len(STATUS_NAMES) else "status %d" % status
+        super().__init__("%s: %s" % (what, name))
+        self.status = status
+
+
+class FileClient:
+    def __init__(self, host, port=FILE_SERVER_PORT, window=8):
+        self.sock = socket.create_connection((host, port), timeout=10)
+        self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        self.window = window
+        self.tag = 0
+        self.rx = b""
+
+    def send(self, action, fields=b""):
+        self.tag = (self.tag + 1) & 0xFFFF
+        body = struct.pack(">H", self.tag) + fields
+        head = struct.pack(HEAD_FORMAT, HEADER_MARK, HEAD_SIZE + len(body),
+                           MODULE_CUBIC_FILE_MANAGER, MODULE_C_FILE_MANAGER, action)
+        self.sock.sendall(head + body)
+        return self.tag
+
+    def receive(self, tag):
+        """Reads the next reply, which must answer `tag`; returns (status, fields)."""
+        while True:
+            if len(self.rx) >= HEAD_SIZE:
+                mark, length, _, _, _ = struct.unpack(HEAD_FORMAT, self.rx[:HEAD_SIZE])
+                if mark != HEADER_MARK or length < HEAD_SIZE + 3:
+                    raise IOError("bad reply header")
+                if len(self.rx) >= length:
+                    frame, self.rx = self.rx[:length], self.rx[length:]
+                    got, status = struct.unpack(">HB", frame[HEAD_SIZE:HEAD_SIZE + 3])
+                    if got != tag:
+                        raise IOError("reply %d out of order, expected %d" % (got, tag))
+                    return status, frame[HEAD_SIZE + 3:]
+            data = self.sock.recv(65536)
+            if not data:
+                raise IOError("connection closed")
+            self.rx += data
+
+    def call(self, action, fields, what):
+        status, reply = self.receive(self.send(action, fields))
+        if status:
+            raise FileError(status, what)
+        return reply
+
+    def ping(self):
+        self.call(AT_FREE_STATUS, b"", "ping")
+
+    def info(self, path):
+        kind, size = struct.unpack(">BI", self.call(AT_FILE_GET_INFO, pack_str(path), path))
+        return kind, size
+
+    def listdir(self, path):
+        entries = []
+        offset = 0
+        while offset != LIST_END:
+            reply = self.call(AT_DIR_LIST, pack_str(path) + struct.pack(">IH", offset, 0xFFFF), path)
+            count, offset = struct.unpack(">HI", reply[:6])
+            pos = 6
+            for _ in range(count):
+                kind, size, name_len = struct.unpack(">BIH", reply[pos:pos + 7])
+                name = reply[pos + 7:pos + 7 + name_len - 1].decode("utf-8", "replace")
+                entries.append((name, kind, size))
+                pos += 7 + name_len
+        return entries
+
+    def mkdir(self, path):
+        self.call(AT_DIR_CREATE, pack_str(path), path)
+
+    def remove(self, path):
+        kind, _ = self.info(path)
+        self.call(AT_DIR_REMOVE if kind == ENTRY_DIR else AT_FILE_REMOVE, pack_str(path), path)
+
+    def rename(self, src, dst):
+        self.call(AT_FILE_RENAME, pack_str(src) + pack_str(dst), src)
+
+    def put(self, path, data, resume=False):
+        """Writes data with up to `window` chunks in flight, resuming where the file ends."""
+        start = 0
+        if resume:
+            try:
+                kind, size = self.info(path)
+                if kind == ENTRY_FILE and size <= len(data):
+                    start = size
+            except FileError:
+                pass
+        if not data:
+            self.call(AT_FILE_CREATE, pack_str(path), path)
+            return
+        path_field = pack_str(path)
+        pending = []
+        offset = start
+        while offset < len(data) or pending:
+            while offset < len(data) and len(pending) < self.window:
+                chunk = data[offset:offset + CHUNK]
+                pending.append(self.send(AT_FILE_WRITE, path_field + struct.pack(">I", offset) + chunk))
+                offset += len(chunk)
+            status, _ = self.receive(pending.pop(0))
+            if status:
+                raise FileError(status, path)
+
+    def get(self, path):
+        _, size = self.info(path)
+        path_field = pack_str(path)
+        chunks = []
+        pending = []
+        offset = 0
+        while offset < size or pending:
+            while offset < size and len(pending) < self.window:
+                pending.append(self.send(AT_FILE_READ, path_field + struct.pack(">IH", offset, CHUNK)))
+                offset += CHUNK
+            status, data = self.receive(pending.pop(0))
+            if status:
+                raise FileError(status, path)
+            chunks.append(data)
+        return b"".join(chunks)
+
+    def close(self):
+        self.sock.close()
+
+
+def http_upload(host, path, data):
+    boundary = uuid.uuid4().hex
+    body = (("--%s\r\nContent-Disposition: form-data; name=\"data\"; filename=\"%s\"\r\n"
+             "Content-Type: application/octet-stream\r\n\r\n" % (boundary, path)).encode("utf-8") +
+            data + ("\r\n--%s--\r\n" % boundary).encode("utf-8"))
+    conn = http.client.HTTPConnection(host, HTTP_PORT, timeout=30)
+    conn.request("POST", "/edit", body, {"Content-Type": "multipart/form-data; boundary=" + boundary})
+    response = conn.getresponse()
+    response.read()
+    conn.close()
+    if response.status != 200:
+        raise IOError("HTTP upload failed: %d" % response.status)
+
+
+def http_list(host, path):
+    conn = http.client.HTTPConnection(host, HTTP_PORT, timeout=30)
+    conn.request("GET", "/list?dir=" + path)
+    response = conn.getresponse()
+    body = response.read()
+    conn.close()
+    return len(body)
+
+
+def timed(fn):
+    start = time.monotonic()
+    result = fn()
+    return time.monotonic() - start, result
+
+
+def bench(client, host, size):
+    data = os.urandom(size)
+    path = "/holo_files_bench.bin"
+    kb = size / 1024.0
+
+    elapsed, _ = timed(lambda: [client.ping() for _ in range(100)])
+    print("ping:                 %.2f ms per request" % (elapsed * 10))
+    for window in (1, client.window):
+        client.window = window
+        elapsed, _ = timed(lambda: client.put(path, data))
+        print("binary put, window %d: %.0f KB/s" % (window, kb / elapsed))
+        elapsed, back = timed(lambda: client.get(path))
+        print("binary get, window %d: %.0f KB/s%s" % (window, kb / elapsed, "" if back == data else " (MISMATCH)"))
+    elapsed, _ = timed(lambda: http_upload(host, path, data))
+    print("HTTP /edit upload:    %.0f KB/s" % (kb / elapsed))
+
+    elapsed, entries = timed(lambda: client.listdir("/"))
+    print("binary list /:        %.1f ms, %d entries" % (elapsed * 1000, len(entries)))
+    elapsed, length = timed(lambda: http_list(host, "/"))
+    print("HTTP /list /:         %.1f ms, %d bytes" % (elapsed * 1000, length))
+    client.remove(path)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("host")
+    parser.add_argument("command", choices=["ping", "ls", "mkdir", "rm", "mv", "get", "put", "bench"])
+    parser.add_argument("args", nargs="*")
+    parser.add_argument("--port", type=int, default=FILE_SERVER_PORT)
+    parser.add_argument("--window", type=int, default=8, help="requests in flight (default: %(default)s)")
+    parser.add_argument("--resume", action="store_true", help="put: continue a partial upload")
+    args = parser.parse_args()
+
+    needed = {"ping": 0, "ls": 1, "mkdir": 1, "rm": 1, "mv": 2, "get": 2, "put": 2, "bench": 1}[args.command]
+    if len(args.args) != needed:
+        parser.error("%s takes %d argument(s)" % (args.command, needed))
+    client = FileClient(args.host, args.port, args.window)
+    try:
+        if args.command == "ping":
+            elapsed, _ = timed(client.ping)
+            print("pong in %.1f ms" % (elapsed * 1000))
+        elif args.command == "ls":
+            for name, kind, size in client.listdir(args.args[0]):
+                print("%s %10d  %s" % ("d" if kind == ENTRY_DIR else "-", size, name))
+        elif args.command == "mkdir":
+            client.mkdir(args.args[0])
+        elif args.command == "rm":
+            client.remove(args.args[0])
+        elif args.command == "mv":
+            client.rename(args.args[0], args.args[1])
+        elif args.command == "get":
+            elapsed, data = timed(lambda: client.get(args.args[0]))
+            with open(args.args[1], "wb") as file:
+                file.write(data)
+            print("%d bytes in %.2f s" % (len(data), elapsed))
+        elif args.command == "put":
+            with open(args.args[0], "rb") as file:
+                data = file.read()
+            elapsed, _ = timed(lambda: client.put(args.args[1], data, args.resume))
+            print("%d bytes in %.2f s" % (len(data), elapsed))
+        else:
+            bench(client, args.host, int(args.args[0]))
+    except FileError as error:
+        sys.exit("holo_files: %s" % error)
+    finally:
+        client.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+"""Stream JPEG frames to a Holo for live preview (no SD card involved).
+
+Frames are taken from an .mjpeg file (concatenated JPEGs) or a list of .jpg
+files and sent over TCP at a fixed rate. At most --window frames are in
+flight; the device acknowledges every frame as shown or dropped, which gives
+the end-to-end latency (send -> decoded on screen) printed at the end.
+
+    python3 holo_live.py 192.168.1.133 preview.mjpeg [--fps 25] [--loop]
+"""
+
+import argparse
+import socket
+import struct
+import threading
+import time
+
+LIVE_STREAM_PORT = 8081
+FRAME_MAGIC = b"HLV1"
+ACK_FORMAT = "<III"
+ACK_SIZE = struct.calcsize(ACK_FORMAT)
+ACK_SHOWN = 0
+
+
+def split_mjpeg(data):
+    frames = []
+    pos = 0
+    while True:
+        start = data.find(b"\xff\xd8", pos)
+        if start < 0:
+            break
+        end = data.find(b"\xff\xd9", start)
+        if end < 0:
+            break
+        frames.append(data[start:end + 2])
+        pos = end + 2
+    return frames
+
+
+def load_frames(paths):
+    frames = []
+    for path in paths:
+        with open(path, "rb") as f:
+            data = f.read()
+        if path.lower().endswith(".mjpeg"):
+            frames.extend(split_mjpeg(data))
+        else:
+            frames.append(data)
+    return frames
+
+
+def now_ms():
+    return int(time.monotonic() * 1000) & 0xFFFFFFFF
+
+
+class LiveSender:
+    def __init__(self, host, port, window):
+        self.sock = socket.create_connection((host, port))
+        self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        self.credits = threading.Semaphore(window)
+        self.latency = []
+        self.dropped = 0
+        self.reader = threading.Thread(target=self._read_acks, daemon=True)
+        self.reader.start()
+
+    def _read_acks(self):
+        buf = b""
+        while True:
+            try:
+                data = self.sock.recv(4096)
+            except OSError:
+                return
+            if not data:
+                return
+            buf += data
+            while len(buf) >= ACK_SIZE:
+                _seq, ts, status = struct.unpack_from(ACK_FORMAT, buf)
+                buf = buf[ACK_SIZE:]
+                if status == ACK_SHOWN:
+                    self.latency.append((now_ms() - ts) & 0xFFFFFFFF)
+                else:
+                    self.dropped += 1
+                self.credits.release()
+
+    def send(self, seq, frame, timeout):
+        # 在途帧数达到窗口上限时等待确认；超时视为确认丢失，继续发送
+        self.credits.acquire(timeout=timeout)
+        head = FRAME_MAGIC + struct.pack("<III", len(frame), seq, now_ms())
+        self.sock.sendall(head + frame)
+
+    def close(self, linger):
+        time.sleep(linger)
+        self.sock.close()
+
+
+def report(sender, sent, elapsed):
+    lat = sorted(sender.latency)
+    print("sent {} frames in {:.1f}s, shown {}, dropped {}".format(
+        sent, elapsed, len(lat), sender.dropped))
+    if lat:
+        print("latency ms: avg {:.1f}  p50 {}  p95 {}  max {}".format(
+            sum(lat) / len(lat), lat[len(lat) // 2], lat[int(len(lat) * 0.95)], lat[-1]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("host")
+    parser.add_argument("files", nargs="+", help=".mjpeg or .jpg files")
+    parser.add_argument("--port", type=int, default=LIVE_STREAM_PORT)
+    parser.add_argument("--fps", type=float, default=25.0)
+    parser.add_argument("--window", type=int, default=3,
+                        help="frames in flight before waiting for an ack")
+    parser.add_argument("--loop", action="store_true", help="repeat forever")
+    args = parser.parse_args()
+
+    frames = load_frames(args.files)
+    if not frames:
+        raise SystemExit("no JPEG frames found")
+
+    sender = LiveSender(args.host, args.port, args.window)
+    interval = 1.0 / args.fps
+    seq = 0
+    start = time.monotonic()
+    try:
+        while True:
+            for frame in frames:
+                sender.send(seq, frame, timeout=1.0)
+                seq += 1
+                next_time = start + seq * interval
+                delay = next_time - time.monotonic()
+                if delay > 0:
+                    time.sleep(delay)
+            if not args.loop:
+                break
+    except KeyboardInterrupt:
+        pass
+    elapsed = time.monotonic() - start
+    sender.close(linger=0.5)
+    report(sender, seq, elapsed)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,133 @@
+// Host check that only the I2C bus task talks to the bus (driver/i2c_bus.*), on the simulator (sim/).
+//
+// The MPU6050 and the BH1750 share one I2C bus. Once i2c_bus_begin() has
+// started the bus task, a transfer from the loop task would interleave with
+// the bus task's and corrupt both. The simulator counts every register access
+// and FIFO read together with the task that made it. Boots the firmware with
+// the MPU6050 answering and with it missing, each in a child process of its
+// own, runs loop() until the IMU stage has started the bus task and for
+// CHECK_LOOP_MS after, and checks:
+//   - after setup() the loop task makes no I2C transfer at all, with or
+//     without the IMU, while the IMU is still being set up in the background
+//     or once the bus task runs; without it, getAction() and update() do not
+//     poll the bus
+//   - the bus task keeps reading the light sensor (and the IMU's FIFO)
+// Exits non-zero when a check fails.
+//
+//     pio run -e i2c_bus_check
+//     .pio/build/i2c_bus_check/program [--partitions CSV]
+
+#include "Arduino.h"
+#include "sim.h"
+#include "sim_check.h"
+#include "common.h"
+#include "driver/i2c_bus.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <string>
+
+#define CHECK_LOOP_MS 2000
+#define CHECK_BUS_TIMEOUT_MS 10000 // the IMU stage gives up on a missing MPU6050 after 5 s
+
+// Runs in the child: boots, runs the loop and checks the traffic
+static void boot_child(const SimOptions &options, const char *name)
+{
+    if (!sim_begin(&options))
+    {
+        printf("FAIL  %s: the simulator starts\n", name);
+        fflush(stdout);
+        _exit(1);
+    }
+    sim_set_loop_task();
+    setup();
+    // The IMU stage runs in the background and starts the bus task when done
+    SimI2cStats booted;
+    sim_i2c_stats(&booted);
+    unsigned long start = millis();
+    while (!i2c_bus_running() && millis() - start < CHECK_BUS_TIMEOUT_MS)
+    {
+        loop();
+        mpu.update(0); // the polling API goes through the same guard
+    }
+    SimI2cStats started;
+    sim_i2c_stats(&started);
+    start = millis();
+    while (millis() - start < CHECK_LOOP_MS)
+    {
+        loop();
+        mpu.update(0);
+    }
+    SimI2cStats ran;
+    sim_i2c_stats(&ran);
+    printf("      %-12s %u transfers in %d ms with the bus task running, %u on the loop task after setup()\n", name,
+           (unsigned)(ran.transfers - started.transfers), CHECK_LOOP_MS,
+           (unsigned)(ran.loop_transfers - booted.loop_transfers));
+
+    char what[160];
+    snprintf(what, sizeof(what), "%s: the bus task starts", name);
+    check(i2c_bus_running(), what);
+    snprintf(what, sizeof(what), "%s: the loop task makes no I2C transfer after setup()", name);
+    check(ran.loop_transfers == booted.loop_transfers, what);
+    snprintf(what, sizeof(what), "%s: the bus task keeps reading", name);
+    check(ran.transfers > started.transfers, what);
+    fflush(stdout);
+    _exit(failures);
+}
+
+static void boot(const SimOptions &options, const char *name)
+{
+    fflush(stdout);
+    pid_t pid = fork();
+    if (0 == pid)
+    {
+        failures = 0;
+        boot_child(options, name);
+    }
+    int status = 0;
+    if (pid < 0 || pid != waitpid(pid, &status, 0) || !WIFEXITED(status))
+    {
+        printf("FAIL  %s: the firmware boots\n", name);
+        ++failures;
+        return;
+    }
+    failures += WEXITSTATUS(status);
+}
+
+int main(int argc, char **argv)
+{
+    SimOptions options;
+    sim_default_options(&options);
+    options.quiet = true;
+    for (int pos = 1; pos < argc; ++pos)
+    {
+        if (!strcmp(argv[pos], "--partitions") && pos + 1 < argc)
+        {
+            options.partitions = argv[++pos];
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--partitions CSV]\n", argv[0]);
+            return 2;
+        }
+    }
+    SimCheckDir work;
+    if (!sim_check_dir("i2c_bus_check", &work, &options))
+    {
+        return 2;
+    }
+    // Each boot listens on the same ports again; keep them apart from other checks
+    options.port_offset = 9100;
+
+    boot(options, "with IMU");
+    options.imu_absent = true;
+    boot(options, "without IMU");
+
+    sim_check_remove(work);
+    printf(failures ? "i2c bus check FAILED (%d)\n" : "i2c bus check passed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,269 @@
+// Host checks for the MPU6050 calibration kept in the settings (driver/imu.*) on the simulator (sim/).
+//
+// The simulated gyro has a bias that drifts with the die temperature, which
+// the offset registers cancel 4 LSB per step as on the chip. Each boot runs
+// in a child process of its own on the same flash, in virtual time: the
+// settings are opened, IMU::init() decides between the stored calibration
+// and a full one, and the device then lies still while the FIFO is read as
+// the I2C bus task would and getAction() runs as the loop would.
+//   - the first boot calibrates fully and stores the offsets and temperature
+//   - a boot a few degrees warmer reuses them; the drift this leaves is taken
+//     out in the background by offset -= (bias +-2) / 4, which must bring the
+//     residual within +-2 LSB in one window and then leave the offsets alone,
+//     and the new offsets reach flash after IMU_CALI_SAVE_INTERVAL
+//   - a boot more than IMU_CALI_TEMP_DELTA away calibrates fully again
+//   - a stored calibration older than IMU_CALI_MAX_AGE, or dated in the
+//     future, is calibrated again; one from yesterday or dated in seconds
+//     since boot (clock not synced when it was saved) is reused
+// A boot tells reuse from a full calibration by the stored offsets, which are
+// moved before it: reuse keeps them, a full calibration replaces them.
+// Exits non-zero when a check fails.
+//
+//     pio run -e imu_calibration_check
+//     .pio/build/imu_calibration_check/program [--partitions CSV]
+
+#include "Arduino.h"
+#include "sim.h"
+#include "sim_check.h"
+#include "driver/imu.h"
+#include "sys/settings.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <functional>
+#include <string>
+
+#define CHECK_BASE_C 30.0f
+#define CHECK_STEP_MS (IMU_FIFO_BURST * GESTURE_SAMPLE_PERIOD) // the bus task's FIFO period
+// One background window: IMU_RECAL_SAMPLES samples, every IMU_RECAL_DECIMATION-th of the FIFO
+#define CHECK_WINDOW_MS (IMU_RECAL_SAMPLES * IMU_RECAL_DECIMATION * GESTURE_SAMPLE_PERIOD)
+#define CHECK_MOVED_OFFSET 5 // added to the stored x gyro offset before a boot
+#define CHECK_DAY (24UL * 3600)
+
+static const float bias_at_base[3] = {37, -23, 10}; // raw LSB at CHECK_BASE_C
+static const float drift[3] = {3, -2, 1};           // LSB per degree
+
+static void set_sensor(float celsius)
+{
+    float bias[3];
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        bias[axis] = bias_at_base[axis] + drift[axis] * (celsius - CHECK_BASE_C);
+    }
+    sim_imu_sensor(bias, celsius);
+}
+
+struct Stored
+{
+    int32_t gyro[3];
+    int32_t temp;
+    uint32_t time;
+};
+
+static Stored stored()
+{
+    Stored cfg;
+    cfg.gyro[0] = settings_get_i32(IMU_CALI_PREFIX "x_gyro", 0);
+    cfg.gyro[1] = settings_get_i32(IMU_CALI_PREFIX "y_gyro", 0);
+    cfg.gyro[2] = settings_get_i32(IMU_CALI_PREFIX "z_gyro", 0);
+    cfg.temp = settings_get_i32(IMU_CALI_PREFIX "temp", 0);
+    cfg.time = settings_get_u32(IMU_CALI_PREFIX "time", 0);
+    return cfg;
+}
+
+// Lets the device lie still for `ms`: the bus task's FIFO reads and a loop()
+static void lie_still(IMU &imu, uint32_t ms)
+{
+    for (uint32_t done = 0; done < ms; done += CHECK_STEP_MS)
+    {
+        delay(CHECK_STEP_MS);
+        imu.busPoll();
+        imu.getAction();
+        imu.action_info.isValid = false;
+    }
+}
+
+// The gyro as the device sees it lying still
+static void residual(IMU &imu, int out[3])
+{
+    lie_still(imu, CHECK_STEP_MS);
+    out[0] = imu.action_info.v_gx;
+    out[1] = imu.action_info.v_gy;
+    out[2] = imu.action_info.v_gz;
+}
+
+static bool within(const int value[3], int limit)
+{
+    return abs(value[0]) <= limit && abs(value[1]) <= limit && abs(value[2]) <= limit;
+}
+
+// ------------------------------------------------------------------ boots
+
+struct Boot
+{
+    SysMpuConfig cfg;
+    IMU imu;
+};
+
+typedef std::function<void(Boot &)> BootBody;
+
+static const SimOptions *sim_config;
+
+// Runs `prepare` on the stored settings, boots the IMU at `celsius` and runs `body`, in a child
+static void boot(float celsius, const std::function<void()> &prepare, const BootBody &body)
+{
+    fflush(stdout);
+    pid_t pid = fork();
+    if (0 == pid)
+    {
+        failures = 0;
+        if (!sim_begin(sim_config) || !settings_init())
+        {
+            printf("FAIL  the simulator and the settings start\n");
+            _exit(1);
+        }
+        sim_set_loop_task();
+        set_sensor(celsius);
+        if (prepare)
+        {
+            prepare();
+        }
+        Boot *state = new Boot();
+        memset(&state->cfg, 0, sizeof(state->cfg));
+        state->imu.init(0, 1, &state->cfg);
+        body(*state);
+        fflush(stdout);
+        _exit(failures);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    failures += WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
+
+static void move_stored_offset()
+{
+    settings_set_i32(IMU_CALI_PREFIX "x_gyro", settings_get_i32(IMU_CALI_PREFIX "x_gyro", 0) + CHECK_MOVED_OFFSET);
+}
+
+// Boots after moving the stored offset (and dating the calibration `timestamp`
+// when not 0) and checks whether the stored calibration was used
+static void check_reuse(float celsius, uint32_t timestamp, bool reuse, const char *what)
+{
+    boot(celsius,
+         [timestamp]() {
+             move_stored_offset();
+             if (0 != timestamp)
+             {
+                 settings_set_u32(IMU_CALI_PREFIX "time", timestamp);
+             }
+         },
+         [reuse, what](Boot &state) {
+             Stored now = stored();
+             int out[3];
+             residual(state.imu, out);
+             // Reuse leaves the moved offset (20 LSB off on x); a full calibration cancels the bias
+             bool ok = reuse ? abs(out[0]) > 2 * CHECK_MOVED_OFFSET && state.cfg.timestamp == now.time
+                             : within(out, 2) && now.time != 0;
+             check(ok, what);
+         });
+}
+
+int main(int argc, char **argv)
+{
+    SimOptions options;
+    sim_default_options(&options);
+    options.quiet = true;
+    options.virtual_time = true;
+    for (int pos = 1; pos < argc; ++pos)
+    {
+        if (!strcmp(argv[pos], "--partitions") && pos + 1 < argc)
+        {
+            options.partitions = argv[++pos];
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--partitions CSV]\n", argv[0]);
+            return 2;
+        }
+    }
+    SimCheckDir work;
+    if (!sim_check_dir("imu_calibration_check", &work, &options))
+    {
+        return 2;
+    }
+    sim_config = &options;
+
+    boot(CHECK_BASE_C, NULL, [](Boot &state) {
+        Stored now = stored();
+        int out[3];
+        residual(state.imu, out);
+        printf("      first boot: offsets %d %d %d, residual %d %d %d\n", (int)now.gyro[0], (int)now.gyro[1],
+               (int)now.gyro[2], out[0], out[1], out[2]);
+        check(state.cfg.valid && now.gyro[0] == state.cfg.x_gyro_offset && now.gyro[1] == state.cfg.y_gyro_offset &&
+                  now.gyro[2] == state.cfg.z_gyro_offset && abs(now.temp - 3000) <= 1 && now.time > IMU_TIME_VALID,
+              "the first boot calibrates and stores offsets, temperature and time");
+        check(within(out, 2), "the full calibration cancels the bias");
+    });
+
+    // 6 degrees warmer: within IMU_CALI_TEMP_DELTA, the drift is left to the background
+    const float warm = CHECK_BASE_C + 6;
+    boot(warm, NULL, [warm](Boot &state) {
+        Stored before = stored();
+        int out[3];
+        residual(state.imu, out);
+        printf("      %.0f C: residual after boot %d %d %d\n", warm, out[0], out[1], out[2]);
+        check(state.cfg.x_gyro_offset == before.gyro[0] && state.cfg.y_gyro_offset == before.gyro[1] &&
+                  state.cfg.z_gyro_offset == before.gyro[2] && !within(out, IMU_RECAL_MIN_BIAS),
+              "a few degrees warmer the stored calibration is reused");
+
+        int expect[3];
+        int16_t offsets[3] = {state.cfg.x_gyro_offset, state.cfg.y_gyro_offset, state.cfg.z_gyro_offset};
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            expect[axis] = offsets[axis] - (out[axis] + (out[axis] > 0 ? 2 : -2)) / 4;
+        }
+        lie_still(state.imu, CHECK_WINDOW_MS + CHECK_WINDOW_MS / 2);
+        int16_t first[3] = {state.cfg.x_gyro_offset, state.cfg.y_gyro_offset, state.cfg.z_gyro_offset};
+        residual(state.imu, out);
+        printf("      after one window: offsets %d %d %d, residual %d %d %d\n", first[0], first[1], first[2], out[0],
+               out[1], out[2]);
+        check(first[0] == expect[0] && first[1] == expect[1] && first[2] == expect[2],
+              "one still window applies offset -= (bias +-2) / 4");
+        check(within(out, 2), "the residual is within +-2 LSB after one window");
+
+        lie_still(state.imu, 4 * CHECK_WINDOW_MS);
+        check(state.cfg.x_gyro_offset == first[0] && state.cfg.y_gyro_offset == first[1] &&
+                  state.cfg.z_gyro_offset == first[2],
+              "further windows leave the converged offsets alone");
+
+        Stored unsaved = stored();
+        check(unsaved.gyro[0] == before.gyro[0], "the new offsets wait for IMU_CALI_SAVE_INTERVAL");
+        lie_still(state.imu, IMU_CALI_SAVE_INTERVAL);
+        // Only a window that moves the offsets asks for a save: drift once more
+        set_sensor(warm + 2);
+        lie_still(state.imu, 2 * CHECK_WINDOW_MS);
+        Stored saved = stored();
+        check(saved.gyro[0] == state.cfg.x_gyro_offset && saved.gyro[1] == state.cfg.y_gyro_offset &&
+                  saved.gyro[2] == state.cfg.z_gyro_offset && abs(saved.temp - (int)((warm + 2) * 100)) <= 1,
+              "the background offsets and temperature reach flash");
+    });
+
+    // 10 degrees away from the last save: beyond IMU_CALI_TEMP_DELTA
+    check_reuse(CHECK_BASE_C + 18, 0, false, "10 degrees away the IMU calibrates fully");
+
+    uint32_t now = (uint32_t)time(NULL);
+    float hot = CHECK_BASE_C + 18;
+    check_reuse(hot, now - CHECK_DAY, true, "a calibration from yesterday is reused");
+    check_reuse(hot, now - IMU_CALI_MAX_AGE - CHECK_DAY, false, "a calibration older than IMU_CALI_MAX_AGE is redone");
+    check_reuse(hot, now + 365 * CHECK_DAY, false, "a calibration dated in the future is redone");
+    check_reuse(hot, 1234, true, "a calibration dated in seconds since boot is judged by temperature only");
+
+    sim_check_remove(work);
+    printf(failures ? "imu calibration check FAILED (%d)\n" : "imu calibration check passed\n", failures);
+    return failures ? 1 : 0;
+}
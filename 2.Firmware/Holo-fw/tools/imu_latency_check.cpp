@@ -0,0 +1,170 @@
+// Host check of how fast the polling IMU API (IMU::update(), driver/imu.*) reports tilts, on the simulator (sim/).
+//
+// Feeds synthetic acceleration sequences, one sample every
+// GESTURE_SAMPLE_PERIOD ms of virtual time, and calls update() after each
+// sample as a loop would. A forward or backward tilt is held pending until
+// it is told apart from a long press; checks that:
+//   - no update() call takes any time: a call that waited for the long press
+//     to play out would move the virtual clock on
+//   - a tilt released early reports UP/DOWN with the first sample after the
+//     release, and one held for IMU_HOLD_TIME reports GO_FORWORD/RETURN with
+//     the first sample past it, each within one sample period, with the
+//     encoder state the LVGL group expects
+//   - a sideways tilt reports TURN_LEFT/TURN_RIGHT with its first sample
+//   - exactly one gesture is reported per tilt, nothing while level
+// Exits non-zero when a check fails.
+//
+//     pio run -e imu_latency_check
+//     .pio/build/imu_latency_check/program [--partitions CSV]
+
+#include "Arduino.h"
+#include "sim.h"
+#include "sim_check.h"
+#include "driver/imu.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#define CHECK_TILT 8000       // raw at +-2g: about 30 degrees
+#define CHECK_SHORT_MS 200    // a tilt released before IMU_HOLD_TIME
+#define CHECK_LONG_MS 800     // a tilt held past it
+#define CHECK_LEVEL_MS 300    // level between the tilts
+#define CHECK_INTERVAL 0      // update(interval): every call may report
+
+struct Reported
+{
+    ACTIVE_TYPE type;
+    unsigned long ms; // millis() when update() returned it
+};
+
+struct Run
+{
+    std::vector<Reported> gestures;
+    unsigned long longest_call; // virtual ms spent inside one update() call
+};
+
+// Feeds `ms` of samples with the given acceleration, calling update() after each
+static void feed(IMU &imu, int16_t ax, int16_t ay, uint32_t ms, Run *run)
+{
+    const int16_t gyro[3] = {0, 0, 0};
+    const int16_t accel[3] = {ax, ay, 16384};
+    for (uint32_t done = 0; done < ms; done += GESTURE_SAMPLE_PERIOD)
+    {
+        delay(GESTURE_SAMPLE_PERIOD);
+        sim_imu_motion(accel, gyro);
+        unsigned long before = millis();
+        ImuAction *action = imu.update(CHECK_INTERVAL);
+        unsigned long took = millis() - before;
+        if (took > run->longest_call)
+        {
+            run->longest_call = took;
+        }
+        if (action->isValid)
+        {
+            // The loop takes the action and clears it
+            run->gestures.push_back({action->active, millis()});
+            action->isValid = false;
+        }
+    }
+}
+
+// One tilt from level: reports what update() returned and when, relative to
+// the first tilted sample
+static Run tilt(IMU &imu, int16_t ax, int16_t ay, uint32_t hold_ms, unsigned long *start)
+{
+    Run run = {{}, 0};
+    feed(imu, 0, 0, CHECK_LEVEL_MS, &run);
+    run.gestures.clear();
+    *start = millis() + GESTURE_SAMPLE_PERIOD;
+    feed(imu, ax, ay, hold_ms, &run);
+    feed(imu, 0, 0, CHECK_LEVEL_MS, &run);
+    return run;
+}
+
+// Checks a tilt that must be reported as `expect` when the sample at `due`
+// (ms after the first tilted sample) has been read, within one sample period
+static void check_tilt(IMU &imu, const char *name, int16_t ax, int16_t ay, uint32_t hold_ms, ACTIVE_TYPE expect,
+                       unsigned long due, int encoder)
+{
+    unsigned long start;
+    encoder_state = (lv_indev_state_t)-1;
+    Run run = tilt(imu, ax, ay, hold_ms, &start);
+    bool one = 1 == run.gestures.size();
+    long late = one ? (long)(run.gestures[0].ms - start) - (long)due : -1;
+    printf("      %-22s %s after %ld ms (due at %lu ms), %u reported, longest update() %lu ms\n", name,
+           one ? active_type_info[run.gestures[0].type] : "-", one ? (long)(run.gestures[0].ms - start) : -1, due,
+           (unsigned)run.gestures.size(), run.longest_call);
+
+    char what[160];
+    snprintf(what, sizeof(what), "%s: update() never waits", name);
+    check(0 == run.longest_call, what);
+    snprintf(what, sizeof(what), "%s: %s is reported once, within one sample period", name,
+             active_type_info[expect]);
+    check(one && expect == run.gestures[0].type && late >= 0 && late <= GESTURE_SAMPLE_PERIOD, what);
+    if (encoder >= 0)
+    {
+        snprintf(what, sizeof(what), "%s: the encoder state follows", name);
+        check(encoder == (int)encoder_state, what);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    SimOptions options;
+    sim_default_options(&options);
+    options.quiet = true;
+    options.virtual_time = true;
+    for (int pos = 1; pos < argc; ++pos)
+    {
+        if (!strcmp(argv[pos], "--partitions") && pos + 1 < argc)
+        {
+            options.partitions = argv[++pos];
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--partitions CSV]\n", argv[0]);
+            return 2;
+        }
+    }
+    SimCheckDir work;
+    if (!sim_check_dir("imu_latency_check", &work, &options))
+    {
+        return 2;
+    }
+    if (!sim_begin(&options))
+    {
+        sim_check_remove(work);
+        return 2;
+    }
+    sim_set_loop_task();
+
+    static SysMpuConfig cfg;
+    static IMU imu;
+    imu.init(0, 0, &cfg); // the offsets as given, no calibration
+
+    // A released tilt is known at the first level sample, a long press once IMU_HOLD_TIME has passed
+    check_tilt(imu, "short forward tilt", CHECK_TILT, 0, CHECK_SHORT_MS, UP, CHECK_SHORT_MS, -1);
+    check_tilt(imu, "short backward tilt", -CHECK_TILT, 0, CHECK_SHORT_MS, DOWN, CHECK_SHORT_MS, -1);
+    check_tilt(imu, "held forward tilt", CHECK_TILT, 0, CHECK_LONG_MS, GO_FORWORD, IMU_HOLD_TIME,
+               LV_INDEV_STATE_PR);
+    check_tilt(imu, "held backward tilt", -CHECK_TILT, 0, CHECK_LONG_MS, RETURN, IMU_HOLD_TIME,
+               LV_INDEV_STATE_REL);
+    check_tilt(imu, "left tilt", 0, CHECK_TILT, GESTURE_SAMPLE_PERIOD, TURN_LEFT, 0, -1);
+    check_tilt(imu, "right tilt", 0, -CHECK_TILT, GESTURE_SAMPLE_PERIOD, TURN_RIGHT, 0, -1);
+
+    Run level = {{}, 0};
+    feed(imu, 0, 0, 2000, &level);
+    check(level.gestures.empty(), "nothing is reported while the device lies level");
+
+    sim_end();
+    sim_check_remove(work);
+    printf(failures ? "imu latency check FAILED (%d)\n" : "imu latency check passed\n", failures);
+    fflush(stdout);
+    // Firmware tasks never return; leave without running static destructors under them
+    _exit(failures ? 1 : 0);
+}
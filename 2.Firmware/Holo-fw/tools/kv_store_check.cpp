@@ -0,0 +1,463 @@
+// Host-side checks and boot-time benchmark for the key-value store (sys/kv_store.*).
+//
+// The store runs on a file-backed flash image (flash_image.h) mapped into
+// memory like the partition on the device, with NOR write rules enforced.
+// Checks typed reads and writes, persistence across reopening (also after
+// unmapping the file), compaction under a long random workload, batches, a
+// full store, and power cuts at random points of writes, batches and
+// compaction: after every cut the reopened store must hold either the state
+// before the interrupted operation or the state after it, nothing else.
+// Ends with the time open() needs to scan a full partition, which is what the
+// device spends at boot.
+// Exits non-zero when a check fails.
+//
+//     g++ -O2 -I../src/sys -I../sim/include -o kv_store_check kv_store_check.cpp ../src/sys/kv_store.cpp
+//     ./kv_store_check [-v] [image]
+
+#include "kv_store.h"
+#include "flash_image.h"
+#include "sim_check.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#define PARTITION_SIZE (4 * KV_SECTOR_SIZE) // "kvstore" in partitions-no-ota.csv
+
+static bool verbose = false;
+
+// Type tag followed by the value bytes
+typedef std::map<std::string, std::string> Model;
+
+static KvFlash flash_of(FlashImage &img)
+{
+    KvFlash flash = {img.map, img.size, flash_image_write, flash_image_erase, &img};
+    return flash;
+}
+
+static bool collect_entry(void *ctx, const char *key, uint8_t type, const void *value, uint16_t len)
+{
+    Model *model = (Model *)ctx;
+    (*model)[key] = std::string(1, (char)type) + std::string((const char *)value, len);
+    return true;
+}
+
+static Model dump(const KvStore &store)
+{
+    Model model;
+    store.forEach(collect_entry, &model);
+    return model;
+}
+
+static void print_model(const char *name, const Model &model)
+{
+    printf("      %s:", name);
+    for (const auto &item : model)
+    {
+        printf(" %s(%d,%zu)", item.first.c_str(), item.second[0], item.second.size() - 1);
+    }
+    printf("\n");
+}
+
+struct Op
+{
+    int kind; // 0 u32, 1 str, 2 blob, 3 remove
+    std::string key;
+    std::string value;
+};
+
+static Op random_op(std::mt19937 &rng, int keys)
+{
+    Op op;
+    op.kind = rng() % 8 == 0 ? 3 : rng() % 3;
+    op.key = "key." + std::to_string(rng() % keys);
+    if (0 == op.kind)
+    {
+        op.value.resize(4);
+        uint32_t value = rng() % 4; // small range so that some writes are no-ops
+        memcpy(&op.value[0], &value, 4);
+    }
+    else if (1 == op.kind)
+    {
+        op.value = std::string(rng() % 48, 'a' + rng() % 26);
+    }
+    else if (2 == op.kind)
+    {
+        op.value.resize(rng() % 200);
+        for (char &c : op.value)
+        {
+            c = (char)rng();
+        }
+    }
+    return op;
+}
+
+static bool run_op(KvStore &store, const Op &op)
+{
+    switch (op.kind)
+    {
+    case 0:
+    {
+        uint32_t value;
+        memcpy(&value, op.value.data(), 4);
+        return store.setU32(op.key.c_str(), value);
+    }
+    case 1:
+        return store.setStr(op.key.c_str(), op.value.c_str());
+    case 2:
+        return store.setBlob(op.key.c_str(), op.value.data(), op.value.size());
+    default:
+        return store.remove(op.key.c_str());
+    }
+}
+
+static void apply_op(Model &model, const Op &op)
+{
+    static const uint8_t types[3] = {KV_TYPE_U32, KV_TYPE_STR, KV_TYPE_BLOB};
+    if (3 == op.kind)
+    {
+        model.erase(op.key);
+        return;
+    }
+    std::string value = op.value;
+    if (1 == op.kind)
+    {
+        value.push_back(0);
+    }
+    model[op.key] = std::string(1, (char)types[op.kind]) + value;
+}
+
+static void check_types(FlashImage &img)
+{
+    KvStore store;
+    bool ok = store.open(flash_of(img));
+    check(ok && 0 == store.stats().keys, "a blank partition opens empty");
+
+    const uint8_t blob[5] = {1, 2, 3, 4, 5};
+    ok = store.setU32("backlight", 80) && store.setI32("offset", -1234) &&
+         store.setStr("ssid", "fiberpunk") && store.setBlob("wifi.cache", blob, sizeof(blob));
+    uint8_t read[5] = {0};
+    ok = ok && 80 == store.getU32("backlight", 0) && -1234 == store.getI32("offset", 0) &&
+         !strcmp("fiberpunk", store.getStr("ssid", "")) && store.getBlob("wifi.cache", read, sizeof(read)) &&
+         !memcmp(blob, read, sizeof(blob));
+    check(ok, "typed values read back");
+
+    ok = 7 == store.getU32("missing", 7) && 7 == store.getU32("ssid", 7) &&
+         !strcmp("def", store.getStr("backlight", "def")) && !store.getBlob("wifi.cache", read, 4);
+    check(ok, "missing keys, other types and other sizes give the default");
+
+    uint32_t writes = store.stats().writes;
+    ok = store.setU32("backlight", 80) && store.setStr("ssid", "fiberpunk") && store.remove("missing");
+    check(ok && writes == store.stats().writes, "unchanged values are not written again");
+
+    char long_key[KV_KEY_MAX + 2];
+    memset(long_key, 'k', sizeof(long_key) - 1);
+    long_key[KV_KEY_MAX + 1] = 0;
+    uint8_t big[KV_VALUE_MAX + 1] = {0};
+    ok = !store.setU32(long_key, 1) && !store.setU32("", 1) && !store.setBlob("big", big, sizeof(big));
+    check(ok && store.setBlob("big", big, KV_VALUE_MAX), "key and value sizes are limited");
+
+    store.remove("offset");
+    store.close();
+    flash_image_close(&img);
+}
+
+static void check_reopen(const char *path)
+{
+    FlashImage img;
+    KvStore store;
+    bool ok = flash_image_open(&img, path, PARTITION_SIZE) && store.open(flash_of(img));
+    ok = ok && 80 == store.getU32("backlight", 0) && !strcmp("fiberpunk", store.getStr("ssid", "")) &&
+         !store.contains("offset") && 4 == store.stats().keys;
+    check(ok, "values survive unmapping the image, removed keys stay removed");
+    check(0 == img.violations, "no write needed an erase");
+    store.close();
+    flash_image_close(&img);
+}
+
+static void check_compaction(FlashImage &img, std::mt19937 &rng)
+{
+    memset(img.map, 0xFF, img.size);
+    KvStore store;
+    store.open(flash_of(img));
+    Model model;
+    bool ok = true;
+    for (int i = 0; i < 20000 && ok; ++i)
+    {
+        Op op = random_op(rng, 12);
+        ok = run_op(store, op);
+        apply_op(model, op);
+        if (0 == i % 997)
+        {
+            KvStore reopened;
+            ok = ok && reopened.open(flash_of(img)) && dump(reopened) == model && dump(store) == model;
+        }
+    }
+    KvStats stats = store.stats();
+    if (verbose)
+    {
+        printf("      %u collections, %u writes, %u erases, %u of %u bytes live\n", stats.collections,
+               stats.writes, stats.erases, stats.live_bytes, stats.used_bytes);
+    }
+    check(ok && dump(store) == model, "20000 random updates match the model, also after reopening");
+    check(stats.collections > 0 && stats.free_sectors >= 1, "old sectors are compacted, one stays free");
+    check(0 == img.violations, "compaction never writes over programmed bytes");
+}
+
+static void check_batches(FlashImage &img)
+{
+    memset(img.map, 0xFF, img.size);
+    KvStore store;
+    store.open(flash_of(img));
+    store.setU32("a", 1);
+    store.setU32("b", 1);
+
+    bool ok = store.begin() && store.setU32("a", 2) && store.setU32("b", 2) && store.setStr("c", "new");
+    ok = ok && 1 == store.getU32("a", 0) && !store.contains("c");
+    store.abort();
+    ok = ok && 1 == store.getU32("a", 0) && 1 == store.getU32("b", 0) && !store.contains("c");
+    check(ok, "a batch is invisible until committed and can be dropped");
+
+    ok = store.begin() && store.setU32("a", 3) && store.remove("b") && store.setStr("c", "new") &&
+         store.setU32("a", 4) && store.commit();
+    KvStore reopened;
+    ok = ok && 4 == store.getU32("a", 0) && !store.contains("b") && reopened.open(flash_of(img)) &&
+         dump(reopened) == dump(store);
+    check(ok, "a committed batch applies in order and persists");
+
+    uint8_t blob[KV_VALUE_MAX] = {0};
+    ok = store.begin();
+    int staged = 0;
+    while (ok && store.setBlob(("big." + std::to_string(staged)).c_str(), blob, sizeof(blob)))
+    {
+        ++staged;
+    }
+    store.abort();
+    check(ok && staged > 0 && staged * KV_VALUE_MAX < KV_SECTOR_SIZE, "a batch is limited to one sector");
+}
+
+static void check_full(FlashImage &img)
+{
+    memset(img.map, 0xFF, img.size);
+    KvStore store;
+    store.open(flash_of(img));
+    uint8_t blob[KV_VALUE_MAX];
+    memset(blob, 0x5A, sizeof(blob));
+    Model model;
+    int stored = 0;
+    for (; stored < KV_MAX_KEYS; ++stored)
+    {
+        std::string key = "blob." + std::to_string(stored);
+        if (!store.setBlob(key.c_str(), blob, sizeof(blob)))
+        {
+            break;
+        }
+        model[key] = std::string(1, (char)KV_TYPE_BLOB) + std::string((const char *)blob, sizeof(blob));
+    }
+    KvStore reopened;
+    bool ok = stored > 0 && stored < KV_MAX_KEYS && reopened.open(flash_of(img)) && dump(reopened) == model;
+    if (verbose)
+    {
+        printf("      %d blobs of %d bytes fit\n", stored, KV_VALUE_MAX);
+    }
+    check(ok, "a full store refuses new values and keeps the old ones");
+    ok = store.remove("blob.0") && store.setBlob("blob.new", blob, sizeof(blob)) &&
+         reopened.open(flash_of(img)) && reopened.contains("blob.new") && !reopened.contains("blob.0");
+    check(ok, "removing a value makes room again");
+
+    memset(img.map, 0xFF, img.size);
+    store.open(flash_of(img));
+    ok = true;
+    for (int i = 0; i < KV_MAX_KEYS && ok; ++i)
+    {
+        ok = store.setU32(("k" + std::to_string(i)).c_str(), i);
+    }
+    check(ok && !store.setU32("one.more", 1) && store.setU32("k0", 7), "the index holds KV_MAX_KEYS keys");
+}
+
+static uint32_t crc32(const uint8_t *data, uint32_t len)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    while (len--)
+    {
+        crc ^= *data++;
+        for (int bit = 0; bit < 8; ++bit)
+        {
+            crc = (crc >> 1) ^ (crc & 1 ? 0xEDB88320 : 0);
+        }
+    }
+    return ~crc;
+}
+
+static void check_version(FlashImage &img)
+{
+    memset(img.map, 0xFF, img.size);
+    KvStore store;
+    store.open(flash_of(img));
+    store.setU32("a", 1);
+    // Same layout written by a future format version: bump the version and fix the header crc
+    img.map[4] = KV_FORMAT_VERSION + 1;
+    uint32_t crc = crc32(img.map, 12);
+    memcpy(img.map + 12, &crc, 4);
+    store.open(flash_of(img));
+    check(!store.contains("a") && store.setU32("a", 2) && 2 == store.getU32("a", 0),
+          "sectors of another format version are treated as blank");
+}
+
+// Runs a random workload and cuts the power in the middle of some operations
+static void check_power_cuts(FlashImage &img, std::mt19937 &rng)
+{
+    memset(img.map, 0xFF, img.size);
+    KvStore store;
+    store.open(flash_of(img));
+    Model acked;
+    int cuts = 0;
+    int rolled_back = 0;
+    uint32_t collections = 0;
+    bool ok = true;
+    for (int i = 0; i < 30000 && ok; ++i)
+    {
+        bool batch = rng() % 5 == 0;
+        std::vector<Op> ops;
+        for (int n = batch ? 2 + rng() % 4 : 1; n > 0; --n)
+        {
+            ops.push_back(random_op(rng, 10));
+        }
+        Model after = acked;
+        for (const Op &op : ops)
+        {
+            apply_op(after, op);
+        }
+
+        bool cut = rng() % 4 == 0;
+        if (cut)
+        {
+            flash_image_cut_after(&img, rng() % 600);
+        }
+        bool done = !batch || store.begin();
+        for (const Op &op : ops)
+        {
+            done = done && run_op(store, op);
+        }
+        done = done && (!batch || store.commit());
+        if (!done && batch)
+        {
+            store.abort();
+        }
+
+        if (!img.powered)
+        {
+            // Reboot: the store must be exactly one of the two states
+            ++cuts;
+            collections += store.stats().collections;
+            flash_image_power_on(&img);
+            store.open(flash_of(img));
+            Model now = dump(store);
+            if (now != acked && now != after)
+            {
+                print_model("before", acked);
+                print_model("after ", after);
+                print_model("found ", now);
+                ok = false;
+            }
+            rolled_back += now == acked && acked != after;
+            acked = now;
+            continue;
+        }
+        flash_image_cut_after(&img, -1);
+        ok = done && dump(store) == after;
+        acked = after;
+    }
+    KvStore reopened;
+    ok = ok && reopened.open(flash_of(img)) && dump(reopened) == acked;
+    if (verbose)
+    {
+        printf("      %d power cuts, %d operations lost, %u collections\n", cuts, rolled_back,
+               collections + store.stats().collections);
+    }
+    check(ok && cuts > 1000, "after a power cut the store is the state before or after the operation");
+    check(0 == img.violations, "recovery never writes over programmed bytes");
+}
+
+// Time open() on partitions full of small records, as the device does at boot
+static void bench(const char *path, std::mt19937 &rng)
+{
+    const uint32_t sizes[] = {PARTITION_SIZE, 16 * KV_SECTOR_SIZE};
+    for (uint32_t size : sizes)
+    {
+        FlashImage img;
+        if (!flash_image_open(&img, path, size))
+        {
+            check(false, "bench image opens");
+            return;
+        }
+        memset(img.map, 0xFF, img.size);
+        KvStore store;
+        store.open(flash_of(img));
+        // Fill every sector but the spare with updates of 40 keys
+        while (store.stats().free_sectors > 1)
+        {
+            store.setU32(("key." + std::to_string(rng() % 40)).c_str(), rng());
+        }
+        const int rounds = 2000;
+        uint32_t records = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; ++i)
+        {
+            KvStore boot;
+            boot.open(flash_of(img));
+            records = boot.stats().records;
+        }
+        double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / rounds;
+        printf("      open() of %u KB with %u records: %.1f us (%.1f MB/s)\n", size / 1024, records, us,
+               size / us);
+        flash_image_close(&img);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = "kv_store_check.img";
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "-v"))
+        {
+            verbose = true;
+        }
+        else
+        {
+            path = argv[i];
+        }
+    }
+    unlink(path);
+    std::mt19937 rng(1);
+
+    FlashImage img;
+    if (!flash_image_open(&img, path, PARTITION_SIZE))
+    {
+        printf("FAIL  cannot create %s\n", path);
+        return 1;
+    }
+    check_types(img);
+    check_reopen(path);
+
+    flash_image_open(&img, path, PARTITION_SIZE);
+    check_compaction(img, rng);
+    check_batches(img);
+    check_full(img);
+    check_version(img);
+    check_power_cuts(img, rng);
+    flash_image_close(&img);
+
+    bench(path, rng);
+    unlink(path);
+
+    printf("%s\n", failures ? "FAILED" : "all checks passed");
+    return failures ? 1 : 0;
+}
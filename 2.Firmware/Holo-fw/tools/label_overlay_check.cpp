@@ -0,0 +1,231 @@
+// Host-side checks for the scrolling label overlay (app/picture/label_overlay.*).
+//
+// Decodes nothing: a random 240x240 RGB565 frame stands in for a JPEG frame.
+// The frame is split into blocks the way TJpgDec hands them to tft_output
+// (16x16, 8x8 and odd clipped sizes), each block is composed with the overlay
+// and the result is compared pixel by pixel with the two-pass result: the
+// whole frame first, then the label blended over it as a separate layer.
+// Covers short (centred) and long (scrolling) text, scroll offsets across the
+// wrap-around and windows partly outside the screen.
+// Exits non-zero when a check fails.
+//
+//     g++ -O2 -I../src/app/picture -I../sim/include -o label_overlay_check label_overlay_check.cpp ../src/app/picture/label_overlay.cpp
+//     ./label_overlay_check [-v]
+
+#include "label_overlay.h"
+#include "sim_check.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <random>
+#include <vector>
+
+#define SCREEN 240
+
+static bool verbose = false;
+
+struct Label
+{
+    int width;
+    int height;
+    std::vector<uint8_t> alpha; // 8 bit, as rasterised from the font
+};
+
+static Label make_label(int width, int height, std::mt19937 &rng)
+{
+    Label label = {width, height, std::vector<uint8_t>(width * height)};
+    for (uint8_t &a : label.alpha)
+    {
+        int pick = rng() % 4;
+        a = 0 == pick ? 0 : 1 == pick ? 255 : (uint8_t)rng();
+    }
+    return label;
+}
+
+// Per channel blend, lv_color_mix() with LV_COLOR_MIX_ROUND_OFS 0 on a 4 bpp alpha
+static uint16_t blend_reference(uint16_t fg, uint16_t bg, uint8_t alpha8)
+{
+    int a4 = alpha8 >> 4;
+    if (0 == a4)
+    {
+        return bg;
+    }
+    if (15 == a4)
+    {
+        return fg;
+    }
+    int mix = (a4 * 17 + 4) >> 3;
+    int shifts[3] = {11, 5, 0};
+    int masks[3] = {0x1F, 0x3F, 0x1F};
+    uint16_t out = 0;
+    for (int ch = 0; ch < 3; ++ch)
+    {
+        int f = (fg >> shifts[ch]) & masks[ch];
+        int b = (bg >> shifts[ch]) & masks[ch];
+        out |= ((b * (32 - mix) + f * mix) >> 5) << shifts[ch];
+    }
+    return out;
+}
+
+// Second pass: the label drawn over the finished frame
+static void overlay_reference(std::vector<uint16_t> &frame, const Label &label, int win_x, int win_y,
+                              int win_w, uint16_t color, uint32_t scroll_ms)
+{
+    for (int sy = 0; sy < SCREEN; ++sy)
+    {
+        for (int sx = 0; sx < SCREEN; ++sx)
+        {
+            int col = sx - win_x;
+            int row = sy - win_y;
+            if (col < 0 || col >= win_w || row < 0 || row >= label.height)
+            {
+                continue;
+            }
+            int u;
+            if (label.width <= win_w)
+            {
+                u = col - (win_w - label.width) / 2;
+            }
+            else
+            {
+                long period = label.width + LABEL_OVERLAY_GAP;
+                long offset = (long)((uint64_t)scroll_ms * LABEL_OVERLAY_SPEED / 1000 % period);
+                u = (int)((col + offset) % period);
+            }
+            if (u < 0 || u >= label.width)
+            {
+                continue;
+            }
+            uint16_t &px = frame[sy * SCREEN + sx];
+            px = blend_reference(color, px, label.alpha[row * label.width + u]);
+        }
+    }
+}
+
+// Single pass: compose every block before it would be pushed
+static void overlay_blocks(std::vector<uint16_t> &frame, const LabelOverlay &overlay, int block_w, int block_h)
+{
+    std::vector<uint16_t> block(block_w * block_h);
+    for (int by = 0; by < SCREEN; by += block_h)
+    {
+        for (int bx = 0; bx < SCREEN; bx += block_w)
+        {
+            // TJpgDec clips the last blocks to the image
+            int w = bx + block_w > SCREEN ? SCREEN - bx : block_w;
+            int h = by + block_h > SCREEN ? SCREEN - by : block_h;
+            for (int y = 0; y < h; ++y)
+            {
+                memcpy(&block[y * w], &frame[(by + y) * SCREEN + bx], w * 2);
+            }
+            overlay.compose(bx, by, w, h, block.data());
+            for (int y = 0; y < h; ++y)
+            {
+                memcpy(&frame[(by + y) * SCREEN + bx], &block[y * w], w * 2);
+            }
+        }
+    }
+}
+
+static bool compare(const Label &label, int win_x, int win_y, int win_w, uint32_t scroll_ms,
+                    int block_w, int block_h, std::mt19937 &rng)
+{
+    std::vector<uint16_t> frame(SCREEN * SCREEN);
+    for (uint16_t &px : frame)
+    {
+        px = (uint16_t)rng();
+    }
+    uint16_t color = rng() % 2 ? 0xFFFF : (uint16_t)rng();
+
+    LabelOverlay overlay;
+    if (!overlay.begin(label.width, label.height))
+    {
+        return false;
+    }
+    for (int y = 0; y < label.height; ++y)
+    {
+        for (int x = 0; x < label.width; ++x)
+        {
+            overlay.setAlpha(x, y, label.alpha[y * label.width + x]);
+        }
+    }
+    overlay.setColor(color);
+    overlay.setWindow(win_x, win_y, win_w);
+    // Reach the offset in frame-sized steps like the player does
+    uint32_t left = scroll_ms;
+    while (left > 0)
+    {
+        uint32_t step = left > 40 ? 40 : left;
+        overlay.advance(step);
+        left -= step;
+    }
+
+    std::vector<uint16_t> expected = frame;
+    overlay_reference(expected, label, win_x, win_y, win_w, color, scroll_ms);
+    overlay_blocks(frame, overlay, block_w, block_h);
+
+    int diff = 0;
+    for (int pos = 0; pos < SCREEN * SCREEN; ++pos)
+    {
+        diff += frame[pos] != expected[pos];
+    }
+    if (verbose || diff)
+    {
+        printf("      label %dx%d window %d,%d w%d scroll %u ms blocks %dx%d: %d pixels differ\n",
+               label.width, label.height, win_x, win_y, win_w, scroll_ms, block_w, block_h, diff);
+    }
+    return 0 == diff;
+}
+
+int main(int argc, char **argv)
+{
+    verbose = argc > 1 && !strcmp(argv[1], "-v");
+    std::mt19937 rng(1);
+
+    const int blocks[][2] = {{16, 16}, {8, 8}, {16, 8}, {13, 7}};
+    const Label short_text = make_label(97, 28, rng);
+    const Label long_text = make_label(431, 28, rng);
+    // One period of the long text is (431 + GAP) px at SPEED px/s
+    const uint32_t period_ms = (431 + LABEL_OVERLAY_GAP) * 1000 / LABEL_OVERLAY_SPEED;
+
+    bool ok = true;
+    for (const auto &block : blocks)
+    {
+        ok = compare(short_text, 20, 188, 200, 0, block[0], block[1], rng) && ok;
+        ok = compare(short_text, 20, 188, 200, 12345, block[0], block[1], rng) && ok;
+    }
+    check(ok, "short text is centred and does not move");
+
+    ok = true;
+    const uint32_t offsets[] = {0, 40, 1000, 7777, period_ms - 40, period_ms, period_ms + 500, 5 * period_ms + 123};
+    for (const auto &block : blocks)
+    {
+        for (uint32_t ms : offsets)
+        {
+            ok = compare(long_text, 20, 188, 200, ms, block[0], block[1], rng) && ok;
+        }
+    }
+    check(ok, "long text scrolls and wraps like the two-pass result");
+
+    ok = true;
+    for (const auto &block : blocks)
+    {
+        ok = compare(long_text, -37, 230, 300, 2500, block[0], block[1], rng) && ok;
+        ok = compare(short_text, 190, -11, 120, 900, block[0], block[1], rng) && ok;
+        ok = compare(long_text, 3, 5, 1, 300, block[0], block[1], rng) && ok;
+    }
+    check(ok, "windows partly off screen are clipped");
+
+    ok = compare(long_text, 20, 188, 0, 300, 16, 16, rng);
+    check(ok, "empty window leaves the frame untouched");
+
+    LabelOverlay overlay;
+    check(!overlay.begin(LABEL_OVERLAY_MAX_WIDTH + 1, 28) && !overlay.active(), "too wide a label is refused");
+    check(overlay.begin(431, 28) && 216 * 28 == overlay.ramUsage(), "strip uses 4 bits per pixel");
+    overlay.clear();
+    check(!overlay.active() && 0 == overlay.ramUsage(), "clear() releases the strip");
+
+    printf("%s\n", failures ? "FAILED" : "all checks passed");
+    return failures ? 1 : 0;
+}
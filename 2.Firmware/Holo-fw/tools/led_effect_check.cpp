@@ -0,0 +1,171 @@
+// Host-side checks for the RGB LED effect generator (driver/led_effect.*).
+//
+// Verifies the gamma and HSV tables against a floating-point reference and
+// steps the RGB/HSV cycle effects for many ticks, checking that every value
+// stays inside its configured range and that the effects keep moving.
+// Exits non-zero when a check fails.
+//
+//     g++ -O2 -I../src/driver -I../sim/include -o led_effect_check led_effect_check.cpp ../src/driver/led_effect.cpp
+//     ./led_effect_check [-v]
+
+#include "led_effect.h"
+#include "sim_check.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LEDS 2
+#define TICKS 20000
+
+static void hsv_reference(uint8_t hue, uint8_t sat, uint8_t val, float rgb[3])
+{
+    float h = hue * 6.0f / 256, s = sat / 255.0f, v = val / 255.0f;
+    int sector = (int)h;
+    float f = h - sector;
+    float up = f, down = 1 - f;
+    float base[6][3] = {{1, up, 0}, {down, 1, 0}, {0, 1, up}, {0, down, 1}, {up, 0, 1}, {1, 0, down}};
+    for (int ch = 0; ch < 3; ++ch)
+    {
+        rgb[ch] = 255 * v * (1 - s * (1 - base[sector][ch]));
+    }
+}
+
+int main(int argc, char **argv)
+{
+    bool verbose = argc > 1 && !strcmp(argv[1], "-v");
+    led_tables_init();
+
+    // Tables
+    bool monotonic = true;
+    for (int pos = 1; pos < 256; ++pos)
+    {
+        monotonic = monotonic && led_gamma(pos) >= led_gamma(pos - 1) && led_gamma(pos) > 0;
+    }
+    check(monotonic && 0 == led_gamma(0) && 255 == led_gamma(255),
+          "gamma is monotonic, keeps 0 and 255 and never turns a lit value off");
+
+    int worst = 0;
+    for (int hue = 0; hue < 256; hue += 1)
+    {
+        for (int sat = 0; sat < 256; sat += 15)
+        {
+            for (int val = 0; val < 256; val += 15)
+            {
+                LedColor out;
+                float ref[3];
+                led_hsv_to_rgb(hue, sat, val, &out);
+                hsv_reference(hue, sat, val, ref);
+                int got[3] = {out.r, out.g, out.b};
+                for (int ch = 0; ch < 3; ++ch)
+                {
+                    int err = abs(got[ch] - (int)lroundf(ref[ch]));
+                    worst = err > worst ? err : worst;
+                }
+            }
+        }
+    }
+    printf("    hsv max error %d\n", worst);
+    check(worst <= 3, "integer HSV matches the float reference within 3 levels");
+    LedColor red, green, blue, white;
+    led_hsv_to_rgb(0, 255, 255, &red);
+    led_hsv_to_rgb(85, 255, 255, &green);
+    led_hsv_to_rgb(171, 255, 255, &blue);
+    led_hsv_to_rgb(123, 0, 255, &white);
+    check(255 == red.r && red.g < 4 && 0 == red.b && green.g >= 250 && blue.b >= 250 &&
+              255 == white.r && 255 == white.g && 255 == white.b,
+          "primaries and white are exact");
+
+    // Solid colours keep the linear duty of the old FastLED brightness
+    LedEffect solid;
+    LedColor frame[LEDS];
+    solid.setRGB(0, 64, 64);
+    solid.setDuty(255);
+    solid.render(frame, LEDS);
+    check(0 == frame[0].r && 64 == frame[0].g && 64 == frame[1].b, "solid colour at full duty is unchanged");
+    solid.setRainbow(50, 150);
+    solid.render(frame, LEDS);
+    LedColor first, last;
+    led_hsv_to_rgb(50, 255, 255, &first);
+    led_hsv_to_rgb(150, 255, 255, &last);
+    check(!memcmp(&frame[0], &first, sizeof(first)) && !memcmp(&frame[LEDS - 1], &last, sizeof(last)),
+          "rainbow spans the hue range across the LEDs");
+
+    // RGB cycle: ramps R, G, B up in turn and back down again
+    LedEffectParam param = {};
+    param.effect = LED_EFFECT_RGB_CYCLE;
+    uint8_t lo[3] = {10, 20, 30}, hi[3] = {250, 200, 240};
+    memcpy(param.min_value, lo, 3);
+    memcpy(param.max_value, hi, 3);
+    param.step[0] = 7;
+    param.min_brightness = 0.15f * LED_BRIGHTNESS_MAX;
+    param.max_brightness = 0.25f * LED_BRIGHTNESS_MAX;
+    param.brightness_step = 0.002f * LED_BRIGHTNESS_MAX;
+
+    LedEffect effect;
+    effect.start(param);
+    bool in_range = true;
+    int reached_max[3] = {0}, reached_min[3] = {0};
+    uint8_t prev[3] = {0};
+    int changes = 0, last_change = 0, longest_gap = 0;
+    uint8_t low_scale = led_gamma((uint8_t)(param.min_brightness >> 8));
+    uint8_t high_scale = led_gamma((uint8_t)(param.max_brightness >> 8));
+    for (int tick = 0; tick < TICKS; ++tick)
+    {
+        effect.step();
+        effect.render(frame, LEDS);
+        uint8_t got[3] = {frame[0].r, frame[0].g, frame[0].b};
+        for (int ch = 0; ch < 3; ++ch)
+        {
+            // Output is the channel value scaled by the gamma of the brightness
+            int scaled_lo = lo[ch] * (low_scale + 1) >> 8;
+            int scaled_hi = hi[ch] * (high_scale + 1) >> 8;
+            in_range = in_range && got[ch] >= scaled_lo && got[ch] <= scaled_hi;
+            reached_max[ch] += got[ch] == scaled_hi;
+            reached_min[ch] += got[ch] == scaled_lo;
+        }
+        if (memcmp(prev, got, 3))
+        {
+            ++changes;
+            longest_gap = tick - last_change > longest_gap ? tick - last_change : longest_gap;
+            last_change = tick;
+        }
+        memcpy(prev, got, 3);
+        if (verbose && tick < 120)
+        {
+            printf("    %4d  %3u %3u %3u\n", tick, got[0], got[1], got[2]);
+        }
+    }
+    check(in_range, "RGB cycle stays within the configured range");
+    check(reached_max[0] && reached_max[1] && reached_max[2] && reached_min[0] && reached_min[1] && reached_min[2],
+          "RGB cycle reaches both ends of every channel");
+    // At 15-25% brightness neighbouring values often round to the same
+    // output, so look for stalls rather than counting every tick
+    printf("    rgb cycle: %d frame changes in %d ticks, longest still %d ticks\n", changes, TICKS, longest_gap);
+    check(longest_gap <= 50, "RGB cycle keeps moving");
+
+    // HSV cycle: each channel bounces independently, even with steps that
+    // would overflow uint8_t near the ends
+    param.effect = LED_EFFECT_HSV_CYCLE;
+    uint8_t hsv_lo[3] = {0, 200, 128}, hsv_hi[3] = {255, 255, 255};
+    memcpy(param.min_value, hsv_lo, 3);
+    memcpy(param.max_value, hsv_hi, 3);
+    param.step[0] = 9;
+    param.step[1] = -5;
+    param.step[2] = 11;
+    effect.start(param);
+    changes = 0;
+    for (int tick = 0; tick < TICKS; ++tick)
+    {
+        effect.step();
+        effect.render(frame, LEDS);
+        changes += memcmp(prev, &frame[0], 3) != 0;
+        memcpy(prev, &frame[0], 3);
+    }
+    printf("    hsv cycle: %d frame changes in %d ticks\n", changes, TICKS);
+    check(changes > TICKS / 2, "HSV cycle keeps moving without getting stuck at an end");
+
+    printf("%s\n", failures ? "FAILED" : "all checks passed");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,419 @@
+// Host checks for live frame streaming (app/picture/live_stream.*) on the simulator (sim/).
+//
+// Boots the firmware with setup() on an empty card in a temporary directory,
+// runs loop() on its own thread in real time and streams the frames of an
+// MJPEG clip to LIVE_STREAM_PORT over loopback like tools/holo_live.py does.
+// Every frame goes through picture_process() and is decoded onto the
+// simulated panel. Checks:
+//   - paced at CHECK_PACED_FPS, every frame is acknowledged as shown, the
+//     panel shows it, and no frame takes longer than CHECK_MAX_LATENCY_MS
+//     from the sender's timestamp to its ACK
+//   - sent flat out, the device drops frames instead of queueing them, shows
+//     some, and never acknowledges a frame twice or one it was not sent
+//   - a sender that stops reading ACKs gets a well-framed ACK stream up to
+//     the point where the device drops it, and the next sender is served
+// Every ACK must echo the timestamp of its frame. The latency of the paced
+// and the flat-out phase is reported.
+// Exits non-zero when a check fails.
+//
+//     pio run -e live_stream_check
+//     .pio/build/live_stream_check/program
+
+#include "Arduino.h"
+#include "sim.h"
+#include "sim_check.h"
+#include "common.h"
+#include "app/picture/live_stream.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define CHECK_BOOT_TIMEOUT_MS 10000 // until the stream port accepts connections
+#define CHECK_PACED_FPS 10
+#define CHECK_PACED_FRAMES 40
+#define CHECK_MAX_LATENCY_MS 250    // paced, sender timestamp to ACK
+#define CHECK_BURST_FRAMES 300      // sent flat out
+#define CHECK_STALL_FRAMES 3000     // sent flat out to a sender that reads no ACKs
+#define CHECK_STALL_RCVBUF 2048     // receive buffer of that sender
+#define CHECK_ACK_TIMEOUT_MS 3000   // for the last ACK after the last frame
+#define CHECK_RECONNECT_MS 200      // for the device to notice a closed sender
+
+// 240x240, 104 frames of about 6KB
+static const char *const clip_source = "lib/Arduino_GFX/examples/ImgViewer/ImgViewerMjpeg/data/earth.mjpeg";
+
+static std::chrono::steady_clock::time_point start_time;
+
+// The sender's clock
+static uint32_t now_ms()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time)
+        .count();
+}
+
+static bool read_host_file(const char *path, std::string *data)
+{
+    FILE *fp = fopen(path, "rb");
+    if (NULL == fp)
+    {
+        return false;
+    }
+    char buf[4096];
+    size_t len;
+    while ((len = fread(buf, 1, sizeof(buf), fp)) > 0)
+    {
+        data->append(buf, len);
+    }
+    fclose(fp);
+    return true;
+}
+
+// The clip is concatenated JPEGs
+static std::vector<std::string> split_mjpeg(const std::string &data)
+{
+    std::vector<std::string> frames;
+    size_t pos = 0;
+    while (true)
+    {
+        size_t begin = data.find("\xff\xd8", pos);
+        size_t end = std::string::npos == begin ? begin : data.find("\xff\xd9", begin);
+        if (std::string::npos == end)
+        {
+            return frames;
+        }
+        frames.push_back(data.substr(begin, end + 2 - begin));
+        pos = end + 2;
+    }
+}
+
+static int connect_device(int rcvbuf = 0)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd >= 0 && rcvbuf > 0)
+    {
+        // Before connect(), so the window the device sees stays small
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    }
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(LIVE_STREAM_PORT);
+    if (fd < 0 || 0 != connect(fd, (struct sockaddr *)&addr, sizeof(addr)))
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return -1;
+    }
+    int enable = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    struct timeval tv = {CHECK_ACK_TIMEOUT_MS / 1000, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    return fd;
+}
+
+static void write_le32(uint8_t *p, uint32_t value)
+{
+    p[0] = value;
+    p[1] = value >> 8;
+    p[2] = value >> 16;
+    p[3] = value >> 24;
+}
+
+static uint32_t read_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool send_all(int fd, const uint8_t *data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t sent = ::send(fd, data, len, MSG_NOSIGNAL);
+        if (sent <= 0)
+        {
+            return false;
+        }
+        data += sent;
+        len -= sent;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------- stream
+
+struct Ack
+{
+    uint32_t seq;
+    uint32_t ts;
+    uint32_t status;
+    uint32_t at; // sender time of arrival
+};
+
+// One connection: what was sent and what came back
+struct LiveSender
+{
+    int fd;
+    std::mutex mutex;
+    std::map<uint32_t, uint32_t> sent; // seq -> ts
+    std::vector<Ack> acks;
+    bool closed = false; // the device ended the connection
+};
+
+static bool send_frame(LiveSender *sender, const std::string &jpg, uint32_t seq)
+{
+    uint8_t head[LIVE_FRAME_HEAD_SIZE];
+    uint32_t ts = now_ms();
+    memcpy(head, LIVE_FRAME_MAGIC, 4);
+    write_le32(head + 4, jpg.size());
+    write_le32(head + 8, seq);
+    write_le32(head + 12, ts);
+    {
+        std::lock_guard<std::mutex> lock(sender->mutex);
+        sender->sent[seq] = ts;
+    }
+    return send_all(sender->fd, head, sizeof(head)) &&
+           send_all(sender->fd, (const uint8_t *)jpg.data(), jpg.size());
+}
+
+// Reads ACKs until `expect` came back, the device ends the connection or
+// none came for CHECK_ACK_TIMEOUT_MS; a trailing partial ACK is left out
+static void read_acks(LiveSender *sender, size_t expect)
+{
+    uint8_t buf[LIVE_ACK_SIZE];
+    size_t got = 0;
+    while (true)
+    {
+        {
+            std::lock_guard<std::mutex> lock(sender->mutex);
+            if (sender->acks.size() >= expect)
+            {
+                return;
+            }
+        }
+        ssize_t len = recv(sender->fd, buf + got, sizeof(buf) - got, 0);
+        if (len <= 0)
+        {
+            std::lock_guard<std::mutex> lock(sender->mutex);
+            sender->closed = 0 == len || (errno != EAGAIN && errno != EWOULDBLOCK);
+            return;
+        }
+        got += len;
+        if (got < sizeof(buf))
+        {
+            continue;
+        }
+        got = 0;
+        Ack ack = {read_le32(buf), read_le32(buf + 4), read_le32(buf + 8), now_ms()};
+        std::lock_guard<std::mutex> lock(sender->mutex);
+        sender->acks.push_back(ack);
+    }
+}
+
+struct Summary
+{
+    int shown = 0;
+    int dropped = 0;
+    bool framed = true; // every ACK is for a frame that was sent, with its timestamp and a known status
+    bool unique = true; // no frame is acknowledged twice
+    std::vector<uint32_t> latency; // of the shown frames, sorted
+};
+
+static Summary summarize(LiveSender *sender)
+{
+    Summary sum;
+    std::map<uint32_t, int> seen;
+    for (const Ack &ack : sender->acks)
+    {
+        auto frame = sender->sent.find(ack.seq);
+        if (sender->sent.end() == frame || frame->second != ack.ts || ack.status > LIVE_ACK_DROPPED)
+        {
+            sum.framed = false;
+            continue;
+        }
+        sum.unique = sum.unique && 0 == seen[ack.seq]++;
+        if (LIVE_ACK_SHOWN == ack.status)
+        {
+            ++sum.shown;
+            sum.latency.push_back(ack.at - ack.ts);
+        }
+        else
+        {
+            ++sum.dropped;
+        }
+    }
+    std::sort(sum.latency.begin(), sum.latency.end());
+    return sum;
+}
+
+static void report(const char *name, const LiveSender &sender, const Summary &sum)
+{
+    printf("      %-10s %zu frames sent, %d shown, %d dropped", name, sender.sent.size(), sum.shown, sum.dropped);
+    if (!sum.latency.empty())
+    {
+        printf(", latency median %u ms, max %u ms", sum.latency[sum.latency.size() / 2], sum.latency.back());
+    }
+    printf("\n");
+}
+
+static bool panel_shows_frame()
+{
+    const uint16_t *fb = sim_framebuffer();
+    return std::any_of(fb, fb + SCREEN_HOR_RES * SCREEN_VER_RES, [](uint16_t pixel) { return 0 != pixel; });
+}
+
+static void check_paced(const std::vector<std::string> &clip)
+{
+    LiveSender sender;
+    sender.fd = connect_device();
+    std::thread reader(read_acks, &sender, CHECK_PACED_FRAMES);
+    bool sent = true;
+    for (uint32_t seq = 0; sent && seq < CHECK_PACED_FRAMES; ++seq)
+    {
+        sent = send_frame(&sender, clip[seq % clip.size()], seq);
+        usleep(1000000 / CHECK_PACED_FPS);
+    }
+    reader.join();
+    close(sender.fd);
+    Summary sum = summarize(&sender);
+    report("paced", sender, sum);
+    check(sent, "paced: every frame is sent");
+    check(sum.framed && sum.unique, "paced: every ACK is for a frame that was sent, once, with its timestamp");
+    check(CHECK_PACED_FRAMES == sum.shown, "paced: every frame is shown");
+    check(panel_shows_frame(), "paced: the frames are drawn on the panel");
+    check(!sum.latency.empty() && sum.latency.back() <= CHECK_MAX_LATENCY_MS,
+          "paced: no frame takes longer than CHECK_MAX_LATENCY_MS");
+}
+
+static void check_burst(const std::vector<std::string> &clip)
+{
+    LiveSender sender;
+    sender.fd = connect_device();
+    std::thread reader(read_acks, &sender, CHECK_BURST_FRAMES);
+    bool sent = true;
+    for (uint32_t seq = 0; sent && seq < CHECK_BURST_FRAMES; ++seq)
+    {
+        sent = send_frame(&sender, clip[seq % clip.size()], seq);
+    }
+    reader.join();
+    close(sender.fd);
+    Summary sum = summarize(&sender);
+    report("flat out", sender, sum);
+    check(sent, "flat out: every frame is sent");
+    check(sum.framed && sum.unique, "flat out: every ACK is for a frame that was sent, once, with its timestamp");
+    check(sum.shown + sum.dropped == CHECK_BURST_FRAMES, "flat out: every frame is acknowledged");
+    check(sum.dropped > 0, "flat out: frames are dropped");
+    check(sum.shown > 0, "flat out: frames are still shown");
+}
+
+static void check_stalled_reader(const std::vector<std::string> &clip)
+{
+    LiveSender sender;
+    sender.fd = connect_device(CHECK_STALL_RCVBUF);
+    uint32_t seq = 0;
+    while (seq < CHECK_STALL_FRAMES && send_frame(&sender, clip[seq % clip.size()], seq))
+    {
+        ++seq;
+    }
+    // Everything the device wrote while nobody read ACKs, then whatever follows
+    read_acks(&sender, CHECK_STALL_FRAMES);
+    close(sender.fd);
+    Summary sum = summarize(&sender);
+    printf("      %-10s %u frames sent, %zu ACKs read before the device closed the connection\n", "stalled", seq,
+           sender.acks.size());
+    check(sum.framed && sum.unique, "stalled reader: the ACKs it gets are well framed");
+    check(sender.closed, "stalled reader: the device drops it");
+
+    usleep(CHECK_RECONNECT_MS * 1000);
+    LiveSender next;
+    next.fd = connect_device();
+    bool sent = send_frame(&next, clip[0], 0);
+    read_acks(&next, 1);
+    close(next.fd);
+    check(sent && summarize(&next).framed && 1 == next.acks.size(), "stalled reader: the next sender is served");
+}
+
+// ---------------------------------------------------------------------- main
+
+static void loop_task()
+{
+    sim_set_loop_task();
+    while (true)
+    {
+        loop();
+    }
+}
+
+int main(int argc, char **argv)
+{
+    SimOptions options;
+    sim_default_options(&options);
+    options.quiet = true;
+    if (argc > 1)
+    {
+        fprintf(stderr, "usage: %s\n", argv[0]);
+        return 2;
+    }
+    std::string data;
+    std::vector<std::string> clip;
+    if (!read_host_file(clip_source, &data) || (clip = split_mjpeg(data)).empty())
+    {
+        fprintf(stderr, "live_stream_check: cannot read %s\n", clip_source);
+        return 2;
+    }
+    SimCheckDir work;
+    if (!sim_check_dir("live_stream_check", &work, &options))
+    {
+        return 2;
+    }
+    if (!sim_begin(&options))
+    {
+        sim_check_remove(work);
+        return 2;
+    }
+
+    sim_set_loop_task();
+    setup();
+    std::thread(loop_task).detach();
+
+    start_time = std::chrono::steady_clock::now();
+    int fd;
+    while ((fd = connect_device()) < 0 && now_ms() < CHECK_BOOT_TIMEOUT_MS)
+    {
+        usleep(20000);
+    }
+    check(fd >= 0, "the stream port accepts connections after boot");
+    if (fd >= 0)
+    {
+        close(fd);
+        usleep(CHECK_RECONNECT_MS * 1000);
+        check_paced(clip);
+        usleep(CHECK_RECONNECT_MS * 1000);
+        check_burst(clip);
+        usleep(CHECK_RECONNECT_MS * 1000);
+        check_stalled_reader(clip);
+    }
+
+    sim_end();
+    sim_check_remove(work);
+    printf(failures ? "live stream check FAILED (%d)\n" : "live stream check passed\n", failures);
+    fflush(stdout);
+    // Firmware tasks never return; leave without running static destructors under them
+    _exit(failures ? 1 : 0);
+}
@@ -0,0 +1,197 @@
+// Headless LVGL drawing check and benchmark with Holo's lv_conf.h on the host.
+//
+// A 240x240 display with a 240x80 draw buffer, as on the cube, and a flush
+// callback that only hashes what it gets. Modes:
+//   hash   runs lv_demo_benchmark with a fixed tick of BENCH_TICK_MS per
+//          lv_timer_handler() call, so the frames do not depend on the host
+//          speed, and prints the number of flushed areas and an FNV-1a hash
+//          of their pixels. Two builds that draw the same give the same line.
+//   time   the same run, reporting the wall time
+//   blend  ns per pixel of the unmasked fill, copy and map paths of
+//          lv_draw_sw_blend_basic() on a 240x80 buffer
+//
+// Compare the RGB565 word-wide blend kernels with the pixel loops:
+//
+//     L=../lib/lvgl-v8.3
+//     SRCS=$(find $L/src $L/demos/benchmark -name '*.c')
+//     for wide in 0 1; do
+//         gcc -O2 -w -I. -I$L -I$L/.. -DLV_CONF_PATH=lvgl_bench_conf.h -DLV_DRAW_SW_RGB565_WIDE=$wide -o lvgl_bench_$wide lvgl_bench.c $SRCS
+//     done
+//     ./lvgl_bench_0 hash && ./lvgl_bench_1 hash
+//     ./lvgl_bench_0 blend && ./lvgl_bench_1 blend
+//
+// For blend timings closer to the scalar Xtensa core, build with
+// -Os -fno-tree-vectorize instead of -O2.
+
+#include "lvgl.h"
+#include "demos/benchmark/lv_demo_benchmark.h"
+#include "src/draw/sw/lv_draw_sw.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_HOR_RES 240
+#define BENCH_VER_RES 240
+#define BENCH_BUF_LINES 80
+#define BENCH_TICK_MS 2
+#define BENCH_BLEND_ITERS 3000
+#define BENCH_BLEND_REPEAT 5 // the best of these is reported
+
+static int fixed_tick;
+static int hash_frames;
+static uint32_t tick_ms;
+static uint64_t hash = 1469598103934665603ULL;
+static uint32_t flushed;
+static volatile int finished;
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+uint32_t bench_tick(void)
+{
+    return fixed_tick ? tick_ms : (uint32_t)(now_s() * 1000);
+}
+
+static void flush_cb(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *px)
+{
+    if (hash_frames)
+    {
+        const uint8_t *p = (const uint8_t *)px;
+        size_t len = lv_area_get_size(area) * sizeof(lv_color_t);
+        for (size_t i = 0; i < len; i++)
+        {
+            hash = (hash ^ p[i]) * 1099511628211ULL;
+        }
+        ++flushed;
+    }
+    lv_disp_flush_ready(drv);
+}
+
+struct BlendCase
+{
+    const char *name;
+    int map;      // copy/map from a source buffer instead of a fill
+    int src_ofs;  // 1 puts the source half a word off the destination
+    lv_opa_t opa;
+    lv_coord_t x1;
+    int plain;    // the destination is one color (the color caches hit)
+};
+
+static void blend_bench(void)
+{
+    static lv_color_t dest[BENCH_HOR_RES * BENCH_BUF_LINES];
+    static lv_color_t src[BENCH_HOR_RES * BENCH_BUF_LINES + 1];
+    static const struct BlendCase cases[] = {
+        {"fill opaque", 0, 0, LV_OPA_COVER, 1, 1},
+        {"fill 50%, plain background", 0, 0, LV_OPA_50, 1, 1},
+        {"fill 50%, busy background", 0, 0, LV_OPA_50, 1, 0},
+        {"copy", 1, 0, LV_OPA_COVER, 0, 0},
+        {"copy, half a word off", 1, 1, LV_OPA_COVER, 1, 0},
+        {"map 50%", 1, 0, LV_OPA_50, 0, 0},
+        {"map 50%, half a word off", 1, 1, LV_OPA_50, 1, 0},
+    };
+    const uint32_t px_num = BENCH_HOR_RES * BENCH_BUF_LINES;
+    for (uint32_t i = 0; i < px_num + 1; i++)
+    {
+        src[i].full = (uint16_t)(i * 2654435761u >> 7);
+    }
+    _lv_refr_set_disp_refreshing(lv_disp_get_default());
+    lv_area_t buf_area = {0, 0, BENCH_HOR_RES - 1, BENCH_BUF_LINES - 1};
+    for (unsigned c = 0; c < sizeof(cases) / sizeof(cases[0]); c++)
+    {
+        const struct BlendCase *bc = &cases[c];
+        lv_area_t area = {bc->x1, 0, BENCH_HOR_RES - 2, BENCH_BUF_LINES - 1};
+        lv_draw_ctx_t ctx;
+        memset(&ctx, 0, sizeof(ctx));
+        ctx.buf = dest;
+        ctx.buf_area = &buf_area;
+        ctx.clip_area = &buf_area;
+        lv_draw_sw_blend_dsc_t dsc;
+        memset(&dsc, 0, sizeof(dsc));
+        dsc.blend_area = &area;
+        dsc.src_buf = bc->map ? src + bc->src_ofs : NULL;
+        dsc.color.full = 0x3a6f;
+        dsc.opa = bc->opa;
+        dsc.mask_res = LV_DRAW_MASK_RES_FULL_COVER;
+        double best = 1e9;
+        for (int rep = 0; rep < BENCH_BLEND_REPEAT; rep++)
+        {
+            for (uint32_t i = 0; i < px_num; i++)
+            {
+                dest[i].full = bc->plain ? 0x1082 : (uint16_t)(i * 40503u);
+            }
+            double start = now_s();
+            for (int i = 0; i < BENCH_BLEND_ITERS; i++)
+            {
+                if (!bc->plain && !bc->map && bc->opa < LV_OPA_MAX)
+                {
+                    // A fill over its own output would find a plain background again
+                    dest[i % px_num].full ^= 0x5555;
+                }
+                lv_draw_sw_blend_basic(&ctx, &dsc);
+            }
+            double ns = (now_s() - start) / BENCH_BLEND_ITERS / lv_area_get_size(&area) * 1e9;
+            best = ns < best ? ns : best;
+        }
+        printf("%-30s %6.2f ns/px\n", bc->name, best);
+    }
+}
+
+static void benchmark_finished(void)
+{
+    finished = 1;
+}
+
+int main(int argc, char **argv)
+{
+    const char *mode = argc > 1 ? argv[1] : "";
+    if (argc != 2 || (strcmp(mode, "hash") && strcmp(mode, "time") && strcmp(mode, "blend")))
+    {
+        fprintf(stderr, "usage: %s hash|time|blend\n", argv[0]);
+        return 2;
+    }
+    hash_frames = !strcmp(mode, "hash");
+    fixed_tick = strcmp(mode, "blend");
+
+    lv_init();
+    static lv_disp_draw_buf_t draw_buf;
+    static lv_color_t buf[BENCH_HOR_RES * BENCH_BUF_LINES];
+    lv_disp_draw_buf_init(&draw_buf, buf, NULL, BENCH_HOR_RES * BENCH_BUF_LINES);
+    static lv_disp_drv_t drv;
+    lv_disp_drv_init(&drv);
+    drv.hor_res = BENCH_HOR_RES;
+    drv.ver_res = BENCH_VER_RES;
+    drv.flush_cb = flush_cb;
+    drv.draw_buf = &draw_buf;
+    lv_disp_drv_register(&drv);
+
+    if (!strcmp(mode, "blend"))
+    {
+        blend_bench();
+        return 0;
+    }
+
+    double start = now_s();
+    lv_demo_benchmark_set_finished_cb(benchmark_finished);
+    lv_demo_benchmark_set_max_speed(true);
+    lv_demo_benchmark();
+    while (!finished)
+    {
+        lv_timer_handler();
+        tick_ms += BENCH_TICK_MS;
+    }
+    if (hash_frames)
+    {
+        printf("%u areas, hash %016llx\n", flushed, (unsigned long long)hash);
+    }
+    else
+    {
+        printf("%.3f s\n", now_s() - start);
+    }
+    return 0;
+}
@@ -0,0 +1,26 @@
+// Holo's lv_conf.h for tools/lvgl_bench.c: the same drawing options, with the
+// demo benchmark and its fonts, a log on stdout and a tick driven by the tool.
+
+#include "../lib/lvgl-v8.3/lv_conf.h"
+
+#undef LV_TICK_CUSTOM_INCLUDE
+#undef LV_TICK_CUSTOM_SYS_TIME_EXPR
+#define LV_TICK_CUSTOM_INCLUDE <stdint.h>
+uint32_t bench_tick(void);
+#define LV_TICK_CUSTOM_SYS_TIME_EXPR (bench_tick())
+
+#undef LV_USE_LOG
+#define LV_USE_LOG 1
+#define LV_LOG_LEVEL LV_LOG_LEVEL_USER
+#define LV_LOG_PRINTF 1
+
+#undef LV_USE_DEMO_BENCHMARK
+#define LV_USE_DEMO_BENCHMARK 1
+#undef LV_FONT_MONTSERRAT_12
+#define LV_FONT_MONTSERRAT_12 1
+#undef LV_FONT_MONTSERRAT_28
+#define LV_FONT_MONTSERRAT_28 1
+
+// The demo needs more than the firmware's pool
+#undef LV_MEM_SIZE
+#define LV_MEM_SIZE (128U * 1024U)
@@ -0,0 +1,356 @@
+// Host checks for the MQTT printer status client (mqtt_status.*).
+//
+// Runs mqtt_status.cpp and PubSubClient with the rest of the firmware on the
+// simulator's network shims (sim/) against a minimal fake broker on a
+// loopback socket, the way the file service check talks to
+// file_conn_process() over a real socket. The broker address goes into the
+// settings as config.txt would put it there. The firmware is not booted;
+// update_print_status() is wrapped at link time (the env's
+// -Wl,--wrap=_Z19update_print_statusiii, the mangled name) so that here it
+// only records what it was called with.
+//
+// The client must connect with its holo-xxxxxx id and subscribe to the topic
+// and topic/+; a "prog;head;bed" message sets all three values, a single
+// value on topic/progress, /head or /bed keeps the other two, a message on
+// another subtopic is ignored and a payload longer than
+// MQTT_PAYLOAD_MAX_LEN is cut instead of overrunning. After the broker drops
+// the connection the client comes back at once, and while the broker refuses
+// it, retries MQTT_RECONNECT_MIN apart and then twice as long.
+// Exits non-zero when a check fails.
+//
+//     pio run -e mqtt_status_check
+//     .pio/build/mqtt_status_check/program
+
+#include "Arduino.h"
+#include "WiFi.h"
+#include "sim.h"
+#include "sim_check.h"
+#include "mqtt_status.h"
+#include "sys/settings.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define CHECK_TOPIC "holo/check"
+#define CHECK_CONNECT_MS 3000  // from init or a drop to the CONNECT
+#define CHECK_STATUS_MS 500    // from a PUBLISH to update_print_status()
+#define CHECK_RETRY_SLACK_MS 400
+
+static uint64_t now_ms()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// ------------------------------------------------------------ print status
+
+struct Status
+{
+    int progress;
+    int head;
+    int bed;
+};
+
+static std::mutex status_mutex;
+static std::vector<Status> statuses;
+
+// Takes the place of update_print_status() (app/picture/picture.cpp) for every caller
+extern "C" void __wrap__Z19update_print_statusiii(int pro, int head, int temp)
+{
+    std::lock_guard<std::mutex> lock(status_mutex);
+    statuses.push_back({pro, head, temp});
+}
+
+// Waits for the next update_print_status() call
+static bool next_status(Status *status, int timeout_ms = CHECK_STATUS_MS)
+{
+    uint64_t until = now_ms() + timeout_ms;
+    do
+    {
+        {
+            std::lock_guard<std::mutex> lock(status_mutex);
+            if (!statuses.empty())
+            {
+                *status = statuses.front();
+                statuses.erase(statuses.begin());
+                return true;
+            }
+        }
+        usleep(5000);
+    } while (now_ms() < until);
+    return false;
+}
+
+// ------------------------------------------------------------ fake broker
+
+struct Packet
+{
+    uint8_t type; // first byte
+    std::string body;
+};
+
+static bool read_exact(int fd, void *buf, size_t len, int timeout_ms)
+{
+    uint8_t *pos = (uint8_t *)buf;
+    uint64_t until = now_ms() + timeout_ms;
+    while (len > 0)
+    {
+        struct pollfd pfd = {fd, POLLIN, 0};
+        int left = (int)(until - now_ms());
+        if (left <= 0 || poll(&pfd, 1, left) <= 0)
+        {
+            return false;
+        }
+        ssize_t got = recv(fd, pos, len, 0);
+        if (got <= 0)
+        {
+            return false;
+        }
+        pos += got;
+        len -= got;
+    }
+    return true;
+}
+
+static bool read_packet(int fd, Packet *packet, int timeout_ms = CHECK_STATUS_MS)
+{
+    uint8_t byte;
+    if (!read_exact(fd, &packet->type, 1, timeout_ms))
+    {
+        return false;
+    }
+    size_t len = 0;
+    int shift = 0;
+    do
+    {
+        if (shift > 21 || !read_exact(fd, &byte, 1, timeout_ms))
+        {
+            return false;
+        }
+        len |= (size_t)(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    packet->body.resize(len);
+    return 0 == len || read_exact(fd, &packet->body[0], len, timeout_ms);
+}
+
+static void send_packet(int fd, uint8_t type, const std::string &body)
+{
+    std::string raw(1, (char)type);
+    size_t len = body.size();
+    do
+    {
+        uint8_t byte = len & 0x7F;
+        len >>= 7;
+        raw += (char)(byte | (len ? 0x80 : 0));
+    } while (len);
+    raw += body;
+    send(fd, raw.data(), raw.size(), MSG_NOSIGNAL);
+}
+
+static std::string mqtt_string(const std::string &text)
+{
+    return std::string(1, (char)(text.size() >> 8)) + (char)(text.size() & 0xFF) + text;
+}
+
+static void publish(int fd, const std::string &topic, const std::string &payload)
+{
+    send_packet(fd, 0x30, mqtt_string(topic) + payload);
+}
+
+// Accepts the next connection and reads its CONNECT; returns the fd or -1
+static int accept_connect(int listen_fd, std::string *client_id, int timeout_ms = CHECK_CONNECT_MS)
+{
+    struct pollfd pfd = {listen_fd, POLLIN, 0};
+    if (poll(&pfd, 1, timeout_ms) <= 0)
+    {
+        return -1;
+    }
+    int fd = accept(listen_fd, NULL, NULL);
+    Packet packet;
+    if (fd < 0 || !read_packet(fd, &packet) || 0x10 != packet.type || packet.body.size() < 12 ||
+        packet.body.compare(0, 6, mqtt_string("MQTT")))
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return -1;
+    }
+    // Protocol name, level, flags, keep alive, then the client id
+    size_t id_len = ((uint8_t)packet.body[10] << 8) | (uint8_t)packet.body[11];
+    *client_id = packet.body.substr(12, id_len);
+    return fd;
+}
+
+// Answers CONNACK and every SUBSCRIBE until none comes for a while; returns the topics
+static std::vector<std::string> accept_session(int fd)
+{
+    send_packet(fd, 0x20, std::string("\0\0", 2));
+    std::vector<std::string> topics;
+    Packet packet;
+    while (read_packet(fd, &packet, 300))
+    {
+        if (0x82 != packet.type || packet.body.size() < 5)
+        {
+            continue;
+        }
+        size_t pos = 2;
+        while (pos + 3 <= packet.body.size())
+        {
+            size_t len = ((uint8_t)packet.body[pos] << 8) | (uint8_t)packet.body[pos + 1];
+            topics.push_back(packet.body.substr(pos + 2, len));
+            pos += 2 + len + 1; // and the requested QoS
+        }
+        send_packet(fd, 0x90, packet.body.substr(0, 2) + std::string(1, '\0'));
+    }
+    return topics;
+}
+
+// ------------------------------------------------------------ checks
+
+static void check_messages(int fd)
+{
+    Status status;
+    publish(fd, CHECK_TOPIC, "42;210;60");
+    check(next_status(&status) && 42 == status.progress && 210 == status.head && 60 == status.bed,
+          "prog;head;bed sets all three values");
+    publish(fd, CHECK_TOPIC "/bed", "65");
+    check(next_status(&status) && 42 == status.progress && 210 == status.head && 65 == status.bed,
+          "a single value keeps the other two");
+    publish(fd, CHECK_TOPIC "/progress", "43");
+    publish(fd, CHECK_TOPIC "/head", "215");
+    bool both = next_status(&status) && 43 == status.progress && next_status(&status) && 215 == status.head &&
+                43 == status.progress && 65 == status.bed;
+    check(both, "messages arriving back to back are all applied");
+    publish(fd, CHECK_TOPIC "/fan", "100");
+    check(!next_status(&status, 300), "other subtopics are ignored");
+    std::string longer = "55;200;70" + std::string(3 * MQTT_PAYLOAD_MAX_LEN, ' ') + "99";
+    publish(fd, CHECK_TOPIC, longer);
+    check(next_status(&status) && 55 == status.progress && 200 == status.head && 70 == status.bed,
+          "a long payload is cut at MQTT_PAYLOAD_MAX_LEN");
+}
+
+static void check_reconnect(int listen_fd, int fd)
+{
+    std::string client_id;
+    uint64_t dropped = now_ms();
+    close(fd);
+    fd = accept_connect(listen_fd, &client_id);
+    check(fd >= 0 && now_ms() - dropped < MQTT_RECONNECT_MIN + CHECK_RETRY_SLACK_MS,
+          "the client reconnects after the broker drops it");
+
+    // Refused twice (bad user name or password): the interval doubles
+    uint64_t attempts[3] = {now_ms(), 0, 0};
+    for (int pos = 0; pos < 3 && fd >= 0; ++pos)
+    {
+        if (pos > 0)
+        {
+            fd = accept_connect(listen_fd, &client_id, MQTT_RECONNECT_MIN * 4 + CHECK_RETRY_SLACK_MS);
+            attempts[pos] = now_ms();
+        }
+        if (fd >= 0 && pos < 2)
+        {
+            send_packet(fd, 0x20, std::string("\0\5", 2));
+            // the client closes a refused connection
+            Packet packet;
+            read_packet(fd, &packet, 300);
+            close(fd);
+        }
+    }
+    long first = (long)(attempts[1] - attempts[0]);
+    long second = (long)(attempts[2] - attempts[1]);
+    printf("      retries after %ld ms and %ld ms\n", first, second);
+    check(fd >= 0 && labs(first - 2 * MQTT_RECONNECT_MIN) < CHECK_RETRY_SLACK_MS &&
+              labs(second - 4 * MQTT_RECONNECT_MIN) < CHECK_RETRY_SLACK_MS,
+          "refused connections are retried with a doubling interval");
+    if (fd < 0)
+    {
+        return;
+    }
+    accept_session(fd);
+    Status status;
+    publish(fd, CHECK_TOPIC "/progress", "80");
+    check(next_status(&status) && 80 == status.progress && 200 == status.head && 70 == status.bed,
+          "after reconnecting messages are applied on top of the last values");
+    close(fd);
+}
+
+int main()
+{
+    SimOptions options;
+    sim_default_options(&options);
+    options.quiet = true;
+    SimCheckDir work;
+    if (!sim_check_dir("mqtt_status_check", &work, &options))
+    {
+        return 2;
+    }
+    if (!sim_begin(&options))
+    {
+        sim_check_remove(work);
+        return 2;
+    }
+    WiFi.mode(WIFI_STA);
+    WiFi.begin("check");
+
+    // The broker, on a port of its own (bind() goes through the simulator's wrapper)
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_len = sizeof(addr);
+    if (listen_fd < 0 || 0 != bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) ||
+        0 != listen(listen_fd, 4) || 0 != getsockname(listen_fd, (struct sockaddr *)&addr, &addr_len))
+    {
+        perror("mqtt_status_check: broker socket");
+        sim_check_remove(work);
+        return 2;
+    }
+    int broker_port = ntohs(addr.sin_port);
+
+    if (!settings_init())
+    {
+        printf("FAIL  the settings open\n");
+        sim_check_remove(work);
+        return 2;
+    }
+    settings_set_str(SETTINGS_TXT_PREFIX "mqtt_host", "127.0.0.1");
+    settings_set_str(SETTINGS_TXT_PREFIX "mqtt_port", String(broker_port).c_str());
+    settings_set_str(SETTINGS_TXT_PREFIX "mqtt_topic", CHECK_TOPIC);
+
+    check(mqtt_status_init(), "the client starts when mqtt_host is set");
+    std::string client_id;
+    int fd = accept_connect(listen_fd, &client_id);
+    check(fd >= 0, "the client connects to the broker");
+    check(0 == client_id.compare(0, 5, "holo-") && 11 == client_id.size(), "the client id is holo-xxxxxx");
+    if (fd >= 0)
+    {
+        std::vector<std::string> topics = accept_session(fd);
+        check(2 == topics.size() && CHECK_TOPIC == topics[0] && CHECK_TOPIC "/+" == topics[1],
+              "the client subscribes to the topic and its subtopics");
+        check_messages(fd);
+        check_reconnect(listen_fd, fd);
+    }
+
+    sim_end();
+    close(listen_fd);
+    sim_check_remove(work);
+    printf(failures ? "mqtt status check FAILED (%d)\n" : "mqtt status check passed\n", failures);
+    fflush(stdout);
+    // The client task never returns; leave without running static destructors under it
+    _exit(failures ? 1 : 0);
+}
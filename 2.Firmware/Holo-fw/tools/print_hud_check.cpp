@@ -0,0 +1,200 @@
+// Host check for the printer status bar of the picture app (app/picture/print_hud.*), on the simulator (sim/).
+//
+// Brings up the display as the firmware does (Display::init(): LVGL on the
+// simulated panel), creates the status bar on an empty screen and counts the
+// areas LVGL invalidates for each status update. The panel above
+// print_hud_top() belongs to the decoded JPEG frames, so it is painted with a
+// pattern first and must come out of every LVGL refresh untouched. Checks:
+//   - nothing is drawn and the frames keep the whole screen before the first
+//     status
+//   - the first status invalidates one area per field, each inside the bar
+//     and covering that field only
+//   - unchanged values invalidate nothing, a changed field only itself
+//   - updates closer than PRINT_HUD_INTERVAL are coalesced and show the
+//     latest values
+// Exits non-zero when a check fails.
+//
+//     pio run -e print_hud_check
+//     .pio/build/print_hud_check/program
+
+#include "Arduino.h"
+#include "sim.h"
+#include "sim_check.h"
+#include "common.h"
+#include "app/picture/print_hud.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#define CHECK_START_MS 1000
+#define CHECK_FRAME_COLOR 0x7BEF // the stand-in for a photo above the bar
+
+static lv_obj_t *hud_bar()
+{
+    return lv_obj_get_child(lv_scr_act(), 0);
+}
+
+// The fields sit in a row at the bottom of the bar
+static lv_obj_t *hud_field(int index)
+{
+    return lv_obj_get_child(lv_obj_get_child(hud_bar(), 0), index);
+}
+
+static uint16_t inv_count()
+{
+    return lv_disp_get_default()->inv_p;
+}
+
+static const lv_area_t *inv_area(int index)
+{
+    return &lv_disp_get_default()->inv_areas[index];
+}
+
+// Draws whatever is pending so the next update starts with no invalidated area
+static void flush()
+{
+    lv_refr_now(NULL);
+}
+
+// The rows above the bar as the frames left them
+static std::vector<uint16_t> frame_rows(lv_coord_t top)
+{
+    const uint16_t *fb = sim_framebuffer();
+    return std::vector<uint16_t>(fb, fb + top * SCREEN_HOR_RES);
+}
+
+// A fresh bar with nothing pending and the frame painted above it
+static void fresh()
+{
+    print_hud_delete();
+    print_hud_create(lv_scr_act(), &lv_font_montserrat_16);
+    flush();
+    tft->fillRect(0, 0, SCREEN_HOR_RES, hud_bar()->coords.y1, CHECK_FRAME_COLOR);
+}
+
+static bool covers_center(const lv_area_t *area, const lv_obj_t *obj)
+{
+    lv_point_t center;
+    center.x = (obj->coords.x1 + obj->coords.x2) / 2;
+    center.y = (obj->coords.y1 + obj->coords.y2) / 2;
+    return _lv_area_is_point_on(area, &center, 0);
+}
+
+// The invalidated area `index` is inside the bar and covers field `field` only
+static bool field_area(int index, int field)
+{
+    if (!_lv_area_is_in(inv_area(index), &hud_bar()->coords, 0))
+    {
+        return false;
+    }
+    for (int f = 0; f < PRINT_HUD_FIELDS; ++f)
+    {
+        if ((f == field) != covers_center(inv_area(index), hud_field(f)))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Refreshes at `now`, reports what was invalidated and draws it; checks the
+// areas against `fields` (-1 terminated) and that the frame above the bar is
+// left alone
+static void update(uint32_t now, const int *fields, const char *name)
+{
+    std::vector<uint16_t> before = frame_rows(hud_bar()->coords.y1);
+    int rendered = print_hud_refresh(now);
+    int areas = inv_count();
+    int expect = 0;
+    bool placed = true;
+    for (; fields[expect] >= 0; ++expect)
+    {
+        placed = placed && expect < areas && field_area(expect, fields[expect]);
+    }
+    flush();
+    printf("      %-28s %d fields rendered, %d areas invalidated\n", name, rendered, areas);
+
+    char what[160];
+    snprintf(what, sizeof(what), "%s: %d fields rendered, one area each", name, expect);
+    check(expect == rendered && expect == areas, what);
+    if (expect > 0)
+    {
+        snprintf(what, sizeof(what), "%s: each area is inside the bar and covers its field only", name);
+        check(placed, what);
+    }
+    snprintf(what, sizeof(what), "%s: the frame above the bar is left alone", name);
+    check(before == frame_rows(hud_bar()->coords.y1), what);
+}
+
+int main(int argc, char **argv)
+{
+    SimOptions options;
+    sim_default_options(&options);
+    options.quiet = true;
+    if (argc > 1)
+    {
+        fprintf(stderr, "usage: %s\n", argv[0]);
+        return 2;
+    }
+    SimCheckDir work;
+    if (!sim_check_dir("print_hud_check", &work, &options))
+    {
+        return 2;
+    }
+    if (!sim_begin(&options))
+    {
+        sim_check_remove(work);
+        return 2;
+    }
+    sim_set_loop_task();
+    screen.init(0, 100);
+
+    static const int none[] = {-1};
+    static const int all[] = {0, 1, 2, -1};
+    static const int head[] = {1, -1};
+    static const int progress_bed[] = {0, 2, -1};
+    static const int progress[] = {0, -1};
+    uint32_t now = CHECK_START_MS;
+
+    // The frames may use the whole screen until there is a status to show
+    fresh();
+    check(SCREEN_VER_RES == print_hud_top(), "before a status the frames keep the whole screen");
+    update(now, none, "before a status");
+
+    fresh();
+    print_hud_set(12, 210, 60);
+    update(now, all, "first status");
+    check(hud_bar()->coords.y1 == print_hud_top() &&
+              SCREEN_VER_RES - PRINT_HUD_MARGIN - PRINT_HUD_HEIGHT == print_hud_top(),
+          "with a status the frames stop at the top of the bar");
+    check(!strcmp("Head: #ff0000 210#", lv_label_get_text(hud_field(1))), "the fields show the status");
+
+    print_hud_set(12, 210, 60);
+    update(now += PRINT_HUD_INTERVAL, none, "unchanged values");
+    print_hud_set(12, 215, 60);
+    update(now += PRINT_HUD_INTERVAL, head, "head temperature changed");
+    print_hud_set(13, 215, 61);
+    update(now += PRINT_HUD_INTERVAL, progress_bed, "progress and bed changed");
+
+    // Too early: nothing is drawn, only the latest values are kept
+    print_hud_set(20, 215, 61);
+    update(now + PRINT_HUD_INTERVAL / 2, none, "half an interval later");
+    print_hud_set(21, 215, 61);
+    update(now + PRINT_HUD_INTERVAL - 1, none, "just before the interval");
+    update(now += PRINT_HUD_INTERVAL, progress, "one interval later");
+    check(!strcmp("#00ff00 Pro:# 21%", lv_label_get_text(hud_field(0))), "coalesced updates show the latest value");
+    update(now += 3 * PRINT_HUD_INTERVAL, none, "nothing pending");
+
+    print_hud_delete();
+    sim_end();
+    sim_check_remove(work);
+    printf(failures ? "print hud check FAILED (%d)\n" : "print hud check passed\n", failures);
+    fflush(stdout);
+    // Firmware tasks never return; leave without running static destructors under them
+    _exit(failures ? 1 : 0);
+}
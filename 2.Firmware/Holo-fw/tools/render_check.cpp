@@ -0,0 +1,408 @@
+// Render regression and performance check for the picture app on the host
+// simulator (sim/).
+//
+// Builds an SD card in a temporary directory with one model of each kind the
+// app plays, made from JPEGs already in the tree:
+//     /seq/1.jpg .. 11.jpg   JPEG sequence (a printed model's layers)
+//     /still/1.jpg           still: a sequence of one image
+//     /clip.mjpeg            MJPEG video (Arduino_GFX's example clip)
+// boots the firmware with setup() under virtual time, then selects each model
+// in turn with a TURN_RIGHT and calls picture_process() --frames times (the
+// call with the gesture is frame 0). After every call the framebuffer hash,
+// the bytes that went to the panel and the CPU time of the call are recorded.
+//
+// --save writes them out; --golden compares hashes and bytes with a saved run
+// and fails on any difference; --baseline compares the CPU time of every
+// model and fails when it grew by more than --threshold percent (and by at
+// least RENDER_MIN_REGRESSION_US). Times are only comparable on the machine
+// and build that saved the baseline, so save one before a change and compare
+// after it; the golden file in the tree is the reference output.
+// --dump DIR writes the first diverging frame of every model as a PPM.
+// Exits non-zero when a check fails.
+//
+//     pio run -e render_check
+//     .pio/build/render_check/program --golden tools/render_golden.txt --save base.txt
+//     (change the renderer, rebuild)
+//     .pio/build/render_check/program --golden tools/render_golden.txt --baseline base.txt
+
+#include "Arduino.h"
+#include "sim.h"
+#include "sim_check.h"
+#include "driver/imu.h"
+#include "app/picture/picture.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#define RENDER_FRAMES 12
+#define RENDER_THRESHOLD 25           // percent
+#define RENDER_MIN_REGRESSION_US 500  // smaller growth is noise on a desktop
+#define RENDER_SEQ_FRAMES 11          // picture_process() cycles 1.jpg .. 11.jpg
+#define RENDER_START_MS 2000          // playback starts at this time, however long boot took
+
+// 240x240, 104 frames of about 6KB: the player only takes frames below 10000 bytes
+static const char *const clip_source = "lib/Arduino_GFX/examples/ImgViewer/ImgViewerMjpeg/data/earth.mjpeg";
+static const char *const sources[] = {
+    "../../5.Docs/Assets/logo.jpg",
+    "lib/TFT_eSPI/examples/Sprite/Animated_dial/data/dial.jpg",
+    "lib/TJpg_Decoder/examples/SD Card/SD_Jpg/data/panda.jpg",
+    "lib/TJpg_Decoder/examples/SPIFFS/All_SPIFFS/Data/tiger.jpg",
+};
+#define SOURCE_NUM (sizeof(sources) / sizeof(sources[0]))
+
+// In the order the app lists them (clip.mjpeg is shown first, without playing)
+static const char *const cases[] = {"seq", "still", "mjpeg"};
+#define CASE_NUM (sizeof(cases) / sizeof(cases[0]))
+
+struct Frame
+{
+    uint64_t hash;
+    uint64_t bytes;
+    uint64_t cpu_us;
+};
+
+typedef std::map<std::string, std::vector<Frame>> Results;
+
+static bool read_file(const char *path, std::string *data)
+{
+    FILE *fp = fopen(path, "rb");
+    if (NULL == fp)
+    {
+        fprintf(stderr, "render_check: cannot read %s\n", path);
+        return false;
+    }
+    char buf[4096];
+    size_t len;
+    data->clear();
+    while ((len = fread(buf, 1, sizeof(buf), fp)) > 0)
+    {
+        data->append(buf, len);
+    }
+    fclose(fp);
+    return true;
+}
+
+static bool write_file(const std::string &path, const std::string &data)
+{
+    FILE *fp = fopen(path.c_str(), "wb");
+    if (NULL == fp || data.size() != fwrite(data.data(), 1, data.size(), fp))
+    {
+        fprintf(stderr, "render_check: cannot write %s\n", path.c_str());
+        if (NULL != fp)
+        {
+            fclose(fp);
+        }
+        return false;
+    }
+    return 0 == fclose(fp);
+}
+
+static bool make_content(const std::string &sd)
+{
+    std::string images[SOURCE_NUM];
+    for (size_t pos = 0; pos < SOURCE_NUM; ++pos)
+    {
+        if (!read_file(sources[pos], &images[pos]))
+        {
+            return false;
+        }
+    }
+    if (0 != mkdir((sd + "/seq").c_str(), 0755) || 0 != mkdir((sd + "/still").c_str(), 0755))
+    {
+        fprintf(stderr, "render_check: cannot create %s\n", sd.c_str());
+        return false;
+    }
+    for (int frame = 0; frame < RENDER_SEQ_FRAMES; ++frame)
+    {
+        if (!write_file(sd + "/seq/" + std::to_string(frame + 1) + ".jpg", images[frame % SOURCE_NUM]))
+        {
+            return false;
+        }
+    }
+    std::string clip;
+    return read_file(clip_source, &clip) && write_file(sd + "/still/1.jpg", images[0]) &&
+           write_file(sd + "/clip.mjpeg", clip);
+}
+
+static bool load_results(const char *path, Results *results)
+{
+    FILE *fp = fopen(path, "r");
+    if (NULL == fp)
+    {
+        fprintf(stderr, "render_check: cannot read %s\n", path);
+        return false;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), fp))
+    {
+        char name[32];
+        unsigned index;
+        unsigned long long hash, bytes, cpu_us;
+        if ('#' == line[0] || 5 != sscanf(line, "%31s %u %llx %llu %llu", name, &index, &hash, &bytes, &cpu_us))
+        {
+            continue;
+        }
+        std::vector<Frame> &frames = (*results)[name];
+        if (index != frames.size())
+        {
+            fprintf(stderr, "render_check: %s: frames of %s out of order\n", path, name);
+            fclose(fp);
+            return false;
+        }
+        frames.push_back({hash, bytes, cpu_us});
+    }
+    fclose(fp);
+    return true;
+}
+
+static bool save_results(const char *path, const Results &results)
+{
+    FILE *fp = fopen(path, "w");
+    if (NULL == fp)
+    {
+        fprintf(stderr, "render_check: cannot write %s\n", path);
+        return false;
+    }
+    fprintf(fp, "# render_check: model frame framebuffer-hash panel-bytes cpu-us\n");
+    for (size_t pos = 0; pos < CASE_NUM; ++pos)
+    {
+        const std::vector<Frame> &frames = results.at(cases[pos]);
+        for (size_t index = 0; index < frames.size(); ++index)
+        {
+            fprintf(fp, "%s %u %016llx %llu %llu\n", cases[pos], (unsigned)index,
+                    (unsigned long long)frames[index].hash, (unsigned long long)frames[index].bytes,
+                    (unsigned long long)frames[index].cpu_us);
+        }
+    }
+    return 0 == fclose(fp);
+}
+
+static uint64_t total_cpu(const std::vector<Frame> &frames)
+{
+    uint64_t sum = 0;
+    for (const Frame &frame : frames)
+    {
+        sum += frame.cpu_us;
+    }
+    return sum;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [--frames N] [--golden FILE] [--baseline FILE] [--threshold PCT] [--save FILE]\n"
+            "          [--dump DIR] [--partitions CSV] [--port-offset N]\n",
+            prog);
+}
+
+int main(int argc, char **argv)
+{
+    SimOptions options;
+    sim_default_options(&options);
+    options.virtual_time = true;
+    options.quiet = true;
+    int frame_num = RENDER_FRAMES;
+    int threshold = RENDER_THRESHOLD;
+    const char *golden_path = NULL;
+    const char *baseline_path = NULL;
+    const char *save_path = NULL;
+    const char *dump_dir = NULL;
+
+    for (int pos = 1; pos < argc; ++pos)
+    {
+        const char *arg = argv[pos];
+        bool has_value = pos + 1 < argc;
+        if (!strcmp(arg, "--frames") && has_value)
+        {
+            frame_num = atoi(argv[++pos]);
+        }
+        else if (!strcmp(arg, "--golden") && has_value)
+        {
+            golden_path = argv[++pos];
+        }
+        else if (!strcmp(arg, "--baseline") && has_value)
+        {
+            baseline_path = argv[++pos];
+        }
+        else if (!strcmp(arg, "--threshold") && has_value)
+        {
+            threshold = atoi(argv[++pos]);
+        }
+        else if (!strcmp(arg, "--save") && has_value)
+        {
+            save_path = argv[++pos];
+        }
+        else if (!strcmp(arg, "--dump") && has_value)
+        {
+            dump_dir = argv[++pos];
+        }
+        else if (!strcmp(arg, "--partitions") && has_value)
+        {
+            options.partitions = argv[++pos];
+        }
+        else if (!strcmp(arg, "--port-offset") && has_value)
+        {
+            options.port_offset = atoi(argv[++pos]);
+        }
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (frame_num <= 0)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    Results golden, baseline;
+    if ((NULL != golden_path && !load_results(golden_path, &golden)) ||
+        (NULL != baseline_path && !load_results(baseline_path, &baseline)))
+    {
+        return 2;
+    }
+
+    // A fresh card and flash every run: saved settings would change playback
+    SimCheckDir work;
+    if (!sim_check_dir("render_check", &work, &options))
+    {
+        return 2;
+    }
+    if (!make_content(work.sd) || !sim_begin(&options))
+    {
+        sim_check_remove(work);
+        return 2;
+    }
+
+    sim_set_loop_task();
+    setup();
+    // Boot tasks run in real time, so the clock after setup() varies a little
+    if (millis() < RENDER_START_MS)
+    {
+        delay(RENDER_START_MS - millis());
+    }
+
+    Results results;
+    ImuAction action;
+    memset(&action, 0, sizeof(action));
+    // Like loop() before the first gesture: the app remembers the previous
+    // action, and a TURN_RIGHT right after boot would count as held
+    action.active = UNKNOWN;
+    picture_process(&action);
+    for (size_t pos = 0; pos < CASE_NUM; ++pos)
+    {
+        std::vector<Frame> &frames = results[cases[pos]];
+        for (int index = 0; index < frame_num; ++index)
+        {
+            action.active = 0 == index ? TURN_RIGHT : UNKNOWN;
+            action.isValid = 0 == index;
+            sim_panel_reset_stats();
+            uint64_t cpu_start = sim_thread_cpu_us();
+            picture_process(&action);
+            uint64_t cpu_us = sim_thread_cpu_us() - cpu_start;
+            SimPanelStats stats;
+            sim_panel_stats(&stats);
+            frames.push_back({sim_framebuffer_hash(), stats.bytes, cpu_us});
+
+            const Frame *expect = NULL;
+            if (golden.count(cases[pos]) && (size_t)index < golden[cases[pos]].size())
+            {
+                expect = &golden[cases[pos]][index];
+            }
+            bool first_diff = NULL != expect && (expect->hash != frames.back().hash) &&
+                              (0 == index || frames[index - 1].hash == golden[cases[pos]][index - 1].hash);
+            if (NULL != dump_dir && first_diff)
+            {
+                std::string path = std::string(dump_dir) + "/" + cases[pos] + "-" + std::to_string(index) + ".ppm";
+                sim_write_ppm(path.c_str());
+            }
+        }
+    }
+
+    bool failed = false;
+    printf("%-6s %6s %10s %10s %10s  %s\n", "model", "frames", "bytes", "cpu us", "base us", "result");
+    for (size_t pos = 0; pos < CASE_NUM; ++pos)
+    {
+        const char *name = cases[pos];
+        const std::vector<Frame> &frames = results[name];
+        uint64_t bytes = 0;
+        for (const Frame &frame : frames)
+        {
+            bytes += frame.bytes;
+        }
+        std::string verdict;
+        if (NULL != golden_path)
+        {
+            const std::vector<Frame> &expect = golden[name];
+            int diverged = -1;
+            for (size_t index = 0; index < frames.size() && index < expect.size() && diverged < 0; ++index)
+            {
+                if (frames[index].hash != expect[index].hash || frames[index].bytes != expect[index].bytes)
+                {
+                    diverged = (int)index;
+                }
+            }
+            if (expect.size() < frames.size())
+            {
+                verdict += "golden has " + std::to_string(expect.size()) + " frames; ";
+                failed = true;
+            }
+            if (diverged >= 0)
+            {
+                verdict += "output differs from frame " + std::to_string(diverged) + "; ";
+                failed = true;
+            }
+        }
+        uint64_t cpu_us = total_cpu(frames);
+        char base_text[16] = "-";
+        if (NULL != baseline_path && baseline.count(name))
+        {
+            uint64_t base_us = total_cpu(baseline[name]);
+            snprintf(base_text, sizeof(base_text), "%llu", (unsigned long long)base_us);
+            if (baseline[name].size() != frames.size())
+            {
+                verdict += "baseline has " + std::to_string(baseline[name].size()) + " frames; ";
+                failed = true;
+            }
+            else if (cpu_us > base_us + RENDER_MIN_REGRESSION_US && cpu_us * 100 > base_us * (100 + threshold))
+            {
+                verdict += "slower by " + std::to_string((cpu_us - base_us) * 100 / (base_us ? base_us : 1)) + "%; ";
+                failed = true;
+            }
+        }
+        else if (NULL != baseline_path)
+        {
+            verdict += "not in baseline; ";
+            failed = true;
+        }
+        if (verdict.empty())
+        {
+            verdict = "ok";
+        }
+        else
+        {
+            verdict.resize(verdict.size() - 2);
+        }
+        printf("%-6s %6u %10llu %10llu %10s  %s\n", name, (unsigned)frames.size(), (unsigned long long)bytes,
+               (unsigned long long)cpu_us, base_text, verdict.c_str());
+    }
+
+    if (NULL != save_path && !save_results(save_path, results))
+    {
+        failed = true;
+    }
+    sim_end();
+    sim_check_remove(work);
+    printf(failed ? "render check FAILED\n" : "render check passed\n");
+    fflush(stdout);
+    // Firmware tasks never return; leave without running static destructors under them
+    _exit(failed ? 1 : 0);
+}
@@ -0,0 +1,279 @@
+// Replay recorded orientation traces through the turntable frame mapping.
+//
+// Record a trace by building the firmware with IMU_TRACE defined (driver/imu.h)
+// and using turntable mode; every DMP quaternion is logged as
+//     quat,<ms>,<w>,<x>,<y>,<z>
+// A trace may name the mapping it was recorded for, overriding the options:
+//     scrub,<frames>,<degrees>,<yaw|roll|pitch>
+// and the frame that must be shown once the device has come to rest:
+//     expect,<ms>,<frame>
+// Other lines are ignored.
+//
+// The tool prints how the filtered mapping tracks the unfiltered one: frame
+// changes, flicker (A -> B -> A within --flicker ms) and the lag between the
+// raw angle entering a frame and the filtered output showing it. It exits
+// non-zero when a trace shows the wrong frame at an expect line, flickers
+// more than --max-flicker times, lags more than --max-lag ms, or changes
+// frames more often than the unfiltered mapping. scrub_traces/ holds traces
+// of slow and fast turns, a shaky hand on frame boundaries and roll; run them
+// after changing the filter or its constants (app/picture/turntable.h).
+//
+//     g++ -O2 -I../src/app/picture -o scrub_replay scrub_replay.cpp ../src/app/picture/turntable.cpp
+//     ./scrub_replay [--frames 11] [--degrees 360] [--axis yaw|roll|pitch] [--max-flicker 0] [--max-lag 300] [-v]
+//                    scrub_traces/*.log
+
+#include "turntable.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+struct Change
+{
+    uint32_t ms;
+    int frame;
+};
+
+struct Mapping
+{
+    int frames;
+    float degrees;
+    TURNTABLE_AXIS axis;
+};
+
+struct Totals
+{
+    int expects = 0;
+    int wrong = 0;
+    int flicker = 0;
+    int extra_changes = 0; // traces where the filter changed frames more often than the raw mapping
+    std::vector<uint32_t> lag;
+};
+
+static TURNTABLE_AXIS parse_axis(const char *name)
+{
+    return !strcmp(name, "roll") ? TURNTABLE_ROLL : !strcmp(name, "pitch") ? TURNTABLE_PITCH : TURNTABLE_YAW;
+}
+
+static int raw_frame(float angle, int frames, float degrees)
+{
+    int step = (int)floorf(angle / (degrees / frames) + 0.5f);
+    return ((step % frames) + frames) % frames;
+}
+
+static bool replay(const char *path, Mapping mapping, uint32_t flicker_ms, bool verbose, Totals *totals)
+{
+    FILE *file = fopen(path, "r");
+    if (NULL == file)
+    {
+        perror(path);
+        return false;
+    }
+
+    TurntableScrub scrub;
+    scrub.begin(mapping.frames, mapping.degrees, mapping.axis);
+    std::vector<Change> raw_changes;
+    std::vector<Change> changes;
+    bool primed = false;
+    float last = 0, unwrapped = 0;
+    int samples = 0;
+    int frame = 0;
+    int expects = 0, wrong = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), file))
+    {
+        unsigned ms;
+        float q[4];
+        int value;
+        char name[16];
+        if (3 == sscanf(line, "scrub,%d,%f,%15[a-z]", &mapping.frames, &mapping.degrees, name))
+        {
+            mapping.axis = parse_axis(name);
+            scrub.begin(mapping.frames, mapping.degrees, mapping.axis);
+            continue;
+        }
+        if (2 == sscanf(line, "expect,%u,%d", &ms, &value))
+        {
+            // 与该时间之前最后一个样本的输出比较
+            ++expects;
+            if (value != frame)
+            {
+                ++wrong;
+                printf("  %8u frame %2d, expected %d\n", ms, frame, value);
+            }
+            continue;
+        }
+        if (5 != sscanf(line, "quat,%u,%f,%f,%f,%f", &ms, &q[0], &q[1], &q[2], &q[3]))
+        {
+            continue;
+        }
+        ++samples;
+        // 未滤波的映射作为参照
+        float angle = TurntableScrub::axisAngle(q, mapping.axis);
+        if (!primed)
+        {
+            primed = true;
+            last = angle;
+        }
+        float delta = angle - last;
+        delta += delta > 180 ? -360 : (delta < -180 ? 360 : 0);
+        last = angle;
+        unwrapped += delta;
+        int raw = raw_frame(unwrapped, mapping.frames, mapping.degrees);
+        if (raw_changes.empty() || raw_changes.back().frame != raw)
+        {
+            raw_changes.push_back({ms, raw});
+        }
+
+        frame = scrub.update(q, ms);
+        if (changes.empty() || changes.back().frame != frame)
+        {
+            changes.push_back({ms, frame});
+            if (verbose)
+            {
+                printf("  %8u frame %2d  angle %7.1f  speed %7.1f deg/s\n", ms, frame, scrub.angle(), scrub.speed());
+            }
+        }
+    }
+    fclose(file);
+
+    int flicker = 0;
+    for (size_t pos = 2; pos < changes.size(); ++pos)
+    {
+        if (changes[pos].frame == changes[pos - 2].frame && changes[pos].ms - changes[pos - 2].ms <= flicker_ms)
+        {
+            ++flicker;
+        }
+    }
+    // 每次滤波输出换帧时，找最近一次原始映射进入该帧的时间
+    size_t raw_pos = 0;
+    for (size_t pos = 1; pos < changes.size(); ++pos)
+    {
+        while (raw_pos + 1 < raw_changes.size() && raw_changes[raw_pos + 1].ms <= changes[pos].ms)
+        {
+            ++raw_pos;
+        }
+        for (size_t back = raw_pos + 1; back-- > 0;)
+        {
+            if (raw_changes[back].frame == changes[pos].frame)
+            {
+                totals->lag.push_back(changes[pos].ms - raw_changes[back].ms);
+                break;
+            }
+        }
+    }
+
+    size_t filtered_count = changes.empty() ? 0 : changes.size() - 1;
+    size_t raw_count = raw_changes.empty() ? 0 : raw_changes.size() - 1;
+    printf("%s: %d samples, %zu frame changes (unfiltered %zu), %d flicker, %d/%d frames as expected\n", path,
+           samples, filtered_count, raw_count, flicker, expects - wrong, expects);
+    totals->expects += expects;
+    totals->wrong += wrong;
+    totals->flicker += flicker;
+    totals->extra_changes += filtered_count > raw_count ? 1 : 0;
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    Mapping mapping = {11, 360, TURNTABLE_YAW};
+    uint32_t flicker_ms = 200;
+    int max_flicker = 0;
+    uint32_t max_lag = 300;
+    bool verbose = false;
+    std::vector<const char *> paths;
+    for (int pos = 1; pos < argc; ++pos)
+    {
+        if (!strcmp(argv[pos], "--frames") && pos + 1 < argc)
+        {
+            mapping.frames = atoi(argv[++pos]);
+        }
+        else if (!strcmp(argv[pos], "--degrees") && pos + 1 < argc)
+        {
+            mapping.degrees = atof(argv[++pos]);
+        }
+        else if (!strcmp(argv[pos], "--flicker") && pos + 1 < argc)
+        {
+            flicker_ms = strtoul(argv[++pos], NULL, 10);
+        }
+        else if (!strcmp(argv[pos], "--axis") && pos + 1 < argc)
+        {
+            mapping.axis = parse_axis(argv[++pos]);
+        }
+        else if (!strcmp(argv[pos], "--max-flicker") && pos + 1 < argc)
+        {
+            max_flicker = atoi(argv[++pos]);
+        }
+        else if (!strcmp(argv[pos], "--max-lag") && pos + 1 < argc)
+        {
+            max_lag = strtoul(argv[++pos], NULL, 10);
+        }
+        else if (!strcmp(argv[pos], "-v"))
+        {
+            verbose = true;
+        }
+        else
+        {
+            paths.push_back(argv[pos]);
+        }
+    }
+    if (paths.empty() || mapping.frames < 2)
+    {
+        fprintf(stderr,
+                "usage: %s [--frames n] [--degrees d] [--axis yaw|roll|pitch] [--max-flicker n] [--max-lag ms] [-v] "
+                "trace.log...\n",
+                argv[0]);
+        return 2;
+    }
+
+    Totals totals;
+    for (const char *path : paths)
+    {
+        if (!replay(path, mapping, flicker_ms, verbose, &totals))
+        {
+            return 2;
+        }
+    }
+
+    uint32_t slowest = 0;
+    if (!totals.lag.empty())
+    {
+        std::vector<uint32_t> &lag = totals.lag;
+        std::sort(lag.begin(), lag.end());
+        unsigned long sum = 0;
+        for (uint32_t value : lag)
+        {
+            sum += value;
+        }
+        slowest = lag.back();
+        printf("lag ms: avg %.1f  p50 %u  p95 %u  max %u\n", (double)sum / lag.size(),
+               lag[lag.size() / 2], lag[lag.size() * 95 / 100], lag.back());
+    }
+
+    int failures = 0;
+    if (totals.wrong > 0)
+    {
+        printf("FAIL  %d of %d expected frames were not shown\n", totals.wrong, totals.expects);
+        ++failures;
+    }
+    if (totals.flicker > max_flicker)
+    {
+        printf("FAIL  %d flicker is above %d\n", totals.flicker, max_flicker);
+        ++failures;
+    }
+    if (slowest > max_lag)
+    {
+        printf("FAIL  lag %u ms is above %u ms\n", slowest, max_lag);
+        ++failures;
+    }
+    if (totals.extra_changes > 0)
+    {
+        printf("FAIL  %d traces change frames more often filtered than unfiltered\n", totals.extra_changes);
+        ++failures;
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,977 @@
+// Host checks for the firmware's HTTP service on the simulator (sim/).
+//
+// Boots the firmware with setup() on an empty card in a temporary directory,
+// runs loop() on its own thread in real time and talks to the HTTP server
+// over loopback like the phone app does.
+//
+// Protocol, on a second HttpServer with test routes: unknown methods get 501
+// and known methods on a path without them 405 with Allow; urlencoded POST
+// bodies become args, also when the next request is pipelined behind them;
+// a large response reaches a normal reader intact, and a reader that stops
+// reading a large response is dropped without holding up other connections
+// for longer than about HTTP_SEND_STALL_TIMEOUT.
+//
+// Load: an MJPEG clip on the card is started with a gesture from a generated
+// IMU trace; the interval between loop() calls (one video frame each) is
+// measured while idle, while HTTP_MAX_CLIENTS keep-alive clients poll
+// /status and /find every CHECK_POLL_MS, and while they poll as fast as they
+// can. Fails when the 99th percentile frame interval under the polling load
+// is more than CHECK_JITTER_MARGIN_MS above idle, or below CHECK_MIN_RPS
+// requests per second flat out. (On the device the server runs on the other
+// core; on a host with few cores the flat-out phase takes CPU from the loop,
+// so its frame times are only reported.)
+//
+// Listing (/list): a directory of CHECK_LIST_ENTRIES files is listed whole,
+// with sizes and mtimes, and page by page; every entry must come back once,
+// and the times are reported as the listing benchmark. The ETag must give
+// 304 for itself, W/ and in a list, and 200 for a tag that only contains it
+// or after the card changed.
+//
+// Discovery: a DISCOVERY_PROBE datagram to the discovery port over loopback
+// gets one JSON reply within CHECK_DISCOVERY_MS; the device name from the
+// card's config.txt, with quotes and a backslash in it, comes back escaped,
+// and gen equals the current /list ETag.
+//
+// Chunked upload (/upload/chunk, /upload/status, /upload/commit): a file is
+// sent in chunks over connections that are cut at random points, in the
+// headers, in the middle of the body or before the reply was read. After
+// every drop the client asks /upload/status where to resume; chunks with a
+// wrong CRC or a wrong offset must be refused without touching the .part
+// file, and a chunk the card only takes part of (the write limit of the
+// simulated card) must leave .part at its length before that chunk. The
+// committed file must equal the source byte for byte. Of two requests for the
+// same chunk on separate connections, the one that ends second must get 409
+// and leave .part alone, also when both started before either ended.
+// Exits non-zero when a check fails.
+//
+//     pio run -e server_check
+//     .pio/build/server_check/program [--seed N] [--drops N] [--port-offset N]
+
+#include "Arduino.h"
+#include "sim.h"
+#include "sim_check.h"
+#include "rom/crc.h"
+#include "http_server.h"
+#include "discovery.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define CHECK_FILE_SIZE (100 * 1024 + 123)
+#define CHECK_CHUNK_SIZE (8 * 1024)
+#define CHECK_OVERLAP_TAIL 16       // bytes of a chunk request held back while another one overtakes it
+#define CHECK_DROPS 40              // connections cut during the upload
+#define CHECK_BOOT_TIMEOUT_MS 10000 // until the server accepts connections
+#define CHECK_MULTIPART_BOUNDARY "holo-check-boundary"
+#define CHECK_PROBE_PORT 88             // the test HttpServer, moved by --port-offset like port 80
+#define CHECK_BIG_SIZE (1024 * 1024)    // /big response
+#define CHECK_STALL_LIMIT_MS 600        // other requests while a reader stalls a large response
+#define CHECK_GESTURE_MS 3000           // trace time of the TURN_RIGHT that starts the clip
+#define CHECK_CLIP_REPEAT 10            // the clip on the card is the example clip this many times over
+#define CHECK_PLAY_TIMEOUT_MS 20000     // until the clip plays
+#define CHECK_SETTLE_MS 4000            // from the first frame to the first measurement
+#define CHECK_PHASE_MS 2000             // length of each measurement
+#define CHECK_POLL_MS 10                // request interval of every client in the polling phase
+#define CHECK_MIN_RPS 200
+#define CHECK_JITTER_MARGIN_MS 10
+#define CHECK_LIST_ENTRIES 1000
+#define CHECK_LIST_PAGE 100
+#define CHECK_LIST_LIMIT_MS 2000        // the whole directory in one listing
+#define CHECK_DISCOVERY_MS 500          // from the probe to the reply
+#define CHECK_DEVICE_NAME "Holo \"Desk\" \\ 1"
+#define CHECK_DEVICE_NAME_JSON "Holo \\\"Desk\\\" \\\\ 1"
+
+// 240x240, 104 frames of about 6KB: the player only takes frames below 10000 bytes
+static const char *const clip_source = "lib/Arduino_GFX/examples/ImgViewer/ImgViewerMjpeg/data/earth.mjpeg";
+
+static int http_port = 0;
+static int probe_port = 0;
+
+static uint64_t now_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+struct Response
+{
+    int status;
+    std::map<std::string, std::string> headers; // names in lower case
+    std::string body;
+};
+
+static int connect_server(int port = http_port, int rcvbuf = 0)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd >= 0 && rcvbuf > 0)
+    {
+        // Before connect(), so the window the server sees stays small
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    }
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (fd < 0 || 0 != connect(fd, (struct sockaddr *)&addr, sizeof(addr)))
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return -1;
+    }
+    int enable = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    struct timeval tv = {5, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    return fd;
+}
+
+static bool send_all(int fd, const char *data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t sent = ::send(fd, data, len, MSG_NOSIGNAL);
+        if (sent <= 0)
+        {
+            return false;
+        }
+        data += sent;
+        len -= sent;
+    }
+    return true;
+}
+
+// Reads one response from `fd`; `pending` keeps bytes of the next one
+static bool read_response(int fd, std::string &pending, Response *resp)
+{
+    char buf[4096];
+    size_t head_end;
+    while (std::string::npos == (head_end = pending.find("\r\n\r\n")))
+    {
+        ssize_t len = recv(fd, buf, sizeof(buf), 0);
+        if (len <= 0)
+        {
+            return false;
+        }
+        pending.append(buf, len);
+    }
+    std::string head = pending.substr(0, head_end);
+    pending.erase(0, head_end + 4);
+    resp->status = 0;
+    resp->headers.clear();
+    resp->body.clear();
+    if (1 != sscanf(head.c_str(), "HTTP/1.%*d %d", &resp->status))
+    {
+        return false;
+    }
+    for (size_t pos = head.find("\r\n"); std::string::npos != pos;)
+    {
+        size_t end = head.find("\r\n", pos + 2);
+        std::string line = head.substr(pos + 2, std::string::npos == end ? std::string::npos : end - pos - 2);
+        size_t colon = line.find(':');
+        if (std::string::npos != colon)
+        {
+            std::string name = line.substr(0, colon);
+            for (char &ch : name)
+            {
+                ch = tolower(ch);
+            }
+            size_t value = line.find_first_not_of(' ', colon + 1);
+            resp->headers[name] = std::string::npos == value ? "" : line.substr(value);
+        }
+        pos = end;
+    }
+
+    auto fill = [&](size_t want) {
+        while (pending.size() < want)
+        {
+            ssize_t len = recv(fd, buf, sizeof(buf), 0);
+            if (len <= 0)
+            {
+                return false;
+            }
+            pending.append(buf, len);
+        }
+        return true;
+    };
+    if (resp->headers.count("transfer-encoding"))
+    {
+        while (true)
+        {
+            size_t line_end;
+            while (std::string::npos == (line_end = pending.find("\r\n")))
+            {
+                if (!fill(pending.size() + 1))
+                {
+                    return false;
+                }
+            }
+            size_t len = strtoul(pending.c_str(), NULL, 16);
+            if (!fill(line_end + 2 + len + 2))
+            {
+                return false;
+            }
+            resp->body.append(pending, line_end + 2, len);
+            pending.erase(0, line_end + 2 + len + 2);
+            if (0 == len)
+            {
+                return true;
+            }
+        }
+    }
+    size_t len = 0;
+    if (resp->headers.count("content-length"))
+    {
+        len = strtoul(resp->headers["content-length"].c_str(), NULL, 10);
+    }
+    else if (304 != resp->status)
+    {
+        // Ends with the connection
+        while (fill(pending.size() + 1))
+        {
+        }
+        len = pending.size();
+    }
+    if (!fill(len))
+    {
+        return false;
+    }
+    resp->body = pending.substr(0, len);
+    pending.erase(0, len);
+    return true;
+}
+
+// One request on a connection of its own
+static bool request(const std::string &method, const std::string &target, const std::string &body,
+                    Response *resp, const std::string &headers = "")
+{
+    int fd = connect_server();
+    if (fd < 0)
+    {
+        return false;
+    }
+    std::string req = method + " " + target + " HTTP/1.1\r\nHost: holo\r\nConnection: close\r\n" + headers;
+    if (!body.empty())
+    {
+        req += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+    }
+    req += "\r\n" + body;
+    std::string pending;
+    bool ok = send_all(fd, req.data(), req.size()) && read_response(fd, pending, resp);
+    close(fd);
+    return ok;
+}
+
+// Sends `raw` on a new connection to `port` and reads `count` responses
+static bool exchange(int port, const std::string &raw, Response *resp, int count = 1)
+{
+    int fd = connect_server(port);
+    if (fd < 0)
+    {
+        return false;
+    }
+    std::string pending;
+    bool ok = send_all(fd, raw.data(), raw.size());
+    for (int pos = 0; ok && pos < count; ++pos)
+    {
+        ok = read_response(fd, pending, &resp[pos]);
+    }
+    close(fd);
+    return ok;
+}
+
+static long json_number(const std::string &json, const char *key)
+{
+    std::string pattern = std::string("\"") + key + "\":";
+    size_t pos = json.find(pattern);
+    return std::string::npos == pos ? -1 : strtol(json.c_str() + pos + pattern.size(), NULL, 10);
+}
+
+static bool read_host_file(const std::string &path, std::string *data)
+{
+    FILE *fp = fopen(path.c_str(), "rb");
+    if (NULL == fp)
+    {
+        return false;
+    }
+    char buf[4096];
+    size_t len;
+    data->clear();
+    while ((len = fread(buf, 1, sizeof(buf), fp)) > 0)
+    {
+        data->append(buf, len);
+    }
+    fclose(fp);
+    return true;
+}
+
+// The clip to play, a device name for discovery and an IMU trace lying still
+// with one TURN_RIGHT
+static bool make_content(const std::string &sd, const std::string &trace)
+{
+    std::string clip;
+    if (!read_host_file(clip_source, &clip))
+    {
+        fprintf(stderr, "server_check: cannot read %s\n", clip_source);
+        return false;
+    }
+    FILE *fp = fopen((sd + "/config.txt").c_str(), "w");
+    bool ok = NULL != fp && fprintf(fp, "device_name:%s\n", CHECK_DEVICE_NAME) > 0 && 0 == fclose(fp);
+    fp = fopen((sd + "/clip.mjpeg").c_str(), "wb");
+    for (int pos = 0; NULL != fp && pos < CHECK_CLIP_REPEAT; ++pos)
+    {
+        fwrite(clip.data(), 1, clip.size(), fp);
+    }
+    ok = ok && NULL != fp && 0 == fclose(fp);
+    fp = fopen(trace.c_str(), "w");
+    for (int ms = 0; NULL != fp && ms < CHECK_GESTURE_MS + 1000; ms += 10)
+    {
+        bool tilted = ms >= CHECK_GESTURE_MS && ms < CHECK_GESTURE_MS + 300;
+        fprintf(fp, "imu,%d,0,%d,16384,0,0,0\n", ms, tilted ? -8000 : 0);
+    }
+    return ok && NULL != fp && 0 == fclose(fp);
+}
+
+// ------------------------------------------------------------------ protocol
+
+static HttpServer *probe;
+
+static char big_byte(size_t pos)
+{
+    return (char)(pos * 7 + pos / 4096);
+}
+
+static bool probe_begin()
+{
+    probe = new HttpServer(CHECK_PROBE_PORT);
+    probe->on("/ping", HTTP_GET, []() { probe->send(200, "text/plain", "pong"); });
+    probe->on("/form", HTTP_POST, []() {
+        String echo;
+        for (int pos = 0; pos < probe->args(); ++pos)
+        {
+            echo += probe->arg(pos) + ";";
+        }
+        probe->send(200, "text/plain", echo);
+    });
+    probe->on("/big", HTTP_GET, []() {
+        probe->setContentLength(CHECK_BIG_SIZE);
+        probe->send(200, "application/octet-stream", "");
+        char buf[1024];
+        for (size_t sent = 0; sent < CHECK_BIG_SIZE; sent += sizeof(buf))
+        {
+            for (size_t pos = 0; pos < sizeof(buf); ++pos)
+            {
+                buf[pos] = big_byte(sent + pos);
+            }
+            probe->sendContent(buf, sizeof(buf));
+        }
+    });
+    return probe->begin();
+}
+
+static std::string form_request(const std::string &target, const std::string &body, bool close_conn)
+{
+    return "POST " + target + " HTTP/1.1\r\nHost: holo\r\n" + (close_conn ? "Connection: close\r\n" : "") +
+           "Content-Type: application/x-www-form-urlencoded\r\n"
+           "Content-Length: " +
+           std::to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+static void check_protocol()
+{
+    Response resp[2];
+    bool closed = false;
+    int fd = connect_server(probe_port);
+    if (fd >= 0)
+    {
+        // The connection must be closed after the 501
+        const char brew[] = "BREW /ping HTTP/1.1\r\nHost: holo\r\n\r\nGET /ping HTTP/1.1\r\n\r\n";
+        std::string pending;
+        send_all(fd, brew, sizeof(brew) - 1);
+        closed = read_response(fd, pending, &resp[0]) && !read_response(fd, pending, &resp[1]);
+        close(fd);
+    }
+    check(closed && 501 == resp[0].status, "an unknown method gets 501 and the connection is closed");
+    check(exchange(probe_port, "DELETE /ping HTTP/1.1\r\nConnection: close\r\n\r\n", resp) &&
+              405 == resp[0].status && "GET" == resp[0].headers["allow"],
+          "a method the path has no route for gets 405 with Allow");
+    check(exchange(probe_port, "GET /nothing HTTP/1.1\r\nConnection: close\r\n\r\n", resp) &&
+              404 == resp[0].status,
+          "an unknown path gets 404");
+
+    std::string pipelined = form_request("/form?q=1", "name=holo+cube&path=%2Fa%20b.jpg&empty=", false) +
+                            "GET /ping HTTP/1.1\r\nConnection: close\r\n\r\n";
+    check(exchange(probe_port, pipelined, resp, 2) && 200 == resp[0].status &&
+              "1;holo cube;/a b.jpg;;" == resp[0].body && "pong" == resp[1].body,
+          "urlencoded POST bodies become args, with a request pipelined behind");
+    check(exchange(probe_port, form_request("/form", "a=" + std::string(3000, 'x'), true), resp) &&
+              413 == resp[0].status,
+          "a form larger than the receive buffer gets 413");
+
+    std::string body;
+    bool intact = exchange(probe_port, "GET /big HTTP/1.1\r\nConnection: close\r\n\r\n", resp) &&
+                  CHECK_BIG_SIZE == resp[0].body.size();
+    for (size_t pos = 0; intact && pos < resp[0].body.size(); ++pos)
+    {
+        intact = resp[0].body[pos] == big_byte(pos);
+    }
+    check(intact, "a 1MB response reaches a reader intact");
+
+    // One client asks for /big and does not read it; the others must still be served
+    int stalled = connect_server(probe_port, 2048);
+    const char big[] = "GET /big HTTP/1.1\r\n\r\n";
+    send_all(stalled, big, sizeof(big) - 1);
+    usleep(50000);
+    uint64_t worst_us = 0;
+    bool answered = true;
+    for (int pos = 0; pos < 20; ++pos)
+    {
+        uint64_t start = now_us();
+        answered = answered && exchange(probe_port, "GET /ping HTTP/1.1\r\nConnection: close\r\n\r\n", resp) &&
+                   "pong" == resp[0].body;
+        worst_us = std::max(worst_us, now_us() - start);
+        usleep(20000);
+    }
+    printf("      slowest request next to a stalled reader: %.1f ms\n", worst_us / 1000.0);
+    check(answered && worst_us < CHECK_STALL_LIMIT_MS * 1000, "a stalled reader does not hold up other clients");
+    size_t got = 0;
+    char buf[4096];
+    ssize_t len;
+    while ((len = recv(stalled, buf, sizeof(buf), 0)) > 0)
+    {
+        got += len;
+    }
+    close(stalled);
+    check(0 == len && got < CHECK_BIG_SIZE, "the stalled reader is dropped");
+}
+
+// ---------------------------------------------------------------------- load
+
+static std::mutex loop_mutex;
+static std::vector<uint64_t> loop_ends; // host time after every loop()
+
+static void loop_task()
+{
+    sim_set_loop_task();
+    while (true)
+    {
+        loop();
+        std::lock_guard<std::mutex> lock(loop_mutex);
+        loop_ends.push_back(now_us());
+    }
+}
+
+// Intervals between loop() calls that ended in [from_us, to_us), sorted, in ms
+static std::vector<double> loop_intervals(uint64_t from_us, uint64_t to_us)
+{
+    std::vector<double> intervals;
+    std::lock_guard<std::mutex> lock(loop_mutex);
+    for (size_t pos = 1; pos < loop_ends.size(); ++pos)
+    {
+        if (loop_ends[pos - 1] >= from_us && loop_ends[pos] < to_us)
+        {
+            intervals.push_back((loop_ends[pos] - loop_ends[pos - 1]) / 1000.0);
+        }
+    }
+    std::sort(intervals.begin(), intervals.end());
+    return intervals;
+}
+
+static double percentile(const std::vector<double> &sorted, double pct)
+{
+    return sorted.empty() ? 0 : sorted[std::min(sorted.size() - 1, (size_t)(sorted.size() * pct / 100))];
+}
+
+static void load_client(std::atomic<bool> *stop, std::atomic<long> *done, int interval_ms)
+{
+    static const char *const targets[] = {"/status?stu=50;210;60", "/find"};
+    int fd = -1;
+    std::string pending;
+    for (long count = 0; !*stop; ++count)
+    {
+        if (fd < 0)
+        {
+            fd = connect_server();
+            pending.clear();
+        }
+        std::string req = std::string("GET ") + targets[count % 2] + " HTTP/1.1\r\nHost: holo\r\n\r\n";
+        Response resp;
+        if (fd >= 0 && send_all(fd, req.data(), req.size()) && read_response(fd, pending, &resp) &&
+            200 == resp.status)
+        {
+            ++*done;
+            if (interval_ms > 0)
+            {
+                usleep(interval_ms * 1000);
+            }
+        }
+        else if (fd >= 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+static void check_load()
+{
+    uint64_t start = now_us();
+    bool playing = false;
+    while (!playing && now_us() - start < CHECK_PLAY_TIMEOUT_MS * 1000ull)
+    {
+        usleep(100000);
+        std::vector<double> recent = loop_intervals(now_us() - 500000, now_us());
+        playing = recent.size() >= 10 && percentile(recent, 50) < 60;
+    }
+    check(playing, "the clip plays after the gesture");
+    if (!playing)
+    {
+        return;
+    }
+    // The name overlay and the print HUD (up with the first status) redraw
+    // for a while after they appear; that is not the server's cost
+    Response resp;
+    request("GET", "/status?stu=50;210;60", "", &resp);
+    usleep(CHECK_SETTLE_MS * 1000);
+
+    struct Phase
+    {
+        const char *name;
+        int interval_ms; // -1: no clients
+        uint64_t from_us;
+        uint64_t to_us;
+        long done;
+    } phases[] = {{"idle", -1, 0, 0, 0}, {"polled", CHECK_POLL_MS, 0, 0, 0}, {"flat", 0, 0, 0, 0}};
+    for (Phase &phase : phases)
+    {
+        std::atomic<bool> stop(false);
+        std::atomic<long> done(0);
+        std::vector<std::thread> clients;
+        for (int pos = 0; phase.interval_ms >= 0 && pos < HTTP_MAX_CLIENTS; ++pos)
+        {
+            clients.emplace_back(load_client, &stop, &done, phase.interval_ms);
+        }
+        phase.from_us = now_us();
+        usleep(CHECK_PHASE_MS * 1000);
+        phase.to_us = now_us();
+        stop = true;
+        for (std::thread &client : clients)
+        {
+            client.join();
+        }
+        phase.done = done;
+    }
+
+    printf("      %-6s %6s %8s %8s %8s %10s\n", "", "frames", "p50 ms", "p99 ms", "max ms", "requests/s");
+    std::vector<double> frames[3];
+    for (int pos = 0; pos < 3; ++pos)
+    {
+        const Phase &phase = phases[pos];
+        frames[pos] = loop_intervals(phase.from_us, phase.to_us);
+        printf("      %-6s %6u %8.1f %8.1f %8.1f %10.0f\n", phase.name, (unsigned)frames[pos].size(),
+               percentile(frames[pos], 50), percentile(frames[pos], 99), frames[pos].empty() ? 0 : frames[pos].back(),
+               phase.done * 1e6 / (phase.to_us - phase.from_us));
+    }
+    check(!frames[1].empty() && percentile(frames[1], 99) <= percentile(frames[0], 99) + CHECK_JITTER_MARGIN_MS,
+          "polling clients do not add frame jitter to playback");
+    check(phases[2].done * 1e6 / (phases[2].to_us - phases[2].from_us) >= CHECK_MIN_RPS,
+          "the server keeps up with clients polling flat out");
+}
+
+// ------------------------------------------------------------------- listing
+
+static size_t count_of(const std::string &text, const char *pattern)
+{
+    size_t count = 0;
+    for (size_t pos = text.find(pattern); std::string::npos != pos; pos = text.find(pattern, pos + 1))
+    {
+        ++count;
+    }
+    return count;
+}
+
+static double list_ms(const std::string &target, Response *resp, const std::string &headers = "")
+{
+    uint64_t start = now_us();
+    if (!request("GET", target, "", resp, headers))
+    {
+        resp->status = -1;
+    }
+    return (now_us() - start) / 1000.0;
+}
+
+static void check_listing(const std::string &sd)
+{
+    std::string dir = sd + "/bench";
+    mkdir(dir.c_str(), 0755);
+    for (int pos = 0; pos < CHECK_LIST_ENTRIES; ++pos)
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "/frame_%04d.jpg", pos);
+        FILE *fp = fopen((dir + std::string(name)).c_str(), "wb");
+        if (NULL != fp)
+        {
+            fwrite(name, 1, pos % 100, fp);
+            fclose(fp);
+        }
+    }
+
+    Response resp;
+    double full_ms = list_ms("/list?dir=/bench", &resp);
+    check(200 == resp.status && CHECK_LIST_ENTRIES == count_of(resp.body, "\"name\":"),
+          "a large directory is listed whole");
+    size_t full_bytes = resp.body.size();
+    std::string etag = resp.headers["etag"];
+    double fields_ms = list_ms("/list?dir=/bench&fields=size,mtime", &resp);
+    check(200 == resp.status && CHECK_LIST_ENTRIES == count_of(resp.body, "\"mtime\":") &&
+              std::string::npos != resp.body.find("\"name\":\"/bench/frame_0042.jpg\",\"size\":42,"),
+          "sizes and mtimes are listed");
+
+    double paged_ms = 0;
+    size_t listed = 0;
+    int pages = 0;
+    bool paged_ok = true;
+    for (long offset = 0; offset >= 0 && paged_ok && pages <= CHECK_LIST_ENTRIES / CHECK_LIST_PAGE + 1; ++pages)
+    {
+        paged_ms += list_ms("/list?dir=/bench&offset=" + std::to_string(offset) +
+                                "&limit=" + std::to_string(CHECK_LIST_PAGE),
+                            &resp);
+        paged_ok = 200 == resp.status && offset == json_number(resp.body, "offset");
+        listed += count_of(resp.body, "\"name\":");
+        offset = std::string::npos != resp.body.find("\"next\":null") ? -1 : json_number(resp.body, "next");
+    }
+    check(paged_ok && CHECK_LIST_ENTRIES == listed && CHECK_LIST_ENTRIES / CHECK_LIST_PAGE == pages,
+          "paging returns every entry once");
+    printf("      %d entries: whole %.1f ms (%u bytes), with size and mtime %.1f ms, %d pages %.1f ms\n",
+           CHECK_LIST_ENTRIES, full_ms, (unsigned)full_bytes, fields_ms, pages, paged_ms);
+    check(full_ms < CHECK_LIST_LIMIT_MS, "a large directory is listed in time");
+
+    check(!etag.empty() && 304 == (list_ms("/list?dir=/bench", &resp, "If-None-Match: " + etag + "\r\n"), resp.status) &&
+              resp.body.empty(),
+          "the ETag gives 304");
+    check(304 == (list_ms("/list?dir=/bench", &resp, "If-None-Match: W/" + etag + "\r\n"), resp.status) &&
+              304 == (list_ms("/list?dir=/bench", &resp, "If-None-Match: \"old\", " + etag + "\r\n"), resp.status) &&
+              304 == (list_ms("/list?dir=/bench", &resp, "If-None-Match: *\r\n"), resp.status),
+          "weak tags, lists and * match");
+    check(200 == (list_ms("/list?dir=/bench", &resp, "If-None-Match: " + etag + "x\r\n"), resp.status) &&
+              200 == (list_ms("/list?dir=/bench", &resp, "If-None-Match: \"x" + etag.substr(1) + "\r\n"), resp.status),
+          "a tag that only contains the ETag does not match");
+    request("GET", "/create?dirname=/bench2", "", &resp);
+    check(200 == (list_ms("/list?dir=/bench", &resp, "If-None-Match: " + etag + "\r\n"), resp.status) &&
+              resp.headers["etag"] != etag,
+          "the ETag changes with the card");
+}
+
+// ------------------------------------------------------------ discovery
+
+static void check_discovery()
+{
+    Response resp;
+    request("GET", "/list?dir=/", "", &resp);
+    std::string etag = resp.headers["etag"];
+
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct timeval tv = {2, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(DISCOVERY_PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    uint64_t start = now_us();
+    sendto(fd, DISCOVERY_PROBE, strlen(DISCOVERY_PROBE), 0, (struct sockaddr *)&addr, sizeof(addr));
+    char buf[DISCOVERY_REPLY_SIZE + 1];
+    ssize_t len = recv(fd, buf, DISCOVERY_REPLY_SIZE, 0);
+    double reply_ms = (now_us() - start) / 1000.0;
+    close(fd);
+
+    std::string reply(buf, len > 0 ? len : 0);
+    printf("      reply in %.1f ms: %s\n", reply_ms, reply.c_str());
+    check(len > 0 && reply_ms < CHECK_DISCOVERY_MS && '{' == reply.front() && '}' == reply.back(),
+          "a probe gets a reply");
+    check(std::string::npos != reply.find("\"name\":\"" CHECK_DEVICE_NAME_JSON "\","),
+          "the device name is escaped in the reply");
+    check(etag.size() > 2 && std::string::npos != reply.find("\"gen\":" + etag + "}"),
+          "gen is the /list ETag");
+    check(json_number(reply, "free_kb") > 0, "free space is reported");
+}
+
+// ------------------------------------------------------------ chunked upload
+
+static std::string chunk_request(const std::string &path, size_t offset, const std::string &data, uint32_t crc)
+{
+    char target[160];
+    snprintf(target, sizeof(target), "/upload/chunk?path=%s&offset=%u&crc=%08x", path.c_str(), (unsigned)offset,
+             (unsigned)crc);
+    std::string body = "--" CHECK_MULTIPART_BOUNDARY "\r\n"
+                       "Content-Disposition: form-data; name=\"data\"; filename=\"chunk\"\r\n"
+                       "Content-Type: application/octet-stream\r\n\r\n" +
+                       data + "\r\n--" CHECK_MULTIPART_BOUNDARY "--\r\n";
+    return std::string("POST ") + std::string(target) +
+           " HTTP/1.1\r\nHost: holo\r\nConnection: close\r\n"
+           "Content-Type: multipart/form-data; boundary=" CHECK_MULTIPART_BOUNDARY "\r\n"
+           "Content-Length: " +
+           std::to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+static long upload_status(const std::string &path)
+{
+    Response resp;
+    if (!request("GET", "/upload/status?path=" + path, "", &resp) || 200 != resp.status)
+    {
+        return -1;
+    }
+    return json_number(resp.body, "committed");
+}
+
+// Sends one chunk; cut_at < request size closes the connection after that
+// many bytes, cut_at == request size closes it without reading the reply
+static int send_chunk(const std::string &req, size_t cut_at)
+{
+    int fd = connect_server();
+    if (fd < 0)
+    {
+        return -1;
+    }
+    bool sent = send_all(fd, req.data(), cut_at < req.size() ? cut_at : req.size());
+    Response resp;
+    std::string pending;
+    int status = 0;
+    if (sent && cut_at > req.size())
+    {
+        status = read_response(fd, pending, &resp) ? resp.status : -1;
+    }
+    close(fd);
+    return status;
+}
+
+static void check_chunked_upload(const std::string &sd, std::mt19937 &rng, int drops)
+{
+    const std::string path = "/upload.bin";
+    std::string data(CHECK_FILE_SIZE, 0);
+    for (char &ch : data)
+    {
+        ch = (char)rng();
+    }
+    Response resp;
+    request("GET", "/upload/abort?path=" + path, "", &resp);
+    check(0 == upload_status(path), "a new upload starts at 0");
+
+    // Refused chunks leave .part alone
+    std::string first = data.substr(0, CHECK_CHUNK_SIZE);
+    uint32_t first_crc = crc32_le(0, (const uint8_t *)first.data(), first.size());
+    check(422 == send_chunk(chunk_request(path, 0, first, first_crc ^ 1), SIZE_MAX) && 0 == upload_status(path),
+          "a chunk with a wrong CRC is refused and not stored");
+    check(409 == send_chunk(chunk_request(path, 100, first, first_crc), SIZE_MAX) && 0 == upload_status(path),
+          "a chunk at the wrong offset is refused with 409");
+
+    // The card takes only part of a chunk: .part goes back to the chunk boundary
+    check(200 == send_chunk(chunk_request(path, 0, first, first_crc), SIZE_MAX) &&
+              CHECK_CHUNK_SIZE == upload_status(path),
+          "the first chunk is committed");
+    std::string second = data.substr(CHECK_CHUNK_SIZE, CHECK_CHUNK_SIZE);
+    uint32_t second_crc = crc32_le(0, (const uint8_t *)second.data(), second.size());
+    sim_sd_limit_writes(CHECK_CHUNK_SIZE / 3);
+    int status = send_chunk(chunk_request(path, CHECK_CHUNK_SIZE, second, second_crc), SIZE_MAX);
+    sim_sd_limit_writes(-1);
+    struct stat st;
+    bool part_ok = 0 == stat((sd + path + ".part").c_str(), &st) && CHECK_CHUNK_SIZE == st.st_size;
+    check(500 == status && part_ok && CHECK_CHUNK_SIZE == upload_status(path),
+          "a short write on the card is cut back to the last whole chunk");
+
+    // A retry on a new connection overtakes the original, still being received:
+    // both pass the offset check when they start, only the first to end is stored
+    std::string req = chunk_request(path, CHECK_CHUNK_SIZE, second, second_crc);
+    int slow = connect_server();
+    bool started = slow >= 0 && send_all(slow, req.data(), req.size() - CHECK_OVERLAP_TAIL);
+    usleep(100000);
+    int retry = send_chunk(req, SIZE_MAX);
+    int original = -1;
+    if (started && send_all(slow, req.data() + req.size() - CHECK_OVERLAP_TAIL, CHECK_OVERLAP_TAIL))
+    {
+        std::string pending;
+        original = read_response(slow, pending, &resp) ? resp.status : -1;
+    }
+    if (slow >= 0)
+    {
+        close(slow);
+    }
+    std::string part;
+    read_host_file(sd + path + ".part", &part);
+    printf("      overlapping chunks: retry %d, original %d, .part %u bytes\n", retry, original,
+           (unsigned)part.size());
+    check(200 == retry && 409 == original && 2 * CHECK_CHUNK_SIZE == upload_status(path) &&
+              part == data.substr(0, 2 * CHECK_CHUNK_SIZE),
+          "of two overlapping chunks at one offset the second to end is refused with 409");
+
+    // The rest over connections that drop at random points
+    int dropped = 0;
+    int resumed = 0;
+    int attempts = 0;
+    bool consistent = true;
+    long committed = upload_status(path);
+    while (committed < (long)data.size() && attempts < drops * 4 + 100)
+    {
+        ++attempts;
+        std::string chunk = data.substr(committed, CHECK_CHUNK_SIZE);
+        req = chunk_request(path, committed, chunk, crc32_le(0, (const uint8_t *)chunk.data(), chunk.size()));
+        size_t cut_at = SIZE_MAX;
+        if (dropped < drops && rng() % 2)
+        {
+            // Anywhere from the request line to "sent but reply not read"
+            cut_at = rng() % (req.size() + 1);
+            ++dropped;
+        }
+        status = send_chunk(req, cut_at);
+        if (SIZE_MAX != cut_at)
+        {
+            // Let the server notice the closed connection before asking it
+            usleep(100000);
+        }
+        long before = committed;
+        committed = upload_status(path);
+        // A cut connection may or may not have delivered the whole chunk, never a part of it
+        bool whole = committed == before || committed == before + (long)chunk.size();
+        if (SIZE_MAX != cut_at)
+        {
+            consistent = consistent && whole;
+            resumed += committed == before ? 1 : 0;
+        }
+        else
+        {
+            consistent = consistent && 200 == status && committed == before + (long)chunk.size();
+        }
+        if (committed < 0)
+        {
+            break;
+        }
+    }
+    printf("      %d of %d chunk requests cut, %d resent\n", dropped, attempts, resumed);
+    check(consistent, "after every dropped connection .part ends on a chunk boundary");
+    check(committed == (long)data.size(), "the upload resumes to the end");
+
+    check(request("GET", "/upload/commit?path=" + path + "&size=" + std::to_string(data.size() + 1), "", &resp) &&
+              409 == resp.status,
+          "commit with the wrong size is refused");
+    check(request("GET", "/upload/commit?path=" + path + "&size=" + std::to_string(data.size()), "", &resp) &&
+              200 == resp.status,
+          "commit renames .part");
+    std::string stored;
+    check(read_host_file(sd + path, &stored) && stored == data, "the file on the card equals the upload");
+    check(0 != stat((sd + path + ".part").c_str(), &st), "no .part is left behind");
+}
+
+// ---------------------------------------------------------------------- main
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [--seed N] [--drops N] [--partitions CSV] [--port-offset N]\n", prog);
+}
+
+int main(int argc, char **argv)
+{
+    SimOptions options;
+    sim_default_options(&options);
+    options.quiet = true;
+    unsigned seed = 1;
+    int drops = CHECK_DROPS;
+
+    for (int pos = 1; pos < argc; ++pos)
+    {
+        const char *arg = argv[pos];
+        bool has_value = pos + 1 < argc;
+        if (!strcmp(arg, "--seed") && has_value)
+        {
+            seed = strtoul(argv[++pos], NULL, 10);
+        }
+        else if (!strcmp(arg, "--drops") && has_value)
+        {
+            drops = atoi(argv[++pos]);
+        }
+        else if (!strcmp(arg, "--partitions") && has_value)
+        {
+            options.partitions = argv[++pos];
+        }
+        else if (!strcmp(arg, "--port-offset") && has_value)
+        {
+            options.port_offset = atoi(argv[++pos]);
+        }
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    http_port = 80 + options.port_offset;
+    probe_port = CHECK_PROBE_PORT + options.port_offset;
+
+    SimCheckDir work;
+    if (!sim_check_dir("server_check", &work, &options))
+    {
+        return 2;
+    }
+    std::string trace = work.path + "/gesture.trace";
+    options.imu_trace = trace.c_str();
+    if (!make_content(work.sd, trace) || !sim_begin(&options))
+    {
+        sim_check_remove(work);
+        return 2;
+    }
+
+    sim_set_loop_task();
+    setup();
+    std::thread(loop_task).detach();
+
+    auto start = std::chrono::steady_clock::now();
+    int fd;
+    while ((fd = connect_server()) < 0 &&
+           std::chrono::steady_clock::now() - start < std::chrono::milliseconds(CHECK_BOOT_TIMEOUT_MS))
+    {
+        usleep(20000);
+    }
+    check(fd >= 0, "the HTTP server accepts connections after boot");
+    if (fd >= 0)
+    {
+        close(fd);
+        check(probe_begin(), "a second server with test routes starts");
+        check_protocol();
+        // Before the upload: a new file on the card changes what the app plays
+        check_load();
+        check_listing(work.sd);
+        check_discovery();
+        std::mt19937 rng(seed);
+        check_chunked_upload(work.sd, rng, drops);
+    }
+
+    sim_end();
+    sim_check_remove(work);
+    printf(failures ? "server check FAILED (%d)\n" : "server check passed\n", failures);
+    fflush(stdout);
+    // Firmware tasks never return; leave without running static destructors under them
+    _exit(failures ? 1 : 0);
+}